@@ -32,6 +32,7 @@
 #include "Core/Errors.h"
 #include "Utils/Logger.h"
 #include "Utils/Threading.h"
+#include "Utils/Image/AsyncImageWriter.h"
 #include "Utils/Image/ImageIO.h"
 #include "Utils/Scripting/ScriptBindings.h"
 #include "RenderGraph/BasePasses/FullScreenPass.h"
@@ -135,50 +136,82 @@ namespace Falcor
         return pTexture;
     }
 
-    Texture::SharedPtr Texture::createFromFile(const std::filesystem::path& path, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    size_t Texture::DecodedFile::getSize() const
+    {
+        if (pBitmap) return pBitmap->getSize();
+        if (pDDS) return pDDS->imageData.size();
+        return 0;
+    }
+
+    Texture::DecodedFile Texture::decodeFile(const std::filesystem::path& path, bool loadAsSrgb)
     {
-        std::filesystem::path fullPath;
-        if (!findFileInDataDirectories(path, fullPath))
+        DecodedFile file;
+        file.loadAsSrgb = loadAsSrgb;
+        if (!findFileInDataDirectories(path, file.fullPath))
         {
             logWarning("Error when loading image file. Can't find image file '{}'.", path);
-            return nullptr;
+            file.fullPath.clear();
+            return file;
         }
 
-        Texture::SharedPtr pTex;
-        if (hasExtension(fullPath, "dds"))
+        if (hasExtension(file.fullPath, "dds"))
         {
             try
             {
-                pTex = ImageIO::loadTextureFromDDS(fullPath, loadAsSrgb);
+                file.pDDS = std::make_shared<DDSData>(ImageIO::loadDDSData(file.fullPath, loadAsSrgb));
             }
             catch (const std::exception& e)
             {
-                logWarning("Error loading '{}': {}", fullPath, e.what());
+                logWarning("Error loading '{}': {}", file.fullPath, e.what());
             }
         }
         else
         {
-            Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(fullPath, kTopDown);
-            if (pBitmap)
-            {
-                ResourceFormat texFormat = pBitmap->getFormat();
-                if (loadAsSrgb)
-                {
-                    texFormat = linearToSrgbFormat(texFormat);
-                }
+            file.pBitmap = Bitmap::createFromFile(file.fullPath, kTopDown);
+        }
+
+        return file;
+    }
 
-                pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
+    Texture::SharedPtr Texture::createFromDecodedFile(const DecodedFile& file, bool generateMipLevels, Texture::BindFlags bindFlags)
+    {
+        Texture::SharedPtr pTex;
+        if (file.pDDS)
+        {
+            try
+            {
+                pTex = ImageIO::createTextureFromDDS(*file.pDDS);
+                if (pTex == nullptr) logWarning("Error loading '{}': Unrecognized texture type.", file.fullPath);
             }
+            catch (const std::exception& e)
+            {
+                logWarning("Error loading '{}': {}", file.fullPath, e.what());
+            }
+        }
+        else if (file.pBitmap)
+        {
+            ResourceFormat texFormat = file.pBitmap->getFormat();
+            if (file.loadAsSrgb)
+            {
+                texFormat = linearToSrgbFormat(texFormat);
+            }
+
+            pTex = Texture::create2D(file.pBitmap->getWidth(), file.pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, file.pBitmap->getData(), bindFlags);
         }
 
         if (pTex != nullptr)
         {
-            pTex->setSourcePath(fullPath);
+            pTex->setSourcePath(file.fullPath);
         }
 
         return pTex;
     }
 
+    Texture::SharedPtr Texture::createFromFile(const std::filesystem::path& path, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        return createFromDecodedFile(decodeFile(path, loadAsSrgb), generateMipLevels, bindFlags);
+    }
+
     Texture::Texture(uint32_t width, uint32_t height, uint32_t depth, uint32_t arraySize, uint32_t mipLevels, uint32_t sampleCount, ResourceFormat format, Type type, BindFlags bindFlags)
         : Resource(type, bindFlags, 0), mWidth(width), mHeight(height), mDepth(depth), mMipLevels(mipLevels), mSampleCount(sampleCount), mArraySize(arraySize), mFormat(format)
     {
@@ -310,7 +343,7 @@ namespace Falcor
         return findViewCommon<ShaderResourceView>(this, mostDetailedMip, mipCount, firstArraySlice, arraySize, mSrvs, createFunc);
     }
 
-    void Texture::captureToFile(uint32_t mipLevel, uint32_t arraySlice, const std::filesystem::path& path, Bitmap::FileFormat format, Bitmap::ExportFlags exportFlags)
+    void Texture::captureToFile(uint32_t mipLevel, uint32_t arraySlice, const std::filesystem::path& path, Bitmap::FileFormat format, Bitmap::ExportFlags exportFlags, AsyncImageWriter* pWriter)
     {
         if (format == Bitmap::FileFormat::DdsFile)
         {
@@ -341,6 +374,12 @@ namespace Falcor
 
         uint32_t width = getWidth(mipLevel);
         uint32_t height = getHeight(mipLevel);
+        if (pWriter)
+        {
+            pWriter->write(path, width, height, format, exportFlags, resourceFormat, std::move(textureData));
+            return;
+        }
+
         auto func = [=]()
         {
             Bitmap::saveImage(path, width, height, format, exportFlags, resourceFormat, true, (void*)textureData.data());
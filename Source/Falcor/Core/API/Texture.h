@@ -40,6 +40,8 @@ namespace Falcor
     class Sampler;
     class Device;
     class RenderContext;
+    class AsyncImageWriter;
+    struct DDSData;
 
     /** Abstracts the API texture objects
     */
@@ -168,7 +170,39 @@ namespace Falcor
         */
         static SharedPtr create2DMS(uint32_t width, uint32_t height, ResourceFormat format, uint32_t sampleCount, uint32_t arraySize = 1, BindFlags bindFlags = BindFlags::ShaderResource);
 
+        /** Image file read into host memory by decodeFile().
+            Holds the decoded bitmap, or the contents of a DDS file in their GPU format.
+        */
+        struct DecodedFile
+        {
+            std::filesystem::path fullPath;         ///< Full path of the file. Empty if the file was not found.
+            bool loadAsSrgb = false;                ///< Create the texture using sRGB format.
+            Bitmap::UniqueConstPtr pBitmap;         ///< Decoded image of a non-DDS file, or nullptr.
+            std::shared_ptr<const DDSData> pDDS;    ///< Contents of a DDS file, or nullptr.
+
+            /** Get the size of the image data in bytes. Zero if the file failed to load.
+            */
+            size_t getSize() const;
+        };
+
+        /** Read and decode an image file into host memory. This is the part of createFromFile() that doesn't access the GPU,
+            so it can run on any thread. Errors are logged and result in a decoded file without image data.
+            \param[in] path File path of the image. Can also include a full path or relative path from a data directory.
+            \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3 or 4 component textures.
+            \return The decoded file.
+        */
+        static DecodedFile decodeFile(const std::filesystem::path& path, bool loadAsSrgb);
+
+        /** Create a new texture object from a file decoded with decodeFile().
+            \param[in] file The decoded file.
+            \param[in] generateMipLevels Whether the mip-chain should be generated. Ignored for DDS files, which contain their mip levels.
+            \param[in] bindFlags The bind flags to create the texture with. Ignored for DDS files.
+            \return A new texture, or nullptr if the file failed to load.
+        */
+        static SharedPtr createFromDecodedFile(const DecodedFile& file, bool generateMipLevels, BindFlags bindFlags = BindFlags::ShaderResource);
+
         /** Create a new texture object from a file.
+            This is decodeFile() followed by createFromDecodedFile().
             \param[in] path File path of the image. Can also include a full path or relative path from a data directory.
             \param[in] generateMipLevels Whether the mip-chain should be generated.
             \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3 or 4 component textures.
@@ -233,8 +267,9 @@ namespace Falcor
             \param[in] path Path of the file to save.
             \param[in] fileFormat Destination image file format (e.g., PNG, PFM, etc.)
             \param[in] exportFlags Save flags, see Bitmap::ExportFlags
+            \param[in] pWriter Optional writer to queue the image on. If nullptr, the image is saved on a dispatched task.
         */
-        void captureToFile(uint32_t mipLevel, uint32_t arraySlice, const std::filesystem::path& path, Bitmap::FileFormat format = Bitmap::FileFormat::PngFile, Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None);
+        void captureToFile(uint32_t mipLevel, uint32_t arraySlice, const std::filesystem::path& path, Bitmap::FileFormat format = Bitmap::FileFormat::PngFile, Bitmap::ExportFlags exportFlags = Bitmap::ExportFlags::None, AsyncImageWriter* pWriter = nullptr);
 
         /** Generates mipmaps for a specified texture object.
             \param[in] pContext Used render context.
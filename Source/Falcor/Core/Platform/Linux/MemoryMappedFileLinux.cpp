@@ -0,0 +1,98 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Core/Platform/MemoryMappedFile.h"
+#include "Core/Errors.h"
+#include "Utils/StringFormatters.h"
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Falcor
+{
+    MemoryMappedFile::MemoryMappedFile(const std::filesystem::path& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) throw RuntimeError("Failed to open file '{}' for memory mapping.", path);
+
+        struct stat fileStat;
+        if (::fstat(fd, &fileStat) == -1)
+        {
+            ::close(fd);
+            throw RuntimeError("Failed to get size of file '{}'.", path);
+        }
+
+        mSize = (size_t)fileStat.st_size;
+        if (mSize > 0)
+        {
+            void* pData = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (pData == MAP_FAILED)
+            {
+                ::close(fd);
+                throw RuntimeError("Failed to memory map file '{}'.", path);
+            }
+            // Files are mostly read front to back.
+            ::madvise(pData, mSize, MADV_SEQUENTIAL);
+            mpData = pData;
+        }
+
+        // The mapping stays valid after closing the file descriptor.
+        ::close(fd);
+    }
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        close();
+    }
+
+    MemoryMappedFile::MemoryMappedFile(MemoryMappedFile&& other) noexcept
+        : mpData(std::exchange(other.mpData, nullptr))
+        , mSize(std::exchange(other.mSize, 0))
+    {
+    }
+
+    MemoryMappedFile& MemoryMappedFile::operator=(MemoryMappedFile&& other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            mpData = std::exchange(other.mpData, nullptr);
+            mSize = std::exchange(other.mSize, 0);
+        }
+        return *this;
+    }
+
+    void MemoryMappedFile::close()
+    {
+        if (mpData) ::munmap(mpData, mSize);
+        mpData = nullptr;
+        mSize = 0;
+    }
+}
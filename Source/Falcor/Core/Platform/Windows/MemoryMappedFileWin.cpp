@@ -0,0 +1,97 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Core/Platform/MemoryMappedFile.h"
+#include "Core/Errors.h"
+#include "Utils/StringFormatters.h"
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <utility>
+
+namespace Falcor
+{
+    MemoryMappedFile::MemoryMappedFile(const std::filesystem::path& path)
+    {
+        HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE) throw RuntimeError("Failed to open file '{}' for memory mapping.", path);
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(hFile, &fileSize))
+        {
+            CloseHandle(hFile);
+            throw RuntimeError("Failed to get size of file '{}'.", path);
+        }
+
+        mSize = (size_t)fileSize.QuadPart;
+        if (mSize > 0)
+        {
+            HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            void* pData = hMapping ? MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            // The view keeps the mapping alive after closing the handles.
+            if (hMapping) CloseHandle(hMapping);
+            if (!pData)
+            {
+                CloseHandle(hFile);
+                throw RuntimeError("Failed to memory map file '{}'.", path);
+            }
+            mpData = pData;
+        }
+
+        CloseHandle(hFile);
+    }
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        close();
+    }
+
+    MemoryMappedFile::MemoryMappedFile(MemoryMappedFile&& other) noexcept
+        : mpData(std::exchange(other.mpData, nullptr))
+        , mSize(std::exchange(other.mSize, 0))
+    {
+    }
+
+    MemoryMappedFile& MemoryMappedFile::operator=(MemoryMappedFile&& other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            mpData = std::exchange(other.mpData, nullptr);
+            mSize = std::exchange(other.mSize, 0);
+        }
+        return *this;
+    }
+
+    void MemoryMappedFile::close()
+    {
+        if (mpData) UnmapViewOfFile(mpData);
+        mpData = nullptr;
+        mSize = 0;
+    }
+}
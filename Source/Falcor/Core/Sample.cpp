@@ -35,6 +35,7 @@
 #include "Utils/Scripting/Scripting.h"
 #include "Utils/UI/TextRenderer.h"
 #include "Utils/Settings.h"
+#include "Utils/Timing/CpuProfiler.h"
 #include "RenderGraph/RenderPassLibrary.h"
 
 #include <imgui.h>
@@ -271,6 +272,7 @@ namespace Falcor
 
         OSServices::start();
         Threading::start();
+        CpuProfiler::instance().setThreadName("Main");
 
         mpSettings.reset(new Settings);
 
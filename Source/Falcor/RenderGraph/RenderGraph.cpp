@@ -75,6 +75,7 @@ namespace Falcor
         for (auto& it : mNodeData)
         {
             it.second.pPass->setScene(gpDevice->getRenderContext(), pScene);
+            mChangedPasses.insert(it.second.name);
         }
         mRecompile = true;
     }
@@ -94,11 +95,12 @@ namespace Falcor
             mNameToIndex[passName] = passIndex;
         }
 
-        pPass->mPassChangedCB = [this]() { mRecompile = true; };
+        pPass->mPassChangedCB = [this, passName]() { mRecompile = true; mChangedPasses.insert(passName); };
         pPass->mName = passName;
 
         if (mpScene) pPass->setScene(gpDevice->getRenderContext(), mpScene);
         mNodeData[passIndex] = { passName, pPass };
+        mChangedPasses.insert(passName);
         mRecompile = true;
         return passIndex;
     }
@@ -161,10 +163,11 @@ namespace Falcor
         std::string passTypeName = pOldPass->getType();
         auto pPass = RenderPassLibrary::instance().createPass(pRenderContext, passTypeName.c_str(), dict);
         pPassIt->second.pPass = pPass;
-        pPass->mPassChangedCB = [this]() { mRecompile = true; };
+        pPass->mPassChangedCB = [this, passName]() { mRecompile = true; mChangedPasses.insert(passName); };
         pPass->mName = pOldPass->getName();
 
         if (mpScene) pPass->setScene(gpDevice->getRenderContext(), mpScene);
+        mChangedPasses.insert(passName);
         mRecompile = true;
     }
 
@@ -399,15 +402,31 @@ namespace Falcor
         return outputs;
     }
 
+    void RenderGraph::setResourceAliasingEnabled(bool enabled)
+    {
+        if (mCompilerDeps.aliasTransientResources == enabled) return;
+        mCompilerDeps.aliasTransientResources = enabled;
+        mRecompile = true;
+    }
+
     bool RenderGraph::compile(RenderContext* pRenderContext, std::string& log)
     {
         if (!mRecompile) return true;
-        mpExe = nullptr;
+
+        // Keep the previous executable alive while compiling, so that unchanged passes and resources are reused.
+        auto pPreviousExe = std::move(mpExe);
+        auto changedPasses = std::move(mChangedPasses);
+        mChangedPasses.clear();
 
         try
         {
-            mpExe = RenderGraphCompiler::compile(*this, pRenderContext, mCompilerDeps);
+            mpExe = RenderGraphCompiler::compile(*this, pRenderContext, mCompilerDeps, pPreviousExe.get(), changedPasses);
             mRecompile = false;
+
+            mCompileStats = mpExe->getCompilePlan().getStats();
+            logInfo("Compiled render graph '{}' in {:.2f} ms: reflected {} and compiled {} of {} passes, reused {} of {} allocations.",
+                mName, mCompileStats.totalTime, mCompileStats.reflectedPassCount, mCompileStats.compiledPassCount, mCompileStats.passCount,
+                mCompileStats.reusedAllocationCount, mCompileStats.allocationCount);
             return true;
         }
         catch (const std::exception& e)
@@ -432,6 +451,7 @@ namespace Falcor
         c.pRenderContext = pRenderContext;
         c.defaultTexDims = mCompilerDeps.defaultResourceProps.dims;
         c.defaultTexFormat = mCompilerDeps.defaultResourceProps.format;
+        c.parallelPrepare = mParallelPassPreparation;
         mpExe->execute(c);
     }
 
@@ -685,6 +705,8 @@ namespace Falcor
         pybind11::class_<RenderGraph, RenderGraph::SharedPtr> renderGraph(m, "RenderGraph");
         renderGraph.def(pybind11::init(&RenderGraph::create));
         renderGraph.def_property("name", &RenderGraph::getName, &RenderGraph::setName);
+        renderGraph.def_property("resourceAliasing", &RenderGraph::isResourceAliasingEnabled, &RenderGraph::setResourceAliasingEnabled);
+        renderGraph.def_property("parallelPassPreparation", &RenderGraph::isParallelPassPreparationEnabled, &RenderGraph::setParallelPassPreparationEnabled);
         renderGraph.def(RenderGraphIR::kAddPass, &RenderGraph::addPass, "pass"_a, "name"_a);
         renderGraph.def(RenderGraphIR::kRemovePass, &RenderGraph::removePass, "name"_a);
         renderGraph.def(RenderGraphIR::kAddEdge, &RenderGraph::addEdge, "src"_a, "dst"_a);
@@ -228,11 +228,29 @@ namespace Falcor
         */
         void setName(const std::string& name) { mName = name; }
 
+        /** Enable/disable sharing of resources between pass outputs with disjoint lifetimes.
+            Passes that don't write an output in every execution must mark it persistent to keep its content when this is enabled.
+        */
+        void setResourceAliasingEnabled(bool enabled);
+
+        bool isResourceAliasingEnabled() const { return mCompilerDeps.aliasTransientResources; }
+
+        /** Enable/disable concurrent RenderPass::prepare() calls for passes that don't depend on each other.
+        */
+        void setParallelPassPreparationEnabled(bool enabled) { mParallelPassPreparation = enabled; }
+
+        bool isParallelPassPreparationEnabled() const { return mParallelPassPreparation; }
+
         /** Compile the graph.
+            After a successful compilation, only passes and resources affected by later changes are updated on recompilation.
         */
         bool compile(RenderContext* pRenderContext, std::string& log);
         bool compile(RenderContext* pRenderContext) { std::string s; return compile(pRenderContext, s); }
 
+        /** Get the statistics of the last successful compilation.
+        */
+        const RenderGraphCompilePlan::Stats& getCompileStats() const { return mCompileStats; }
+
     private:
         RenderGraph(const std::string& name);
 
@@ -284,6 +302,9 @@ namespace Falcor
         RenderGraphExe::SharedPtr mpExe;                            ///< Helper for allocating resources and executing the graph.
         RenderGraphCompiler::Dependencies mCompilerDeps;            ///< Data needed by the graph compiler.
         bool mRecompile = false;                                    ///< Set to true to trigger a recompilation after any graph changes (topology/scene/size/passes/etc.)
+        std::unordered_set<std::string> mChangedPasses;             ///< Passes that were added, replaced or requested a recompilation since the last compilation.
+        RenderGraphCompilePlan::Stats mCompileStats;                ///< Statistics of the last successful compilation.
+        bool mParallelPassPreparation = true;                       ///< Prepare independent passes concurrently.
 
         friend class RenderGraphUI;
         friend class RenderGraphExporter;
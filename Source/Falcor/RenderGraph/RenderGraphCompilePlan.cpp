@@ -0,0 +1,138 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "RenderGraphCompilePlan.h"
+
+namespace Falcor
+{
+    RenderGraphCompilePlan::RenderGraphCompilePlan(uint2 defaultTexDims, ResourceFormat defaultTexFormat)
+        : mDefaultTexDims(defaultTexDims)
+        , mDefaultTexFormat(defaultTexFormat)
+    {
+    }
+
+    void RenderGraphCompilePlan::setPassReflection(const std::string& name, const RenderPassReflection& reflection)
+    {
+        auto it = mPassIndices.find(name);
+        if (it == mPassIndices.end())
+        {
+            mPassIndices[name] = mPasses.size();
+            mPasses.push_back({ name, reflection });
+        }
+        else
+        {
+            mPasses[it->second].reflection = reflection;
+        }
+    }
+
+    void RenderGraphCompilePlan::setPassCompileData(const std::string& name, const RenderPassReflection& connectedResources)
+    {
+        auto it = mPassIndices.find(name);
+        FALCOR_ASSERT(it != mPassIndices.end());
+        auto& pass = mPasses[it->second];
+        pass.connectedResources = connectedResources;
+        pass.hasCompileData = true;
+    }
+
+    void RenderGraphCompilePlan::addResource(const std::string& name, const ResourceMemoryPlanner::ResourceDesc& desc)
+    {
+        FALCOR_ASSERT(mResourceIndices.count(name) == 0);
+        mResourceIndices[name] = mResources.size();
+        mResources.push_back({ name, desc });
+    }
+
+    bool RenderGraphCompilePlan::needsReflect(const RenderGraphCompilePlan* pPrevious, const std::string& name) const
+    {
+        if (!pPrevious || mChangedPasses.count(name) != 0) return true;
+        if (pPrevious->mDefaultTexDims != mDefaultTexDims || pPrevious->mDefaultTexFormat != mDefaultTexFormat) return true;
+        return pPrevious->getPass(name) == nullptr;
+    }
+
+    bool RenderGraphCompilePlan::needsCompile(const RenderGraphCompilePlan* pPrevious, const std::string& name) const
+    {
+        const Pass* pPass = getPass(name);
+        FALCOR_ASSERT(pPass && pPass->hasCompileData);
+        if (needsReflect(pPrevious, name)) return true;
+
+        const Pass* pPreviousPass = pPrevious->getPass(name);
+        return !pPreviousPass->hasCompileData || pPreviousPass->connectedResources != pPass->connectedResources;
+    }
+
+    bool RenderGraphCompilePlan::canReuseResource(const RenderGraphCompilePlan* pPrevious, const std::string& name) const
+    {
+        if (!pPrevious) return false;
+        const Resource* pResource = getResource(name);
+        const Resource* pPreviousResource = pPrevious->getResource(name);
+        return pResource && pPreviousResource && pResource->desc == pPreviousResource->desc;
+    }
+
+    RenderGraphCompilePlan::Diff RenderGraphCompilePlan::diff(const RenderGraphCompilePlan* pPrevious) const
+    {
+        Diff diff;
+
+        for (const auto& pass : mPasses)
+        {
+            bool reflect = needsReflect(pPrevious, pass.name);
+            bool compile = pass.hasCompileData && needsCompile(pPrevious, pass.name);
+            if (reflect) diff.reflectedPasses.push_back(pass.name);
+            if (compile) diff.compiledPasses.push_back(pass.name);
+            if (!reflect && !compile) diff.unchangedPasses.push_back(pass.name);
+        }
+
+        for (const auto& resource : mResources)
+        {
+            if (canReuseResource(pPrevious, resource.name)) diff.reusedResources.push_back(resource.name);
+            else diff.createdResources.push_back(resource.name);
+        }
+
+        if (pPrevious)
+        {
+            for (const auto& pass : pPrevious->mPasses)
+            {
+                if (getPass(pass.name) == nullptr) diff.removedPasses.push_back(pass.name);
+            }
+            for (const auto& resource : pPrevious->mResources)
+            {
+                if (getResource(resource.name) == nullptr) diff.releasedResources.push_back(resource.name);
+            }
+        }
+
+        return diff;
+    }
+
+    const RenderGraphCompilePlan::Pass* RenderGraphCompilePlan::getPass(const std::string& name) const
+    {
+        auto it = mPassIndices.find(name);
+        return it != mPassIndices.end() ? &mPasses[it->second] : nullptr;
+    }
+
+    const RenderGraphCompilePlan::Resource* RenderGraphCompilePlan::getResource(const std::string& name) const
+    {
+        auto it = mResourceIndices.find(name);
+        return it != mResourceIndices.end() ? &mResources[it->second] : nullptr;
+    }
+}
@@ -0,0 +1,174 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "RenderPassReflection.h"
+#include "ResourceMemoryPlanner.h"
+#include "Core/Macros.h"
+#include "Core/API/Formats.h"
+#include "Utils/Math/Vector.h"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Falcor
+{
+    /** Records the state of a render graph compilation and compares it against the previous one.
+
+        The compiler fills a plan with the reflection and compile data of every executed pass and the
+        resolved description of every allocated resource. Comparing it with the plan of the previous
+        compilation yields the passes that must be reflected and compiled again and the resources that
+        can keep their previous allocation, which allows recompiling a graph incrementally.
+
+        A pass must be reflected again when it was marked as changed (added, replaced or requested a
+        recompile), when it was not part of the previous compilation, or when the default resource
+        properties changed. It must be compiled again when it is reflected again or when its connected
+        resources changed. A resource can be reused when its resolved description is unchanged.
+
+        The plan only operates on descriptions and does not reference any passes or GPU resources.
+    */
+    class FALCOR_API RenderGraphCompilePlan
+    {
+    public:
+        struct Pass
+        {
+            std::string name;
+            RenderPassReflection reflection;            ///< Reflection returned by RenderPass::reflect() for the default properties.
+            RenderPassReflection connectedResources;    ///< Connected resources passed to RenderPass::compile().
+            bool hasCompileData = false;                ///< True if the connected resources were recorded.
+        };
+
+        struct Resource
+        {
+            std::string name;                           ///< Field name in the format PassName.FieldName.
+            ResourceMemoryPlanner::ResourceDesc desc;   ///< Resolved creation properties.
+        };
+
+        /** Difference between two compilations. Names are listed in execution order.
+        */
+        struct Diff
+        {
+            std::vector<std::string> reflectedPasses;   ///< Passes whose reflection must be recomputed.
+            std::vector<std::string> compiledPasses;    ///< Passes that must be compiled. Includes all reflected passes with compile data.
+            std::vector<std::string> unchangedPasses;   ///< Passes that keep their reflection and compiled state.
+            std::vector<std::string> removedPasses;     ///< Passes of the previous compilation that are no longer executed.
+            std::vector<std::string> reusedResources;   ///< Resources whose description is unchanged.
+            std::vector<std::string> createdResources;  ///< Resources that are new or whose description changed.
+            std::vector<std::string> releasedResources; ///< Resources of the previous compilation that no longer exist.
+        };
+
+        /** Compilation statistics. Times are in milliseconds.
+        */
+        struct Stats
+        {
+            uint32_t passCount = 0;
+            uint32_t reflectedPassCount = 0;
+            uint32_t compiledPassCount = 0;
+            uint32_t allocationCount = 0;
+            uint32_t reusedAllocationCount = 0;   ///< Allocations taken over from the previous compilation.
+            double resolveTime = 0.0;       ///< Time spent resolving the execution order and reflecting passes.
+            double compileTime = 0.0;       ///< Time spent compiling passes.
+            double allocateTime = 0.0;      ///< Time spent planning and creating resources.
+            double totalTime = 0.0;
+        };
+
+        /** Create an empty plan.
+            \param[in] defaultTexDims Default texture dimensions used for the compilation.
+            \param[in] defaultTexFormat Default texture format used for the compilation.
+        */
+        RenderGraphCompilePlan(uint2 defaultTexDims = {}, ResourceFormat defaultTexFormat = ResourceFormat::Unknown);
+
+        /** Mark a pass as changed since the previous compilation. Its reflection and compiled state are not reused.
+        */
+        void markPassChanged(const std::string& name) { mChangedPasses.insert(name); }
+
+        /** Set the reflection of a pass. Adds the pass if it doesn't exist.
+        */
+        void setPassReflection(const std::string& name, const RenderPassReflection& reflection);
+
+        /** Set the connected resources a pass is compiled with. The pass must exist.
+        */
+        void setPassCompileData(const std::string& name, const RenderPassReflection& connectedResources);
+
+        /** Add a resource.
+        */
+        void addResource(const std::string& name, const ResourceMemoryPlanner::ResourceDesc& desc);
+
+        /** Check if a pass must be reflected, or if its reflection from the previous compilation is still valid.
+            \param[in] pPrevious Plan of the previous compilation, or nullptr if there is none.
+            \param[in] name Pass name.
+        */
+        bool needsReflect(const RenderGraphCompilePlan* pPrevious, const std::string& name) const;
+
+        /** Check if a pass must be compiled. The pass compile data must have been set.
+            \param[in] pPrevious Plan of the previous compilation, or nullptr if there is none.
+            \param[in] name Pass name.
+        */
+        bool needsCompile(const RenderGraphCompilePlan* pPrevious, const std::string& name) const;
+
+        /** Check if a resource can keep its allocation from the previous compilation.
+            \param[in] pPrevious Plan of the previous compilation, or nullptr if there is none.
+            \param[in] name Resource name.
+        */
+        bool canReuseResource(const RenderGraphCompilePlan* pPrevious, const std::string& name) const;
+
+        /** Compare the plan against the plan of the previous compilation.
+            \param[in] pPrevious Plan of the previous compilation, or nullptr if there is none.
+        */
+        Diff diff(const RenderGraphCompilePlan* pPrevious) const;
+
+        /** Get a pass by name, or nullptr if it doesn't exist.
+        */
+        const Pass* getPass(const std::string& name) const;
+
+        /** Get a resource by name, or nullptr if it doesn't exist.
+        */
+        const Resource* getResource(const std::string& name) const;
+
+        const std::vector<Pass>& getPasses() const { return mPasses; }
+        const std::vector<Resource>& getResources() const { return mResources; }
+
+        uint2 getDefaultTexDims() const { return mDefaultTexDims; }
+        ResourceFormat getDefaultTexFormat() const { return mDefaultTexFormat; }
+
+        Stats& getStats() { return mStats; }
+        const Stats& getStats() const { return mStats; }
+
+    private:
+        uint2 mDefaultTexDims;
+        ResourceFormat mDefaultTexFormat;
+        std::unordered_set<std::string> mChangedPasses;
+
+        std::vector<Pass> mPasses;
+        std::unordered_map<std::string, size_t> mPassIndices;
+        std::vector<Resource> mResources;
+        std::unordered_map<std::string, size_t> mResourceIndices;
+
+        Stats mStats;
+    };
+}
@@ -30,6 +30,7 @@
 #include "RenderPasses/ResolvePass.h"
 #include "Utils/Algorithm/DirectedGraphTraversal.h"
 #include "Utils/StringUtils.h"
+#include "Utils/Timing/CpuTimer.h"
 
 namespace Falcor
 {
@@ -41,21 +42,44 @@ namespace Falcor
         }
     }
 
-    RenderGraphCompiler::RenderGraphCompiler(RenderGraph& graph, const Dependencies& dependencies) : mGraph(graph), mDependencies(dependencies) {}
+    RenderGraphCompiler::RenderGraphCompiler(RenderGraph& graph, const Dependencies& dependencies, const RenderGraphExe* pPreviousExe)
+        : mGraph(graph)
+        , mDependencies(dependencies)
+        , mpPreviousPlan(pPreviousExe ? &pPreviousExe->mCompilePlan : nullptr)
+        , mPlan(dependencies.defaultResourceProps.dims, dependencies.defaultResourceProps.format)
+    {}
 
-    RenderGraphExe::SharedPtr RenderGraphCompiler::compile(RenderGraph& graph, RenderContext* pRenderContext, const Dependencies& dependencies)
+    RenderGraphExe::SharedPtr RenderGraphCompiler::compile(RenderGraph& graph, RenderContext* pRenderContext, const Dependencies& dependencies, const RenderGraphExe* pPreviousExe, const std::unordered_set<std::string>& changedPasses)
     {
-        RenderGraphCompiler c = RenderGraphCompiler(graph, dependencies);
+        RenderGraphCompiler c = RenderGraphCompiler(graph, dependencies, pPreviousExe);
+        for (const auto& name : changedPasses) c.mPlan.markPassChanged(name);
 
         // Register the external resources
         auto pResourcesCache = ResourceCache::create();
         for (const auto&[name, pRes] : dependencies.externalResources) pResourcesCache->registerExternalResource(name, pRes);
 
+        auto startTime = CpuTimer::getCurrentTimePoint();
         c.resolveExecutionOrder();
+        auto compileStartTime = CpuTimer::getCurrentTimePoint();
         c.compilePasses(pRenderContext);
+        auto compileEndTime = CpuTimer::getCurrentTimePoint();
         if (c.insertAutoPasses()) c.resolveExecutionOrder();
         c.validateGraph();
-        c.allocateResources(pResourcesCache.get());
+        auto allocateStartTime = CpuTimer::getCurrentTimePoint();
+        c.allocateResources(pResourcesCache.get(), pPreviousExe ? pPreviousExe->mpResourceCache.get() : nullptr);
+        auto endTime = CpuTimer::getCurrentTimePoint();
+
+        auto diff = c.mPlan.diff(c.mpPreviousPlan);
+        auto& stats = c.mPlan.getStats();
+        stats.passCount = (uint32_t)c.mExecutionList.size();
+        stats.reflectedPassCount = (uint32_t)diff.reflectedPasses.size();
+        stats.compiledPassCount = (uint32_t)diff.compiledPasses.size();
+        stats.allocationCount = pResourcesCache->getMemoryStats().allocationCount;
+        stats.reusedAllocationCount = pResourcesCache->getReusedAllocationCount();
+        stats.resolveTime = CpuTimer::calcDuration(startTime, compileStartTime) + CpuTimer::calcDuration(compileEndTime, allocateStartTime);
+        stats.compileTime = CpuTimer::calcDuration(compileStartTime, compileEndTime);
+        stats.allocateTime = CpuTimer::calcDuration(allocateStartTime, endTime);
+        stats.totalTime = CpuTimer::calcDuration(startTime, endTime);
 
         auto pExe = RenderGraphExe::create();
         pExe->mExecutionList.reserve(c.mExecutionList.size());
@@ -64,8 +88,10 @@ namespace Falcor
         {
             pExe->insertPass(e.name, e.pPass);
         }
+        c.addPassDependencies(pExe->mTaskGraph);
         c.restoreCompilationChanges();
         pExe->mpResourceCache = pResourcesCache;
+        pExe->mCompilePlan = std::move(c.mPlan);
         return pExe;
     }
 
@@ -142,13 +168,16 @@ namespace Falcor
         compileData.defaultTexDims = mDependencies.defaultResourceProps.dims;
         compileData.defaultTexFormat = mDependencies.defaultResourceProps.format;
 
-        // For each object in the vector, if it's being used in the execution, put it in the list
+        // For each object in the vector, if it's being used in the execution, put it in the list.
+        // Passes that didn't change since the previous compilation keep their reflection.
         for (auto& node : topologicalSort)
         {
             if (participatingPasses.find(node) != participatingPasses.end())
             {
                 const auto pData = mGraph.mNodeData[node];
-                mExecutionList.push_back({ node, pData.pPass, pData.name, pData.pPass->reflect(compileData) });
+                RenderPassReflection reflection = mPlan.needsReflect(mpPreviousPlan, pData.name) ? pData.pPass->reflect(compileData) : mpPreviousPlan->getPass(pData.name)->reflection;
+                mPlan.setPassReflection(pData.name, reflection);
+                mExecutionList.push_back({ node, pData.pPass, pData.name, std::move(reflection) });
             }
         }
     }
@@ -230,6 +259,7 @@ namespace Falcor
                     }
 
                     mCompilationChanges.generatedPasses.push_back(resolvePassName);
+                    mPlan.markPassChanged(resolvePassName);
                     addedPasses = true;
                 }
             }
@@ -238,15 +268,9 @@ namespace Falcor
         return addedPasses;
     }
 
-    void RenderGraphCompiler::allocateResources(ResourceCache* pResourceCache)
+    void RenderGraphCompiler::allocateResources(ResourceCache* pResourceCache, const ResourceCache* pPreviousCache)
     {
-        // Build list to look up execution order index from the pass
-        std::unordered_map<RenderPass*, uint32_t> passToIndex;
-        for (size_t i = 0; i < mExecutionList.size(); i++)
-        {
-            passToIndex.emplace(mExecutionList[i].pPass.get(), uint32_t(i));
-        }
-
+        std::vector<std::string> resourceNames;
         for (size_t i = 0; i < mExecutionList.size(); i++)
         {
             uint32_t nodeIndex = mExecutionList[i].index;
@@ -284,6 +308,7 @@ namespace Falcor
                     uint32_t lifetime = graphOutput ? uint32_t(-1) : uint32_t(i);
                     if (graphOutput && field.getBindFlags() != ResourceBindFlags::None) field.bindFlags(field.getBindFlags() | ResourceBindFlags::ShaderResource); // Adding ShaderResource for graph outputs
                     pResourceCache->registerField(fullFieldName, field, lifetime);
+                    resourceNames.push_back(fullFieldName);
                 }
             }
 
@@ -308,16 +333,37 @@ namespace Falcor
                 std::string srcFieldName = mGraph.mNodeData[pEdge->getSourceNode()].name + '.' + edgeData.srcField;
                 std::string dstFieldName = mGraph.mNodeData[nodeIndex].name + '.' + dstField.getName();
 
-                const auto& pSrcPass = mGraph.mNodeData[pEdge->getSourceNode()].pPass.get();
-                const auto& srcReflection = mExecutionList[passToIndex.at(pSrcPass)].reflector;
-                pResourceCache->registerField(dstFieldName, dstField, passToIndex[pSrcPass], srcFieldName);
+                // The resource lives until the last pass reading it.
+                pResourceCache->registerField(dstFieldName, dstField, uint32_t(i), srcFieldName);
             }
         }
 
-        pResourceCache->allocateResources(mDependencies.defaultResourceProps);
+        pResourceCache->allocateResources(mDependencies.defaultResourceProps, mDependencies.aliasTransientResources, pPreviousCache);
+        for (const auto& name : resourceNames)
+        {
+            if (auto pDesc = pResourceCache->getResourceDesc(name)) mPlan.addResource(name, *pDesc);
+        }
     }
 
 
+    void RenderGraphCompiler::addPassDependencies(RenderPassTaskGraph& taskGraph) const
+    {
+        std::unordered_map<uint32_t, uint32_t> nodeToPass;
+        for (uint32_t i = 0; i < mExecutionList.size(); i++) nodeToPass[mExecutionList[i].index] = i;
+
+        // Both data and execution edges order the passes.
+        for (uint32_t i = 0; i < mExecutionList.size(); i++)
+        {
+            const DirectedGraph::Node* pNode = mGraph.mpGraph->getNode(mExecutionList[i].index);
+            for (uint32_t e = 0; e < pNode->getIncomingEdgeCount(); e++)
+            {
+                uint32_t srcNode = mGraph.mpGraph->getEdge(pNode->getIncomingEdge(e))->getSourceNode();
+                auto it = nodeToPass.find(srcNode);
+                if (it != nodeToPass.end()) taskGraph.addDependency(i, it->second);
+            }
+        }
+    }
+
     void RenderGraphCompiler::restoreCompilationChanges()
     {
         for (const auto& name : mCompilationChanges.generatedPasses) mGraph.removePass(name);
@@ -403,6 +449,9 @@ namespace Falcor
 
     void RenderGraphCompiler::compilePasses(RenderContext* pRenderContext)
     {
+        // The first attempt only compiles passes whose compile data changed since the previous compilation.
+        // If it fails, the passes are reflected again and all of them are compiled.
+        bool incremental = true;
         while(1)
         {
             std::string log;
@@ -411,7 +460,10 @@ namespace Falcor
             {
                 try
                 {
-                    p.pPass->compile(pRenderContext, prepPassCompilationData(p));
+                    auto compileData = prepPassCompilationData(p);
+                    mPlan.setPassCompileData(p.name, compileData.connectedResources);
+                    if (incremental && !mPlan.needsCompile(mpPreviousPlan, p.name)) continue;
+                    p.pPass->compile(pRenderContext, compileData);
                 }
                 catch (const std::exception& e)
                 {
@@ -423,6 +475,7 @@ namespace Falcor
             if (success) return;
 
             // Retry
+            incremental = false;
             bool changed = false;
             for (auto& p : mExecutionList)
             {
@@ -29,9 +29,11 @@
 #include "RenderPass.h"
 #include "RenderPassReflection.h"
 #include "ResourceCache.h"
+#include "RenderGraphCompilePlan.h"
 #include "RenderGraphExe.h"
 #include "Core/Macros.h"
 #include <string>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -46,13 +48,27 @@ namespace Falcor
         {
             ResourceCache::DefaultProperties defaultResourceProps;
             ResourceCache::ResourcesMap externalResources;
+            bool aliasTransientResources = true;
         };
-        static RenderGraphExe::SharedPtr compile(RenderGraph& graph, RenderContext* pRenderContext, const Dependencies& dependencies);
+
+        /** Compile a render graph.
+            If the executable of a previous compilation is given, the graph is recompiled incrementally: passes that didn't change
+            keep their reflection and are only compiled again if their connected resources changed, and resources with unchanged
+            creation properties are taken over from the previous executable.
+            \param[in] graph The graph to compile.
+            \param[in] pRenderContext The render context.
+            \param[in] dependencies Compilation dependencies.
+            \param[in] pPreviousExe Optional. Executable of the previous compilation of the same graph.
+            \param[in] changedPasses Passes that were added, replaced or requested a recompile since the previous compilation.
+        */
+        static RenderGraphExe::SharedPtr compile(RenderGraph& graph, RenderContext* pRenderContext, const Dependencies& dependencies, const RenderGraphExe* pPreviousExe = nullptr, const std::unordered_set<std::string>& changedPasses = {});
 
     private:
-        RenderGraphCompiler(RenderGraph& graph, const Dependencies& dependencies);
+        RenderGraphCompiler(RenderGraph& graph, const Dependencies& dependencies, const RenderGraphExe* pPreviousExe);
         RenderGraph& mGraph;
         const Dependencies& mDependencies;
+        const RenderGraphCompilePlan* mpPreviousPlan;
+        RenderGraphCompilePlan mPlan;
 
         struct PassData
         {
@@ -73,8 +89,9 @@ namespace Falcor
         void resolveExecutionOrder();
         void compilePasses(RenderContext* pRenderContext);
         bool insertAutoPasses();
-        void allocateResources(ResourceCache* pResourceCache);
+        void allocateResources(ResourceCache* pResourceCache, const ResourceCache* pPreviousCache);
         void validateGraph() const;
+        void addPassDependencies(RenderPassTaskGraph& taskGraph) const;
         void restoreCompilationChanges();
         RenderPass::CompileData prepPassCompilationData(const PassData& passData);
     };
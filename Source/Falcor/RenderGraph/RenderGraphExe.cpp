@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "RenderGraphExe.h"
 #include "Utils/Timing/Profiler.h"
+#include <algorithm>
 
 namespace Falcor
 {
@@ -34,6 +35,22 @@ namespace Falcor
     {
         FALCOR_PROFILE("RenderGraphExe::execute()");
 
+        // Prepare the passes on the CPU. Passes that don't depend on each other are prepared concurrently.
+        // Passes without a prepare() override are skipped after the first frame, and so is the whole step if no pass overrides it.
+        if (mPrepareRequired)
+        {
+            FALCOR_PROFILE("prepare");
+            mTaskGraph.run([&](uint32_t i)
+            {
+                const auto& pass = mExecutionList[i];
+                if (!pass.pPass->mHasPrepare) return;
+                RenderData renderData(pass.name, mpResourceCache, ctx.pGraphDictionary, ctx.defaultTexDims, ctx.defaultTexFormat);
+                pass.pPass->prepare(renderData);
+            }, ctx.parallelPrepare);
+            mPrepareRequired = std::any_of(mExecutionList.begin(), mExecutionList.end(), [](const Pass& pass) { return pass.pPass->mHasPrepare; });
+        }
+
+        // Execute the passes in order.
         for (const auto& pass : mExecutionList)
         {
             FALCOR_PROFILE(pass.name);
@@ -95,6 +112,8 @@ namespace Falcor
     void RenderGraphExe::insertPass(const std::string& name, const RenderPass::SharedPtr& pPass)
     {
         mExecutionList.push_back(Pass(name, pPass));
+        mTaskGraph.addPass(name);
+        mPrepareRequired = true;
     }
 
     Resource::SharedPtr RenderGraphExe::getResource(const std::string& name) const
@@ -28,6 +28,8 @@
 #pragma once
 #include "RenderPass.h"
 #include "ResourceCache.h"
+#include "RenderGraphCompilePlan.h"
+#include "RenderPassTaskGraph.h"
 #include "Core/Macros.h"
 #include "Core/HotReloadFlags.h"
 #include "Core/API/Formats.h"
@@ -54,9 +56,11 @@ namespace Falcor
             InternalDictionary::SharedPtr pGraphDictionary;
             uint2 defaultTexDims;
             ResourceFormat defaultTexFormat;
+            bool parallelPrepare = true;    ///< Prepare passes that don't depend on each other concurrently.
         };
 
-        /** Execute the graph
+        /** Execute the graph.
+            All passes are prepared first, then executed in order. See RenderPass::prepare().
         */
         void execute(const Context& ctx);
 
@@ -89,6 +93,14 @@ namespace Falcor
         */
         void setInput(const std::string& name, const Resource::SharedPtr& pResource);
 
+        /** Get the compile plan the executable was created from.
+        */
+        const RenderGraphCompilePlan& getCompilePlan() const { return mCompilePlan; }
+
+        /** Get the dependency graph of the passes.
+        */
+        const RenderPassTaskGraph& getTaskGraph() const { return mTaskGraph; }
+
     private:
         friend class RenderGraphCompiler;
         static SharedPtr create() { return SharedPtr(new RenderGraphExe); }
@@ -107,5 +119,8 @@ namespace Falcor
 
         std::vector<Pass> mExecutionList;
         ResourceCache::SharedPtr mpResourceCache;
+        RenderGraphCompilePlan mCompilePlan;
+        RenderPassTaskGraph mTaskGraph;
+        bool mPrepareRequired = true;   ///< Some pass overrides RenderPass::prepare(), or the passes were not prepared yet.
     };
 }
@@ -148,6 +148,15 @@ namespace Falcor
         */
         virtual void compile(RenderContext* pRenderContext, const CompileData& compileData) {}
 
+        /** Prepares the pass for execution on the CPU. Called every frame before any pass of the graph is executed.
+            The function is called after prepare() of all passes this pass depends on, and may run on a worker thread
+            concurrently with prepare() of other passes. It must not record GPU commands, create GPU objects or modify
+            the graph dictionary, as these are not thread-safe. Work that depends on other passes belongs in execute().
+            The default implementation marks the pass as not needing preparation, and the executor stops calling it.
+            Overrides must therefore not call the base implementation.
+        */
+        virtual void prepare(const RenderData& renderData) { mHasPrepare = false; }
+
         /** Executes the pass.
         */
         virtual void execute(RenderContext* pRenderContext, const RenderData& renderData) = 0;
@@ -201,6 +210,10 @@ namespace Falcor
 
         std::function<void(void)> mPassChangedCB = [] {};
 
+    private:
+        bool mHasPrepare = true;    ///< False once the default prepare() was called, i.e., the pass doesn't override it.
+
         friend class RenderGraph;
+        friend class RenderGraphExe;
     };
 }
@@ -0,0 +1,108 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "RenderPassTaskGraph.h"
+#include "Core/Errors.h"
+#include <algorithm>
+#include <exception>
+#include <execution>
+#include <mutex>
+
+namespace Falcor
+{
+    uint32_t RenderPassTaskGraph::addPass(const std::string& name)
+    {
+        mPasses.push_back({ name, {} });
+        mLevels.clear();
+        return (uint32_t)mPasses.size() - 1;
+    }
+
+    void RenderPassTaskGraph::addDependency(uint32_t pass, uint32_t dependency)
+    {
+        if (pass >= mPasses.size() || dependency >= pass)
+        {
+            throw ArgumentError("Invalid dependency of pass {} on pass {}. Passes can only depend on passes executed before them.", pass, dependency);
+        }
+
+        auto& dependencies = mPasses[pass].dependencies;
+        if (std::find(dependencies.begin(), dependencies.end(), dependency) == dependencies.end())
+        {
+            dependencies.push_back(dependency);
+            mLevels.clear();
+        }
+    }
+
+    std::vector<std::vector<uint32_t>> RenderPassTaskGraph::getLevels() const
+    {
+        // Dependencies always point to earlier passes, so a single pass in execution order resolves all levels.
+        std::vector<uint32_t> passLevels(mPasses.size(), 0);
+        std::vector<std::vector<uint32_t>> levels;
+        for (uint32_t i = 0; i < mPasses.size(); i++)
+        {
+            for (uint32_t d : mPasses[i].dependencies) passLevels[i] = std::max(passLevels[i], passLevels[d] + 1);
+            if (passLevels[i] >= levels.size()) levels.resize(passLevels[i] + 1);
+            levels[passLevels[i]].push_back(i);
+        }
+        return levels;
+    }
+
+    void RenderPassTaskGraph::run(const std::function<void(uint32_t)>& task, bool parallel) const
+    {
+        if (!parallel)
+        {
+            for (uint32_t i = 0; i < mPasses.size(); i++) task(i);
+            return;
+        }
+
+        if (mLevels.empty()) mLevels = getLevels();
+
+        std::exception_ptr pException;
+        std::mutex exceptionMutex;
+
+        for (const auto& level : mLevels)
+        {
+            // Exceptions must not escape a parallel algorithm, so they are captured and rethrown after the level finished.
+            auto runTask = [&](uint32_t pass)
+            {
+                try
+                {
+                    task(pass);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(exceptionMutex);
+                    if (!pException) pException = std::current_exception();
+                }
+            };
+
+            if (level.size() == 1) runTask(level[0]);
+            else std::for_each(std::execution::par, level.begin(), level.end(), runTask);
+
+            if (pException) std::rethrow_exception(pException);
+        }
+    }
+}
@@ -0,0 +1,88 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+    /** Dependency graph of the passes of a compiled render graph.
+
+        Passes are added in execution order and a pass can only depend on passes that come before it.
+        The graph is used to run per-pass CPU tasks concurrently: the task of a pass starts after the tasks
+        of all its dependencies have finished, and tasks of passes that don't depend on each other may run
+        at the same time. Passes are grouped into levels, where each level only depends on earlier levels,
+        and the levels are processed one after the other with the passes of a level running in parallel.
+    */
+    class FALCOR_API RenderPassTaskGraph
+    {
+    public:
+        /** Add a pass.
+            \param[in] name Pass name.
+            \return Index of the pass.
+        */
+        uint32_t addPass(const std::string& name);
+
+        /** Add a dependency between two passes.
+            \param[in] pass Index of the dependent pass.
+            \param[in] dependency Index of the pass it depends on. Must be smaller than 'pass'.
+        */
+        void addDependency(uint32_t pass, uint32_t dependency);
+
+        uint32_t getPassCount() const { return (uint32_t)mPasses.size(); }
+        const std::string& getPassName(uint32_t pass) const { return mPasses[pass].name; }
+        const std::vector<uint32_t>& getDependencies(uint32_t pass) const { return mPasses[pass].dependencies; }
+
+        /** Group the passes into levels. A pass is placed in the level after the last level containing one of its dependencies.
+            \return List of levels, each holding pass indices in execution order.
+        */
+        std::vector<std::vector<uint32_t>> getLevels() const;
+
+        /** Run a task for every pass.
+            The levels are computed on the first run after the graph changed and reused by later runs.
+            The task of a pass starts after the tasks of all its dependencies finished. If a task throws,
+            no tasks of later levels are started and the first exception is rethrown.
+            \param[in] task Function called with the pass index.
+            \param[in] parallel Run independent tasks concurrently. Otherwise tasks run on the calling thread in execution order.
+        */
+        void run(const std::function<void(uint32_t)>& task, bool parallel = true) const;
+
+    private:
+        struct Pass
+        {
+            std::string name;
+            std::vector<uint32_t> dependencies;
+        };
+
+        std::vector<Pass> mPasses;
+        mutable std::vector<std::vector<uint32_t>> mLevels;    ///< Levels used by run(). Empty until the first run after a change.
+    };
+}
@@ -29,6 +29,8 @@
 #include "Core/API/Texture.h"
 #include "Core/API/Buffer.h"
 #include "Utils/Logger.h"
+#include "Utils/StringUtils.h"
+#include <unordered_set>
 
 namespace Falcor
 {
@@ -65,6 +67,14 @@ namespace Falcor
         return mResourceData[i].field;
     }
 
+    const ResourceMemoryPlanner::ResourceDesc* ResourceCache::getResourceDesc(const std::string& name) const
+    {
+        auto it = mNameToIndex.find(name);
+        if (it == mNameToIndex.end()) return nullptr;
+        const auto& data = mResourceData[it->second];
+        return data.pResource ? &data.desc : nullptr;
+    }
+
     void ResourceCache::registerExternalResource(const std::string& name, const Resource::SharedPtr& pResource)
     {
         if(pResource) mExternalResources[name] = pResource;
@@ -116,7 +126,7 @@ namespace Falcor
         }
     }
 
-    Resource::SharedPtr createResourceForPass(const ResourceCache::DefaultProperties& params, const RenderPassReflection::Field& field, bool resolveBindFlags, const std::string& resourceName)
+    ResourceMemoryPlanner::ResourceDesc resolveResourceDesc(const ResourceCache::DefaultProperties& params, const RenderPassReflection::Field& field, bool resolveBindFlags)
     {
         uint32_t width = field.getWidth() ? field.getWidth() : params.dims.x;
         uint32_t height = field.getHeight() ? field.getHeight() : params.dims.y;
@@ -146,31 +156,37 @@ namespace Falcor
         {
             if (resolveBindFlags) bindFlags = Resource::BindFlags::UnorderedAccess | Resource::BindFlags::ShaderResource;
         }
+
+        return { field.getType(), width, height, depth, sampleCount, arraySize, mipLevels, format, bindFlags };
+    }
+
+    Resource::SharedPtr createResource(const ResourceMemoryPlanner::ResourceDesc& desc, const std::string& resourceName)
+    {
         Resource::SharedPtr pResource;
 
-        switch (field.getType())
+        switch (desc.type)
         {
         case RenderPassReflection::Field::Type::RawBuffer:
-            pResource = Buffer::create(width, bindFlags, Buffer::CpuAccess::None);
+            pResource = Buffer::create(desc.width, desc.bindFlags, Buffer::CpuAccess::None);
             break;
         case RenderPassReflection::Field::Type::Texture1D:
-            pResource = Texture::create1D(width, format, arraySize, mipLevels, nullptr, bindFlags);
+            pResource = Texture::create1D(desc.width, desc.format, desc.arraySize, desc.mipLevels, nullptr, desc.bindFlags);
             break;
         case RenderPassReflection::Field::Type::Texture2D:
-            if (sampleCount > 1)
+            if (desc.sampleCount > 1)
             {
-                pResource = Texture::create2DMS(width, height, format, sampleCount, arraySize, bindFlags);
+                pResource = Texture::create2DMS(desc.width, desc.height, desc.format, desc.sampleCount, desc.arraySize, desc.bindFlags);
             }
             else
             {
-                pResource = Texture::create2D(width, height, format, arraySize, mipLevels, nullptr, bindFlags);
+                pResource = Texture::create2D(desc.width, desc.height, desc.format, desc.arraySize, desc.mipLevels, nullptr, desc.bindFlags);
             }
             break;
         case RenderPassReflection::Field::Type::Texture3D:
-            pResource = Texture::create3D(width, height, depth, format, mipLevels, nullptr, bindFlags);
+            pResource = Texture::create3D(desc.width, desc.height, desc.depth, desc.format, desc.mipLevels, nullptr, desc.bindFlags);
             break;
         case RenderPassReflection::Field::Type::TextureCube:
-            pResource = Texture::createCube(width, height, format, arraySize, mipLevels, nullptr, bindFlags);
+            pResource = Texture::createCube(desc.width, desc.height, desc.format, desc.arraySize, desc.mipLevels, nullptr, desc.bindFlags);
             break;
         default:
             FALCOR_UNREACHABLE();
@@ -180,14 +196,70 @@ namespace Falcor
         return pResource;
     }
 
-    void ResourceCache::allocateResources(const DefaultProperties& params)
+    void ResourceCache::allocateResources(const DefaultProperties& params, bool aliasTransientResources, const ResourceCache* pPreviousCache)
     {
-        for (auto& data : mResourceData)
+        // Plan the memory of all resources that need to be created.
+        // Graph outputs are read after the graph executed, internal fields keep their content across frames
+        // and persistent fields must not change, so only the remaining fields can share resources.
+        ResourceMemoryPlanner planner;
+        std::vector<uint32_t> plannedIndices;
+        std::vector<ResourceMemoryPlanner::ResourceDesc> descs;
+        for (uint32_t i = 0; i < mResourceData.size(); i++)
+        {
+            const auto& data = mResourceData[i];
+            if ((data.pResource != nullptr) || !data.field.isValid()) continue;
+
+            bool transient = aliasTransientResources && data.lifetime.second != uint32_t(-1) &&
+                !is_set(data.field.getVisibility(), RenderPassReflection::Field::Visibility::Internal) &&
+                !is_set(data.field.getFlags(), RenderPassReflection::Field::Flags::Persistent);
+
+            descs.push_back(resolveResourceDesc(params, data.field, data.resolveBindFlags));
+            planner.addResource(descs.back(), data.lifetime.first, data.lifetime.second, transient);
+            plannedIndices.push_back(i);
+        }
+
+        auto plan = planner.plan();
+        std::vector<Resource::SharedPtr> allocations(plan.allocations.size());
+
+        // Take over the resources of the previous cache whose fields kept their creation properties.
+        // A previous resource backs at most one allocation, as aliased fields may no longer share one.
+        mReusedAllocationCount = 0;
+        if (pPreviousCache)
         {
-            if ((data.pResource == nullptr) && (data.field.isValid()))
+            std::unordered_set<const Resource*> takenResources;
+            for (size_t r = 0; r < plannedIndices.size(); r++)
             {
-                data.pResource = createResourceForPass(params, data.field, data.resolveBindFlags, data.name);
+                auto& pResource = allocations[plan.allocationIndices[r]];
+                if (pResource) continue;
+
+                const auto& data = mResourceData[plannedIndices[r]];
+                auto it = pPreviousCache->mNameToIndex.find(data.name);
+                if (it == pPreviousCache->mNameToIndex.end()) continue;
+
+                const auto& previousData = pPreviousCache->mResourceData[it->second];
+                if (!previousData.pResource || previousData.desc != descs[r]) continue;
+                if (!takenResources.insert(previousData.pResource.get()).second) continue;
+
+                pResource = previousData.pResource;
+                mReusedAllocationCount++;
             }
         }
+
+        for (size_t r = 0; r < plannedIndices.size(); r++)
+        {
+            auto& data = mResourceData[plannedIndices[r]];
+            auto& pResource = allocations[plan.allocationIndices[r]];
+            if (!pResource) pResource = createResource(descs[r], data.name);
+            data.pResource = pResource;
+            data.desc = descs[r];
+        }
+
+        mMemoryStats = plan.stats;
+        if (mMemoryStats.allocationCount < mMemoryStats.resourceCount)
+        {
+            logInfo("ResourceCache: Aliased {} resources into {} allocations, memory {} -> {} (peak in use {}).",
+                mMemoryStats.resourceCount, mMemoryStats.allocationCount, formatByteSize(mMemoryStats.dedicatedBytes),
+                formatByteSize(mMemoryStats.plannedBytes), formatByteSize(mMemoryStats.peakLiveBytes));
+        }
     }
 }
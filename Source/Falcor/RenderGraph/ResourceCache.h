@@ -27,6 +27,7 @@
  **************************************************************************/
 #pragma once
 #include "RenderPassReflection.h"
+#include "ResourceMemoryPlanner.h"
 #include "Core/Macros.h"
 #include "Core/API/Resource.h"
 #include <memory>
@@ -78,10 +79,28 @@ namespace Falcor
         */
         const RenderPassReflection::Field& getResourceReflection(const std::string& name) const;
 
+        /** Get the resolved creation properties of a resource. Only valid after allocateResources() was called.
+            \return The properties, or nullptr if the resource doesn't exist.
+        */
+        const ResourceMemoryPlanner::ResourceDesc* getResourceDesc(const std::string& name) const;
+
         /** Allocate all resources that need to be created/updated.
             This includes new resources, resources whose properties have been updated since last allocation call.
+            \param[in] params Default resource properties.
+            \param[in] aliasTransientResources If true, fields with identical properties and disjoint lifetimes share a resource.
+                Graph outputs, internal fields and persistent fields are never shared.
+            \param[in] pPreviousCache Optional. Cache of a previous compilation. Resources of fields with the same name and
+                unchanged creation properties are taken over from it instead of being created again.
+        */
+        void allocateResources(const DefaultProperties& params, bool aliasTransientResources = true, const ResourceCache* pPreviousCache = nullptr);
+
+        /** Get the memory statistics of the last allocation.
         */
-        void allocateResources(const DefaultProperties& params);
+        const ResourceMemoryPlanner::Stats& getMemoryStats() const { return mMemoryStats; }
+
+        /** Get the number of allocations of the last allocation that were taken over from a previous cache.
+        */
+        uint32_t getReusedAllocationCount() const { return mReusedAllocationCount; }
 
         /** Clears all registered field/resource properties and allocated resources.
         */
@@ -97,6 +116,7 @@ namespace Falcor
             Resource::SharedPtr pResource;          // The resource
             bool resolveBindFlags;                  // Whether or not we should resolve the field's bind-flags before creating the resource
             std::string name;                       // Full name of the resource, including the pass name
+            ResourceMemoryPlanner::ResourceDesc desc; // Resolved creation properties, valid once the resource is allocated
         };
 
         // Resources and properties for fields within (and therefore owned by) a render graph
@@ -105,6 +125,9 @@ namespace Falcor
 
         // References to output resources not to be allocated by the render graph
         ResourcesMap mExternalResources;
+
+        ResourceMemoryPlanner::Stats mMemoryStats;
+        uint32_t mReusedAllocationCount = 0;
     };
 
 }
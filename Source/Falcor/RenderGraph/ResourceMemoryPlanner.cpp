@@ -0,0 +1,156 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "ResourceMemoryPlanner.h"
+#include "Core/Errors.h"
+#include "Core/API/Resource.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace Falcor
+{
+    namespace
+    {
+        uint32_t divCeil(uint32_t a, uint32_t b) { return (a + b - 1) / b; }
+    }
+
+    bool ResourceMemoryPlanner::ResourceDesc::operator==(const ResourceDesc& other) const
+    {
+        return type == other.type && width == other.width && height == other.height && depth == other.depth &&
+            sampleCount == other.sampleCount && arraySize == other.arraySize && mipLevels == other.mipLevels &&
+            format == other.format && bindFlags == other.bindFlags;
+    }
+
+    uint64_t ResourceMemoryPlanner::ResourceDesc::getSizeInBytes() const
+    {
+        using Type = RenderPassReflection::Field::Type;
+        if (type == Type::RawBuffer) return width;
+        if (format == ResourceFormat::Unknown) return 0;
+
+        uint32_t w = width;
+        uint32_t h = type == Type::Texture1D ? 1 : height;
+        uint32_t d = type == Type::Texture3D ? depth : 1;
+        uint32_t layers = arraySize * (type == Type::TextureCube ? 6 : 1);
+
+        uint32_t maxMipLevels = 1 + (uint32_t)std::log2(std::max({ w, h, d, 1u }));
+        uint32_t mips = mipLevels == Resource::kMaxPossible ? maxMipLevels : std::min(mipLevels, maxMipLevels);
+
+        uint32_t blockWidth = getFormatWidthCompressionRatio(format);
+        uint32_t blockHeight = getFormatHeightCompressionRatio(format);
+        uint64_t size = 0;
+        for (uint32_t mip = 0; mip < mips; mip++)
+        {
+            uint32_t mipWidth = std::max(w >> mip, 1u);
+            uint32_t mipHeight = std::max(h >> mip, 1u);
+            uint32_t mipDepth = std::max(d >> mip, 1u);
+            size += (uint64_t)divCeil(mipWidth, blockWidth) * divCeil(mipHeight, blockHeight) * mipDepth * getFormatBytesPerBlock(format);
+        }
+        return size * layers * std::max(sampleCount, 1u);
+    }
+
+    uint32_t ResourceMemoryPlanner::addResource(const ResourceDesc& desc, uint32_t firstUse, uint32_t lastUse, bool transient)
+    {
+        if (firstUse > lastUse) throw ArgumentError("Resource lifetime [{}, {}] is empty.", firstUse, lastUse);
+        mResources.push_back({ desc, firstUse, lastUse, transient });
+        return (uint32_t)mResources.size() - 1;
+    }
+
+    ResourceMemoryPlanner::Plan ResourceMemoryPlanner::plan() const
+    {
+        Plan plan;
+        plan.allocationIndices.resize(mResources.size());
+        std::vector<uint32_t> allocationLastUse;
+        std::vector<bool> allocationTransient;
+
+        // Assign transient resources in order of their first use. Each one takes over the compatible allocation
+        // that was released most recently, otherwise it gets a new one. Per set of compatible resources this
+        // needs as many allocations as there are overlapping lifetimes.
+        std::vector<uint32_t> order(mResources.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return mResources[a].firstUse < mResources[b].firstUse; });
+
+        for (uint32_t i : order)
+        {
+            const auto& r = mResources[i];
+
+            uint32_t best = uint32_t(-1);
+            if (r.transient)
+            {
+                for (uint32_t a = 0; a < plan.allocations.size(); a++)
+                {
+                    if (!allocationTransient[a] || allocationLastUse[a] >= r.firstUse || plan.allocations[a] != r.desc) continue;
+                    if (best == uint32_t(-1) || allocationLastUse[a] > allocationLastUse[best]) best = a;
+                }
+            }
+
+            if (best == uint32_t(-1))
+            {
+                best = (uint32_t)plan.allocations.size();
+                plan.allocations.push_back(r.desc);
+                allocationLastUse.push_back(r.lastUse);
+                allocationTransient.push_back(r.transient);
+            }
+            allocationLastUse[best] = r.lastUse;
+            plan.allocationIndices[i] = best;
+        }
+
+        // Compute the memory statistics. Non-transient resources are considered live at all times.
+        Stats& stats = plan.stats;
+        stats.resourceCount = (uint32_t)mResources.size();
+        stats.allocationCount = (uint32_t)plan.allocations.size();
+        for (const auto& r : mResources) stats.dedicatedBytes += r.desc.getSizeInBytes();
+        for (const auto& desc : plan.allocations) stats.plannedBytes += desc.getSizeInBytes();
+
+        std::vector<std::pair<uint32_t, int64_t>> events;
+        uint64_t persistentBytes = 0;
+        for (const auto& r : mResources)
+        {
+            int64_t size = (int64_t)r.desc.getSizeInBytes();
+            if (!r.transient)
+            {
+                persistentBytes += size;
+                continue;
+            }
+            events.push_back({ r.firstUse, size });
+            if (r.lastUse != uint32_t(-1)) events.push_back({ r.lastUse + 1, -size });
+        }
+        // Releases sort before allocations at the same time point since the lifetimes are inclusive.
+        std::sort(events.begin(), events.end());
+
+        int64_t liveBytes = 0;
+        uint64_t peakBytes = 0;
+        for (const auto& e : events)
+        {
+            liveBytes += e.second;
+            peakBytes = std::max(peakBytes, (uint64_t)liveBytes);
+        }
+        stats.peakLiveBytes = persistentBytes + peakBytes;
+
+        return plan;
+    }
+}
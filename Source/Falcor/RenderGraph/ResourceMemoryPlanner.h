@@ -0,0 +1,111 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "RenderPassReflection.h"
+#include "Core/Macros.h"
+#include "Core/API/Formats.h"
+#include <cstdint>
+#include <vector>
+
+namespace Falcor
+{
+    /** Plans the memory of render graph resources.
+
+        Resources are described by their creation properties and the range of time points in which
+        they are used (normally indices into the execution order). Transient resources with identical
+        properties and disjoint lifetimes are assigned to the same allocation, so that a single resource
+        object backs all of them. Non-transient resources always get a dedicated allocation.
+
+        The planner only operates on descriptions and does not create any GPU resources.
+    */
+    class FALCOR_API ResourceMemoryPlanner
+    {
+    public:
+        /** Fully resolved resource creation properties.
+        */
+        struct ResourceDesc
+        {
+            RenderPassReflection::Field::Type type = RenderPassReflection::Field::Type::Texture2D;
+            uint32_t width = 0;                                 ///< Width in texels, or size in bytes for buffers.
+            uint32_t height = 1;
+            uint32_t depth = 1;
+            uint32_t sampleCount = 1;
+            uint32_t arraySize = 1;
+            uint32_t mipLevels = 1;                             ///< Mip count, or Resource::kMaxPossible for a full mip chain.
+            ResourceFormat format = ResourceFormat::Unknown;
+            ResourceBindFlags bindFlags = ResourceBindFlags::None;
+
+            bool operator==(const ResourceDesc& other) const;
+            bool operator!=(const ResourceDesc& other) const { return !(*this == other); }
+
+            /** Estimate the memory footprint in bytes, ignoring alignment and padding.
+            */
+            uint64_t getSizeInBytes() const;
+        };
+
+        struct Stats
+        {
+            uint32_t resourceCount = 0;     ///< Number of planned resources.
+            uint32_t allocationCount = 0;   ///< Number of allocations backing them.
+            uint64_t dedicatedBytes = 0;    ///< Memory if every resource had a dedicated allocation.
+            uint64_t plannedBytes = 0;      ///< Memory of the planned allocations.
+            uint64_t peakLiveBytes = 0;     ///< Largest memory of resources in use at the same time. This is a lower bound for any aliasing scheme.
+        };
+
+        struct Plan
+        {
+            std::vector<uint32_t> allocationIndices;    ///< Index of the allocation backing each resource, in the order resources were added.
+            std::vector<ResourceDesc> allocations;      ///< Creation properties of each allocation.
+            Stats stats;
+        };
+
+        /** Add a resource.
+            \param[in] desc Resource creation properties.
+            \param[in] firstUse First time point in which the resource is used.
+            \param[in] lastUse Last time point in which the resource is used (inclusive).
+            \param[in] transient True if the resource content is only needed within its lifetime and may share memory with other resources.
+            \return Index of the resource.
+        */
+        uint32_t addResource(const ResourceDesc& desc, uint32_t firstUse, uint32_t lastUse, bool transient);
+
+        /** Assign the resources to allocations.
+        */
+        Plan plan() const;
+
+    private:
+        struct Entry
+        {
+            ResourceDesc desc;
+            uint32_t firstUse;
+            uint32_t lastUse;
+            bool transient;
+        };
+
+        std::vector<Entry> mResources;
+    };
+}
@@ -29,9 +29,13 @@
 #include "Core/Assert.h"
 #include "Core/Errors.h"
 #include "Utils/Logger.h"
+#include "Utils/NumericRange.h"
+#include "Utils/Math/Common.h"
 #include "Utils/Timing/Profiler.h"
 #include "Utils/Scripting/ScriptBindings.h"
 #include <algorithm>
+#include <exception>
+#include <execution>
 
 namespace
 {
@@ -45,6 +49,13 @@ namespace
     const uint32_t kMaxLeafTriangleCount = 1 << PackedNode::kTriangleCountBits;
     const uint32_t kMaxLeafTriangleOffset = 1 << PackedNode::kTriangleOffsetBits;
 
+    // Parallel build: ranges with at least this many triangles are split in the top phase using parallel binning.
+    // Smaller ranges are built as independent subtrees in parallel tasks.
+    const uint32_t kMinParallelSplitTriangleCount = 1 << 13;
+
+    // Parallel build: number of triangles processed per task when binning or updating the SoA data.
+    const uint32_t kParallelChunkSize = 1 << 12;
+
     inline float safeACos(float v)
     {
         return std::acos(glm::clamp(v, -1.0f, 1.0f));
@@ -234,6 +245,43 @@ namespace Falcor
         return SharedPtr(new LightBVHBuilder(options));
     }
 
+    struct LightBVHBuilder::ParallelBuildData
+    {
+        std::vector<float> centers[3];          ///< Bounding box centers per dimension. SoA copy of the triangle data, kept in the same order.
+        std::vector<float> flux;                ///< Triangle flux. SoA copy of the triangle data, kept in the same order.
+        std::vector<uint32_t> binIds;           ///< Scratch: bin index per triangle.
+        std::vector<uint32_t> binnedIndices;    ///< Scratch: triangle indices sorted by bin, in triangle order within each bin.
+        std::vector<uint32_t> chunkOffsets;     ///< Scratch: per chunk and bin histogram/offsets into 'binnedIndices'.
+
+        ParallelBuildData(const std::vector<TriangleSortData>& trianglesData)
+        {
+            const size_t count = trianglesData.size();
+            for (auto& c : centers) c.resize(count);
+            flux.resize(count);
+            binIds.resize(count);
+            binnedIndices.resize(count);
+            update(trianglesData, Range(0, (uint32_t)count));
+        }
+
+        /** Update the SoA copy for a range of triangles after they have been reordered.
+        */
+        void update(const std::vector<TriangleSortData>& trianglesData, const Range& range)
+        {
+            auto chunkRange = NumericRange<uint32_t>(0, div_round_up(range.length(), kParallelChunkSize));
+            std::for_each(std::execution::par, chunkRange.begin(), chunkRange.end(), [&](uint32_t chunk)
+            {
+                const uint32_t first = range.begin + chunk * kParallelChunkSize;
+                const uint32_t last = std::min(first + kParallelChunkSize, range.end);
+                for (uint32_t i = first; i < last; ++i)
+                {
+                    const float3 center = trianglesData[i].bounds.center();
+                    for (uint32_t dimension = 0; dimension < 3; ++dimension) centers[dimension][i] = center[dimension];
+                    flux[i] = trianglesData[i].flux;
+                }
+            });
+        }
+    };
+
     void LightBVHBuilder::build(LightBVH& bvh)
     {
         FALCOR_PROFILE("LightBVHBuilder::build()");
@@ -244,12 +292,33 @@ namespace Falcor
         // Get global list of emissive triangles.
         FALCOR_ASSERT(bvh.mpLightCollection);
         const auto& triangles = bvh.mpLightCollection->getMeshLightTriangles();
-        if (triangles.empty()) return;
+
+        // Build the tree. If there are no non-culled triangles, we're done.
+        std::vector<uint32_t> triangleIndices;
+        std::vector<uint64_t> triangleBitmasks;
+        if (!buildNodes(triangles, bvh.mNodes, triangleIndices, triangleBitmasks)) return;
+
+        // The BVH is ready, mark it as valid and upload the data.
+        bvh.mIsValid = true;
+        bvh.mMaxTriangleCountPerLeaf = mOptions.maxTriangleCountPerLeaf;
+        bvh.uploadCPUBuffers(triangleIndices, triangleBitmasks);
+
+        // Computate metadata.
+        bvh.finalize();
+    }
+
+    bool LightBVHBuilder::buildNodes(const std::vector<LightCollection::MeshLightTriangle>& triangles, std::vector<PackedNode>& nodes, std::vector<uint32_t>& triangleIndices, std::vector<uint64_t>& triangleBitmasks)
+    {
+        nodes.clear();
+        triangleIndices.clear();
+        triangleBitmasks.clear();
+
+        if (triangles.empty()) return false;
 
         // Create list of triangles that should be included in BVH.
         // For each triangle, precompute data we need for the build.
-        BuildingData data(bvh.mNodes);
-        data.trianglesData.reserve(triangles.size());
+        std::vector<TriangleSortData> trianglesData;
+        trianglesData.reserve(triangles.size());
 
         for (size_t i = 0; i < triangles.size(); i++)
         {
@@ -266,19 +335,19 @@ namespace Falcor
                 tri.flux = triangles[i].flux;
                 tri.triangleIndex = static_cast<uint32_t>(i);
 
-                data.trianglesData.push_back(tri);
+                trianglesData.push_back(tri);
             }
         }
 
         // If there are no non-culled triangles, we're done.
-        if (data.trianglesData.empty()) return;
+        if (trianglesData.empty()) return false;
 
         // Validate options.
         if (mOptions.maxTriangleCountPerLeaf > kMaxLeafTriangleCount)
         {
             throw RuntimeError("Max triangle count per leaf exceeds the maximum supported ({})", kMaxLeafTriangleCount);
         }
-        if (data.trianglesData.size() > kMaxLeafTriangleOffset + kMaxLeafTriangleCount)
+        if (trianglesData.size() > kMaxLeafTriangleOffset + kMaxLeafTriangleCount)
         {
             throw RuntimeError("Emissive triangle count exceeds the maximum supported ({})", kMaxLeafTriangleOffset + kMaxLeafTriangleCount);
         }
@@ -287,7 +356,7 @@ namespace Falcor
         // To be grossly conservative, assume each triangle requires two nodes.
         // This is only system RAM and shouldn't be that much, so it's not worth being more careful about it.
         // TODO: Better estimate of how many nodes we will need.
-        data.nodes.clear();
+        BuildingData data(nodes, trianglesData, triangleBitmasks);
         data.nodes.reserve(2 * data.trianglesData.size());
         data.triangleIndices.reserve(data.trianglesData.size());
 
@@ -296,7 +365,14 @@ namespace Falcor
 
         // Build the tree.
         SplitHeuristicFunction splitFunc = getSplitFunction(mOptions.splitHeuristicSelection);
-        buildInternal(mOptions, splitFunc, 0ull, 0, Range(0, static_cast<uint32_t>(data.trianglesData.size())), data);
+        if (mOptions.useParallelBuild)
+        {
+            buildParallel(mOptions, splitFunc, data);
+        }
+        else
+        {
+            buildInternal(mOptions, splitFunc, 0ull, 0, Range(0, static_cast<uint32_t>(data.trianglesData.size())), data);
+        }
         FALCOR_ASSERT(!data.nodes.empty());
 
         size_t numValid = 0;
@@ -308,13 +384,8 @@ namespace Falcor
         float cosConeAngle;
         computeLightingConesInternal(0, data, cosConeAngle);
 
-        // The BVH is ready, mark it as valid and upload the data.
-        bvh.mIsValid = true;
-        bvh.mMaxTriangleCountPerLeaf = mOptions.maxTriangleCountPerLeaf;
-        bvh.uploadCPUBuffers(data.triangleIndices, data.triangleBitmasks);
-
-        // Computate metadata.
-        bvh.finalize();
+        triangleIndices = std::move(data.triangleIndices);
+        return true;
     }
 
     bool LightBVHBuilder::renderUI(Gui::Widgets& widget)
@@ -328,6 +399,7 @@ namespace Falcor
         bool optionsChanged = false;
 
         optionsChanged |= widget.checkbox("Allow refitting", options.allowRefitting);
+        optionsChanged |= widget.checkbox("Parallel build", options.useParallelBuild);
         optionsChanged |= widget.var("Max triangle count per leaf", options.maxTriangleCountPerLeaf, 1u, kMaxLeafTriangleCount);
         optionsChanged |= widget.dropdown("Split heuristic", kSplitHeuristicList, (uint32_t&)options.splitHeuristicSelection);
 
@@ -450,6 +522,172 @@ namespace Falcor
         }
     }
 
+    void LightBVHBuilder::buildParallel(const Options& options, const SplitHeuristicFunction& splitHeuristic, BuildingData& data)
+    {
+        const uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+        // Subtree deferred to a parallel task. Its node and triangle indices are local until it is stitched into the final tree.
+        struct Subtree
+        {
+            Range range;
+            uint64_t bitmask;
+            uint32_t depth;
+            std::vector<PackedNode> nodes;
+            std::vector<uint32_t> triangleIndices;
+            std::exception_ptr pException;
+
+            Subtree(const Range& _range, uint64_t _bitmask, uint32_t _depth) : range(_range), bitmask(_bitmask), depth(_depth) {}
+        };
+
+        // Node of the top levels in depth-first order. The left child is always the next entry.
+        struct TopNode
+        {
+            InternalNode node = {};
+            uint32_t rightIndex = kInvalidIndex;    ///< Index of the right child entry.
+            uint32_t subtreeIndex = kInvalidIndex;  ///< Index of the deferred subtree, or kInvalidIndex for an internal node.
+        };
+
+        ParallelBuildData parallelData(data.trianglesData);
+        std::vector<TopNode> topNodes;
+        std::vector<Subtree> subtrees;
+
+        // Top phase: split large ranges in the same order as buildInternal(), but bin them in parallel.
+        std::function<uint32_t(uint64_t, uint32_t, const Range&)> buildTop = [&](uint64_t bitmask, uint32_t depth, const Range& triangleRange)
+        {
+            const uint32_t topIndex = (uint32_t)topNodes.size();
+            topNodes.push_back({});
+
+            const auto deferSubtree = [&]()
+            {
+                topNodes[topIndex].subtreeIndex = (uint32_t)subtrees.size();
+                subtrees.emplace_back(triangleRange, bitmask, depth);
+                return topIndex;
+            };
+
+            if (triangleRange.length() < kMinParallelSplitTriangleCount) return deferSubtree();
+
+            // Compute the AABB of the node in parallel. The per-chunk boxes are merged in order so that the result is identical to the serial loop.
+            const uint32_t chunkCount = div_round_up(triangleRange.length(), kParallelChunkSize);
+            std::vector<AABB> chunkBounds(chunkCount);
+            auto chunkRange = NumericRange<uint32_t>(0, chunkCount);
+            std::for_each(std::execution::par, chunkRange.begin(), chunkRange.end(), [&](uint32_t chunk)
+            {
+                const uint32_t first = triangleRange.begin + chunk * kParallelChunkSize;
+                const uint32_t last = std::min(first + kParallelChunkSize, triangleRange.end);
+                for (uint32_t dataIndex = first; dataIndex < last; ++dataIndex) chunkBounds[chunk] |= data.trianglesData[dataIndex].bounds;
+            });
+            AABB nodeBounds;
+            for (const AABB& bounds : chunkBounds) nodeBounds |= bounds;
+            FALCOR_ASSERT(nodeBounds.valid());
+
+            // The total flux is accumulated serially to preserve the summation order.
+            float nodeFlux = 0.f;
+            for (uint32_t dataIndex = triangleRange.begin; dataIndex < triangleRange.end; ++dataIndex) nodeFlux += parallelData.flux[dataIndex];
+
+            data.currentNodeFlux = nodeFlux;
+            data.pParallelData = &parallelData;
+
+            bool trySplitting = triangleRange.length() > (options.createLeavesASAP ? options.maxTriangleCountPerLeaf : 1);
+            const SplitResult splitResult = trySplitting ? splitHeuristic(data, triangleRange, nodeBounds, options) : SplitResult();
+            data.pParallelData = nullptr;
+
+            // Leaves are always created by buildInternal().
+            if (!splitResult.isValid()) return deferSubtree();
+
+            FALCOR_ASSERT(triangleRange.begin < splitResult.triangleIndex && splitResult.triangleIndex < triangleRange.end);
+
+            // Sort the centroids and update the lists accordingly.
+            // This has to use the same algorithm on the same data as buildInternal() to produce the same order.
+            auto comp = [dim = splitResult.axis](const TriangleSortData& d1, const TriangleSortData& d2) { return d1.bounds.center()[dim] < d2.bounds.center()[dim]; };
+            std::nth_element(std::begin(data.trianglesData) + triangleRange.begin, std::begin(data.trianglesData) + splitResult.triangleIndex, std::begin(data.trianglesData) + triangleRange.end, comp);
+            parallelData.update(data.trianglesData, triangleRange);
+
+            if (depth >= kMaxBVHDepth)
+            {
+                throw RuntimeError("BVH depth of {} reached. Maximum of {} allowed.", depth + 1, kMaxBVHDepth);
+            }
+
+            InternalNode node = {};
+            node.attribs.setAABB(nodeBounds.minPoint, nodeBounds.maxPoint);
+            node.attribs.flux = nodeFlux;
+
+            uint32_t leftIndex = buildTop(bitmask | (0ull << depth), depth + 1, Range(triangleRange.begin, splitResult.triangleIndex));
+            uint32_t rightIndex = buildTop(bitmask | (1ull << depth), depth + 1, Range(splitResult.triangleIndex, triangleRange.end));
+            FALCOR_ASSERT(leftIndex == topIndex + 1);
+
+            topNodes[topIndex].node = node;
+            topNodes[topIndex].rightIndex = rightIndex;
+            return topIndex;
+        };
+        buildTop(0ull, 0, Range(0, static_cast<uint32_t>(data.trianglesData.size())));
+
+        // Build all deferred subtrees in parallel. The subtrees operate on disjoint triangle ranges.
+        // Exceptions can't propagate out of parallel algorithms, so they are captured and rethrown in order.
+        auto subtreeRange = NumericRange<size_t>(0, subtrees.size());
+        std::for_each(std::execution::par, subtreeRange.begin(), subtreeRange.end(), [&](size_t subtreeIndex)
+        {
+            Subtree& subtree = subtrees[subtreeIndex];
+            try
+            {
+                BuildingData subtreeData(subtree.nodes, data.trianglesData, data.triangleBitmasks);
+                subtreeData.nodes.reserve(2 * subtree.range.length());
+                subtreeData.triangleIndices.reserve(subtree.range.length());
+                buildInternal(options, splitHeuristic, subtree.bitmask, subtree.depth, subtree.range, subtreeData);
+                subtree.triangleIndices = std::move(subtreeData.triangleIndices);
+            }
+            catch (...)
+            {
+                subtree.pException = std::current_exception();
+            }
+        });
+        for (const auto& subtree : subtrees)
+        {
+            if (subtree.pException) std::rethrow_exception(subtree.pException);
+        }
+
+        // Stitch the top nodes and subtrees together in depth-first order.
+        std::function<uint32_t(uint32_t)> emitNode = [&](uint32_t topIndex)
+        {
+            const TopNode& topNode = topNodes[topIndex];
+            const uint32_t nodeIndex = (uint32_t)data.nodes.size();
+
+            if (topNode.subtreeIndex != kInvalidIndex)
+            {
+                const Subtree& subtree = subtrees[topNode.subtreeIndex];
+                const uint32_t triangleOffset = (uint32_t)data.triangleIndices.size();
+
+                // Relocate the child node and triangle offsets. These are stored in the first dword, which is patched
+                // directly rather than repacking the node, as repacking would requantize the node attributes.
+                for (PackedNode node : subtree.nodes)
+                {
+                    if (node.isLeaf())
+                    {
+                        FALCOR_ASSERT(node.getLeafNode().triangleOffset + triangleOffset < kMaxLeafTriangleOffset);
+                        node.data[0].x += triangleOffset;
+                    }
+                    else
+                    {
+                        node.data[0].x += nodeIndex;
+                    }
+                    data.nodes.push_back(node);
+                }
+                data.triangleIndices.insert(data.triangleIndices.end(), subtree.triangleIndices.begin(), subtree.triangleIndices.end());
+                return nodeIndex;
+            }
+
+            data.nodes.push_back({});
+
+            InternalNode node = topNode.node;
+            uint32_t leftIndex = emitNode(topIndex + 1);
+            FALCOR_ASSERT(leftIndex == nodeIndex + 1);
+            node.rightChildIdx = emitNode(topNode.rightIndex);
+
+            data.nodes[nodeIndex].setInternalNode(node);
+            return nodeIndex;
+        };
+        emitNode(0);
+    }
+
     float3 LightBVHBuilder::computeLightingConesInternal(const uint32_t nodeIndex, BuildingData& data, float& cosConeAngle)
     {
         if (!data.nodes[nodeIndex].isLeaf())
@@ -510,6 +748,115 @@ namespace Falcor
         return coneDirection;
     }
 
+    template<typename BinIdFunction>
+    void LightBVHBuilder::fillBins(const BuildingData& data, const Range& triangleRange, uint32_t dimension, const BinIdFunction& getBinId, bool computeCones, std::vector<Bin>& bins)
+    {
+        // Helpers to compute the lighting cone of a bin.
+        // The cone direction is the average direction over all lights in the bin and the cone angle is grown to include all.
+        // If the vector is zero length (no lights or if all directions cancelled out), the cone is marked as invalid.
+        // TODO: Switch to a more sophisticated algorithm to get narrower cones.
+        auto initCone = [](Bin& bin)
+        {
+            bin.cosConeAngle = glm::length(bin.coneDirection) < FLT_MIN ? kInvalidCosConeAngle : 1.0f;
+            bin.coneDirection = glm::normalize(bin.coneDirection);
+        };
+        auto growCone = [](Bin& bin, const TriangleSortData& td)
+        {
+            bin.cosConeAngle = computeCosConeAngle(bin.coneDirection, bin.cosConeAngle, td.coneDirection, td.cosConeAngle);
+        };
+
+        // Reset the bins.
+        for (Bin& bin : bins) bin = Bin();
+
+        ParallelBuildData* pParallelData = data.pParallelData;
+        if (!pParallelData || triangleRange.length() < kMinParallelSplitTriangleCount)
+        {
+            // Fill the bins with all triangles.
+            for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+            {
+                const auto& td = data.trianglesData[i];
+                bins[getBinId(td.bounds.center()[dimension])] |= td;
+            }
+
+            if (computeCones)
+            {
+                for (Bin& bin : bins) initCone(bin);
+                for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
+                {
+                    const auto& td = data.trianglesData[i];
+                    growCone(bins[getBinId(td.bounds.center()[dimension])], td);
+                }
+            }
+            return;
+        }
+
+        // Parallel binning. The bins accumulate floating-point sums, so to get results identical to the serial loop
+        // the triangles have to be accumulated into each bin in triangle order. This is done by a stable counting sort
+        // of the triangles by bin, after which each bin is accumulated independently.
+        const uint32_t binCount = (uint32_t)bins.size();
+        const uint32_t chunkCount = div_round_up(triangleRange.length(), kParallelChunkSize);
+        const float* centers = pParallelData->centers[dimension].data();
+        auto& binIds = pParallelData->binIds;
+        auto& binnedIndices = pParallelData->binnedIndices;
+        auto& chunkOffsets = pParallelData->chunkOffsets;
+        chunkOffsets.assign((size_t)chunkCount * binCount, 0);
+
+        // Compute the bin of each triangle and the per-chunk histograms.
+        auto chunkRange = NumericRange<uint32_t>(0, chunkCount);
+        std::for_each(std::execution::par, chunkRange.begin(), chunkRange.end(), [&](uint32_t chunk)
+        {
+            const uint32_t first = triangleRange.begin + chunk * kParallelChunkSize;
+            const uint32_t last = std::min(first + kParallelChunkSize, triangleRange.end);
+            uint32_t* histogram = &chunkOffsets[(size_t)chunk * binCount];
+            for (uint32_t i = first; i < last; ++i)
+            {
+                const uint32_t binId = getBinId(centers[i]);
+                binIds[i] = binId;
+                histogram[binId]++;
+            }
+        });
+
+        // Convert the histograms to offsets. Triangles are ordered by bin, then by chunk, then by index.
+        std::vector<uint32_t> binOffsets(binCount + 1);
+        uint32_t offset = triangleRange.begin;
+        for (uint32_t binId = 0; binId < binCount; ++binId)
+        {
+            binOffsets[binId] = offset;
+            for (uint32_t chunk = 0; chunk < chunkCount; ++chunk)
+            {
+                uint32_t& entry = chunkOffsets[(size_t)chunk * binCount + binId];
+                const uint32_t count = entry;
+                entry = offset;
+                offset += count;
+            }
+        }
+        binOffsets[binCount] = offset;
+        FALCOR_ASSERT(offset == triangleRange.end);
+
+        // Scatter the triangle indices.
+        std::for_each(std::execution::par, chunkRange.begin(), chunkRange.end(), [&](uint32_t chunk)
+        {
+            const uint32_t first = triangleRange.begin + chunk * kParallelChunkSize;
+            const uint32_t last = std::min(first + kParallelChunkSize, triangleRange.end);
+            uint32_t* offsets = &chunkOffsets[(size_t)chunk * binCount];
+            for (uint32_t i = first; i < last; ++i) binnedIndices[offsets[binIds[i]]++] = i;
+        });
+
+        // Accumulate each bin.
+        auto binRange = NumericRange<uint32_t>(0, binCount);
+        std::for_each(std::execution::par, binRange.begin(), binRange.end(), [&](uint32_t binId)
+        {
+            Bin& bin = bins[binId];
+            for (uint32_t j = binOffsets[binId]; j < binOffsets[binId + 1]; ++j) bin |= data.trianglesData[binnedIndices[j]];
+
+            if (computeCones)
+            {
+                initCone(bin);
+                for (uint32_t j = binOffsets[binId]; j < binOffsets[binId + 1]; ++j) growCone(bin, data.trianglesData[binnedIndices[j]]);
+            }
+        });
+    }
+
     LightBVHBuilder::SplitResult LightBVHBuilder::computeSplitWithEqual(const BuildingData& /*data*/, const Range& triangleRange, const AABB& nodeBounds, const Options& /*parameters*/)
     {
         // Find the largest dimension.
@@ -542,21 +889,6 @@ namespace Falcor
         std::pair<float, SplitResult> overallBestSplit = std::make_pair(std::numeric_limits<float>::infinity(), SplitResult());
         FALCOR_ASSERT(!overallBestSplit.second.isValid());
 
-        struct Bin
-        {
-            AABB bounds;
-            uint32_t triangleCount = 0;
-
-            Bin() = default;
-            Bin(const TriangleSortData& tri) : bounds(tri.bounds), triangleCount(1) {}
-            Bin& operator|= (const Bin& rhs)
-            {
-                bounds |= rhs.bounds;
-                triangleCount += rhs.triangleCount;
-                return *this;
-            }
-        };
-
         FALCOR_ASSERT(parameters.binCount > 1);
         std::vector<Bin> bins(parameters.binCount);
         std::vector<float> costs(parameters.binCount - 1);
@@ -567,26 +899,18 @@ namespace Falcor
         */
         const auto binAlongDimension = [&bins, &costs, &triangleRange, &data, &parameters, &overallBestSplit, &nodeBounds](uint32_t dimension)
         {
-            // Helper to compute the bin id for a given triangle.
-            auto getBinId = [&](const TriangleSortData& td)
+            // Helper to compute the bin id for a given triangle's bounding box center.
+            auto getBinId = [&](float p)
             {
                 float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
                 FALCOR_ASSERT(bmin < bmax);
                 float scale = (float)parameters.binCount / (bmax - bmin);
-                float p = td.bounds.center()[dimension];
                 FALCOR_ASSERT(bmin <= p && p <= bmax);
                 return std::min((uint32_t)((p - bmin) * scale), parameters.binCount - 1);
             };
 
-            // Reset the bins.
-            for (Bin& bin : bins) bin = Bin();
-
             // Fill the bins with all triangles.
-            for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
-            {
-                const auto& td = data.trianglesData[i];
-                bins[getBinId(td)] |= td;
-            }
+            fillBins(data, triangleRange, dimension, getBinId, false, bins);
 
             // First, compute A_j(L) * N_j(L) by sweeping over the bins from left to right.
             // Note that the costs vector has n-1 elements when there are n bins; the i:th elements represents the split between bin i and i+1.
@@ -702,27 +1026,6 @@ namespace Falcor
         uint32_t largestDimension = dimensions[2] >= dimensions[0] && dimensions[2] >= dimensions[1] ?
             2 : (dimensions[1] >= dimensions[0] && dimensions[1] >= dimensions[2] ? 1 : 0);
 
-        struct Bin
-        {
-            AABB bounds;
-            uint32_t triangleCount = 0;
-            float flux = 0.0f;
-            float3 coneDirection = float3(0.0f);
-            float cosConeAngle = 1.0f;
-
-            Bin() = default;
-            Bin(const TriangleSortData& tri) : bounds(tri.bounds), triangleCount(1), flux(tri.flux), coneDirection(tri.coneDirection), cosConeAngle(tri.cosConeAngle) {}
-            Bin& operator|= (const Bin& rhs)
-            {
-                bounds |= rhs.bounds;
-                triangleCount += rhs.triangleCount;
-                flux += rhs.flux;
-                coneDirection += rhs.coneDirection;
-                // Note: cosConeAngle should be computed separately after the final cone direction is known
-                return *this;
-            }
-        };
-
         FALCOR_ASSERT(parameters.binCount > 1);
         std::vector<Bin> bins(parameters.binCount);
         std::vector<float> costs(parameters.binCount - 1);
@@ -736,43 +1039,19 @@ namespace Falcor
         */
         const auto binAlongDimension = [&bins, &costs, &triangleRange, &data, &parameters, &overallBestSplit, &nodeBounds, largestDimension, dimensions](uint32_t dimension)
         {
-            // Helper to compute the bin id for a given triangle.
-            auto getBinId = [&](const TriangleSortData& td)
+            // Helper to compute the bin id for a given triangle's bounding box center.
+            auto getBinId = [&](float p)
             {
                 float bmin = nodeBounds.minPoint[dimension], bmax = nodeBounds.maxPoint[dimension];
                 float w = bmax - bmin;
                 FALCOR_ASSERT(w >= 0.f); // The node bounds can be zero if all primitives are axis-aligned and coplanar
                 float scale = w > FLT_MIN ? (float)parameters.binCount / w : 0.f;
-                float p = td.bounds.center()[dimension];
                 FALCOR_ASSERT(bmin <= p && p <= bmax);
                 return std::min((uint32_t)((p - bmin) * scale), parameters.binCount - 1);
             };
 
-            // Reset the bins.
-            for (Bin& bin : bins) bin = Bin();
-
-            // Fill the bins with all triangles.
-            for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
-            {
-                const auto& td = data.trianglesData[i];
-                bins[getBinId(td)] |= td;
-            }
-
-            // Compute the lighting cones for each bin.
-            // The cone direction is the average direction over all lights in the bin and the cone angle is grown to include all.
-            // If the vector is zero length (no lights or if all directions cancelled out), the cone is marked as invalid.
-            // TODO: Switch to a more sophisticated algorithm to get narrower cones.
-            for (Bin& bin : bins)
-            {
-                bin.cosConeAngle = glm::length(bin.coneDirection) < FLT_MIN ? kInvalidCosConeAngle : 1.0f;
-                bin.coneDirection = glm::normalize(bin.coneDirection);
-            }
-            for (uint32_t i = triangleRange.begin; i < triangleRange.end; ++i)
-            {
-                const auto& td = data.trianglesData[i];
-                Bin& bin = bins[getBinId(td)];
-                bin.cosConeAngle = computeCosConeAngle(bin.coneDirection, bin.cosConeAngle, td.coneDirection, td.cosConeAngle);
-            }
+            // Fill the bins with all triangles and compute the lighting cones for each bin.
+            fillBins(data, triangleRange, dimension, getBinId, true, bins);
 
             // First, compute A_j(L) * N_j(L) by sweeping over the bins from left to right.
             // Note that the costs vector has n-1 elements when there are n bins; the i:th elements represents the split between bin i and i+1.
@@ -914,6 +1193,7 @@ namespace Falcor
         options.field(allowRefitting);
         options.field(usePreintegration);
         options.field(useLightingCones);
+        options.field(useParallelBuild);
 #undef field
     }
 }
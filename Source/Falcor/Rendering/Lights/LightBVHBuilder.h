@@ -28,6 +28,7 @@
 #pragma once
 #include "LightBVH.h"
 #include "Core/Macros.h"
+#include "Scene/Lights/LightCollection.h"
 #include "Utils/Math/AABB.h"
 #include "Utils/Math/Vector.h"
 #include "Utils/UI/Gui.h"
@@ -74,6 +75,7 @@ namespace Falcor
             bool           allowRefitting = true;                                ///< Rather than always rebuilding the BVH from scratch, keep the hierarchy but update the bounds and lighting cones.
             bool           usePreintegration = true;                             ///< Use pre-integration for culling out emissive triangles and use their flux when computing the splits. Only valid when using the BinnedSAOH split heuristic.
             bool           useLightingCones = true;                              ///< Use lighting cones when computing the splits. Only valid when using the BinnedSAOH split heuristic.
+            bool           useParallelBuild = true;                              ///< Build the top levels with parallel binning and the subtrees below as parallel tasks. The result is identical to the serial build.
         };
 
         /** Creates a new object.
@@ -86,6 +88,16 @@ namespace Falcor
         */
         void build(LightBVH& bvh);
 
+        /** Build the BVH nodes on the CPU without creating any GPU resources.
+            This is the CPU part of build() and is exposed for validation and benchmarking of the builder.
+            \param[in] triangles List of emissive triangles.
+            \param[out] nodes BVH nodes in depth-first order.
+            \param[out] triangleIndices Triangle indices sorted by leaf node.
+            \param[out] triangleBitmasks Per triangle bit pattern retracing the tree traversal to reach the triangle. Indexed by global triangle index.
+            \return True if a BVH was built, false if there were no (non-culled) triangles.
+        */
+        bool buildNodes(const std::vector<LightCollection::MeshLightTriangle>& triangles, std::vector<PackedNode>& nodes, std::vector<uint32_t>& triangleIndices, std::vector<uint64_t>& triangleBitmasks);
+
         virtual bool renderUI(Gui::Widgets& widget);
 
         const Options& getOptions() const { return mOptions; }
@@ -123,15 +135,44 @@ namespace Falcor
             uint32_t triangleIndex = MeshLightData::kInvalidIndex; ///< Index into global triangle list.
         };
 
+        /** Aggregated data of all triangles falling into one bin of the binned SAH/SAOH split search.
+        */
+        struct Bin
+        {
+            AABB bounds;
+            uint32_t triangleCount = 0;
+            float flux = 0.0f;
+            float3 coneDirection = float3(0.0f);
+            float cosConeAngle = 1.0f;
+
+            Bin() = default;
+            Bin(const TriangleSortData& tri) : bounds(tri.bounds), triangleCount(1), flux(tri.flux), coneDirection(tri.coneDirection), cosConeAngle(tri.cosConeAngle) {}
+            Bin& operator|= (const Bin& rhs)
+            {
+                bounds |= rhs.bounds;
+                triangleCount += rhs.triangleCount;
+                flux += rhs.flux;
+                coneDirection += rhs.coneDirection;
+                // Note: cosConeAngle should be computed separately after the final cone direction is known
+                return *this;
+            }
+        };
+
+        /** Scratch data used by the parallel build. Defined in LightBVHBuilder.cpp.
+        */
+        struct ParallelBuildData;
+
         struct BuildingData
         {
             std::vector<PackedNode>& nodes;                 ///< BVH nodes generated by the builder.
-            std::vector<TriangleSortData> trianglesData;    ///< Compact list of triangles to include in build.
+            std::vector<TriangleSortData>& trianglesData;   ///< Compact list of triangles to include in build. Shared between all subtrees of a parallel build.
             std::vector<uint32_t> triangleIndices;          ///< Triangle indices sorted by leaf node. Each leaf node refers to a contiguous array of triangle indices.
-            std::vector<uint64_t> triangleBitmasks;         ///< Array containing the per triangle bit pattern retracing the tree traversal to reach the triangle: 0=left child, 1=right child; this array gets filled in during the build process. Indexed by global triangle index.
+            std::vector<uint64_t>& triangleBitmasks;        ///< Array containing the per triangle bit pattern retracing the tree traversal to reach the triangle: 0=left child, 1=right child; this array gets filled in during the build process. Indexed by global triangle index.
             float currentNodeFlux = 0.f;                    ///< Used by computeSAOHSplit() as the leaf creation cost.
+            ParallelBuildData* pParallelData = nullptr;     ///< Scratch data for parallel binning, or nullptr to bin serially.
 
-            BuildingData(std::vector<PackedNode>& bvhNodes) : nodes(bvhNodes) {}
+            BuildingData(std::vector<PackedNode>& bvhNodes, std::vector<TriangleSortData>& sortData, std::vector<uint64_t>& bitmasks)
+                : nodes(bvhNodes), trianglesData(sortData), triangleBitmasks(bitmasks) {}
         };
 
         /** Compute the split according to a specified heuristic.
@@ -158,6 +199,27 @@ namespace Falcor
         */
         uint32_t buildInternal(const Options& options, const SplitHeuristicFunction& splitHeuristic, uint64_t bitmask, uint32_t depth, const Range& triangleRange, BuildingData& data);
 
+        /** Parallel BVH build producing the exact same nodes as buildInternal() called on the root.
+            The top levels are split in order using parallel binning. Once a range falls below a size threshold,
+            its subtree is deferred and all deferred subtrees are built with buildInternal() as parallel tasks.
+            The subtrees are finally stitched together in depth-first order.
+            \param[in] splitHeuristic The splitting heuristic to be used.
+            \param[in,out] data Prepared light data.
+        */
+        void buildParallel(const Options& options, const SplitHeuristicFunction& splitHeuristic, BuildingData& data);
+
+        /** Fill the bins for a binned split search along one dimension.
+            Large ranges are binned in parallel if data.pParallelData is set. The result is bit-identical to serial binning.
+            \param[in] data Prepared light data.
+            \param[in] triangleRange Range of triangles to process.
+            \param[in] dimension The dimension to bin along.
+            \param[in] getBinId Maps a triangle's bounding box center along the dimension to a bin index.
+            \param[in] computeCones Compute the per-bin lighting cones.
+            \param[out] bins The bins. The vector is assumed to be sized to the bin count.
+        */
+        template<typename BinIdFunction>
+        static void fillBins(const BuildingData& data, const Range& triangleRange, uint32_t dimension, const BinIdFunction& getBinId, bool computeCones, std::vector<Bin>& bins);
+
         /** Recursive computation of lighting cones for all internal nodes.
             \param[in] nodeIndex Index of the current node.
             \param[in,out] data Updated node data.
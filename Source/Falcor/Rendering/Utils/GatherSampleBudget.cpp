@@ -0,0 +1,95 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "GatherSampleBudget.h"
+#include "Core/Assert.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Falcor
+{
+    namespace
+    {
+        const float kMinScale = 1e-6f;
+    }
+
+    GatherSampleBudget::GatherSampleBudget()
+        : GatherSampleBudget(Options())
+    {
+    }
+
+    GatherSampleBudget::GatherSampleBudget(const Options& options)
+    {
+        setOptions(options);
+    }
+
+    void GatherSampleBudget::setOptions(const Options& options)
+    {
+        mOptions = options;
+        mOptions.minSamples = std::max(mOptions.minSamples, 1u);
+        mOptions.maxSamples = std::max(mOptions.maxSamples, mOptions.minSamples);
+        mOptions.importanceFloor = std::max(mOptions.importanceFloor, 1e-3f);
+        mOptions.adaptationRate = std::clamp(mOptions.adaptationRate, 0.01f, 1.f);
+        reset();
+    }
+
+    void GatherSampleBudget::reset()
+    {
+        mScale = getTargetSamplesPerPixel() / mOptions.importanceFloor;
+        mRealizedSamplesPerPixel = 0.f;
+        mHasEstimate = false;
+    }
+
+    float GatherSampleBudget::getTargetSamplesPerPixel() const
+    {
+        return std::clamp(mOptions.samplesPerPixel, float(mOptions.minSamples), float(mOptions.maxSamples));
+    }
+
+    void GatherSampleBudget::update(double importanceSum, double sampleSum, uint64_t pixelCount)
+    {
+        if (pixelCount == 0 || importanceSum <= 0.0) return;
+
+        const double target = getTargetSamplesPerPixel();
+        mRealizedSamplesPerPixel = float(sampleSum / double(pixelCount));
+
+        double scale = mScale;
+        if (!mHasEstimate || sampleSum <= 0.0)
+        {
+            // Solve for the scale ignoring the clamping of the sample counts.
+            scale = target * double(pixelCount) / importanceSum;
+            mHasEstimate = true;
+        }
+        else
+        {
+            scale *= std::pow(target / double(mRealizedSamplesPerPixel), double(mOptions.adaptationRate));
+        }
+
+        // Beyond this scale every pixel is clamped to the max count, so growing it further only delays the recovery.
+        const double maxScale = double(mOptions.maxSamples) / double(mOptions.importanceFloor);
+        mScale = float(std::clamp(scale, double(kMinScale), maxScale));
+    }
+}
@@ -0,0 +1,93 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "GatherSampleBudget.slang"
+#include "Core/Macros.h"
+#include <cstdint>
+
+namespace Falcor
+{
+    /** Host-side controller for adaptive final gather sample counts.
+
+        Every pixel takes gatherSampleCount(importance, scale, ...) gather samples, see GatherSampleBudget.slang.
+        The controller chooses the global scale so that the average sample count per pixel
+        matches the budget. It is fed the image-wide sums of the pixel importances and of the
+        realized sample counts of a previous frame. The first update solves for the scale
+        assuming no clamping; later updates correct it multiplicatively by the ratio of the
+        budget to the realized average, which also accounts for pixels clamped to the min or max count.
+    */
+    class FALCOR_API GatherSampleBudget
+    {
+    public:
+        struct Options
+        {
+            float samplesPerPixel = 4.f;    ///< Average number of gather samples per pixel.
+            uint32_t minSamples = 1;        ///< Minimum number of gather samples per pixel.
+            uint32_t maxSamples = 16;       ///< Maximum number of gather samples per pixel.
+            float importanceFloor = 0.1f;   ///< Importance of pixels without variance. Must be positive.
+            float adaptationRate = 0.5f;    ///< Exponent in (0,1] applied to the correction of the scale. Lower values react slower but are more stable.
+        };
+
+        GatherSampleBudget();
+        GatherSampleBudget(const Options& options);
+
+        /** Set new options. Resets the controller.
+        */
+        void setOptions(const Options& options);
+        const Options& getOptions() const { return mOptions; }
+
+        /** Resets the scale so that a pixel of importance 'importanceFloor' takes the budgeted sample count.
+        */
+        void reset();
+
+        /** Updates the scale from the statistics of a previous frame.
+            \param[in] importanceSum Sum of the pixel importances.
+            \param[in] sampleSum Sum of the gather samples taken by the pixels.
+            \param[in] pixelCount Number of pixels.
+        */
+        void update(double importanceSum, double sampleSum, uint64_t pixelCount);
+
+        /** Returns the average number of samples per pixel that is targeted, i.e. the budget clamped to [minSamples, maxSamples].
+        */
+        float getTargetSamplesPerPixel() const;
+
+        /** Returns the global scale to pass to gatherSampleCount().
+        */
+        float getScale() const { return mScale; }
+
+        /** Returns the average number of samples per pixel realized in the last frame passed to update().
+        */
+        float getRealizedSamplesPerPixel() const { return mRealizedSamplesPerPixel; }
+
+    private:
+        Options mOptions;
+        float mScale = 0.f;
+        float mRealizedSamplesPerPixel = 0.f;
+        bool mHasEstimate = false;
+    };
+}
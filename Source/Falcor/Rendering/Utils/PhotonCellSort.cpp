@@ -0,0 +1,117 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "PhotonCellSort.h"
+#include "Core/Assert.h"
+#include "Core/API/RenderContext.h"
+#include "Utils/Math/Common.h"
+#include "Utils/Timing/Profiler.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        const char kShaderFile[] = "Rendering/Utils/PhotonCellSort.cs.slang";
+        const uint32_t kGroupSize = 256;
+
+        /** Returns a 2D dispatch size in thread groups covering at least elementCount threads.
+        */
+        uint3 getDispatchSize(uint32_t elementCount)
+        {
+            const uint32_t numGroups = div_round_up(elementCount, kGroupSize);
+            const uint32_t groupsX = std::max((uint32_t)sqrt(numGroups), 1u);
+            const uint32_t groupsY = div_round_up(numGroups, groupsX);
+            FALCOR_ASSERT(groupsX * groupsY * kGroupSize >= elementCount);
+            return { groupsX, groupsY, 1 };
+        }
+    }
+
+    PhotonCellSort::PhotonCellSort()
+    {
+        // Dummy bucket capacity just so we can get reflection data. The actual value is set in execute().
+        Program::DefineList defines = { {"GROUP_SIZE", std::to_string(kGroupSize)}, {"PHOTONS_PER_BUCKET", "1"} };
+        mpCountProgram = ComputeProgram::createFromFile(kShaderFile, "countPhotons", defines);
+        mpCountVars = ComputeVars::create(mpCountProgram.get());
+        mpScatterProgram = ComputeProgram::createFromFile(kShaderFile, "scatterPhotons", defines);
+        mpScatterVars = ComputeVars::create(mpScatterProgram.get());
+
+        mpComputeState = ComputeState::create();
+        mpPrefixSum = PrefixSum::create();
+    }
+
+    PhotonCellSort::SharedPtr PhotonCellSort::create()
+    {
+        return SharedPtr(new PhotonCellSort());
+    }
+
+    void PhotonCellSort::execute(RenderContext* pRenderContext, const Buffer::SharedPtr& pBuckets, uint32_t bucketCount, uint32_t photonsPerBucket, const Buffer::SharedPtr& pCellStart, const Buffer::SharedPtr& pSortedIndices)
+    {
+        FALCOR_PROFILE("PhotonCellSort::execute");
+
+        FALCOR_ASSERT(pRenderContext);
+        FALCOR_ASSERT(bucketCount > 0 && photonsPerBucket > 0);
+        FALCOR_ASSERT(pBuckets && pBuckets->getElementCount() >= bucketCount);
+        FALCOR_ASSERT(pCellStart && pCellStart->getSize() >= (bucketCount + 1) * sizeof(uint32_t));
+        FALCOR_ASSERT(pSortedIndices);
+
+        // Specialize the programs for the bucket layout.
+        // This will trigger a re-compile if a new capacity is encountered.
+        mpCountProgram->addDefine("PHOTONS_PER_BUCKET", std::to_string(photonsPerBucket));
+        mpScatterProgram->addDefine("PHOTONS_PER_BUCKET", std::to_string(photonsPerBucket));
+
+        // Pass 1: write the number of photons stored in each bucket, followed by a zero for the total.
+        {
+            const uint3 dispatchSize = getDispatchSize(bucketCount + 1);
+            mpCountVars["CB"]["gBucketCount"] = bucketCount;
+            mpCountVars["CB"]["gDispatchX"] = dispatchSize.x * kGroupSize;
+            mpCountVars["gBuckets"] = pBuckets;
+            mpCountVars["gCellStart"] = pCellStart;
+
+            mpComputeState->setProgram(mpCountProgram);
+            pRenderContext->dispatch(mpComputeState.get(), mpCountVars.get(), dispatchSize);
+        }
+
+        pRenderContext->uavBarrier(pCellStart.get());
+
+        // Pass 2: exclusive scan turns the counts into the start of each bucket's range.
+        mpPrefixSum->execute(pRenderContext, pCellStart, bucketCount + 1);
+
+        // Pass 3: scatter the photon indices of each bucket to its range.
+        {
+            const uint3 dispatchSize = getDispatchSize(bucketCount);
+            mpScatterVars["CB"]["gBucketCount"] = bucketCount;
+            mpScatterVars["CB"]["gDispatchX"] = dispatchSize.x * kGroupSize;
+            mpScatterVars["CB"]["gSortedCapacity"] = pSortedIndices->getElementCount();
+            mpScatterVars["gBuckets"] = pBuckets;
+            mpScatterVars["gCellStart"] = pCellStart;
+            mpScatterVars["gSortedIndices"] = pSortedIndices;
+
+            mpComputeState->setProgram(mpScatterProgram);
+            pRenderContext->dispatch(mpComputeState.get(), mpScatterVars.get(), dispatchSize);
+        }
+    }
+}
@@ -0,0 +1,86 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Core/API/Buffer.h"
+#include "Core/State/ComputeState.h"
+#include "Core/Program/ComputeProgram.h"
+#include "Core/Program/ProgramVars.h"
+#include "Utils/Algorithm/PrefixSum.h"
+#include <memory>
+
+namespace Falcor
+{
+    class RenderContext;
+
+    /** Sorts the photons of a bucketed photon hash grid into cell-coherent order.
+
+        Each bucket holds the photons of one grid cell as a list of indices into the photon data.
+        The sort is a counting sort over buckets: the number of photons stored in each bucket is
+        prefix summed into a cell start table, and the photon indices are scattered to
+        [cellStart[b], cellStart[b + 1]) in bucket order. The photons of a cell can then be
+        read as one contiguous range.
+    */
+    class FALCOR_API PhotonCellSort
+    {
+    public:
+        using SharedPtr = std::shared_ptr<PhotonCellSort>;
+        using SharedConstPtr = std::shared_ptr<const PhotonCellSort>;
+        virtual ~PhotonCellSort() = default;
+
+        /** Create a new photon cell sort object.
+            \return New object, or throws an exception if creation failed.
+        */
+        static SharedPtr create();
+
+        /** Sorts the photon indices of a hash grid by bucket.
+            \param[in] pRenderContext The render context.
+            \param[in] pBuckets Structured buffer of buckets with layout { uint size; int cell; uint2 pad; uint photonIdx[photonsPerBucket]; }.
+                       'size' is the number of photons inserted into the bucket and may exceed photonsPerBucket.
+            \param[in] bucketCount Number of buckets.
+            \param[in] photonsPerBucket Number of photon indices a bucket can hold.
+            \param[out] pCellStart Raw buffer of at least bucketCount + 1 uints. Receives the first sorted index of each bucket.
+                        The last element holds the total number of photons.
+            \param[out] pSortedIndices Structured uint buffer receiving the photon indices in bucket order. Indices past its end are dropped.
+        */
+        void execute(RenderContext* pRenderContext, const Buffer::SharedPtr& pBuckets, uint32_t bucketCount, uint32_t photonsPerBucket, const Buffer::SharedPtr& pCellStart, const Buffer::SharedPtr& pSortedIndices);
+
+    protected:
+        PhotonCellSort();
+
+        ComputeState::SharedPtr     mpComputeState;
+
+        ComputeProgram::SharedPtr   mpCountProgram;
+        ComputeVars::SharedPtr      mpCountVars;
+
+        ComputeProgram::SharedPtr   mpScatterProgram;
+        ComputeVars::SharedPtr      mpScatterVars;
+
+        PrefixSum::SharedPtr        mpPrefixSum;
+    };
+}
@@ -0,0 +1,166 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "PhotonEmission.h"
+#include "Core/Assert.h"
+#include "Core/API/RenderContext.h"
+#include "Rendering/Lights/EnvMapSampler.h"
+#include "Scene/Lights/Light.h"
+#include "Utils/Color/ColorHelpers.slang"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace Falcor
+{
+    PhotonEmissionCounts splitPhotonsByPower(const PhotonEmissionPower& power, uint32_t photonCount)
+    {
+        PhotonEmissionCounts counts;
+        const double total = (double)power.analytic + power.emissive + power.env;
+        if (!(total > 0.0)) return counts;
+
+        uint32_t* count[3] = { &counts.analytic, &counts.emissive, &counts.env };
+        const float groupPower[3] = { power.analytic, power.emissive, power.env };
+
+        // Round down and give the remainder to the most powerful group.
+        uint32_t assigned = 0;
+        uint32_t largest = 0;
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            *count[i] = groupPower[i] > 0.f ? (uint32_t)std::floor(photonCount * (groupPower[i] / total)) : 0;
+            assigned += *count[i];
+            if (groupPower[i] > groupPower[largest]) largest = i;
+        }
+        FALCOR_ASSERT(assigned <= photonCount);
+        *count[largest] += photonCount - assigned;
+
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            if (groupPower[i] > 0.f && *count[i] == 0) *count[i] = 1;
+        }
+        return counts;
+    }
+
+    std::vector<uint32_t> splitPhotonsByLightPower(const std::vector<float>& power, uint32_t photonCount, uint32_t minPhotonsPerLight, uint32_t maxPhotonsPerLight)
+    {
+        std::vector<uint32_t> counts(power.size(), 0);
+        std::vector<size_t> lights;
+        float minPower = std::numeric_limits<float>::max();
+        for (size_t i = 0; i < power.size(); i++)
+        {
+            if (!(power[i] > 0.f)) continue;
+            lights.push_back(i);
+            minPower = std::min(minPower, power[i]);
+        }
+        if (lights.empty()) return counts;
+
+        const double maxCount = maxPhotonsPerLight > 0 ? (double)maxPhotonsPerLight : (double)std::numeric_limits<uint32_t>::max();
+        const double minCount = std::min((double)minPhotonsPerLight, maxCount);
+        auto getCount = [&](size_t i, double scale) { return std::clamp(scale * power[i], minCount, maxCount); };
+        auto getTotal = [&](double scale)
+        {
+            double total = 0.0;
+            for (size_t i : lights) total += getCount(i, scale);
+            return total;
+        };
+
+        // The clamped total is continuous and non-decreasing in the photons per unit power.
+        // Bisect for the scale that spends the budget. At the upper bound every light gets at least the whole budget before clamping.
+        double lo = 0.0;
+        double hi = (double)photonCount / minPower;
+        for (uint32_t iteration = 0; iteration < 64; iteration++)
+        {
+            double mid = 0.5 * (lo + hi);
+            if (getTotal(mid) < photonCount) lo = mid;
+            else hi = mid;
+        }
+
+        // Round down and hand out the remainder by the largest fractional part.
+        std::vector<double> fraction(power.size(), 0.0);
+        int64_t remainder = photonCount;
+        for (size_t i : lights)
+        {
+            double count = getCount(i, hi);
+            counts[i] = (uint32_t)std::floor(count);
+            fraction[i] = count - counts[i];
+            remainder -= counts[i];
+        }
+        std::stable_sort(lights.begin(), lights.end(), [&](size_t a, size_t b) { return fraction[a] > fraction[b]; });
+        for (size_t i : lights)
+        {
+            if (remainder <= 0) break;
+            if (counts[i] >= maxCount) continue;
+            counts[i]++;
+            remainder--;
+        }
+        return counts;
+    }
+
+    float getAnalyticLightPhotonPower(const Light& light, float sceneRadius)
+    {
+        if (!light.isActive()) return 0.f;
+
+        const LightData& data = light.getData();
+        float intensity = luminance(data.intensity);
+        switch ((LightType)data.type)
+        {
+        case LightType::Point:
+            return photonPointLightPower(intensity, data.openingAngle);
+        case LightType::Directional:
+            return photonDirectionalLightPower(intensity, sceneRadius);
+        case LightType::Distant:
+            return photonDistantLightPower(intensity, data.cosSubtendedAngle, sceneRadius);
+        case LightType::Rect:
+        case LightType::Disc:
+        case LightType::Sphere:
+            return photonAreaLightPower(intensity, data.surfaceArea);
+        default:
+            FALCOR_UNREACHABLE();
+            return 0.f;
+        }
+    }
+
+    float getEnvMapPhotonPower(RenderContext* pRenderContext, const EnvMapSampler& envMapSampler, float sceneRadius)
+    {
+        FALCOR_ASSERT(pRenderContext);
+        const auto& pImportanceMap = envMapSampler.getImportanceMap();
+        FALCOR_ASSERT(pImportanceMap && pImportanceMap->getFormat() == ResourceFormat::R32Float);
+
+        // The 1x1 mip holds the average luminance of the env map texture, without intensity and tint.
+        uint32_t subresource = pImportanceMap->getSubresourceIndex(0, pImportanceMap->getMipCount() - 1);
+        std::vector<uint8_t> data = pRenderContext->readTextureSubresource(pImportanceMap.get(), subresource);
+        FALCOR_ASSERT(data.size() >= sizeof(float));
+        float averageLuminance = 0.f;
+        std::memcpy(&averageLuminance, data.data(), sizeof(float));
+
+        const auto& pEnvMap = envMapSampler.getEnvMap();
+        averageLuminance *= pEnvMap->getIntensity() * luminance(pEnvMap->getTint());
+        return photonEnvPower(averageLuminance, sceneRadius);
+    }
+}
@@ -0,0 +1,98 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "PhotonEmission.slang"
+#include "Core/Macros.h"
+#include <cstdint>
+#include <vector>
+
+namespace Falcor
+{
+    class RenderContext;
+    class EnvMapSampler;
+    class Light;
+
+    /** Luminous power of the light groups photons are started from.
+    */
+    struct PhotonEmissionPower
+    {
+        float analytic = 0.f;   ///< Analytic lights.
+        float emissive = 0.f;   ///< Emissive triangles.
+        float env = 0.f;        ///< Environment map, through the scene-bounding disk.
+
+        float total() const { return analytic + emissive + env; }
+    };
+
+    /** Number of photons started from each light group per iteration.
+    */
+    struct PhotonEmissionCounts
+    {
+        uint32_t analytic = 0;
+        uint32_t emissive = 0;
+        uint32_t env = 0;
+
+        uint32_t total() const { return analytic + emissive + env; }
+    };
+
+    /** Splits a photon budget between the light groups proportional to their power.
+        The counts add up to the budget, except that every group with power gets at least one photon.
+        No photons are assigned if no group has power.
+        \param[in] power Power of the light groups.
+        \param[in] photonCount Photon budget.
+        \return Number of photons per group.
+    */
+    FALCOR_API PhotonEmissionCounts splitPhotonsByPower(const PhotonEmissionPower& power, uint32_t photonCount);
+
+    /** Splits a photon budget between the lights of a group proportional to their power.
+        The counts are clamped to [minPhotonsPerLight, maxPhotonsPerLight] and the budget left over by the clamped lights
+        is redistributed to the others, so the counts add up to the budget unless the limits make that impossible.
+        Lights without power get no photons.
+        \param[in] power Power of each light.
+        \param[in] photonCount Photon budget of the group.
+        \param[in] minPhotonsPerLight Minimum number of photons of a light with power.
+        \param[in] maxPhotonsPerLight Maximum number of photons of a light, or zero for no cap. Takes precedence over the minimum.
+        \return Number of photons per light.
+    */
+    FALCOR_API std::vector<uint32_t> splitPhotonsByLightPower(const std::vector<float>& power, uint32_t photonCount, uint32_t minPhotonsPerLight, uint32_t maxPhotonsPerLight);
+
+    /** Returns the power an analytic light emits into the scene. Lights at infinity (directional, distant) emit through the scene-bounding disk.
+        \param[in] light Analytic light.
+        \param[in] sceneRadius Radius of the scene-bounding sphere.
+        \return Luminous power, or zero if the light is inactive.
+    */
+    FALCOR_API float getAnalyticLightPhotonPower(const Light& light, float sceneRadius);
+
+    /** Returns the power an environment map emits into the scene, see photonEnvPower().
+        The average luminance is read back from the last mip of the importance map, which flushes the GPU.
+        \param[in] pRenderContext Render context.
+        \param[in] envMapSampler Sampler of the environment map.
+        \param[in] sceneRadius Radius of the scene-bounding sphere.
+        \return Luminous power.
+    */
+    FALCOR_API float getEnvMapPhotonPower(RenderContext* pRenderContext, const EnvMapSampler& envMapSampler, float sceneRadius);
+}
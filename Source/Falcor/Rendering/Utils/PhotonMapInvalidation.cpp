@@ -0,0 +1,252 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "PhotonMapInvalidation.h"
+#include "PhotonEmission.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Changes that affect the whole image and cannot be localized.
+        const Scene::UpdateFlags kRestartFlags = Scene::UpdateFlags::GeometryChanged | Scene::UpdateFlags::MeshesChanged | Scene::UpdateFlags::MaterialsChanged
+            | Scene::UpdateFlags::RenderSettingsChanged | Scene::UpdateFlags::EnvMapChanged | Scene::UpdateFlags::CurvesMoved | Scene::UpdateFlags::CustomPrimitivesMoved
+            | Scene::UpdateFlags::DisplacementChanged | Scene::UpdateFlags::SDFGridConfigChanged | Scene::UpdateFlags::SDFGeometryChanged;
+
+        // Changes after which the photon budget has to be split between the lights again.
+        const Scene::UpdateFlags kLightSamplingFlags = Scene::UpdateFlags::GeometryChanged | Scene::UpdateFlags::MaterialsChanged | Scene::UpdateFlags::EnvMapChanged
+            | Scene::UpdateFlags::EnvMapPropertiesChanged | Scene::UpdateFlags::LightCountChanged;
+
+        const Scene::UpdateFlags kAnalyticLightFlags = Scene::UpdateFlags::LightsMoved | Scene::UpdateFlags::LightIntensityChanged
+            | Scene::UpdateFlags::LightPropertiesChanged | Scene::UpdateFlags::LightCountChanged;
+
+        const uint32_t kAllLightGroups = (1u << (uint32_t)PhotonLightGroup::Count) - 1;
+
+        uint32_t lightGroupBit(PhotonLightGroup group)
+        {
+            return 1u << (uint32_t)group;
+        }
+    }
+
+    void PhotonMapInvalidation::reset(const PhotonSourcePower& power, std::vector<AABB> instanceBounds, const AABB& sceneBounds)
+    {
+        mPower = power;
+        mInstanceBounds = std::move(instanceBounds);
+        mSceneArea = sceneBounds.valid() ? sceneBounds.area() : 0.f;
+    }
+
+    PhotonMapInvalidation::Decision PhotonMapInvalidation::update(const PhotonSceneUpdate& update)
+    {
+        Decision decision;
+        bool restart = is_set(update.flags, kRestartFlags);
+        decision.rebuildLightSampling = is_set(update.flags, kLightSamplingFlags);
+
+        // Analytic lights that moved or changed their power restart the analytic group. Lights without power emit no photons.
+        std::vector<float> analyticPower = update.analyticPower.empty() ? mPower.analytic : update.analyticPower;
+        if (analyticPower.size() != mPower.analytic.size())
+        {
+            // Lights were added or removed.
+            restart = true;
+            decision.rebuildLightSampling = true;
+        }
+        else
+        {
+            bool changed = false;
+            for (uint32_t lightID : update.movedAnalyticLights)
+            {
+                if (lightID >= analyticPower.size()) restart = true;
+                else if (analyticPower[lightID] > 0.f || mPower.analytic[lightID] > 0.f) changed = true;
+            }
+            for (size_t i = 0; i < analyticPower.size(); i++)
+            {
+                if (analyticPower[i] != mPower.analytic[i]) changed = true;
+            }
+            if (changed) decision.resetGroups |= lightGroupBit(PhotonLightGroup::Analytic);
+        }
+        mPower.analytic = std::move(analyticPower);
+
+        for (uint32_t lightID : update.movedMeshLights)
+        {
+            if (lightID >= mPower.meshLights.size()) restart = true;
+            else if (mPower.meshLights[lightID] > 0.f) decision.resetGroups |= lightGroupBit(PhotonLightGroup::Emissive);
+        }
+
+        if (is_set(update.flags, Scene::UpdateFlags::EnvMapPropertiesChanged)) decision.resetGroups |= lightGroupBit(PhotonLightGroup::EnvMap);
+
+        // The emissive output of the vbuffer pass holds the visible emission and, with final gathering, the direct light of all sources.
+        if (decision.resetGroups != 0)
+        {
+            decision.resetGroups |= lightGroupBit(PhotonLightGroup::Direct);
+            decision.rebuildLightSampling = true;
+        }
+
+        // Moved geometry restarts the region it swept over, grown by the margin for the shadows and indirect light it casts nearby.
+        float sweptFraction = 0.f;
+        for (const auto& [instanceID, bounds] : update.movedInstances)
+        {
+            if (instanceID >= mInstanceBounds.size() || mSceneArea <= 0.f)
+            {
+                restart = true;
+                continue;
+            }
+            AABB swept = mInstanceBounds[instanceID];
+            swept |= bounds;
+            mInstanceBounds[instanceID] = bounds;
+            if (!swept.valid()) continue;
+
+            sweptFraction += std::min(swept.area() / mSceneArea, 1.f);
+            const float3 extent = swept.extent();
+            const float margin = mResetMargin * std::max(extent.x, std::max(extent.y, extent.z));
+            decision.resetBounds.emplace_back(swept.minPoint - float3(margin), swept.maxPoint + float3(margin));
+        }
+
+        if (restart || sweptFraction >= mRestartThreshold || decision.resetGroups == kAllLightGroups)
+        {
+            decision.action = Action::Restart;
+            decision.resetGroups = kAllLightGroups;
+            decision.resetBounds.clear();
+        }
+        else if (decision.resetGroups != 0 || !decision.resetBounds.empty())
+        {
+            decision.action = Action::Invalidate;
+        }
+        return decision;
+    }
+
+    PhotonSceneUpdate PhotonMapInvalidation::getSceneUpdate(const Scene& scene)
+    {
+        PhotonSceneUpdate update;
+        update.flags = scene.getUpdates();
+
+        if (is_set(update.flags, kAnalyticLightFlags))
+        {
+            const float sceneRadius = scene.getSceneBounds().radius();
+            update.analyticPower.resize(scene.getLightCount());
+            for (uint32_t i = 0; i < scene.getLightCount(); i++)
+            {
+                const Light& light = *scene.getLight(i);
+                update.analyticPower[i] = getAnalyticLightPhotonPower(light, sceneRadius);
+                if (is_set(light.getChanges(), Light::Changes::Position | Light::Changes::Direction | Light::Changes::SurfaceArea)) update.movedAnalyticLights.push_back(i);
+            }
+        }
+
+        if (is_set(update.flags, Scene::UpdateFlags::LightCollectionChanged))
+        {
+            const auto& lightsUpdateInfo = scene.getLightCollectionUpdates().lightsUpdateInfo;
+            for (uint32_t i = 0; i < (uint32_t)lightsUpdateInfo.size(); i++)
+            {
+                if (is_set(lightsUpdateInfo[i], LightCollection::UpdateFlags::MatrixChanged)) update.movedMeshLights.push_back(i);
+            }
+        }
+
+        if (is_set(update.flags, Scene::UpdateFlags::GeometryMoved))
+        {
+            const AnimationController* pAnimationController = scene.getAnimationController();
+            for (uint32_t i = 0; i < scene.getGeometryInstanceCount(); i++)
+            {
+                if (pAnimationController->isMatrixChanged(NodeID{ scene.getGeometryInstance(i).globalMatrixID })) update.movedInstances.emplace_back(i, getInstanceBounds(scene, i));
+            }
+        }
+
+        return update;
+    }
+
+    std::vector<AABB> PhotonMapInvalidation::getInstanceBounds(const Scene& scene)
+    {
+        std::vector<AABB> bounds(scene.getGeometryInstanceCount());
+        for (uint32_t i = 0; i < (uint32_t)bounds.size(); i++) bounds[i] = getInstanceBounds(scene, i);
+        return bounds;
+    }
+
+    AABB PhotonMapInvalidation::getInstanceBounds(const Scene& scene, uint32_t instanceID)
+    {
+        const GeometryInstanceData& instance = scene.getGeometryInstance(instanceID);
+        const rmcv::mat4& transform = scene.getAnimationController()->getGlobalMatrices()[instance.globalMatrixID];
+        switch (instance.getType())
+        {
+        case GeometryType::TriangleMesh:
+        case GeometryType::DisplacedTriangleMesh:
+            return scene.getMeshBounds(instance.geometryID).transform(transform);
+        case GeometryType::Curve:
+            return scene.getCurveBounds(instance.geometryID).transform(transform);
+        default:
+            return AABB();
+        }
+    }
+
+    std::vector<uint4> PhotonMapInvalidation::getResetRegions(const std::vector<AABB>& bounds, const rmcv::mat4& viewProj, uint2 frameDim)
+    {
+        std::vector<uint4> regions;
+        const float2 dim = float2(frameDim);
+        for (const AABB& box : bounds)
+        {
+            if (!box.valid()) continue;
+
+            // Bounds of the projected corners in normalized device coordinates.
+            float2 ndcMin = float2(std::numeric_limits<float>::infinity());
+            float2 ndcMax = float2(-std::numeric_limits<float>::infinity());
+            bool behindCamera = false;
+            for (uint32_t i = 0; i < 8; i++)
+            {
+                const float4 corner = float4((i & 1) ? box.maxPoint.x : box.minPoint.x, (i & 2) ? box.maxPoint.y : box.minPoint.y, (i & 4) ? box.maxPoint.z : box.minPoint.z, 1.f);
+                const float4 clip = viewProj * corner;
+                if (clip.w <= 0.f)
+                {
+                    behindCamera = true;
+                    break;
+                }
+                const float2 ndc = float2(clip.x, clip.y) / clip.w;
+                ndcMin = glm::min(ndcMin, ndc);
+                ndcMax = glm::max(ndcMax, ndc);
+            }
+
+            uint4 rect = uint4(0, 0, frameDim.x, frameDim.y);
+            if (!behindCamera)
+            {
+                // Pixel rows go down, the y axis of the device coordinates up.
+                const float2 pixelMin = glm::clamp(glm::floor(float2(ndcMin.x * 0.5f + 0.5f, 0.5f - ndcMax.y * 0.5f) * dim), float2(0.f), dim);
+                const float2 pixelMax = glm::clamp(glm::ceil(float2(ndcMax.x * 0.5f + 0.5f, 0.5f - ndcMin.y * 0.5f) * dim), float2(0.f), dim);
+                rect = uint4(uint2(pixelMin), uint2(pixelMax));
+                if (rect.x >= rect.z || rect.y >= rect.w) continue;     // Outside the frame.
+            }
+
+            if (regions.size() < kMaxPhotonResetRegions)
+            {
+                regions.push_back(rect);
+            }
+            else
+            {
+                uint4& last = regions.back();
+                last = uint4(glm::min(uint2(last.x, last.y), uint2(rect.x, rect.y)), glm::max(uint2(last.z, last.w), uint2(rect.z, rect.w)));
+            }
+        }
+        return regions;
+    }
+}
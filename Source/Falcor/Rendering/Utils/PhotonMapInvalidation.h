@@ -0,0 +1,146 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "PhotonLightGroups.slang"
+#include "Core/Macros.h"
+#include "Scene/Scene.h"
+#include "Utils/Math/AABB.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Falcor
+{
+    /** Photon power of the light sources, in the units of PhotonEmissionPower.
+    */
+    struct PhotonSourcePower
+    {
+        std::vector<float> analytic;    ///< Per analytic light, indexed like the scene lights. Inactive lights have no power.
+        std::vector<float> meshLights;  ///< Per mesh light, indexed like LightCollection::getMeshLights().
+        float env = 0.f;                ///< Environment map.
+    };
+
+    /** Changes of one frame as seen by a photon mapper.
+        Built from Scene::getUpdates(), the changes of the analytic lights and the light collection update list, see PhotonMapInvalidation::getSceneUpdate().
+    */
+    struct PhotonSceneUpdate
+    {
+        Scene::UpdateFlags flags = Scene::UpdateFlags::None;
+        std::vector<float> analyticPower;                           ///< Current power per analytic light. Empty if no analytic light changed.
+        std::vector<uint32_t> movedAnalyticLights;                  ///< Analytic lights that moved, turned or changed their size.
+        std::vector<uint32_t> movedMeshLights;                      ///< Mesh lights whose instance transform changed.
+        std::vector<std::pair<uint32_t, AABB>> movedInstances;      ///< Geometry instances that moved, with their new world-space bounds.
+    };
+
+    /** Decides which parts of a photon mapper's accumulated image a scene change invalidates.
+
+        The photons are shot again every iteration, so only the accumulated image goes stale. The photon
+        mappers accumulate one image per light group (see PhotonLightGroup). A light source that moved or
+        changed its power restarts the accumulation of its group, the other groups keep their iterations.
+        Moved geometry restarts all groups in the region it swept over, grown by a margin for the shadows
+        and indirect light it casts nearby. Changes that cannot be localized (materials, added geometry,
+        render settings) and moved geometry that sweeps over more than the restart threshold of the scene
+        surface restart the whole accumulation.
+
+        The tracker remembers the light powers and instance bounds of the accumulated image. They are
+        set with reset() whenever the photon budget is split between the lights.
+    */
+    class FALCOR_API PhotonMapInvalidation
+    {
+    public:
+        enum class Action
+        {
+            None,       ///< Nothing the photon mapper depends on changed.
+            Invalidate, ///< Restart the light groups in resetGroups everywhere and all groups in resetBounds.
+            Restart,    ///< Restart the accumulation.
+        };
+
+        struct Decision
+        {
+            Action action = Action::None;
+            uint32_t resetGroups = 0;               ///< Bit mask of the light groups that restart, bit i is PhotonLightGroup i.
+            std::vector<AABB> resetBounds;          ///< World-space regions in which all light groups restart.
+            bool rebuildLightSampling = false;      ///< The light powers changed, so the photon budget has to be split again.
+        };
+
+        /** Sets the light powers and instance bounds the accumulated image is built from.
+            \param[in] power Power of the light sources.
+            \param[in] instanceBounds World-space bounds of the geometry instances, indexed like the scene instances.
+            \param[in] sceneBounds World-space scene bounds.
+        */
+        void reset(const PhotonSourcePower& power, std::vector<AABB> instanceBounds, const AABB& sceneBounds);
+
+        /** Evaluates the changes of one frame and updates the tracked state to the new one.
+            \param[in] update Changes since the last call.
+            \return How the photon mapper should treat its accumulated image.
+        */
+        Decision update(const PhotonSceneUpdate& update);
+
+        /** Sets the fraction of the scene surface that moved geometry has to sweep over to restart the accumulation.
+        */
+        void setRestartThreshold(float threshold) { mRestartThreshold = threshold; }
+        float getRestartThreshold() const { return mRestartThreshold; }
+
+        /** Sets the margin the reset regions are grown by on every side, relative to the largest extent of the swept bounds.
+        */
+        void setResetMargin(float margin) { mResetMargin = margin; }
+        float getResetMargin() const { return mResetMargin; }
+
+        /** Collects the changes of the last Scene::update() call.
+            Analytic light powers are only computed if a light changed.
+            \param[in] scene The scene.
+            \return The changes of the frame.
+        */
+        static PhotonSceneUpdate getSceneUpdate(const Scene& scene);
+
+        /** Returns the world-space bounds of all geometry instances of a scene.
+            Instances other than triangle meshes and curves get an invalid box and are ignored.
+        */
+        static std::vector<AABB> getInstanceBounds(const Scene& scene);
+
+        /** Returns the world-space bounds of one geometry instance.
+        */
+        static AABB getInstanceBounds(const Scene& scene, uint32_t instanceID);
+
+        /** Projects world-space reset regions to pixel rectangles.
+            A region that reaches behind the camera covers the whole frame.
+            \param[in] bounds World-space regions.
+            \param[in] viewProj View-projection matrix of the camera.
+            \param[in] frameDim Frame size in pixels.
+            \return At most kMaxPhotonResetRegions rectangles (min.xy, max.xy) with exclusive max corner. Regions beyond the limit are merged into the last rectangle.
+        */
+        static std::vector<uint4> getResetRegions(const std::vector<AABB>& bounds, const rmcv::mat4& viewProj, uint2 frameDim);
+
+    private:
+        PhotonSourcePower mPower;
+        std::vector<AABB> mInstanceBounds;
+        float mSceneArea = 0.f;
+        float mRestartThreshold = 0.5f;
+        float mResetMargin = 0.5f;
+    };
+}
@@ -0,0 +1,244 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "PhotonMapperStats.h"
+#include "Core/API/RenderContext.h"
+#include "Utils/Logger.h"
+#include "Utils/Scripting/ScriptBindings.h"
+#include <sstream>
+#include <iomanip>
+
+namespace Falcor
+{
+    PhotonMapperStats::SharedPtr PhotonMapperStats::create()
+    {
+        return SharedPtr(new PhotonMapperStats());
+    }
+
+    void PhotonMapperStats::beginFrame(RenderContext* pRenderContext)
+    {
+        // Prepare state.
+        FALCOR_ASSERT(!mRunning);
+        mRunning = true;
+        mWaitingForData = false;
+
+        // Mark previously stored data as invalid. The config may have changed, so this is the safe bet.
+        mStats = Stats();
+        mStatsValid = false;
+        for (uint32_t i = 0; i < kStageCount; i++) mStageTimed[i] = false;
+
+        if (mEnabled)
+        {
+            if (!mpCounters)
+            {
+                mpCounters = Buffer::createStructured(sizeof(uint32_t), kCounterCount, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr, false);
+                mpCounters->setName("PhotonMapperStats::Counters");
+                mpCountersReadback = Buffer::create(kCounterCount * sizeof(uint32_t), ResourceBindFlags::None, Buffer::CpuAccess::Read);
+            }
+            pRenderContext->clearUAV(mpCounters->getUAV().get(), uint4(0));
+            mCpuStart = CpuTimer::getCurrentTimePoint();
+        }
+    }
+
+    void PhotonMapperStats::endFrame(RenderContext* pRenderContext, float causticRadius, float globalRadius)
+    {
+        FALCOR_ASSERT(mRunning);
+        mRunning = false;
+
+        if (mEnabled)
+        {
+            // Create fence first time we need it.
+            if (!mpFence) mpFence = GpuFence::create();
+
+            mStats.cpuTime = CpuTimer::calcDuration(mCpuStart, CpuTimer::getCurrentTimePoint());
+            mStats.causticRadius = causticRadius;
+            mStats.globalRadius = globalRadius;
+
+            pRenderContext->copyResource(mpCountersReadback.get(), mpCounters.get());
+            for (uint32_t i = 0; i < kStageCount; i++)
+            {
+                if (mStageTimed[i]) mpStageTimers[i]->resolve();
+            }
+
+            // Submit command list and insert signal.
+            pRenderContext->flush(false);
+            mpFence->gpuSignal(pRenderContext->getLowLevelData()->getCommandQueue());
+
+            mWaitingForData = true;
+        }
+    }
+
+    void PhotonMapperStats::beginStage(Stage stage)
+    {
+        FALCOR_ASSERT(mRunning);
+        if (!mEnabled) return;
+
+        const uint32_t i = (uint32_t)stage;
+        if (!mpStageTimers[i]) mpStageTimers[i] = GpuTimer::create();
+        mpStageTimers[i]->begin();
+        mStageTimed[i] = true;
+    }
+
+    void PhotonMapperStats::endStage(Stage stage)
+    {
+        FALCOR_ASSERT(mRunning);
+        if (!mEnabled) return;
+
+        const uint32_t i = (uint32_t)stage;
+        FALCOR_ASSERT(mStageTimed[i]);
+        mpStageTimers[i]->end();
+    }
+
+    void PhotonMapperStats::prepareProgram(const Program::SharedPtr& pProgram, const ShaderVar& var)
+    {
+        FALCOR_ASSERT(mRunning);
+
+        if (mEnabled)
+        {
+            pProgram->addDefine("_PHOTON_STATS_ENABLED");
+            var["gPhotonStats"] = mpCounters;
+        }
+        else
+        {
+            pProgram->removeDefine("_PHOTON_STATS_ENABLED");
+        }
+    }
+
+    void PhotonMapperStats::renderUI(Gui::Widgets& widget)
+    {
+        // Configuration.
+        widget.checkbox("Photon stats", mEnabled);
+        widget.tooltip("Collects photon counts and stage timings of each iteration.\nNote that this option slows down the performance.");
+
+        // Fetch data and show stats if available.
+        copyStatsToCPU();
+        if (mStatsValid)
+        {
+            widget.text("Stats:");
+            widget.tooltip("Culled photons were rejected by the global photon rejection or the photon culling.\n"
+                "Dropped photons did not fit into the photon buffers or hash buckets.\n"
+                "The average path depth is the number of surface hits per emitted photon.");
+
+            std::ostringstream oss;
+            oss << "Emitted photons: " << mStats.photonsEmitted << "\n"
+                << "Caustic photons: " << mStats.causticPhotons << "\n"
+                << "Global photons: " << mStats.globalPhotons << "\n"
+                << "Culled photons: " << mStats.culledPhotons << "\n"
+                << "Dropped photons: " << mStats.droppedPhotons << "\n"
+                << "Path depth (avg): " << std::fixed << std::setprecision(3) << mStats.avgPathDepth << "\n"
+                << "Caustic radius: " << std::setprecision(5) << mStats.causticRadius << "\n"
+                << "Global radius: " << std::setprecision(5) << mStats.globalRadius << "\n"
+                << "Generate (GPU): " << std::setprecision(3) << mStats.generateTime << " ms\n"
+                << "Build (GPU): " << std::setprecision(3) << mStats.buildTime << " ms\n"
+                << "Collect (GPU): " << std::setprecision(3) << mStats.collectTime << " ms\n"
+                << "Pass (CPU): " << std::setprecision(3) << mStats.cpuTime << " ms\n";
+
+            widget.text(oss.str());
+        }
+    }
+
+    bool PhotonMapperStats::getStats(PhotonMapperStats::Stats& stats)
+    {
+        copyStatsToCPU();
+        if (!mStatsValid)
+        {
+            logWarning("PhotonMapperStats::getStats() - Stats are not valid. Ignoring.");
+            return false;
+        }
+        stats = mStats;
+        return true;
+    }
+
+    void PhotonMapperStats::copyStatsToCPU()
+    {
+        FALCOR_ASSERT(!mRunning);
+        if (mWaitingForData)
+        {
+            // Wait for signal.
+            mpFence->syncCpu();
+            mWaitingForData = false;
+
+            if (mEnabled)
+            {
+                const uint32_t* pCounters = static_cast<const uint32_t*>(mpCountersReadback->map(Buffer::MapType::Read));
+                FALCOR_ASSERT(pCounters);
+                mStats.setCounters(pCounters);
+                mpCountersReadback->unmap();
+
+                auto stageTime = [this](Stage stage) { return mStageTimed[(uint32_t)stage] ? mpStageTimers[(uint32_t)stage]->getElapsedTime() : 0.0; };
+                mStats.generateTime = stageTime(Stage::Generate);
+                mStats.buildTime = stageTime(Stage::Build);
+                mStats.collectTime = stageTime(Stage::Collect);
+
+                mStatsValid = true;
+            }
+        }
+    }
+
+    void PhotonMapperStats::Stats::setCounters(const uint32_t counters[(uint32_t)PhotonStatsCounter::Count])
+    {
+        photonsEmitted = counters[(uint32_t)PhotonStatsCounter::Emitted];
+        causticPhotons = counters[(uint32_t)PhotonStatsCounter::StoredCaustic];
+        globalPhotons = counters[(uint32_t)PhotonStatsCounter::StoredGlobal];
+        culledPhotons = counters[(uint32_t)PhotonStatsCounter::Culled];
+        droppedPhotons = counters[(uint32_t)PhotonStatsCounter::Dropped];
+        pathVertices = counters[(uint32_t)PhotonStatsCounter::PathVertices];
+        avgPathDepth = photonsEmitted > 0 ? (float)pathVertices / photonsEmitted : 0.f;
+    }
+
+    pybind11::dict PhotonMapperStats::Stats::toPython() const
+    {
+        pybind11::dict d;
+
+        d["photonsEmitted"] = photonsEmitted;
+        d["causticPhotons"] = causticPhotons;
+        d["globalPhotons"] = globalPhotons;
+        d["culledPhotons"] = culledPhotons;
+        d["droppedPhotons"] = droppedPhotons;
+        d["pathVertices"] = pathVertices;
+        d["avgPathDepth"] = avgPathDepth;
+        d["causticRadius"] = causticRadius;
+        d["globalRadius"] = globalRadius;
+        d["generateTime"] = generateTime;
+        d["buildTime"] = buildTime;
+        d["collectTime"] = collectTime;
+        d["cpuTime"] = cpuTime;
+
+        return d;
+    }
+
+    FALCOR_SCRIPT_BINDING(PhotonMapperStats)
+    {
+        pybind11::class_<PhotonMapperStats, PhotonMapperStats::SharedPtr> photonMapperStats(m, "PhotonMapperStats");
+        photonMapperStats.def_property("enabled", &PhotonMapperStats::isEnabled, &PhotonMapperStats::setEnabled);
+        photonMapperStats.def_property_readonly("stats", [](PhotonMapperStats* pStats) {
+            PhotonMapperStats::Stats stats;
+            pStats->getStats(stats);
+            return stats.toPython();
+        });
+    }
+}
@@ -0,0 +1,151 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "PhotonMapperStatsShared.slang"
+#include "Core/Macros.h"
+#include "Core/API/Buffer.h"
+#include "Core/API/GpuFence.h"
+#include "Core/API/GpuTimer.h"
+#include "Core/Program/Program.h"
+#include "Core/Program/ShaderVar.h"
+#include "Utils/Timing/CpuTimer.h"
+#include "Utils/UI/Gui.h"
+#include <pybind11/pytypes.h>
+#include <memory>
+
+namespace Falcor
+{
+    class RenderContext;
+
+    /** Helper class for collecting per-iteration stats in the photon mappers.
+
+        Photon counts are logged on the GPU by the generation shader (see PhotonMapperStats.slang).
+        The stages of an iteration are timed on the GPU, the whole pass on the CPU.
+        The stats are available in getStats() after readback to the CPU, and in Python as the "stats" dict.
+    */
+    class FALCOR_API PhotonMapperStats
+    {
+    public:
+        /** Timed stages of a photon mapper iteration.
+        */
+        enum class Stage
+        {
+            Generate,   ///< Tracing and storing the photons.
+            Build,      ///< Building the photon map, e.g. sorting the photons or building the acceleration structure.
+            Collect,    ///< Gathering the photons at the camera hits.
+
+            Count
+        };
+
+        struct Stats
+        {
+            uint32_t photonsEmitted = 0;
+            uint32_t causticPhotons = 0;
+            uint32_t globalPhotons = 0;
+            uint32_t culledPhotons = 0;
+            uint32_t droppedPhotons = 0;
+            uint32_t pathVertices = 0;
+            float    avgPathDepth = 0.f;    ///< Surface hits per emitted photon.
+            float    causticRadius = 0.f;
+            float    globalRadius = 0.f;
+            double   generateTime = 0.0;    ///< GPU time of the generate stage in ms.
+            double   buildTime = 0.0;       ///< GPU time of the build stage in ms.
+            double   collectTime = 0.0;     ///< GPU time of the collect stage in ms.
+            double   cpuTime = 0.0;         ///< CPU time of the pass in ms.
+
+            /** Fills the photon counts from the GPU counters.
+                \param[in] counters Counter values indexed by PhotonStatsCounter.
+            */
+            void setCounters(const uint32_t counters[(uint32_t)PhotonStatsCounter::Count]);
+
+            /** Convert to python dict.
+            */
+            pybind11::dict toPython() const;
+        };
+
+        using SharedPtr = std::shared_ptr<PhotonMapperStats>;
+        virtual ~PhotonMapperStats() = default;
+
+        static SharedPtr create();
+
+        void setEnabled(bool enabled) { mEnabled = enabled; }
+        bool isEnabled() const { return mEnabled; }
+
+        /** Starts an iteration. Clears the counters if stats are enabled.
+        */
+        void beginFrame(RenderContext* pRenderContext);
+
+        /** Ends an iteration and starts the readback of the counters and timers.
+            \param[in] causticRadius Caustic radius used in this iteration.
+            \param[in] globalRadius Global radius used in this iteration.
+        */
+        void endFrame(RenderContext* pRenderContext, float causticRadius, float globalRadius);
+
+        /** Starts and ends the GPU timer of a stage. Stages that are not run in an iteration report zero.
+        */
+        void beginStage(Stage stage);
+        void endStage(Stage stage);
+
+        /** Perform program specialization and bind resources.
+            This call doesn't change any resource declarations in the program.
+        */
+        void prepareProgram(const Program::SharedPtr& pProgram, const ShaderVar& var);
+
+        void renderUI(Gui::Widgets& widget);
+
+        /** Fetches the stats of the last iteration.
+            \param[out] stats The stats are copied here.
+            \return True if stats are available, false otherwise.
+        */
+        bool getStats(Stats& stats);
+
+    protected:
+        PhotonMapperStats() = default;
+        void copyStatsToCPU();
+
+        static const uint32_t kCounterCount = (uint32_t)PhotonStatsCounter::Count;
+        static const uint32_t kStageCount = (uint32_t)Stage::Count;
+
+        // Internal state
+        Buffer::SharedPtr                   mpCounters;                     ///< GPU counters.
+        Buffer::SharedPtr                   mpCountersReadback;             ///< Counters for readback (CPU mappable).
+        GpuFence::SharedPtr                 mpFence;                        ///< GPU fence for sychronizing readback.
+        GpuTimer::SharedPtr                 mpStageTimers[kStageCount];     ///< GPU timers of the stages.
+        bool                                mStageTimed[kStageCount] = {};  ///< True if a stage was timed in the last iteration.
+        CpuTimer::TimePoint                 mCpuStart;                      ///< Start of the pass on the CPU.
+
+        // Configuration
+        bool                                mEnabled = false;               ///< Enable photon statistics.
+
+        // Runtime data
+        bool                                mRunning = false;               ///< True inbetween beginFrame() / endFrame() calls.
+        bool                                mWaitingForData = false;        ///< True if we are waiting for data to become available on the GPU.
+        bool                                mStatsValid = false;            ///< True if stats have been read back and are valid.
+        Stats                               mStats;                         ///< Stats of the last iteration.
+    };
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "PhotonRadiusEstimation.h"
+#include "Core/API/RenderContext.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    namespace
+    {
+        const char kFootprintShaderFile[] = "Rendering/Utils/PhotonPixelFootprint.cs.slang";
+    }
+
+    PhotonRadiusEstimate estimatePhotonRadii(float surfaceArea, float sceneRadius, float pixelFootprint, uint32_t causticPhotons, uint32_t globalPhotons, float photonsPerQuery, float maxSceneFraction)
+    {
+        const float maxRadius = maxSceneFraction * sceneRadius;
+        const float minRadius = std::min(pixelFootprint, maxRadius);
+
+        auto radius = [&](uint32_t photonCount, float upperBound)
+        {
+            if (photonCount == 0) return upperBound;
+            return std::clamp(photonDensityRadius(float(photonCount), surfaceArea, photonsPerQuery), std::min(minRadius, upperBound), upperBound);
+        };
+
+        PhotonRadiusEstimate estimate;
+        estimate.globalRadius = radius(globalPhotons, maxRadius);
+        estimate.causticRadius = radius(causticPhotons, estimate.globalRadius);
+        return estimate;
+    }
+
+    PhotonPixelFootprint::SharedPtr PhotonPixelFootprint::create(const Scene::SharedPtr& pScene)
+    {
+        return SharedPtr(new PhotonPixelFootprint(pScene));
+    }
+
+    PhotonPixelFootprint::PhotonPixelFootprint(const Scene::SharedPtr& pScene)
+        : mpScene(pScene)
+    {
+        FALCOR_ASSERT(mpScene);
+
+        Program::Desc desc;
+        desc.addShaderModules(mpScene->getShaderModules());
+        desc.addShaderLibrary(kFootprintShaderFile).csEntry("main");
+        desc.addTypeConformances(mpScene->getTypeConformances());
+        mpFootprintPass = ComputePass::create(desc, mpScene->getSceneDefines());
+
+        mpParallelReduction = ComputeParallelReduction::create();
+    }
+
+    float PhotonPixelFootprint::execute(RenderContext* pRenderContext, const Texture::SharedPtr& pVBuffer)
+    {
+        FALCOR_ASSERT(pVBuffer);
+        const uint2 frameDim = uint2(pVBuffer->getWidth(), pVBuffer->getHeight());
+
+        if (!mpFootprint || mpFootprint->getWidth() != frameDim.x || mpFootprint->getHeight() != frameDim.y)
+        {
+            mpFootprint = Texture::create2D(frameDim.x, frameDim.y, ResourceFormat::RGBA32Float, 1, 1, nullptr, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+        }
+
+        auto var = mpFootprintPass->getRootVar();
+        var["gScene"] = mpScene->getParameterBlock();
+        var["CB"]["gFrameDim"] = frameDim;
+        var["gVBuffer"] = pVBuffer;
+        var["gFootprint"] = mpFootprint;
+        mpFootprintPass->execute(pRenderContext, frameDim.x, frameDim.y);
+
+        // Sum of (footprint, valid flag) over all pixels. Blocks until the result is available.
+        float4 sum = float4(0.f);
+        mpParallelReduction->execute<float4>(pRenderContext, mpFootprint, ComputeParallelReduction::Type::Sum, &sum);
+        return sum.y > 0.f ? sum.x / sum.y : 0.f;
+    }
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "PhotonRadiusEstimation.slang"
+#include "Core/Macros.h"
+#include "Core/API/Texture.h"
+#include "RenderGraph/BasePasses/ComputePass.h"
+#include "Scene/Scene.h"
+#include "Utils/Algorithm/ComputeParallelReduction.h"
+#include <cstdint>
+#include <memory>
+
+namespace Falcor
+{
+    class RenderContext;
+
+    /** Start radii of the caustic and global photon maps.
+    */
+    struct PhotonRadiusEstimate
+    {
+        float causticRadius = 0.f;
+        float globalRadius = 0.f;
+    };
+
+    /** Estimates the start radii of a photon mapper from the photons stored in a pilot iteration.
+        The radii hold photonsPerQuery photons if the photons are spread evenly over the surface area.
+        The global radius is clamped to [pixelFootprint, maxSceneFraction * sceneRadius]. The caustic
+        photons are concentrated in a small part of the scene, so the caustic radius is not larger than
+        the global radius. Without photons in a map its radius falls back to the upper bound.
+        \param[in] surfaceArea Estimate of the lit surface area, e.g. the surface area of the scene bounds.
+        \param[in] sceneRadius Radius of the scene-bounding sphere.
+        \param[in] pixelFootprint Average world-space pixel footprint at the camera hits, or zero if unknown.
+        \param[in] causticPhotons Number of caustic photons stored in the pilot iteration.
+        \param[in] globalPhotons Number of global photons stored in the pilot iteration.
+        \param[in] photonsPerQuery Targeted number of photons per query.
+        \param[in] maxSceneFraction Upper bound of the radii relative to the scene radius.
+        \return The estimated radii.
+    */
+    FALCOR_API PhotonRadiusEstimate estimatePhotonRadii(float surfaceArea, float sceneRadius, float pixelFootprint, uint32_t causticPhotons, uint32_t globalPhotons, float photonsPerQuery, float maxSceneFraction = 0.05f);
+
+    /** Computes the average world-space pixel footprint at the hits of a V-buffer.
+        The object is created for one scene and has to be recreated if the scene changes.
+    */
+    class FALCOR_API PhotonPixelFootprint
+    {
+    public:
+        using SharedPtr = std::shared_ptr<PhotonPixelFootprint>;
+        virtual ~PhotonPixelFootprint() = default;
+
+        /** Create a new object.
+            \param[in] pScene The scene the V-buffer is rendered from.
+            \return New object, or throws an exception if creation failed.
+        */
+        static SharedPtr create(const Scene::SharedPtr& pScene);
+
+        /** Computes the average pixel footprint over the pixels that hit a triangle.
+            This call blocks until the result is available on the CPU.
+            \param[in] pRenderContext The render context.
+            \param[in] pVBuffer V-buffer with the camera hits, e.g. from VBufferPM.
+            \return Average pixel footprint, or zero if no pixel hit the scene.
+        */
+        float execute(RenderContext* pRenderContext, const Texture::SharedPtr& pVBuffer);
+
+    protected:
+        PhotonPixelFootprint(const Scene::SharedPtr& pScene);
+
+        Scene::SharedPtr                        mpScene;
+        ComputePass::SharedPtr                  mpFootprintPass;        ///< Writes the footprint and a valid flag of each pixel.
+        Texture::SharedPtr                      mpFootprint;            ///< Per-pixel footprint (x) and valid flag (y).
+        ComputeParallelReduction::SharedPtr     mpParallelReduction;
+    };
+}
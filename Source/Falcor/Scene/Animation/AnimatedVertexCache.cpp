@@ -29,6 +29,8 @@
 #include "Animation.h"
 #include "Core/API/RenderContext.h"
 #include "Scene/Scene.h"
+#include "Utils/Logger.h"
+#include "Utils/StringUtils.h"
 #include "Utils/Timing/Profiler.h"
 
 namespace Falcor
@@ -39,6 +41,16 @@ namespace Falcor
         const std::string kUpdateCurveAABBsFilename = "Scene/Animation/UpdateCurveAABBs.slang";
         const std::string kUpdateCurvePolyTubeVerticesFilename = "Scene/Animation/UpdateCurvePolyTubeVertices.slang";
 
+        // Keyframe streaming settings.
+        const uint32_t kStreamedKeyframeSlotCount = 8;  // Keyframe buffers per streamed animation.
+        const uint32_t kStreamedPositionBits = 16;      // Bits per quantized position component.
+        const uint32_t kStreamedIntraInterval = 16;     // Interval between independently encoded keyframes.
+
+        uint32_t getKeyframeBufferCount(size_t keyframeCount, bool streamKeyframes)
+        {
+            return streamKeyframes ? std::min(kStreamedKeyframeSlotCount, (uint32_t)keyframeCount) : (uint32_t)keyframeCount;
+        }
+
         InterpolationInfo calculateInterpolation(double time, const std::vector<double>& timeSamples, Animation::Behavior preInfinityBehavior, Animation::Behavior postInfinityBehavior)
         {
             if (!std::isfinite(time))
@@ -96,11 +108,12 @@ namespace Falcor
         }
     }
 
-    AnimatedVertexCache::AnimatedVertexCache(Scene* pScene, const Buffer::SharedPtr& pPrevVertexData, std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes)
+    AnimatedVertexCache::AnimatedVertexCache(Scene* pScene, const Buffer::SharedPtr& pPrevVertexData, std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, bool streamKeyframes)
         : mpScene(pScene)
         , mCachedCurves(cachedCurves)
         , mCachedMeshes(cachedMeshes)
         , mpPrevVertexData(pPrevVertexData)
+        , mStreamKeyframes(streamKeyframes)
     {
         if (mCachedCurves.empty() && mCachedMeshes.empty()) return;
 
@@ -127,6 +140,11 @@ namespace Falcor
                 createCurvePolyTubeVertexUpdatePass();
             }
 
+            // The keyframes are now held by the keyframe streams.
+            if (mStreamKeyframes)
+            {
+                for (auto& cache : mCachedCurves) cache.vertexData = {};
+            }
 
         }
 
@@ -137,22 +155,34 @@ namespace Falcor
 
             createMeshVertexUpdatePass();
         }
+
+        if (mStreamKeyframes) startKeyframePrefetcher();
     }
 
-    AnimatedVertexCache::UniquePtr AnimatedVertexCache::create(Scene* pScene, const Buffer::SharedPtr& pPrevVertexData, std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes)
+    AnimatedVertexCache::UniquePtr AnimatedVertexCache::create(Scene* pScene, const Buffer::SharedPtr& pPrevVertexData, std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, bool streamKeyframes)
     {
-        return UniquePtr(new AnimatedVertexCache(pScene, pPrevVertexData, std::move(cachedCurves), std::move(cachedMeshes)));
+        return UniquePtr(new AnimatedVertexCache(pScene, pPrevVertexData, std::move(cachedCurves), std::move(cachedMeshes), streamKeyframes));
     }
 
     bool AnimatedVertexCache::animate(RenderContext* pRenderContext, double time)
     {
         if (!hasAnimations()) return false;
 
+        if (mStreamKeyframes) uploadPrefetchedKeyframes();
+
         if (!mCachedCurves.empty())
         {
             double curveTime = mLoopAnimations ? std::fmod(time, mGlobalCurveAnimationLength) : time;
             InterpolationInfo interpolationInfo = calculateInterpolation(curveTime, mCurveKeyframeTimes, mPreInfinityBehavior, Animation::Behavior::Constant);
 
+            if (mStreamKeyframes)
+            {
+                // Both curve channels share the merged timeline, so their windows assign identical slots.
+                uint2 keyframeIndices = interpolationInfo.keyframeIndices;
+                if (mCurveLSSCount > 0) interpolationInfo.keyframeIndices = streamKeyframes(mCurveLSSChannel, keyframeIndices);
+                if (mCurvePolyTubeCount > 0) interpolationInfo.keyframeIndices = streamKeyframes(mCurvePolyTubeChannel, keyframeIndices);
+            }
+
             if (mCurveLSSCount > 0)
             {
                 executeCurveLSSVertexUpdatePass(pRenderContext, interpolationInfo);
@@ -200,6 +230,13 @@ namespace Falcor
         return m;
     }
 
+    uint64_t AnimatedVertexCache::getStreamedKeyframeMemoryInBytes() const
+    {
+        uint64_t m = 0;
+        for (const auto& pStream : mpKeyframeStreams) m += pStream->getEncodedSize();
+        return m;
+    }
+
     // We create a merged list of all timestamps and generate new frames for curves where those timestamps are missing.
     // This can lead to fairly heavy overhead if we have cached curves with vastly different total length.
     // Currently, our assets have cached curves with the same list of timestamps.
@@ -231,9 +268,10 @@ namespace Falcor
         }
 
         // Create buffers for vertex positions in curve vertex caches.
+        // In streaming mode, the buffers only hold the keyframes in the streaming window.
         ResourceBindFlags vbBindFlags = ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess;
-        mpCurveVertexBuffers.resize(mCurveKeyframeTimes.size());
-        for (uint32_t i = 0; i < mCurveKeyframeTimes.size(); i++)
+        mpCurveVertexBuffers.resize(getKeyframeBufferCount(mCurveKeyframeTimes.size(), mStreamKeyframes));
+        for (uint32_t i = 0; i < mpCurveVertexBuffers.size(); i++)
         {
             mpCurveVertexBuffers[i] = Buffer::createStructured(sizeof(DynamicCurveVertexData), mCurveVertexCount, vbBindFlags, Buffer::CpuAccess::None, nullptr, false);
             mpCurveVertexBuffers[i]->setName("AnimatedVertexCache::mpCurveVertexBuffers[" + std::to_string(i) + "]");
@@ -243,42 +281,30 @@ namespace Falcor
         mpPrevCurveVertexBuffer = Buffer::createStructured(sizeof(DynamicCurveVertexData), mCurveVertexCount, vbBindFlags, Buffer::CpuAccess::None, nullptr, false);
         mpPrevCurveVertexBuffer->setName("AnimatedVertexCache::mpPrevCurveVertexBuffer");
 
-        // Initialize vertex buffers with cached positions.
+        // Initialize previous vertex buffer with positions at the first keyframe.
         uint32_t offset = 0;
         for (size_t i = 0; i < mCachedCurves.size(); i++)
         {
             if (mCachedCurves[i].tessellationMode != CurveTessellationMode::LinearSweptSphere) continue;
 
-            size_t vertexCount = mCachedCurves[i].vertexData[0].size();
-            uint32_t bufSize = uint32_t(vertexCount * sizeof(DynamicCurveVertexData));
-            uint32_t k = 0;
-            const auto& timeSamples = mCachedCurves[i].timeSamples;
+            uint32_t bufSize = uint32_t(mCachedCurves[i].vertexData[0].size() * sizeof(DynamicCurveVertexData));
+            mpPrevCurveVertexBuffer->setBlob(mCachedCurves[i].vertexData[0].data(), offset, bufSize);
+            offset += bufSize;
+        }
 
+        // Initialize vertex buffers with cached positions, or encode them for streaming.
+        if (mStreamKeyframes)
+        {
+            mCurveLSSChannel = initCurveKeyframeStream(CurveTessellationMode::LinearSweptSphere, mCurveVertexCount, mpCurveVertexBuffers);
+        }
+        else
+        {
+            std::vector<DynamicCurveVertexData> vertices;
             for (uint32_t j = 0; j < mCurveKeyframeTimes.size(); j++)
             {
-                while (k + 1 < timeSamples.size() && timeSamples[k] < mCurveKeyframeTimes[j]) k++;
-
-                if (timeSamples[k] == mCurveKeyframeTimes[j])
-                {
-                    mpCurveVertexBuffers[j]->setBlob(mCachedCurves[i].vertexData[k].data(), offset, bufSize);
-                }
-                else
-                {
-                    // Linearly interpolate at the missing keyframe.
-                    float t = float((mCurveKeyframeTimes[j] - timeSamples[k - 1]) / (timeSamples[k] - timeSamples[k - 1]));
-                    std::vector<DynamicCurveVertexData> interpVertices(vertexCount);
-                    for (size_t p = 0; p < vertexCount; p++)
-                    {
-                        interpVertices[p].position = lerp(mCachedCurves[i].vertexData[k - 1][p].position, mCachedCurves[i].vertexData[k][p].position, t);
-                    }
-                    mpCurveVertexBuffers[j]->setBlob(interpVertices.data(), offset, bufSize);
-                }
+                gatherCurveKeyframe(CurveTessellationMode::LinearSweptSphere, j, vertices);
+                mpCurveVertexBuffers[j]->setBlob(vertices.data(), 0, vertices.size() * sizeof(DynamicCurveVertexData));
             }
-
-            // Initialize it with positions at the first keyframe.
-            mpPrevCurveVertexBuffer->setBlob(mCachedCurves[i].vertexData[0].data(), offset, bufSize);
-
-            offset += bufSize;
         }
 
         // Create curve index buffer.
@@ -345,46 +371,26 @@ namespace Falcor
 
         // Create buffers for vertex positions in curve vertex caches.
         ResourceBindFlags vbBindFlags = ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess;
-        mpCurvePolyTubeVertexBuffers.resize(mCurveKeyframeTimes.size());
-        for (uint32_t i = 0; i < mCurveKeyframeTimes.size(); i++)
+        mpCurvePolyTubeVertexBuffers.resize(getKeyframeBufferCount(mCurveKeyframeTimes.size(), mStreamKeyframes));
+        for (uint32_t i = 0; i < mpCurvePolyTubeVertexBuffers.size(); i++)
         {
             mpCurvePolyTubeVertexBuffers[i] = Buffer::createStructured(sizeof(DynamicCurveVertexData), mCurvePolyTubeVertexCount, vbBindFlags, Buffer::CpuAccess::None, nullptr, false);
             mpCurvePolyTubeVertexBuffers[i]->setName("AnimatedVertexCache::mpCurvePolyTubeVertexBuffers[" + std::to_string(i) + "]");
         }
 
-        // Initialize vertex buffers with cached positions.
-        uint32_t offset = 0;
-        for (size_t i = 0; i < mCachedCurves.size(); i++)
+        // Initialize vertex buffers with cached positions, or encode them for streaming.
+        if (mStreamKeyframes)
         {
-            if (mCachedCurves[i].tessellationMode != CurveTessellationMode::PolyTube) continue;
-
-            size_t vertexCount = mCachedCurves[i].vertexData[0].size();
-            uint32_t bufSize = uint32_t(vertexCount * sizeof(DynamicCurveVertexData));
-            uint32_t k = 0;
-            const auto& timeSamples = mCachedCurves[i].timeSamples;
-
+            mCurvePolyTubeChannel = initCurveKeyframeStream(CurveTessellationMode::PolyTube, mCurvePolyTubeVertexCount, mpCurvePolyTubeVertexBuffers);
+        }
+        else
+        {
+            std::vector<DynamicCurveVertexData> vertices;
             for (uint32_t j = 0; j < mCurveKeyframeTimes.size(); j++)
             {
-                while (k + 1 < timeSamples.size() && timeSamples[k] < mCurveKeyframeTimes[j]) k++;
-
-                if (timeSamples[k] == mCurveKeyframeTimes[j])
-                {
-                    mpCurvePolyTubeVertexBuffers[j]->setBlob(mCachedCurves[i].vertexData[k].data(), offset, bufSize);
-                }
-                else
-                {
-                    // Linearly interpolate at the missing keyframe.
-                    float t = float((mCurveKeyframeTimes[j] - timeSamples[k - 1]) / (timeSamples[k] - timeSamples[k - 1]));
-                    std::vector<DynamicCurveVertexData> interpVertices(vertexCount);
-                    for (size_t p = 0; p < vertexCount; p++)
-                    {
-                        interpVertices[p].position = lerp(mCachedCurves[i].vertexData[k - 1][p].position, mCachedCurves[i].vertexData[k][p].position, t);
-                    }
-                    mpCurvePolyTubeVertexBuffers[j]->setBlob(interpVertices.data(), offset, bufSize);
-                }
+                gatherCurveKeyframe(CurveTessellationMode::PolyTube, j, vertices);
+                mpCurvePolyTubeVertexBuffers[j]->setBlob(vertices.data(), 0, vertices.size() * sizeof(DynamicCurveVertexData));
             }
-
-            offset += bufSize;
         }
 
         // Create curve strand index buffer.
@@ -393,7 +399,7 @@ namespace Falcor
         mpCurvePolyTubeStrandIndexBuffer->setName("AnimatedVertexCache::mpCurvePolyTubeStrandIndexBuffer");
 
         // Initialize strand index buffer.
-        offset = 0;
+        uint32_t offset = 0;
         const uint32_t strandLastVertexIndex = 0xffffffff;
         std::vector<uint32_t> strandIndexData(mCurvePolyTubeVertexCount);
         for (uint32_t i = 0; i < (uint32_t)mCachedCurves.size(); i++)
@@ -428,13 +434,66 @@ namespace Falcor
         mpCurvePolyTubeStrandIndexBuffer->setBlob(strandIndexData.data(), 0, mCurvePolyTubeVertexCount * sizeof(uint32_t));
     }
 
+    void AnimatedVertexCache::gatherCurveKeyframe(CurveTessellationMode mode, uint32_t keyframe, std::vector<DynamicCurveVertexData>& vertices) const
+    {
+        vertices.clear();
+        const double time = mCurveKeyframeTimes[keyframe];
+
+        for (const auto& cache : mCachedCurves)
+        {
+            if (cache.tessellationMode != mode) continue;
+
+            const auto& timeSamples = cache.timeSamples;
+            size_t k = std::lower_bound(timeSamples.begin(), timeSamples.end(), time) - timeSamples.begin();
+            k = std::min(k, timeSamples.size() - 1);
+
+            if (k == 0 || timeSamples[k] == time)
+            {
+                vertices.insert(vertices.end(), cache.vertexData[k].begin(), cache.vertexData[k].end());
+            }
+            else
+            {
+                // Linearly interpolate at the missing keyframe.
+                float t = float((time - timeSamples[k - 1]) / (timeSamples[k] - timeSamples[k - 1]));
+                for (size_t p = 0; p < cache.vertexData[k].size(); p++)
+                {
+                    vertices.push_back({ lerp(cache.vertexData[k - 1][p].position, cache.vertexData[k][p].position, t) });
+                }
+            }
+        }
+    }
+
+    uint32_t AnimatedVertexCache::initCurveKeyframeStream(CurveTessellationMode mode, uint32_t vertexCount, std::vector<Buffer::SharedPtr>& slotBuffers)
+    {
+        // Interpolated keyframes stay within the bounds of the cached positions.
+        AABB bounds;
+        for (const auto& cache : mCachedCurves)
+        {
+            if (cache.tessellationMode != mode) continue;
+            for (const auto& vertices : cache.vertexData)
+            {
+                for (const auto& v : vertices) bounds.include(v.position);
+            }
+        }
+
+        auto pStream = std::make_unique<KeyframeStream>(vertexCount, (uint32_t)sizeof(DynamicCurveVertexData), bounds, kStreamedPositionBits, kStreamedIntraInterval);
+        std::vector<DynamicCurveVertexData> vertices;
+        for (uint32_t j = 0; j < mCurveKeyframeTimes.size(); j++)
+        {
+            gatherCurveKeyframe(mode, j, vertices);
+            pStream->append(vertices.data());
+        }
+
+        return addKeyframeChannel(std::move(pStream), slotBuffers, 0);
+    }
+
 
     void AnimatedVertexCache::initMeshKeyframes()
     {
         for (const auto& cache : mCachedMeshes)
         {
             mGlobalMeshAnimationLength = std::max(mGlobalMeshAnimationLength, cache.timeSamples.back());
-            mMeshKeyframeCount += (uint32_t)cache.timeSamples.size();
+            mMeshKeyframeCount += getKeyframeBufferCount(cache.timeSamples.size(), mStreamKeyframes);
             mMaxMeshVertexCount = std::max((uint32_t)cache.vertexData.front().size(), mMaxMeshVertexCount);
         }
     }
@@ -457,16 +516,35 @@ namespace Falcor
             meta.prevVbOffset = mpScene->getMesh(cache.meshID).prevVbOffset;
             meshMetadata.push_back(meta);
 
-            // Create vertex buffer for each keyframe on this mesh
-            for (size_t i = 0; i < cache.vertexData.size(); i++)
+            // Create vertex buffer for each keyframe on this mesh, or for each slot of the streaming window.
+            uint32_t keyframeBufferCount = getKeyframeBufferCount(cache.timeSamples.size(), mStreamKeyframes);
+            for (uint32_t i = 0; i < keyframeBufferCount; i++)
             {
-                auto& data = cache.vertexData[i];
+                const void* pInitData = mStreamKeyframes ? nullptr : cache.vertexData[i].data();
                 size_t index = keyframeOffset + i;
-                mpMeshVertexBuffers[index] = Buffer::createStructured(sizeof(PackedStaticVertexData), (uint32_t)data.size(), ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, data.data(), false);
+                mpMeshVertexBuffers[index] = Buffer::createStructured(sizeof(PackedStaticVertexData), meta.vertexCount, ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, pInitData, false);
                 mpMeshVertexBuffers[index]->setName("AnimatedVertexCache::mpMeshVertexBuffers[" + std::to_string(index) + "]");
             }
 
-            keyframeOffset += (uint32_t)cache.timeSamples.size();
+            if (mStreamKeyframes)
+            {
+                AABB bounds;
+                for (const auto& vertices : cache.vertexData)
+                {
+                    for (const auto& v : vertices) bounds.include(v.position);
+                }
+
+                auto pStream = std::make_unique<KeyframeStream>(meta.vertexCount, (uint32_t)sizeof(PackedStaticVertexData), bounds, kStreamedPositionBits, kStreamedIntraInterval);
+                for (const auto& vertices : cache.vertexData) pStream->append(vertices.data());
+
+                uint32_t channel = addKeyframeChannel(std::move(pStream), mpMeshVertexBuffers, keyframeOffset);
+                if (meshMetadata.size() == 1) mMeshChannelOffset = channel;
+
+                // The keyframes are now held by the keyframe stream.
+                cache.vertexData = {};
+            }
+
+            keyframeOffset += keyframeBufferCount;
         }
 
         mpMeshMetadataBuffer = Buffer::createStructured(sizeof(PerMeshMetadata), (uint32_t)meshMetadata.size(), ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, meshMetadata.data(), false);
@@ -500,14 +578,14 @@ namespace Falcor
         FALCOR_ASSERT(mCurveLSSCount > 0);
 
         Program::DefineList defines;
-        defines.add("CURVE_KEYFRAME_COUNT", std::to_string(mCurveKeyframeTimes.size()));
+        defines.add("CURVE_KEYFRAME_COUNT", std::to_string(mpCurveVertexBuffers.size()));
         mpCurveVertexUpdatePass = ComputePass::create(kUpdateCurveVerticesFilename, "main", defines);
 
         auto block = mpCurveVertexUpdatePass->getVars()["gCurveVertexUpdater"];
         auto var = block["curvePerKeyframe"];
 
         // Bind curve vertex data.
-        for (uint32_t i = 0; i < mCurveKeyframeTimes.size(); i++) var[i]["vertexData"] = mpCurveVertexBuffers[i];
+        for (uint32_t i = 0; i < mpCurveVertexBuffers.size(); i++) var[i]["vertexData"] = mpCurveVertexBuffers[i];
     }
 
     void AnimatedVertexCache::createCurveLSSAABBUpdatePass()
@@ -525,7 +603,7 @@ namespace Falcor
         FALCOR_ASSERT(mCurvePolyTubeCount > 0);
 
         Program::DefineList defines;
-        defines.add("CURVE_KEYFRAME_COUNT", std::to_string(mCurveKeyframeTimes.size()));
+        defines.add("CURVE_KEYFRAME_COUNT", std::to_string(mpCurvePolyTubeVertexBuffers.size()));
         mpCurvePolyTubeVertexUpdatePass = ComputePass::create(kUpdateCurvePolyTubeVerticesFilename, "main", defines);
 
         auto block = mpCurvePolyTubeVertexUpdatePass->getVars()["gCurvePolyTubeVertexUpdater"];
@@ -535,7 +613,7 @@ namespace Falcor
         auto var = block["curvePerKeyframe"];
 
         // Bind curve vertex data.
-        for (uint32_t i = 0; i < mCurveKeyframeTimes.size(); i++) var[i]["vertexData"] = mpCurvePolyTubeVertexBuffers[i];
+        for (uint32_t i = 0; i < mpCurvePolyTubeVertexBuffers.size(); i++) var[i]["vertexData"] = mpCurvePolyTubeVertexBuffers[i];
     }
 
 
@@ -550,6 +628,12 @@ namespace Falcor
         {
             auto postInfinityBehavior = mLoopAnimations ? Animation::Behavior::Cycle : Animation::Behavior::Constant;
             mMeshInterpolationInfo[i] = calculateInterpolation(t, mCachedMeshes[i].timeSamples, mPreInfinityBehavior, postInfinityBehavior);
+
+            // Keyframes are not accessed when copying to the previous vertices.
+            if (mStreamKeyframes && !copyPrev)
+            {
+                mMeshInterpolationInfo[i].keyframeIndices = streamKeyframes(mMeshChannelOffset + (uint32_t)i, mMeshInterpolationInfo[i].keyframeIndices);
+            }
         }
 
         mpMeshInterpolationBuffer->setBlob(mMeshInterpolationInfo.data(), 0, mpMeshInterpolationBuffer->getSize());
@@ -621,5 +705,97 @@ namespace Falcor
         mpCurvePolyTubeVertexUpdatePass->execute(pRenderContext, mMaxCurvePolyTubeVertexCount * 4, mCurvePolyTubeCount, 1);
     }
 
+    uint32_t AnimatedVertexCache::addKeyframeChannel(KeyframeStream::UniquePtr pStream, std::vector<Buffer::SharedPtr>& slotBuffers, uint32_t slotBufferOffset)
+    {
+        FALCOR_ASSERT(mpKeyframeStreams.size() == mKeyframeChannels.size());
+
+        uint32_t keyframeCount = pStream->getKeyframeCount();
+        mKeyframeChannels.push_back({ KeyframeWindow(keyframeCount, getKeyframeBufferCount(keyframeCount, true)), &slotBuffers, slotBufferOffset });
+        mpKeyframeStreams.push_back(std::move(pStream));
+        return (uint32_t)mKeyframeChannels.size() - 1;
+    }
+
+    void AnimatedVertexCache::startKeyframePrefetcher()
+    {
+        std::vector<const KeyframeStream*> streams;
+        uint64_t decodedSize = 0;
+        uint32_t slotCount = 0;
+        for (size_t i = 0; i < mpKeyframeStreams.size(); i++)
+        {
+            streams.push_back(mpKeyframeStreams[i].get());
+            decodedSize += mpKeyframeStreams[i]->getDecodedSize();
+            slotCount += mKeyframeChannels[i].window.getSlotCount();
+        }
+        mpKeyframePrefetcher = std::make_unique<KeyframePrefetcher>(std::move(streams));
+
+        logInfo("AnimatedVertexCache: Streaming {} keyframe sequences through {} GPU keyframe buffers. Keyframes use {} on the host ({} uncompressed), keyframe buffers use {} on the GPU.",
+            mpKeyframeStreams.size(), slotCount, formatByteSize(getStreamedKeyframeMemoryInBytes()), formatByteSize(decodedSize), formatByteSize(getMemoryUsageInBytes()));
+    }
+
+    uint2 AnimatedVertexCache::streamKeyframes(uint32_t channel, uint2 keyframeIndices)
+    {
+        FALCOR_ASSERT(mpKeyframePrefetcher);
+
+        auto isNeeded = [&](uint32_t keyframe) { return keyframe == keyframeIndices.x || keyframe == keyframeIndices.y; };
+        KeyframeWindow& window = mKeyframeChannels[channel].window;
+
+        for (const auto& load : window.update(keyframeIndices.x))
+        {
+            // Drop the pending upload of a keyframe that left the window before it was decoded.
+            auto it = std::find_if(mPendingUploads.begin(), mPendingUploads.end(), [&](const PendingUpload& p) { return p.channel == channel && p.slot == load.slot; });
+            if (it != mPendingUploads.end())
+            {
+                mpKeyframePrefetcher->cancel(channel, it->keyframe);
+                mPendingUploads.erase(it);
+            }
+
+            if (isNeeded(load.keyframe))
+            {
+                mpKeyframePrefetcher->take(channel, load.keyframe, mKeyframeUploadData);
+                uploadKeyframe(channel, load.slot, mKeyframeUploadData);
+            }
+            else
+            {
+                mpKeyframePrefetcher->request(channel, load.keyframe);
+                mPendingUploads.push_back({ channel, load.keyframe, load.slot });
+            }
+        }
+
+        // Keyframes needed now that have been requested earlier but not uploaded yet are waited for.
+        for (auto it = mPendingUploads.begin(); it != mPendingUploads.end();)
+        {
+            if (it->channel == channel && isNeeded(it->keyframe))
+            {
+                mpKeyframePrefetcher->take(channel, it->keyframe, mKeyframeUploadData);
+                uploadKeyframe(channel, it->slot, mKeyframeUploadData);
+                it = mPendingUploads.erase(it);
+            }
+            else ++it;
+        }
+
+        return uint2(window.getSlot(keyframeIndices.x), window.getSlot(keyframeIndices.y));
+    }
+
+    void AnimatedVertexCache::uploadKeyframe(uint32_t channel, uint32_t slot, const std::vector<uint8_t>& data)
+    {
+        const KeyframeChannel& c = mKeyframeChannels[channel];
+        (*c.pSlotBuffers)[c.slotBufferOffset + slot]->setBlob(data.data(), 0, data.size());
+    }
+
+    void AnimatedVertexCache::uploadPrefetchedKeyframes()
+    {
+        FALCOR_PROFILE("upload prefetched keyframes");
+
+        for (auto it = mPendingUploads.begin(); it != mPendingUploads.end();)
+        {
+            if (mpKeyframePrefetcher->tryTake(it->channel, it->keyframe, mKeyframeUploadData))
+            {
+                uploadKeyframe(it->channel, it->slot, mKeyframeUploadData);
+                it = mPendingUploads.erase(it);
+            }
+            else ++it;
+        }
+    }
+
 
 }
@@ -27,6 +27,7 @@
  **************************************************************************/
 #pragma once
 #include "Animation.h"
+#include "KeyframeStream.h"
 #include "SharedTypes.slang"
 #include "Core/API/Buffer.h"
 #include "Scene/Curves/CurveConfig.h"
@@ -78,7 +79,14 @@ namespace Falcor
         using UniqueConstPtr = std::unique_ptr<const AnimatedVertexCache>;
         ~AnimatedVertexCache() = default;
 
-        static UniquePtr create(Scene* pScene, const Buffer::SharedPtr& pPrevVertexData, std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes);
+        /** Create the vertex cache.
+            \param[in] pScene Scene the cached geometry belongs to.
+            \param[in] pPrevVertexData Buffer of previous vertex positions owned by the AnimationController.
+            \param[in] cachedCurves Vertex-animated curves.
+            \param[in] cachedMeshes Vertex-animated meshes.
+            \param[in] streamKeyframes Keep keyframes compressed on the host and only a sliding window of them in GPU memory.
+        */
+        static UniquePtr create(Scene* pScene, const Buffer::SharedPtr& pPrevVertexData, std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, bool streamKeyframes = false);
 
         void setIsLooped(bool looped) { mLoopAnimations = looped; }
 
@@ -102,13 +110,23 @@ namespace Falcor
 
         uint64_t getMemoryUsageInBytes() const;
 
+        bool isStreamingKeyframes() const { return mpKeyframePrefetcher != nullptr; }
+
+        /** Get the host memory holding compressed keyframes in streaming mode.
+        */
+        uint64_t getStreamedKeyframeMemoryInBytes() const;
+
     private:
-        AnimatedVertexCache(Scene* pScene, const Buffer::SharedPtr& pPrevVertexData, std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes);
+        AnimatedVertexCache(Scene* pScene, const Buffer::SharedPtr& pPrevVertexData, std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, bool streamKeyframes);
 
         void initCurveKeyframes();
         void bindCurveLSSBuffers();
         void bindCurvePolyTubeBuffers();
 
+        // Gather the vertices of all curves in the given tessellation mode at a keyframe of the merged timeline.
+        void gatherCurveKeyframe(CurveTessellationMode mode, uint32_t keyframe, std::vector<DynamicCurveVertexData>& vertices) const;
+        uint32_t initCurveKeyframeStream(CurveTessellationMode mode, uint32_t vertexCount, std::vector<Buffer::SharedPtr>& slotBuffers);
+
         void createCurveLSSVertexUpdatePass();
         void createCurveLSSAABBUpdatePass();
         void createCurvePolyTubeVertexUpdatePass();
@@ -129,6 +147,29 @@ namespace Falcor
 
         void executeCurvePolyTubeVertexUpdatePass(RenderContext* pContext, const InterpolationInfo& info, bool copyPrev = false);
 
+        struct KeyframeChannel
+        {
+            KeyframeWindow window;                          ///< Keyframes resident in the GPU slots.
+            std::vector<Buffer::SharedPtr>* pSlotBuffers;   ///< GPU buffers holding the slots.
+            uint32_t slotBufferOffset;                      ///< Index of the first slot in pSlotBuffers.
+        };
+
+        struct PendingUpload
+        {
+            uint32_t channel;
+            uint32_t keyframe;
+            uint32_t slot;
+        };
+
+        uint32_t addKeyframeChannel(KeyframeStream::UniquePtr pStream, std::vector<Buffer::SharedPtr>& slotBuffers, uint32_t slotBufferOffset);
+        void startKeyframePrefetcher();
+
+        // Make the keyframes of an interpolation resident and return their slots.
+        // Keyframes further ahead in the window are decoded in the background and uploaded once ready.
+        uint2 streamKeyframes(uint32_t channel, uint2 keyframeIndices);
+        void uploadKeyframe(uint32_t channel, uint32_t slot, const std::vector<uint8_t>& data);
+        void uploadPrefetchedKeyframes();
+
 
         bool mLoopAnimations = true;
         double mGlobalCurveAnimationLength = 0;
@@ -172,11 +213,22 @@ namespace Falcor
 
         std::vector<CachedMesh> mCachedMeshes;
         std::vector<InterpolationInfo> mMeshInterpolationInfo;
-        uint32_t mMeshKeyframeCount = 0; ///< Total count of all keyframes for all meshes
+        uint32_t mMeshKeyframeCount = 0; ///< Total count of keyframe buffers for all meshes
         uint32_t mMaxMeshVertexCount = 0; ///< Greatest vertex count a mesh has
 
         std::vector<Buffer::SharedPtr> mpMeshVertexBuffers;
         Buffer::SharedPtr mpMeshInterpolationBuffer;
         Buffer::SharedPtr mpMeshMetadataBuffer;
+
+        // Keyframe streaming. Each channel streams one keyframe stream through its own set of slots.
+        bool mStreamKeyframes = false;
+        std::vector<KeyframeStream::UniquePtr> mpKeyframeStreams;
+        std::vector<KeyframeChannel> mKeyframeChannels;
+        std::vector<PendingUpload> mPendingUploads;
+        KeyframePrefetcher::UniquePtr mpKeyframePrefetcher;
+        uint32_t mCurveLSSChannel = 0;
+        uint32_t mCurvePolyTubeChannel = 0;
+        uint32_t mMeshChannelOffset = 0;
+        std::vector<uint8_t> mKeyframeUploadData;
     };
 }
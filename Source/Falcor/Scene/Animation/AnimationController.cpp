@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "AnimationController.h"
 #include "Core/API/RenderContext.h"
+#include "Utils/StringUtils.h"
 #include "Utils/Timing/Profiler.h"
 #include "Scene/Scene.h"
 #include <fstream>
@@ -96,7 +97,7 @@ namespace Falcor
         return UniquePtr(new AnimationController(pScene, staticVertexData, skinningVertexData, prevVertexCount, animations));
     }
 
-    void AnimationController::addAnimatedVertexCaches(std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, const StaticVertexVector& staticVertexData)
+    void AnimationController::addAnimatedVertexCaches(std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, const StaticVertexVector& staticVertexData, bool streamKeyframes)
     {
         size_t totalAnimatedMeshVertexCount = 0;
 
@@ -160,7 +161,7 @@ namespace Falcor
             mpPrevVertexData->setBlob(prevVertexData.data(), byteOffset, prevVertexData.size() * sizeof(PrevVertexData));
         }
 
-        mpVertexCache = AnimatedVertexCache::create(mpScene, mpPrevVertexData, std::move(cachedCurves), std::move(cachedMeshes));
+        mpVertexCache = AnimatedVertexCache::create(mpScene, mpPrevVertexData, std::move(cachedCurves), std::move(cachedMeshes), streamKeyframes);
 
         // Note: It is a workaround to have two pre-infinity behaviors for the cached animation.
         // We need `Cycle` behavior when the length of cached animation is smaller than the length of mesh animation (e.g., tiger forest).
@@ -481,6 +482,11 @@ namespace Falcor
         }
         widget.tooltip("Enable/disable global animation looping.");
 
+        if (mpVertexCache && mpVertexCache->isStreamingKeyframes())
+        {
+            widget.text("Streamed keyframes: " + formatByteSize(mpVertexCache->getStreamedKeyframeMemoryInBytes()) + " host, " + formatByteSize(mpVertexCache->getMemoryUsageInBytes()) + " GPU");
+        }
+
         for (auto& animation : mAnimations)
         {
             if (auto animGroup = widget.group(animation->getName()))
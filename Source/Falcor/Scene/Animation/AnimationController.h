@@ -58,7 +58,7 @@ namespace Falcor
 
         /** Add animated vertex caches (curves and meshes) to the controller.
         */
-        void addAnimatedVertexCaches(std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, const StaticVertexVector& staticVertexData);
+        void addAnimatedVertexCaches(std::vector<CachedCurve>&& cachedCurves, std::vector<CachedMesh>&& cachedMeshes, const StaticVertexVector& staticVertexData, bool streamKeyframes = false);
 
         /** Returns true if controller contains animations.
         */
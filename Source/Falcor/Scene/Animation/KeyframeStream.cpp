@@ -0,0 +1,368 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "KeyframeStream.h"
+#include "Core/Errors.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Falcor
+{
+    namespace
+    {
+        uint32_t zigzagEncode(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+        int32_t zigzagDecode(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+        void writeVarint(std::vector<uint8_t>& data, uint32_t v)
+        {
+            while (v >= 0x80)
+            {
+                data.push_back(uint8_t(v | 0x80));
+                v >>= 7;
+            }
+            data.push_back(uint8_t(v));
+        }
+
+        uint32_t readVarint(const uint8_t*& p)
+        {
+            uint32_t v = 0;
+            for (uint32_t shift = 0;; shift += 7)
+            {
+                uint8_t byte = *p++;
+                v |= uint32_t(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) return v;
+            }
+        }
+
+        uint32_t floatBits(float f)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            return bits;
+        }
+
+        float bitsToFloat(uint32_t bits)
+        {
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+    }
+
+    KeyframeStream::KeyframeStream(uint32_t vertexCount, uint32_t vertexStride, const AABB& positionBounds, uint32_t positionBits, uint32_t intraInterval)
+        : mVertexCount(vertexCount)
+        , mWordsPerVertex(vertexStride / sizeof(uint32_t))
+        , mPositionBits(positionBits)
+        , mIntraInterval(std::max(intraInterval, 1u))
+        , mPositionMin(0.f)
+        , mQuantizeScale(0.f)
+        , mDequantizeScale(0.f)
+    {
+        if (vertexStride % sizeof(uint32_t) != 0 || vertexStride < sizeof(float3)) throw ArgumentError("Vertex stride must be a multiple of 4 bytes and hold a float3 position.");
+        if (positionBits > 24) throw ArgumentError("Position bits must be in the range [0, 24].");
+
+        if (mPositionBits > 0 && positionBounds.valid())
+        {
+            float maxCode = float((1u << mPositionBits) - 1);
+            float3 extent = positionBounds.extent();
+            mPositionMin = positionBounds.minPoint;
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                mQuantizeScale[i] = extent[i] > 0.f ? maxCode / extent[i] : 0.f;
+                mDequantizeScale[i] = extent[i] / maxCode;
+            }
+        }
+
+        mPrevCodes.resize((size_t)mVertexCount * mWordsPerVertex);
+    }
+
+    void KeyframeStream::append(const void* pData)
+    {
+        const uint32_t keyframe = getKeyframeCount();
+        const bool intra = isIntraKeyframe(keyframe);
+        const uint32_t maxCode = (1u << mPositionBits) - 1;
+        const uint32_t* pWords = reinterpret_cast<const uint32_t*>(pData);
+
+        mKeyframeOffsets.push_back(mData.size());
+
+        // Zero residuals are run-length encoded as a zero followed by the number of additional zeros.
+        uint32_t zeroRun = 0;
+        auto flushZeroRun = [&]()
+        {
+            if (zeroRun == 0) return;
+            writeVarint(mData, 0);
+            writeVarint(mData, zeroRun - 1);
+            zeroRun = 0;
+        };
+        auto writeResidual = [&](uint32_t residual)
+        {
+            if (residual == 0)
+            {
+                zeroRun++;
+                return;
+            }
+            flushZeroRun();
+            writeVarint(mData, residual);
+        };
+
+        // Encode word by word so that static attributes form long runs of zero residuals.
+        for (uint32_t word = 0; word < mWordsPerVertex; word++)
+        {
+            for (size_t i = word; i < mPrevCodes.size(); i += mWordsPerVertex)
+            {
+                uint32_t prev = intra ? 0 : mPrevCodes[i];
+                uint32_t code = pWords[i];
+
+                if (isPositionWord(word))
+                {
+                    float q = std::round((bitsToFloat(code) - mPositionMin[word]) * mQuantizeScale[word]);
+                    code = (uint32_t)std::clamp(q, 0.f, float(maxCode));
+                    writeResidual(zigzagEncode(int32_t(code - prev)));
+                }
+                else
+                {
+                    writeResidual(code ^ prev);
+                }
+
+                mPrevCodes[i] = code;
+            }
+        }
+        flushZeroRun();
+    }
+
+    float KeyframeStream::getMaxPositionError() const
+    {
+        if (mPositionBits == 0) return 0.f;
+        return 0.5f * std::max({ mDequantizeScale.x, mDequantizeScale.y, mDequantizeScale.z });
+    }
+
+    void KeyframeStream::decodeCodes(uint32_t keyframe, std::vector<uint32_t>& codes) const
+    {
+        const bool intra = isIntraKeyframe(keyframe);
+        const uint8_t* p = mData.data() + mKeyframeOffsets[keyframe];
+
+        uint32_t zeroRun = 0;
+        for (uint32_t word = 0; word < mWordsPerVertex; word++)
+        {
+            const bool position = isPositionWord(word);
+            for (size_t i = word; i < codes.size(); i += mWordsPerVertex)
+            {
+                uint32_t prev = intra ? 0 : codes[i];
+                uint32_t residual = 0;
+                if (zeroRun > 0) zeroRun--;
+                else if ((residual = readVarint(p)) == 0) zeroRun = readVarint(p);
+
+                if (position) codes[i] = prev + (uint32_t)zigzagDecode(residual);
+                else codes[i] = prev ^ residual;
+            }
+        }
+        FALCOR_ASSERT(zeroRun == 0);
+
+        FALCOR_ASSERT(p == mData.data() + (keyframe + 1 < getKeyframeCount() ? mKeyframeOffsets[keyframe + 1] : mData.size()));
+    }
+
+    KeyframeStream::Decoder::Decoder(const KeyframeStream& stream)
+        : mpStream(&stream)
+        , mCodes(stream.mPrevCodes.size())
+    {}
+
+    void KeyframeStream::Decoder::decode(uint32_t keyframe, void* pDst)
+    {
+        const KeyframeStream& s = *mpStream;
+        FALCOR_ASSERT(keyframe < s.getKeyframeCount());
+
+        if (keyframe != mKeyframe)
+        {
+            // Continue from the last decoded keyframe if it lies between the intra keyframe and the target.
+            uint32_t intraKeyframe = keyframe - keyframe % s.mIntraInterval;
+            bool canContinue = mKeyframe != kInvalidKeyframe && mKeyframe >= intraKeyframe && mKeyframe < keyframe;
+            for (uint32_t k = canContinue ? mKeyframe + 1 : intraKeyframe; k <= keyframe; k++) s.decodeCodes(k, mCodes);
+            mKeyframe = keyframe;
+        }
+
+        uint32_t* pWords = reinterpret_cast<uint32_t*>(pDst);
+        for (uint32_t word = 0; word < s.mWordsPerVertex; word++)
+        {
+            const bool position = s.isPositionWord(word);
+            for (size_t i = word; i < mCodes.size(); i += s.mWordsPerVertex)
+            {
+                pWords[i] = position ? floatBits(s.mPositionMin[word] + float(mCodes[i]) * s.mDequantizeScale[word]) : mCodes[i];
+            }
+        }
+    }
+
+    KeyframeWindow::KeyframeWindow(uint32_t keyframeCount, uint32_t slotCount)
+        : mKeyframeSlots(keyframeCount, kInvalidSlot)
+        , mSlotKeyframes(std::min(slotCount, keyframeCount), kInvalidSlot)
+    {
+        if (keyframeCount > 1 && slotCount < 2) throw ArgumentError("A keyframe window needs at least two slots to interpolate.");
+    }
+
+    std::vector<KeyframeWindow::Load> KeyframeWindow::update(uint32_t keyframe)
+    {
+        FALCOR_ASSERT(keyframe < getKeyframeCount());
+
+        const uint32_t keyframeCount = getKeyframeCount();
+        const uint32_t slotCount = getSlotCount();
+        auto inWindow = [&](uint32_t k) { return (k + keyframeCount - keyframe) % keyframeCount < slotCount; };
+
+        // Collect slots that are empty or hold keyframes outside the new window.
+        std::vector<uint32_t> freeSlots;
+        for (uint32_t slot = slotCount; slot-- > 0;)
+        {
+            uint32_t k = mSlotKeyframes[slot];
+            if (k == kInvalidSlot || !inWindow(k)) freeSlots.push_back(slot);
+        }
+
+        std::vector<Load> loads;
+        for (uint32_t i = 0; i < slotCount; i++)
+        {
+            uint32_t k = (keyframe + i) % keyframeCount;
+            if (mKeyframeSlots[k] != kInvalidSlot) continue;
+
+            FALCOR_ASSERT(!freeSlots.empty());
+            uint32_t slot = freeSlots.back();
+            freeSlots.pop_back();
+
+            if (mSlotKeyframes[slot] != kInvalidSlot) mKeyframeSlots[mSlotKeyframes[slot]] = kInvalidSlot;
+            mSlotKeyframes[slot] = k;
+            mKeyframeSlots[k] = slot;
+            loads.push_back({ k, slot });
+        }
+
+        return loads;
+    }
+
+    KeyframePrefetcher::KeyframePrefetcher(std::vector<const KeyframeStream*> streams)
+        : mStreams(std::move(streams))
+    {
+        for (const KeyframeStream* pStream : mStreams)
+        {
+            mWorkerDecoders.emplace_back(*pStream);
+            mCallerDecoders.emplace_back(*pStream);
+        }
+        mWorker = std::thread(&KeyframePrefetcher::workerLoop, this);
+    }
+
+    KeyframePrefetcher::~KeyframePrefetcher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mCondition.notify_all();
+        mWorker.join();
+    }
+
+    void KeyframePrefetcher::request(uint32_t stream, uint32_t keyframe)
+    {
+        FALCOR_ASSERT(stream < mStreams.size() && keyframe < mStreams[stream]->getKeyframeCount());
+
+        Key key{ stream, keyframe };
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mActive == key)
+            {
+                mDiscardActive = false;
+                return;
+            }
+            if (mReady.count(key) || std::find(mQueue.begin(), mQueue.end(), key) != mQueue.end()) return;
+            mQueue.push_back(key);
+        }
+        mCondition.notify_all();
+    }
+
+    void KeyframePrefetcher::cancel(uint32_t stream, uint32_t keyframe)
+    {
+        Key key{ stream, keyframe };
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.erase(std::remove(mQueue.begin(), mQueue.end(), key), mQueue.end());
+        mReady.erase(key);
+        if (mActive == key) mDiscardActive = true;
+    }
+
+    bool KeyframePrefetcher::tryTake(uint32_t stream, uint32_t keyframe, std::vector<uint8_t>& data)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mReady.find(Key{ stream, keyframe });
+        if (it == mReady.end()) return false;
+        data = std::move(it->second);
+        mReady.erase(it);
+        return true;
+    }
+
+    void KeyframePrefetcher::take(uint32_t stream, uint32_t keyframe, std::vector<uint8_t>& data)
+    {
+        Key key{ stream, keyframe };
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            if (mActive == key)
+            {
+                mDiscardActive = false;
+                mCondition.wait(lock, [&] { return mActive != key; });
+            }
+
+            auto it = mReady.find(key);
+            if (it != mReady.end())
+            {
+                data = std::move(it->second);
+                mReady.erase(it);
+                return;
+            }
+            mQueue.erase(std::remove(mQueue.begin(), mQueue.end(), key), mQueue.end());
+        }
+
+        // Not decoded ahead of time, decode on the calling thread.
+        data.resize(mStreams[stream]->getKeyframeSize());
+        mCallerDecoders[stream].decode(keyframe, data.data());
+    }
+
+    void KeyframePrefetcher::workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true)
+        {
+            mCondition.wait(lock, [&] { return mStop || !mQueue.empty(); });
+            if (mStop) break;
+
+            Key key = mQueue.front();
+            mQueue.pop_front();
+            mActive = key;
+            mDiscardActive = false;
+
+            lock.unlock();
+            std::vector<uint8_t> data(mStreams[key.first]->getKeyframeSize());
+            mWorkerDecoders[key.first].decode(key.second, data.data());
+            lock.lock();
+
+            if (!mDiscardActive) mReady[key] = std::move(data);
+            mActive = Key{ kIdle, kIdle };
+            mCondition.notify_all();
+        }
+    }
+}
@@ -0,0 +1,225 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Utils/Math/AABB.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Falcor
+{
+    /** Compressed host storage for a sequence of vertex keyframes.
+
+        Each vertex is a tightly packed record of 32-bit words starting with a float3 position
+        (e.g. PackedStaticVertexData or DynamicCurveVertexData). Positions are quantized to a fixed
+        number of bits per axis relative to the given bounds; all other words are stored bit-exact.
+        Every keyframe is delta-encoded against its predecessor (zigzag for positions, XOR for the
+        remaining words) and the residuals are written as variable-length integers. Every
+        `intraInterval`-th keyframe is encoded without a predecessor so that random access only
+        has to decode a bounded number of keyframes.
+    */
+    class FALCOR_API KeyframeStream
+    {
+    public:
+        using UniquePtr = std::unique_ptr<KeyframeStream>;
+
+        /** Create an empty stream.
+            \param[in] vertexCount Number of vertices per keyframe.
+            \param[in] vertexStride Size of a vertex in bytes. Must be a multiple of 4 and at least 12.
+            \param[in] positionBounds Bounds enclosing all vertex positions. Positions outside are clamped.
+            \param[in] positionBits Number of bits per quantized position component (1-24), or 0 to store positions losslessly.
+            \param[in] intraInterval Interval between keyframes that are encoded independently of their predecessor.
+        */
+        KeyframeStream(uint32_t vertexCount, uint32_t vertexStride, const AABB& positionBounds, uint32_t positionBits = 16, uint32_t intraInterval = 16);
+
+        /** Encode and append a keyframe.
+            \param[in] pData Vertex data of size getKeyframeSize().
+        */
+        void append(const void* pData);
+
+        uint32_t getKeyframeCount() const { return (uint32_t)mKeyframeOffsets.size(); }
+        uint32_t getVertexCount() const { return mVertexCount; }
+
+        /** Get the size of a decoded keyframe in bytes.
+        */
+        size_t getKeyframeSize() const { return (size_t)mVertexCount * mWordsPerVertex * sizeof(uint32_t); }
+
+        /** Get the size of all keyframes in encoded form in bytes.
+        */
+        size_t getEncodedSize() const { return mData.size(); }
+
+        /** Get the size of all keyframes in decoded form in bytes.
+        */
+        size_t getDecodedSize() const { return getKeyframeSize() * getKeyframeCount(); }
+
+        /** Get the largest error the position quantization introduces on any axis.
+        */
+        float getMaxPositionError() const;
+
+        /** Sequential decoder.
+            Decoding the keyframe following the previously decoded one only applies a single delta.
+            Any other keyframe restarts from the nearest preceding intra keyframe.
+            A decoder is not thread-safe, but any number of decoders can read the same stream concurrently.
+        */
+        class FALCOR_API Decoder
+        {
+        public:
+            Decoder(const KeyframeStream& stream);
+
+            /** Decode a keyframe.
+                \param[in] keyframe Keyframe index.
+                \param[out] pDst Destination of size getKeyframeSize().
+            */
+            void decode(uint32_t keyframe, void* pDst);
+
+        private:
+            const KeyframeStream* mpStream;
+            std::vector<uint32_t> mCodes;       ///< Quantized words of the last decoded keyframe.
+            uint32_t mKeyframe = kInvalidKeyframe;
+        };
+
+    private:
+        static constexpr uint32_t kInvalidKeyframe = std::numeric_limits<uint32_t>::max();
+
+        bool isPositionWord(uint32_t word) const { return mPositionBits > 0 && word < 3; }
+        bool isIntraKeyframe(uint32_t keyframe) const { return keyframe % mIntraInterval == 0; }
+        void decodeCodes(uint32_t keyframe, std::vector<uint32_t>& codes) const;
+
+        uint32_t mVertexCount;
+        uint32_t mWordsPerVertex;
+        uint32_t mPositionBits;
+        uint32_t mIntraInterval;
+        float3 mPositionMin;
+        float3 mQuantizeScale;              ///< Scale from position offset to code.
+        float3 mDequantizeScale;            ///< Scale from code to position offset.
+
+        std::vector<uint32_t> mPrevCodes;   ///< Quantized words of the last appended keyframe.
+        std::vector<uint8_t> mData;         ///< Encoded keyframes.
+        std::vector<size_t> mKeyframeOffsets;
+    };
+
+    /** Assignment of keyframes to a fixed number of resident slots.
+
+        The window always covers the current keyframe and as many of its successors as there are
+        slots, wrapping around at the end of the animation. Keyframes that drop out of the window
+        release their slots, which are handed to newly covered keyframes.
+    */
+    class FALCOR_API KeyframeWindow
+    {
+    public:
+        static constexpr uint32_t kInvalidSlot = std::numeric_limits<uint32_t>::max();
+
+        struct Load
+        {
+            uint32_t keyframe;
+            uint32_t slot;
+        };
+
+        /** Create a window.
+            \param[in] keyframeCount Number of keyframes in the animation.
+            \param[in] slotCount Number of resident slots. Clamped to the keyframe count.
+        */
+        KeyframeWindow(uint32_t keyframeCount, uint32_t slotCount);
+
+        /** Move the window to start at the given keyframe.
+            \param[in] keyframe Current keyframe.
+            \return Keyframes that were assigned a slot and need to be loaded, nearest first.
+        */
+        std::vector<Load> update(uint32_t keyframe);
+
+        /** Get the slot holding a keyframe, or kInvalidSlot if it is not resident.
+        */
+        uint32_t getSlot(uint32_t keyframe) const { return mKeyframeSlots[keyframe]; }
+
+        uint32_t getKeyframeCount() const { return (uint32_t)mKeyframeSlots.size(); }
+        uint32_t getSlotCount() const { return (uint32_t)mSlotKeyframes.size(); }
+
+    private:
+        std::vector<uint32_t> mKeyframeSlots;
+        std::vector<uint32_t> mSlotKeyframes;
+    };
+
+    /** Background decoder for keyframe streams.
+        A single worker thread decodes requested keyframes in request order so that they are
+        ready by the time playback reaches them.
+    */
+    class FALCOR_API KeyframePrefetcher
+    {
+    public:
+        using UniquePtr = std::unique_ptr<KeyframePrefetcher>;
+
+        /** Create a prefetcher. The streams must outlive it and must not be appended to anymore.
+        */
+        KeyframePrefetcher(std::vector<const KeyframeStream*> streams);
+        ~KeyframePrefetcher();
+
+        /** Queue a keyframe for decoding. Requests for keyframes already queued or decoded are ignored.
+        */
+        void request(uint32_t stream, uint32_t keyframe);
+
+        /** Drop a requested keyframe that is no longer needed.
+        */
+        void cancel(uint32_t stream, uint32_t keyframe);
+
+        /** Take a decoded keyframe if it is ready.
+            \return True if the keyframe was decoded and moved into data.
+        */
+        bool tryTake(uint32_t stream, uint32_t keyframe, std::vector<uint8_t>& data);
+
+        /** Take a decoded keyframe. Waits if the keyframe is being decoded, and decodes it
+            on the calling thread if it was not requested or is still queued.
+        */
+        void take(uint32_t stream, uint32_t keyframe, std::vector<uint8_t>& data);
+
+    private:
+        using Key = std::pair<uint32_t, uint32_t>;
+        static constexpr uint32_t kIdle = std::numeric_limits<uint32_t>::max();
+
+        void workerLoop();
+
+        std::vector<const KeyframeStream*> mStreams;
+        std::vector<KeyframeStream::Decoder> mWorkerDecoders;
+        std::vector<KeyframeStream::Decoder> mCallerDecoders;
+
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        std::deque<Key> mQueue;
+        std::map<Key, std::vector<uint8_t>> mReady;
+        Key mActive{ kIdle, kIdle };
+        bool mDiscardActive = false;
+        bool mStop = false;
+        std::thread mWorker;
+    };
+}
@@ -27,53 +27,67 @@
  **************************************************************************/
 #include "CurveTessellation.h"
 #include "Core/Assert.h"
+#include "Utils/NumericRange.h"
 #include "Utils/Math/Common.h"
 #include "Utils/Math/MathHelpers.h"
 #include "Utils/Math/CubicSpline.h"
 #include "Utils/Math/Matrix/Matrix.h"
+#include "Utils/Timing/CpuProfiler.h"
 #include <glm/gtx/quaternion.hpp>
+#include <algorithm>
+#include <execution>
+#include <numeric>
 #include <cmath>
 
 namespace Falcor
 {
-    struct StrandArrays {
-        std::vector<float3> controlPoints;
-        std::vector<float>  widths;
-        std::vector<float2> UVs;
-        uint32_t vertexCount { 0 };
-    };
-
-    struct CurveArrays {
-        const float3* controlPoints;
-        const float* widths;
-        const float2* UVs;
-
-        // Initializer
-        CurveArrays(const float3* paramControlPoints, const float* paramWidths, const float2* paramUVs)
-        {
-            controlPoints = paramControlPoints;
-            widths = paramWidths;
-            UVs = paramUVs;
-        }
-    };
-
-    struct CubicSplineCache
-    {
-        CubicSpline<float3> optSplinePoints;
-        CubicSpline<float>  optSplineWidths;
-        CubicSpline<float2> optSplineUVs;
-
-        CubicSpline<float3> splinePoints;
-        CubicSpline<float>  splineWidths;
-        CubicSpline<float2> splineUVs;
-    };
-
     namespace
     {
         // Curves tessellated to quad-tubes have the width somewhere between curveWidth and (curveWidth / sqrt(2)), depending on the viewing angle.
         // To achieve curveWidth on average, however, we need to scale the initial curveWidth by 1.11 (the number was deducted numerically).
         const float kMeshCompensationScale = 1.11f;
 
+        const size_t kStrandBlockSize = 64; ///< Number of strands tessellated per parallel task.
+
+        struct CurveArrays
+        {
+            const float3* controlPoints;
+            const float* widths;
+            const float2* UVs;
+        };
+
+        /** Scratch arrays holding the control points of one strand.
+        */
+        struct StrandArrays
+        {
+            std::vector<float3> controlPoints;
+            std::vector<float>  widths;
+            std::vector<float2> UVs;
+        };
+
+        struct CubicSplineCache
+        {
+            CubicSpline<float3> splinePoints;
+            CubicSpline<float>  splineWidths;
+            CubicSpline<float2> splineUVs;
+        };
+
+        /** Output layout of the tessellated strands, computed in a counting pass before any output is written.
+            Only every keepOneEveryXStrands-th input strand is tessellated; these are indexed by their position in the output.
+            A strand is tessellated into samples (points along the strand) connected by segments.
+        */
+        struct StrandLayout
+        {
+            std::vector<uint32_t> inputOffsets;     ///< Offset of the first control point of each strand in the input arrays.
+            std::vector<uint32_t> inputCounts;      ///< Number of control points of each strand in the input arrays.
+            std::vector<uint32_t> uniqueCounts;     ///< Number of control points of each strand after removing consecutive duplicates.
+            std::vector<uint32_t> sampleOffsets;    ///< Offset of the first sample of each strand. Holds one extra entry with the total sample count.
+            std::vector<uint32_t> segmentOffsets;   ///< Offset of the first segment of each strand. Holds one extra entry with the total segment count.
+
+            size_t getStrandCount() const { return inputOffsets.size(); }
+            uint32_t getSampleCount(size_t strand) const { return sampleOffsets[strand + 1] - sampleOffsets[strand]; }
+        };
+
         float4 transformSphere(const rmcv::mat4& xform, const float4& sphere)
         {
             // Spheres are represented as (center.x, center.y, center.z, radius).
@@ -91,14 +105,77 @@ namespace Falcor
 #endif
         }
 
-        void optimizeStrandGeometry(CubicSplineCache& splineCache, const CurveArrays& curveArrays, StrandArrays& strandArrays, StrandArrays& optimizedStrandArrays, uint32_t pointOffset, uint32_t subdivPerSegment, uint32_t keepOneEveryXVerticesPerStrand, float widthScale)
+        /** Run a function for all blocks of kStrandBlockSize strands in [0, count) in parallel.
+            The function is called with the strand range [begin, end) of a block.
+        */
+        template<typename F>
+        void parallelForBlocks(size_t count, F func)
+        {
+            auto range = NumericRange<size_t>(0, div_round_up(count, kStrandBlockSize));
+            std::for_each(std::execution::par, range.begin(), range.end(), [&](size_t block)
+            {
+                func(block * kStrandBlockSize, std::min(count, (block + 1) * kStrandBlockSize));
+            });
+        }
+
+        uint32_t countUniqueControlPoints(const float3* controlPoints, uint32_t vertexCount)
+        {
+            if (vertexCount == 0) return 0;
+            uint32_t count = 1;
+            for (uint32_t j = 0; j < vertexCount - 1; j++)
+            {
+                if (controlPoints[j] != controlPoints[j + 1]) count++;
+            }
+            return count;
+        }
+
+        StrandLayout computeStrandLayout(uint32_t strandCount, const uint32_t* vertexCountsPerStrand, const float3* controlPoints, uint32_t subdivPerSegment, uint32_t keepOneEveryXStrands, uint32_t keepOneEveryXVerticesPerStrand)
+        {
+            FALCOR_PROFILE_CPU("computeStrandLayout");
+
+            std::vector<uint32_t> allInputOffsets(strandCount);
+            std::exclusive_scan(std::execution::par, vertexCountsPerStrand, vertexCountsPerStrand + strandCount, allInputOffsets.begin(), 0u);
+
+            StrandLayout layout;
+            size_t count = div_round_up(strandCount, keepOneEveryXStrands);
+            layout.inputOffsets.resize(count);
+            layout.inputCounts.resize(count);
+            layout.uniqueCounts.resize(count);
+            std::vector<uint32_t> sampleCounts(count + 1, 0);
+            std::vector<uint32_t> segmentCounts(count + 1, 0);
+
+            parallelForBlocks(count, [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; i++)
+                {
+                    size_t inputStrand = i * keepOneEveryXStrands;
+                    layout.inputOffsets[i] = allInputOffsets[inputStrand];
+                    layout.inputCounts[i] = vertexCountsPerStrand[inputStrand];
+                    layout.uniqueCounts[i] = countUniqueControlPoints(controlPoints + layout.inputOffsets[i], layout.inputCounts[i]);
+
+                    // Strands with less than two distinct control points are degenerate and skipped.
+                    if (layout.uniqueCounts[i] < 2) continue;
+                    segmentCounts[i] = div_round_up(subdivPerSegment * (layout.uniqueCounts[i] - 1), keepOneEveryXVerticesPerStrand);
+                    sampleCounts[i] = segmentCounts[i] + 1;
+                }
+            });
+
+            layout.sampleOffsets.resize(count + 1);
+            layout.segmentOffsets.resize(count + 1);
+            std::exclusive_scan(std::execution::par, sampleCounts.begin(), sampleCounts.end(), layout.sampleOffsets.begin(), 0u);
+            std::exclusive_scan(std::execution::par, segmentCounts.begin(), segmentCounts.end(), layout.segmentOffsets.begin(), 0u);
+            return layout;
+        }
+
+        /** Copy the control points of a strand, removing consecutive duplicates.
+        */
+        void copyUniqueControlPoints(const CurveArrays& curveArrays, uint32_t pointOffset, uint32_t vertexCount, StrandArrays& strandArrays)
         {
             strandArrays.controlPoints.clear();
             strandArrays.UVs.clear();
             strandArrays.widths.clear();
 
-            // Optimize geometry by removing duplicates.
-            for (uint32_t j = 0; j < strandArrays.vertexCount - 1; j++)
+            for (uint32_t j = 0; j < vertexCount - 1; j++)
             {
                 if (curveArrays.controlPoints[pointOffset + j] != curveArrays.controlPoints[pointOffset + j + 1])
                 {
@@ -109,54 +186,52 @@ namespace Falcor
             }
 
             // Add the last control point.
-            strandArrays.controlPoints.push_back(curveArrays.controlPoints[pointOffset + strandArrays.vertexCount - 1]);
-            strandArrays.widths.push_back(curveArrays.widths[pointOffset + strandArrays.vertexCount - 1]);
-            if (curveArrays.UVs) strandArrays.UVs.push_back(curveArrays.UVs[pointOffset + strandArrays.vertexCount - 1]);
-
-            optimizedStrandArrays.vertexCount = static_cast<uint32_t>(strandArrays.controlPoints.size());
-
-            const CubicSpline<float3>& splinePoints = splineCache.optSplinePoints.setup(strandArrays.controlPoints.data(), optimizedStrandArrays.vertexCount);
-            const CubicSpline<float>& splineWidths = splineCache.optSplineWidths.setup(strandArrays.widths.data(), optimizedStrandArrays.vertexCount);
+            strandArrays.controlPoints.push_back(curveArrays.controlPoints[pointOffset + vertexCount - 1]);
+            strandArrays.widths.push_back(curveArrays.widths[pointOffset + vertexCount - 1]);
+            if (curveArrays.UVs) strandArrays.UVs.push_back(curveArrays.UVs[pointOffset + vertexCount - 1]);
+        }
 
-            uint32_t tmpCount = 0;
-            for (uint32_t j = 0; j < optimizedStrandArrays.vertexCount - 1; j++)
+        /** Call a function for all samples of a strand.
+            Sample i is taken at every keepOneEveryXVerticesPerStrand-th subdivision point; the last sample is always at the end of the strand.
+            The function is called with the sample index, the spline segment and the parameter within the segment.
+        */
+        template<typename F>
+        void forEachSample(uint32_t sampleCount, uint32_t uniqueCount, uint32_t subdivPerSegment, uint32_t keepOneEveryXVerticesPerStrand, F func)
+        {
+            for (uint32_t i = 0; i < sampleCount - 1; i++)
             {
-                for (uint32_t k = 0; k < subdivPerSegment; k++)
-                {
-                    if (tmpCount % keepOneEveryXVerticesPerStrand == 0)
-                    {
-                        float t = (float)k / (float)subdivPerSegment;
-                        optimizedStrandArrays.controlPoints.push_back(splinePoints.interpolate(j, t));
-                        optimizedStrandArrays.widths.push_back(kMeshCompensationScale * widthScale * splineWidths.interpolate(j, t));
-                    }
-                    tmpCount++;
-                }
+                uint32_t subdivIndex = i * keepOneEveryXVerticesPerStrand;
+                func(i, subdivIndex / subdivPerSegment, (float)(subdivIndex % subdivPerSegment) / (float)subdivPerSegment);
             }
+            func(sampleCount - 1, uniqueCount - 2, 1.f);
+        }
 
-            // Always keep the last vertex.
-            optimizedStrandArrays.controlPoints.push_back(splinePoints.interpolate(optimizedStrandArrays.vertexCount - 2, 1.f));
-            optimizedStrandArrays.widths.push_back(kMeshCompensationScale * widthScale * splineWidths.interpolate(optimizedStrandArrays.vertexCount - 2, 1.f));
+        /** Resample the spline through the control points of a strand at the sample positions.
+        */
+        void resampleStrand(CubicSplineCache& splineCache, const StrandArrays& strandArrays, StrandArrays& resampledArrays, uint32_t sampleCount, uint32_t subdivPerSegment, uint32_t keepOneEveryXVerticesPerStrand, float widthScale)
+        {
+            uint32_t uniqueCount = (uint32_t)strandArrays.controlPoints.size();
+            const CubicSpline<float3>& splinePoints = splineCache.splinePoints.setup(strandArrays.controlPoints.data(), uniqueCount);
+            const CubicSpline<float>& splineWidths = splineCache.splineWidths.setup(strandArrays.widths.data(), uniqueCount);
+
+            resampledArrays.controlPoints.resize(sampleCount);
+            resampledArrays.widths.resize(sampleCount);
+            forEachSample(sampleCount, uniqueCount, subdivPerSegment, keepOneEveryXVerticesPerStrand, [&](uint32_t i, uint32_t j, float t)
+            {
+                resampledArrays.controlPoints[i] = splinePoints.interpolate(j, t);
+                resampledArrays.widths[i] = kMeshCompensationScale * widthScale * splineWidths.interpolate(j, t);
+            });
 
             // Texture coordinates.
-            if (curveArrays.UVs)
+            resampledArrays.UVs.clear();
+            if (!strandArrays.UVs.empty())
             {
-                const CubicSpline<float2>& splineUVs = splineCache.optSplineUVs.setup(strandArrays.UVs.data(), optimizedStrandArrays.vertexCount);
-                tmpCount = 0;
-                for (uint32_t j = 0; j < optimizedStrandArrays.vertexCount - 1; j++)
+                const CubicSpline<float2>& splineUVs = splineCache.splineUVs.setup(strandArrays.UVs.data(), uniqueCount);
+                resampledArrays.UVs.resize(sampleCount);
+                forEachSample(sampleCount, uniqueCount, subdivPerSegment, keepOneEveryXVerticesPerStrand, [&](uint32_t i, uint32_t j, float t)
                 {
-                    for (uint32_t k = 0; k < subdivPerSegment; k++)
-                    {
-                        if (tmpCount % keepOneEveryXVerticesPerStrand == 0)
-                        {
-                            float t = (float)k / (float)subdivPerSegment;
-                            optimizedStrandArrays.UVs.push_back(splineUVs.interpolate(j, t));
-                        }
-                        tmpCount++;
-                    }
-                }
-
-                // Always keep the last vertex.
-                optimizedStrandArrays.UVs.push_back(splineUVs.interpolate(optimizedStrandArrays.vertexCount - 2, 1.f));
+                    resampledArrays.UVs[i] = splineUVs.interpolate(j, t);
+                });
             }
         }
 
@@ -171,8 +246,10 @@ namespace Falcor
             }
             else if (j == 1)
             {
+                // Strands with only two points have no next point.
+                uint32_t next = std::min(j + 1, (uint32_t)strandArrays.controlPoints.size() - 1);
                 prevFwd = normalize(strandArrays.controlPoints[j] - strandArrays.controlPoints[j - 1]);
-                fwd = normalize(strandArrays.controlPoints[j + 1] - strandArrays.controlPoints[j - 1]);
+                fwd = normalize(strandArrays.controlPoints[next] - strandArrays.controlPoints[j - 1]);
             }
             else if (j < strandArrays.controlPoints.size() - 2)
             {
@@ -191,46 +268,53 @@ namespace Falcor
             t = glm::rotate(rotQuat, t);
         }
 
-        void updateMeshResultBuffers(CurveTessellation::MeshResult& result, const CurveArrays& curveArrays, StrandArrays& optimizedStrandArrays, const float3& fwd, const float3& s, const float3& t, uint32_t pointCountPerCrossSection, const float& widthScale, uint32_t j)
+        void writeCrossSection(CurveTessellation::MeshResult& result, const StrandArrays& resampledArrays, const float3& fwd, const float3& s, const float3& t, uint32_t pointCountPerCrossSection, uint32_t meshVertexOffset, uint32_t j)
         {
             // Mesh vertices, normals, tangents, and texCrds (if any).
-            for (uint32_t k = 0; k < pointCountPerCrossSection; k++)
+            uint32_t vertexIndex = meshVertexOffset + j * pointCountPerCrossSection;
+            for (uint32_t k = 0; k < pointCountPerCrossSection; k++, vertexIndex++)
             {
                 float phi = (float)k / (float)pointCountPerCrossSection * (float)M_PI * 2.f;
                 float3 vNormal = std::cos(phi) * s + std::sin(phi) * t;
 
-                float curveRadius = 0.5f * optimizedStrandArrays.widths[j];
-                result.vertices.push_back(optimizedStrandArrays.controlPoints[j] + curveRadius * vNormal);
-                result.normals.push_back(vNormal);
-                result.tangents.push_back(float4(fwd.x, fwd.y, fwd.z, 1));
-                result.radii.push_back(curveRadius);
+                float curveRadius = 0.5f * resampledArrays.widths[j];
+                result.vertices[vertexIndex] = resampledArrays.controlPoints[j] + curveRadius * vNormal;
+                result.normals[vertexIndex] = vNormal;
+                result.tangents[vertexIndex] = float4(fwd.x, fwd.y, fwd.z, 1);
+                result.radii[vertexIndex] = curveRadius;
 
-                if (curveArrays.UVs)
+                if (!resampledArrays.UVs.empty())
                 {
-                    result.texCrds.push_back(optimizedStrandArrays.UVs[j]);
+                    result.texCrds[vertexIndex] = resampledArrays.UVs[j];
                 }
             }
         }
 
-        void connectFaceVertices(CurveTessellation::MeshResult& result, uint32_t meshVertexOffset, uint32_t pointCountPerCrossSection, uint32_t quadCountLimit, uint32_t nextCrossSectionVertexOffset, uint32_t multiplier, uint32_t j)
+        void connectCrossSections(CurveTessellation::MeshResult& result, uint32_t meshVertexOffset, uint32_t faceOffset, uint32_t pointCountPerCrossSection, uint32_t j)
         {
-            for (uint32_t k = 0; k < quadCountLimit; k++)
+            // Two triangles between each pair of neighboring points of cross-sections j and j + 1.
+            uint32_t* pIndices = result.faceVertexIndices.data() + 3 * (faceOffset + 2 * j * pointCountPerCrossSection);
+            uint32_t current = meshVertexOffset + j * pointCountPerCrossSection;
+            uint32_t next = current + pointCountPerCrossSection;
+            for (uint32_t k = 0; k < pointCountPerCrossSection; k++)
             {
-                result.faceVertexCounts.push_back(3);
-                result.faceVertexIndices.push_back(meshVertexOffset + multiplier * j * pointCountPerCrossSection + k);
-                result.faceVertexIndices.push_back(meshVertexOffset + multiplier * j * pointCountPerCrossSection + (k + nextCrossSectionVertexOffset) % pointCountPerCrossSection);
-                result.faceVertexIndices.push_back(meshVertexOffset + (multiplier * j + 1) * pointCountPerCrossSection + (k + nextCrossSectionVertexOffset) % pointCountPerCrossSection);
-
-                result.faceVertexCounts.push_back(3);
-                result.faceVertexIndices.push_back(meshVertexOffset + multiplier * j * pointCountPerCrossSection + k);
-                result.faceVertexIndices.push_back(meshVertexOffset + (multiplier * j + 1) * pointCountPerCrossSection + (k + nextCrossSectionVertexOffset) % pointCountPerCrossSection);
-                result.faceVertexIndices.push_back(meshVertexOffset + (multiplier * j + 1) * pointCountPerCrossSection + k);
+                uint32_t k1 = (k + 1) % pointCountPerCrossSection;
+
+                *pIndices++ = current + k;
+                *pIndices++ = current + k1;
+                *pIndices++ = next + k1;
+
+                *pIndices++ = current + k;
+                *pIndices++ = next + k1;
+                *pIndices++ = next + k;
             }
         }
     }
 
     CurveTessellation::SweptSphereResult CurveTessellation::convertToLinearSweptSphere(uint32_t strandCount, const uint32_t* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t degree, uint32_t subdivPerSegment, uint32_t keepOneEveryXStrands, uint32_t keepOneEveryXVerticesPerStrand, float widthScale, const rmcv::mat4& xform)
     {
+        FALCOR_PROFILE_CPU("CurveTessellation::convertToLinearSweptSphere");
+
         SweptSphereResult result;
 
         // Only support linear tube segments now.
@@ -238,168 +322,113 @@ namespace Falcor
         FALCOR_ASSERT(degree == 1);
         result.degree = degree;
 
-        uint32_t pointCounts = 0;
-        uint32_t segCounts = 0;
-        uint32_t maxVertexCountsPerStrand = 0;
-        for (uint32_t i = 0; i < strandCount; i += keepOneEveryXStrands)
-        {
-            uint32_t tmpPointCount = div_round_up(subdivPerSegment * (vertexCountsPerStrand[i] - 1), keepOneEveryXVerticesPerStrand) + 1;
-            pointCounts += tmpPointCount;
-            segCounts += tmpPointCount - 1;
-            maxVertexCountsPerStrand = std::max(maxVertexCountsPerStrand, vertexCountsPerStrand[i]);
-        }
-        result.indices.reserve(segCounts);
-        result.points.reserve(pointCounts);
-        result.radius.reserve(pointCounts);
-        result.texCrds.reserve(pointCounts);
-
-        uint32_t pointOffset = 0;
-
-        StrandArrays strandArrays;
-        strandArrays.controlPoints.reserve(maxVertexCountsPerStrand);
-        strandArrays.widths.reserve(maxVertexCountsPerStrand);
-        strandArrays.UVs.reserve(maxVertexCountsPerStrand);
-        CurveArrays curveArrays(controlPoints, widths, UVs);
-
-        StrandArrays optimizedStrandArrays;
-        CubicSplineCache splineCache;
-        for (uint32_t i = 0; i < strandCount; i += keepOneEveryXStrands)
-        {
-            optimizedStrandArrays.controlPoints.clear();
-            optimizedStrandArrays.UVs.clear();
-            optimizedStrandArrays.widths.clear();
-            optimizedStrandArrays.vertexCount = 0;
-            strandArrays.vertexCount = vertexCountsPerStrand[i];
-
-            optimizeStrandGeometry(splineCache, curveArrays, strandArrays, optimizedStrandArrays, pointOffset, subdivPerSegment, keepOneEveryXVerticesPerStrand, widthScale);
-
-            const CubicSpline<float3>& splinePoints = splineCache.splinePoints.setup(strandArrays.controlPoints.data(), optimizedStrandArrays.vertexCount);
-            const CubicSpline<float>& splineWidths = splineCache.splineWidths.setup(strandArrays.widths.data(), optimizedStrandArrays.vertexCount);
+        // Size the output exactly, then tessellate the strands in parallel directly into it.
+        const StrandLayout layout = computeStrandLayout(strandCount, vertexCountsPerStrand, controlPoints, subdivPerSegment, keepOneEveryXStrands, keepOneEveryXVerticesPerStrand);
+        const uint32_t pointCount = layout.sampleOffsets.back();
+        result.indices.resize(layout.segmentOffsets.back());
+        result.points.resize(pointCount);
+        result.radius.resize(pointCount);
+        if (UVs) result.texCrds.resize(pointCount);
 
-            uint32_t tmpCount = 0;
-            for (uint32_t j = 0; j < optimizedStrandArrays.vertexCount - 1; j++)
+        const CurveArrays curveArrays = { controlPoints, widths, UVs };
+        parallelForBlocks(layout.getStrandCount(), [&](size_t begin, size_t end)
+        {
+            StrandArrays strandArrays;
+            CubicSplineCache splineCache;
+            for (size_t i = begin; i < end; i++)
             {
-                for (uint32_t k = 0; k < subdivPerSegment; k++)
-                {
-                    if (tmpCount % keepOneEveryXVerticesPerStrand == 0)
-                    {
-                        float t = (float)k / (float)subdivPerSegment;
-                        result.indices.push_back((uint32_t)result.points.size());
+                const uint32_t sampleCount = layout.getSampleCount(i);
+                if (sampleCount == 0) continue;
 
-                        // Pre-transform curve points.
-                        float4 sph = transformSphere(xform, float4(splinePoints.interpolate(j, t), splineWidths.interpolate(j, t) * 0.5f * widthScale));
+                copyUniqueControlPoints(curveArrays, layout.inputOffsets[i], layout.inputCounts[i], strandArrays);
+                const uint32_t uniqueCount = layout.uniqueCounts[i];
+                const uint32_t pointOffset = layout.sampleOffsets[i];
+                const uint32_t segmentOffset = layout.segmentOffsets[i];
 
-                        result.points.push_back(sph.xyz);
-                        result.radius.push_back(sph.w);
-                    }
-                    tmpCount++;
-                }
-            }
+                const CubicSpline<float3>& splinePoints = splineCache.splinePoints.setup(strandArrays.controlPoints.data(), uniqueCount);
+                const CubicSpline<float>& splineWidths = splineCache.splineWidths.setup(strandArrays.widths.data(), uniqueCount);
+                forEachSample(sampleCount, uniqueCount, subdivPerSegment, keepOneEveryXVerticesPerStrand, [&](uint32_t k, uint32_t j, float t)
+                {
+                    // Pre-transform curve points.
+                    float4 sph = transformSphere(xform, float4(splinePoints.interpolate(j, t), splineWidths.interpolate(j, t) * 0.5f * widthScale));
+                    result.points[pointOffset + k] = sph.xyz;
+                    result.radius[pointOffset + k] = sph.w;
+                });
 
-            // Always keep the last vertex.
-            float4 sph = transformSphere(xform, float4(splinePoints.interpolate(optimizedStrandArrays.vertexCount - 2, 1.f), splineWidths.interpolate(optimizedStrandArrays.vertexCount - 2, 1.f) * 0.5f * widthScale));
-            result.points.push_back(sph.xyz);
-            result.radius.push_back(sph.w);
+                // Each segment starts at all but the last point of the strand.
+                for (uint32_t k = 0; k < sampleCount - 1; k++) result.indices[segmentOffset + k] = pointOffset + k;
 
-            // Texture coordinates.
-            if (UVs)
-            {
-                const CubicSpline<float2>& splineUVs = splineCache.splineUVs.setup(strandArrays.UVs.data(), optimizedStrandArrays.vertexCount);
-                tmpCount = 0;
-                for (uint32_t j = 0; j < optimizedStrandArrays.vertexCount - 1; j++)
+                // Texture coordinates.
+                if (UVs)
                 {
-                    for (uint32_t k = 0; k < subdivPerSegment; k++)
+                    const CubicSpline<float2>& splineUVs = splineCache.splineUVs.setup(strandArrays.UVs.data(), uniqueCount);
+                    forEachSample(sampleCount, uniqueCount, subdivPerSegment, keepOneEveryXVerticesPerStrand, [&](uint32_t k, uint32_t j, float t)
                     {
-                        if (tmpCount % keepOneEveryXVerticesPerStrand == 0)
-                        {
-                            float t = (float)k / (float)subdivPerSegment;
-                            result.texCrds.push_back(splineUVs.interpolate(j, t));
-                        }
-                        tmpCount++;
-                    }
+                        result.texCrds[pointOffset + k] = splineUVs.interpolate(j, t);
+                    });
                 }
-
-                // Always keep the last vertex.
-                result.texCrds.push_back(splineUVs.interpolate(optimizedStrandArrays.vertexCount - 2, 1.f));
             }
-
-            for (uint32_t j = i; j < std::min(strandCount, i + keepOneEveryXStrands); j++) pointOffset += vertexCountsPerStrand[j];
-        }
+        });
 
         return result;
     }
 
     CurveTessellation::MeshResult CurveTessellation::convertToPolytube(uint32_t strandCount, const uint32_t* vertexCountsPerStrand, const float3* controlPoints, const float* widths, const float2* UVs, uint32_t subdivPerSegment, uint32_t keepOneEveryXStrands, uint32_t keepOneEveryXVerticesPerStrand, float widthScale, uint32_t pointCountPerCrossSection)
     {
+        FALCOR_PROFILE_CPU("CurveTessellation::convertToPolytube");
+
         MeshResult result;
-        uint32_t vertexCounts = 0;
-        uint32_t faceCounts = 0;
-        uint32_t maxVertexCountsPerStrand = 0;
-        for (uint32_t i = 0; i < strandCount; i += keepOneEveryXStrands)
-        {
-            uint32_t tmpPointCount = div_round_up(subdivPerSegment * (vertexCountsPerStrand[i] - 1), keepOneEveryXVerticesPerStrand) + 1;
-            vertexCounts += pointCountPerCrossSection * tmpPointCount;
-            faceCounts += 2 * pointCountPerCrossSection * (tmpPointCount - 1);
-            maxVertexCountsPerStrand = std::max(maxVertexCountsPerStrand, vertexCountsPerStrand[i]);
-        }
-        result.vertices.reserve(vertexCounts);
-        result.normals.reserve(vertexCounts);
-        result.tangents.reserve(vertexCounts);
-        result.texCrds.reserve(vertexCounts);
-        result.radii.reserve(vertexCounts);
-        result.faceVertexCounts.reserve(faceCounts);
-        result.faceVertexIndices.reserve(faceCounts * 3);
-
-        uint32_t pointOffset = 0;
-        uint32_t meshVertexOffset = 0;
-
-        StrandArrays strandArrays;
-        strandArrays.controlPoints.reserve(maxVertexCountsPerStrand);
-        strandArrays.widths.reserve(maxVertexCountsPerStrand);
-        strandArrays.UVs.reserve(maxVertexCountsPerStrand);
-        CurveArrays curveArrays(controlPoints, widths, UVs);
-
-        StrandArrays optimizedStrandArrays;
-        CubicSplineCache splineCache;
-        for (uint32_t i = 0; i < strandCount; i += keepOneEveryXStrands)
-        {
-            optimizedStrandArrays.controlPoints.clear();
-            optimizedStrandArrays.UVs.clear();
-            optimizedStrandArrays.widths.clear();
-            optimizedStrandArrays.vertexCount = 0;
 
-            strandArrays.vertexCount = vertexCountsPerStrand[i];
+        // Size the output exactly, then tessellate the strands in parallel directly into it.
+        // Each sample becomes a cross-section of pointCountPerCrossSection vertices, each segment a ring of 2 * pointCountPerCrossSection triangles.
+        const StrandLayout layout = computeStrandLayout(strandCount, vertexCountsPerStrand, controlPoints, subdivPerSegment, keepOneEveryXStrands, keepOneEveryXVerticesPerStrand);
+        const uint32_t vertexCount = pointCountPerCrossSection * layout.sampleOffsets.back();
+        const uint32_t faceCount = 2 * pointCountPerCrossSection * layout.segmentOffsets.back();
+        result.vertices.resize(vertexCount);
+        result.normals.resize(vertexCount);
+        result.tangents.resize(vertexCount);
+        if (UVs) result.texCrds.resize(vertexCount);
+        result.radii.resize(vertexCount);
+        result.faceVertexCounts.assign(faceCount, 3);
+        result.faceVertexIndices.resize(3 * (size_t)faceCount);
+
+        const CurveArrays curveArrays = { controlPoints, widths, UVs };
+        parallelForBlocks(layout.getStrandCount(), [&](size_t begin, size_t end)
+        {
+            StrandArrays strandArrays;
+            StrandArrays resampledArrays;
+            CubicSplineCache splineCache;
+            for (size_t i = begin; i < end; i++)
+            {
+                const uint32_t sampleCount = layout.getSampleCount(i);
+                if (sampleCount == 0) continue;
 
-            optimizeStrandGeometry(splineCache, curveArrays, strandArrays, optimizedStrandArrays, pointOffset, subdivPerSegment, keepOneEveryXVerticesPerStrand, widthScale);
+                copyUniqueControlPoints(curveArrays, layout.inputOffsets[i], layout.inputCounts[i], strandArrays);
+                resampleStrand(splineCache, strandArrays, resampledArrays, sampleCount, subdivPerSegment, keepOneEveryXVerticesPerStrand, widthScale);
 
-            for (uint32_t j = i; j < std::min(strandCount, i + keepOneEveryXStrands); j++) pointOffset += vertexCountsPerStrand[j];
+                const uint32_t meshVertexOffset = pointCountPerCrossSection * layout.sampleOffsets[i];
+                const uint32_t faceOffset = 2 * pointCountPerCrossSection * layout.segmentOffsets[i];
 
-            // Build the initial frame.
-            float3 fwd, s, t;
-            fwd = normalize(optimizedStrandArrays.controlPoints[1] - optimizedStrandArrays.controlPoints[0]);
-            buildFrame(fwd, s, t);
+                // Build the initial frame.
+                float3 fwd, s, t;
+                fwd = normalize(resampledArrays.controlPoints[1] - resampledArrays.controlPoints[0]);
+                buildFrame(fwd, s, t);
 
-            // Create mesh.
-            for (uint32_t j = 0; j < optimizedStrandArrays.controlPoints.size(); j++)
-            {
-                // Update the curve's frame vectors: [fwd, s, t]
-                updateCurveFrame(optimizedStrandArrays, fwd, s, t, j);
+                // Create mesh.
+                for (uint32_t j = 0; j < sampleCount; j++)
+                {
+                    // Update the curve's frame vectors: [fwd, s, t]
+                    updateCurveFrame(resampledArrays, fwd, s, t, j);
 
-                // Mesh vertices, normals, tangents, and texCrds (if any).
-                updateMeshResultBuffers(result, curveArrays, optimizedStrandArrays, fwd, s, t, pointCountPerCrossSection, widthScale, j);
+                    // Mesh vertices, normals, tangents, and texCrds (if any).
+                    writeCrossSection(result, resampledArrays, fwd, s, t, pointCountPerCrossSection, meshVertexOffset, j);
 
-                // Mesh faces.
-                if (j < optimizedStrandArrays.controlPoints.size() - 1)
-                {
-                    uint32_t quadCountLimit = pointCountPerCrossSection;
-                    connectFaceVertices(result, meshVertexOffset, pointCountPerCrossSection, quadCountLimit, 1, 1, j);
+                    // Mesh faces.
+                    if (j < sampleCount - 1) connectCrossSections(result, meshVertexOffset, faceOffset, pointCountPerCrossSection, j);
                 }
             }
+        });
 
-            meshVertexOffset += pointCountPerCrossSection * (uint32_t)optimizedStrandArrays.controlPoints.size();
-        }
         return result;
     }
-
-
 }
@@ -48,6 +48,8 @@ namespace Falcor
         };
 
         /** Convert cubic B-splines to a couple of linear swept sphere segments.
+            Strands are tessellated in parallel into exactly sized outputs; the result does not depend on scheduling.
+            Strands with less than two distinct control points are skipped.
             \param[in] strandCount Number of curve strands.
             \param[in] vertexCountsPerStrand Number of control points per strand.
             \param[in] controlPoints Array of control points.
@@ -77,6 +79,8 @@ namespace Falcor
         };
 
         /** Tessellate cubic B-splines to a triangular mesh.
+            Strands are tessellated in parallel into exactly sized outputs; the result does not depend on scheduling.
+            Strands with less than two distinct control points are skipped.
             \param[in] strandCount Number of curve strands.
             \param[in] vertexCountsPerStrand Number of control points per strand.
             \param[in] controlPoints Array of control points.
@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "Importer.h"
 #include "Utils/Scripting/ScriptBindings.h"
+#include "Utils/Timing/CpuProfiler.h"
 
 namespace Falcor
 {
@@ -44,6 +45,8 @@ namespace Falcor
 
     void Importer::import(const std::filesystem::path& path, SceneBuilder& builder, const SceneBuilder::InstanceMatrices& instances, const Dictionary& dict)
     {
+        FALCOR_PROFILE_CPU("Importer::import");
+
         auto ext = getExtensionFromPath(path);
         auto it = sImportFunctions.find(ext);
         if (it == sImportFunctions.end())
@@ -212,6 +212,21 @@ namespace Falcor
         {
         }
 
+        BasicSceneBuilder::BasicSceneBuilder(const BasicSceneBuilder& parent, std::unique_ptr<BasicScene> pImportScene)
+            : mpImportScene(std::move(pImportScene))
+            , mScene(*mpImportScene)
+            , mInheritedMaterial(parent.mGraphicsState.currentMaterial)
+            , mCurrentBlock(parent.mCurrentBlock)
+            , mGraphicsState(parent.mGraphicsState)
+            , mNamedCoordinateSystems(parent.mNamedCoordinateSystems)
+        {
+            // Unnamed materials of the parent are not part of the staging scene.
+            if (std::holds_alternative<uint32_t>(mGraphicsState.currentMaterial))
+            {
+                mGraphicsState.currentMaterial = kInheritedMaterialIndex;
+            }
+        }
+
         void BasicSceneBuilder::onReverseOrientation(FileLoc loc)
         {
             VERIFY_WORLD("ReverseOrientation");
@@ -462,6 +477,82 @@ namespace Falcor
             mScene.addInstances(mInstances);
         }
 
+        std::unique_ptr<ParserTarget> BasicSceneBuilder::createImportTarget(FileLoc loc)
+        {
+            VERIFY_WORLD("Import");
+
+            if (mpActiveInstanceDefinition)
+            {
+                throwError(loc, "Import can't be called inside instance definition.");
+            }
+
+            return std::unique_ptr<ParserTarget>(new BasicSceneBuilder(*this, std::make_unique<BasicScene>(mScene.mSearchPath)));
+        }
+
+        void BasicSceneBuilder::mergeImportTarget(ParserTarget& importTarget, FileLoc loc)
+        {
+            auto& imported = dynamic_cast<BasicSceneBuilder&>(importTarget);
+            FALCOR_ASSERT(imported.mpImportScene);
+            BasicScene& importScene = *imported.mpImportScene;
+
+            // Ensure there are no pushed graphics states. This also covers unterminated instance definitions.
+            if (!imported.mStack.empty())
+            {
+                throwError(loc, "Missing end to AttributeBegin in imported file.");
+            }
+
+            // Issue error if names defined in the imported file are already used.
+            auto mergeNames = [&loc](std::set<std::string>& names, const std::set<std::string>& importedNames, const char* type)
+            {
+                for (const auto& name : importedNames)
+                {
+                    if (!names.insert(name).second) throwError(loc, "Imported file is redefining {} '{}'.", type, name);
+                }
+            };
+            mergeNames(mNamedMaterialNames, imported.mNamedMaterialNames, "named material");
+            mergeNames(mMediumNames, imported.mMediumNames, "named medium");
+            mergeNames(mFloatTextureNames, imported.mFloatTextureNames, "texture");
+            mergeNames(mSpectrumTextureNames, imported.mSpectrumTextureNames, "texture");
+            mergeNames(mInstanceNames, imported.mInstanceNames, "object instance");
+
+            // Append unnamed materials and area lights and remap the shape references to them.
+            const uint32_t materialOffset = (uint32_t)mScene.mMaterials.size();
+            const int areaLightOffset = (int)mScene.mAreaLights.size();
+
+            for (auto& material : importScene.mMaterials)
+            {
+                material.name = fmt::format("Unnamed{}", mUnamedMaterialIndex++);
+                mScene.mMaterials.push_back(std::move(material));
+            }
+            std::move(importScene.mAreaLights.begin(), importScene.mAreaLights.end(), std::back_inserter(mScene.mAreaLights));
+
+            auto remapShape = [&](ShapeSceneEntity& shape)
+            {
+                if (uint32_t* pIndex = std::get_if<uint32_t>(&shape.materialRef))
+                {
+                    if (*pIndex == kInheritedMaterialIndex) shape.materialRef = imported.mInheritedMaterial;
+                    else *pIndex += materialOffset;
+                }
+                if (shape.lightIndex >= 0) shape.lightIndex += areaLightOffset;
+            };
+
+            for (auto& shape : imported.mShapes) remapShape(shape);
+            for (auto& [name, instanceDefinition] : importScene.mInstanceDefinitions)
+            {
+                for (auto& shape : instanceDefinition.shapes) remapShape(shape);
+                mScene.mInstanceDefinitions.emplace(name, std::move(instanceDefinition));
+            }
+
+            mScene.mNamedMaterials.merge(importScene.mNamedMaterials);
+            mScene.mFloatTextures.merge(importScene.mFloatTextures);
+            mScene.mSpectrumTextures.merge(importScene.mSpectrumTextures);
+            std::move(importScene.mMedia.begin(), importScene.mMedia.end(), std::back_inserter(mScene.mMedia));
+            std::move(importScene.mLights.begin(), importScene.mLights.end(), std::back_inserter(mScene.mLights));
+
+            std::move(imported.mShapes.begin(), imported.mShapes.end(), std::back_inserter(mShapes));
+            std::move(imported.mInstances.begin(), imported.mInstances.end(), std::back_inserter(mInstances));
+        }
+
         void BasicSceneBuilder::onOption(const std::string& name, const std::string& value, FileLoc loc)
         {
             // Options:
@@ -290,6 +290,8 @@ namespace Falcor
 
             std::map<std::string, InstanceDefinitionSceneEntity> mInstanceDefinitions;
             std::vector<InstanceSceneEntity> mInstances;
+
+            friend class BasicSceneBuilder;
         };
 
         constexpr uint32_t kMaxTransforms = 2;
@@ -384,9 +386,21 @@ namespace Falcor
 
             void onEndOfFiles() override;
 
+            std::unique_ptr<ParserTarget> createImportTarget(FileLoc loc) override;
+            void mergeImportTarget(ParserTarget& importTarget, FileLoc loc) override;
+
         private:
+            /** Create a builder for an imported file. Entities are staged in a separate scene until merged into the parent.
+            */
+            BasicSceneBuilder(const BasicSceneBuilder& parent, std::unique_ptr<BasicScene> pImportScene);
+
             rmcv::mat4 getTransform() const { return mGraphicsState.ctm[0]; }
 
+            /** Unnamed material index used by import builders to reference the current material of the parent builder.
+                All other unnamed material indices of an import builder reference its staging scene.
+            */
+            static constexpr uint32_t kInheritedMaterialIndex = ~0u;
+
             static constexpr int kStartTransformBits = 1 << 0;
             static constexpr int kEndTransformBits = 1 << 1;
             static constexpr int kAllTransformsBits = (1 << kMaxTransforms) - 1;
@@ -422,7 +436,9 @@ namespace Falcor
                 Float transformStartTime = 0, transformEndTime = 1;
             };
 
+            std::unique_ptr<BasicScene> mpImportScene;  ///< Staging scene owned by import builders. Must be declared before mScene.
             BasicScene& mScene;
+            MaterialRef mInheritedMaterial;             ///< Current material of the parent builder when the import started.
 
             enum class BlockState { OptionsBlock, WorldBlock };
             BlockState mCurrentBlock = BlockState::OptionsBlock;
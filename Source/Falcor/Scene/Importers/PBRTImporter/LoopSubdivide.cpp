@@ -32,14 +32,15 @@
 // SPDX: Apache-2.0
 
 #include "LoopSubdivide.h"
-#include "Core/Assert.h"
 #include "Core/Errors.h"
+#include "Utils/NumericRange.h"
+#include "Utils/Math/Common.h"
+#include "Utils/Timing/CpuProfiler.h"
 
 #include <algorithm>
-#include <map>
-#include <memory>
-#include <memory_resource>
-#include <set>
+#include <execution>
+#include <limits>
+#include <numeric>
 
 #include <cmath>
 
@@ -47,482 +48,528 @@ namespace Falcor
 {
     namespace pbrt
     {
-        struct SDFace;
-        struct SDVertex;
-
         #define NEXT(i) (((i) + 1) % 3)
         #define PREV(i) (((i) + 2) % 3)
 
-        struct SDVertex
+        namespace
         {
-            SDVertex(const float3& p = float3(0.f)) : p(p) {}
-
-            int valence();
-            void oneRing(float3 *p);
-
-            float3 p;
-            SDFace* startFace = nullptr;
-            SDVertex* child = nullptr;
-            bool regular = false;
-            bool boundary = false;
-        };
+            const uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+            const size_t kBlockSize = 1 << 12;  ///< Number of vertices or faces processed per parallel task.
 
-        struct SDFace
-        {
-            SDFace()
+            enum VertexFlags : uint8_t
             {
-                for (uint32_t i = 0; i < 3; ++i)
-                {
-                    v[i] = nullptr;
-                    f[i] = nullptr;
-                }
-                for (uint32_t i = 0; i < 4; ++i)
-                {
-                    children[i] = nullptr;
-                }
-            }
-
-            uint32_t vnum(SDVertex* vert) const
+                kBoundary = 0x1,
+                kRegular = 0x2,
+            };
+
+            /** Run a function for all blocks of kBlockSize indices in [0, count) in parallel.
+                The function is called with the index range [begin, end) of a block.
+                Exceptions are captured and the one of the lowest block is rethrown, matching the behavior of a serial loop.
+            */
+            template<typename F>
+            void parallelForBlocks(size_t count, F func)
             {
-                for (int i = 0; i < 3; ++i)
+                size_t blockCount = div_round_up(count, kBlockSize);
+                std::vector<std::exception_ptr> exceptions(blockCount);
+                auto range = NumericRange<size_t>(0, blockCount);
+                std::for_each(std::execution::par, range.begin(), range.end(), [&](size_t block)
                 {
-                    if (v[i] == vert) return i;
-                }
-                throw RuntimeError("Basic logic error in SDFace::vnum().");
-            }
+                    try
+                    {
+                        func(block * kBlockSize, std::min(count, (block + 1) * kBlockSize));
+                    }
+                    catch (...)
+                    {
+                        exceptions[block] = std::current_exception();
+                    }
+                });
 
-            SDFace* nextFace(SDVertex* vert) const { return f[vnum(vert)]; }
-            SDFace* prevFace(SDVertex* vert) const { return f[PREV(vnum(vert))]; }
-            SDVertex* nextVert(SDVertex* vert) const { return v[NEXT(vnum(vert))]; }
-            SDVertex* prevVert(SDVertex* vert) const { return v[PREV(vnum(vert))]; }
-            SDVertex* otherVert(SDVertex* v0, SDVertex* v1)
-            {
-                for (uint32_t i = 0; i < 3; ++i)
+                for (const auto& pException : exceptions)
                 {
-                    if (v[i] != v0 && v[i] != v1) return v[i];
+                    if (pException) std::rethrow_exception(pException);
                 }
-                throw RuntimeError("Basic logic error in SDFace::otherVert()");
-            }
-
-            SDVertex* v[3];
-            SDFace* f[3];
-            SDFace* children[4];
-        };
-
-        struct SDEdge
-        {
-            SDEdge(SDVertex* v0 = nullptr, SDVertex* v1 = nullptr)
-            {
-                v[0] = std::min(v0, v1);
-                v[1] = std::max(v0, v1);
-                f[0] = f[1] = nullptr;
-                f0edgeNum = -1;
             }
 
-            bool operator<(const SDEdge &e2) const
+            /** One level of the subdivision mesh stored in flat arrays.
+                Face i has vertices faceVertices[3 * i + k] and neighbors faceNeighbors[3 * i + k], where neighbor k is
+                across the edge from vertex k to vertex NEXT(k). We call 3 * i + k a half-edge of face i.
+                The four children of face i in the next level are faces 4 * i + k. The children of the vertices of a level
+                keep their index in the next level, new edge vertices are appended after them.
+            */
+            struct SubdivLevel
             {
-                if (v[0] == e2.v[0]) return v[1] < e2.v[1];
-                return v[0] < e2.v[0];
-            }
-
-            SDVertex* v[2];
-            SDFace* f[2];
-            int f0edgeNum;
-        };
-
-        static float3 weightOneRing(SDVertex* vert, float beta);
-        static float3 weightBoundary(SDVertex* vert, float beta);
-
-        inline int SDVertex::valence()
-        {
-            SDFace* f = startFace;
-            if (!boundary)
-            {
-                // Compute valence of interior vertex.
-                int nf = 1;
-                while ((f = f->nextFace(this)) != startFace) ++nf;
-                return nf;
-            }
-            else
-            {
-                // Compute valence of boundary vertex
-                int nf = 1;
-                while ((f = f->nextFace(this)) != nullptr) ++nf;
-                f = startFace;
-                while ((f = f->prevFace(this)) != nullptr) ++nf;
-                return nf + 1;
-            }
-        }
+                std::vector<float3> positions;
+                std::vector<uint32_t> startFaces;   ///< Face adjacent to each vertex, used as start of the one-ring traversal.
+                std::vector<uint8_t> vertexFlags;   ///< Combination of VertexFlags for each vertex.
+                std::vector<uint32_t> faceVertices;
+                std::vector<uint32_t> faceNeighbors;
 
-        inline float beta(uint32_t valence)
-        {
-            if (valence == 3)
-                return 3.f / 16.f;
-            else
-                return 3.f / (8.f * valence);
-        }
-
-        inline float loopGamma(uint32_t valence)
-        {
-            return 1.f / (valence + 3.f / (8.f * beta(valence)));
-        }
-
-        LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> positions, fstd::span<const uint32_t> indices)
-        {
-            std::vector<SDVertex*> vertices;
-            std::vector<SDFace*> faces;
-
-            // Allocate vertices and faces.
-            std::unique_ptr<SDVertex[]> verts = std::make_unique<SDVertex[]>(positions.size());
-            for (size_t i = 0; i < positions.size(); ++i)
-            {
-                verts[i] = SDVertex(positions[i]);
-                vertices.push_back(&verts[i]);
-            }
-            size_t faceCount = indices.size() / 3;
-            std::unique_ptr<SDFace[]> fs = std::make_unique<SDFace[]>(faceCount);
-            for (size_t i = 0; i < faceCount; ++i)
-            {
-                faces.push_back(&fs[i]);
-            }
+                uint32_t getVertexCount() const { return (uint32_t)positions.size(); }
+                uint32_t getFaceCount() const { return (uint32_t)(faceVertices.size() / 3); }
 
-            // Set face to vertex pointers.
-            const uint32_t* vp = indices.data();
-            for (size_t i = 0; i < faceCount; ++i, vp += 3)
-            {
-                SDFace* f = faces[i];
-                for (uint32_t j = 0; j < 3; ++j)
+                void resize(size_t vertexCount, size_t faceCount)
                 {
-                    SDVertex* v = vertices[vp[j]];
-                    f->v[j] = v;
-                    v->startFace = f;
+                    positions.resize(vertexCount);
+                    startFaces.resize(vertexCount);
+                    vertexFlags.resize(vertexCount);
+                    faceVertices.resize(3 * faceCount);
+                    faceNeighbors.resize(3 * faceCount);
                 }
-            }
 
-            // Set neighbor pointers in faces.
-            std::set<SDEdge> edges;
-            for (size_t i = 0; i < faceCount; ++i)
-            {
-                SDFace* f = faces[i];
-                for (uint32_t edgeNum = 0; edgeNum < 3; ++edgeNum)
+                bool isBoundary(uint32_t vert) const { return (vertexFlags[vert] & kBoundary) != 0; }
+                bool isRegular(uint32_t vert) const { return (vertexFlags[vert] & kRegular) != 0; }
+
+                uint32_t vnum(uint32_t face, uint32_t vert) const
                 {
-                    // Update neighbor pointer for edgeNum.
-                    int v0 = edgeNum, v1 = NEXT(edgeNum);
-                    SDEdge e(f->v[v0], f->v[v1]);
-                    if (edges.find(e) == edges.end())
+                    if (face == kInvalidIndex) throw RuntimeError("Inconsistent mesh topology in loop subdivision.");
+                    const uint32_t* v = &faceVertices[3 * face];
+                    for (uint32_t i = 0; i < 3; ++i)
                     {
-                        // Handle new edge.
-                        e.f[0] = f;
-                        e.f0edgeNum = edgeNum;
-                        edges.insert(e);
-                    }
-                    else
-                    {
-                        // Handle previously seen edge.
-                        e =* edges.find(e);
-                        e.f[0]->f[e.f0edgeNum] = f;
-                        f->f[edgeNum] = e.f[0];
-                        edges.erase(e);
+                        if (v[i] == vert) return i;
                     }
+                    throw RuntimeError("Basic logic error in SubdivLevel::vnum().");
                 }
-            }
 
-            // Finish vertex initialization.
-            for (size_t i = 0; i < positions.size(); ++i)
-            {
-                SDVertex* v = vertices[i];
-                SDFace* f = v->startFace;
-                do
-                {
-                    f = f->nextFace(v);
-                } while ((f != nullptr) && f != v->startFace);
-                v->boundary = (f == nullptr);
-                if (!v->boundary && v->valence() == 6) v->regular = true;
-                else if (v->boundary && v->valence() == 4) v->regular = true;
-                else v->regular = false;
-            }
-
-            // Refine LoopSubdiv into triangles.
-            std::vector<SDFace*> f = faces;
-            std::vector<SDVertex*> v = vertices;
-
-            std::pmr::monotonic_buffer_resource buffer;
-            std::pmr::polymorphic_allocator<SDVertex> vertexAllocator(&buffer);
-            std::pmr::polymorphic_allocator<SDFace> faceAllocator(&buffer);
-
-            for (size_t i = 0; i < levels; ++i)
-            {
-                // Update f and v for next level of subdivision.
-                std::vector<SDFace*> newFaces;
-                std::vector<SDVertex*> newVertices;
-
-                // Allocate next level of children in mesh tree.
-                for (SDVertex* vertex : v)
-                {
-                    vertex->child = vertexAllocator.allocate(1);
-                    vertex->child->regular = vertex->regular;
-                    vertex->child->boundary = vertex->boundary;
-                    newVertices.push_back(vertex->child);
-                }
-                for (SDFace* face : f)
+                uint32_t nextFace(uint32_t face, uint32_t vert) const { return faceNeighbors[3 * face + vnum(face, vert)]; }
+                uint32_t prevFace(uint32_t face, uint32_t vert) const { return faceNeighbors[3 * face + PREV(vnum(face, vert))]; }
+                uint32_t nextVert(uint32_t face, uint32_t vert) const { return faceVertices[3 * face + NEXT(vnum(face, vert))]; }
+                uint32_t prevVert(uint32_t face, uint32_t vert) const { return faceVertices[3 * face + PREV(vnum(face, vert))]; }
+                uint32_t otherVert(uint32_t face, uint32_t v0, uint32_t v1) const
                 {
-                    for (uint32_t k = 0; k < 4; ++k)
+                    const uint32_t* v = &faceVertices[3 * face];
+                    for (uint32_t i = 0; i < 3; ++i)
                     {
-                        face->children[k] = faceAllocator.allocate(1);
-                        newFaces.push_back(face->children[k]);
+                        if (v[i] != v0 && v[i] != v1) return v[i];
                     }
+                    throw RuntimeError("Basic logic error in SubdivLevel::otherVert().");
                 }
 
-                // Update vertex positions and create new edge vertices.
-
-                // Update vertex positions for even vertices.
-                for (SDVertex* vertex : v)
+                uint32_t valence(uint32_t vert) const
                 {
-                    if (!vertex->boundary)
+                    uint32_t startFace = startFaces[vert];
+                    uint32_t f = startFace;
+                    if (!isBoundary(vert))
                     {
-                        // Apply one-ring rule for even vertex.
-                        if (vertex->regular) vertex->child->p = weightOneRing(vertex, 1.f / 16.f);
-                        else vertex->child->p = weightOneRing(vertex, beta(vertex->valence()));
+                        // Compute valence of interior vertex.
+                        uint32_t nf = 1;
+                        while ((f = nextFace(f, vert)) != startFace) ++nf;
+                        return nf;
                     }
                     else
                     {
-                        // Apply boundary rule for even vertex.
-                        vertex->child->p = weightBoundary(vertex, 1.f / 8.f);
+                        // Compute valence of boundary vertex.
+                        uint32_t nf = 1;
+                        while ((f = nextFace(f, vert)) != kInvalidIndex) ++nf;
+                        f = startFace;
+                        while ((f = prevFace(f, vert)) != kInvalidIndex) ++nf;
+                        return nf + 1;
                     }
                 }
 
-                // Compute new odd edge vertices.
-                std::map<SDEdge, SDVertex*> edgeVerts;
-                for (SDFace* face : f)
+                /** Call a function for the positions of the one-ring vertices in order.
+                    Interior vertices are visited starting at the start face, boundary vertices from one boundary edge to the other.
+                */
+                template<typename F>
+                void forEachOneRing(uint32_t vert, F func) const
                 {
-                    for (uint32_t k = 0; k < 3; ++k)
+                    uint32_t startFace = startFaces[vert];
+                    uint32_t face = startFace;
+                    if (!isBoundary(vert))
                     {
-                        // Compute odd vertex on kth edge.
-                        SDEdge edge(face->v[k], face->v[NEXT(k)]);
-                        SDVertex* vert = edgeVerts[edge];
-                        if (vert == nullptr)
+                        // Get one-ring vertices for interior vertex.
+                        do
                         {
-                            // Create and initialize new odd vertex
-                            vert = vertexAllocator.allocate(1);
-                            newVertices.push_back(vert);
-                            vert->regular = true;
-                            vert->boundary = (face->f[k] == nullptr);
-                            vert->startFace = face->children[3];
-
-                            // Apply edge rules to compute new vertex position
-                            if (vert->boundary)
-                            {
-                                vert->p = 0.5f * edge.v[0]->p;
-                                vert->p += 0.5f * edge.v[1]->p;
-                            }
-                            else
-                            {
-                                vert->p = 3.f / 8.f * edge.v[0]->p;
-                                vert->p += 3.f / 8.f * edge.v[1]->p;
-                                vert->p += 1.f / 8.f * face->otherVert(edge.v[0], edge.v[1])->p;
-                                vert->p += 1.f / 8.f * face->f[k]->otherVert(edge.v[0], edge.v[1])->p;
-                            }
-                            edgeVerts[edge] = vert;
+                            func(positions[nextVert(face, vert)]);
+                            face = nextFace(face, vert);
+                        } while (face != startFace);
+                    }
+                    else
+                    {
+                        // Get one-ring vertices for boundary vertex.
+                        uint32_t f2;
+                        while ((f2 = nextFace(face, vert)) != kInvalidIndex)
+                        {
+                            face = f2;
                         }
+                        func(positions[nextVert(face, vert)]);
+                        do
+                        {
+                            func(positions[prevVert(face, vert)]);
+                            face = prevFace(face, vert);
+                        } while (face != kInvalidIndex);
                     }
                 }
 
-                // Update new mesh topology.
+                void oneRing(uint32_t vert, std::vector<float3>& ring) const
+                {
+                    ring.clear();
+                    forEachOneRing(vert, [&](const float3& p) { ring.push_back(p); });
+                }
+            };
+
+            /** Half-edges of a level bucketed by their lower vertex index in CSR layout.
+                Within a bucket half-edges are sorted by their upper vertex index and then by their own index,
+                so half-edges connecting the same two vertices are adjacent and ordered as a serial loop over the faces visits them.
+            */
+            struct EdgeTable
+            {
+                std::vector<uint32_t> offsets;
+                std::vector<uint32_t> halfEdges;
+
+                static uint32_t lowerVertex(const SubdivLevel& level, uint32_t halfEdge)
+                {
+                    uint32_t face = halfEdge / 3;
+                    return std::min(level.faceVertices[halfEdge], level.faceVertices[3 * face + NEXT(halfEdge % 3)]);
+                }
 
-                // Update even vertex face pointers.
-                for (SDVertex* vertex : v)
+                static uint32_t upperVertex(const SubdivLevel& level, uint32_t halfEdge)
                 {
-                    int vertNum = vertex->startFace->vnum(vertex);
-                    vertex->child->startFace = vertex->startFace->children[vertNum];
+                    uint32_t face = halfEdge / 3;
+                    return std::max(level.faceVertices[halfEdge], level.faceVertices[3 * face + NEXT(halfEdge % 3)]);
                 }
 
-                // Update face neighbor pointers.
-                for (SDFace* face : f)
+                void build(const SubdivLevel& level)
                 {
-                    for (uint32_t j = 0; j < 3; ++j)
+                    FALCOR_PROFILE_CPU("EdgeTable::build");
+
+                    // Counting sort of the half-edges by lower vertex. The scatter advances offsets to the end of each bucket.
+                    uint32_t halfEdgeCount = (uint32_t)level.faceVertices.size();
+                    offsets.assign(level.getVertexCount() + 1, 0);
+                    for (uint32_t i = 0; i < halfEdgeCount; ++i) ++offsets[lowerVertex(level, i) + 1];
+                    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+                    halfEdges.resize(halfEdgeCount);
+                    for (uint32_t i = 0; i < halfEdgeCount; ++i) halfEdges[offsets[lowerVertex(level, i)]++] = i;
+                    std::copy_backward(offsets.begin(), offsets.end() - 1, offsets.end());
+                    offsets[0] = 0;
+
+                    parallelForBlocks(level.getVertexCount(), [&](size_t begin, size_t end)
                     {
-                        // Update children f pointers for siblings.
-                        face->children[3]->f[j] = face->children[NEXT(j)];
-                        face->children[j]->f[NEXT(j)] = face->children[3];
-
-                        // Update children f pointers for neighbor children.
-                        SDFace* f2 = face->f[j];
-                        face->children[j]->f[j] = f2 != nullptr ? f2->children[f2->vnum(face->v[j])] : nullptr;
-                        f2 = face->f[PREV(j)];
-                        face->children[j]->f[PREV(j)] = f2 != nullptr ? f2->children[f2->vnum(face->v[j])] : nullptr;
-                    }
+                        for (size_t vert = begin; vert < end; ++vert)
+                        {
+                            std::sort(halfEdges.begin() + offsets[vert], halfEdges.begin() + offsets[vert + 1], [&](uint32_t a, uint32_t b)
+                            {
+                                uint32_t va = upperVertex(level, a);
+                                uint32_t vb = upperVertex(level, b);
+                                return va != vb ? va < vb : a < b;
+                            });
+                        }
+                    });
                 }
 
-                // Update face vertex pointers.
-                for (SDFace* face : f)
+                /** Call a function in parallel for all groups of half-edges connecting the same two vertices.
+                    The function is called with a pointer to the sorted half-edge indices of the group and their count.
+                */
+                template<typename F>
+                void forEachEdge(const SubdivLevel& level, F func) const
                 {
-                    for (uint32_t j = 0; j < 3; ++j)
+                    parallelForBlocks(level.getVertexCount(), [&](size_t begin, size_t end)
                     {
-                        // Update child vertex pointer to new even vertex
-                        face->children[j]->v[j] = face->v[j]->child;
-
-                        // Update child vertex pointer to new odd vertex
-                        SDVertex *vert = edgeVerts[SDEdge(face->v[j], face->v[NEXT(j)])];
-                        face->children[j]->v[NEXT(j)] = vert;
-                        face->children[NEXT(j)]->v[j] = vert;
-                        face->children[3]->v[j] = vert;
-                    }
+                        for (uint32_t i = offsets[begin]; i < offsets[end];)
+                        {
+                            uint32_t upper = upperVertex(level, halfEdges[i]);
+                            uint32_t groupEnd = i + 1;
+                            while (groupEnd < offsets[end] && lowerVertex(level, halfEdges[groupEnd]) == lowerVertex(level, halfEdges[i]) && upperVertex(level, halfEdges[groupEnd]) == upper) ++groupEnd;
+                            func(&halfEdges[i], groupEnd - i);
+                            i = groupEnd;
+                        }
+                    });
                 }
+            };
 
-                // Prepare for next level of subdivision
-                f = newFaces;
-                v = newVertices;
+            float3 weightOneRing(const SubdivLevel& level, uint32_t vert, float beta)
+            {
+                uint32_t valence = level.valence(vert);
+                float3 p = (1 - valence * beta) * level.positions[vert];
+                level.forEachOneRing(vert, [&](const float3& q) { p += beta * q; });
+                return p;
             }
 
-            // Push vertices to limit surface.
-            std::vector<float3> pLimit(v.size());
-            for (size_t i = 0; i < v.size(); ++i)
+            float3 weightBoundary(const SubdivLevel& level, uint32_t vert, float beta)
             {
-                if (v[i]->boundary) pLimit[i] = weightBoundary(v[i], 1.f / 5.f);
-                else pLimit[i] = weightOneRing(v[i], loopGamma(v[i]->valence()));
+                // Only the first and last vertices of the one-ring contribute.
+                float3 first, last;
+                bool isFirst = true;
+                level.forEachOneRing(vert, [&](const float3& q)
+                {
+                    if (isFirst) first = q;
+                    last = q;
+                    isFirst = false;
+                });
+                float3 p = (1 - 2 * beta) * level.positions[vert];
+                p += beta * first;
+                p += beta * last;
+                return p;
             }
-            for (size_t i = 0; i < v.size(); ++i)
+
+            inline float beta(uint32_t valence)
             {
-                v[i]->p = pLimit[i];
+                if (valence == 3)
+                    return 3.f / 16.f;
+                else
+                    return 3.f / (8.f * valence);
             }
 
-            // Compute vertex tangents on limit surface.
-            std::vector<float3> Ns;
-            Ns.reserve(v.size());
-            std::vector<float3> pRing(16, float3());
-            for (SDVertex* vertex : v)
+            inline float loopGamma(uint32_t valence)
             {
-                float3 S(0.f);
-                float3 T(0.f);
-                uint32_t valence = vertex->valence();
-                if (valence > pRing.size()) pRing.resize(valence);
-                vertex->oneRing(&pRing[0]);
-                if (!vertex->boundary)
+                return 1.f / (valence + 3.f / (8.f * beta(valence)));
+            }
+
+            SubdivLevel createBaseLevel(fstd::span<const float3> positions, fstd::span<const uint32_t> indices)
+            {
+                SubdivLevel level;
+                size_t faceCount = indices.size() / 3;
+                if (positions.size() >= kInvalidIndex || indices.size() >= kInvalidIndex) throw RuntimeError("Mesh is too large for loop subdivision.");
+                level.resize(positions.size(), faceCount);
+                std::copy(positions.begin(), positions.end(), level.positions.begin());
+                std::copy(indices.begin(), indices.begin() + 3 * faceCount, level.faceVertices.begin());
+
+                // Set vertex to face indices. The last face referencing a vertex is its start face.
+                std::fill(level.startFaces.begin(), level.startFaces.end(), kInvalidIndex);
+                for (uint32_t i = 0; i < 3 * faceCount; ++i)
                 {
-                    // Compute tangents of interior face
-                    for (uint32_t j = 0; j < valence; ++j)
-                    {
-                        S += std::cos(2.f * float(M_PI) * j / valence) * float3(pRing[j]);
-                        T += std::sin(2.f * float(M_PI) * j / valence) * float3(pRing[j]);
-                    }
+                    uint32_t vert = level.faceVertices[i];
+                    if (vert >= positions.size()) throw RuntimeError("Vertex index {} is out of range.", vert);
+                    level.startFaces[vert] = i / 3;
                 }
-                else
+                for (uint32_t i = 0; i < level.getVertexCount(); ++i)
                 {
-                    // Compute tangents of boundary face
-                    S = pRing[valence - 1] - pRing[0];
-                    if (valence == 2)
-                    {
-                        T = float3(pRing[0] + pRing[1] - 2.f * vertex->p);
-                    }
-                    else if (valence == 3)
-                    {
-                        T = pRing[1] - vertex->p;
-                    }
-                    else if (valence == 4) // regular
+                    if (level.startFaces[i] == kInvalidIndex) throw RuntimeError("Vertex {} is not referenced by any face.", i);
+                }
+
+                // Set neighbor indices in faces. Half-edges connecting the same vertices are paired up in face order.
+                std::fill(level.faceNeighbors.begin(), level.faceNeighbors.end(), kInvalidIndex);
+                EdgeTable edges;
+                edges.build(level);
+                edges.forEachEdge(level, [&](const uint32_t* pHalfEdges, uint32_t count)
+                {
+                    for (uint32_t i = 0; i + 1 < count; i += 2)
                     {
-                        T = float3(-1.f * pRing[0] + 2.f * pRing[1] + 2.f * pRing[2] + -1.f * pRing[3] + -2.f * vertex->p);
+                        level.faceNeighbors[pHalfEdges[i]] = pHalfEdges[i + 1] / 3;
+                        level.faceNeighbors[pHalfEdges[i + 1]] = pHalfEdges[i] / 3;
                     }
-                    else
+                });
+
+                // Finish vertex initialization.
+                parallelForBlocks(level.getVertexCount(), [&](size_t begin, size_t end)
+                {
+                    for (uint32_t vert = (uint32_t)begin; vert < end; ++vert)
                     {
-                        float theta = float(M_PI) / float(valence - 1);
-                        T = float3(std::sin(theta) * (pRing[0] + pRing[valence - 1]));
-                        for (uint32_t k = 1; k < valence - 1; ++k)
+                        uint32_t startFace = level.startFaces[vert];
+                        uint32_t f = startFace;
+                        do
                         {
-                            float wt = (2 * std::cos(theta) - 2) * std::sin((k)*theta);
-                            T += float3(wt * pRing[k]);
-                        }
-                        T = -T;
+                            f = level.nextFace(f, vert);
+                        } while (f != kInvalidIndex && f != startFace);
+                        bool boundary = f == kInvalidIndex;
+                        level.vertexFlags[vert] = boundary ? kBoundary : 0;
+                        uint32_t valence = level.valence(vert);
+                        if ((!boundary && valence == 6) || (boundary && valence == 4)) level.vertexFlags[vert] |= kRegular;
                     }
-                }
-                Ns.push_back(cross(S, T));
+                });
+
+                return level;
             }
 
-            // Create triangle mesh from subdivision mesh
+            /** Subdivide a level into the next level.
+                \param[in] level Level to subdivide.
+                \param[out] next Next level. Its storage is reused.
+            */
+            void subdivideLevel(const SubdivLevel& level, SubdivLevel& next)
             {
-                size_t ntris = f.size();
-                std::vector<uint32_t> verts(3 * ntris);
-                uint32_t *vp = verts.data();
-                uint32_t totVerts = (uint32_t)v.size();
-                std::map<SDVertex*, uint32_t> usedVerts;
-                for (uint32_t i = 0; i < totVerts; ++i)
+                FALCOR_PROFILE_CPU("subdivideLevel");
+
+                uint32_t vertexCount = level.getVertexCount();
+                uint32_t faceCount = level.getFaceCount();
+                if (12 * (uint64_t)faceCount >= kInvalidIndex) throw RuntimeError("Subdivided mesh is too large.");
+
+                // Assign new odd vertices to edges. Each edge vertex is owned by the first half-edge visiting the edge.
+                EdgeTable edges;
+                edges.build(level);
+                std::vector<uint32_t> edgeOwners(3 * faceCount);
+                edges.forEachEdge(level, [&](const uint32_t* pHalfEdges, uint32_t count)
+                {
+                    for (uint32_t i = 0; i < count; ++i) edgeOwners[pHalfEdges[i]] = pHalfEdges[0];
+                });
+                std::vector<uint32_t> edgeVertices(3 * faceCount);
+                uint32_t nextVertexCount = vertexCount;
+                for (uint32_t i = 0; i < 3 * faceCount; ++i)
                 {
-                    usedVerts[v[i]] = i;
+                    edgeVertices[i] = edgeOwners[i] == i ? nextVertexCount++ : edgeVertices[edgeOwners[i]];
                 }
-                for (size_t i = 0; i < ntris; ++i)
+
+                next.resize(nextVertexCount, 4 * (size_t)faceCount);
+
+                // Update vertex positions for even vertices and set their start faces.
+                parallelForBlocks(vertexCount, [&](size_t begin, size_t end)
                 {
-                    for (uint32_t j = 0; j < 3; ++j)
+                    for (uint32_t vert = (uint32_t)begin; vert < end; ++vert)
                     {
-                        *vp = usedVerts[f[i]->v[j]];
-                        ++vp;
+                        if (!level.isBoundary(vert))
+                        {
+                            // Apply one-ring rule for even vertex.
+                            if (level.isRegular(vert)) next.positions[vert] = weightOneRing(level, vert, 1.f / 16.f);
+                            else next.positions[vert] = weightOneRing(level, vert, beta(level.valence(vert)));
+                        }
+                        else
+                        {
+                            // Apply boundary rule for even vertex.
+                            next.positions[vert] = weightBoundary(level, vert, 1.f / 8.f);
+                        }
+                        next.vertexFlags[vert] = level.vertexFlags[vert];
+                        uint32_t startFace = level.startFaces[vert];
+                        next.startFaces[vert] = 4 * startFace + level.vnum(startFace, vert);
                     }
-                }
+                });
+
+                // Compute new odd edge vertices and update the topology of the child faces.
+                parallelForBlocks(faceCount, [&](size_t begin, size_t end)
+                {
+                    for (uint32_t face = (uint32_t)begin; face < end; ++face)
+                    {
+                        const uint32_t* v = &level.faceVertices[3 * face];
+                        const uint32_t* f = &level.faceNeighbors[3 * face];
 
-                LoopSubdivideResult result;
-                result.positions = std::move(pLimit);
-                result.normals = std::move(Ns);
-                result.indices = std::move(verts);
-                return result;
+                        for (uint32_t k = 0; k < 3; ++k)
+                        {
+                            if (edgeOwners[3 * face + k] != 3 * face + k) continue;
+
+                            // Create and initialize new odd vertex.
+                            uint32_t vert = edgeVertices[3 * face + k];
+                            uint32_t v0 = v[k];
+                            uint32_t v1 = v[NEXT(k)];
+                            bool boundary = f[k] == kInvalidIndex;
+                            next.vertexFlags[vert] = kRegular | (boundary ? kBoundary : 0);
+                            next.startFaces[vert] = 4 * face + 3;
+
+                            // Apply edge rules to compute new vertex position.
+                            float3 p;
+                            if (boundary)
+                            {
+                                p = 0.5f * level.positions[v0];
+                                p += 0.5f * level.positions[v1];
+                            }
+                            else
+                            {
+                                p = 3.f / 8.f * level.positions[v0];
+                                p += 3.f / 8.f * level.positions[v1];
+                                p += 1.f / 8.f * level.positions[level.otherVert(face, v0, v1)];
+                                p += 1.f / 8.f * level.positions[level.otherVert(f[k], v0, v1)];
+                            }
+                            next.positions[vert] = p;
+                        }
+
+                        // Child k of this face has vertices children[3 * k + j] and neighbors neighbors[3 * k + j].
+                        uint32_t* children = &next.faceVertices[12 * face];
+                        uint32_t* neighbors = &next.faceNeighbors[12 * face];
+                        for (uint32_t j = 0; j < 3; ++j)
+                        {
+                            // Update children neighbors for siblings.
+                            neighbors[9 + j] = 4 * face + NEXT(j);
+                            neighbors[3 * j + NEXT(j)] = 4 * face + 3;
+
+                            // Update children neighbors for neighbor children.
+                            uint32_t f2 = f[j];
+                            neighbors[3 * j + j] = f2 != kInvalidIndex ? 4 * f2 + level.vnum(f2, v[j]) : kInvalidIndex;
+                            f2 = f[PREV(j)];
+                            neighbors[3 * j + PREV(j)] = f2 != kInvalidIndex ? 4 * f2 + level.vnum(f2, v[j]) : kInvalidIndex;
+
+                            // Update child vertices to new even and odd vertices.
+                            uint32_t odd = edgeVertices[3 * face + j];
+                            children[3 * j + j] = v[j];
+                            children[3 * j + NEXT(j)] = odd;
+                            children[3 * NEXT(j) + j] = odd;
+                            children[9 + j] = odd;
+                        }
+                    }
+                });
             }
         }
 
-        static float3 weightOneRing(SDVertex* vert, float beta)
+        LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> positions, fstd::span<const uint32_t> indices)
         {
-            // Put vert one-ring in pRing.
-            uint32_t valence = vert->valence();
-            FALCOR_ASSERT(valence < 16);
-            float3 pRing[16];
-
-            vert->oneRing(pRing);
-            float3 p = (1 - valence * beta) * vert->p;
-            for (uint32_t i = 0; i < valence; ++i)
+            FALCOR_PROFILE_CPU("loopSubdivide");
+
+            // Refine the mesh, alternating between two levels to reuse their storage.
+            SubdivLevel level = createBaseLevel(positions, indices);
+            SubdivLevel next;
+            for (uint32_t i = 0; i < levels; ++i)
             {
-                p += beta * pRing[i];
+                subdivideLevel(level, next);
+                std::swap(level, next);
             }
-            return p;
-        }
 
-        void SDVertex::oneRing(float3* p)
-        {
-            if (!boundary)
+            LoopSubdivideResult result;
+            uint32_t vertexCount = level.getVertexCount();
+
+            // Push vertices to limit surface.
+            result.positions.resize(vertexCount);
+            parallelForBlocks(vertexCount, [&](size_t begin, size_t end)
             {
-                // Get one-ring vertices for interior vertex.
-                SDFace* face = startFace;
-                do
+                for (uint32_t vert = (uint32_t)begin; vert < end; ++vert)
                 {
-                    *p++ = face->nextVert(this)->p;
-                    face = face->nextFace(this);
-                } while (face != startFace);
-            }
-            else
+                    if (level.isBoundary(vert)) result.positions[vert] = weightBoundary(level, vert, 1.f / 5.f);
+                    else result.positions[vert] = weightOneRing(level, vert, loopGamma(level.valence(vert)));
+                }
+            });
+            std::swap(level.positions, result.positions);
+
+            // Compute vertex tangents on limit surface.
+            result.normals.resize(vertexCount);
+            parallelForBlocks(vertexCount, [&](size_t begin, size_t end)
             {
-                // Get one-ring vertices for boundary vertex.
-                SDFace* face = startFace;
-                SDFace* f2;
-                while ((f2 = face->nextFace(this)) != nullptr)
+                std::vector<float3> pRing;
+                for (uint32_t vert = (uint32_t)begin; vert < end; ++vert)
                 {
-                    face = f2;
+                    const float3& p = level.positions[vert];
+                    float3 S(0.f);
+                    float3 T(0.f);
+                    level.oneRing(vert, pRing);
+                    uint32_t valence = (uint32_t)pRing.size();
+                    if (!level.isBoundary(vert))
+                    {
+                        // Compute tangents of interior face.
+                        for (uint32_t j = 0; j < valence; ++j)
+                        {
+                            S += std::cos(2.f * float(M_PI) * j / valence) * float3(pRing[j]);
+                            T += std::sin(2.f * float(M_PI) * j / valence) * float3(pRing[j]);
+                        }
+                    }
+                    else
+                    {
+                        // Compute tangents of boundary face.
+                        S = pRing[valence - 1] - pRing[0];
+                        if (valence == 2)
+                        {
+                            T = float3(pRing[0] + pRing[1] - 2.f * p);
+                        }
+                        else if (valence == 3)
+                        {
+                            T = pRing[1] - p;
+                        }
+                        else if (valence == 4) // regular
+                        {
+                            T = float3(-1.f * pRing[0] + 2.f * pRing[1] + 2.f * pRing[2] + -1.f * pRing[3] + -2.f * p);
+                        }
+                        else
+                        {
+                            float theta = float(M_PI) / float(valence - 1);
+                            T = float3(std::sin(theta) * (pRing[0] + pRing[valence - 1]));
+                            for (uint32_t k = 1; k < valence - 1; ++k)
+                            {
+                                float wt = (2 * std::cos(theta) - 2) * std::sin((k)*theta);
+                                T += float3(wt * pRing[k]);
+                            }
+                            T = -T;
+                        }
+                    }
+                    result.normals[vert] = cross(S, T);
                 }
-                *p++ = face->nextVert(this)->p;
-                do
-                {
-                    *p++ = face->prevVert(this)->p;
-                    face = face->prevFace(this);
-                } while (face != nullptr);
-            }
-        }
+            });
 
-        static float3 weightBoundary(SDVertex* vert, float beta)
-        {
-            // Put vert one-ring in pRing.
-            uint32_t valence = vert->valence();
-            FALCOR_ASSERT(valence < 16);
-            float3 pRing[16];
-
-            vert->oneRing(pRing);
-            float3 p = (1 - 2 * beta) * vert->p;
-            p += beta * pRing[0];
-            p += beta * pRing[valence - 1];
-            return p;
+            // Create triangle mesh from subdivision mesh.
+            result.positions = std::move(level.positions);
+            result.indices = std::move(level.faceVertices);
+            return result;
         }
     }
 }
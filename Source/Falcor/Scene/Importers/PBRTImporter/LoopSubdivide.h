@@ -32,6 +32,7 @@
 // SPDX: Apache-2.0
 
 #pragma once
+#include "Core/Macros.h"
 #include "Utils/Math/Vector.h"
 #include <fstd/span.h> // TODO C++20: Replace with <span>
 #include <vector>
@@ -47,6 +48,12 @@ namespace Falcor
             std::vector<uint32_t> indices;
         };
 
-        LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> positions, fstd::span<const uint32_t> vertices);
+        /** Apply Loop subdivision to a triangle mesh and push the vertices to the limit surface.
+            \param[in] levels Number of subdivision levels.
+            \param[in] positions Vertex positions.
+            \param[in] vertices Vertex indices, three per triangle.
+            \return Subdivided mesh with limit surface normals.
+        */
+        FALCOR_API LoopSubdivideResult loopSubdivide(uint32_t levels, fstd::span<const float3> positions, fstd::span<const uint32_t> vertices);
     }
 }
@@ -70,10 +70,13 @@
 #include "Core/API/Device.h"
 #include "Utils/Settings.h"
 #include "Utils/Logger.h"
+#include "Utils/NumericRange.h"
+#include "Utils/Timing/CpuProfiler.h"
 #include "Utils/Timing/TimeReport.h"
 #include "Utils/Math/FalcorMath.h"
 #include "Utils/Math/FNVHash.h"
 #include "Scene/Importer.h"
+#include "Scene/PlyReader.h"
 #include "Scene/Material/Material.h"
 #include "Scene/Material/StandardMaterial.h"
 #include "Scene/Material/RGLMaterial.h"
@@ -86,6 +89,7 @@
 #include "Scene/Material/PBRT/PBRTDiffuseTransmissionMaterial.h"
 #include "Scene/Curves/CurveTessellation.h"
 
+#include <execution>
 #include <unordered_map>
 
 namespace Falcor
@@ -153,13 +157,46 @@ namespace Falcor
         {
         };
 
+        /** Mesh loaded from a PLY file.
+            The attribute arrays are passed to the scene builder directly instead of converting them to a triangle mesh.
+        */
+        struct PlyShapeMesh
+        {
+            std::string name;
+            PlyMesh mesh;
+            bool frontFaceCW = false;
+        };
+
         /** Holds the results from creating a shape.
         */
         struct Shape
         {
             Falcor::TriangleMesh::SharedPtr pTriangleMesh;
+            std::shared_ptr<PlyShapeMesh> pPlyMesh;
             rmcv::mat4 transform;
             Falcor::Material::SharedPtr pMaterial;
+
+            bool hasMesh() const { return pTriangleMesh || pPlyMesh; }
+        };
+
+        /** Holds a single curve strand before it is appended to a curve aggregate.
+        */
+        struct CurveStrand
+        {
+            uint32_t splitDepth;
+            std::vector<float3> points;
+            std::vector<float> widths;
+        };
+
+        /** Holds the geometry created from a shape entity before materials are assigned.
+        */
+        struct ShapeGeometry
+        {
+            Falcor::TriangleMesh::SharedPtr pTriangleMesh;
+            std::shared_ptr<PlyShapeMesh> pPlyMesh;
+            rmcv::mat4 transform;
+            std::optional<CurveStrand> curveStrand;
+            bool skipped = false;       ///< True if the shape is discarded due to invalid parameters.
         };
 
         /** Holds a list of aggregated curve shapes (strands).
@@ -187,6 +224,11 @@ namespace Falcor
             std::vector<float> widths;      ///< Concatenated list of widths of all strands.
         };
 
+        /** Holds the tessellated geometry of a curve aggregate.
+            Meshes are pre-processed so they can be added to the scene builder directly.
+        */
+        using CurveGeometry = std::variant<std::monostate, CurveTessellation::SweptSphereResult, SceneBuilder::ProcessedMesh>;
+
         struct InstanceDefinition
         {
             std::vector<std::pair<MeshID,  rmcv::mat4>> meshes; // List of meshID + transform
@@ -208,7 +250,8 @@ namespace Falcor
 
             Falcor::Material::SharedPtr pDefaultMaterial;
 
-            std::unordered_map<CurveAggregate::Key, CurveAggregate, CurveAggregate::KeyHash> curveAggregates;
+            std::vector<CurveAggregate> curveAggregates;    ///< Curve aggregates in order of their first strand.
+            std::unordered_map<CurveAggregate::Key, size_t, CurveAggregate::KeyHash> curveAggregateIndices;
 
             std::map<std::string, InstanceDefinition> instanceDefinitions;
 
@@ -1358,7 +1401,10 @@ namespace Falcor
             }
         }
 
-        Shape createShape(BuilderContext& ctx, const ShapeSceneEntity& entity)
+        /** Create the geometry of a shape.
+            This only accesses the shape entity and is safe to call concurrently for different shapes.
+        */
+        ShapeGeometry createShapeGeometry(const BuilderContext& ctx, const ShapeSceneEntity& entity)
         {
             auto warnUnsupported = [&]() { warnUnsupportedType(entity.loc, "Shape", entity.name); };
 
@@ -1367,7 +1413,14 @@ namespace Falcor
 
             warnUnsupportedParameters(params, { "alpha" });
 
-            Shape shape;
+            ShapeGeometry shape;
+
+            auto skipShape = []()
+            {
+                ShapeGeometry skipped;
+                skipped.skipped = true;
+                return skipped;
+            };
 
             if (type == "sphere")
             {
@@ -1434,31 +1487,17 @@ namespace Falcor
 
                 auto P = params.getPoint3Array("P");
 
-                // Create or get existing curve aggregate.
-                auto pMaterial = ctx.getMaterial(entity.materialRef);
-                CurveAggregate::Key key { entity.transform, pMaterial.get() };
-                auto it = ctx.curveAggregates.find(key);
-                if (it == ctx.curveAggregates.end())
-                {
-                    it = ctx.curveAggregates.emplace(key, CurveAggregate{}).first;
-                    it->second.transform = entity.transform;
-                    it->second.pMaterial = pMaterial;
-                    it->second.splitDepth = splitdepth;
-                }
-                CurveAggregate &aggregate = it->second;
-
-                // Append curve to aggregate.
-                size_t pointCount = P.size();
-                size_t offset = aggregate.points.size();
-                aggregate.strands.push_back(pointCount);
-                aggregate.points.resize(aggregate.points.size() + pointCount);
-                aggregate.widths.resize(aggregate.widths.size() + pointCount);
-                for (size_t i = 0; i < pointCount; ++i)
+                // Curve strands are appended to curve aggregates once the material is known.
+                CurveStrand strand;
+                strand.splitDepth = splitdepth;
+                strand.widths.resize(P.size());
+                for (size_t i = 0; i < P.size(); ++i)
                 {
-                    float t = float(i) / pointCount;
-                    aggregate.points[offset + i] = P[i];
-                    aggregate.widths[offset + i] = lerp(width0, width1, t);
+                    float t = float(i) / P.size();
+                    strand.widths[i] = lerp(width0, width1, t);
                 }
+                strand.points = std::move(P);
+                shape.curveStrand = std::move(strand);
             }
             else if (type == "trianglemesh")
             {
@@ -1480,7 +1519,7 @@ namespace Falcor
                     else
                     {
                         logWarning(entity.loc, "Vertex indices 'indices' missing. Skipping.");
-                        return {};
+                        return skipShape();
                     }
                 }
                 if (indices.size() % 3 != 0)
@@ -1491,7 +1530,7 @@ namespace Falcor
                 if (P.empty())
                 {
                     logWarning(entity.loc, "Vertex positions 'positions' missing. Skipping.");
-                    return {};
+                    return skipShape();
                 }
                 if (!uv.empty() && uv.size() != P.size())
                 {
@@ -1508,7 +1547,7 @@ namespace Falcor
                     if (i < 0 || i >= P.size())
                     {
                         logWarning(entity.loc, "Vertex index {} is out of bounds. Skipping.", i);
-                        return {};
+                        return skipShape();
                     }
                 }
 
@@ -1538,8 +1577,21 @@ namespace Falcor
                 auto filename = params.getString("filename", "");
                 auto path = ctx.resolver(filename);
 
-                shape.pTriangleMesh = Falcor::TriangleMesh::createFromFile(path.string());
-                if (shape.pTriangleMesh) shape.pTriangleMesh->setName(filename);
+                try
+                {
+                    auto pPlyMesh = std::make_shared<PlyShapeMesh>();
+                    pPlyMesh->name = filename;
+                    pPlyMesh->mesh = PlyReader::read(path);
+                    // Flip texture coordinates to match TriangleMesh::createFromFile().
+                    for (auto& texCrd : pPlyMesh->mesh.texCrds) texCrd.y = 1.f - texCrd.y;
+
+                    if (pPlyMesh->mesh.indices.empty()) logWarning(entity.loc, "PLY file '{}' contains no triangles. Skipping.", filename);
+                    else shape.pPlyMesh = std::move(pPlyMesh);
+                }
+                catch (const RuntimeError& e)
+                {
+                    logWarning(entity.loc, "{}", e.what());
+                }
                 shape.transform = entity.transform;
             }
             else if (type == "loopsubdiv")
@@ -1575,11 +1627,52 @@ namespace Falcor
                 throwError(entity.loc, "Unknown shape type '{}'.", type);
             }
 
+            return shape;
+        }
+
+        /** Create a shape from its geometry.
+            This assigns the material and area light and appends curve strands to the curve aggregates.
+            It must be called in the order of the shape entities to produce a deterministic scene.
+        */
+        Shape createShape(BuilderContext& ctx, const ShapeSceneEntity& entity, ShapeGeometry geometry)
+        {
+            if (geometry.skipped) return {};
+
+            Shape shape;
+            shape.pTriangleMesh = std::move(geometry.pTriangleMesh);
+            shape.pPlyMesh = std::move(geometry.pPlyMesh);
+            shape.transform = geometry.transform;
+
+            // Append curve strand to a new or existing curve aggregate.
+            if (geometry.curveStrand)
+            {
+                const CurveStrand& strand = *geometry.curveStrand;
+                auto pMaterial = ctx.getMaterial(entity.materialRef);
+                CurveAggregate::Key key { entity.transform, pMaterial.get() };
+                auto [it, inserted] = ctx.curveAggregateIndices.emplace(key, ctx.curveAggregates.size());
+                if (inserted)
+                {
+                    CurveAggregate& newAggregate = ctx.curveAggregates.emplace_back();
+                    newAggregate.transform = entity.transform;
+                    newAggregate.pMaterial = pMaterial;
+                    newAggregate.splitDepth = strand.splitDepth;
+                }
+                CurveAggregate& aggregate = ctx.curveAggregates[it->second];
+
+                aggregate.strands.push_back((uint32_t)strand.points.size());
+                aggregate.points.insert(aggregate.points.end(), strand.points.begin(), strand.points.end());
+                aggregate.widths.insert(aggregate.widths.end(), strand.widths.begin(), strand.widths.end());
+            }
+
             // Reverse orientation.
             if (entity.reverseOrientation && shape.pTriangleMesh)
             {
                 shape.pTriangleMesh->setFrontFaceCW(!shape.pTriangleMesh->getFrontFaceCW());
             }
+            if (entity.reverseOrientation && shape.pPlyMesh)
+            {
+                shape.pPlyMesh->frontFaceCW = !shape.pPlyMesh->frontFaceCW;
+            }
 
             // Get the material.
             shape.pMaterial = ctx.getMaterial(entity.materialRef);
@@ -1609,37 +1702,137 @@ namespace Falcor
             return shape;
         }
 
-        /** Create curve geometry from a curve aggregate.
-            This can either result in mesh or curve geometry depending on the tesselation mode.
+        /** Run a function for all indices in [0, count) in parallel.
+            Exceptions are captured and the one of the lowest index is rethrown, matching the behavior of a serial loop.
         */
-        std::variant<Falcor::MeshID, Falcor::CurveID> createCurveGeometry(BuilderContext& ctx, const CurveAggregate& curveAggregate)
+        template<typename F>
+        void parallelFor(size_t count, F func)
         {
-            CurveTessellationMode mode = CurveTessellationMode::LinearSweptSphere;
+            std::vector<std::exception_ptr> exceptions(count);
+            auto range = NumericRange<size_t>(0, count);
+            std::for_each(std::execution::par, range.begin(), range.end(), [&](size_t i)
+            {
+                try
+                {
+                    func(i);
+                }
+                catch (...)
+                {
+                    exceptions[i] = std::current_exception();
+                }
+            });
 
-            if (is_set(ctx.builder.getFlags(), SceneBuilder::Flags::TessellateCurvesIntoPolyTubes))
+            for (const auto& pException : exceptions)
             {
-                mode = CurveTessellationMode::PolyTube;
+                if (pException) std::rethrow_exception(pException);
             }
+        }
+
+        /** Pre-process a mesh loaded from a PLY file.
+            Facet normals are used if the file has no normals, matching TriangleMesh::createFromFile().
+        */
+        SceneBuilder::ProcessedMesh processPlyMesh(const BuilderContext& ctx, const PlyShapeMesh& plyMesh, const Falcor::Material::SharedPtr& pMaterial)
+        {
+            static const float2 kZeroTexCrd(0.f);
+
+            const auto& data = plyMesh.mesh;
+            std::vector<float3> faceNormals;
 
+            SceneBuilder::Mesh mesh;
+            mesh.name = plyMesh.name;
+            mesh.faceCount = data.getTriangleCount();
+            mesh.vertexCount = data.getVertexCount();
+            mesh.indexCount = (uint32_t)data.indices.size();
+            mesh.pIndices = data.indices.data();
+            mesh.topology = Vao::Topology::TriangleList;
+            mesh.isFrontFaceCW = plyMesh.frontFaceCW;
+            mesh.pMaterial = pMaterial;
+            mesh.positions = { data.positions.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+            if (!data.normals.empty())
+            {
+                mesh.normals = { data.normals.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+            }
+            else
+            {
+                faceNormals = data.computeFaceNormals();
+                mesh.normals = { faceNormals.data(), SceneBuilder::Mesh::AttributeFrequency::Uniform };
+            }
+            if (!data.texCrds.empty())
+            {
+                mesh.texCrds = { data.texCrds.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
+            }
+            else
+            {
+                mesh.texCrds = { &kZeroTexCrd, SceneBuilder::Mesh::AttributeFrequency::Constant };
+            }
+
+            return ctx.builder.processMesh(mesh);
+        }
+
+        /** Create shapes and add their meshes to the scene builder.
+            Shapes are processed in batches. Within a batch, the shape geometry is created and pre-processed in parallel,
+            while materials, area lights and curve strands are assigned and meshes are added in the order of the entities.
+            \param[in] entities Shape entities.
+            \param[in] addMeshInstance Called in entity order for each added mesh with the mesh ID and transform.
+        */
+        void createShapes(BuilderContext& ctx, const std::vector<ShapeSceneEntity>& entities,
+                          const std::function<void(const ShapeSceneEntity&, MeshID, const rmcv::mat4&)>& addMeshInstance)
+        {
+            FALCOR_PROFILE_CPU("PBRTImporter::createShapes");
+
+            // Limits the number of meshes held in memory at once.
+            const size_t kBatchSize = 256;
+
+            std::vector<ShapeGeometry> geometries;
+            std::vector<Shape> shapes;
+            std::vector<SceneBuilder::ProcessedMesh> processedMeshes;
+
+            for (size_t batchStart = 0; batchStart < entities.size(); batchStart += kBatchSize)
+            {
+                const size_t batchSize = std::min(kBatchSize, entities.size() - batchStart);
+
+                geometries.clear();
+                geometries.resize(batchSize);
+                parallelFor(batchSize, [&](size_t i) { geometries[i] = createShapeGeometry(ctx, entities[batchStart + i]); });
+
+                shapes.clear();
+                for (size_t i = 0; i < batchSize; ++i)
+                {
+                    shapes.push_back(createShape(ctx, entities[batchStart + i], std::move(geometries[i])));
+                }
+
+                processedMeshes.clear();
+                processedMeshes.resize(batchSize);
+                parallelFor(batchSize, [&](size_t i)
+                {
+                    const auto& shape = shapes[i];
+                    if (shape.pTriangleMesh) processedMeshes[i] = ctx.builder.processTriangleMesh(shape.pTriangleMesh, shape.pMaterial);
+                    else if (shape.pPlyMesh) processedMeshes[i] = processPlyMesh(ctx, *shape.pPlyMesh, shape.pMaterial);
+                });
+
+                for (size_t i = 0; i < batchSize; ++i)
+                {
+                    if (!shapes[i].hasMesh()) continue;
+                    auto meshID = ctx.builder.addProcessedMesh(processedMeshes[i]);
+                    addMeshInstance(entities[batchStart + i], meshID, shapes[i].transform);
+                }
+            }
+        }
+
+        /** Tessellate a curve aggregate.
+            This can either result in mesh or curve geometry depending on the tesselation mode.
+            This does not modify the scene builder and is safe to call concurrently.
+        */
+        CurveGeometry tessellateCurveAggregate(const BuilderContext& ctx, CurveTessellationMode mode, const CurveAggregate& curveAggregate)
+        {
             uint32_t subdivPerSegment = 1u << curveAggregate.splitDepth;
 
             if (mode == CurveTessellationMode::LinearSweptSphere)
             {
-                auto result = CurveTessellation::convertToLinearSweptSphere(
+                return CurveTessellation::convertToLinearSweptSphere(
                     curveAggregate.strands.size(), curveAggregate.strands.data(),
                     curveAggregate.points.data(), curveAggregate.widths.data(), nullptr,
                     1, subdivPerSegment, 1, 1, 1.f, rmcv::mat4());
-
-                Falcor::SceneBuilder::Curve curve;
-                curve.degree = result.degree;
-                curve.vertexCount = result.points.size();
-                curve.indexCount = result.indices.size();
-                curve.pIndices = result.indices.data();
-                curve.pMaterial = curveAggregate.pMaterial;
-                curve.positions.pData = result.points.data();
-                curve.radius.pData = result.radius.data();
-
-                return ctx.builder.addCurve(curve);
             }
             else
             {
@@ -1674,42 +1867,84 @@ namespace Falcor
                 mesh.curveRadii.pData = result.radii.data();
                 mesh.curveRadii.frequency = Falcor::SceneBuilder::Mesh::AttributeFrequency::Vertex;
 
-                return ctx.builder.addMesh(mesh);
+                return ctx.builder.processMesh(mesh);
             }
         }
 
+        /** Create curve geometry from the curve aggregates assembled by createShape() and clear the aggregates.
+            The aggregates are tessellated in parallel and added to the scene builder in the order they were created.
+            \param[in] addInstance Called for each curve aggregate with the created mesh or curve ID.
+        */
+        void createCurves(BuilderContext& ctx, const std::function<void(const CurveAggregate&, std::variant<MeshID, CurveID>)>& addInstance)
+        {
+            FALCOR_PROFILE_CPU("PBRTImporter::createCurves");
+
+            CurveTessellationMode mode = CurveTessellationMode::LinearSweptSphere;
+
+            if (is_set(ctx.builder.getFlags(), SceneBuilder::Flags::TessellateCurvesIntoPolyTubes))
+            {
+                mode = CurveTessellationMode::PolyTube;
+            }
+
+            std::vector<CurveGeometry> geometries(ctx.curveAggregates.size());
+            parallelFor(geometries.size(), [&](size_t i) { geometries[i] = tessellateCurveAggregate(ctx, mode, ctx.curveAggregates[i]); });
+
+            for (size_t i = 0; i < geometries.size(); ++i)
+            {
+                const auto& curveAggregate = ctx.curveAggregates[i];
+                if (auto pResult = std::get_if<CurveTessellation::SweptSphereResult>(&geometries[i]))
+                {
+                    Falcor::SceneBuilder::Curve curve;
+                    curve.degree = pResult->degree;
+                    curve.vertexCount = pResult->points.size();
+                    curve.indexCount = pResult->indices.size();
+                    curve.pIndices = pResult->indices.data();
+                    curve.pMaterial = curveAggregate.pMaterial;
+                    curve.positions.pData = pResult->points.data();
+                    curve.radius.pData = pResult->radius.data();
+
+                    addInstance(curveAggregate, ctx.builder.addCurve(curve));
+                }
+                else if (auto pMesh = std::get_if<SceneBuilder::ProcessedMesh>(&geometries[i]))
+                {
+                    addInstance(curveAggregate, ctx.builder.addProcessedMesh(*pMesh));
+                }
+                else
+                {
+                    FALCOR_UNREACHABLE();
+                }
+            }
+
+            ctx.curveAggregates.clear();
+            ctx.curveAggregateIndices.clear();
+        }
+
         InstanceDefinition createInstanceDefinition(BuilderContext& ctx, const InstanceDefinitionSceneEntity& entity)
         {
             InstanceDefinition instanceDefinition;
 
-            for (const auto& shapeEntity : entity.shapes)
+            // Process shapes and create meshes.
+            createShapes(ctx, entity.shapes, [&](const ShapeSceneEntity&, MeshID meshID, const rmcv::mat4& transform)
             {
-                // Process shapes and create meshes.
-                auto shape = createShape(ctx, shapeEntity);
-                if (shape.pTriangleMesh)
+                instanceDefinition.meshes.emplace_back(meshID, transform);
+            });
+
+            // Create curves from curve aggregates assembled during the processing step above.
+            createCurves(ctx, [&](const CurveAggregate& curveAggregate, std::variant<MeshID, CurveID> meshOrCurveID)
+            {
+                if (auto meshID = std::get_if<Falcor::MeshID>(&meshOrCurveID))
                 {
-                    auto meshID = ctx.builder.addTriangleMesh(shape.pTriangleMesh, shape.pMaterial);
-                    instanceDefinition.meshes.emplace_back(meshID, shape.transform);
+                    instanceDefinition.meshes.emplace_back(*meshID, curveAggregate.transform);
                 }
-
-                // Create curves from curve aggregates assembled during the processing step above.
-                for (const auto& [_, curveAggregate] : ctx.curveAggregates)
+                else if (auto curveID = std::get_if<Falcor::CurveID>(&meshOrCurveID))
                 {
-                    auto meshOrCurveID = createCurveGeometry(ctx, curveAggregate);
-                    if (auto meshID = std::get_if<Falcor::MeshID>(&meshOrCurveID))
-                    {
-                        instanceDefinition.meshes.emplace_back(*meshID, curveAggregate.transform);
-                    }
-                    else if (auto curveID = std::get_if<Falcor::CurveID>(&meshOrCurveID))
-                    {
-                        instanceDefinition.curves.emplace_back(*curveID, curveAggregate.transform);
-                    }
-                    {
-                        FALCOR_UNREACHABLE();
-                    }
+                    instanceDefinition.curves.emplace_back(*curveID, curveAggregate.transform);
                 }
-                ctx.curveAggregates.clear();
-            }
+                else
+                {
+                    FALCOR_UNREACHABLE();
+                }
+            });
 
             return instanceDefinition;
         }
@@ -1776,22 +2011,16 @@ namespace Falcor
             }
 
             // Process shapes and create meshes.
-            for (const auto& entity : ctx.scene.getShapes())
+            createShapes(ctx, ctx.scene.getShapes(), [&ctx](const ShapeSceneEntity& entity, MeshID meshID, const rmcv::mat4& transform)
             {
-                auto shape = createShape(ctx, entity);
-                if (shape.pTriangleMesh)
-                {
-                    auto nodeID = ctx.builder.addNode({ entity.name, shape.transform });
-                    auto meshID = ctx.builder.addTriangleMesh(shape.pTriangleMesh, shape.pMaterial);
-                    ctx.builder.addMeshInstance(nodeID, meshID);
-                }
-            }
+                auto nodeID = ctx.builder.addNode({ entity.name, transform });
+                ctx.builder.addMeshInstance(nodeID, meshID);
+            });
 
             // Create curves from curve aggregates assembled during the processing step above.
-            for (const auto& [_, curveAggregate] : ctx.curveAggregates)
+            createCurves(ctx, [&ctx](const CurveAggregate& curveAggregate, std::variant<MeshID, CurveID> meshOrCurveID)
             {
                 auto nodeID = ctx.builder.addNode({ "curves", curveAggregate.transform });
-                auto meshOrCurveID = createCurveGeometry(ctx, curveAggregate);
                 if (auto meshID = std::get_if<Falcor::MeshID>(&meshOrCurveID))
                 {
                     ctx.builder.addMeshInstance(nodeID, *meshID);
@@ -1804,8 +2033,7 @@ namespace Falcor
                 {
                     FALCOR_UNREACHABLE();
                 }
-            }
-            ctx.curveAggregates.clear();
+            });
 
             auto getInstanceDefinition = [&ctx](const InstanceSceneEntity& entity)
             {
@@ -41,6 +41,9 @@
 
 #include <atomic>
 #include <charconv>
+#include <future>
+#include <mutex>
+#include <thread>
 
 namespace Falcor
 {
@@ -109,9 +112,14 @@ namespace Falcor
             : mPath(path)
             , mContents(std::move(str))
         {
+            // Tokenizers for imported files are created on worker threads.
+            static std::mutex filenamesMutex;
             auto pFilename = std::make_unique<std::string>(path.string());
             mLoc = FileLoc(*pFilename);
-            getFilenames().push_back(std::move(pFilename));
+            {
+                std::lock_guard<std::mutex> lock(filenamesMutex);
+                getFilenames().push_back(std::move(pFilename));
+            }
 
             mPos = mContents.data();
             mEnd = mPos + mContents.size();
@@ -434,6 +442,41 @@ namespace Falcor
             return parameterVector;
         }
 
+        /** Limits the number of threads parsing imported files.
+            Imports that find no free slot are parsed on the importing thread, which also avoids
+            blocking on nested imports.
+        */
+        class ImportThreadSlots
+        {
+        public:
+            static bool tryAcquire()
+            {
+                static const uint32_t maxCount = std::max(1u, std::thread::hardware_concurrency());
+                uint32_t count = sCount.load();
+                while (count < maxCount)
+                {
+                    if (sCount.compare_exchange_weak(count, count + 1)) return true;
+                }
+                return false;
+            }
+
+            static void release() { sCount--; }
+
+        private:
+            static inline std::atomic<uint32_t> sCount{0};
+        };
+
+        void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer);
+
+        /** Parse an imported file into a separate target.
+        */
+        void parseImport(ParserTarget& target, const std::filesystem::path& path)
+        {
+            std::unique_ptr<Tokenizer> importTokenizer = Tokenizer::createFromFile(path);
+            logInfo("PBRTImporter: Started parsing '{}'.", importTokenizer->getPath().string());
+            parse(target, std::move(importTokenizer));
+        }
+
         void parse(ParserTarget& target, std::unique_ptr<Tokenizer> tokenizer)
         {
             static std::atomic<bool> warnedTransformBeginEndDeprecated{false};
@@ -445,6 +488,14 @@ namespace Falcor
             std::vector<std::unique_ptr<Tokenizer>> fileStack;
             fileStack.push_back(std::move(tokenizer));
 
+            struct ImportJob
+            {
+                FileLoc loc;
+                std::unique_ptr<ParserTarget> pTarget;
+                std::future<void> result;               ///< Invalid if the import was parsed inline.
+            };
+            std::vector<ImportJob> importJobs;
+
             std::optional<Token> ungetToken;
 
             /** Helper function that handles the file stack, returning the next token from
@@ -620,7 +671,33 @@ namespace Falcor
                     }
                     else if (tok->token == "Import")
                     {
-                        throwError(tok->loc, "'Import' directive not supported yet.");
+                        Token filenameToken = *nextToken(TokenRequired);
+                        std::string filename = toString(dequoteString(filenameToken));
+                        auto path = searchPath / filename;
+                        auto pImportTarget = target.createImportTarget(tok->loc);
+                        if (!pImportTarget)
+                        {
+                            std::unique_ptr<Tokenizer> importTokenizer = Tokenizer::createFromFile(path);
+                            logInfo("PBRTImporter: Started parsing '{}'.", importTokenizer->getPath().string());
+                            fileStack.push_back(std::move(importTokenizer));
+                        }
+                        else
+                        {
+                            ImportJob job { tok->loc, std::move(pImportTarget) };
+                            if (ImportThreadSlots::tryAcquire())
+                            {
+                                job.result = std::async(std::launch::async, [pTarget = job.pTarget.get(), path]()
+                                {
+                                    struct Release { ~Release() { ImportThreadSlots::release(); } } release;
+                                    parseImport(*pTarget, path);
+                                });
+                            }
+                            else
+                            {
+                                parseImport(*job.pTarget, path);
+                            }
+                            importJobs.push_back(std::move(job));
+                        }
                     }
                     else if (tok->token == "Identity")
                     {
@@ -851,6 +928,13 @@ namespace Falcor
                     syntaxError(*tok);
                 }
             }
+
+            // Merge imported files in the order of their directives. This makes the result independent of the parse order.
+            for (auto& job : importJobs)
+            {
+                if (job.result.valid()) job.result.get();
+                target.mergeImportTarget(*job.pTarget, job.loc);
+            }
         }
 
         void parseFile(ParserTarget& target, const std::filesystem::path& path)
@@ -94,6 +94,17 @@ namespace Falcor
             virtual void onObjectInstance(const std::string& name, FileLoc loc) = 0;
 
             virtual void onEndOfFiles() = 0;
+
+            /** Create a target for parsing a file referenced by an 'Import' directive.
+                Imported files are parsed concurrently into separate targets, which are merged back
+                in the order of the directives once the importing file has been parsed.
+                \return Returns the import target, or nullptr to parse the file inline like 'Include'.
+            */
+            virtual std::unique_ptr<ParserTarget> createImportTarget(FileLoc loc) { return nullptr; }
+
+            /** Merge a target created by createImportTarget() after its file has been parsed.
+            */
+            virtual void mergeImportTarget(ParserTarget& importTarget, FileLoc loc) {}
         };
 
         void parseFile(ParserTarget& target, const std::filesystem::path& path);
@@ -52,8 +52,9 @@ namespace Falcor
 
         bool srgb = mUseSrgb && pMaterial->getTextureSlotInfo(slot).srgb;
 
-        // Request texture to be loaded.
-        auto handle = mpTextureManager->loadTexture(path, true, srgb);
+        // Request texture to be loaded. Emissive textures are loaded first as they are needed to build the emissive light data.
+        uint32_t priority = slot == Material::TextureSlot::Emissive ? AsyncTextureLoader::kHighPriority : AsyncTextureLoader::kDefaultPriority;
+        auto handle = mpTextureManager->loadTexture(path, true, srgb, Resource::BindFlags::ShaderResource, true, priority);
 
         // Store assignment to material for later.
         mTextureAssignments.emplace_back(TextureAssignment{ pMaterial, slot, handle });
@@ -0,0 +1,749 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "PlyReader.h"
+#include "Core/Assert.h"
+#include "Core/Errors.h"
+#include "Core/Platform/MemoryMappedFile.h"
+#include "Core/Platform/OS.h"
+#include "Utils/NumericRange.h"
+#include "Utils/StringFormatters.h"
+#include "Utils/StringUtils.h"
+#include "Utils/Math/Common.h"
+#include "Utils/Timing/CpuProfiler.h"
+
+#include <fast_float/fast_float.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <execution>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Falcor
+{
+    namespace
+    {
+        const size_t kStreamChunkSize = 1 << 22;    ///< Size of chunks decompressed at once when streaming compressed files.
+        const size_t kDecodeBlockSize = 1 << 14;    ///< Number of vertices decoded per parallel task.
+
+        enum class Format
+        {
+            Ascii,
+            BinaryLittleEndian,
+            BinaryBigEndian,
+        };
+
+        enum class Type
+        {
+            Int8,
+            UInt8,
+            Int16,
+            UInt16,
+            Int32,
+            UInt32,
+            Float32,
+            Float64,
+        };
+
+        std::optional<Type> parseType(const std::string& name)
+        {
+            if (name == "char" || name == "int8") return Type::Int8;
+            if (name == "uchar" || name == "uint8") return Type::UInt8;
+            if (name == "short" || name == "int16") return Type::Int16;
+            if (name == "ushort" || name == "uint16") return Type::UInt16;
+            if (name == "int" || name == "int32") return Type::Int32;
+            if (name == "uint" || name == "uint32") return Type::UInt32;
+            if (name == "float" || name == "float32") return Type::Float32;
+            if (name == "double" || name == "float64") return Type::Float64;
+            return {};
+        }
+
+        size_t getTypeSize(Type type)
+        {
+            switch (type)
+            {
+            case Type::Int8:
+            case Type::UInt8:
+                return 1;
+            case Type::Int16:
+            case Type::UInt16:
+                return 2;
+            case Type::Int32:
+            case Type::UInt32:
+            case Type::Float32:
+                return 4;
+            case Type::Float64:
+                return 8;
+            default:
+                FALCOR_UNREACHABLE();
+                return 0;
+            }
+        }
+
+        template<typename T>
+        T loadValue(const uint8_t* p, bool swapBytes)
+        {
+            T value;
+            if (swapBytes)
+            {
+                uint8_t bytes[sizeof(T)];
+                for (size_t i = 0; i < sizeof(T); ++i) bytes[i] = p[sizeof(T) - 1 - i];
+                std::memcpy(&value, bytes, sizeof(T));
+            }
+            else
+            {
+                std::memcpy(&value, p, sizeof(T));
+            }
+            return value;
+        }
+
+        template<typename T>
+        T readValue(const uint8_t* p, Type type, bool swapBytes)
+        {
+            switch (type)
+            {
+            case Type::Int8: return (T)loadValue<int8_t>(p, swapBytes);
+            case Type::UInt8: return (T)loadValue<uint8_t>(p, swapBytes);
+            case Type::Int16: return (T)loadValue<int16_t>(p, swapBytes);
+            case Type::UInt16: return (T)loadValue<uint16_t>(p, swapBytes);
+            case Type::Int32: return (T)loadValue<int32_t>(p, swapBytes);
+            case Type::UInt32: return (T)loadValue<uint32_t>(p, swapBytes);
+            case Type::Float32: return (T)loadValue<float>(p, swapBytes);
+            case Type::Float64: return (T)loadValue<double>(p, swapBytes);
+            default:
+                FALCOR_UNREACHABLE();
+                return T(0);
+            }
+        }
+
+        struct Property
+        {
+            std::string name;
+            Type type = Type::Float32;
+            bool isList = false;
+            Type countType = Type::UInt8;
+            size_t offset = 0;          ///< Byte offset within a row. Only valid for elements without list properties.
+        };
+
+        struct Element
+        {
+            std::string name;
+            size_t count = 0;
+            std::vector<Property> properties;
+
+            bool hasFixedRowSize() const
+            {
+                return std::none_of(properties.begin(), properties.end(), [](const Property& prop) { return prop.isList; });
+            }
+
+            size_t getRowSize() const
+            {
+                FALCOR_ASSERT(hasFixedRowSize());
+                size_t size = 0;
+                for (const auto& prop : properties) size += getTypeSize(prop.type);
+                return size;
+            }
+
+            int findProperty(const std::string& propName) const
+            {
+                for (size_t i = 0; i < properties.size(); ++i)
+                {
+                    if (properties[i].name == propName) return (int)i;
+                }
+                return -1;
+            }
+        };
+
+        /** Property indices of the vertex attributes.
+        */
+        struct VertexLayout
+        {
+            int position[3] = { -1, -1, -1 };
+            int normal[3] = { -1, -1, -1 };
+            int texCrd[2] = { -1, -1 };
+
+            bool hasNormals() const { return normal[0] >= 0 && normal[1] >= 0 && normal[2] >= 0; }
+            bool hasTexCrds() const { return texCrd[0] >= 0 && texCrd[1] >= 0; }
+
+            explicit VertexLayout(const Element& element)
+            {
+                for (int i = 0; i < 3; ++i)
+                {
+                    position[i] = element.findProperty(std::string(1, "xyz"[i]));
+                    if (position[i] < 0) throw RuntimeError("PLY vertex element is missing property '{}'.", "xyz"[i]);
+                    normal[i] = element.findProperty(std::string("n") + "xyz"[i]);
+                }
+
+                const char* kTexCrdNames[][2] = { { "u", "v" }, { "s", "t" }, { "texture_u", "texture_v" }, { "texture_s", "texture_t" } };
+                for (const auto& names : kTexCrdNames)
+                {
+                    texCrd[0] = element.findProperty(names[0]);
+                    texCrd[1] = element.findProperty(names[1]);
+                    if (hasTexCrds()) break;
+                }
+
+                // Only scalar properties can be used as attributes.
+                for (int i : position)
+                {
+                    if (element.properties[i].isList) throw RuntimeError("PLY vertex property '{}' must not be a list.", element.properties[i].name);
+                }
+                if (hasNormals() && std::any_of(std::begin(normal), std::end(normal), [&](int i) { return element.properties[i].isList; })) normal[0] = -1;
+                if (hasTexCrds() && std::any_of(std::begin(texCrd), std::end(texCrd), [&](int i) { return element.properties[i].isList; })) texCrd[0] = -1;
+            }
+
+            /** Store a vertex.
+                \param[in] getValue Function returning the value of a property given its index.
+            */
+            template<typename F>
+            void storeVertex(PlyMesh& mesh, size_t index, F getValue) const
+            {
+                mesh.positions[index] = float3(getValue(position[0]), getValue(position[1]), getValue(position[2]));
+                if (hasNormals()) mesh.normals[index] = float3(getValue(normal[0]), getValue(normal[1]), getValue(normal[2]));
+                if (hasTexCrds()) mesh.texCrds[index] = float2(getValue(texCrd[0]), getValue(texCrd[1]));
+            }
+        };
+
+        /** Provides contiguous access to file contents that are either in memory or decompressed on the fly.
+            When decompressing, only a window of the decompressed data is kept in memory.
+        */
+        class Input
+        {
+        public:
+            Input(const uint8_t* pData, size_t size, bool compressed)
+            {
+                if (compressed)
+                {
+                    mpStream = std::make_unique<z_stream>();
+                    *mpStream = {};
+                    // MAX_WBITS | 32 to support both zlib or gzip files.
+                    if (inflateInit2(mpStream.get(), MAX_WBITS | 32) != Z_OK) throw RuntimeError("inflateInit2 failed while decompressing.");
+                    mpCompressed = pData;
+                    mCompressedSize = size;
+                }
+                else
+                {
+                    mpPos = pData;
+                    mpEnd = pData + size;
+                }
+            }
+
+            ~Input()
+            {
+                if (mpStream) inflateEnd(mpStream.get());
+            }
+
+            /** True if data is decompressed on the fly and only a window of it is accessible at once.
+            */
+            bool isStreaming() const { return mpStream != nullptr; }
+
+            /** Try to make the next 'size' bytes accessible.
+                \return Number of accessible bytes, which is less than 'size' only at the end of the input.
+            */
+            size_t available(size_t size)
+            {
+                if ((size_t)(mpEnd - mpPos) < size) refill(size);
+                return std::min(size, (size_t)(mpEnd - mpPos));
+            }
+
+            /** Get a pointer to the next 'size' bytes. Throws if the input ends before.
+                The pointer is valid until the next call to available() or require().
+            */
+            const uint8_t* require(size_t size)
+            {
+                if (available(size) < size) throw RuntimeError("Unexpected end of PLY file.");
+                return mpPos;
+            }
+
+            void consume(size_t size)
+            {
+                FALCOR_ASSERT(size <= (size_t)(mpEnd - mpPos));
+                mpPos += size;
+            }
+
+            std::string readLine()
+            {
+                std::string line;
+                while (true)
+                {
+                    if (available(1) == 0) throw RuntimeError("Unexpected end of PLY header.");
+                    char c = (char)*mpPos++;
+                    if (c == '\n') break;
+                    if (c != '\r') line.push_back(c);
+                    if (line.size() > 4096) throw RuntimeError("Invalid PLY header.");
+                }
+                return line;
+            }
+
+            /** Read the next whitespace separated token.
+                The returned view is valid until the next call to any of the read functions.
+                \return The token or an empty view at the end of the input.
+            */
+            std::string_view readToken()
+            {
+                auto isSpace = [](uint8_t c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; };
+
+                while (true)
+                {
+                    if (available(1) == 0) return {};
+                    if (!isSpace(*mpPos)) break;
+                    ++mpPos;
+                }
+
+                size_t length = 0;
+                while (available(length + 1) > length && !isSpace(mpPos[length])) ++length;
+
+                std::string_view token(reinterpret_cast<const char*>(mpPos), length);
+                mpPos += length;
+                return token;
+            }
+
+        private:
+            void refill(size_t size)
+            {
+                if (!mpStream || mStreamEnded) return;
+
+                // Move the remaining bytes to the front and fill the rest of the buffer.
+                size_t filled = (size_t)(mpEnd - mpPos);
+                if (filled > 0 && mpPos != mBuffer.data()) std::memmove(mBuffer.data(), mpPos, filled);
+                mBuffer.resize(std::max({ mBuffer.size(), size, kStreamChunkSize }));
+
+                while (filled < mBuffer.size() && !mStreamEnded)
+                {
+                    if (mpStream->avail_in == 0)
+                    {
+                        if (mCompressedSize == 0) throw RuntimeError("Unexpected end of compressed PLY file.");
+                        uInt inputSize = (uInt)std::min<size_t>(mCompressedSize, UINT_MAX);
+                        mpStream->next_in = const_cast<Bytef*>(mpCompressed);
+                        mpStream->avail_in = inputSize;
+                        mpCompressed += inputSize;
+                        mCompressedSize -= inputSize;
+                    }
+
+                    uInt outputSize = (uInt)std::min<size_t>(mBuffer.size() - filled, UINT_MAX);
+                    mpStream->next_out = mBuffer.data() + filled;
+                    mpStream->avail_out = outputSize;
+
+                    int ret = inflate(mpStream.get(), Z_NO_FLUSH);
+                    if (ret == Z_STREAM_END) mStreamEnded = true;
+                    else if (ret != Z_OK) throw RuntimeError("Failed to decompress PLY file (error: {}).", ret);
+
+                    filled += outputSize - mpStream->avail_out;
+                }
+
+                mpPos = mBuffer.data();
+                mpEnd = mBuffer.data() + filled;
+            }
+
+            const uint8_t* mpPos = nullptr;
+            const uint8_t* mpEnd = nullptr;
+
+            std::unique_ptr<z_stream> mpStream;
+            const uint8_t* mpCompressed = nullptr;
+            size_t mCompressedSize = 0;
+            bool mStreamEnded = false;
+            std::vector<uint8_t> mBuffer;
+        };
+
+        double parseNumber(std::string_view token)
+        {
+            if (token.empty()) throw RuntimeError("Unexpected end of PLY file.");
+            double value;
+            auto result = fast_float::from_chars(token.data(), token.data() + token.size(), value);
+            if (result.ec != std::errc() || result.ptr != token.data() + token.size())
+            {
+                throw RuntimeError("Invalid number '{}' in PLY file.", token);
+            }
+            return value;
+        }
+
+        class Reader
+        {
+        public:
+            Reader(Input& input) : mInput(input) {}
+
+            PlyMesh read()
+            {
+                readHeader();
+
+                auto vertexIt = std::find_if(mElements.begin(), mElements.end(), [](const Element& e) { return e.name == "vertex"; });
+                if (vertexIt == mElements.end()) throw RuntimeError("PLY file has no vertex element.");
+                mVertexCount = vertexIt->count;
+                if (mVertexCount > UINT32_MAX) throw RuntimeError("PLY file has too many vertices.");
+
+                for (const auto& element : mElements)
+                {
+                    if (element.name == "vertex") readVertices(element);
+                    else if (element.name == "face") readFaces(element);
+                    else skipElement(element);
+                }
+
+                return std::move(mMesh);
+            }
+
+        private:
+            void readHeader()
+            {
+                if (mInput.readLine() != "ply") throw RuntimeError("Not a PLY file.");
+
+                std::optional<Format> format;
+                while (true)
+                {
+                    std::string line = mInput.readLine();
+                    auto tokens = splitString(line, " \t");
+                    if (tokens.empty()) continue;
+
+                    const auto& keyword = tokens[0];
+                    if (keyword == "end_header")
+                    {
+                        break;
+                    }
+                    else if (keyword == "comment" || keyword == "obj_info")
+                    {
+                        continue;
+                    }
+                    else if (keyword == "format" && tokens.size() == 3)
+                    {
+                        if (tokens[1] == "ascii") format = Format::Ascii;
+                        else if (tokens[1] == "binary_little_endian") format = Format::BinaryLittleEndian;
+                        else if (tokens[1] == "binary_big_endian") format = Format::BinaryBigEndian;
+                        else throw RuntimeError("Unknown PLY format '{}'.", tokens[1]);
+                    }
+                    else if (keyword == "element" && tokens.size() == 3)
+                    {
+                        Element element;
+                        element.name = tokens[1];
+                        element.count = (size_t)std::stoull(tokens[2]);
+                        mElements.push_back(std::move(element));
+                    }
+                    else if (keyword == "property" && !mElements.empty() && (tokens.size() == 3 || (tokens.size() == 5 && tokens[1] == "list")))
+                    {
+                        Property prop;
+                        bool isList = tokens.size() == 5;
+                        auto type = parseType(tokens[isList ? 3 : 1]);
+                        auto countType = isList ? parseType(tokens[2]) : Type::UInt8;
+                        if (!type || !countType) throw RuntimeError("Invalid PLY property '{}'.", line);
+                        prop.name = tokens.back();
+                        prop.type = *type;
+                        prop.isList = isList;
+                        prop.countType = *countType;
+                        mElements.back().properties.push_back(std::move(prop));
+                    }
+                    else
+                    {
+                        throw RuntimeError("Unexpected line '{}' in PLY header.", line);
+                    }
+                }
+
+                if (!format) throw RuntimeError("PLY header is missing the format.");
+                mFormat = *format;
+                mSwapBytes = mFormat == Format::BinaryBigEndian;
+
+                for (auto& element : mElements)
+                {
+                    size_t offset = 0;
+                    for (auto& prop : element.properties)
+                    {
+                        prop.offset = offset;
+                        offset += getTypeSize(prop.type);
+                    }
+                }
+            }
+
+            /** Size of a list property at the current input position. Consumes nothing.
+            */
+            size_t getListSize(const Property& prop, const uint8_t* p, int64_t& count)
+            {
+                count = readValue<int64_t>(p, prop.countType, mSwapBytes);
+                if (count < 0) throw RuntimeError("Invalid PLY list size {}.", count);
+                return getTypeSize(prop.countType) + (size_t)count * getTypeSize(prop.type);
+            }
+
+            /** Read a row of an element with list properties in binary format.
+                \param[in] onProperty Called with the property index and a pointer to the property data.
+            */
+            template<typename F>
+            void readBinaryRow(const Element& element, F onProperty)
+            {
+                for (size_t i = 0; i < element.properties.size(); ++i)
+                {
+                    const auto& prop = element.properties[i];
+                    size_t size = getTypeSize(prop.isList ? prop.countType : prop.type);
+                    const uint8_t* p = mInput.require(size);
+                    if (prop.isList)
+                    {
+                        int64_t count;
+                        size = getListSize(prop, p, count);
+                        p = mInput.require(size);
+                    }
+                    onProperty(i, p);
+                    mInput.consume(size);
+                }
+            }
+
+            void readVertices(const Element& element)
+            {
+                FALCOR_PROFILE_CPU("PlyReader::readVertices");
+
+                const VertexLayout layout(element);
+                mMesh.positions.resize(element.count);
+                if (layout.hasNormals()) mMesh.normals.resize(element.count);
+                if (layout.hasTexCrds()) mMesh.texCrds.resize(element.count);
+
+                std::vector<float> values(element.properties.size());
+                auto getValue = [&values](int i) { return values[i]; };
+
+                if (mFormat == Format::Ascii)
+                {
+                    for (size_t v = 0; v < element.count; ++v)
+                    {
+                        for (size_t i = 0; i < element.properties.size(); ++i)
+                        {
+                            const auto& prop = element.properties[i];
+                            if (prop.isList)
+                            {
+                                size_t count = (size_t)parseNumber(mInput.readToken());
+                                for (size_t j = 0; j < count; ++j) mInput.readToken();
+                            }
+                            else
+                            {
+                                values[i] = (float)parseNumber(mInput.readToken());
+                            }
+                        }
+                        layout.storeVertex(mMesh, v, getValue);
+                    }
+                }
+                else if (!element.hasFixedRowSize())
+                {
+                    for (size_t v = 0; v < element.count; ++v)
+                    {
+                        readBinaryRow(element, [&](size_t i, const uint8_t* p)
+                        {
+                            const auto& prop = element.properties[i];
+                            if (!prop.isList) values[i] = readValue<float>(p, prop.type, mSwapBytes);
+                        });
+                        layout.storeVertex(mMesh, v, getValue);
+                    }
+                }
+                else
+                {
+                    // Decode rows of fixed size in bulk. Mapped files are decoded at once, compressed files in chunks.
+                    const size_t rowSize = element.getRowSize();
+                    const size_t chunkRows = mInput.isStreaming() ? std::max<size_t>(1, kStreamChunkSize / rowSize) : element.count;
+
+                    for (size_t firstRow = 0; firstRow < element.count; firstRow += chunkRows)
+                    {
+                        const size_t rowCount = std::min(chunkRows, element.count - firstRow);
+                        const uint8_t* pRows = mInput.require(rowCount * rowSize);
+
+                        auto blockRange = NumericRange<size_t>(0, div_round_up(rowCount, kDecodeBlockSize));
+                        std::for_each(std::execution::par, blockRange.begin(), blockRange.end(), [&](size_t block)
+                        {
+                            const size_t blockEnd = std::min(rowCount, (block + 1) * kDecodeBlockSize);
+                            for (size_t r = block * kDecodeBlockSize; r < blockEnd; ++r)
+                            {
+                                const uint8_t* pRow = pRows + r * rowSize;
+                                layout.storeVertex(mMesh, firstRow + r, [&](int i)
+                                {
+                                    const auto& prop = element.properties[i];
+                                    return readValue<float>(pRow + prop.offset, prop.type, mSwapBytes);
+                                });
+                            }
+                        });
+
+                        mInput.consume(rowCount * rowSize);
+                    }
+                }
+            }
+
+            void addPolygon(const uint32_t* pPolygon, size_t count)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    if (pPolygon[i] >= mVertexCount) throw RuntimeError("PLY vertex index {} is out of range.", pPolygon[i]);
+                }
+                // Triangulate as a fan.
+                for (size_t i = 1; i + 1 < count; ++i)
+                {
+                    mMesh.indices.push_back(pPolygon[0]);
+                    mMesh.indices.push_back(pPolygon[i]);
+                    mMesh.indices.push_back(pPolygon[i + 1]);
+                }
+            }
+
+            void readFaces(const Element& element)
+            {
+                FALCOR_PROFILE_CPU("PlyReader::readFaces");
+
+                int indexProperty = element.findProperty("vertex_indices");
+                if (indexProperty < 0) indexProperty = element.findProperty("vertex_index");
+                if (indexProperty < 0 || !element.properties[indexProperty].isList) throw RuntimeError("PLY face element is missing the vertex index list.");
+
+                mMesh.indices.reserve(mMesh.indices.size() + element.count * 3);
+                std::vector<uint32_t> polygon;
+
+                auto toIndex = [](int64_t value) { return (value < 0 || value > UINT32_MAX) ? UINT32_MAX : (uint32_t)value; };
+
+                for (size_t f = 0; f < element.count; ++f)
+                {
+                    if (mFormat == Format::Ascii)
+                    {
+                        for (size_t i = 0; i < element.properties.size(); ++i)
+                        {
+                            const auto& prop = element.properties[i];
+                            if (!prop.isList)
+                            {
+                                mInput.readToken();
+                                continue;
+                            }
+                            size_t count = (size_t)parseNumber(mInput.readToken());
+                            polygon.resize(count);
+                            for (size_t j = 0; j < count; ++j) polygon[j] = toIndex((int64_t)parseNumber(mInput.readToken()));
+                            if ((int)i == indexProperty) addPolygon(polygon.data(), count);
+                        }
+                    }
+                    else
+                    {
+                        readBinaryRow(element, [&](size_t i, const uint8_t* p)
+                        {
+                            if ((int)i != indexProperty) return;
+                            const auto& prop = element.properties[i];
+                            int64_t count;
+                            getListSize(prop, p, count);
+                            const size_t countSize = getTypeSize(prop.countType);
+                            const size_t valueSize = getTypeSize(prop.type);
+                            polygon.resize((size_t)count);
+                            for (size_t j = 0; j < (size_t)count; ++j)
+                            {
+                                polygon[j] = toIndex(readValue<int64_t>(p + countSize + j * valueSize, prop.type, mSwapBytes));
+                            }
+                            addPolygon(polygon.data(), polygon.size());
+                        });
+                    }
+                }
+            }
+
+            void skipElement(const Element& element)
+            {
+                if (mFormat == Format::Ascii)
+                {
+                    for (size_t r = 0; r < element.count; ++r)
+                    {
+                        for (const auto& prop : element.properties)
+                        {
+                            size_t count = prop.isList ? (size_t)parseNumber(mInput.readToken()) : 1;
+                            for (size_t j = 0; j < count; ++j) mInput.readToken();
+                        }
+                    }
+                }
+                else if (element.hasFixedRowSize())
+                {
+                    size_t remaining = element.count * element.getRowSize();
+                    while (remaining > 0)
+                    {
+                        size_t size = std::min(remaining, kStreamChunkSize);
+                        mInput.require(size);
+                        mInput.consume(size);
+                        remaining -= size;
+                    }
+                }
+                else
+                {
+                    for (size_t r = 0; r < element.count; ++r) readBinaryRow(element, [](size_t, const uint8_t*) {});
+                }
+            }
+
+            Input& mInput;
+            Format mFormat = Format::Ascii;
+            bool mSwapBytes = false;
+            std::vector<Element> mElements;
+            size_t mVertexCount = 0;
+            PlyMesh mMesh;
+        };
+    }
+
+    std::vector<float3> PlyMesh::computeFaceNormals() const
+    {
+        std::vector<float3> faceNormals(getTriangleCount());
+        for (size_t i = 0; i < faceNormals.size(); ++i)
+        {
+            const float3& p0 = positions[indices[i * 3]];
+            const float3& p1 = positions[indices[i * 3 + 1]];
+            const float3& p2 = positions[indices[i * 3 + 2]];
+            float3 n = cross(p1 - p0, p2 - p0);
+            float len = length(n);
+            faceNormals[i] = len > 0.f ? n / len : float3(0.f);
+        }
+        return faceNormals;
+    }
+
+    std::vector<float3> PlyMesh::computeVertexNormals() const
+    {
+        std::vector<float3> vertexNormals(positions.size(), float3(0.f));
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            const float3& p0 = positions[indices[i]];
+            const float3& p1 = positions[indices[i + 1]];
+            const float3& p2 = positions[indices[i + 2]];
+            // The cross product is proportional to the triangle area.
+            float3 n = cross(p1 - p0, p2 - p0);
+            for (size_t j = 0; j < 3; ++j) vertexNormals[indices[i + j]] += n;
+        }
+        for (auto& n : vertexNormals)
+        {
+            float len = length(n);
+            n = len > 0.f ? n / len : float3(0.f);
+        }
+        return vertexNormals;
+    }
+
+    PlyMesh PlyReader::read(const std::filesystem::path& path)
+    {
+        FALCOR_PROFILE_CPU("PlyReader::read");
+
+        MemoryMappedFile file(path);
+        try
+        {
+            return read(file.getData(), file.getSize(), hasExtension(path, "gz"));
+        }
+        catch (const RuntimeError& e)
+        {
+            throw RuntimeError("Failed to read PLY file '{}': {}", path, e.what());
+        }
+    }
+
+    PlyMesh PlyReader::read(const void* pData, size_t size, bool compressed)
+    {
+        Input input(static_cast<const uint8_t*>(pData), size, compressed);
+        Reader reader(input);
+        return reader.read();
+    }
+}
@@ -0,0 +1,86 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include "Utils/Math/Vector.h"
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+namespace Falcor
+{
+    /** Triangle mesh loaded from a PLY file.
+        Attributes are stored in separate arrays so they can be referenced by SceneBuilder::Mesh without conversion.
+    */
+    struct FALCOR_API PlyMesh
+    {
+        std::vector<float3> positions;
+        std::vector<float3> normals;    ///< Per-vertex normals, or empty if the file has none.
+        std::vector<float2> texCrds;    ///< Per-vertex texture coordinates as stored in the file, or empty if the file has none.
+        std::vector<uint32_t> indices;  ///< Triangle list. Polygons are triangulated as fans.
+
+        uint32_t getVertexCount() const { return (uint32_t)positions.size(); }
+        uint32_t getTriangleCount() const { return (uint32_t)(indices.size() / 3); }
+
+        /** Compute a normal for each triangle based on its winding.
+            \return Normalized face normals, zero for degenerate triangles.
+        */
+        std::vector<float3> computeFaceNormals() const;
+
+        /** Compute smooth vertex normals by accumulating the area weighted normals of adjacent triangles.
+            \return Normalized vertex normals, zero for vertices without non-degenerate triangles.
+        */
+        std::vector<float3> computeVertexNormals() const;
+    };
+
+    /** Reader for PLY files in ASCII and binary (little and big endian) format.
+        Uncompressed files are memory mapped and vertex data is decoded in bulk in parallel. Files with a .gz
+        extension are decompressed while streaming through them, so the decompressed file is never held in memory.
+        Only the 'vertex' and 'face' elements are read, all other elements are skipped. Supported vertex properties
+        are positions (x, y, z), normals (nx, ny, nz) and texture coordinates (u, v / s, t / texture_u, texture_v / texture_s, texture_t).
+    */
+    class FALCOR_API PlyReader
+    {
+    public:
+        /** Read a PLY file.
+            Throws an exception if the file cannot be read or is malformed.
+            \param[in] path File path. Files with a .gz extension are decompressed.
+            \return The loaded mesh.
+        */
+        static PlyMesh read(const std::filesystem::path& path);
+
+        /** Read a PLY file from memory.
+            Throws an exception if the data is malformed.
+            \param[in] pData PLY file contents.
+            \param[in] size Size of the file contents in bytes.
+            \param[in] compressed True if the data is zlib/gzip compressed.
+            \return The loaded mesh.
+        */
+        static PlyMesh read(const void* pData, size_t size, bool compressed = false);
+    };
+}
@@ -224,7 +224,7 @@ namespace Falcor
         }
 
         // Must be placed after curve data/AABB creation.
-        mpAnimationController->addAnimatedVertexCaches(std::move(sceneData.cachedCurves), std::move(sceneData.cachedMeshes), sceneData.meshStaticData);
+        mpAnimationController->addAnimatedVertexCaches(std::move(sceneData.cachedCurves), std::move(sceneData.cachedMeshes), sceneData.meshStaticData, sceneData.streamVertexCacheKeyframes);
 
         // Finalize scene.
         finalize();
@@ -1662,7 +1662,7 @@ namespace Falcor
         }
 
         // Update light collection
-        if (mpLightCollection && mpLightCollection->update(pContext))
+        if (mpLightCollection && mpLightCollection->update(pContext, &mLightCollectionUpdates))
         {
             mUpdates |= UpdateFlags::LightCollectionChanged;
             mSceneStats.emissiveMemoryInBytes = mpLightCollection->getMemoryUsageInBytes();
@@ -314,6 +314,7 @@ namespace Falcor
             std::vector<std::vector<uint32_t>> meshIdToInstanceIds; ///< Mapping of what instances belong to which mesh.
             std::vector<MeshGroup> meshGroups;                      ///< List of mesh groups. Each group maps to a BLAS for ray tracing.
             std::vector<CachedMesh> cachedMeshes;                   ///< Cached data for vertex-animated meshes.
+            bool streamVertexCacheKeyframes = false;                ///< True if vertex cache keyframes should be streamed instead of kept in GPU memory.
             uint32_t prevVertexCount = 0;                           ///< Number of vertices that the AnimationController needs to allocate to store previous frame vertices.
 
             bool useCompressedHitInfo = false;                      ///< True if scene should used compressed HitInfo (on scenes with triangles meshes only).
@@ -889,6 +890,11 @@ namespace Falcor
         */
         const LightCollection::SharedPtr& getLightCollection(RenderContext* pContext);
 
+        /** Get the per mesh light changes of the last update() call, indexed like LightCollection::getMeshLights().
+            The list is empty if the light collection has not been created.
+        */
+        const LightCollection::UpdateStatus& getLightCollectionUpdates() const { return mLightCollectionUpdates; }
+
         /** Get the environment map or nullptr if it doesn't exist.
         */
         const EnvMap::SharedPtr& getEnvMap() const { return mpEnvMap; }
@@ -1259,6 +1265,7 @@ namespace Falcor
         std::vector<Grid::SharedPtr> mGrids;                        ///< All loaded grids.
         std::unordered_map<Grid::SharedPtr, SdfGridID> mGridIDs;    ///< Lookup table for grid IDs.
         LightCollection::SharedPtr mpLightCollection;               ///< Class for managing emissive geometry. This is created lazily upon first use.
+        LightCollection::UpdateStatus mLightCollectionUpdates;      ///< Per mesh light changes of the last update.
         EnvMap::SharedPtr mpEnvMap;                                 ///< Environment map or nullptr if not loaded.
         bool mEnvMapChanged = false;                                ///< Flag indicating that the environment map has changed since last frame.
         LightProfile::SharedPtr mpLightProfile;                     ///< DEMO21: Global light profile.
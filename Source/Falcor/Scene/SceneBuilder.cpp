@@ -33,6 +33,7 @@
 #include "Utils/Logger.h"
 #include "Utils/Math/Common.h"
 #include "Utils/Image/TextureAnalyzer.h"
+#include "Utils/Timing/CpuProfiler.h"
 #include "Utils/Timing/TimeReport.h"
 #include "Utils/Scripting/ScriptBindings.h"
 #include "Utils/Math/MathHelpers.h"
@@ -262,8 +263,13 @@ namespace Falcor
     {
         if (mpScene) return mpScene;
 
+        FALCOR_PROFILE_CPU("SceneBuilder::getScene");
+
         // Finish loading textures. This blocks until all textures are loaded and assigned.
-        mpMaterialTextureLoader.reset();
+        {
+            FALCOR_PROFILE_CPU("SceneBuilder::waitForTextures");
+            mpMaterialTextureLoader.reset();
+        }
 
         // If no meshes were added, we create a dummy mesh to keep the scene generation working.
         // Scenes with no meshes can be useful for example when using volumes in isolation.
@@ -325,6 +331,7 @@ namespace Falcor
         for (auto& sdfInstanceData : mSceneData.sdfGridInstances) sdfInstanceData.instanceIndex = tlasInstanceIndex++;
 
         mSceneData.useCompressedHitInfo = is_set(mFlags, Flags::UseCompressedHitInfo);
+        mSceneData.streamVertexCacheKeyframes = is_set(mFlags, Flags::StreamVertexCacheKeyframes);
 
         // Write scene cache if requested.
         if (mWriteSceneCache)
@@ -351,6 +358,11 @@ namespace Falcor
     }
 
     MeshID SceneBuilder::addTriangleMesh(const TriangleMesh::SharedPtr& pTriangleMesh, const Material::SharedPtr& pMaterial)
+    {
+        return addProcessedMesh(processTriangleMesh(pTriangleMesh, pMaterial));
+    }
+
+    SceneBuilder::ProcessedMesh SceneBuilder::processTriangleMesh(const TriangleMesh::SharedPtr& pTriangleMesh, const Material::SharedPtr& pMaterial) const
     {
         checkArgument(pTriangleMesh != nullptr, "'pTriangleMesh' is missing");
         checkArgument(pMaterial != nullptr, "'pMaterial' is missing");
@@ -380,7 +392,7 @@ namespace Falcor
         mesh.normals = { normals.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
         mesh.texCrds = { texCoords.data(), SceneBuilder::Mesh::AttributeFrequency::Vertex };
 
-        return addMesh(mesh);
+        return processMesh(mesh);
     }
 
     SceneBuilder::ProcessedMesh SceneBuilder::processMesh(const Mesh& mesh_, MeshAttributeIndices* pAttributeIndices) const
@@ -2819,6 +2831,7 @@ namespace Falcor
         flags.value("DontUseDisplacement", SceneBuilder::Flags::DontUseDisplacement);
         flags.value("UseCompressedHitInfo", SceneBuilder::Flags::UseCompressedHitInfo);
         flags.value("TessellateCurvesIntoPolyTubes", SceneBuilder::Flags::TessellateCurvesIntoPolyTubes);
+        flags.value("StreamVertexCacheKeyframes", SceneBuilder::Flags::StreamVertexCacheKeyframes);
         flags.value("UseCache", SceneBuilder::Flags::UseCache);
         flags.value("RebuildCache", SceneBuilder::Flags::RebuildCache);
         ScriptBindings::addEnumBinaryOperators(flags);
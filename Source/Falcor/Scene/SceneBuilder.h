@@ -76,6 +76,7 @@ namespace Falcor
             DontUseDisplacement             = 0x4000,   ///< Don't use displacement mapping.
             UseCompressedHitInfo            = 0x8000,   ///< Use compressed hit info (on scenes with triangle meshes only).
             TessellateCurvesIntoPolyTubes   = 0x10000,  ///< Tessellate curves into poly-tubes (the default is linear swept spheres).
+            StreamVertexCacheKeyframes      = 0x20000,  ///< Keep vertex cache keyframes compressed on the host and stream a sliding window of them to the GPU during playback.
 
             UseCache                        = 0x10000000, ///< Enable scene caching. This caches the runtime scene representation on disk to reduce load time.
             RebuildCache                    = 0x20000000, ///< Rebuild scene cache.
@@ -402,6 +403,14 @@ namespace Falcor
         */
         ProcessedMesh processMesh(const Mesh& mesh, MeshAttributeIndices* pAttributeIndices = nullptr) const;
 
+        /** Pre-process a triangle mesh into the data format that is used in the global scene buffers.
+            This is thread safe and can be used to prepare meshes in parallel before adding them with addProcessedMesh().
+            \param pTriangleMesh The triangle mesh to pre-process.
+            \param pMaterial The material to use for the mesh.
+            \return The pre-processed mesh.
+        */
+        ProcessedMesh processTriangleMesh(const TriangleMesh::SharedPtr& pTriangleMesh, const Material::SharedPtr& pMaterial) const;
+
         /** Generate tangents for a mesh.
             \param mesh The mesh to generate tangents for. If successful, the tangent attribute on the mesh will be set to the output vector.
             \param tangents Output for generated tangents.
@@ -30,6 +30,7 @@
 #include "Material/HairMaterial.h"
 #include "Material/ClothMaterial.h"
 #include "Material/MaterialTextureLoader.h"
+#include "Volume/GridBrickCache.h"
 #include "Utils/Logger.h"
 
 #include <lz4_stream/lz4_stream.h>
@@ -44,7 +45,7 @@ namespace Falcor
         /** Specfies the current cache file version.
             This needs to be incremented every time the file format changes!
         */
-        const uint32_t kVersion = 25;
+        const uint32_t kVersion = 27;
 
         /** Scene cache directory (subdirectory in the application data directory).
         */
@@ -347,6 +348,7 @@ namespace Falcor
             for (const auto& data : cachedMesh.vertexData) stream.write(data);
         }
         stream.write(sceneData.useCompressedHitInfo);
+        stream.write(sceneData.streamVertexCacheKeyframes);
         stream.write(sceneData.has16BitIndices);
         stream.write(sceneData.has32BitIndices);
         stream.write(sceneData.meshDrawCount);
@@ -468,6 +470,7 @@ namespace Falcor
             for (auto& data : cachedMesh.vertexData) stream.read(data);
         }
         stream.read(sceneData.useCompressedHitInfo);
+        stream.read(sceneData.streamVertexCacheKeyframes);
         stream.read(sceneData.has16BitIndices);
         stream.read(sceneData.has32BitIndices);
         stream.read(sceneData.meshDrawCount);
@@ -859,6 +862,7 @@ namespace Falcor
 
     void SceneCache::writeGrid(OutputStream& stream, const Grid::SharedPtr& pGrid)
     {
+        stream.write(pGrid->mBrickCacheKey);
         const nanovdb::HostBuffer& buffer = pGrid->mGridHandle.buffer();
         stream.write((uint64_t)buffer.size());
         stream.write(buffer.data(), buffer.size());
@@ -866,9 +870,16 @@ namespace Falcor
 
     Grid::SharedPtr SceneCache::readGrid(InputStream& stream)
     {
+        auto brickCacheKey = stream.read<std::optional<SHA1::MD>>();
         uint64_t size = stream.read<uint64_t>();
         auto buffer = nanovdb::HostBuffer::create(size);
         stream.read(buffer.data(), buffer.size());
+
+        // Skip the brick conversion if the grid is still available in the grid brick cache.
+        if (brickCacheKey)
+        {
+            if (auto pGrid = GridBrickCache::readGrid(*brickCacheKey)) return pGrid;
+        }
         return Grid::SharedPtr(new Grid(nanovdb::GridHandle<nanovdb::HostBuffer>(std::move(buffer))));
     }
 
@@ -26,7 +26,9 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #include "TriangleMesh.h"
+#include "PlyReader.h"
 #include "Core/Assert.h"
+#include "Core/Errors.h"
 #include "Core/Platform/OS.h"
 #include "Utils/Logger.h"
 #include "Utils/Scripting/ScriptBindings.h"
@@ -37,6 +39,56 @@
 
 namespace Falcor
 {
+    namespace
+    {
+        bool isPlyFile(const std::filesystem::path& path)
+        {
+            return hasExtension(path, "ply") || (hasExtension(path, "gz") && hasExtension(path.stem(), "ply"));
+        }
+
+        /** Convert a mesh loaded with the PLY reader.
+            Matches the result of loading through ASSIMP, i.e. texture coordinates are flipped and
+            facet normals are generated by splitting vertices.
+        */
+        TriangleMesh::SharedPtr createFromPlyMesh(const PlyMesh& plyMesh, bool smoothNormals)
+        {
+            auto getTexCoord = [&](uint32_t i)
+            {
+                return plyMesh.texCrds.empty() ? float2(0.f) : float2(plyMesh.texCrds[i].x, 1.f - plyMesh.texCrds[i].y);
+            };
+
+            TriangleMesh::VertexList vertices;
+            TriangleMesh::IndexList indices;
+
+            if (!plyMesh.normals.empty() || smoothNormals)
+            {
+                std::vector<float3> generatedNormals;
+                if (plyMesh.normals.empty()) generatedNormals = plyMesh.computeVertexNormals();
+                const auto& normals = plyMesh.normals.empty() ? generatedNormals : plyMesh.normals;
+                vertices.resize(plyMesh.getVertexCount());
+                for (uint32_t i = 0; i < plyMesh.getVertexCount(); ++i)
+                {
+                    vertices[i] = { plyMesh.positions[i], normals[i], getTexCoord(i) };
+                }
+                indices = plyMesh.indices;
+            }
+            else
+            {
+                auto faceNormals = plyMesh.computeFaceNormals();
+                vertices.resize(plyMesh.indices.size());
+                indices.resize(plyMesh.indices.size());
+                for (uint32_t i = 0; i < (uint32_t)plyMesh.indices.size(); ++i)
+                {
+                    uint32_t index = plyMesh.indices[i];
+                    vertices[i] = { plyMesh.positions[index], faceNormals[i / 3], getTexCoord(index) };
+                    indices[i] = i;
+                }
+            }
+
+            return TriangleMesh::create(vertices, indices);
+        }
+    }
+
     TriangleMesh::SharedPtr TriangleMesh::create()
     {
         return SharedPtr(new TriangleMesh());
@@ -201,6 +253,20 @@ namespace Falcor
             return nullptr;
         }
 
+        // PLY files are loaded with the native reader, which avoids building an intermediate ASSIMP scene.
+        if (isPlyFile(fullPath))
+        {
+            try
+            {
+                return createFromPlyMesh(PlyReader::read(fullPath), smoothNormals);
+            }
+            catch (const RuntimeError& e)
+            {
+                logWarning("Failed to load triangle mesh from '{}': {}", fullPath, e.what());
+                return nullptr;
+            }
+        }
+
         Assimp::Importer importer;
 
         unsigned int flags =
@@ -101,7 +101,7 @@ namespace Falcor
         static SharedPtr createSphere(float radius = 0.5f, uint32_t segmentsU = 32, uint32_t segmentsV = 16);
 
         /** Creates a triangle mesh from a file.
-            This is using ASSIMP to support a wide variety of asset formats.
+            This is using ASSIMP to support a wide variety of asset formats. PLY files (including .ply.gz) are loaded with PlyReader.
             All geometry found in the asset is pre-transformed and merged into the same triangle mesh.
             \param[in] path File path to load mesh from.
             \param[in] smoothNormals If no normals are defined in the model, generate smooth instead of facet normals.
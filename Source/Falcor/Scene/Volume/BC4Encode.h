@@ -65,30 +65,36 @@ static void FixRange(int& min, int& max, int steps)
 static int FitCodes(uint8_t const* tile, uint8_t const* codes, uint8_t* indices)
 {
     // fit each alpha value to the codebook
-    int err = 0;
+    // all 16 values are compared against one code at a time, which lets the compiler vectorize the inner loop
+    int least[16];
+    uint8_t best[16];
     for (int i = 0; i < 16; ++i)
     {
-        // find the least error and corresponding index
-        int value = (int)(tile[i]);
-        int least = INT_MAX;
-        int index = 0;
-        for (int j = 0; j < 8; ++j)
+        least[i] = INT_MAX;
+        best[i] = 0;
+    }
+    for (int j = 0; j < 8; ++j)
+    {
+        int code = (int)codes[j];
+        for (int i = 0; i < 16; ++i)
         {
             // get the squared error from this code
-            int dist = (int)value - (int)codes[j];
+            int dist = (int)tile[i] - code;
             dist *= dist;
 
-            // compare with the best so far
-            if (dist < least)
-            {
-                least = dist;
-                index = j;
-            }
+            // compare with the best so far, keeping the first code on ties
+            bool closer = dist < least[i];
+            least[i] = closer ? dist : least[i];
+            best[i] = closer ? (uint8_t)j : best[i];
         }
+    }
 
-        // save this index and accumulate the error
-        indices[i] = (uint8_t)index;
-        err += least;
+    // save the indices and accumulate the error
+    int err = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        indices[i] = best[i];
+        err += least[i];
     }
 
     // return the total error
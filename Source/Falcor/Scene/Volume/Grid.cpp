@@ -26,6 +26,7 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #include "Grid.h"
+#include "GridBrickCache.h"
 #include "GridConverter.h"
 #include "Core/Program/ShaderVar.h"
 #include "Utils/StringUtils.h"
@@ -86,7 +87,7 @@ namespace Falcor
         return SharedPtr(new Grid(std::move(handle)));
     }
 
-    Grid::SharedPtr Grid::createFromFile(const std::filesystem::path& path, const std::string& gridname)
+    Grid::SharedPtr Grid::createFromFile(const std::filesystem::path& path, const std::string& gridname, bool useCache)
     {
         std::filesystem::path fullPath;
         if (!findFileInDataDirectories(path, fullPath))
@@ -95,19 +96,32 @@ namespace Falcor
             return nullptr;
         }
 
-        if (hasExtension(fullPath, "nvdb"))
-        {
-            return createFromNanoVDBFile(fullPath, gridname);
-        }
-        else if (hasExtension(fullPath, "vdb"))
-        {
-            return createFromOpenVDBFile(fullPath, gridname);
-        }
-        else
+        const bool isNanoVDB = hasExtension(fullPath, "nvdb");
+        if (!isNanoVDB && !hasExtension(fullPath, "vdb"))
         {
             logWarning("Error when loading grid. Unsupported grid file '{}'.", fullPath);
             return nullptr;
         }
+
+        std::optional<GridBrickCache::Key> cacheKey;
+        if (useCache)
+        {
+            try
+            {
+                cacheKey = GridBrickCache::computeKey(fullPath, gridname);
+                if (auto pGrid = GridBrickCache::readGrid(*cacheKey)) return pGrid;
+            }
+            catch (const RuntimeError& e)
+            {
+                logWarning("Failed to compute grid brick cache key for '{}': {}", fullPath, e.what());
+            }
+        }
+
+        auto handle = isNanoVDB ? loadNanoVDBFile(fullPath, gridname) : loadOpenVDBFile(fullPath, gridname);
+        if (!handle) return nullptr;
+
+        if (cacheKey) return GridBrickCache::writeGrid(*cacheKey, std::move(handle));
+        return SharedPtr(new Grid(std::move(handle)));
     }
 
     void Grid::renderUI(Gui::Widgets& widget)
@@ -200,10 +214,11 @@ namespace Falcor
         return rmcv::translate(rmcv::mat4(invAffine), -translation);
     }
 
-    Grid::Grid(nanovdb::GridHandle<nanovdb::HostBuffer> gridHandle)
+    Grid::Grid(nanovdb::GridHandle<nanovdb::HostBuffer> gridHandle, BrickedGrid brickedGrid)
         : mGridHandle(std::move(gridHandle))
         , mpFloatGrid(mGridHandle.grid<float>())
         , mAccessor(mpFloatGrid->getAccessor())
+        , mBrickedGrid(std::move(brickedGrid))
     {
         if (!mpFloatGrid->hasMinMax())
         {
@@ -218,42 +233,45 @@ namespace Falcor
             Buffer::CpuAccess::None,
             mGridHandle.data()
         );
-        using NanoVDBGridConverter = NanoVDBConverterBC4;
-        mBrickedGrid = NanoVDBGridConverter(mpFloatGrid).convert();
+        if (!mBrickedGrid.atlas)
+        {
+            using NanoVDBGridConverter = NanoVDBConverterBC4;
+            mBrickedGrid = NanoVDBGridConverter(mpFloatGrid).convert();
+        }
     }
 
-    Grid::SharedPtr Grid::createFromNanoVDBFile(const std::filesystem::path& path, const std::string& gridname)
+    nanovdb::GridHandle<nanovdb::HostBuffer> Grid::loadNanoVDBFile(const std::filesystem::path& path, const std::string& gridname)
     {
         if (!nanovdb::io::hasGrid(path.string(), gridname))
         {
             logWarning("Error when loading grid. Can't find grid '{}' in '{}'.", gridname, path);
-            return nullptr;
+            return {};
         }
 
         auto handle = nanovdb::io::readGrid(path.string(), gridname);
         if (!handle)
         {
             logWarning("Error when loading grid.");
-            return nullptr;
+            return {};
         }
 
         auto floatGrid = handle.grid<float>();
         if (!floatGrid || floatGrid->gridType() != nanovdb::GridType::Float)
         {
             logWarning("Error when loading grid. Grid '{}' in '{}' is not of type float.", gridname, path);
-            return nullptr;
+            return {};
         }
 
         if (floatGrid->isEmpty())
         {
             logWarning("Grid '{}' in '{}' is empty.", gridname, path);
-            return nullptr;
+            return {};
         }
 
-        return SharedPtr(new Grid(std::move(handle)));
+        return handle;
     }
 
-    Grid::SharedPtr Grid::createFromOpenVDBFile(const std::filesystem::path& path, const std::string& gridname)
+    nanovdb::GridHandle<nanovdb::HostBuffer> Grid::loadOpenVDBFile(const std::filesystem::path& path, const std::string& gridname)
     {
         openvdb::initialize();
 
@@ -275,25 +293,23 @@ namespace Falcor
         if (!baseGrid)
         {
             logWarning("Error when loading grid. Can't find grid '{}' in '{}'.", gridname, path);
-            return nullptr;
+            return {};
         }
 
         if (!baseGrid->isType<openvdb::FloatGrid>())
         {
             logWarning("Error when loading grid. Grid '{}' in '{}' is not of type float.", gridname, path);
-            return nullptr;
+            return {};
         }
 
         if (baseGrid->empty())
         {
             logWarning("Grid '{}' in '{}' is empty.", gridname, path);
-            return nullptr;
+            return {};
         }
 
         openvdb::FloatGrid::Ptr floatGrid = openvdb::gridPtrCast<openvdb::FloatGrid>(baseGrid);
-        auto handle = nanovdb::openToNanoVDB(floatGrid);
-
-        return SharedPtr(new Grid(std::move(handle)));
+        return nanovdb::openToNanoVDB(floatGrid);
     }
 
 
@@ -312,6 +328,6 @@ namespace Falcor
 
         grid.def_static("createSphere", &Grid::createSphere, "radius"_a, "voxelSize"_a, "blendRange"_a = 3.f);
         grid.def_static("createBox", &Grid::createBox, "width"_a, "height"_a, "depth"_a, "voxelSize"_a, "blendRange"_a = 3.f);
-        grid.def_static("createFromFile", &Grid::createFromFile, "path"_a, "gridname"_a);
+        grid.def_static("createFromFile", &Grid::createFromFile, "path"_a, "gridname"_a, "useCache"_a = true);
     }
 }
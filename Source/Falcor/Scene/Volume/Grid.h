@@ -31,6 +31,7 @@
 #include "Core/Macros.h"
 #include "Core/API/Buffer.h"
 #include "Utils/Math/AABB.h"
+#include "Utils/CryptoUtils.h"
 #include "Utils/Math/Matrix.h"
 #include "Utils/UI/Gui.h"
 
@@ -47,6 +48,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <optional>
 #include <string>
 
 namespace Falcor
@@ -80,11 +82,14 @@ namespace Falcor
 
         /** Create a grid from a file.
             Currently only OpenVDB and NanoVDB grids of type float are supported.
+            The bricked representation is stored in the grid brick cache (see GridBrickCache), keyed by the file content,
+            so that subsequent loads of the same grid skip the conversion.
             \param[in] path File path of the grid. Can also include a full path or relative path from a data directory.
             \param[in] gridname Name of the grid to load.
+            \param[in] useCache Read from and write to the grid brick cache.
             \return A new grid, or nullptr if the grid failed to load.
         */
-        static SharedPtr createFromFile(const std::filesystem::path& path, const std::string& gridname);
+        static SharedPtr createFromFile(const std::filesystem::path& path, const std::string& gridname, bool useCache = true);
 
         /** Render the UI.
         */
@@ -133,6 +138,10 @@ namespace Falcor
         */
         const nanovdb::GridHandle<nanovdb::HostBuffer>& getGridHandle() const;
 
+        /** Get the bricked representation of the grid.
+        */
+        const BrickedGrid& getBrickedGrid() const { return mBrickedGrid; }
+
         /** Get the (affine) NanoVDB transformation matrix.
         */
         rmcv::mat4 getTransform() const;
@@ -142,10 +151,14 @@ namespace Falcor
         rmcv::mat4 getInvTransform() const;
 
     private:
-        Grid(nanovdb::GridHandle<nanovdb::HostBuffer> gridHandle);
+        /** Create a grid from a NanoVDB grid handle.
+            \param[in] gridHandle Handle of a float grid.
+            \param[in] brickedGrid Bricked representation of the grid. If empty, the grid is converted.
+        */
+        Grid(nanovdb::GridHandle<nanovdb::HostBuffer> gridHandle, BrickedGrid brickedGrid = {});
 
-        static SharedPtr createFromNanoVDBFile(const std::filesystem::path& path, const std::string& gridname);
-        static SharedPtr createFromOpenVDBFile(const std::filesystem::path& path, const std::string& gridname);
+        static nanovdb::GridHandle<nanovdb::HostBuffer> loadNanoVDBFile(const std::filesystem::path& path, const std::string& gridname);
+        static nanovdb::GridHandle<nanovdb::HostBuffer> loadOpenVDBFile(const std::filesystem::path& path, const std::string& gridname);
 
         // Host data.
         nanovdb::GridHandle<nanovdb::HostBuffer> mGridHandle;
@@ -155,6 +168,9 @@ namespace Falcor
         Buffer::SharedPtr mpBuffer;
         BrickedGrid mBrickedGrid;
 
+        std::optional<SHA1::MD> mBrickCacheKey; ///< Key of the grid in the grid brick cache, if stored there.
+
+        friend class GridBrickCache;
         friend class SceneCache;
     };
 }
@@ -0,0 +1,321 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "GridBrickCache.h"
+#include "GridConverter.h"
+#include "Core/Errors.h"
+#include "Core/API/Formats.h"
+#include "Core/Platform/MemoryMappedFile.h"
+#include "Core/Platform/OS.h"
+#include "Utils/Logger.h"
+#include "Utils/NumericRange.h"
+#include "Utils/Math/Common.h"
+#include "Utils/Timing/CpuProfiler.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4146 4244 4267 4275 4996)
+#endif
+#include <nanovdb/util/GridStats.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <execution>
+#include <fstream>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Specifies the current cache file version.
+            This needs to be incremented every time the file format or the brick conversion changes!
+        */
+        const uint32_t kVersion = 1;
+
+        /** Grid brick cache directory (subdirectory in the application data directory).
+        */
+        const std::string kDirectory = "NVIDIA/Falcor/GridCache";
+
+        const size_t kHashChunkSize = 64 * 1024 * 1024; ///< Grid files are hashed in chunks of this size in parallel.
+        const uint64_t kSectionAlignment = 256; ///< Alignment of the data sections in the cache file.
+        const uint32_t kRangeMipCount = 4;
+        const uint32_t kBrickSize = 8;
+
+        /** Cache file layout:
+            Header | NanoVDB grid | atlas | range (all mips) | indirection
+            All sections are aligned to kSectionAlignment so the file can be memory mapped and used in place.
+        */
+        const char* kMagic = "FalcorG$";
+        struct Section
+        {
+            uint64_t offset{};
+            uint64_t size{};
+        };
+
+        struct Header
+        {
+            uint8_t magic[8]{};
+            uint32_t version{};
+            uint32_t atlasFormat{}; ///< ResourceFormat of the atlas texture.
+            uint32_t leafDim[3]{};  ///< Size of the range and indirection textures (mip 0).
+            uint32_t atlasSize[3]{}; ///< Size of the atlas texture in pixels.
+            Section grid;
+            Section atlas;
+            Section range;
+            Section indirection;
+
+            bool isValid() const
+            {
+                return std::memcmp(magic, kMagic, sizeof(Header::magic)) == 0 && version == kVersion;
+            }
+        };
+
+        uint64_t getRangeSize(const uint32_t leafDim[3])
+        {
+            uint64_t size = 0;
+            for (uint32_t mip = 0; mip < kRangeMipCount; ++mip)
+            {
+                size += uint64_t(std::max(1u, leafDim[0] >> mip)) * std::max(1u, leafDim[1] >> mip) * std::max(1u, leafDim[2] >> mip) * sizeof(uint32_t);
+            }
+            return size;
+        }
+
+        uint64_t getAtlasSlabSize(ResourceFormat format, uint32_t width, uint32_t height)
+        {
+            uint64_t blocksX = width / getFormatWidthCompressionRatio(format);
+            uint64_t blocksY = height / getFormatHeightCompressionRatio(format);
+            return blocksX * blocksY * kBrickSize * getFormatBytesPerBlock(format);
+        }
+
+        void validateHeader(const Header& header, uint64_t fileSize)
+        {
+            if (!header.isValid()) throw RuntimeError("Invalid header.");
+
+            for (const Section& section : { header.grid, header.atlas, header.range, header.indirection })
+            {
+                if (section.offset % kSectionAlignment != 0 || section.offset > fileSize || section.size > fileSize - section.offset)
+                {
+                    throw RuntimeError("Section out of bounds.");
+                }
+            }
+
+            uint64_t leafCount = uint64_t(header.leafDim[0]) * header.leafDim[1] * header.leafDim[2];
+            if (leafCount == 0 || header.range.size != getRangeSize(header.leafDim) || header.indirection.size != leafCount * sizeof(uint32_t))
+            {
+                throw RuntimeError("Range or indirection size mismatch.");
+            }
+
+            ResourceFormat format = (ResourceFormat)header.atlasFormat;
+            if (format != ResourceFormat::BC4Unorm && format != ResourceFormat::R8Unorm && format != ResourceFormat::R16Unorm)
+            {
+                throw RuntimeError("Unsupported atlas format.");
+            }
+            if (header.atlasSize[0] % kBrickSize != 0 || header.atlasSize[1] % kBrickSize != 0 || header.atlasSize[2] % kBrickSize != 0 ||
+                header.atlas.size != getAtlasSlabSize(format, header.atlasSize[0], header.atlasSize[1]) * (header.atlasSize[2] / kBrickSize))
+            {
+                throw RuntimeError("Atlas size mismatch.");
+            }
+        }
+
+        uint64_t alignStream(std::ostream& stream)
+        {
+            static const char kZeros[kSectionAlignment] = {};
+            uint64_t offset = (uint64_t)stream.tellp();
+            uint64_t padding = align_to(kSectionAlignment, offset) - offset;
+            stream.write(kZeros, padding);
+            return offset + padding;
+        }
+
+        Section writeSection(std::ostream& stream, const void* pData, uint64_t size)
+        {
+            Section section;
+            section.offset = alignStream(stream);
+            section.size = size;
+            stream.write(reinterpret_cast<const char*>(pData), size);
+            return section;
+        }
+    }
+
+    GridBrickCache::Key GridBrickCache::computeKey(const std::filesystem::path& path, const std::string& gridname)
+    {
+        FALCOR_PROFILE_CPU("GridBrickCache::computeKey");
+
+        // Hash fixed size chunks of the file in parallel and hash the chunk digests.
+        MemoryMappedFile file(path);
+        const uint8_t* pData = reinterpret_cast<const uint8_t*>(file.getData());
+        const uint64_t fileSize = file.getSize();
+        std::vector<SHA1::MD> digests(div_round_up(fileSize, (uint64_t)kHashChunkSize));
+        auto range = NumericRange<size_t>(0, digests.size());
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](size_t i)
+        {
+            uint64_t offset = i * kHashChunkSize;
+            digests[i] = SHA1::compute(pData + offset, std::min((uint64_t)kHashChunkSize, fileSize - offset));
+        });
+
+        SHA1 sha1;
+        sha1.update(&kVersion, sizeof(kVersion));
+        sha1.update(&fileSize, sizeof(fileSize));
+        for (const auto& digest : digests) sha1.update(digest.data(), digest.size());
+        sha1.update(gridname.data(), gridname.size());
+        return sha1.finalize();
+    }
+
+    std::filesystem::path GridBrickCache::getCachePath(const Key& key)
+    {
+        std::string name;
+        for (auto c : key) name += fmt::format("{:02x}", c);
+        return getAppDataDirectory() / kDirectory / name;
+    }
+
+    Grid::SharedPtr GridBrickCache::readGrid(const Key& key)
+    {
+        auto cachePath = getCachePath(key);
+        if (!std::filesystem::exists(cachePath)) return nullptr;
+
+        FALCOR_PROFILE_CPU("GridBrickCache::readGrid");
+
+        try
+        {
+            MemoryMappedFile file(cachePath);
+            const uint8_t* pData = reinterpret_cast<const uint8_t*>(file.getData());
+            if (file.getSize() < sizeof(Header)) throw RuntimeError("File is truncated.");
+
+            Header header;
+            std::memcpy(&header, pData, sizeof(header));
+            validateHeader(header, file.getSize());
+
+            auto buffer = nanovdb::HostBuffer::create(header.grid.size);
+            std::memcpy(buffer.data(), pData + header.grid.offset, header.grid.size);
+            nanovdb::GridHandle<nanovdb::HostBuffer> handle(std::move(buffer));
+            if (!handle.grid<float>()) throw RuntimeError("Grid is not of type float.");
+
+            // The range and indirection textures are created directly from the mapped file.
+            // The atlas is uploaded one slab at a time like during conversion to bound the upload memory.
+            const uint32_t* leafDim = header.leafDim;
+            const uint32_t* atlasSize = header.atlasSize;
+            const ResourceFormat format = (ResourceFormat)header.atlasFormat;
+            BrickedGrid bricks;
+            bricks.range = Texture::create3D(leafDim[0], leafDim[1], leafDim[2], ResourceFormat::RG16Float, kRangeMipCount, pData + header.range.offset, ResourceBindFlags::ShaderResource, false);
+            bricks.indirection = Texture::create3D(leafDim[0], leafDim[1], leafDim[2], ResourceFormat::RGBA8Uint, 1, pData + header.indirection.offset, ResourceBindFlags::ShaderResource, false);
+            bricks.atlas = Texture::create3D(atlasSize[0], atlasSize[1], atlasSize[2], format, 1, nullptr, ResourceBindFlags::ShaderResource, false);
+
+            BrickAtlasUploader uploader(bricks.atlas, kBrickSize);
+            const uint64_t slabSize = getAtlasSlabSize(format, atlasSize[0], atlasSize[1]);
+            for (uint32_t slab = 0; slab < atlasSize[2] / kBrickSize; ++slab)
+            {
+                uploader.upload(slab, pData + header.atlas.offset + slab * slabSize, slabSize);
+            }
+
+            logInfo("Loaded grid from brick cache '{}'.", cachePath);
+
+            auto pGrid = Grid::SharedPtr(new Grid(std::move(handle), std::move(bricks)));
+            pGrid->mBrickCacheKey = key;
+            return pGrid;
+        }
+        catch (const std::exception& e)
+        {
+            logWarning("Failed to read grid brick cache file '{}': {}", cachePath, e.what());
+            return nullptr;
+        }
+    }
+
+    Grid::SharedPtr GridBrickCache::writeGrid(const Key& key, nanovdb::GridHandle<nanovdb::HostBuffer> gridHandle)
+    {
+        FALCOR_PROFILE_CPU("GridBrickCache::writeGrid");
+
+        // Compute the grid statistics before writing the grid so that cached grids don't need to recompute them.
+        nanovdb::FloatGrid* pFloatGrid = gridHandle.grid<float>();
+        FALCOR_ASSERT(pFloatGrid);
+        if (!pFloatGrid->hasMinMax()) nanovdb::gridStats(*pFloatGrid);
+
+        // Write to a uniquely named temporary file first, so that concurrent or aborted writes never leave a partial cache file.
+        auto cachePath = getCachePath(key);
+        auto tempPath = cachePath;
+        tempPath += fmt::format(".{:08x}.tmp", std::random_device()());
+
+        std::ofstream fs;
+        try
+        {
+            std::filesystem::create_directories(cachePath.parent_path());
+            fs.open(tempPath, std::ios_base::binary);
+        }
+        catch (const std::filesystem::filesystem_error& e)
+        {
+            logWarning("Failed to create grid brick cache directory: {}", e.what());
+        }
+        if (!fs.is_open()) logWarning("Failed to create grid brick cache file '{}'.", tempPath);
+
+        Header header;
+        std::memcpy(header.magic, kMagic, sizeof(Header::magic));
+        header.version = kVersion;
+        fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        header.grid = writeSection(fs, gridHandle.data(), gridHandle.size());
+        header.atlas.offset = alignStream(fs);
+
+        using NanoVDBGridConverter = NanoVDBConverterBC4;
+        NanoVDBGridConverter converter(pFloatGrid);
+        BrickedGrid bricks = converter.convert([&fs](const void* pData, size_t size)
+        {
+            fs.write(reinterpret_cast<const char*>(pData), size);
+        });
+
+        header.atlas.size = (uint64_t)fs.tellp() - header.atlas.offset;
+        header.range = writeSection(fs, converter.getRangeData().data(), converter.getRangeData().size() * sizeof(uint32_t));
+        header.indirection = writeSection(fs, converter.getIndirectionData().data(), converter.getIndirectionData().size() * sizeof(uint32_t));
+        header.atlasFormat = (uint32_t)bricks.atlas->getFormat();
+        header.leafDim[0] = bricks.range->getWidth();
+        header.leafDim[1] = bricks.range->getHeight();
+        header.leafDim[2] = bricks.range->getDepth();
+        header.atlasSize[0] = bricks.atlas->getWidth();
+        header.atlasSize[1] = bricks.atlas->getHeight();
+        header.atlasSize[2] = bricks.atlas->getDepth();
+        fs.seekp(0);
+        fs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        fs.close();
+
+        auto pGrid = Grid::SharedPtr(new Grid(std::move(gridHandle), std::move(bricks)));
+
+        std::error_code ec;
+        if (fs)
+        {
+            std::filesystem::rename(tempPath, cachePath, ec);
+            if (!ec)
+            {
+                logInfo("Wrote grid brick cache '{}'.", cachePath);
+                pGrid->mBrickCacheKey = key;
+                return pGrid;
+            }
+        }
+        logWarning("Failed to write grid brick cache file '{}'.", cachePath);
+        std::filesystem::remove(tempPath, ec);
+        return pGrid;
+    }
+}
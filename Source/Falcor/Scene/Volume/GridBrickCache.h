@@ -0,0 +1,76 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Grid.h"
+#include "Core/Macros.h"
+#include "Utils/CryptoUtils.h"
+
+#include <filesystem>
+#include <string>
+
+namespace Falcor
+{
+    /** On-disk cache of bricked grids.
+
+        Converting a grid to its bricked representation is expensive for large grids. The cache stores the converted
+        range, indirection and (BC4 compressed) atlas data together with the NanoVDB grid in a single versioned,
+        memory-mappable file per grid. Cache entries are keyed by the content of the grid file and the grid name,
+        so they are independent of the file location and can be shared across scenes and machines.
+    */
+    class FALCOR_API GridBrickCache
+    {
+    public:
+        using Key = SHA1::MD;
+
+        /** Compute the cache key of a grid.
+            Throws an exception if the grid file cannot be read.
+            \param[in] path Path of the grid file.
+            \param[in] gridname Name of the grid in the file.
+            \return Returns the cache key.
+        */
+        static Key computeKey(const std::filesystem::path& path, const std::string& gridname);
+
+        /** Get the path of the cache file for a given key.
+        */
+        static std::filesystem::path getCachePath(const Key& key);
+
+        /** Read a grid from the cache.
+            \param[in] key Cache key.
+            \return Returns the cached grid, or nullptr if the grid is not in the cache or the cache file is invalid.
+        */
+        static Grid::SharedPtr readGrid(const Key& key);
+
+        /** Create a grid and write it to the cache.
+            The atlas is written while it is converted. Failing to write the cache file is not fatal.
+            \param[in] key Cache key.
+            \param[in] gridHandle Handle of a float grid.
+            \return Returns the new grid.
+        */
+        static Grid::SharedPtr writeGrid(const Key& key, nanovdb::GridHandle<nanovdb::HostBuffer> gridHandle);
+    };
+}
@@ -28,7 +28,10 @@
 #pragma once
 #include "BrickedGrid.h"
 #include "BC4Encode.h"
+#include "Core/Assert.h"
+#include "Core/API/Device.h"
 #include "Core/API/Formats.h"
+#include "Core/API/RenderContext.h"
 #include "Utils/Logger.h"
 #include "Utils/HostDeviceShared.slangh"
 #include "Utils/NumericRange.h"
@@ -45,12 +48,49 @@
 #endif
 
 #include <algorithm>
-#include <atomic>
 #include <execution>
+#include <functional>
 #include <vector>
 
 namespace Falcor
 {
+    /** Uploads a brick atlas in slabs that are one brick deep.
+        The GPU is synchronized regularly to bound the host memory held by pending uploads.
+    */
+    class BrickAtlasUploader
+    {
+    public:
+        BrickAtlasUploader(const Texture::SharedPtr& pAtlas, uint32_t brickSize)
+            : mpAtlas(pAtlas)
+            , mBrickSize(brickSize)
+            , mpRenderContext(gpDevice->getRenderContext())
+        {}
+
+        /** Upload a slab.
+            \param[in] slab Slab index along the atlas depth.
+            \param[in] pData Texel data of the slab.
+            \param[in] size Size of the texel data in bytes.
+        */
+        void upload(uint32_t slab, const void* pData, size_t size)
+        {
+            mpRenderContext->updateSubresourceData(mpAtlas.get(), 0, pData, uint3(0, 0, slab * mBrickSize), uint3(mpAtlas->getWidth(), mpAtlas->getHeight(), mBrickSize));
+            mPendingBytes += size;
+            if (mPendingBytes >= kMaxPendingBytes)
+            {
+                mpRenderContext->flush(true);
+                mPendingBytes = 0;
+            }
+        }
+
+    private:
+        static const size_t kMaxPendingBytes = size_t(256) << 20; ///< Upload size after which we wait for the GPU to release upload memory.
+
+        Texture::SharedPtr mpAtlas;
+        uint32_t mBrickSize;
+        RenderContext* mpRenderContext;
+        size_t mPendingBytes = 0;
+    };
+
     template <typename TexelType, unsigned int kBitsPerTexel> struct NanoVDBToBricksConverter;
     using NanoVDBConverterBC4 = NanoVDBToBricksConverter<uint64_t, 4>;
     using NanoVDBConverterUNORM8 = NanoVDBToBricksConverter<uint8_t, 8>;
@@ -60,23 +100,61 @@ namespace Falcor
     struct NanoVDBToBricksConverter
     {
     public:
+        /** Callback receiving the encoded atlas data one slab at a time, in order of increasing depth.
+        */
+        using AtlasSlabCallback = std::function<void(const void* pData, size_t size)>;
+
         NanoVDBToBricksConverter(const nanovdb::FloatGrid* grid);
         NanoVDBToBricksConverter(const NanoVDBToBricksConverter& rhs) = delete;
 
-        BrickedGrid convert();
+        /** Convert the grid to bricks.
+            Bricks are converted in parallel and assigned to atlas slots in scan order, so the result is deterministic.
+            The atlas is encoded and uploaded one slab of bricks at a time to bound the host memory footprint.
+            \param[in] onAtlasSlab Optional callback receiving each encoded atlas slab, e.g. to write it to a cache.
+        */
+        BrickedGrid convert(const AtlasSlabCallback& onAtlasSlab = {});
+
+        /** Get the range data of all mips, valid after convert().
+        */
+        const std::vector<uint32_t>& getRangeData() const { return mRangeData; }
+
+        /** Get the indirection data, valid after convert().
+        */
+        const std::vector<uint32_t>& getIndirectionData() const { return mPtrData; }
 
     private:
         const static uint32_t kBrickSize = 8; // Must be 8, to match both NanoVDB leaf size.
         const static int32_t kBC4Compress = kBitsPerTexel == 4;
 
-        void convertSlice(int z);
+        /** Non-empty brick found during conversion.
+        */
+        struct Brick
+        {
+            const float* pValues;   ///< Voxel values of the leaf.
+            uint32_t leafIndex;     ///< Linear index of the brick in the mip 0 range and indirection data.
+            float minorant;
+            float majorant;
+        };
+
+        void convertRow(int y, int z, std::vector<Brick>& bricks);
+        template <typename AccessorT>
+        void expandHalo(AccessorT& a, const nanovdb::Coord& ijk, float& minorant, float& majorant) const;
+        void writeBrick(const Brick& brick, uint32_t slabSlot, TexelType* pSlab) const;
         void computeMip(int mip);
+        Texture::SharedPtr createAtlas(const std::vector<Brick>& bricks, const AtlasSlabCallback& onAtlasSlab) const;
 
         inline uint3 getAtlasSizeBricks() const { return mAtlasSizeBricks; }
         inline uint3 getAtlasSizePixels() const { return mAtlasSizeBricks * kBrickSize; }
         inline uint32_t getAtlasMaxBrick() const { return mAtlasSizeBricks.x * mAtlasSizeBricks.y * mAtlasSizeBricks.z; }
+        inline size_t getSlabTexelCount() const
+        {
+            // A slab is one brick deep and holds mAtlasSizeBricks.x * mAtlasSizeBricks.y bricks.
+            uint3 atlasSizePixels = getAtlasSizePixels();
+            size_t pixelCount = size_t(atlasSizePixels.x) * atlasSizePixels.y * kBrickSize;
+            return kBC4Compress ? (pixelCount / 16) : pixelCount;
+        }
 
-        inline ResourceFormat getAtlasFormat() {
+        inline ResourceFormat getAtlasFormat() const {
             switch (kBitsPerTexel) {
             case 4: return ResourceFormat::BC4Unorm;
             case 8: return ResourceFormat::R8Unorm;
@@ -96,7 +174,7 @@ namespace Falcor
             return float2(f16tof32(data16[0]), f16tof32(data16[1]));
         }
 
-        inline void expandMinorantMajorant(float value, float& min_inout, float& maj_inout)
+        static inline void expandMinorantMajorant(float value, float& min_inout, float& maj_inout)
         {
             if (value < min_inout) min_inout = value;
             if (value > maj_inout) maj_inout = value;
@@ -109,14 +187,11 @@ namespace Falcor
         uint32_t mLeafCount[4];
         std::vector<uint32_t> mRangeData;
         std::vector<uint32_t> mPtrData;
-        std::vector<TexelType> mAtlasData;
-        std::atomic_uint32_t mNonEmptyCount;
     };
 
     template <typename TexelType, unsigned int kBitsPerTexel>
     NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::NanoVDBToBricksConverter(const nanovdb::FloatGrid* grid)
     {
-        mNonEmptyCount.store(0);
         mpFloatGrid = grid;
         auto& voxelbox = mpFloatGrid->indexBBox();
         mBBMin = (int3(voxelbox.min().x(), voxelbox.min().y(), voxelbox.min().z())) & (~7);
@@ -132,126 +207,141 @@ namespace Falcor
         uint approxdim = 1u << uint(log2f((float)leafCount + 1.f) / 3.f); // Choose the first 2 dimensions to be powers of 2.
         uint lastdim = (leafCount + approxdim * approxdim - 1) / (approxdim * approxdim);
         mAtlasSizeBricks = uint3(approxdim, approxdim, lastdim);
-        uint3 atlasSizePixels = getAtlasSizePixels();
-        uint leafTexelCount = atlasSizePixels.x * atlasSizePixels.y * atlasSizePixels.z;
         mRangeData.resize(mLeafCount[3]);
         mPtrData.resize(mLeafCount[0]);
-        mAtlasData.resize(kBC4Compress ? (leafTexelCount / 16) : leafTexelCount);
     }
 
     template <typename TexelType, unsigned int kBitsPerTexel>
-    void NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::convertSlice(int z)
+    void NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::convertRow(int y, int z, std::vector<Brick>& bricks)
     {
-        uint3 atlasSizePixels = getAtlasSizePixels();
-        uint brickMax = getAtlasMaxBrick();
-        uint bricksPerSlice = mAtlasSizeBricks.x * mAtlasSizeBricks.y;
-        uint pixelsPerSlice = atlasSizePixels.x * atlasSizePixels.y;
-
-        size_t offset = z * mLeafDim[0].x * mLeafDim[0].y;
+        uint32_t offset = (z * mLeafDim[0].y + y) * mLeafDim[0].x;
         uint32_t* rangedst = mRangeData.data() + offset;
-        uint32_t* ptrdst = mPtrData.data() + offset;
         auto a = mpFloatGrid->getAccessor();
-        for (int y = 0; y < mLeafDim[0].y; ++y)
+        for (int x = 0; x < mLeafDim[0].x; ++x)
+        {
+            nanovdb::Coord ijk = { x * 8 + mBBMin.x, y * 8 + mBBMin.y, z * 8 + mBBMin.z };
+            auto val = a.getValue(ijk);
+            auto leaf = a.probeLeaf(ijk);
+            float minorant = val, majorant = val;
+            if (leaf)
+            {
+                // Nanovdb only stores minorant/majorant for active voxels, but we need all of them... Grab the central 8x8x8 first the quick way.
+                const float* data = leaf->data()->mValues;
+                for (int i = 0; i < kBrickSize * kBrickSize * kBrickSize; ++i) expandMinorantMajorant(data[i], minorant, majorant);
+                // We also need the halo from neighbouring bricks.
+                expandHalo(a, ijk, minorant, majorant);
+            }
+            if (majorant == minorant || leaf == nullptr)
+            {
+                *rangedst++ = f32tof16(majorant) + (f32tof16(majorant) << 16); // force identical major and minor
+            }
+            else
+            {
+                majorant = f16tof32(f32tof16(majorant) + 1);
+                minorant = f16tof32(f32tof16(minorant));
+                *rangedst++ = f32tof16(majorant) + (f32tof16(minorant) << 16);
+                bricks.push_back({ leaf->data()->mValues, offset + x, minorant, majorant });
+            }
+        }
+    }
+
+    template <typename TexelType, unsigned int kBitsPerTexel>
+    template <typename AccessorT>
+    void NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::expandHalo(AccessorT& a, const nanovdb::Coord& ijk, float& minorant, float& majorant) const
+    {
+        // The halo has always been gathered from the -y and +y faces only: the loops for the other faces compared a signed
+        // counter starting at -1 against the unsigned brick size and never ran. This is kept to not change the converted ranges.
+        // The face is read in bulk from the neighbouring leaf, or is the single tile value if the neighbour is not allocated.
+        const int size = kBrickSize;
+        for (int dy : { -1, 1 })
         {
-            for (int x = 0; x < mLeafDim[0].x; ++x)
+            nanovdb::Coord neighbor = ijk + nanovdb::Coord(0, dy * size, 0);
+            auto leaf = a.probeLeaf(neighbor);
+            if (!leaf)
             {
-                nanovdb::Coord ijk = { x * 8 + mBBMin.x, y * 8 + mBBMin.y, z * 8 + mBBMin.z };
-                auto val = a.getValue(ijk);
-                auto leaf = a.probeLeaf(ijk);
-                float minorant = val, majorant = val;
-                uint myleaf = 0;
-                if (leaf)
+                expandMinorantMajorant(a.getValue(neighbor), minorant, majorant);
+                continue;
+            }
+
+            const float* data = leaf->data()->mValues;
+            int j = dy < 0 ? size - 1 : 0;
+            for (int i = 0; i < size; ++i)
+            {
+                for (int k = 0; k < size; ++k) expandMinorantMajorant(data[i * size * size + j * size + k], minorant, majorant);
+            }
+        }
+    }
+
+    template <typename TexelType, unsigned int kBitsPerTexel>
+    void NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::writeBrick(const Brick& brick, uint32_t slabSlot, TexelType* pSlab) const
+    {
+        uint3 atlasSizePixels = getAtlasSizePixels();
+        uint pixelsPerSlice = atlasSizePixels.x * atlasSizePixels.y;
+        uint32_t atlasx = slabSlot % mAtlasSizeBricks.x;
+        uint32_t atlasy = slabSlot / mAtlasSizeBricks.x;
+        const float* data = brick.pValues;
+        float minorant = brick.minorant;
+        float majorant = brick.majorant;
+
+        if (!kBC4Compress) {
+            float invRange = ((1 << kBitsPerTexel) - 1.f) / (majorant - minorant);
+            TexelType* atlasdst = pSlab + atlasx * kBrickSize + atlasy * (atlasSizePixels.x * kBrickSize);
+            for (int pixz = 0; pixz < kBrickSize; ++pixz)
+            {
+                for (int pixy = 0; pixy < kBrickSize; ++pixy)
                 {
-                    // Nanovdb only stores minorant/majorant for active voxels, but we need all of them... Grab the central 8x8x8 first the quick way.
-                    const float* data = leaf->data()->mValues;
-                    for (int i = 0; i < kBrickSize * kBrickSize * kBrickSize; ++i) expandMinorantMajorant(data[i], minorant, majorant);
-                    // We also need the 1-halo from neighbouring bricks. Fetch them in an order that maximises nanovdb's internal cache reuse.
-                    for (int j = -1; j <= kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(i, j, -1)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(i, j, kBrickSize)), minorant, majorant);
-                    for (int j = 0; j < kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(i, -1, j)), minorant, majorant);
-                    for (int j = 0; j < kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(i, kBrickSize, j)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(-1, j, i)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) for (int i = 0; i < kBrickSize; ++i) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(kBrickSize, j, i)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(-1, j, -1)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(kBrickSize, j, -1)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(-1, j, kBrickSize)), minorant, majorant);
-                    for (int j = -1; j <= kBrickSize; ++j) expandMinorantMajorant(a.getValue(ijk + nanovdb::Coord(kBrickSize, j, kBrickSize)), minorant, majorant);
-
-                    if (minorant != majorant) myleaf = mNonEmptyCount.fetch_add(1);
+                    for (int pixx = 0; pixx < kBrickSize; ++pixx)
+                    {
+                        float f = data[pixx * kBrickSize * kBrickSize + pixy * kBrickSize + pixz];
+                        *atlasdst++ = TexelType((f - minorant) * invRange);
+                    }
+                    atlasdst += (atlasSizePixels.x - kBrickSize); // next scanline
                 }
-                if (majorant == minorant || myleaf >= brickMax || leaf == nullptr)
+                atlasdst += (pixelsPerSlice - (atlasSizePixels.x * kBrickSize)); // next slice
+            }
+        }
+        else {
+            // BC4 compression: quantize the whole brick first, stored as [z][y][x] so that tiles are contiguous rows.
+            float invRange = (255.f) / (majorant - minorant);
+            uint8_t voxels[kBrickSize][kBrickSize][kBrickSize];
+            for (int pixx = 0; pixx < kBrickSize; ++pixx)
+            {
+                for (int pixy = 0; pixy < kBrickSize; ++pixy)
                 {
-                    *rangedst++ = f32tof16(majorant) + (f32tof16(majorant) << 16); // force identical major and minor
-                    *ptrdst++ = 0;
+                    for (int pixz = 0; pixz < kBrickSize; ++pixz)
+                    {
+                        float f = data[pixx * (kBrickSize * kBrickSize) + pixy * kBrickSize + pixz];
+                        voxels[pixz][pixy][pixx] = uint8_t((f - minorant) * invRange);
+                    }
                 }
-                else
+            }
+
+            uint64_t* atlasdst = (uint64_t*)pSlab + atlasx * (kBrickSize / 4) + atlasy * ((atlasSizePixels.x / 4) * kBrickSize / 4);
+            for (int pixz = 0; pixz < kBrickSize; ++pixz)
+            {
+                for (int tiley = 0; tiley < kBrickSize; tiley += 4)
                 {
-                    const float* data = leaf->data()->mValues;
-                    majorant = f16tof32(f32tof16(majorant) + 1);
-                    minorant = f16tof32(f32tof16(minorant));
-                    *rangedst++ = f32tof16(majorant) + (f32tof16(minorant) << 16);
-                    uint32_t atlasx = myleaf % mAtlasSizeBricks.x;
-                    uint32_t atlasy = (myleaf / mAtlasSizeBricks.x) % mAtlasSizeBricks.y;
-                    uint32_t atlasz = myleaf / bricksPerSlice;
-                    *ptrdst++ = (atlasx + (atlasy << 8) + (atlasz << 16));
-
-                    if (!kBC4Compress) {
-                        float invRange = ((1 << kBitsPerTexel) - 1.f) / (majorant - minorant);
-                        TexelType* atlasdst = (TexelType*)mAtlasData.data() + atlasx * kBrickSize + atlasy * (atlasSizePixels.x * kBrickSize) + atlasz * (pixelsPerSlice * kBrickSize);
-                        for (int pixz = 0; pixz < kBrickSize; ++pixz)
+                    for (int tilex = 0; tilex < kBrickSize; tilex += 4) {
+                        uint8_t tilevals[4][4];
+                        for (int pixy = 0; pixy < 4; ++pixy)
                         {
-                            for (int pixy = 0; pixy < kBrickSize; ++pixy)
-                            {
-                                for (int pixx = 0; pixx < kBrickSize; ++pixx)
-                                {
-                                    float f = data[pixx * kBrickSize * kBrickSize + pixy * kBrickSize + pixz];
-                                    *atlasdst++ = TexelType((f - minorant) * invRange);
-                                }
-                                atlasdst += (atlasSizePixels.x - kBrickSize); // next scanline
-                            }
-                            atlasdst += (pixelsPerSlice - (atlasSizePixels.x * kBrickSize)); // next slice
+                            for (int pixx = 0; pixx < 4; ++pixx) tilevals[pixy][pixx] = voxels[pixz][tiley + pixy][tilex + pixx];
                         }
+                        CompressAlphaDxt5((uint8_t*)&tilevals[0][0], atlasdst);
+                        atlasdst++;
                     }
-                    else {
-                        // BC4 compression:
-                        float invRange = (255.f) / (majorant - minorant);
-                        uint64_t* atlasdst = ((uint64_t*)mAtlasData.data() + atlasx * (kBrickSize / 4) + atlasy * ((atlasSizePixels.x / 4) * kBrickSize / 4) + atlasz * (pixelsPerSlice / 16 * kBrickSize));
-                        for (int pixz = 0; pixz < kBrickSize; ++pixz)
-                        {
-                            for (int tiley = 0; tiley < kBrickSize; tiley += 4)
-                            {
-                                for (int tilex = 0; tilex < kBrickSize; tilex += 4) {
-                                    uint8_t tilevals[4][4];
-                                    uint8_t tileminorant = 255, tilemajorant = 0;
-                                    for (int pixy = 0; pixy < 4; ++pixy)
-                                    {
-                                        for (int pixx = 0; pixx < 4; ++pixx)
-                                        {
-                                            float f = data[(pixx + tilex) * (kBrickSize * kBrickSize) + (pixy + tiley) * kBrickSize + pixz];
-                                            uint8_t voxel = uint8_t((f - minorant) * invRange);
-                                            tileminorant = std::min(tileminorant, voxel);
-                                            tilemajorant = std::max(tilemajorant, voxel);
-                                            tilevals[pixy][pixx] = voxel;
-                                        }
-                                    }
-                                    CompressAlphaDxt5((uint8_t*)&tilevals[0][0], atlasdst);
-                                    atlasdst++;
-                                }
-                                atlasdst += (atlasSizePixels.x / 4 - kBrickSize / 4); // next scanline
-                            }
-                            atlasdst += (pixelsPerSlice / 16 - (atlasSizePixels.x / 4 * kBrickSize / 4)); // next slice
-                        } // z slice loop
-                    } // bc4 compress?
-                } // non empty brick?
-            } // x brick loop
-        } // y brick loop
+                    atlasdst += (atlasSizePixels.x / 4 - kBrickSize / 4); // next scanline
+                }
+                atlasdst += (pixelsPerSlice / 16 - (atlasSizePixels.x / 4 * kBrickSize / 4)); // next slice
+            } // z slice loop
+        } // bc4 compress?
     }
 
     template <typename TexelType, unsigned int kBitsPerTexel>
     void NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::computeMip(int mip)
     {
-        uint32_t* rangedst = mRangeData.data() + mLeafCount[mip - 1];
-        uint32_t* rangesrc = mRangeData.data() + ((mip > 1) ? mLeafCount[mip - 2] : 0);
+        uint32_t* rangedstBase = mRangeData.data() + mLeafCount[mip - 1];
+        const uint32_t* rangesrcBase = mRangeData.data() + ((mip > 1) ? mLeafCount[mip - 2] : 0);
         int3 leafdim_src = mLeafDim[mip - 1];
         uint32_t rowstride_src = leafdim_src.x;
         uint32_t slicestride_src = leafdim_src.y * rowstride_src;
@@ -260,10 +350,13 @@ namespace Falcor
         uint32_t rowstride_tgt = leafdim_tgt.x;
         uint32_t slicestride_tgt = leafdim_tgt.y * rowstride_tgt;
 
-        for (int z = 0; z < leafdim_tgt.z; ++z, rangesrc += slicestride_src)
+        auto range = NumericRange<int>(0, leafdim_tgt.z);
+        std::for_each(std::execution::par, range.begin(), range.end(), [&](int z)
         {
-            for (int y = 0; y < leafdim_tgt.y; ++y, rangesrc += rowstride_src)
+            uint32_t* rangedst = rangedstBase + z * slicestride_tgt;
+            for (int y = 0; y < leafdim_tgt.y; ++y)
             {
+                const uint32_t* rangesrc = rangesrcBase + 2 * z * slicestride_src + 2 * y * rowstride_src;
                 for (int x = 0; x < leafdim_tgt.x; ++x, rangesrc += 2)
                 {
                     float2 majmin_dst = combineMajMin(
@@ -279,23 +372,76 @@ namespace Falcor
                     *rangedst++ = f32tof16(majmin_dst.x) + (f32tof16(majmin_dst.y) << 16);
                 } // x
             } // y
-        } // z
+        }); // z
+    }
+
+    template <typename TexelType, unsigned int kBitsPerTexel>
+    Texture::SharedPtr NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::createAtlas(const std::vector<Brick>& bricks, const AtlasSlabCallback& onAtlasSlab) const
+    {
+        uint3 atlasSizePixels = getAtlasSizePixels();
+        auto pAtlas = Texture::create3D(atlasSizePixels.x, atlasSizePixels.y, atlasSizePixels.z, getAtlasFormat(), 1, nullptr, ResourceBindFlags::ShaderResource, false);
+
+        // Encode and upload one slab at a time. Texels not covered by a brick are zero.
+        BrickAtlasUploader uploader(pAtlas, kBrickSize);
+        uint32_t bricksPerSlab = mAtlasSizeBricks.x * mAtlasSizeBricks.y;
+        uint32_t brickCount = (uint32_t)bricks.size();
+        std::vector<TexelType> slab(getSlabTexelCount());
+        for (uint32_t z = 0; z < mAtlasSizeBricks.z; ++z)
+        {
+            uint32_t first = std::min(z * bricksPerSlab, brickCount);
+            uint32_t last = std::min(first + bricksPerSlab, brickCount);
+            if (last - first < bricksPerSlab) std::fill(slab.begin(), slab.end(), TexelType(0));
+
+            auto range = NumericRange<uint32_t>(first, last);
+            std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t slot) { writeBrick(bricks[slot], slot - first, slab.data()); });
+
+            if (onAtlasSlab) onAtlasSlab(slab.data(), slab.size() * sizeof(TexelType));
+            uploader.upload(z, slab.data(), slab.size() * sizeof(TexelType));
+        }
+
+        return pAtlas;
     }
 
     template <typename TexelType, unsigned int kBitsPerTexel>
-    BrickedGrid NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::convert()
+    BrickedGrid NanoVDBToBricksConverter<TexelType, kBitsPerTexel>::convert(const AtlasSlabCallback& onAtlasSlab)
     {
         auto t0 = CpuTimer::getCurrentTimePoint();
-        auto range = NumericRange<int>(0, mLeafDim[0].z);
-        std::for_each(std::execution::par, range.begin(), range.end(), [&](int z) { convertSlice(z); });
+
+        // Compute the brick ranges and collect the non-empty bricks, in parallel over rows of leaves.
+        uint32_t rowCount = mLeafDim[0].y * mLeafDim[0].z;
+        std::vector<std::vector<Brick>> rowBricks(rowCount);
+        auto rowRange = NumericRange<uint32_t>(0, rowCount);
+        std::for_each(std::execution::par, rowRange.begin(), rowRange.end(), [&](uint32_t row) { convertRow(row % mLeafDim[0].y, row / mLeafDim[0].y, rowBricks[row]); });
+
+        // Assign atlas slots to the non-empty bricks in scan order.
+        size_t brickCount = 0;
+        for (const auto& row : rowBricks) brickCount += row.size();
+        FALCOR_ASSERT(brickCount <= getAtlasMaxBrick());
+        std::vector<Brick> bricks;
+        bricks.reserve(brickCount);
+        for (auto& row : rowBricks)
+        {
+            bricks.insert(bricks.end(), row.begin(), row.end());
+            std::vector<Brick>().swap(row);
+        }
+        uint bricksPerSlice = mAtlasSizeBricks.x * mAtlasSizeBricks.y;
+        for (uint32_t slot = 0; slot < (uint32_t)bricks.size(); ++slot)
+        {
+            uint32_t atlasx = slot % mAtlasSizeBricks.x;
+            uint32_t atlasy = (slot / mAtlasSizeBricks.x) % mAtlasSizeBricks.y;
+            uint32_t atlasz = slot / bricksPerSlice;
+            mPtrData[bricks[slot].leafIndex] = (atlasx + (atlasy << 8) + (atlasz << 16));
+        }
+
         for (int mip = 1; mip < 4; ++mip) computeMip(mip);
-        double dt = CpuTimer::calcDuration(t0, CpuTimer::getCurrentTimePoint());
-        logInfo("converted in {}ms: mNonEmptyCount {} vs max {}", dt, mNonEmptyCount, getAtlasMaxBrick());
 
-        BrickedGrid bricks;
-        bricks.range = Texture::create3D(mLeafDim[0].x, mLeafDim[0].y, mLeafDim[0].z, ResourceFormat::RG16Float, 4, mRangeData.data(), ResourceBindFlags::ShaderResource, false);
-        bricks.indirection = Texture::create3D(mLeafDim[0].x, mLeafDim[0].y, mLeafDim[0].z, ResourceFormat::RGBA8Uint, 1, mPtrData.data(), ResourceBindFlags::ShaderResource, false);
-        bricks.atlas = Texture::create3D(getAtlasSizePixels().x, getAtlasSizePixels().y, getAtlasSizePixels().z, getAtlasFormat(), 1, mAtlasData.data(), ResourceBindFlags::ShaderResource, false);
-        return bricks;
+        BrickedGrid result;
+        result.range = Texture::create3D(mLeafDim[0].x, mLeafDim[0].y, mLeafDim[0].z, ResourceFormat::RG16Float, 4, mRangeData.data(), ResourceBindFlags::ShaderResource, false);
+        result.indirection = Texture::create3D(mLeafDim[0].x, mLeafDim[0].y, mLeafDim[0].z, ResourceFormat::RGBA8Uint, 1, mPtrData.data(), ResourceBindFlags::ShaderResource, false);
+        result.atlas = createAtlas(bricks, onAtlasSlab);
+
+        double dt = CpuTimer::calcDuration(t0, CpuTimer::getCurrentTimePoint());
+        logInfo("converted in {}ms: mNonEmptyCount {} vs max {}", dt, bricks.size(), getAtlasMaxBrick());
+        return result;
     }
 }
@@ -0,0 +1,122 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "AsyncImageWriter.h"
+#include "Utils/Timing/CpuProfiler.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    AsyncImageWriter::AsyncImageWriter(size_t maxQueuedBytes)
+        : mMaxQueuedBytes(maxQueuedBytes)
+    {
+        mThread = std::thread(&AsyncImageWriter::runWorker, this);
+    }
+
+    AsyncImageWriter::~AsyncImageWriter()
+    {
+        flush();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTerminate = true;
+        }
+        mWorkerCondition.notify_all();
+        mThread.join();
+    }
+
+    void AsyncImageWriter::write(const std::filesystem::path& path, uint32_t width, uint32_t height, Bitmap::FileFormat fileFormat, Bitmap::ExportFlags exportFlags, ResourceFormat resourceFormat, std::vector<uint8_t> data)
+    {
+        const size_t size = data.size();
+
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        // Wait until there is room in the budget. An empty queue always accepts the request.
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        mQueueCondition.wait(lock, [&]() { return mQueuedBytes == 0 || mQueuedBytes + size <= mMaxQueuedBytes; });
+        mStats.blockedTime += CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+        mQueue.push(WriteRequest{ path, width, height, fileFormat, exportFlags, resourceFormat, std::move(data) });
+        mQueuedBytes += size;
+        mPendingCount++;
+        mStats.peakQueuedBytes = std::max(mStats.peakQueuedBytes, mQueuedBytes);
+        mWorkerCondition.notify_one();
+    }
+
+    void AsyncImageWriter::flush()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mQueueCondition.wait(lock, [&]() { return mPendingCount == 0; });
+    }
+
+    AsyncImageWriter::Stats AsyncImageWriter::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+    void AsyncImageWriter::runWorker()
+    {
+        CpuProfiler::instance().setThreadName("AsyncImageWriter");
+
+        while (true)
+        {
+            // Wait on condition until more work is ready.
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWorkerCondition.wait(lock, [&]() { return mTerminate || !mQueue.empty(); });
+
+            if (mQueue.empty())
+            {
+                if (mTerminate) break;
+                continue;
+            }
+
+            WriteRequest request = std::move(mQueue.front());
+            mQueue.pop();
+
+            lock.unlock();
+
+            // Bitmap::saveImage reports errors itself.
+            const size_t size = request.data.size();
+            {
+                FALCOR_PROFILE_CPU("AsyncImageWriter::write");
+                Bitmap::saveImage(request.path, request.width, request.height, request.fileFormat, request.exportFlags, request.resourceFormat, true, request.data.data());
+            }
+            request.data.clear();
+            request.data.shrink_to_fit();
+
+            lock.lock();
+
+            mQueuedBytes -= size;
+            mPendingCount--;
+            mStats.imageCount++;
+            mStats.bytesWritten += size;
+            mQueueCondition.notify_all();
+        }
+    }
+}
@@ -0,0 +1,117 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Bitmap.h"
+#include "Core/Macros.h"
+#include "Core/API/Formats.h"
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace Falcor
+{
+    /** Utility class to write images to disk on a background thread.
+
+        Images are written with Bitmap::saveImage(), which streams EXR and PFM files block by block
+        with parallel compression. The queue holds at most a budget of pixel data. Submitting an image
+        blocks while the budget is exhausted, which throttles the caller to the I/O throughput instead
+        of letting memory grow without bound.
+    */
+    class FALCOR_API AsyncImageWriter
+    {
+    public:
+        static constexpr size_t kDefaultMaxQueuedBytes = size_t(1) << 30; ///< Default budget for queued pixel data (1 GB).
+
+        /** Writer statistics. All counters are accumulated over the lifetime of the writer.
+        */
+        struct Stats
+        {
+            size_t imageCount = 0;          ///< Number of images written.
+            size_t bytesWritten = 0;        ///< Number of bytes of pixel data written.
+            size_t peakQueuedBytes = 0;     ///< Peak number of bytes of pixel data in the queue.
+            double blockedTime = 0.0;       ///< Total time in ms callers were blocked waiting for the queue.
+        };
+
+        /** Constructor.
+            \param[in] maxQueuedBytes Budget in bytes for queued pixel data. An image larger than the budget is accepted when the queue is empty.
+        */
+        AsyncImageWriter(size_t maxQueuedBytes = kDefaultMaxQueuedBytes);
+
+        /** Destructor.
+            Blocks until all queued images have been written.
+        */
+        ~AsyncImageWriter();
+
+        /** Queue an image for writing. Blocks while the queue is over budget.
+            See Bitmap::saveImage() for a description of the parameters.
+            \param[in] data Pixel data, moved into the queue.
+        */
+        void write(const std::filesystem::path& path, uint32_t width, uint32_t height, Bitmap::FileFormat fileFormat, Bitmap::ExportFlags exportFlags, ResourceFormat resourceFormat, std::vector<uint8_t> data);
+
+        /** Block until all queued images have been written.
+        */
+        void flush();
+
+        /** Get writer statistics.
+        */
+        Stats getStats() const;
+
+    private:
+        void runWorker();
+
+        struct WriteRequest
+        {
+            std::filesystem::path path;
+            uint32_t width;
+            uint32_t height;
+            Bitmap::FileFormat fileFormat;
+            Bitmap::ExportFlags exportFlags;
+            ResourceFormat resourceFormat;
+            std::vector<uint8_t> data;
+        };
+
+        const size_t mMaxQueuedBytes;
+
+        mutable std::mutex mMutex;                  ///< Mutex for synchronizing access to shared resources.
+        std::condition_variable mWorkerCondition;   ///< Condition variable for the worker to wait on.
+        std::condition_variable mQueueCondition;    ///< Condition variable signaled when queued data is released.
+        std::thread mThread;                        ///< Worker thread.
+
+        // Internal state. Do not access outside of critical section.
+        std::queue<WriteRequest> mQueue;            ///< Write request queue.
+        size_t mQueuedBytes = 0;                    ///< Bytes of pixel data queued or being written.
+        size_t mPendingCount = 0;                   ///< Number of requests queued or being written.
+        Stats mStats;
+
+        bool mTerminate = false;                    ///< Flag to terminate the worker thread.
+    };
+}
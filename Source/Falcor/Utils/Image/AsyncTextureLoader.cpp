@@ -27,105 +27,301 @@
  **************************************************************************/
 #include "AsyncTextureLoader.h"
 #include "Core/API/Device.h"
-#include "Utils/Threading.h"
+#include "Utils/Logger.h"
+#include "Utils/Timing/CpuProfiler.h"
+#include <algorithm>
 
 namespace Falcor
 {
     namespace
     {
-        constexpr size_t kUploadsPerFlush = 16; ///< Number of texture uploads before issuing a flush (to keep upload heap from growing).
+        constexpr size_t kUploadsPerFlush = 16;                 ///< Number of texture uploads before issuing a flush (to keep upload heap from growing).
+        constexpr size_t kUploadBytesPerFlush = size_t(256) << 20; ///< Number of uploaded bytes before issuing a flush.
     }
 
-    AsyncTextureLoader::AsyncTextureLoader(size_t threadCount)
+    AsyncTextureLoader::AsyncTextureLoader(size_t threadCount, size_t maxInFlightBytes)
+        : mMaxInFlightBytes(maxInFlightBytes)
     {
-        runWorkers(threadCount);
+        threadCount = std::max<size_t>(threadCount, 1);
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            mDecodeThreads.emplace_back(&AsyncTextureLoader::runDecodeWorker, this);
+        }
+        mUploadThread = std::thread(&AsyncTextureLoader::runUploadWorker, this);
     }
 
     AsyncTextureLoader::~AsyncTextureLoader()
     {
+        waitForAll();
         terminateWorkers();
 
         gpDevice->flushAndSync();
     }
 
-    std::future<Texture::SharedPtr> AsyncTextureLoader::loadFromFile(const std::filesystem::path& path, bool generateMipLevels, bool loadAsSrgb, Resource::BindFlags bindFlags, LoadCallback callback)
+    std::future<Texture::SharedPtr> AsyncTextureLoader::loadFromFile(const std::filesystem::path& path, bool generateMipLevels, bool loadAsSrgb, Resource::BindFlags bindFlags, LoadCallback callback, uint32_t priority)
     {
         std::lock_guard<std::mutex> lock(mMutex);
-        mLoadRequestQueue.push(LoadRequest{path, generateMipLevels, loadAsSrgb, bindFlags, callback });
-        mCondition.notify_one();
-        return mLoadRequestQueue.back().promise.get_future();
+        mStats.requestCount++;
+
+        Waiter waiter{ callback };
+        auto future = waiter.promise.get_future();
+
+        RequestKey key{ path, generateMipLevels, loadAsSrgb, bindFlags };
+        if (auto it = mJobsInFlight.find(key); it != mJobsInFlight.end())
+        {
+            // Merge with the identical request in flight. Raise its priority if needed.
+            // Jobs are re-inserted into their queue as the priority is part of the ordering.
+            const LoadJobPtr& pJob = it->second;
+            if (priority > pJob->priority)
+            {
+                if (mDecodeQueue.erase(pJob))
+                {
+                    pJob->priority = priority;
+                    mDecodeQueue.insert(pJob);
+                }
+                else if (mUploadQueue.erase(pJob))
+                {
+                    pJob->priority = priority;
+                    mUploadQueue.insert(pJob);
+                }
+                else
+                {
+                    pJob->priority = priority;
+                }
+            }
+            pJob->waiters.push_back(std::move(waiter));
+            mStats.mergedCount++;
+            return future;
+        }
+
+        auto pJob = std::make_shared<LoadJob>();
+        pJob->key = key;
+        pJob->path = path;
+        pJob->generateMipLevels = generateMipLevels;
+        pJob->loadAsSRGB = loadAsSrgb;
+        pJob->bindFlags = bindFlags;
+        pJob->priority = priority;
+        pJob->sequence = mNextSequence++;
+        pJob->waiters.push_back(std::move(waiter));
+
+        mJobsInFlight[key] = pJob;
+        mDecodeQueue.insert(pJob);
+        mPendingJobCount++;
+        mDecodeCondition.notify_one();
+
+        return future;
     }
 
-    void AsyncTextureLoader::runWorkers(size_t threadCount)
+    size_t AsyncTextureLoader::cancel(const std::filesystem::path& path)
     {
-        // Create a barrier to synchronize worker threads before issuing a global flush.
-        mFlushBarrier = std::make_shared<Barrier>(threadCount, [&]() {
-            gpDevice->flushAndSync();
-            mFlushPending = false;
-            mUploadCounter = 0;
-            });
+        std::vector<LoadJobPtr> cancelledJobs;
+        size_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            count = cancelJobs([&](const LoadJob& job) { return job.path == path; }, cancelledJobs);
+        }
+        for (auto& pJob : cancelledJobs) complete(*pJob, nullptr);
+        return count;
+    }
 
-        for (size_t i = 0; i < threadCount; ++i)
+    size_t AsyncTextureLoader::cancelAll()
+    {
+        std::vector<LoadJobPtr> cancelledJobs;
+        size_t count = 0;
         {
-            mThreads.emplace_back(&AsyncTextureLoader::runWorker, this);
+            std::lock_guard<std::mutex> lock(mMutex);
+            count = cancelJobs([](const LoadJob&) { return true; }, cancelledJobs);
         }
+        for (auto& pJob : cancelledJobs) complete(*pJob, nullptr);
+        return count;
+    }
+
+    void AsyncTextureLoader::waitForAll()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mIdleCondition.wait(lock, [&]() { return mPendingJobCount == 0; });
     }
 
-    void AsyncTextureLoader::runWorker()
+    AsyncTextureLoader::Stats AsyncTextureLoader::getStats() const
     {
-        // This function is the entry point for worker threads.
-        // The workers wait on the load request queue and load a texture when woken up.
-        // To avoid the upload heap growing too large, we synchronize the threads and
-        // issue a global GPU flush at regular intervals.
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+    size_t AsyncTextureLoader::cancelJobs(const std::function<bool(const LoadJob&)>& predicate, std::vector<LoadJobPtr>& cancelledJobs)
+    {
+        // Called from within the critical section.
+        // Waiters of cancelled jobs are completed by the caller after releasing the mutex.
+        size_t count = 0;
+        for (auto it = mJobsInFlight.begin(); it != mJobsInFlight.end();)
+        {
+            LoadJobPtr pJob = it->second;
+            if (!predicate(*pJob))
+            {
+                ++it;
+                continue;
+            }
+
+            if (mDecodeQueue.erase(pJob))
+            {
+                mPendingJobCount--;
+            }
+            else if (mUploadQueue.erase(pJob))
+            {
+                mInFlightBytes -= pJob->inFlightBytes;
+                pJob->file = {};
+                mPendingJobCount--;
+                mDecodeCondition.notify_all();
+            }
+            else
+            {
+                // The job is currently being decoded. The decode worker drops it when done.
+                pJob->cancelled = true;
+            }
+
+            count += pJob->waiters.size();
+            it = mJobsInFlight.erase(it);
+            cancelledJobs.push_back(std::move(pJob));
+        }
+
+        mStats.cancelledCount += count;
+        if (mPendingJobCount == 0) mIdleCondition.notify_all();
+
+        return count;
+    }
+
+    void AsyncTextureLoader::runDecodeWorker()
+    {
+        // This function is the entry point for decode worker threads.
+        // The workers pick the highest priority job from the decode queue, read and decode the image
+        // into host memory and pass it on to the upload worker. Workers stall while the decoded data
+        // waiting for upload exceeds the in-flight budget.
+
+        auto canDecode = [&]()
+        {
+            return !mDecodeQueue.empty() && (mInFlightBytes == 0 || mInFlightBytes < mMaxInFlightBytes);
+        };
+
+        CpuProfiler::instance().setThreadName("AsyncTextureLoader decode");
 
         while (true)
         {
             // Wait on condition until more work is ready.
             std::unique_lock<std::mutex> lock(mMutex);
-            mCondition.wait(lock, [&]() { return mTerminate || !mLoadRequestQueue.empty() || mFlushPending; });
+            mDecodeCondition.wait(lock, [&]() { return mTerminate || canDecode(); });
 
-            // Sync thread if a flush is pending.
-            if (mFlushPending)
+            if (!canDecode())
             {
-                lock.unlock();
-                mFlushBarrier->wait();
-                mCondition.notify_one();
+                if (mTerminate) break;
                 continue;
             }
 
-            // Terminate thread unless there is more work to do.
-            if (mTerminate && mLoadRequestQueue.empty() && !mFlushPending) break;
+            // Pop highest priority job from queue.
+            LoadJobPtr pJob = *mDecodeQueue.begin();
+            mDecodeQueue.erase(mDecodeQueue.begin());
+
+            lock.unlock();
+
+            // Decode the image (this part is running in parallel).
+            {
+                FALCOR_PROFILE_CPU("AsyncTextureLoader::decode");
+                decode(*pJob);
+            }
+
+            lock.lock();
+
+            if (pJob->cancelled)
+            {
+                // The job was cancelled during decoding. Its waiters have already been completed.
+                mPendingJobCount--;
+                if (mPendingJobCount == 0) mIdleCondition.notify_all();
+                continue;
+            }
+
+            mInFlightBytes += pJob->inFlightBytes;
+            mStats.peakInFlightBytes = std::max(mStats.peakInFlightBytes, mInFlightBytes);
+            mUploadQueue.insert(pJob);
+            mUploadCondition.notify_one();
+        }
+    }
+
+    void AsyncTextureLoader::runUploadWorker()
+    {
+        // This function is the entry point for the upload worker thread.
+        // All GPU texture creation happens on this thread, so no synchronization between workers is
+        // needed for flushing. To avoid the upload heap growing too large, we issue a global GPU flush
+        // after a number of uploads or bytes, and when the last pending job has been uploaded.
+
+        size_t uploadsSinceFlush = 0;
+        size_t bytesSinceFlush = 0;
+
+        CpuProfiler::instance().setThreadName("AsyncTextureLoader upload");
+
+        while (true)
+        {
+            // Wait on condition until more work is ready.
+            std::unique_lock<std::mutex> lock(mMutex);
+            mUploadCondition.wait(lock, [&]() { return mTerminate || !mUploadQueue.empty(); });
 
-            // Go back waiting if queue is currently empty.
-            if (mLoadRequestQueue.empty()) continue;
+            if (mUploadQueue.empty())
+            {
+                if (mTerminate) break;
+                continue;
+            }
 
-            // Pop next load request from queue.
-            auto request = std::move(mLoadRequestQueue.front());
-            mLoadRequestQueue.pop();
+            // Pop highest priority job from queue. Once the upload has started the job can no longer be merged or cancelled.
+            LoadJobPtr pJob = *mUploadQueue.begin();
+            mUploadQueue.erase(mUploadQueue.begin());
+            if (auto it = mJobsInFlight.find(pJob->key); it != mJobsInFlight.end() && it->second == pJob) mJobsInFlight.erase(it);
 
             lock.unlock();
 
-            // Load the textures (this part is running in parallel).
-            Texture::SharedPtr pTexture = Texture::createFromFile(request.path, request.generateMipLevels, request.loadAsSRGB, request.bindFlags);
-            request.promise.set_value(pTexture);
+            Texture::SharedPtr pTexture;
+            {
+                FALCOR_PROFILE_CPU("AsyncTextureLoader::upload");
+                pTexture = upload(*pJob);
+            }
+            size_t uploadedBytes = pJob->inFlightBytes;
+            pJob->file = {};
+
+            complete(*pJob, pTexture);
 
-            if (request.callback)
+            if (pTexture)
             {
-                request.callback(pTexture);
+                uploadsSinceFlush++;
+                bytesSinceFlush += uploadedBytes;
             }
 
             lock.lock();
 
+            // Release the decoded data from the in-flight budget.
+            mInFlightBytes -= pJob->inFlightBytes;
+            mDecodeCondition.notify_all();
+
+            if (pTexture)
+            {
+                mStats.uploadedCount++;
+                mStats.uploadedBytes += uploadedBytes;
+            }
+
             // Issue a global flush if necessary.
             // TODO: It would be better to check the size of the upload heap instead.
-            if (!mTerminate && pTexture != nullptr &&
-                ++mUploadCounter >= kUploadsPerFlush)
+            bool flush = uploadsSinceFlush >= kUploadsPerFlush || bytesSinceFlush >= kUploadBytesPerFlush || (mPendingJobCount == 1 && uploadsSinceFlush > 0);
+            if (flush)
             {
-                mFlushPending = true;
-                mCondition.notify_all();
+                lock.unlock();
+                {
+                    FALCOR_PROFILE_CPU("AsyncTextureLoader::flush");
+                    gpDevice->flushAndSync();
+                }
+                lock.lock();
+                uploadsSinceFlush = 0;
+                bytesSinceFlush = 0;
+                mStats.flushCount++;
             }
 
-            mCondition.notify_one();
+            mPendingJobCount--;
+            if (mPendingJobCount == 0) mIdleCondition.notify_all();
         }
     }
 
@@ -136,8 +332,32 @@ namespace Falcor
             mTerminate = true;
         }
 
-        mCondition.notify_all();
+        mDecodeCondition.notify_all();
+        mUploadCondition.notify_all();
 
-        for (auto& thread : mThreads) thread.join();
+        for (auto& thread : mDecodeThreads) thread.join();
+        mUploadThread.join();
+    }
+
+    void AsyncTextureLoader::decode(LoadJob& job)
+    {
+        job.file = Texture::decodeFile(job.path, job.loadAsSRGB);
+        job.inFlightBytes = job.file.getSize();
+    }
+
+    Texture::SharedPtr AsyncTextureLoader::upload(LoadJob& job)
+    {
+        return Texture::createFromDecodedFile(job.file, job.generateMipLevels, job.bindFlags);
+    }
+
+    void AsyncTextureLoader::complete(LoadJob& job, const Texture::SharedPtr& pTexture)
+    {
+        // Called without holding the mutex. The job is no longer reachable from the queues, so its waiters can be accessed freely.
+        for (auto& waiter : job.waiters)
+        {
+            waiter.promise.set_value(pTexture);
+            if (waiter.callback) waiter.callback(pTexture);
+        }
+        job.waiters.clear();
     }
 }
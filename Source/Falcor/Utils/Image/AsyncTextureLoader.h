@@ -26,6 +26,7 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #pragma once
+#include "Bitmap.h"
 #include "Core/Macros.h"
 #include "Core/API/Resource.h"
 #include "Core/API/Texture.h"
@@ -33,73 +34,173 @@
 #include <filesystem>
 #include <functional>
 #include <future>
+#include <map>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <set>
 #include <thread>
+#include <tuple>
 #include <vector>
 
 namespace Falcor
 {
-    class Barrier;
+    /** Utility class to load textures asynchronously.
 
-    /** Utility class to load textures asynchronously using multiple worker threads.
+        Loading is split into two pipelined stages:
+        - Decode: a pool of worker threads reads and decodes image files into host memory.
+        - Upload: a single upload thread creates the GPU textures and periodically flushes the device
+          to keep the upload heap bounded. Decoding of further textures continues while the upload
+          thread is busy or flushing.
+
+        The amount of decoded but not yet uploaded host memory is bounded by a byte budget.
+        Decode workers stall while the budget is exhausted. Since the size of a texture is only known after
+        decoding, the budget can be exceeded by at most one texture per decode worker.
+
+        Requests are processed in order of descending priority, and in submission order for equal
+        priorities. Identical requests (same path and load options) that are still in flight are
+        merged and complete together. Requests can be cancelled until their upload has started.
     */
     class FALCOR_API AsyncTextureLoader
     {
     public:
         using LoadCallback = std::function<void(Texture::SharedPtr pTexture)>;
 
+        static constexpr uint32_t kDefaultPriority = 0;                             ///< Default request priority.
+        static constexpr uint32_t kHighPriority = 100;                              ///< Priority for textures that should be available first (e.g. emissive textures).
+        static constexpr size_t kDefaultMaxInFlightBytes = size_t(1) << 30;         ///< Default budget for decoded texture data waiting for upload (1 GB).
+
+        /** Loader statistics. All counters are accumulated over the lifetime of the loader.
+        */
+        struct Stats
+        {
+            size_t requestCount = 0;        ///< Number of calls to loadFromFile().
+            size_t mergedCount = 0;         ///< Number of requests merged with an identical request in flight.
+            size_t cancelledCount = 0;      ///< Number of requests completed by cancellation.
+            size_t uploadedCount = 0;       ///< Number of textures uploaded.
+            size_t uploadedBytes = 0;       ///< Number of bytes of decoded texture data uploaded.
+            size_t flushCount = 0;          ///< Number of GPU flushes issued by the upload stage.
+            size_t peakInFlightBytes = 0;   ///< Peak number of decoded bytes waiting for upload.
+        };
+
         /** Constructor.
-            \param[in] threadCount Number of worker threads.
+            \param[in] threadCount Number of decode worker threads.
+            \param[in] maxInFlightBytes Budget in bytes for decoded texture data waiting for upload.
         */
-        AsyncTextureLoader(size_t threadCount = std::thread::hardware_concurrency());
+        AsyncTextureLoader(size_t threadCount = std::thread::hardware_concurrency(), size_t maxInFlightBytes = kDefaultMaxInFlightBytes);
 
         /** Destructor.
-            Blocks until all threads have terminated.
+            Blocks until all pending requests have completed and all threads have terminated.
         */
         ~AsyncTextureLoader();
 
         /** Request loading a texture.
+            If an identical request (same path and load options) is still in flight, the request is merged with it
+            and its priority is raised to the higher of the two.
             \param[in] path File path of the texture. This can be a full path or a relative path from a data directory.
             \param[in] generateMipLevels Whether the full mip-chain should be generated.
             \param[in] loadAsSRGB Load the texture as sRGB format if supported, otherwise linear color.
             \param[in] bindFlags The bind flags for the texture resource.
-            \param[in] callback Function called after the texture load has finished.
-            \return A future to a new texture, or nullptr if the texture failed to load.
+            \param[in] callback Function called after the texture load has finished. Called from a loader thread.
+            \param[in] priority Request priority. Requests with higher priority are loaded first.
+            \return A future to a new texture, or nullptr if the texture failed to load or the request was cancelled.
         */
         std::future<Texture::SharedPtr> loadFromFile(
             const std::filesystem::path& path,
             bool generateMipLevels,
             bool loadAsSRGB,
             Resource::BindFlags bindFlags = Resource::BindFlags::ShaderResource,
-            LoadCallback callback = {}
+            LoadCallback callback = {},
+            uint32_t priority = kDefaultPriority
         );
 
-    private:
-        void runWorkers(size_t threadCount);
-        void runWorker();
-        void terminateWorkers();
+        /** Cancel all in-flight requests for a given path.
+            Requests whose upload has already started are not affected.
+            Cancelled requests complete with nullptr and their callbacks are invoked.
+            \param[in] path File path of the texture, as passed to loadFromFile().
+            \return Number of cancelled requests.
+        */
+        size_t cancel(const std::filesystem::path& path);
+
+        /** Cancel all in-flight requests.
+            \return Number of cancelled requests.
+        */
+        size_t cancelAll();
+
+        /** Block until all requests issued so far have completed.
+        */
+        void waitForAll();
+
+        /** Get loader statistics.
+        */
+        Stats getStats() const;
 
-        struct LoadRequest
+    private:
+        struct Waiter
         {
-            std::filesystem::path path;
-            bool generateMipLevels;
-            bool loadAsSRGB;
-            Resource::BindFlags bindFlags;
             LoadCallback callback;
             std::promise<Texture::SharedPtr> promise;
         };
 
-        std::mutex mMutex;                          ///< Mutex for synchronizing access to shared resources.
-        std::condition_variable mCondition;         ///< Condition variable for workers to wait on.
-        std::shared_ptr<Barrier> mFlushBarrier;     ///< Barrier for flushing the GPU to upload textures.
-        std::vector<std::thread> mThreads;          ///< Worker threads.
+        using RequestKey = std::tuple<std::filesystem::path, bool, bool, Resource::BindFlags>;
+
+        /** A unique load job. Multiple identical requests share one job.
+        */
+        struct LoadJob
+        {
+            RequestKey key;
+            std::filesystem::path path;
+            bool generateMipLevels = false;
+            bool loadAsSRGB = false;
+            Resource::BindFlags bindFlags = Resource::BindFlags::None;
+            uint32_t priority = kDefaultPriority;
+            uint64_t sequence = 0;                  ///< Submission order, used to break priority ties.
+            bool cancelled = false;                 ///< True if cancelled while decoding.
+
+            std::vector<Waiter> waiters;
+
+            // Output of the decode stage.
+            Texture::DecodedFile file;              ///< Decoded image file (without image data if decoding failed).
+            size_t inFlightBytes = 0;               ///< Bytes accounted against the in-flight budget.
+        };
+
+        using LoadJobPtr = std::shared_ptr<LoadJob>;
+
+        struct JobOrder
+        {
+            bool operator()(const LoadJobPtr& a, const LoadJobPtr& b) const
+            {
+                if (a->priority != b->priority) return a->priority > b->priority;
+                return a->sequence < b->sequence;
+            }
+        };
+
+        void runDecodeWorker();
+        void runUploadWorker();
+        void terminateWorkers();
+
+        void decode(LoadJob& job);
+        Texture::SharedPtr upload(LoadJob& job);
+        void complete(LoadJob& job, const Texture::SharedPtr& pTexture);
+        size_t cancelJobs(const std::function<bool(const LoadJob&)>& predicate, std::vector<LoadJobPtr>& cancelledJobs);
+
+        const size_t mMaxInFlightBytes;
+
+        mutable std::mutex mMutex;                  ///< Mutex for synchronizing access to shared resources.
+        std::condition_variable mDecodeCondition;   ///< Condition variable for decode workers to wait on.
+        std::condition_variable mUploadCondition;   ///< Condition variable for the upload worker to wait on.
+        std::condition_variable mIdleCondition;     ///< Condition variable signaled when jobs complete.
+        std::vector<std::thread> mDecodeThreads;    ///< Decode worker threads.
+        std::thread mUploadThread;                  ///< Upload worker thread.
 
         // Internal state. Do not access outside of critical section.
-        std::queue<LoadRequest> mLoadRequestQueue;  ///< Texture loading request queue.
+        std::set<LoadJobPtr, JobOrder> mDecodeQueue;        ///< Jobs waiting to be decoded, ordered by priority.
+        std::set<LoadJobPtr, JobOrder> mUploadQueue;        ///< Decoded jobs waiting to be uploaded, ordered by priority.
+        std::map<RequestKey, LoadJobPtr> mJobsInFlight;     ///< All jobs that have not started uploading, for merging identical requests.
+        size_t mPendingJobCount = 0;                        ///< Number of jobs not yet completed.
+        size_t mInFlightBytes = 0;                          ///< Decoded bytes waiting for upload.
+        uint64_t mNextSequence = 0;
+        Stats mStats;
 
         bool mTerminate = false;                    ///< Flag to terminate worker threads.
-        bool mFlushPending = false;                 ///< Flag to indicate a GPU flush is pending.
-        uint32_t mUploadCounter = 0;                ///< Counter to issue a flush every few uploads.
     };
 }
@@ -26,6 +26,7 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #include "Bitmap.h"
+#include "ScanlineWriter.h"
 #include "Core/API/Texture.h"
 #include "Utils/Logger.h"
 #include "Utils/StringUtils.h"
@@ -487,15 +488,8 @@ namespace Falcor
 
         if (fileFormat == Bitmap::FileFormat::PfmFile || fileFormat == Bitmap::FileFormat::ExrFile)
         {
-            std::vector<float> floatData;
-            if (isConvertibleToRGBA32Float(resourceFormat))
-            {
-                floatData = convertToRGBA32Float(resourceFormat, width, height, pData);
-                pData = floatData.data();
-                resourceFormat = ResourceFormat::RGBA32Float;
-                bytesPerPixel = 16;
-            }
-            else if (bytesPerPixel != 16 && bytesPerPixel != 12)
+            const bool convertToFloat = isConvertibleToRGBA32Float(resourceFormat);
+            if (!convertToFloat && bytesPerPixel != 16 && bytesPerPixel != 12)
             {
                 reportError("Bitmap::saveImage supports only 32-bit/channel RGB/RGBA or 16-bit RGBA images as PFM/EXR files.");
                 return;
@@ -517,49 +511,61 @@ namespace Falcor
                 }
             }
 
-            if (exportAlpha && bytesPerPixel != 16)
+            if (exportAlpha && !convertToFloat && bytesPerPixel != 16)
             {
                 reportError("Bitmap::saveImage requesting to export alpha-channel to EXR file, but the resource doesn't have an alpha-channel");
                 return;
             }
 
-            // Upload the image manually and flip it vertically
-            bool scanlineCopy = exportAlpha ? bytesPerPixel == 16 : bytesPerPixel == 12;
-
-            pImage = FreeImage_AllocateT(exportAlpha ? FIT_RGBAF : FIT_RGBF, width, height);
-            BYTE* head = (BYTE*)pData;
-            for (unsigned y = 0; y < height; y++)
+            // Stream the image to file. Rows are converted to RGBA float in blocks, so no full-frame copy is made.
+            const uint8_t* pSrc = static_cast<const uint8_t*>(pData);
+            const size_t rowPitch = size_t(bytesPerPixel) * width;
+            auto reader = [=](uint32_t y, uint32_t rowCount, float* pDst)
             {
-                float* dstBits = (float*)FreeImage_GetScanLine(pImage, height - y - 1);
-                if (scanlineCopy)
+                const uint8_t* pRows = pSrc + y * rowPitch;
+                if (convertToFloat)
+                {
+                    auto floatData = convertToRGBA32Float(resourceFormat, width, rowCount, pRows);
+                    std::memcpy(pDst, floatData.data(), floatData.size() * sizeof(float));
+                }
+                else if (bytesPerPixel == 16)
                 {
-                    std::memcpy(dstBits, head, bytesPerPixel * width);
+                    std::memcpy(pDst, pRows, rowPitch * rowCount);
                 }
                 else
                 {
-                    FALCOR_ASSERT(exportAlpha == false);
-                    for (unsigned x = 0; x < width; x++)
+                    const float* pSrcFloat = reinterpret_cast<const float*>(pRows);
+                    for (size_t i = 0; i < size_t(width) * rowCount; ++i)
                     {
-                        dstBits[x*3 + 0] = (((float*)head)[x*4 + 0]);
-                        dstBits[x*3 + 1] = (((float*)head)[x*4 + 1]);
-                        dstBits[x*3 + 2] = (((float*)head)[x*4 + 2]);
+                        pDst[i * 4 + 0] = pSrcFloat[i * 3 + 0];
+                        pDst[i * 4 + 1] = pSrcFloat[i * 3 + 1];
+                        pDst[i * 4 + 2] = pSrcFloat[i * 3 + 2];
+                        pDst[i * 4 + 3] = 1.f;
                     }
                 }
-                head += bytesPerPixel * width;
-            }
+            };
 
-            if (fileFormat == Bitmap::FileFormat::ExrFile)
+            try
             {
-                flags = 0;
-                if (is_set(exportFlags, ExportFlags::Uncompressed))
+                if (fileFormat == Bitmap::FileFormat::ExrFile)
                 {
-                    flags |= EXR_NONE | EXR_FLOAT;
+                    // Lossy export previously used B44. The streaming writer stores half float data with lossless ZIP compression instead.
+                    ScanlineWriter::ExrOptions options;
+                    options.exportAlpha = exportAlpha;
+                    options.halfFloat = !is_set(exportFlags, ExportFlags::Uncompressed);
+                    options.compression = is_set(exportFlags, ExportFlags::Uncompressed) ? ScanlineWriter::ExrCompression::None : ScanlineWriter::ExrCompression::Zip;
+                    ScanlineWriter::writeEXR(path, width, height, reader, options);
                 }
-                else if (is_set(exportFlags, ExportFlags::Lossy))
+                else
                 {
-                    flags |= EXR_B44 | EXR_ZIP;
+                    ScanlineWriter::writePFM(path, width, height, reader);
                 }
             }
+            catch (const std::exception& e)
+            {
+                reportError(fmt::format("Bitmap::saveImage: {}", e.what()));
+            }
+            return;
         }
         else
         {
@@ -40,22 +40,6 @@ namespace Falcor
 {
     namespace
     {
-        struct ImportData
-        {
-            // Commonly used values converted or casted for cleaner access
-            ResourceFormat format;
-            Resource::Type type;
-            uint32_t width;
-            uint32_t height;
-            uint32_t depth;
-            uint32_t arraySize;
-            uint32_t mipLevels;
-            bool hasDX10Header = false;
-
-            // Data to be imported
-            std::vector<uint8_t> imageData;
-        };
-
         struct ExportData
         {
             // Commonly used values converted or casted for cleaner access
@@ -388,7 +372,7 @@ namespace Falcor
         }
 
         // Reads image information from the DDS header data contained in pHeaderData.
-        void readDDSHeader(ImportData& data, const void* pHeaderData, size_t& headerSize, bool loadAsSrgb)
+        void readDDSHeader(DDSData& data, const void* pHeaderData, size_t& headerSize, bool loadAsSrgb)
         {
             // Check magic number
             auto magic = *static_cast<const uint32_t*>(pHeaderData);
@@ -404,7 +388,7 @@ namespace Falcor
                 throw RuntimeError("DDS header size mismatch.");
             }
 
-            // Check for the presence of the extended DX10 header and fill in ImportData fields with their corresponding values
+            // Check for the presence of the extended DX10 header and fill in DDSData fields with their corresponding values
             data.mipLevels = (pHeader->mipMapCount == 0) ? 1 : pHeader->mipMapCount;
             auto pixelFormat = pHeader->ddspf;
             auto fourCC = pixelFormat.fourCC;
@@ -498,7 +482,7 @@ namespace Falcor
         }
 
         // Loads the information and data for the specified image. This function does not handle creation of the texture for the image.
-        void loadDDS(const std::filesystem::path& path, bool loadAsSrgb, ImportData& data)
+        void loadDDS(const std::filesystem::path& path, bool loadAsSrgb, DDSData& data)
         {
             std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
             if (!file)
@@ -567,7 +551,7 @@ namespace Falcor
             return nullptr;
         }
 
-        ImportData data;
+        DDSData data;
         try
         {
             loadDDS(fullPath, false, data);
@@ -597,7 +581,7 @@ namespace Falcor
             return nullptr;
         }
 
-        ImportData data;
+        DDSData data;
         try
         {
             loadDDS(fullPath, loadAsSrgb, data);
@@ -608,33 +592,40 @@ namespace Falcor
             return nullptr;
         }
 
-        Texture::SharedPtr pTex;
+        Texture::SharedPtr pTex = createTextureFromDDS(data);
+        if (pTex == nullptr)
+        {
+            logWarning("Failed to load DDS image from '{}': Unrecognized texture type.", path);
+            return nullptr;
+        }
+
+        pTex->setSourcePath(fullPath);
+        return pTex;
+    }
+
+    DDSData ImageIO::loadDDSData(const std::filesystem::path& path, bool loadAsSrgb)
+    {
+        DDSData data;
+        loadDDS(path, loadAsSrgb, data);
+        return data;
+    }
+
+    Texture::SharedPtr ImageIO::createTextureFromDDS(const DDSData& data)
+    {
         // TODO: Automatic mip generation
         switch (data.type)
         {
         case Resource::Type::Texture1D:
-            pTex = Texture::create1D(data.width, data.format, data.arraySize, data.mipLevels, data.imageData.data());
-            break;
+            return Texture::create1D(data.width, data.format, data.arraySize, data.mipLevels, data.imageData.data());
         case Resource::Type::Texture2D:
-            pTex = Texture::create2D(data.width, data.height, data.format, data.arraySize, data.mipLevels, data.imageData.data());
-            break;
+            return Texture::create2D(data.width, data.height, data.format, data.arraySize, data.mipLevels, data.imageData.data());
         case Resource::Type::TextureCube:
-            pTex = Texture::createCube(data.width, data.height, data.format, data.arraySize / 6, data.mipLevels, data.imageData.data());
-            break;
+            return Texture::createCube(data.width, data.height, data.format, data.arraySize / 6, data.mipLevels, data.imageData.data());
         case Resource::Type::Texture3D:
-            pTex = Texture::create3D(data.width, data.height, data.depth, data.format, data.mipLevels, data.imageData.data());
-            break;
+            return Texture::create3D(data.width, data.height, data.depth, data.format, data.mipLevels, data.imageData.data());
         default:
-            logWarning("Failed to load DDS image from '{}': Unrecognized texture type.", path);
             return nullptr;
         }
-
-        if (pTex != nullptr)
-        {
-            pTex->setSourcePath(fullPath);
-        }
-
-        return pTex;
     }
 
     void ImageIO::saveToDDS(const std::filesystem::path& path, const Bitmap& bitmap, CompressionMode mode, bool generateMips)
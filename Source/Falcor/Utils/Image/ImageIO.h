@@ -30,11 +30,28 @@
 #include "Core/Macros.h"
 #include "Core/API/Texture.h"
 #include <filesystem>
+#include <vector>
 
 namespace Falcor
 {
     class CopyContext;
 
+    /** Contents of a DDS file, in the GPU format of the file and including all array slices and mip levels.
+    */
+    struct DDSData
+    {
+        ResourceFormat format = ResourceFormat::Unknown;
+        Resource::Type type = Resource::Type::Texture2D;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t depth = 0;
+        uint32_t arraySize = 0;     ///< Number of array slices. Six per cube for cube maps.
+        uint32_t mipLevels = 0;
+        bool hasDX10Header = false;
+
+        std::vector<uint8_t> imageData;
+    };
+
     class FALCOR_API ImageIO
     {
     public:
@@ -95,6 +112,20 @@ namespace Falcor
         */
         static Texture::SharedPtr loadTextureFromDDS(const std::filesystem::path& path, bool loadAsSrgb);
 
+        /** Read a DDS file into host memory without creating a texture.
+            Throws an exception if the DDS file is malformed.
+            \param[in] path Full path of the file to load.
+            \param[in] loadAsSrgb If true, convert the image format property to a corresponding sRGB format if available. Image data is not changed.
+            eturn Contents of the DDS file.
+        */
+        static DDSData loadDDSData(const std::filesystem::path& path, bool loadAsSrgb);
+
+        /** Create a texture from the contents of a DDS file.
+            \param[in] data Contents of the DDS file, see loadDDSData().
+            eturn Texture object, or nullptr if the resource type is not supported.
+        */
+        static Texture::SharedPtr createTextureFromDDS(const DDSData& data);
+
         /** Saves a bitmap to a DDS file.
             Throws an exception if path is invalid or the image cannot be saved.
             \param[in] path Path to save to.
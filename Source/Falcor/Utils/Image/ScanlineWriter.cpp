@@ -0,0 +1,321 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "ScanlineWriter.h"
+#include "Core/Errors.h"
+#include "Utils/NumericRange.h"
+#include "Utils/StringFormatters.h"
+#include <glm/detail/type_half.hpp>
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <execution>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Falcor
+{
+    namespace
+    {
+        constexpr uint32_t kExrZipLinesPerChunk = 16;   ///< Scanlines per chunk for ZIP compression (fixed by the file format).
+        constexpr uint32_t kPfmLinesPerBlock = 32;      ///< Rows per block when writing PFM files.
+
+        using Block = std::vector<uint8_t>;
+
+        /** Produce blocks in parallel and consume them in order.
+            At most a few blocks per thread are in flight, so memory use is bounded independent of the image size.
+        */
+        void processBlocksInOrder(uint32_t blockCount, const std::function<void(uint32_t, Block&)>& produce, const std::function<void(uint32_t, const Block&)>& consume)
+        {
+            const uint32_t batchSize = std::max(1u, std::thread::hardware_concurrency()) * 2;
+            std::vector<Block> blocks(batchSize);
+
+            for (uint32_t batchStart = 0; batchStart < blockCount; batchStart += batchSize)
+            {
+                const uint32_t count = std::min(batchSize, blockCount - batchStart);
+
+                // Exceptions must not escape the parallel algorithm, so the first one is captured and rethrown.
+                std::exception_ptr pException;
+                std::mutex exceptionMutex;
+                auto range = NumericRange<uint32_t>(0, count);
+                std::for_each(std::execution::par, range.begin(), range.end(), [&](uint32_t i)
+                {
+                    try
+                    {
+                        produce(batchStart + i, blocks[i]);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(exceptionMutex);
+                        if (!pException) pException = std::current_exception();
+                    }
+                });
+                if (pException) std::rethrow_exception(pException);
+
+                for (uint32_t i = 0; i < count; ++i) consume(batchStart + i, blocks[i]);
+            }
+        }
+
+        class HeaderWriter
+        {
+        public:
+            void writeString(const std::string& s) { mData.insert(mData.end(), s.begin(), s.end()); mData.push_back(0); }
+            void writeUint8(uint8_t v) { mData.push_back(v); }
+            template<typename T> void write(const T& v) { const uint8_t* p = reinterpret_cast<const uint8_t*>(&v); mData.insert(mData.end(), p, p + sizeof(T)); }
+
+            void beginAttribute(const std::string& name, const std::string& type, int32_t size)
+            {
+                writeString(name);
+                writeString(type);
+                write(size);
+            }
+
+            const std::vector<uint8_t>& getData() const { return mData; }
+
+        private:
+            std::vector<uint8_t> mData;
+        };
+
+        /** Apply the OpenEXR ZIP predictor and byte reordering, then deflate.
+            Returns false if the compressed data is not smaller than the input, in which case the data is stored uncompressed.
+        */
+        bool compressZip(const std::vector<uint8_t>& raw, std::vector<uint8_t>& tmp, Block& out)
+        {
+            const size_t size = raw.size();
+            tmp.resize(size);
+
+            // Split even and odd bytes into two halves.
+            uint8_t* t1 = tmp.data();
+            uint8_t* t2 = tmp.data() + (size + 1) / 2;
+            for (size_t i = 0; i < size; ++i)
+            {
+                if ((i & 1) == 0) *t1++ = raw[i];
+                else *t2++ = raw[i];
+            }
+
+            // Delta predictor.
+            int p = size > 0 ? tmp[0] : 0;
+            for (size_t i = 1; i < size; ++i)
+            {
+                int d = int(tmp[i]) - p + (128 + 256);
+                p = tmp[i];
+                tmp[i] = uint8_t(d);
+            }
+
+            uLongf compressedSize = compressBound((uLong)size);
+            out.resize(compressedSize);
+            if (compress(out.data(), &compressedSize, tmp.data(), (uLong)size) != Z_OK || compressedSize >= size) return false;
+            out.resize(compressedSize);
+            return true;
+        }
+
+        std::ofstream openFile(const std::filesystem::path& path)
+        {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            if (!file) throw RuntimeError("Failed to open '{}' for writing.", path);
+            return file;
+        }
+    }
+
+    size_t ScanlineWriter::writeEXR(const std::filesystem::path& path, uint32_t width, uint32_t height, const RowReader& reader, const ExrOptions& options)
+    {
+        if (width == 0 || height == 0) throw ArgumentError("Cannot write empty image to '{}'.", path);
+
+        const uint32_t linesPerChunk = options.compression == ExrCompression::Zip ? kExrZipLinesPerChunk : 1;
+        const uint32_t chunkCount = (height + linesPerChunk - 1) / linesPerChunk;
+        const uint32_t bytesPerSample = options.halfFloat ? 2 : 4;
+
+        // Channels must be sorted by name. Indices refer to RGBA components.
+        std::vector<std::pair<std::string, uint32_t>> channels;
+        if (options.exportAlpha) channels.push_back({ "A", 3 });
+        channels.push_back({ "B", 2 });
+        channels.push_back({ "G", 1 });
+        channels.push_back({ "R", 0 });
+
+        // Header.
+        HeaderWriter header;
+        header.write(uint32_t(20000630)); // Magic number.
+        header.write(uint32_t(2));        // Version 2, single-part scanline file.
+
+        int32_t channelListSize = 1;
+        for (const auto& channel : channels) channelListSize += int32_t(channel.first.size() + 1 + 16);
+        header.beginAttribute("channels", "chlist", channelListSize);
+        for (const auto& channel : channels)
+        {
+            header.writeString(channel.first);
+            header.write(int32_t(options.halfFloat ? 1 : 2)); // Pixel type (1 = HALF, 2 = FLOAT).
+            header.write(uint32_t(0));                         // pLinear and reserved.
+            header.write(int32_t(1));                          // xSampling.
+            header.write(int32_t(1));                          // ySampling.
+        }
+        header.writeUint8(0);
+
+        header.beginAttribute("compression", "compression", 1);
+        header.writeUint8(options.compression == ExrCompression::Zip ? 3 : 0);
+
+        for (const char* name : { "dataWindow", "displayWindow" })
+        {
+            header.beginAttribute(name, "box2i", 16);
+            header.write(int32_t(0));
+            header.write(int32_t(0));
+            header.write(int32_t(width - 1));
+            header.write(int32_t(height - 1));
+        }
+
+        header.beginAttribute("lineOrder", "lineOrder", 1);
+        header.writeUint8(0); // Increasing y.
+
+        header.beginAttribute("pixelAspectRatio", "float", 4);
+        header.write(1.f);
+
+        header.beginAttribute("screenWindowCenter", "v2f", 8);
+        header.write(0.f);
+        header.write(0.f);
+
+        header.beginAttribute("screenWindowWidth", "float", 4);
+        header.write(1.f);
+
+        header.writeUint8(0); // End of header.
+
+        std::ofstream file = openFile(path);
+        file.write(reinterpret_cast<const char*>(header.getData().data()), header.getData().size());
+
+        // Offset table, filled in after the chunks are written.
+        const std::streamoff offsetTablePos = file.tellp();
+        std::vector<uint64_t> offsets(chunkCount, 0);
+        file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+
+        auto produce = [&](uint32_t chunkIndex, Block& block)
+        {
+            const uint32_t y = chunkIndex * linesPerChunk;
+            const uint32_t rowCount = std::min(linesPerChunk, height - y);
+
+            std::vector<float> pixels(size_t(rowCount) * width * 4);
+            reader(y, rowCount, pixels.data());
+
+            // Each scanline stores all samples of one channel after another.
+            std::vector<uint8_t> raw(size_t(rowCount) * width * channels.size() * bytesPerSample);
+            uint8_t* dst = raw.data();
+            for (uint32_t row = 0; row < rowCount; ++row)
+            {
+                const float* src = pixels.data() + size_t(row) * width * 4;
+                for (const auto& channel : channels)
+                {
+                    if (options.halfFloat)
+                    {
+                        uint16_t* dstHalf = reinterpret_cast<uint16_t*>(dst);
+                        for (uint32_t x = 0; x < width; ++x) dstHalf[x] = uint16_t(glm::detail::toFloat16(src[x * 4 + channel.second]));
+                    }
+                    else
+                    {
+                        float* dstFloat = reinterpret_cast<float*>(dst);
+                        for (uint32_t x = 0; x < width; ++x) dstFloat[x] = src[x * 4 + channel.second];
+                    }
+                    dst += size_t(width) * bytesPerSample;
+                }
+            }
+
+            Block data;
+            std::vector<uint8_t> tmp;
+            bool compressed = options.compression == ExrCompression::Zip && compressZip(raw, tmp, data);
+            const Block& payload = compressed ? data : raw;
+
+            block.resize(8 + payload.size());
+            int32_t chunkHeader[2] = { int32_t(y), int32_t(payload.size()) };
+            std::memcpy(block.data(), chunkHeader, sizeof(chunkHeader));
+            std::memcpy(block.data() + 8, payload.data(), payload.size());
+        };
+
+        auto consume = [&](uint32_t chunkIndex, const Block& block)
+        {
+            offsets[chunkIndex] = uint64_t(file.tellp());
+            file.write(reinterpret_cast<const char*>(block.data()), block.size());
+        };
+
+        processBlocksInOrder(chunkCount, produce, consume);
+
+        const size_t fileSize = size_t(file.tellp());
+        file.seekp(offsetTablePos);
+        file.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+        file.close();
+
+        if (!file) throw RuntimeError("Failed to write EXR file '{}'.", path);
+        return fileSize;
+    }
+
+    size_t ScanlineWriter::writePFM(const std::filesystem::path& path, uint32_t width, uint32_t height, const RowReader& reader)
+    {
+        if (width == 0 || height == 0) throw ArgumentError("Cannot write empty image to '{}'.", path);
+
+        // A negative scale denotes little endian data.
+        std::ofstream file = openFile(path);
+        std::string header = "PF\n" + std::to_string(width) + " " + std::to_string(height) + "\n-1.000000\n";
+        file.write(header.data(), header.size());
+
+        // PFM stores rows bottom to top. Blocks are enumerated from the bottom of the image.
+        const uint32_t blockCount = (height + kPfmLinesPerBlock - 1) / kPfmLinesPerBlock;
+
+        auto produce = [&](uint32_t blockIndex, Block& block)
+        {
+            const uint32_t yEnd = height - blockIndex * kPfmLinesPerBlock;
+            const uint32_t rowCount = std::min(kPfmLinesPerBlock, yEnd);
+            const uint32_t y = yEnd - rowCount;
+
+            std::vector<float> pixels(size_t(rowCount) * width * 4);
+            reader(y, rowCount, pixels.data());
+
+            block.resize(size_t(rowCount) * width * 3 * sizeof(float));
+            float* dst = reinterpret_cast<float*>(block.data());
+            for (uint32_t row = rowCount; row-- > 0;)
+            {
+                const float* src = pixels.data() + size_t(row) * width * 4;
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    *dst++ = src[x * 4 + 0];
+                    *dst++ = src[x * 4 + 1];
+                    *dst++ = src[x * 4 + 2];
+                }
+            }
+        };
+
+        auto consume = [&](uint32_t, const Block& block)
+        {
+            file.write(reinterpret_cast<const char*>(block.data()), block.size());
+        };
+
+        processBlocksInOrder(blockCount, produce, consume);
+
+        const size_t fileSize = size_t(file.tellp());
+        file.close();
+
+        if (!file) throw RuntimeError("Failed to write PFM file '{}'.", path);
+        return fileSize;
+    }
+}
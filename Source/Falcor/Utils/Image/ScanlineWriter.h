@@ -0,0 +1,84 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "Core/Macros.h"
+#include <filesystem>
+#include <functional>
+
+namespace Falcor
+{
+    /** Streaming writers for floating-point image files.
+        Pixel data is pulled from the caller in blocks of rows, so no full-frame copy of the image is made.
+        Blocks are converted and compressed in parallel and written in order.
+    */
+    class FALCOR_API ScanlineWriter
+    {
+    public:
+        /** Callback that reads a block of rows as RGBA32Float data.
+            Called concurrently from multiple threads for disjoint row ranges.
+            \param[in] y First row of the block. Row 0 is the top row of the image.
+            \param[in] rowCount Number of rows in the block.
+            \param[out] pDst Destination buffer with room for rowCount * width * 4 floats.
+        */
+        using RowReader = std::function<void(uint32_t y, uint32_t rowCount, float* pDst)>;
+
+        enum class ExrCompression
+        {
+            None,   ///< Uncompressed, one scanline per chunk.
+            Zip,    ///< Deflate compression, 16 scanlines per chunk.
+        };
+
+        struct ExrOptions
+        {
+            bool exportAlpha = false;                           ///< Write an alpha channel.
+            bool halfFloat = true;                              ///< Store channels as half instead of float.
+            ExrCompression compression = ExrCompression::Zip;   ///< Compression method.
+        };
+
+        /** Write a single-part scanline OpenEXR file.
+            Throws a RuntimeError if the file cannot be written.
+            \param[in] path File path.
+            \param[in] width Image width.
+            \param[in] height Image height.
+            \param[in] reader Callback providing the pixel data.
+            \param[in] options Output options.
+            \return Number of bytes written.
+        */
+        static size_t writeEXR(const std::filesystem::path& path, uint32_t width, uint32_t height, const RowReader& reader, const ExrOptions& options);
+
+        /** Write an RGB portable float map (PFM) file.
+            Throws a RuntimeError if the file cannot be written.
+            \param[in] path File path.
+            \param[in] width Image width.
+            \param[in] height Image height.
+            \param[in] reader Callback providing the pixel data.
+            \return Number of bytes written.
+        */
+        static size_t writePFM(const std::filesystem::path& path, uint32_t width, uint32_t height, const RowReader& reader);
+    };
+}
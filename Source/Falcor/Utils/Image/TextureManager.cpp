@@ -103,7 +103,7 @@ namespace Falcor
         return handle;
     }
 
-    TextureManager::TextureHandle TextureManager::loadTexture(const std::filesystem::path& path, bool generateMipLevels, bool loadAsSRGB, Resource::BindFlags bindFlags, bool async)
+    TextureManager::TextureHandle TextureManager::loadTexture(const std::filesystem::path& path, bool generateMipLevels, bool loadAsSRGB, Resource::BindFlags bindFlags, bool async, uint32_t priority)
     {
         TextureHandle handle;
 
@@ -154,7 +154,7 @@ namespace Falcor
             };
 
             // Issue load request to texture loader.
-            mAsyncTextureLoader.loadFromFile(fullPath, generateMipLevels, loadAsSRGB, bindFlags, callback);
+            mAsyncTextureLoader.loadFromFile(fullPath, generateMipLevels, loadAsSRGB, bindFlags, callback, priority);
 #else
             // Load texture from main thread.
             Texture::SharedPtr pTexture = Texture::createFromFile(fullPath, generateMipLevels, loadAsSRGB, bindFlags);
@@ -111,9 +111,10 @@ namespace Falcor
             \param[in] loadAsSRGB Load the texture as sRGB format if supported, otherwise linear color.
             \param[in] bindFlags The bind flags for the texture resource.
             \param[in] async Load asynchronously, otherwise the function blocks until the texture data is loaded.
+            \param[in] priority Load priority for asynchronous loading. Textures with higher priority are loaded first.
             \return Unique handle to the texture, or an invalid handle if the texture can't be found.
         */
-        TextureHandle loadTexture(const std::filesystem::path& path, bool generateMipLevels, bool loadAsSRGB, Resource::BindFlags bindFlags = Resource::BindFlags::ShaderResource, bool async = true);
+        TextureHandle loadTexture(const std::filesystem::path& path, bool generateMipLevels, bool loadAsSRGB, Resource::BindFlags bindFlags = Resource::BindFlags::ShaderResource, bool async = true, uint32_t priority = AsyncTextureLoader::kDefaultPriority);
 
         /** Wait for a requested texture to load.
             If the handle is valid, the call blocks until the texture is loaded (or failed to load).
@@ -29,6 +29,7 @@
 #include "Core/Assert.h"
 #include "Core/Platform/OS.h"
 #include <iostream>
+#include <mutex>
 
 namespace Falcor
 {
@@ -39,6 +40,7 @@ namespace Falcor
         std::filesystem::path sLogFilePath;
 
 #if FALCOR_ENABLE_LOGGER
+        std::mutex sMutex;      ///< Serializes output of messages logged from multiple threads.
         bool sInitialized = false;
         FILE* sLogFile = nullptr;
 
@@ -90,6 +92,7 @@ namespace Falcor
     void Logger::shutdown()
     {
 #if FALCOR_ENABLE_LOGGER
+        std::lock_guard<std::mutex> lock(sMutex);
         if(sLogFile)
         {
             fclose(sLogFile);
@@ -125,6 +128,7 @@ namespace Falcor
         if (level <= sVerbosity)
         {
             std::string s = fmt::format("{} {}\n", getLogLevelString(level), msg);
+            std::lock_guard<std::mutex> lock(sMutex);
 
             // Write to console.
             if (is_set(sOutputs, OutputFlags::Console))
@@ -151,6 +155,7 @@ namespace Falcor
     bool Logger::setLogFilePath(const std::filesystem::path& path)
     {
 #if FALCOR_ENABLE_LOGGER
+        std::lock_guard<std::mutex> lock(sMutex);
         if (sLogFile)
         {
             return false;
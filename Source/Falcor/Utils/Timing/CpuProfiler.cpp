@@ -0,0 +1,333 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "CpuProfiler.h"
+#include "Core/Assert.h"
+#include "Core/Errors.h"
+#include "Utils/StringFormatters.h"
+#include <fmt/format.h>
+#include <algorithm>
+#include <fstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Interval at which the collector drains the per-thread buffers during a capture.
+        const std::chrono::milliseconds kCollectInterval(10);
+
+        size_t roundUpToPowerOfTwo(size_t value)
+        {
+            size_t result = 1;
+            while (result < value) result <<= 1;
+            return result;
+        }
+
+        void appendJsonString(fmt::memory_buffer& buffer, std::string_view str)
+        {
+            buffer.push_back('"');
+            for (char c : str)
+            {
+                switch (c)
+                {
+                case '"': fmt::format_to(std::back_inserter(buffer), "\\\""); break;
+                case '\\': fmt::format_to(std::back_inserter(buffer), "\\\\"); break;
+                case '\n': fmt::format_to(std::back_inserter(buffer), "\\n"); break;
+                case '\t': fmt::format_to(std::back_inserter(buffer), "\\t"); break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) fmt::format_to(std::back_inserter(buffer), "\\u{:04x}", int(c));
+                    else buffer.push_back(c);
+                }
+            }
+            buffer.push_back('"');
+        }
+    }
+
+    /** Single-producer/single-consumer ring buffer of completed events.
+        The owning thread is the only producer. The collector drains the buffer while holding the profiler mutex.
+    */
+    struct CpuProfiler::ThreadBuffer
+    {
+        ThreadBuffer(uint32_t threadID) : threadID(threadID) {}
+
+        /** Allocate the event storage. Called by the owning thread before its first event is published.
+        */
+        void allocate(size_t capacity)
+        {
+            FALCOR_ASSERT((capacity & (capacity - 1)) == 0);
+            events.resize(capacity);
+            mask = capacity - 1;
+        }
+
+        const uint32_t threadID;
+        std::vector<Event> events;
+        size_t mask = 0;
+
+        alignas(64) std::atomic<uint64_t> writeIndex = 0;   ///< Written by the owning thread only.
+        alignas(64) std::atomic<uint64_t> readIndex = 0;    ///< Written by the collector only.
+        std::atomic<uint64_t> droppedCount = 0;
+        std::atomic<bool> retired = false;                  ///< Set when the owning thread exits.
+    };
+
+    // CpuProfiler::Capture
+
+    std::string CpuProfiler::Capture::getThreadName(uint32_t threadID) const
+    {
+        auto it = mThreadNames.find(threadID);
+        return it != mThreadNames.end() ? it->second : std::string();
+    }
+
+    std::string CpuProfiler::Capture::toChromeTrace() const
+    {
+        fmt::memory_buffer buffer;
+        auto out = std::back_inserter(buffer);
+
+        fmt::format_to(out, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        bool first = true;
+        auto separator = [&]()
+        {
+            if (!first) fmt::format_to(out, ",\n");
+            first = false;
+        };
+
+        for (const auto& [threadID, name] : mThreadNames)
+        {
+            separator();
+            fmt::format_to(out, "{{\"ph\":\"M\",\"pid\":0,\"tid\":{},\"name\":\"thread_name\",\"args\":{{\"name\":", threadID);
+            appendJsonString(buffer, name);
+            fmt::format_to(out, "}}}}");
+        }
+
+        // Complete events ("X") with timestamps and durations in microseconds.
+        for (const auto& event : mEvents)
+        {
+            separator();
+            fmt::format_to(out, "{{\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f},\"name\":", event.threadID, event.startTime * 1e-3, event.duration * 1e-3);
+            appendJsonString(buffer, mNames[event.name]);
+            fmt::format_to(out, "}}");
+        }
+
+        fmt::format_to(out, "\n]}}\n");
+        return fmt::to_string(buffer);
+    }
+
+    void CpuProfiler::Capture::writeChromeTrace(const std::filesystem::path& path) const
+    {
+        auto json = toChromeTrace();
+        std::ofstream ofs(path, std::ios::binary);
+        if (!ofs) throw RuntimeError("Failed to open '{}' for writing.", path);
+        ofs.write(json.data(), json.size());
+    }
+
+    // CpuProfiler
+
+    CpuProfiler& CpuProfiler::instance()
+    {
+        static CpuProfiler sInstance;
+        return sInstance;
+    }
+
+    CpuProfiler::CpuProfiler()
+        : mEpoch(CpuTimer::getCurrentTimePoint())
+    {}
+
+    CpuProfiler::~CpuProfiler()
+    {
+        endCapture();
+    }
+
+    CpuProfiler::NameID CpuProfiler::internName(std::string_view name)
+    {
+        std::lock_guard<std::mutex> lock(mNameMutex);
+        auto it = mNameIDs.find(std::string(name));
+        if (it != mNameIDs.end()) return it->second;
+
+        NameID id = (NameID)mNames.size();
+        mNames.emplace_back(name);
+        mNameIDs.emplace(mNames.back(), id);
+        return id;
+    }
+
+    void CpuProfiler::setThreadName(const std::string& name)
+    {
+        ThreadBuffer* pBuffer = getThreadBuffer();
+        std::lock_guard<std::mutex> lock(mMutex);
+        mThreadNames[pBuffer->threadID] = name;
+    }
+
+    uint32_t& CpuProfiler::getThreadDepth()
+    {
+        thread_local uint32_t depth = 0;
+        return depth;
+    }
+
+    void CpuProfiler::recordEvent(NameID name, CpuTimer::TimePoint startTime, CpuTimer::TimePoint endTime, uint32_t depth)
+    {
+        if (!isEnabled()) return;
+
+        ThreadBuffer* pBuffer = getThreadBuffer();
+        if (pBuffer->events.empty())
+        {
+            size_t capacity;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                capacity = mBufferCapacity;
+            }
+            pBuffer->allocate(capacity);
+        }
+
+        uint64_t writeIndex = pBuffer->writeIndex.load(std::memory_order_relaxed);
+        uint64_t readIndex = pBuffer->readIndex.load(std::memory_order_acquire);
+        if (writeIndex - readIndex > pBuffer->mask)
+        {
+            pBuffer->droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto toNanoseconds = [this](CpuTimer::TimePoint t) { return (uint64_t)std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(t - mEpoch).count()); };
+        uint64_t start = toNanoseconds(startTime);
+        uint64_t end = toNanoseconds(endTime);
+
+        pBuffer->events[writeIndex & pBuffer->mask] = { name, pBuffer->threadID, depth, start, end - start };
+        pBuffer->writeIndex.store(writeIndex + 1, std::memory_order_release);
+    }
+
+    CpuProfiler::ThreadBuffer* CpuProfiler::getThreadBuffer()
+    {
+        // The profiler keeps a reference to the buffer so that events recorded by a thread survive its exit.
+        // Event storage is allocated on the first recorded event, so naming a thread is cheap.
+        struct ThreadBufferHolder
+        {
+            std::shared_ptr<ThreadBuffer> pBuffer;
+            ~ThreadBufferHolder() { if (pBuffer) pBuffer->retired.store(true, std::memory_order_release); }
+        };
+        thread_local ThreadBufferHolder holder;
+
+        if (!holder.pBuffer)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            holder.pBuffer = std::make_shared<ThreadBuffer>(mNextThreadID++);
+            mThreadBuffers.push_back(holder.pBuffer);
+        }
+        return holder.pBuffer.get();
+    }
+
+    void CpuProfiler::collect()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (const auto& pBuffer : mThreadBuffers)
+        {
+            uint64_t readIndex = pBuffer->readIndex.load(std::memory_order_relaxed);
+            uint64_t writeIndex = pBuffer->writeIndex.load(std::memory_order_acquire);
+            if (mpCapture)
+            {
+                for (uint64_t i = readIndex; i < writeIndex; ++i) mpCapture->mEvents.push_back(pBuffer->events[i & pBuffer->mask]);
+                mpCapture->mDroppedEventCount += pBuffer->droppedCount.exchange(0, std::memory_order_relaxed);
+            }
+            pBuffer->readIndex.store(writeIndex, std::memory_order_release);
+        }
+
+        // Release buffers of exited threads once they are drained.
+        mThreadBuffers.erase(std::remove_if(mThreadBuffers.begin(), mThreadBuffers.end(), [](const auto& pBuffer)
+        {
+            return pBuffer->retired.load(std::memory_order_acquire) && pBuffer->readIndex.load(std::memory_order_relaxed) == pBuffer->writeIndex.load(std::memory_order_acquire);
+        }), mThreadBuffers.end());
+    }
+
+    void CpuProfiler::runCollector()
+    {
+        std::unique_lock<std::mutex> lock(mCollectorMutex);
+        while (!mStopCollector)
+        {
+            mCollectorCondition.wait_for(lock, kCollectInterval, [this]() { return mStopCollector; });
+            collect();
+        }
+    }
+
+    void CpuProfiler::startCapture(size_t bufferCapacity)
+    {
+        if (isCapturing()) endCapture();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mBufferCapacity = roundUpToPowerOfTwo(std::max<size_t>(bufferCapacity, 2));
+            mpCapture = Capture::SharedPtr(new Capture());
+        }
+
+        // Discard events left over from a previous capture.
+        collect();
+
+        mStopCollector = false;
+        mCollectorThread = std::thread(&CpuProfiler::runCollector, this);
+        mEnabled.store(true, std::memory_order_relaxed);
+    }
+
+    CpuProfiler::Capture::SharedPtr CpuProfiler::endCapture()
+    {
+        if (!isCapturing()) return nullptr;
+
+        mEnabled.store(false, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock(mCollectorMutex);
+            mStopCollector = true;
+        }
+        mCollectorCondition.notify_all();
+        if (mCollectorThread.joinable()) mCollectorThread.join();
+
+        // Drain events recorded before recording was disabled.
+        // Scopes that are still open on other threads when the capture ends are not included.
+        collect();
+
+        Capture::SharedPtr pCapture;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            std::swap(pCapture, mpCapture);
+            pCapture->mThreadNames = mThreadNames;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mNameMutex);
+            pCapture->mNames.assign(mNames.begin(), mNames.end());
+        }
+
+        std::stable_sort(pCapture->mEvents.begin(), pCapture->mEvents.end(), [](const Event& a, const Event& b)
+        {
+            if (a.threadID != b.threadID) return a.threadID < b.threadID;
+            if (a.startTime != b.startTime) return a.startTime < b.startTime;
+            return a.depth < b.depth;
+        });
+
+        return pCapture;
+    }
+
+    bool CpuProfiler::isCapturing() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mpCapture != nullptr;
+    }
+}
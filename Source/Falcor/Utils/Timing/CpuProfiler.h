@@ -0,0 +1,247 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+#include "CpuTimer.h"
+#include "Core/Macros.h"
+#include "Core/FalcorConfig.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Falcor
+{
+    /** Low-overhead hierarchical CPU profiler.
+
+        Unlike Profiler, which is tied to the render thread and aggregates GPU/CPU times per frame,
+        this class records individual timed scopes on any thread. Each thread writes completed scopes
+        into its own lock-free ring buffer. Event names are interned once and referred to by ID.
+        Buffers are drained by a background thread while a capture is active, and the captured
+        events can be exported in Chrome trace format (chrome://tracing, ui.perfetto.dev).
+
+        Recording is disabled by default and costs a single relaxed atomic load per scope when disabled.
+        Use the FALCOR_PROFILE_CPU macro to instrument code.
+    */
+    class FALCOR_API CpuProfiler
+    {
+    public:
+        using NameID = uint32_t;
+
+        static constexpr size_t kDefaultBufferCapacity = 1 << 16; ///< Default per-thread ring buffer capacity in events.
+
+        /** A completed scope.
+        */
+        struct Event
+        {
+            NameID name;            ///< Interned event name.
+            uint32_t threadID;      ///< Profiler thread ID (not the OS thread ID).
+            uint32_t depth;         ///< Nesting depth on the recording thread.
+            uint64_t startTime;     ///< Start time in nanoseconds relative to the profiler epoch.
+            uint64_t duration;      ///< Duration in nanoseconds.
+        };
+
+        /** Events recorded between startCapture() and endCapture().
+        */
+        class FALCOR_API Capture
+        {
+        public:
+            using SharedPtr = std::shared_ptr<Capture>;
+
+            /** Get the captured events, ordered by thread ID and start time.
+            */
+            const std::vector<Event>& getEvents() const { return mEvents; }
+
+            /** Get the name of an interned event.
+            */
+            const std::string& getName(NameID name) const { return mNames[name]; }
+
+            /** Get the name of a thread, or an empty string if the thread is unnamed.
+            */
+            std::string getThreadName(uint32_t threadID) const;
+
+            /** Get the number of events that were dropped because a ring buffer was full.
+            */
+            uint64_t getDroppedEventCount() const { return mDroppedEventCount; }
+
+            /** Convert the capture to a JSON string in Chrome trace event format.
+            */
+            std::string toChromeTrace() const;
+
+            /** Write the capture to a file in Chrome trace event format.
+                \param[in] path File path.
+            */
+            void writeChromeTrace(const std::filesystem::path& path) const;
+
+        private:
+            std::vector<Event> mEvents;
+            std::vector<std::string> mNames;
+            std::unordered_map<uint32_t, std::string> mThreadNames;
+            uint64_t mDroppedEventCount = 0;
+
+            friend class CpuProfiler;
+        };
+
+        /** Global profiler instance.
+        */
+        static CpuProfiler& instance();
+
+        /** Check if recording is enabled. Recording is enabled while a capture is active.
+        */
+        bool isEnabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+        /** Intern an event name.
+            Interning takes a lock and should be done once per call site, see FALCOR_PROFILE_CPU.
+            \param[in] name Event name.
+            \return Name ID, stable for the lifetime of the process.
+        */
+        NameID internName(std::string_view name);
+
+        /** Set the name of the calling thread, which is shown in trace exports.
+            \param[in] name Thread name.
+        */
+        void setThreadName(const std::string& name);
+
+        /** Record a completed scope on the calling thread.
+            Does nothing if recording is disabled.
+            \param[in] name Interned event name.
+            \param[in] startTime Scope start time.
+            \param[in] endTime Scope end time.
+            \param[in] depth Nesting depth.
+        */
+        void recordEvent(NameID name, CpuTimer::TimePoint startTime, CpuTimer::TimePoint endTime, uint32_t depth);
+
+        /** Start capturing events. Enables recording and starts the background collector.
+            \param[in] bufferCapacity Per-thread ring buffer capacity in events, used for threads that have not recorded events yet. Rounded up to a power of two.
+        */
+        void startCapture(size_t bufferCapacity = kDefaultBufferCapacity);
+
+        /** End capture. Disables recording and returns the events recorded since startCapture().
+            \return Captured events, or nullptr if no capture was active.
+        */
+        Capture::SharedPtr endCapture();
+
+        /** Check if a capture is active.
+        */
+        bool isCapturing() const;
+
+        /** Get the nesting depth counter of the calling thread. Used by CpuProfilerScope.
+        */
+        static uint32_t& getThreadDepth();
+
+    private:
+        CpuProfiler();
+        ~CpuProfiler();
+
+        struct ThreadBuffer;
+        ThreadBuffer* getThreadBuffer();
+        void collect();
+        void runCollector();
+
+        const CpuTimer::TimePoint mEpoch;
+        std::atomic<bool> mEnabled = false;
+
+        std::mutex mNameMutex;                                  ///< Protects the name table.
+        std::unordered_map<std::string, NameID> mNameIDs;
+        std::deque<std::string> mNames;
+
+        mutable std::mutex mMutex;                              ///< Protects the thread buffer list and capture state.
+        std::vector<std::shared_ptr<ThreadBuffer>> mThreadBuffers;
+        std::unordered_map<uint32_t, std::string> mThreadNames;
+        uint32_t mNextThreadID = 0;
+        size_t mBufferCapacity = kDefaultBufferCapacity;
+        Capture::SharedPtr mpCapture;                           ///< Currently active capture.
+
+        std::mutex mCollectorMutex;
+        std::condition_variable mCollectorCondition;
+        std::thread mCollectorThread;
+        bool mStopCollector = false;
+    };
+
+    /** Helper class for recording a CPU profiler scope using RAII.
+        The FALCOR_PROFILE_CPU macro wraps creation of local CpuProfilerScope objects and interns the name once per call site.
+    */
+    class CpuProfilerScope
+    {
+    public:
+        CpuProfilerScope(CpuProfiler::NameID name)
+        {
+            if (CpuProfiler::instance().isEnabled()) begin(name);
+        }
+
+        CpuProfilerScope(std::string_view name)
+        {
+            auto& profiler = CpuProfiler::instance();
+            if (profiler.isEnabled()) begin(profiler.internName(name));
+        }
+
+        ~CpuProfilerScope()
+        {
+            if (!mActive) return;
+            auto endTime = CpuTimer::getCurrentTimePoint();
+            uint32_t depth = --CpuProfiler::getThreadDepth();
+            CpuProfiler::instance().recordEvent(mName, mStartTime, endTime, depth);
+        }
+
+        CpuProfilerScope(const CpuProfilerScope&) = delete;
+        CpuProfilerScope& operator=(const CpuProfilerScope&) = delete;
+
+    private:
+        void begin(CpuProfiler::NameID name)
+        {
+            mName = name;
+            mActive = true;
+            ++CpuProfiler::getThreadDepth();
+            mStartTime = CpuTimer::getCurrentTimePoint();
+        }
+
+        CpuProfiler::NameID mName = 0;
+        bool mActive = false;
+        CpuTimer::TimePoint mStartTime;
+    };
+}
+
+#define FALCOR_PROFILE_CPU_CONCAT_(a, b) a##b
+#define FALCOR_PROFILE_CPU_CONCAT(a, b) FALCOR_PROFILE_CPU_CONCAT_(a, b)
+
+#if FALCOR_ENABLE_PROFILER
+/** Record a CPU profiler scope until the end of the enclosing block. The name must be constant for the call site.
+*/
+#define FALCOR_PROFILE_CPU(_name) \
+    static const Falcor::CpuProfiler::NameID FALCOR_PROFILE_CPU_CONCAT(_cpuProfileName, __LINE__) = Falcor::CpuProfiler::instance().internName(_name); \
+    Falcor::CpuProfilerScope FALCOR_PROFILE_CPU_CONCAT(_cpuProfileScope, __LINE__)(FALCOR_PROFILE_CPU_CONCAT(_cpuProfileName, __LINE__))
+#else
+#define FALCOR_PROFILE_CPU(_name)
+#endif
@@ -375,13 +375,25 @@ namespace Falcor
     {
         setEnabled(true);
         mpCapture = Capture::create(mLastFrameEvents.size(), reservedFrames);
+
+        // Record CPU scopes on all threads for the duration of the capture.
+        // An already running CPU capture (e.g. started by TimingCapture) is left untouched.
+        auto& cpuProfiler = CpuProfiler::instance();
+        if (!mOwnsCpuCapture && cpuProfiler.isCapturing()) return;
+        cpuProfiler.startCapture();
+        mOwnsCpuCapture = true;
     }
 
     Profiler::Capture::SharedPtr Profiler::endCapture()
     {
         Capture::SharedPtr pCapture;
         std::swap(pCapture, mpCapture);
-        if (pCapture) pCapture->finalize();
+        if (pCapture)
+        {
+            if (mOwnsCpuCapture) pCapture->mpCpuCapture = CpuProfiler::instance().endCapture();
+            pCapture->finalize();
+        }
+        mOwnsCpuCapture = false;
         return pCapture;
     }
 
@@ -442,10 +454,14 @@ namespace Falcor
     {
         using namespace pybind11::literals;
 
-        auto endCapture = [] (Profiler* pProfiler) {
+        auto endCapture = [] (Profiler* pProfiler, const std::filesystem::path& tracePath) {
             std::optional<pybind11::dict> result;
             auto pCapture = pProfiler->endCapture();
-            if (pCapture) result = pCapture->toPython();
+            if (pCapture)
+            {
+                result = pCapture->toPython();
+                if (!tracePath.empty() && pCapture->getCpuCapture()) pCapture->getCpuCapture()->writeChromeTrace(tracePath);
+            }
             return result;
         };
 
@@ -455,6 +471,6 @@ namespace Falcor
         profiler.def_property_readonly("isCapturing", &Profiler::isCapturing);
         profiler.def_property_readonly("events", &Profiler::getPythonEvents);
         profiler.def("startCapture", &Profiler::startCapture, "reservedFrames"_a = 1000);
-        profiler.def("endCapture", endCapture);
+        profiler.def("endCapture", endCapture, "tracePath"_a = std::filesystem::path());
     }
 }
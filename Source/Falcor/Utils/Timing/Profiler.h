@@ -27,6 +27,7 @@
  **************************************************************************/
 #pragma once
 #include "CpuTimer.h"
+#include "CpuProfiler.h"
 #include "Core/Macros.h"
 #include "Core/API/GpuTimer.h"
 #include <pybind11/pytypes.h>
@@ -142,6 +143,11 @@ namespace Falcor
             std::string toJsonString() const;
             void writeToFile(const std::filesystem::path& path) const;
 
+            /** Get the CPU profiler events recorded during the capture.
+                \return Returns the CPU capture, or nullptr if the CPU profiler was already capturing when the capture was started.
+            */
+            const CpuProfiler::Capture::SharedPtr& getCpuCapture() const { return mpCpuCapture; }
+
         private:
             Capture(size_t reservedEvents, size_t reservedFrames);
 
@@ -153,6 +159,7 @@ namespace Falcor
             size_t mFrameCount = 0;
             std::vector<Event*> mEvents;
             std::vector<Lane> mLanes;
+            CpuProfiler::Capture::SharedPtr mpCpuCapture;
             bool mFinalized = false;
 
             friend class Profiler;
@@ -179,6 +186,7 @@ namespace Falcor
         void setPaused(bool paused) { mPaused = paused; }
 
         /** Start profile capture.
+            This also starts a CPU profiler capture unless one is already active, see CpuProfiler.
             \param[in] reservedFrames Number of frames to reserve memory for.
         */
         void startCapture(size_t reservedFrames = 1024);
@@ -259,6 +267,7 @@ namespace Falcor
         uint32_t mFrameIndex = 0;                           ///< Current frame index.
 
         Capture::SharedPtr mpCapture;                       ///< Currently active capture.
+        bool mOwnsCpuCapture = false;                       ///< True if the active capture started the CPU profiler capture.
 
         GpuFence::SharedPtr mpFence;
         uint64_t mFenceValue = uint64_t(-1);
@@ -268,6 +277,7 @@ namespace Falcor
 
     /** Helper class for starting and ending profiling events using RAII.
         The constructor and destructor call Profiler::StartEvent() and Profiler::EndEvent().
+        The event is also recorded as a CpuProfiler scope while the CPU profiler is enabled.
         The FALCOR_PROFILE macro wraps creation of local ProfilerEvent objects when profiling is enabled,
         and does nothing when profiling is disabled, so should be used instead of directly creating ProfilerEvent objects.
     */
@@ -277,6 +287,7 @@ namespace Falcor
         ProfilerEvent(const std::string& name, Profiler::Flags flags = Profiler::Flags::Default)
             : mName(name)
             , mFlags(flags)
+            , mCpuScope(mName)
         {
             Profiler::instance().startEvent(mName, mFlags);
         }
@@ -289,6 +300,7 @@ namespace Falcor
     private:
         const std::string mName;
         Profiler::Flags mFlags;
+        CpuProfilerScope mCpuScope;
     };
 }
 
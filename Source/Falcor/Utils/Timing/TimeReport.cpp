@@ -26,6 +26,7 @@
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
 #include "TimeReport.h"
+#include "CpuProfiler.h"
 #include "Utils/Logger.h"
 #include "Utils/StringUtils.h"
 #include <numeric>
@@ -62,8 +63,12 @@ namespace Falcor
     {
         auto currentTime = CpuTimer::getCurrentTimePoint();
         std::chrono::duration<double> duration = currentTime - mLastMeasureTime;
-        mLastMeasureTime = currentTime;
         mMeasurements.push_back({name, duration.count()});
+
+        // Forward the measurement to the CPU profiler so that it shows up in traces.
+        auto& cpuProfiler = CpuProfiler::instance();
+        if (cpuProfiler.isEnabled()) cpuProfiler.recordEvent(cpuProfiler.internName(name), mLastMeasureTime, currentTime, CpuProfiler::getThreadDepth());
+        mLastMeasureTime = currentTime;
     }
 
     void TimeReport::addTotal(const std::string name)
@@ -63,6 +63,7 @@ namespace Mogwai
         : CaptureTrigger(pRenderer, "Frame Capture")
     {
         mpImageProcessing = ImageProcessing::create();
+        mpImageWriter = std::make_unique<AsyncImageWriter>();
     }
 
     void FrameCapture::renderUI(Gui* pGui)
@@ -248,7 +249,7 @@ namespace Mogwai
             Bitmap::ExportFlags flags = Bitmap::ExportFlags::None;
             if (mask == TextureChannelFlags::RGBA) flags |= Bitmap::ExportFlags::ExportAlpha;
 
-            pTex->captureToFile(0, 0, filename, fileformat, flags);
+            pTex->captureToFile(0, 0, filename, fileformat, flags, mpImageWriter.get());
         }
     }
 
@@ -29,6 +29,7 @@
 #include "../../Mogwai.h"
 #include "CaptureTrigger.h"
 #include "Utils/Image/ImageProcessing.h"
+#include "Utils/Image/AsyncImageWriter.h"
 
 namespace Mogwai
 {
@@ -54,5 +55,6 @@ namespace Mogwai
 
         bool mCaptureAllOutputs = false;
         ImageProcessing::SharedPtr mpImageProcessing;
+        std::unique_ptr<AsyncImageWriter> mpImageWriter;    ///< Writes captured images in the background. Blocks capture when too much data is queued.
     };
 }
@@ -27,6 +27,7 @@
  **************************************************************************/
 #include "Falcor.h"
 #include "TimingCapture.h"
+#include "Utils/Timing/CpuProfiler.h"
 
 namespace Mogwai
 {
@@ -34,6 +35,7 @@ namespace Mogwai
     {
         const std::string kScriptVar = "timingCapture";
         const std::string kCaptureFrameTime = "captureFrameTime";
+        const std::string kCaptureCpuTrace = "captureCpuTrace";
     }
 
     MOGWAI_EXTENSION(TimingCapture);
@@ -43,6 +45,11 @@ namespace Mogwai
         return UniquePtr(new TimingCapture(pRenderer));
     }
 
+    TimingCapture::~TimingCapture()
+    {
+        writeCpuTrace();
+    }
+
     void TimingCapture::registerScriptBindings(pybind11::module& m)
     {
         using namespace pybind11::literals;
@@ -51,6 +58,7 @@ namespace Mogwai
 
         // Members
         timingCapture.def(kCaptureFrameTime.c_str(), &TimingCapture::captureFrameTime, "path"_a);
+        timingCapture.def(kCaptureCpuTrace.c_str(), &TimingCapture::captureCpuTrace, "path"_a);
     }
 
     std::string TimingCapture::getScriptVar() const
@@ -92,4 +100,48 @@ namespace Mogwai
         if (frameRate.getFrameCount() > 1)
             mFrameTimeFile << frameRate.getLastFrameTime() << std::endl;
     }
+
+    void TimingCapture::captureCpuTrace(std::filesystem::path path)
+    {
+        writeCpuTrace();
+
+        if (!path.empty())
+        {
+            auto& cpuProfiler = CpuProfiler::instance();
+            if (cpuProfiler.isCapturing())
+            {
+                logError("CPU profiler is already capturing. Ignoring call.");
+                return;
+            }
+
+            if (std::filesystem::exists(path))
+            {
+                logWarning("CPU trace in file '{}' will be overwritten.", path);
+            }
+
+            cpuProfiler.startCapture();
+            mCpuTracePath = path;
+        }
+    }
+
+    void TimingCapture::writeCpuTrace()
+    {
+        if (mCpuTracePath.empty()) return;
+
+        auto pCapture = CpuProfiler::instance().endCapture();
+        if (pCapture)
+        {
+            try
+            {
+                pCapture->writeChromeTrace(mCpuTracePath);
+                logInfo("Wrote CPU trace with {} events to '{}'.", pCapture->getEvents().size(), mCpuTracePath);
+                if (pCapture->getDroppedEventCount() > 0) logWarning("CPU trace dropped {} events due to full buffers.", pCapture->getDroppedEventCount());
+            }
+            catch (const std::exception& e)
+            {
+                logError("Failed to write CPU trace: {}", e.what());
+            }
+        }
+        mCpuTracePath.clear();
+    }
 }
@@ -34,7 +34,7 @@ namespace Mogwai
     class TimingCapture : public Extension
     {
     public:
-        virtual ~TimingCapture() = default;
+        virtual ~TimingCapture();
         static UniquePtr create(Renderer* pRenderer);
 
         virtual void beginFrame(RenderContext* pRenderContext, const Fbo::SharedPtr& pTargetFbo) override;
@@ -49,6 +49,13 @@ namespace Mogwai
         void captureFrameTime(std::filesystem::path path);
         void recordPreviousFrameTime();
 
+        /** Start capturing a CPU trace of all threads, or end capture and write the trace if path is empty.
+            The trace is written in Chrome trace format to the path given when the capture was started.
+        */
+        void captureCpuTrace(std::filesystem::path path);
+        void writeCpuTrace();
+
         std::ofstream   mFrameTimeFile;     ///< Frame times are appended to this file when it's open.
+        std::filesystem::path mCpuTracePath; ///< CPU trace is written to this file when the capture ends. Empty if not capturing.
     };
 }
@@ -61,6 +61,7 @@ namespace
 
     const char kInputChannel[] = "input";
     const char kOutputChannel[] = "output";
+    const char kVarianceChannel[] = "variance";
 
     // Serialized parameters
     const char kEnabled[] = "enabled";
@@ -71,6 +72,7 @@ namespace
     const char kPrecisionMode[] = "precisionMode";
     const char kSubFrameCount[] = "subFrameCount";
     const char kMaxAccumulatedFrames[] = "maxAccumulatedFrames";
+    const char kBatchSize[] = "batchSize";
 
     const Gui::DropdownList kModeSelectorList =
     {
@@ -99,6 +101,7 @@ AccumulatePass::AccumulatePass(const Dictionary& dict)
         else if (key == kPrecisionMode) mPrecisionMode = value;
         else if (key == kSubFrameCount) mSubFrameCount = value;
         else if (key == kMaxAccumulatedFrames) mMaxAccumulatedFrames = value;
+        else if (key == kBatchSize) mBatchSize = std::max(1u, (uint32_t)value);
         else logWarning("Unknown field '{}' in AccumulatePass dictionary.", key);
     }
 
@@ -122,6 +125,7 @@ Dictionary AccumulatePass::getScriptingDictionary()
     dict[kPrecisionMode] = mPrecisionMode;
     dict[kSubFrameCount] = mSubFrameCount;
     dict[kMaxAccumulatedFrames] = mMaxAccumulatedFrames;
+    dict[kBatchSize] = mBatchSize;
     return dict;
 }
 
@@ -133,6 +137,7 @@ RenderPassReflection AccumulatePass::reflect(const CompileData& compileData)
 
     reflector.addInput(kInputChannel, "Input data to be temporally accumulated").bindFlags(ResourceBindFlags::ShaderResource);
     reflector.addOutput(kOutputChannel, "Output data that is temporally accumulated").bindFlags(ResourceBindFlags::RenderTarget | ResourceBindFlags::UnorderedAccess | ResourceBindFlags::ShaderResource).format(fmt).texture2D(sz.x, sz.y);
+    reflector.addOutput(kVarianceChannel, "Estimated variance of the accumulated output").bindFlags(ResourceBindFlags::UnorderedAccess | ResourceBindFlags::ShaderResource).format(ResourceFormat::RGBA32Float).texture2D(sz.x, sz.y).flags(RenderPassReflection::Field::Flags::Optional);
     return reflector;
 }
 
@@ -179,6 +184,7 @@ void AccumulatePass::execute(RenderContext* pRenderContext, const RenderData& re
     // Grab our input/output buffers.
     Texture::SharedPtr pSrc = renderData.getTexture(kInputChannel);
     Texture::SharedPtr pDst = renderData.getTexture(kOutputChannel);
+    Texture::SharedPtr pVariance = renderData.getTexture(kVarianceChannel);
     FALCOR_ASSERT(pSrc && pDst);
 
     const uint2 resolution = uint2(pSrc->getWidth(), pSrc->getHeight());
@@ -201,6 +207,9 @@ void AccumulatePass::execute(RenderContext* pRenderContext, const RenderData& re
         mEnabled = false;
     }
 
+    // The variance is only estimated while accumulating.
+    if (pVariance && !(mEnabled && resolutionMatch)) pRenderContext->clearUAV(pVariance->getUAV().get(), float4(0.f));
+
     // Decide action based on current configuration:
     // - The accumulation pass supports integer input but requires matching I/O size.
     // - Blit supports mismatching size but requires non-integer format.
@@ -213,7 +222,7 @@ void AccumulatePass::execute(RenderContext* pRenderContext, const RenderData& re
     }
     else if (resolutionMatch)
     {
-        accumulate(pRenderContext, pSrc, pDst);
+        accumulate(pRenderContext, pSrc, pDst, pVariance);
     }
     else
     {
@@ -222,55 +231,106 @@ void AccumulatePass::execute(RenderContext* pRenderContext, const RenderData& re
     }
 }
 
-void AccumulatePass::accumulate(RenderContext* pRenderContext, const Texture::SharedPtr& pSrc, const Texture::SharedPtr& pDst)
+void AccumulatePass::accumulate(RenderContext* pRenderContext, const Texture::SharedPtr& pSrc, const Texture::SharedPtr& pDst, const Texture::SharedPtr& pVariance)
 {
     FALCOR_ASSERT(pSrc && pDst);
     FALCOR_ASSERT(pSrc->getWidth() == mFrameDim.x && pSrc->getHeight() == mFrameDim.y);
     FALCOR_ASSERT(pDst->getWidth() == mFrameDim.x && pDst->getHeight() == mFrameDim.y);
     const FormatType srcType = getFormatType(pSrc->getFormat());
 
+    // When batching, the accumulation programs read the floating-point batch sums instead of the source.
+    const bool batching = mEnabled && mBatchSize > 1;
+    const FormatType accumType = batching ? FormatType::Float : srcType;
+
     // If for the first time, or if the input format type has changed, (re)compile the programs.
-    if (mpProgram.empty() || srcType != mSrcType)
+    if (mpProgram.empty() || srcType != mSrcType || accumType != mAccumType)
     {
-        Program::DefineList defines;
-        switch (srcType)
+        auto getDefines = [](FormatType type)
         {
-            case FormatType::Uint:
-                defines.add("_INPUT_FORMAT", "INPUT_FORMAT_UINT");
-                break;
-            case FormatType::Sint:
-                defines.add("_INPUT_FORMAT", "INPUT_FORMAT_SINT");
-                break;
-            default:
-                defines.add("_INPUT_FORMAT", "INPUT_FORMAT_FLOAT");
-                break;
-        }
+            Program::DefineList defines;
+            switch (type)
+            {
+                case FormatType::Uint:
+                    defines.add("_INPUT_FORMAT", "INPUT_FORMAT_UINT");
+                    break;
+                case FormatType::Sint:
+                    defines.add("_INPUT_FORMAT", "INPUT_FORMAT_SINT");
+                    break;
+                default:
+                    defines.add("_INPUT_FORMAT", "INPUT_FORMAT_FLOAT");
+                    break;
+            }
+            return defines;
+        };
+        const Program::DefineList defines = getDefines(accumType);
+
         // Create accumulation programs.
         // Note only compensated summation needs precise floating-point mode.
         mpProgram[Precision::Double] = ComputeProgram::createFromFile(kShaderFile, "accumulateDouble", defines, Shader::CompilerFlags::TreatWarningsAsErrors);
         mpProgram[Precision::Single] = ComputeProgram::createFromFile(kShaderFile, "accumulateSingle", defines, Shader::CompilerFlags::TreatWarningsAsErrors);
         mpProgram[Precision::SingleCompensated] = ComputeProgram::createFromFile(kShaderFile, "accumulateSingleCompensated", defines, Shader::CompilerFlags::FloatingPointModePrecise | Shader::CompilerFlags::TreatWarningsAsErrors);
+        mpVarianceProgram = ComputeProgram::createFromFile(kShaderFile, "accumulateVariance", defines, Shader::CompilerFlags::FloatingPointModePrecise | Shader::CompilerFlags::TreatWarningsAsErrors);
         mpVars = ComputeVars::create(mpProgram[mPrecisionMode]->getReflector());
 
+        // The batch summation reads the source itself.
+        mpBatchProgram = ComputeProgram::createFromFile(kShaderFile, "accumulateBatch", getDefines(srcType), Shader::CompilerFlags::TreatWarningsAsErrors);
+        mpBatchVars = ComputeVars::create(mpBatchProgram->getReflector());
+
         mSrcType = srcType;
+        mAccumType = accumType;
     }
 
     // Setup accumulation.
-    prepareAccumulation(pRenderContext, mFrameDim.x, mFrameDim.y);
+    prepareAccumulation(pRenderContext, mFrameDim.x, mFrameDim.y, pVariance != nullptr);
+
+    if (batching)
+    {
+        if (!mpLastOutput || mpLastOutput->getWidth() != mFrameDim.x || mpLastOutput->getHeight() != mFrameDim.y || mpLastOutput->getFormat() != pDst->getFormat())
+        {
+            mpLastOutput = Texture::create2D(mFrameDim.x, mFrameDim.y, pDst->getFormat(), 1, 1, nullptr, Resource::BindFlags::ShaderResource);
+        }
+
+        // Add the frame to the current batch.
+        mpBatchVars["PerFrameCB"]["gResolution"] = mFrameDim;
+        mpBatchVars["PerFrameCB"]["gAccumCount"] = mFrameCount;
+        mpBatchVars["PerFrameCB"]["gBatchIndex"] = mBatchIndex;
+        mpBatchVars["gCurFrame"] = pSrc;
+        mpBatchVars["gBatchSum"] = mpBatchSum;
+        mpBatchVars["gOutputFrame"] = pDst;
+
+        uint3 numGroups = div_round_up(uint3(mFrameDim.x, mFrameDim.y, 1u), mpBatchProgram->getReflector()->getThreadGroupSize());
+        mpState->setProgram(mpBatchProgram);
+        pRenderContext->dispatch(mpState.get(), mpBatchVars.get(), numGroups);
+
+        if (++mBatchIndex < mBatchSize)
+        {
+            // Batch is incomplete. Keep the output of the last completed batch. Before the first batch completes, the batch program outputs the partial batch mean.
+            if (mFrameCount > 0) pRenderContext->copyResource(pDst.get(), mpLastOutput.get());
+            if (pVariance && mFrameCount == 0) pRenderContext->clearUAV(pVariance->getUAV().get(), float4(0.f));
+            return;
+        }
+        mBatchIndex = 0;
+    }
 
     // Set shader parameters.
     mpVars["PerFrameCB"]["gResolution"] = mFrameDim;
     mpVars["PerFrameCB"]["gAccumCount"] = mFrameCount;
     mpVars["PerFrameCB"]["gAccumulate"] = mEnabled;
     mpVars["PerFrameCB"]["gMovingAverageMode"] = (mMaxAccumulatedFrames > 0);
-    mpVars["gCurFrame"] = pSrc;
+    mpVars["PerFrameCB"]["gInputScale"] = batching ? 1.f / mBatchSize : 1.f;
+    mpVars["gCurFrame"] = batching ? mpBatchSum : pSrc;
     mpVars["gOutputFrame"] = pDst;
+    mpVars["gVariance"] = pVariance;
 
     // Bind accumulation buffers. Some of these may be nullptr's.
     mpVars["gLastFrameSum"] = mpLastFrameSum;
     mpVars["gLastFrameCorr"] = mpLastFrameCorr;
     mpVars["gLastFrameSumLo"] = mpLastFrameSumLo;
     mpVars["gLastFrameSumHi"] = mpLastFrameSumHi;
+    mpVars["gVarianceSum"] = mpVarianceSum;
+    mpVars["gVarianceCorr"] = mpVarianceCorr;
+    mpVars["gVarianceSumSq"] = mpVarianceSumSq;
+    mpVars["gVarianceSumSqCorr"] = mpVarianceSumSqCorr;
 
     // Update the frame count.
     // The accumulation limit (mMaxAccumulatedFrames) has a special value of 0 (no limit) and is not supported in the SingleCompensated mode.
@@ -285,6 +345,16 @@ void AccumulatePass::accumulate(RenderContext* pRenderContext, const Texture::Sh
     uint3 numGroups = div_round_up(uint3(mFrameDim.x, mFrameDim.y, 1u), pProgram->getReflector()->getThreadGroupSize());
     mpState->setProgram(pProgram);
     pRenderContext->dispatch(mpState.get(), mpVars.get(), numGroups);
+
+    // Estimate the variance from the same input.
+    if (pVariance)
+    {
+        mpState->setProgram(mpVarianceProgram);
+        pRenderContext->dispatch(mpState.get(), mpVars.get(), numGroups);
+    }
+
+    // Keep the output for the frames until the next batch completes.
+    if (batching) pRenderContext->copyResource(mpLastOutput.get(), pDst.get());
 }
 
 void AccumulatePass::renderUI(Gui::Widgets& widget)
@@ -323,7 +393,14 @@ void AccumulatePass::renderUI(Gui::Widgets& widget)
             widget.tooltip("0 = no limit");
         }
 
-        const std::string text = std::string("Frames accumulated ") + std::to_string(mFrameCount);
+        if (widget.var("Batch Size", mBatchSize, 1u))
+        {
+            reset();
+        }
+        widget.tooltip("Number of frames averaged per batch. The batch means are accumulated and the output is updated once per batch.\n"
+                       "With the variance output connected, the variance is estimated from the batch means. Frame counts count batches.");
+
+        const std::string text = std::string(mBatchSize > 1 ? "Batches accumulated " : "Frames accumulated ") + std::to_string(mFrameCount);
         widget.text(text);
     }
 }
@@ -354,9 +431,10 @@ void AccumulatePass::setEnabled(bool enabled)
 void AccumulatePass::reset()
 {
     mFrameCount = 0;
+    mBatchIndex = 0;
 }
 
-void AccumulatePass::prepareAccumulation(RenderContext* pRenderContext, uint32_t width, uint32_t height)
+void AccumulatePass::prepareAccumulation(RenderContext* pRenderContext, uint32_t width, uint32_t height, bool estimateVariance)
 {
     // Allocate/resize/clear buffers for intermedate data. These are different depending on accumulation mode.
     // Buffers that are not used in the current mode are released.
@@ -386,4 +464,24 @@ void AccumulatePass::prepareAccumulation(RenderContext* pRenderContext, uint32_t
     prepareBuffer(mpLastFrameCorr, ResourceFormat::RGBA32Float, mPrecisionMode == Precision::SingleCompensated);
     prepareBuffer(mpLastFrameSumLo, ResourceFormat::RGBA32Uint, mPrecisionMode == Precision::Double);
     prepareBuffer(mpLastFrameSumHi, ResourceFormat::RGBA32Uint, mPrecisionMode == Precision::Double);
+    prepareBuffer(mpVarianceSum, ResourceFormat::RGBA32Float, estimateVariance);
+    prepareBuffer(mpVarianceCorr, ResourceFormat::RGBA32Float, estimateVariance);
+    prepareBuffer(mpVarianceSumSq, ResourceFormat::RGBA32Float, estimateVariance);
+    prepareBuffer(mpVarianceSumSqCorr, ResourceFormat::RGBA32Float, estimateVariance);
+
+    // The batch buffers are not cleared on reset. The first frame of a batch overwrites the batch sum,
+    // and the last output is only read after a batch completed.
+    if (mEnabled && mBatchSize > 1)
+    {
+        if (!mpBatchSum || mpBatchSum->getWidth() != width || mpBatchSum->getHeight() != height)
+        {
+            mpBatchSum = Texture::create2D(width, height, ResourceFormat::RGBA32Float, 1, 1, nullptr, Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess);
+            reset();
+        }
+    }
+    else
+    {
+        mpBatchSum = nullptr;
+        mpLastOutput = nullptr;
+    }
 }
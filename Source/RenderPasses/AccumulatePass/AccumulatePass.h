@@ -39,6 +39,11 @@ using namespace Falcor;
     For accumulating many samples for ground truth rendering etc., fp32 precision
     is not always sufficient. The pass supports higher precision modes using
     either error compensation (Kahan summation) or double precision math.
+
+    Frames can be accumulated in batches of N frames: the batch means are
+    accumulated, and the output is updated once per batch. If the optional
+    variance output is connected, the pass estimates the variance of the
+    accumulated average from the accumulated frames (or batch means).
 */
 class AccumulatePass : public RenderPass
 {
@@ -75,15 +80,19 @@ public:
 
 protected:
     AccumulatePass(const Dictionary& dict);
-    void prepareAccumulation(RenderContext* pRenderContext, uint32_t width, uint32_t height);
-    void accumulate(RenderContext* pRenderContext, const Texture::SharedPtr& pSrc, const Texture::SharedPtr& pDst);
+    void prepareAccumulation(RenderContext* pRenderContext, uint32_t width, uint32_t height, bool estimateVariance);
+    void accumulate(RenderContext* pRenderContext, const Texture::SharedPtr& pSrc, const Texture::SharedPtr& pDst, const Texture::SharedPtr& pVariance);
 
     // Internal state
     Scene::SharedPtr            mpScene;                        ///< The current scene (or nullptr if no scene).
     std::map<Precision, ComputeProgram::SharedPtr> mpProgram;   ///< Accumulation programs, one per mode.
+    ComputeProgram::SharedPtr   mpVarianceProgram;              ///< Variance estimation program.
     ComputeVars::SharedPtr      mpVars;                         ///< Program variables.
+    ComputeProgram::SharedPtr   mpBatchProgram;                 ///< Batch summation program.
+    ComputeVars::SharedPtr      mpBatchVars;                    ///< Batch summation program variables.
     ComputeState::SharedPtr     mpState;
     FormatType                  mSrcType;                       ///< Format type of the source that gets accumulated.
+    FormatType                  mAccumType;                     ///< Format type of the input of the accumulation programs. Float when batching.
 
     uint32_t                    mFrameCount = 0;                ///< Number of accumulated frames. This is reset upon changes.
     uint2                       mFrameDim = { 0, 0 };           ///< Current frame dimension in pixels.
@@ -91,6 +100,13 @@ protected:
     Texture::SharedPtr          mpLastFrameCorr;                ///< Last frame running compensation term. Used in SingleKahan mode.
     Texture::SharedPtr          mpLastFrameSumLo;               ///< Last frame running sum (lo bits). Used in Double mode.
     Texture::SharedPtr          mpLastFrameSumHi;               ///< Last frame running sum (hi bits). Used in Double mode.
+    Texture::SharedPtr          mpVarianceSum;                  ///< Running sum for variance estimation.
+    Texture::SharedPtr          mpVarianceCorr;                 ///< Running compensation term of mpVarianceSum.
+    Texture::SharedPtr          mpVarianceSumSq;                ///< Running sum of squares for variance estimation.
+    Texture::SharedPtr          mpVarianceSumSqCorr;            ///< Running compensation term of mpVarianceSumSq.
+    Texture::SharedPtr          mpBatchSum;                     ///< Sum of the frames of the current batch. Used when batching.
+    Texture::SharedPtr          mpLastOutput;                   ///< Output after the last completed batch. Used when batching.
+    uint32_t                    mBatchIndex = 0;                ///< Index of the current frame in its batch.
 
     // UI variables
     bool                        mEnabled = true;                ///< True if accumulation is enabled.
@@ -98,6 +114,7 @@ protected:
     Precision                   mPrecisionMode = Precision::Single;
     uint32_t                    mSubFrameCount = 0;             ///< Number of frames to accumulate before reset. Useful for generating references.
     uint32_t                    mMaxAccumulatedFrames = 0;      ///< Number of frames to accumulate before weights become constant. Useful for noise comparisons.
+    uint32_t                    mBatchSize = 1;                 ///< Number of frames per batch. Frame counts (accumulated, sub frames, max frames) count batches.
 
     ResourceFormat              mOutputFormat = ResourceFormat::Unknown;                    ///< Output format (uses default when set to ResourceFormat::Unknown).
     RenderPassHelpers::IOSize   mOutputSizeSelection = RenderPassHelpers::IOSize::Default;  ///< Selected output size.
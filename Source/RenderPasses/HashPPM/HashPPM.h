@@ -28,6 +28,12 @@
 #pragma once
 #include "Falcor.h"
 #include "Utils/Sampling/SampleGenerator.h"
+#include "Rendering/Lights/EnvMapSampler.h"
+#include "Rendering/Utils/PhotonEmission.h"
+#include "Rendering/Utils/PhotonMapInvalidation.h"
+#include "Rendering/Utils/PhotonMapperStats.h"
+#include "Rendering/Utils/PhotonRadiusEstimation.h"
+#include "Rendering/Utils/PhotonCellSort.h"
 #include <chrono>
 
 using namespace Falcor;
@@ -55,6 +61,8 @@ public:
     virtual bool onMouseEvent(const MouseEvent& mouseEvent) override { return false; }
     virtual bool onKeyEvent(const KeyboardEvent& keyEvent) override { return false; }
 
+    const PhotonMapperStats::SharedPtr& getPhotonStats() const { return mpStats; }
+
     enum class TextureFormat {
         _8Bit = 0u,
         _16Bit = 1u,
@@ -66,8 +74,13 @@ public:
         area = 1u
     };
 
+    enum CollectMode : uint32_t {
+        cube = 0u,      ///< Visit every cell of the cube around the query
+        tight = 1u      ///< Visit only the cells the query sphere overlaps
+    };
+
 private:
-    PhotonMapperHash();
+    PhotonMapperHash(const Dictionary& dict);
 
     /** Prepares Program Variables and binds the sample generator
     */
@@ -105,11 +118,28 @@ private:
     */
     void generatePhotons(RenderContext* pRenderContext, const RenderData& renderData);
 
+    /** Sorts the generated photons by cell and copies their data into contiguous buffers in that order
+    */
+    void sortPhotons(RenderContext* pRenderContext);
+
     /** Pass that collect the photons. It will shoot a infinit small ray at the current camera position and collect all photons.
     * The needed position etc. has to be provided by a gBuffer
     */
     void collectPhotons(RenderContext* pRenderContext, const RenderData& renderData);
 
+    /** Creates the compensated sums the iterations are accumulated in. Releases them if the image is not accumulated
+    */
+    void prepareAccumulation(const uint2 dim);
+
+    /** Returns the number of light groups accumulated separately. Without incremental updates all light is one group
+    */
+    uint getLightGroupCount() const;
+
+    /** Sets the start radii from the photon counts of the pilot iteration and the pixel footprint at the camera hits.
+        Restarts the iterations with the new radii.
+    */
+    void applyRadiusEstimate(RenderContext* pRenderContext, const RenderData& renderData);
+
   
     /** Prepares the buffer that holds the seeds for the SampleGenerator
     */
@@ -136,6 +166,10 @@ private:
     // Internal state
     Scene::SharedPtr            mpScene;                    ///< Current scene.
     SampleGenerator::SharedPtr  mpSampleGenerator;          ///< GPU sample generator.
+    PhotonMapperStats::SharedPtr mpStats;                   ///< Per-iteration photon counts and stage timings.
+    PhotonPixelFootprint::SharedPtr mpPixelFootprint;       ///< Pixel footprint at the camera hits for the radius estimation.
+    PhotonMapInvalidation       mInvalidation;              ///< Decides which light groups and screen regions a scene change restarts.
+    EnvMapSampler::SharedPtr    mpEnvMapSampler;            ///< Environment map sampler. Only set if the environment map lights the scene.
 
     //Constants
     const float                 kMinPhotonRadius = 0.0001f;                 ///< At radius 0.0001 Photons are still visible
@@ -153,6 +187,9 @@ private:
 
     float                       mCausticRadiusStart = 0.01f;            ///< Start value for the caustic Radius
     float                       mGlobalRadiusStart = 0.05f;             ///< Start value for the caustic Radius
+    bool                        mAutoRadius = false;                    ///< Estimate the start radii from a pilot iteration
+    float                       mPhotonsPerQuery = 32.f;                ///< Targeted number of photons per query for the radius estimation
+    bool                        mRadiusPilotPending = true;             ///< The next iteration is a pilot iteration for the radius estimation
     float                       mCausticRadius = 1.f;                 ///< Current Radius for caustic Photons
     float                       mGlobalRadius = 1.f;                  ///< Current Radius for global Photons
 
@@ -160,6 +197,7 @@ private:
 
     bool                        mResetIterations = false;               ///<Resets the iterations counter once
     bool                        mAlwaysResetIterations = false;         ///<Resets the iteration counter every frame
+    bool                        mIncrementalUpdates = true;             ///<Light and object animations restart only the changed light groups and the screen regions of moved objects instead of being ignored
 
     bool                        mNumPhotonsChanged = false;             ///<If true buffers needs to be restarted and Number of photons needs to be changed
     bool                        mFitBuffersToPhotonShot = false;        ///<Changes the buffer size to be around the number of photons shot
@@ -168,6 +206,8 @@ private:
     bool                        mAdjustShadingNormals = true;           ///<Adjusts the shading normals (Generate)
 
     uint                        mNumBucketBits = 20;                    ///< 2^NumBucketBits is the total amount of possible buckets
+    float                       mCellSizeFactor = 1.f;                  ///< Hash cell size relative to the current radius
+    bool                        mBlockedBuckets = false;                ///< Maps each 2x2x2 block of cells to consecutive buckets
     uint                        mNumPhotonsPerBucket = 12;              ///< Max Photons per hash grid.
     uint                        mQuadraticProbeIterations = 10;         ///< Number of quadartic probe iteratons per hash.
 
@@ -176,6 +216,8 @@ private:
     // Generate only
     uint                        mMaxBounces = 10;                        ///< Depth of recursion (0 = none).
     float                       mRussianRoulette = 0.3f;                ///< Probabilty that a Global photon is saved
+    bool                        mFluxRoulette = true;                   ///< Terminate and store photons by their flux relative to the average photon flux
+    float                       mPhotonFluxReference = 0.f;             ///< Average flux luminance of the emitted photons
 
     uint                        mNumPhotons = 2000000;                   ///< Number of Photons shot
     uint                        mNumPhotonsUI = mNumPhotons;            ///< For UI. It is decopled from the runtime var because changes have to be confirmed
@@ -188,6 +230,9 @@ private:
     // Collect only
     bool                        mDisableGlobalCollection = false;       ///<Disabled the collection of global photons
     bool                        mDisableCausticCollection = false;       ///<Disabled the collection of caustic photons
+    bool                        mAccumulateImage = true;                ///<Averages the iterations in the photon image. Disabled, each iteration is output for a following accumulator
+    CollectMode                 mCollectMode = CollectMode::tight;      ///<Which cells are visited for a photon query
+    bool                        mSortPhotons = false;                   ///<Sorts the photons by cell after generation so they are collected from contiguous memory
 
     bool                        mEnableStochasticCollection = true;     ///<Enables/Disables Stochasic collection
     float                       mStochasticCollectProbability = 0.33f;  ///< Probability for collection
@@ -198,6 +243,10 @@ private:
     //*******************************************************
     
     uint                        mFrameCount = 0;            ///< Frame count since last Reset
+    uint32_t                    mResetLightGroups = 0;      ///< Light groups (bits of PhotonLightGroup) whose sums restart in the next iteration
+    std::vector<AABB>           mResetBounds;               ///< World bounds of moved objects. All light groups restart in their screen region in the next iteration
+    Texture::SharedPtr          mpAccumulationSum;          ///< Compensated sums of the iterations per light group, stacked vertically. The alpha channel counts the iterations
+    Texture::SharedPtr          mpAccumulationCorr;         ///< Compensation term of the sum
     std::vector<uint>           mPhotonCount = { 0,0 };
     bool                        mOptionsChanged = false;
     bool                        mResetCS = true;
@@ -213,13 +262,16 @@ private:
     std::vector<uint> mActiveEmissiveTriangles;
     bool            mRebuildLightTex = false;
     LightTexMode mLightTexMode = LightTexMode::power;
+    uint mMinPhotonsPerLight = 256;     ///< Minimum number of photons per analytic light with power. One 16x16 block of the light sample texture
+    uint mMaxPhotonsPerLight = 0;       ///< Maximum number of photons per analytic light. Zero for no cap
     Texture::SharedPtr mLightSampleTex;
     Buffer::SharedPtr mPhotonsPerTriangle;
+    Buffer::SharedPtr mPhotonsPerAnalytic;
     const uint mMaxDispatchY = 512;
     uint mPGDispatchX = 0;
     uint mAnalyticEndIndex = 0;
     uint mNumLights = 0;
-    float mAnalyticInvPdf = 0.0f;
+    uint mNumEnvPhotons = 0;    ///< Number of photons emitted from the environment map
 
     //Clock/Timer
     bool                        mUseTimer = false;                          //<Activates the timer
@@ -282,6 +334,17 @@ private:
     PhotonBuffers mCausticBuffers;              ///< Buffers for the caustic photons
     PhotonBuffers mGlobalBuffers;               ///< Buffers for the global photons
 
+    struct SortedPhotonBuffers {
+        Buffer::SharedPtr cellStart;            ///< First sorted photon of each bucket, followed by the total number of photons
+        Buffer::SharedPtr sortedIndices;        ///< Photon indices in bucket order
+        Buffer::SharedPtr photons;              ///< Photon position, flux and direction in bucket order
+    };
+
+    PhotonCellSort::SharedPtr mpPhotonCellSort;     ///< Sorts the photon indices by bucket
+    ComputePass::SharedPtr mpCSReorder;             ///< Copies the photon data into bucket order
+    SortedPhotonBuffers mCausticSorted;         ///< Sorted caustic photons
+    SortedPhotonBuffers mGlobalSorted;          ///< Sorted global photons
+
     Texture::SharedPtr mRandNumSeedBuffer;       ///< Buffer for the random seeds
 
 };
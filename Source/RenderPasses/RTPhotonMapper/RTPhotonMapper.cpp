@@ -47,9 +47,16 @@ extern "C" FALCOR_API_EXPORT const char* getProjDir()
     return PROJECT_DIR;
 }
 
+static void regRTPhotonMapper(pybind11::module& m)
+{
+    pybind11::class_<RTPhotonMapper, RenderPass, RTPhotonMapper::SharedPtr> pass(m, "RTPhotonMapper");
+    pass.def_property_readonly("photonStats", &RTPhotonMapper::getPhotonStats);
+}
+
 extern "C" FALCOR_API_EXPORT void getPasses(Falcor::RenderPassLibrary & lib)
 {
     lib.registerPass(RTPhotonMapper::kInfo, RTPhotonMapper::create);
+    ScriptBindings::registerBinding(regRTPhotonMapper);
 }
 
 namespace
@@ -67,15 +74,36 @@ namespace
     const uint32_t kMaxAttributeSizeBytes = 8u;
     const uint32_t kMaxRecursionDepth = 2u;
 
+    // Scripting options
+    const char kAccumulateImage[] = "accumulateImage";
+    const char kMinPhotonsPerLight[] = "minPhotonsPerLight";
+    const char kMaxPhotonsPerLight[] = "maxPhotonsPerLight";
+    const char kCollectStats[] = "collectStats";
+    const char kAutoRadius[] = "autoRadius";
+    const char kFluxRoulette[] = "fluxRoulette";
+    const char kIncrementalUpdates[] = "incrementalUpdates";
+    const char kRestartThreshold[] = "restartThreshold";
+    const char kResetMargin[] = "resetMargin";
+
+    const char kInputVBuffer[] = "vbuffer";
+
     //Input/Output
     const ChannelList kInputChannels =
     {
-        {"vbuffer",             "gVBuffer",                 "V Buffer to get the intersected triangle",         false},
+        {kInputVBuffer,         "gVBuffer",                 "V Buffer to get the intersected triangle",         false},
         {"viewW",               "gViewWorld",               "World View Direction",                             false},
         {"thp",                 "gThp",                     "Throughput",                                       false},
         {"emissive",            "gEmissive",                "Emissive",                                         false},
     };
 
+    //Final gather points of VBufferPM, one array slice per gather ray. If connected, the global photons are collected there and the caustic photons at the vbuffer hit
+    const ChannelList kGatherInputChannels =
+    {
+        {"gatherVBuffer",       "gGatherVBuffer",           "Final gather points",                              true /* optional */},
+        {"gatherViewW",         "gGatherViewW",             "World View Direction at the final gather points",  true /* optional */},
+        {"gatherThp",           "gGatherThp",               "Throughput from the vbuffer hit to the final gather points", true /* optional */},
+    };
+
     const ChannelList kOutputChannels =
     {
         { "PhotonImage",          "gPhotonImage",               "An image that shows the caustics and indirect light from global photons" , false , ResourceFormat::RGBA32Float }
@@ -105,13 +133,29 @@ namespace
 
 RTPhotonMapper::SharedPtr RTPhotonMapper::create(RenderContext* pRenderContext, const Dictionary& dict)
 {
-    SharedPtr pPass = SharedPtr(new RTPhotonMapper);
+    SharedPtr pPass = SharedPtr(new RTPhotonMapper(dict));
     return pPass;
 }
 
-RTPhotonMapper::RTPhotonMapper():
+RTPhotonMapper::RTPhotonMapper(const Dictionary& dict):
     RenderPass(kInfo)
 {
+    mpStats = PhotonMapperStats::create();
+
+    for (const auto& [key, value] : dict)
+    {
+        if (key == kAccumulateImage) mAccumulateImage = value;
+        else if (key == kMinPhotonsPerLight) mMinPhotonsPerLight = value;
+        else if (key == kMaxPhotonsPerLight) mMaxPhotonsPerLight = value;
+        else if (key == kCollectStats) mpStats->setEnabled(value);
+        else if (key == kAutoRadius) mAutoRadius = value;
+        else if (key == kFluxRoulette) mFluxRoulette = value;
+        else if (key == kIncrementalUpdates) mIncrementalUpdates = value;
+        else if (key == kRestartThreshold) mInvalidation.setRestartThreshold(value);
+        else if (key == kResetMargin) mInvalidation.setResetMargin(value);
+        else logWarning("Unknown field '{}' in {} dictionary.", key, kInfo.type);
+    }
+
     //Create sample generatior object here
     mpSampleGenerator = SampleGenerator::create(SAMPLE_GENERATOR_UNIFORM);
     FALCOR_ASSERT(mpSampleGenerator);
@@ -119,7 +163,17 @@ RTPhotonMapper::RTPhotonMapper():
 
 Dictionary RTPhotonMapper::getScriptingDictionary()
 {
-    return Dictionary();
+    Dictionary dict;
+    dict[kAccumulateImage] = mAccumulateImage;
+    dict[kMinPhotonsPerLight] = mMinPhotonsPerLight;
+    dict[kMaxPhotonsPerLight] = mMaxPhotonsPerLight;
+    dict[kCollectStats] = mpStats->isEnabled();
+    dict[kAutoRadius] = mAutoRadius;
+    dict[kFluxRoulette] = mFluxRoulette;
+    dict[kIncrementalUpdates] = mIncrementalUpdates;
+    dict[kRestartThreshold] = mInvalidation.getRestartThreshold();
+    dict[kResetMargin] = mInvalidation.getResetMargin();
+    return dict;
 }
 
 RenderPassReflection RTPhotonMapper::reflect(const CompileData& compileData)
@@ -131,6 +185,15 @@ RenderPassReflection RTPhotonMapper::reflect(const CompileData& compileData)
     addRenderPassInputs(reflector, kInputChannels);
     addRenderPassOutputs(reflector, kOutputChannels);
 
+    //The accumulated image is not written while the timer stops the iterations, so its memory must not be shared with other resources of the graph
+    if (mAccumulateImage) reflector.getField(kOutputChannels[0].name)->flags(RenderPassReflection::Field::Flags::Persistent);
+
+    //The array size of the gather points is set by the VBufferPM pass
+    for (const auto& channel : kGatherInputChannels)
+    {
+        reflector.addInput(channel.name, channel.desc).texture2D(0, 0, 1, 1, 0).bindFlags(ResourceBindFlags::ShaderResource).flags(RenderPassReflection::Field::Flags::Optional);
+    }
+
     return reflector;
 }
 
@@ -153,6 +216,27 @@ void RTPhotonMapper::execute(RenderContext* pRenderContext, const RenderData& re
         return;
     }
 
+    //Emit photons from the environment map if it lights the scene. A changed environment map restarts the iterations
+    if (is_set(mpScene->getUpdates(), Scene::UpdateFlags::EnvMapChanged))
+        mpEnvMapSampler = nullptr;
+    if (mpScene->useEnvLight() != (mpEnvMapSampler != nullptr)) {
+        mpEnvMapSampler = mpScene->useEnvLight() ? EnvMapSampler::create(pRenderContext, mpScene->getEnvMap()) : nullptr;
+        mRebuildLightTex = true;
+        mResetIterations = true;
+    }
+
+    //Light and object animations restart the light groups and screen regions they change. A following accumulator cannot restart parts of the image and restarts completely
+    if (mIncrementalUpdates && mLightSampleTex) {
+        PhotonMapInvalidation::Decision decision = mInvalidation.update(PhotonMapInvalidation::getSceneUpdate(*mpScene));
+        mRebuildLightTex |= decision.rebuildLightSampling;
+        if (decision.action == PhotonMapInvalidation::Action::Restart || (decision.action == PhotonMapInvalidation::Action::Invalidate && !mAccumulateImage))
+            mResetIterations = true;
+        else if (decision.action == PhotonMapInvalidation::Action::Invalidate) {
+            mResetLightGroups |= decision.resetGroups;
+            mResetBounds.insert(mResetBounds.end(), decision.resetBounds.begin(), decision.resetBounds.end());
+        }
+    }
+
     //Reset Frame Count if conditions are met
     if (mResetIterations || mAlwaysResetIterations || is_set(mpScene->getUpdates(), Scene::UpdateFlags::CameraMoved)) {
         mFrameCount = 0;
@@ -171,6 +255,7 @@ void RTPhotonMapper::execute(RenderContext* pRenderContext, const RenderData& re
     if (mNumPhotonsChanged) {
         changeNumPhotons();
         mNumPhotonsChanged = false;
+        mRadiusPilotPending = true;
     }
 
     //Trace mode Acceleration strucutre
@@ -254,6 +339,14 @@ void RTPhotonMapper::execute(RenderContext* pRenderContext, const RenderData& re
     // Photon Culling Pre-Pass
     //
 
+    //With automatic radii the first iteration is a pilot that counts the stored photons
+    const bool radiusPilot = mAutoRadius && mRadiusPilotPending;
+    const bool statsEnabled = mpStats->isEnabled();
+    if (radiusPilot) mpStats->setEnabled(true);
+
+    mpStats->beginFrame(pRenderContext);
+    mpStats->beginStage(PhotonMapperStats::Stage::Generate);
+
     if (mEnablePhotonCulling)
         photonCullingPass(pRenderContext, renderData);
 
@@ -262,6 +355,7 @@ void RTPhotonMapper::execute(RenderContext* pRenderContext, const RenderData& re
     //
 
     generatePhotons(pRenderContext, renderData);
+    mpStats->endStage(PhotonMapperStats::Stage::Generate);
 
 
     //Barrier for the AABB buffers (they need to be ready for Acceleration Structure Building)
@@ -276,11 +370,15 @@ void RTPhotonMapper::execute(RenderContext* pRenderContext, const RenderData& re
     mPhotonAccelSizeLastIt = {static_cast<uint>(mPhotonCount[0] * mPhotonBufferOverestimate), static_cast<uint>(mPhotonCount[1] * mPhotonBufferOverestimate)};
     if (mFrameCount == 0) { mPhotonAccelSizeLastIt[0] = mCausticBuffers.maxSize; mPhotonAccelSizeLastIt[1] = mGlobalBuffers.maxSize; }
 
+    mpStats->beginStage(PhotonMapperStats::Stage::Build);
     buildBottomLevelAS(pRenderContext, mPhotonAccelSizeLastIt);
     buildTopLevelAS(pRenderContext);
+    mpStats->endStage(PhotonMapperStats::Stage::Build);
 
     //Debug pass to visualize photons from acceleration structure
     if (mUsePhotonASDebugPass) {
+        mpStats->endFrame(pRenderContext, mCausticRadius, mGlobalRadius);
+        mpStats->setEnabled(statsEnabled);
         photonASDebugPass(pRenderContext, renderData);
         //Skip the collection and radius reduction if enabled
         return;
@@ -290,8 +388,23 @@ void RTPhotonMapper::execute(RenderContext* pRenderContext, const RenderData& re
     // Photon Collection Pass
     //
 
+    //A following accumulator has to restart together with the photon mapper
+    if (!mAccumulateImage && mFrameCount == 0) {
+        auto flags = dict.getValue(kRenderPassRefreshFlags, RenderPassRefreshFlags::None);
+        dict[Falcor::kRenderPassRefreshFlags] = flags | Falcor::RenderPassRefreshFlags::RenderOptionsChanged;
+    }
+    mpStats->beginStage(PhotonMapperStats::Stage::Collect);
     collectPhotons(pRenderContext, renderData);
+    mpStats->endStage(PhotonMapperStats::Stage::Collect);
+    mpStats->endFrame(pRenderContext, mCausticRadius, mGlobalRadius);
 
+    if (radiusPilot) {
+        applyRadiusEstimate(pRenderContext, renderData);
+        mpStats->setEnabled(statsEnabled);
+    }
+
+    mResetLightGroups = 0;
+    mResetBounds.clear();
     mFrameCount++;
 
     //Reduce radius with formula by Knaus & Zwicker (2011)
@@ -309,6 +422,52 @@ void RTPhotonMapper::execute(RenderContext* pRenderContext, const RenderData& re
     if (mResetConstantBuffers) mResetConstantBuffers = false;
 }
 
+void RTPhotonMapper::prepareAccumulation(const uint2 dim)
+{
+    if (!mAccumulateImage) {
+        mpAccumulationSum = nullptr;
+        mpAccumulationCorr = nullptr;
+        return;
+    }
+    //The light groups are stacked vertically
+    const uint32_t height = dim.y * getLightGroupCount();
+    if (mpAccumulationSum && mpAccumulationSum->getWidth() == dim.x && mpAccumulationSum->getHeight() == height) return;
+
+    mpAccumulationSum = Texture::create2D(dim.x, height, ResourceFormat::RGBA32Float, 1, 1, nullptr, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+    mpAccumulationSum->setName("RTPhotonMapper::AccumulationSum");
+    mpAccumulationCorr = Texture::create2D(dim.x, height, ResourceFormat::RGBA32Float, 1, 1, nullptr, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+    mpAccumulationCorr->setName("RTPhotonMapper::AccumulationCorr");
+
+    //New sums hold no iterations
+    mResetLightGroups = ~0u;
+}
+
+uint RTPhotonMapper::getLightGroupCount() const
+{
+    return mIncrementalUpdates && mAccumulateImage ? (uint)PhotonLightGroup::Count : 1u;
+}
+
+void RTPhotonMapper::applyRadiusEstimate(RenderContext* pRenderContext, const RenderData& renderData)
+{
+    mRadiusPilotPending = false;
+
+    PhotonMapperStats::Stats stats;
+    if (!mpStats->getStats(stats)) return;
+
+    if (!mpPixelFootprint) mpPixelFootprint = PhotonPixelFootprint::create(mpScene);
+    const float pixelFootprint = mpPixelFootprint->execute(pRenderContext, renderData.getTexture(kInputVBuffer));
+
+    //Scene bounds surface area as an estimate of the lit surface area
+    const AABB& bounds = mpScene->getSceneBounds();
+    PhotonRadiusEstimate radii = estimatePhotonRadii(bounds.area(), bounds.radius(), pixelFootprint, stats.causticPhotons, stats.globalPhotons, mPhotonsPerQuery);
+    mCausticRadiusStart = std::max(radii.causticRadius, kMinPhotonRadius);
+    mGlobalRadiusStart = std::max(radii.globalRadius, kMinPhotonRadius);
+    mHashCellRad = mGlobalRadiusStart / 2.f;
+
+    //Restart the iterations with the new radii
+    mOptionsChanged = true;
+}
+
 void RTPhotonMapper::renderUI(Gui::Widgets& widget)
 {
     float2 dummySpacing = float2(0, 10);
@@ -401,8 +560,19 @@ void RTPhotonMapper::renderUI(Gui::Widgets& widget)
         widget.tooltip("The start value for the radius of caustic Photons");
         dirty |= widget.var("Global Radius Start", mGlobalRadiusStart, kMinPhotonRadius, FLT_MAX, 0.001f);
         widget.tooltip("The start value for the radius of global Photons");
+        bool estimateRadius = widget.checkbox("Auto Radius", mAutoRadius);
+        widget.tooltip("Estimates the start radii from the scene size, the pixel footprint at the camera hits and the photons stored in a pilot iteration. The estimation runs again when the scene or the number of photons changes");
+        if (mAutoRadius) {
+            estimateRadius |= widget.var("Photons per Query", mPhotonsPerQuery, 1.f, 1024.f, 1.f);
+            widget.tooltip("Targeted number of photons in a query for the radius estimation");
+            estimateRadius |= widget.button("Estimate Radius");
+        }
+        mRadiusPilotPending |= estimateRadius;
+        dirty |= estimateRadius;
         dirty |= widget.var("Rejection Probability", mRejectionProbability, 0.001f, 1.f, 0.001f);
         widget.tooltip("Probabilty that a Global Photon is saved");
+        dirty |= widget.checkbox("Flux Roulette", mFluxRoulette);
+        widget.tooltip("Terminates photon paths and stores global photons with probabilities proportional to their flux relative to the average photon flux. The photons then carry about the same flux, which lowers the noise for the same number of photons. Without it the paths are terminated by their throughput and the global photons are stored with the fixed probability above");
     }
     //Material Settings
     if (auto group = widget.group("Material Options")) {
@@ -467,6 +637,10 @@ void RTPhotonMapper::renderUI(Gui::Widgets& widget)
     if (auto group = widget.group("Light Sample Tex")) {
         mRebuildLightTex |= widget.dropdown("Sample mode", kLightTexModeList, (uint32_t&)mLightTexMode);
         widget.tooltip("Changes photon distribution for the light sampling texture. Also rebuilds the texture.");
+        mRebuildLightTex |= widget.var("Min Photons per Light", mMinPhotonsPerLight, 0u, 1u << 20);
+        widget.tooltip("Minimum number of photons of every analytic light with power, even if its share of the power is smaller");
+        mRebuildLightTex |= widget.var("Max Photons per Light", mMaxPhotonsPerLight, 0u, 1u << 24);
+        widget.tooltip("Maximum number of photons of an analytic light. The rest of its share goes to the other analytic lights. Zero for no cap");
         mRebuildLightTex |= widget.button("Rebuild Light Tex");
         dirty |= mRebuildLightTex;
     }
@@ -491,10 +665,31 @@ void RTPhotonMapper::renderUI(Gui::Widgets& widget)
 
     dirty |= mPhotonInfoFormatChanged;  //Reset iterations if format is changed
 
+    if (auto group = widget.group("Statistics")) {
+        mpStats->renderUI(group);
+    }
+
     widget.dummy("", dummySpacing);
     //Reset Iterations
     widget.checkbox("Always Reset Iterations", mAlwaysResetIterations);
     widget.tooltip("Always Resets the Iterations, currently good for moving the camera");
+    dirty |= widget.checkbox("Incremental Updates", mIncrementalUpdates);
+    widget.tooltip("Light and object animations restart only what they change. Analytic, mesh and environment map photons and the direct light are accumulated in separate sums (128 B per pixel), and a changed light restarts its group and the direct light. "
+        "Moved objects restart all groups in the screen region of their old and new bounds, grown by the reset margin. Shadows and reflections cast further than the margin keep the old lighting. "
+        "Without it scene changes other than camera and environment map changes are ignored");
+    if (mIncrementalUpdates) {
+        float restartThreshold = mInvalidation.getRestartThreshold();
+        if (widget.var("Restart Threshold", restartThreshold, 0.f, 1.f, 0.01f)) mInvalidation.setRestartThreshold(restartThreshold);
+        widget.tooltip("Fraction of the scene surface swept by moved objects from which on all iterations are restarted instead of their screen regions");
+        float resetMargin = mInvalidation.getResetMargin();
+        if (widget.var("Reset Margin", resetMargin, 0.f, 10.f, 0.05f)) mInvalidation.setResetMargin(resetMargin);
+        widget.tooltip("Growth of the bounds of moved objects relative to their extent. Larger margins also restart nearby shadows and reflections");
+    }
+    if (widget.checkbox("Accumulate Image", mAccumulateImage)) {
+        dirty = true;
+        requestRecompile();
+    }
+    widget.tooltip("Averages the iterations in the photon image, with compensated sums that do not drift over many iterations. Disable to output the radiance of each iteration, e.g. for an AccumulatePass with a precision mode. The timer does not stop a following accumulator");
     mResetIterations |= widget.button("Reset Iterations");
     widget.tooltip("Resets the iterations");
     dirty |= mResetIterations;
@@ -508,6 +703,9 @@ void RTPhotonMapper::setScene(RenderContext* pRenderContext, const Scene::Shared
 {
     // Clear data for previous scene.
     resetPhotonMapper();
+    mpEnvMapSampler = nullptr;
+    mpPixelFootprint = nullptr;
+    mRadiusPilotPending = true;
     resetCullingVars();
 
     // After changing scene, the raytracing program should to be recreated.
@@ -721,6 +919,7 @@ void RTPhotonMapper::generatePhotons(RenderContext* pRenderContext, const Render
     mTracerGenerate.pProgram->addDefine("RAY_TMAX_CULLING", std::to_string(kCollectTMax));
     mTracerGenerate.pProgram->addDefine("CULLING_USE_PROJECTION", std::to_string(mUseProjectionMatrixCulling));
     mTracerGenerate.pProgram->addDefine("PHOTON_FACE_NORMAL", mUseFaceNormalToReject ? "1" : "0");
+    mTracerGenerate.pProgram->addDefine("LIGHT_GROUP_COUNT", std::to_string(getLightGroupCount()));
     mTracerGenerate.pProgram->addDefine("MULTI_DIFFHIT_CAUSTIC_MAP", mCausticMapMultipleDiffuseHits == 0 ? "0" : "1");
 
     if (!mTracerGenerate.pVars) prepareVars();
@@ -729,6 +928,7 @@ void RTPhotonMapper::generatePhotons(RenderContext* pRenderContext, const Render
     auto& dict = renderData.getDictionary();
 
     auto var = mTracerGenerate.pVars->getRootVar();
+    mpStats->prepareProgram(mTracerGenerate.pProgram, var);
 
     // Set constants (uniforms).
     // 
@@ -737,6 +937,10 @@ void RTPhotonMapper::generatePhotons(RenderContext* pRenderContext, const Render
 
     std::string nameBuf = "PerFrame";
     var[nameBuf]["gFrameCount"] = mFrameCount;
+    var[nameBuf]["gSceneCenter"] = mpScene->getSceneBounds().center();
+    var[nameBuf]["gSceneRadius"] = mpScene->getSceneBounds().radius();
+    var[nameBuf]["gNumEnvPhotons"] = mNumEnvPhotons;
+    var[nameBuf]["gPhotonFluxReference"] = mPhotonFluxReference;
     var[nameBuf]["gCausticRadius"] = mCausticRadius;
     var[nameBuf]["gGlobalRadius"] = mGlobalRadius;
     var[nameBuf]["gHashScaleFactor"] = 1.0f / (hashRad * 2);  //Radius needs to be double to ensure that all photons from the camera cell are in it
@@ -747,10 +951,10 @@ void RTPhotonMapper::generatePhotons(RenderContext* pRenderContext, const Render
         var[nameBuf]["gMaxRecursion"] = mMaxBounces;
         var[nameBuf]["gPRNGDimension"] = dict.keyExists(kRenderPassPRNGDimension) ? dict[kRenderPassPRNGDimension] : 0u;
         var[nameBuf]["gGlobalRejection"] = mRejectionProbability;
+        var[nameBuf]["gFluxRoulette"] = mFluxRoulette;
         var[nameBuf]["gEmissiveScale"] = mIntensityScalar;
 
         var[nameBuf]["gSpecRoughCutoff"] = mSpecRoughCutoff;
-        var[nameBuf]["gAnalyticInvPdf"] = mAnalyticInvPdf;
         var[nameBuf]["gAdjustShadingNormals"] = mAdjustShadingNormals;
         var[nameBuf]["gUseAlphaTest"] = mUseAlphaTest;
 
@@ -773,6 +977,8 @@ void RTPhotonMapper::generatePhotons(RenderContext* pRenderContext, const Render
     var["gPhotonCounter"] = mPhotonCounterBuffer.counter;
     var["gLightSample"] = mLightSampleTex;
     var["gNumPhotonsPerEmissive"] = mPhotonsPerTriangle;
+    var["gNumPhotonsPerAnalytic"] = mPhotonsPerAnalytic;
+    if (mpEnvMapSampler) mpEnvMapSampler->setShaderData(var["gEnvMapSampler"]);
 
     //Set optinal culling variables
     if (mEnablePhotonCulling) {
@@ -791,8 +997,8 @@ void RTPhotonMapper::collectPhotons(RenderContext* pRenderContext, const RenderD
 {
     FALCOR_PROFILE("Collect_Pass");
 
-    //Check if stochastic collect variables have changed
-    if (mMaxNumberPhotonsSC != mMaxNumberPhotonsSCUI) {
+    //Check if stochastic collect variables or the light groups have changed. The light groups change the payload size
+    if (mMaxNumberPhotonsSC != mMaxNumberPhotonsSCUI || mCollectLightGroupCount != getLightGroupCount()) {
         //Rebuild program
         mMaxNumberPhotonsSC = mMaxNumberPhotonsSCUI;
         createCollectionProgram();
@@ -804,11 +1010,13 @@ void RTPhotonMapper::collectPhotons(RenderContext* pRenderContext, const RenderD
     // Full Collect
     //************************************
     mTracerCollect.pProgram->addDefines(getValidResourceDefines(kInputChannels, renderData));
+    mTracerCollect.pProgram->addDefines(getValidResourceDefines(kGatherInputChannels, renderData));
     mTracerCollect.pProgram->addDefines(getValidResourceDefines(kOutputChannels, renderData));
     mTracerCollect.pProgram->addDefine("RAY_TMIN", std::to_string(kCollectTMin));
     mTracerCollect.pProgram->addDefine("RAY_TMAX", std::to_string(kCollectTMax));
     mTracerCollect.pProgram->addDefine("INFO_TEXTURE_HEIGHT", std::to_string(kInfoTexHeight));
     mTracerCollect.pProgram->addDefine("PHOTON_FACE_NORMAL", mUseFaceNormalToReject ? "1" : "0");
+    mTracerCollect.pProgram->addDefine("LIGHT_GROUP_COUNT", std::to_string(mCollectLightGroupCount));
 
     // Prepare program for full collect vars. This may trigger shader compilation.
     if (!mTracerCollect.pVars) {
@@ -826,12 +1034,14 @@ void RTPhotonMapper::collectPhotons(RenderContext* pRenderContext, const RenderD
     //Stochastic Collect
     //************************************
     mTracerStochasticCollect.pProgram->addDefines(getValidResourceDefines(kInputChannels, renderData));
+    mTracerStochasticCollect.pProgram->addDefines(getValidResourceDefines(kGatherInputChannels, renderData));
     mTracerStochasticCollect.pProgram->addDefines(getValidResourceDefines(kOutputChannels, renderData));
     mTracerStochasticCollect.pProgram->addDefine("RAY_TMIN", std::to_string(kCollectTMin));
     mTracerStochasticCollect.pProgram->addDefine("RAY_TMAX", std::to_string(kCollectTMax));
     mTracerStochasticCollect.pProgram->addDefine("INFO_TEXTURE_HEIGHT", std::to_string(kInfoTexHeight));
     mTracerStochasticCollect.pProgram->addDefine("NUM_PHOTONS", std::to_string(mMaxNumberPhotonsSC));
     mTracerStochasticCollect.pProgram->addDefine("PHOTON_FACE_NORMAL", mUseFaceNormalToReject ? "1" : "0");
+    mTracerStochasticCollect.pProgram->addDefine("LIGHT_GROUP_COUNT", std::to_string(mCollectLightGroupCount));
 
     // Prepare program for full collect vars. This may trigger shader compilation.
     if (!mTracerStochasticCollect.pVars) {
@@ -854,6 +1064,7 @@ void RTPhotonMapper::collectPhotons(RenderContext* pRenderContext, const RenderD
     //Per frame
     std::string nameBuf = "PerFrame";
     var[nameBuf]["gFrameCount"] = mFrameCount;
+    var[nameBuf]["gAccumulateImage"] = mAccumulateImage;
     var[nameBuf]["gCausticRadius"] = mCausticRadius;
     var[nameBuf]["gGlobalRadius"] = mGlobalRadius;
 
@@ -884,8 +1095,17 @@ void RTPhotonMapper::collectPhotons(RenderContext* pRenderContext, const RenderD
 
     //Bind input and output textures
     for (auto& channel : kInputChannels) bindAsTex(channel);
+    for (auto& channel : kGatherInputChannels) var[channel.texname] = renderData.getTexture(channel.name);
     bindAsTex(kOutputChannels[0]);
 
+    prepareAccumulation(renderData.getDefaultTextureDims());
+    const std::vector<uint4> resetRegions = PhotonMapInvalidation::getResetRegions(mResetBounds, mpScene->getCamera()->getViewProjMatrix(), renderData.getDefaultTextureDims());
+    var["PerFrame"]["gResetGroups"] = mFrameCount == 0 ? ~0u : mResetLightGroups;
+    var["PerFrame"]["gResetRegionCount"] = (uint32_t)resetRegions.size();
+    for (size_t i = 0; i < resetRegions.size(); i++) var["PerFrame"]["gResetRegions"][i] = resetRegions[i];
+    var["gAccumulationSum"] = mpAccumulationSum;
+    var["gAccumulationCorr"] = mpAccumulationCorr;
+
     //bind TLAS
     bool tlasValid = var["gPhotonAS"].setSrv(mPhotonTlas.pSrv);
     FALCOR_ASSERT(tlasValid);
@@ -1092,30 +1312,51 @@ void RTPhotonMapper::prepareRandomSeedBuffer(const uint2 screenDimensions)
 void RTPhotonMapper::createLightSampleTexture(RenderContext* pRenderContext)
 {
     if (mPhotonsPerTriangle) mPhotonsPerTriangle.reset();
+    if (mPhotonsPerAnalytic) mPhotonsPerAnalytic.reset();
     if (mLightSampleTex) mLightSampleTex.reset();
 
     FALCOR_ASSERT(mpScene);    //Scene has to be set
 
-    auto analyticLights = mpScene->getActiveLights();
     auto lightCollection = mpScene->getLightCollection(pRenderContext);
 
+    //Split the photons between the analytic lights, the emissive triangles and the environment map by their power
+    //Analytic lights are indexed like in the scene. Inactive lights have no power and get no photons
+    const float sceneRadius = mpScene->getSceneBounds().radius();
+    PhotonEmissionPower power;
+    PhotonSourcePower sourcePower;     //Per light power for the scene change tracking
+    std::vector<float> analyticLightPower(mpScene->getLightCount());
+    for (uint i = 0; i < mpScene->getLightCount(); i++) {
+        analyticLightPower[i] = getAnalyticLightPhotonPower(*mpScene->getLight(i), sceneRadius);
+        power.analytic += analyticLightPower[i];
+    }
+    if (lightCollection->getActiveLightCount() > 0) {
+        getActiveEmissiveTriangles(pRenderContext);
+        const auto& meshLightTriangles = lightCollection->getMeshLightTriangles();
+        sourcePower.meshLights.resize(lightCollection->getMeshLights().size());
+        for (uint triIdx : mActiveEmissiveTriangles) {
+            power.emissive += meshLightTriangles[triIdx].flux;
+            sourcePower.meshLights[meshLightTriangles[triIdx].lightIdx] += meshLightTriangles[triIdx].flux * mIntensityScalar;
+        }
+        power.emissive *= mIntensityScalar;
+    }
+    if (mpEnvMapSampler) power.env = getEnvMapPhotonPower(pRenderContext, *mpEnvMapSampler, sceneRadius);
+
+    sourcePower.analytic = analyticLightPower;
+    sourcePower.env = power.env;
+    mInvalidation.reset(sourcePower, PhotonMapInvalidation::getInstanceBounds(*mpScene), mpScene->getSceneBounds());
+
+    PhotonEmissionCounts emissionCounts = splitPhotonsByPower(power, mNumPhotons);
+    uint numEmissivePhotons = emissionCounts.emissive;
+    mNumEnvPhotons = emissionCounts.env;
+
+    //Split the analytic photons between the analytic lights by their power
+    std::vector<uint> numPhotonsPerLight = splitPhotonsByLightPower(analyticLightPower, emissionCounts.analytic, mMinPhotonsPerLight, mMaxPhotonsPerLight);
     uint analyticPhotons = 0;
-    uint numEmissivePhotons = 0;
-    //If there are analytic Lights split number of Photons even between the analytic light and the number of emissive models (approximation of the number of emissive lights)
-    if (analyticLights.size() != 0) {
-        uint lightsTotal = static_cast<uint>(analyticLights.size() + lightCollection->getMeshLights().size());
-        float percentAnalytic = static_cast<float>(analyticLights.size()) / static_cast<float>(lightsTotal);
-        analyticPhotons = static_cast<uint>(mNumPhotons * percentAnalytic);
-        analyticPhotons += (uint)analyticLights.size() - (analyticPhotons % (uint)analyticLights.size());  //add it up so every light gets the same number of photons
-        numEmissivePhotons = mNumPhotons - analyticPhotons;
-    }
-    else
-        numEmissivePhotons = mNumPhotons;
+    for (uint photons : numPhotonsPerLight) analyticPhotons += photons;
 
     std::vector<uint> numPhotonsPerTriangle;    //only filled when there are emissive
 
     if (numEmissivePhotons > 0) {
-        getActiveEmissiveTriangles(pRenderContext);
         auto meshLightTriangles = lightCollection->getMeshLightTriangles();
         //Get total area to distribute to get the number of photons per area.
         float totalMode = 0;
@@ -1161,12 +1402,12 @@ void RTPhotonMapper::createLightSampleTexture(RenderContext* pRenderContext)
         numEmissivePhotons = tmpNumEmissivePhotons;     //get real photon count
     }
 
-    uint totalNumPhotons = numEmissivePhotons + analyticPhotons;
+    uint totalNumPhotons = numEmissivePhotons + analyticPhotons + mNumEnvPhotons;
 
-    //calculate the pdf for analytic and emissive light
-    if (analyticPhotons > 0 && analyticLights.size() > 0) {
-        mAnalyticInvPdf = (static_cast<float>(totalNumPhotons) * static_cast<float>(analyticLights.size())) / static_cast<float>(analyticPhotons);
-    }
+    //Flux roulette keeps the photons near the average flux of the emitted photons
+    mPhotonFluxReference = totalNumPhotons > 0 ? power.total() / totalNumPhotons : 0.f;
+
+    //calculate the pdf for emissive light
     if (numEmissivePhotons > 0 && lightCollection->getActiveLightCount()) {
         mEmissiveInvPdf = (static_cast<float>(totalNumPhotons) * lightCollection->getActiveLightCount()) / static_cast<float>(numEmissivePhotons);
     }
@@ -1177,8 +1418,13 @@ void RTPhotonMapper::createLightSampleTexture(RenderContext* pRenderContext)
 
     //Create texture. The texture fills 16x16 fields with information
 
-    uint xPhotons = (totalNumPhotons / mMaxDispatchY) + 1;
-    xPhotons += (xPhotons % blockSize == 0 && analyticPhotons > 0) ? blockSize : blockSize - (xPhotons % blockSize);  //Fill up so x to 16x16 block with at least 1 block extra when mixed
+    //Every light group starts on a new block. Fill up x so that all blocks fit
+    auto getNumBlocks = [&](uint photons) {
+        return photons > 0 ? (photons / blockSizeSq) + 1 : 0;
+    };
+    uint numBlocks = getNumBlocks(analyticPhotons) + getNumBlocks(numEmissivePhotons) + getNumBlocks(mNumEnvPhotons);
+    uint blocksPerColumn = mMaxDispatchY / blockSize;
+    uint xPhotons = std::max((numBlocks + blocksPerColumn - 1) / blocksPerColumn, 1u) * blockSize;
 
     //Init the texture with the invalid index (zero)
     //Negative indices are analytic and postivie indices are emissive
@@ -1196,28 +1442,13 @@ void RTPhotonMapper::createLightSampleTexture(RenderContext* pRenderContext)
         return uint2(x, y);
     };
 
-    //Fill analytic lights
-    if (analyticLights.size() > 0) {
-        uint numCurrentLight = 0;
-        uint step = analyticPhotons / static_cast<uint>(analyticLights.size());
-        bool stop = false;
-        for (uint i = 0; i <= analyticPhotons / blockSizeSq; i++) {
-            if (stop) break;
-            for (uint y = 0; y < blockSize; y++) {
-                if (stop) break;
-                for (uint x = 0; x < blockSize; x++) {
-                    if (numCurrentLight >= analyticPhotons) {
-                        stop = true;
-                        break;
-                    }
-                    uint2 idx = getBlockStartingIndex(i);
-                    idx += uint2(x, y);
-                    int32_t lightIdx = static_cast<int32_t>((numCurrentLight / step) + 1);  //current light index + 1
-                    lightIdx *= -1;                                                         //turn it negative as it is a analytic light
-                    lightIdxTex[getIndex(idx)] = lightIdx;
-                    numCurrentLight++;
-                }
-            }
+    //Fill analytic lights. Every light gets a consecutive range of photons
+    uint analyticIdx = 0;
+    for (uint lightIdx = 0; lightIdx < static_cast<uint>(numPhotonsPerLight.size()); lightIdx++) {
+        for (uint i = 0; i < numPhotonsPerLight[lightIdx]; i++, analyticIdx++) {
+            uint2 idx = getBlockStartingIndex(analyticIdx / blockSizeSq);
+            idx += uint2(analyticIdx % blockSize, (analyticIdx % blockSizeSq) / blockSize);
+            lightIdxTex[getIndex(idx)] = -static_cast<int32_t>(lightIdx + 1);      //light index + 1, negative as it is a analytic light
         }
     }
 
@@ -1253,7 +1484,15 @@ void RTPhotonMapper::createLightSampleTexture(RenderContext* pRenderContext)
         }
     }
 
-
+    //Fill environment map photons
+    if (mNumEnvPhotons > 0) {
+        uint envStartBlock = getNumBlocks(analyticPhotons) + getNumBlocks(numEmissivePhotons);
+        for (uint i = 0; i < mNumEnvPhotons; i++) {
+            uint2 idx = getBlockStartingIndex(envStartBlock + i / blockSizeSq);
+            idx += uint2(i % blockSize, (i % blockSizeSq) / blockSize);
+            lightIdxTex[getIndex(idx)] = kPhotonEnvLightIndex;
+        }
+    }
 
     //Create texture and Pdf buffer
     mLightSampleTex = Texture::create2D(xPhotons, mMaxDispatchY, ResourceFormat::R32Int, 1, 1, lightIdxTex.data());
@@ -1266,6 +1505,12 @@ void RTPhotonMapper::createLightSampleTexture(RenderContext* pRenderContext)
     mPhotonsPerTriangle = Buffer::createStructured(sizeof(uint), static_cast<uint32_t>(numPhotonsPerTriangle.size()), ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, numPhotonsPerTriangle.data());
     mPhotonsPerTriangle->setName("RTPhotonMapper::mPhotonsPerTriangleEmissive");
 
+    if (numPhotonsPerLight.size() == 0) {
+        numPhotonsPerLight.push_back(0);
+    }
+    mPhotonsPerAnalytic = Buffer::createStructured(sizeof(uint), static_cast<uint32_t>(numPhotonsPerLight.size()), ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, numPhotonsPerLight.data());
+    mPhotonsPerAnalytic->setName("RTPhotonMapper::mPhotonsPerAnalytic");
+
 
     //Set numPhoton variable
     mPGDispatchX = xPhotons;
@@ -1298,14 +1543,16 @@ void RTPhotonMapper::createCollectionProgram()
     mTracerCollect = RayTraceProgramHelper::create();
     mTracerStochasticCollect = RayTraceProgramHelper::create();
     mResetConstantBuffers = true;
+    mCollectLightGroupCount = getLightGroupCount();
 
     //Full Collect
     {
-        //payload size is num photons + a counter + sampleGenerator(16B)
-        uint maxPayloadSize = kMaxPayloadSizeBytesCollect;
+        //payload size is the radiance of each light group + a counter + sampleGenerator(16B)
+        uint maxPayloadSize = kMaxPayloadSizeBytesCollect + (mCollectLightGroupCount - 1) * (uint)sizeof(float3);
 
         RtProgram::Desc desc;
         desc.addShaderLibrary(kShaderCollectPhoton);
+        desc.setCompilerFlags(Shader::CompilerFlags::FloatingPointModePrecise);   //The compensated sums need precise floating-point math
         desc.setMaxPayloadSize(maxPayloadSize);
         desc.setMaxAttributeSize(kMaxAttributeSizeBytes);
         desc.setMaxTraceRecursionDepth(kMaxRecursionDepth);
@@ -1327,6 +1574,7 @@ void RTPhotonMapper::createCollectionProgram()
 
         RtProgram::Desc desc;
         desc.addShaderLibrary(kShaderCollectStochasticPhoton);
+        desc.setCompilerFlags(Shader::CompilerFlags::FloatingPointModePrecise);   //The compensated sums need precise floating-point math
         desc.setMaxPayloadSize(maxPayloadSize);
         desc.setMaxAttributeSize(kMaxAttributeSizeBytes);
         desc.setMaxTraceRecursionDepth(kMaxRecursionDepth);
@@ -1382,6 +1630,7 @@ void RTPhotonMapper::photonCullingPass(RenderContext* pRenderContext, const Rend
 
         mPhotonCullingPass = ComputePass::create(desc, defines, true);
     }
+    mPhotonCullingPass->getProgram()->addDefines(getValidResourceDefines(kGatherInputChannels, renderData));
 
     //Variables
      // Set constants.
@@ -1398,6 +1647,7 @@ void RTPhotonMapper::photonCullingPass(RenderContext* pRenderContext, const Rend
     var["PerFrame"]["gGlobalRadius"] = mGlobalRadius;
 
     var[kInputChannels[0].texname] = renderData[kInputChannels[0].name]->asTexture();    //VBuffer
+    var[kGatherInputChannels[0].texname] = renderData.getTexture(kGatherInputChannels[0].name);
     var["gHashBuffer"] = mCullingBuffer;
 
 
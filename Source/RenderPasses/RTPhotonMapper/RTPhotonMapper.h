@@ -28,6 +28,11 @@
 #pragma once
 #include "Falcor.h"
 #include "Utils/Sampling/SampleGenerator.h"
+#include "Rendering/Lights/EnvMapSampler.h"
+#include "Rendering/Utils/PhotonEmission.h"
+#include "Rendering/Utils/PhotonMapInvalidation.h"
+#include "Rendering/Utils/PhotonMapperStats.h"
+#include "Rendering/Utils/PhotonRadiusEstimation.h"
 #include <chrono>
  //For building the Acceleration Structure 
 #include "Core/API/RtAccelerationStructure.h"
@@ -59,6 +64,8 @@ public:
     virtual bool onMouseEvent(const MouseEvent& mouseEvent) override { return false; }
     virtual bool onKeyEvent(const KeyboardEvent& keyEvent) override { return false; }
 
+    const PhotonMapperStats::SharedPtr& getPhotonStats() const { return mpStats; }
+
     enum class TextureFormat {
         _16Bit = 0u,
         _32Bit = 1u
@@ -70,7 +77,7 @@ public:
     };
 
 private:
-    RTPhotonMapper();
+    RTPhotonMapper(const Dictionary& dict);
 
     /** Prepares Program Variables and binds the sample generator
     */
@@ -109,6 +116,19 @@ private:
     */
     void collectPhotons(RenderContext* pRenderContext, const RenderData& renderData);
 
+    /** Creates the compensated sums the iterations are accumulated in. Releases them if the image is not accumulated
+    */
+    void prepareAccumulation(const uint2 dim);
+
+    /** Returns the number of light groups accumulated separately. Without incremental updates all light is one group
+    */
+    uint getLightGroupCount() const;
+
+    /** Sets the start radii from the photon counts of the pilot iteration and the pixel footprint at the camera hits.
+        Restarts the iterations with the new radii.
+    */
+    void applyRadiusEstimate(RenderContext* pRenderContext, const RenderData& renderData);
+
     /** Creates the AS. Calls the createTopLevelAS(..) and createBottomLevelAS(..) functions
     */
     void createAccelerationStructure(RenderContext* pContext);
@@ -176,6 +196,10 @@ private:
     // Internal state
     Scene::SharedPtr            mpScene;                    ///< Current scene.
     SampleGenerator::SharedPtr  mpSampleGenerator;          ///< GPU sample generator.
+    PhotonMapperStats::SharedPtr mpStats;                   ///< Per-iteration photon counts and stage timings.
+    PhotonPixelFootprint::SharedPtr mpPixelFootprint;       ///< Pixel footprint at the camera hits for the radius estimation.
+    PhotonMapInvalidation       mInvalidation;              ///< Decides which light groups and screen regions a scene change restarts.
+    EnvMapSampler::SharedPtr    mpEnvMapSampler;            ///< Environment map sampler. Only set if the environment map lights the scene.
 
     //Constants
     const float                 kMinPhotonRadius = 0.00001f;                 ///< Too small radiis should not be used as it could lead to floating point errors. 
@@ -195,6 +219,9 @@ private:
 
     float                       mCausticRadiusStart = 0.01f;            ///< Start value for the caustic Radius
     float                       mGlobalRadiusStart = 0.05f;             ///< Start value for the caustic Radius
+    bool                        mAutoRadius = false;                    ///< Estimate the start radii from a pilot iteration
+    float                       mPhotonsPerQuery = 32.f;                ///< Targeted number of photons per query for the radius estimation
+    bool                        mRadiusPilotPending = true;             ///< The next iteration is a pilot iteration for the radius estimation
     float                       mCausticRadius = 1.f;                 ///< Current Radius for caustic Photons
     float                       mGlobalRadius = 1.f;                  ///< Current Radius for global Photons
 
@@ -205,6 +232,7 @@ private:
 
     bool                        mResetIterations = false;               ///<Resets the iterations counter once
     bool                        mAlwaysResetIterations = false;         ///<Resets the iteration counter every frame
+    bool                        mIncrementalUpdates = true;             ///<Light and object animations restart only the changed light groups and the screen regions of moved objects instead of being ignored
 
     bool                        mNumPhotonsChanged = false;             ///<If true buffers needs to be restarted and Number of photons needs to be changed
     bool                        mFitBuffersToPhotonShot = false;        ///<Changes the buffer size to be around the number of photons shot
@@ -220,6 +248,8 @@ private:
     // Generate only
     uint                        mMaxBounces = 10;                        ///< Depth of recursion (0 = none).
     float                       mRejectionProbability = 0.3f;                ///< Probabilty that a Global photon is saved
+    bool                        mFluxRoulette = true;                   ///< Terminate and store photons by their flux relative to the average photon flux
+    float                       mPhotonFluxReference = 0.f;             ///< Average flux luminance of the emitted photons
 
     uint                        mNumPhotons = 2000000;                   ///< Number of Photons shot
     uint                        mNumPhotonsUI = mNumPhotons;            ///< For UI. It is decopled from the runtime var because changes have to be confirmed
@@ -235,6 +265,7 @@ private:
     // Collect only
     bool                        mDisableGlobalCollection = false;       ///<Disabled the collection of global photons
     bool                        mDisableCausticCollection = false;       ///<Disabled the collection of caustic photons
+    bool                        mAccumulateImage = true;                ///<Averages the iterations in the photon image. Disabled, each iteration is output for a following accumulator
 
     //Photon Culling
     bool                        mEnablePhotonCulling = true;            //<Photon Culling with AS
@@ -248,6 +279,7 @@ private:
     bool                        mEnableStochasticCollect = true;       //< Stochastic collect
     uint                        mMaxNumberPhotonsSC = 3;                 //< Max number of photons that can get collected. (4 * x) - 1 for best fit
     uint                        mMaxNumberPhotonsSCUI = mMaxNumberPhotonsSC;
+    uint                        mCollectLightGroupCount = 1;             //< Light groups the collect programs were created for. The full collect payload holds one radiance per group
     uint                        mStochasticIterations = 10000;
 
     //*******************************************************
@@ -255,6 +287,10 @@ private:
     //*******************************************************
     
     uint                        mFrameCount = 0;            ///< Frame count since last Reset
+    uint32_t                    mResetLightGroups = 0;      ///< Light groups (bits of PhotonLightGroup) whose sums restart in the next iteration
+    std::vector<AABB>           mResetBounds;               ///< World bounds of moved objects. All light groups restart in their screen region in the next iteration
+    Texture::SharedPtr          mpAccumulationSum;          ///< Compensated sums of the iterations per light group, stacked vertically. The alpha channel counts the iterations
+    Texture::SharedPtr          mpAccumulationCorr;         ///< Compensation term of the sum
     std::vector<uint>           mPhotonCount = { 0,0 };
     std::array<uint, 2>         mPhotonAccelSizeLastIt{ 0,0 };
     bool                        mOptionsChanged = false;
@@ -286,13 +322,16 @@ private:
     std::vector<uint> mActiveEmissiveTriangles;
     bool            mRebuildLightTex = false;
     LightTexMode mLightTexMode = LightTexMode::power;
+    uint mMinPhotonsPerLight = 256;     ///< Minimum number of photons per analytic light with power. One 16x16 block of the light sample texture
+    uint mMaxPhotonsPerLight = 0;       ///< Maximum number of photons per analytic light. Zero for no cap
     Texture::SharedPtr mLightSampleTex;
     Buffer::SharedPtr mPhotonsPerTriangle;
+    Buffer::SharedPtr mPhotonsPerAnalytic;
     const uint mMaxDispatchY = 512;
     uint mPGDispatchX = 0;
     uint mAnalyticEndIndex = 0;
     uint mNumLights = 0;
-    float mAnalyticInvPdf = 0.0f;
+    uint mNumEnvPhotons = 0;    ///< Number of photons emitted from the environment map
     float mEmissiveInvPdf = 0.0f;
 
     // Ray tracing program.
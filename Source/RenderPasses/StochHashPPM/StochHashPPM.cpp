@@ -48,9 +48,16 @@ extern "C" FALCOR_API_EXPORT const char* getProjDir()
     return PROJECT_DIR;
 }
 
+static void regStochHashPPM(pybind11::module& m)
+{
+    pybind11::class_<PhotonMapperStochasticHash, RenderPass, PhotonMapperStochasticHash::SharedPtr> pass(m, "StochHashPPM");
+    pass.def_property_readonly("photonStats", &PhotonMapperStochasticHash::getPhotonStats);
+}
+
 extern "C" FALCOR_API_EXPORT void getPasses(Falcor::RenderPassLibrary & lib)
 {
     lib.registerPass(PhotonMapperStochasticHash::kInfo, PhotonMapperStochasticHash::create);
+    ScriptBindings::registerBinding(regStochHashPPM);
 }
 
 namespace
@@ -65,14 +72,35 @@ namespace
     const uint32_t kMaxAttributeSizeBytes = 8u;
     const uint32_t kMaxRecursionDepth = 2u;
 
+    // Scripting options
+    const char kAccumulateImage[] = "accumulateImage";
+    const char kMinPhotonsPerLight[] = "minPhotonsPerLight";
+    const char kMaxPhotonsPerLight[] = "maxPhotonsPerLight";
+    const char kCollectStats[] = "collectStats";
+    const char kAutoRadius[] = "autoRadius";
+    const char kFluxRoulette[] = "fluxRoulette";
+    const char kIncrementalUpdates[] = "incrementalUpdates";
+    const char kRestartThreshold[] = "restartThreshold";
+    const char kResetMargin[] = "resetMargin";
+
+    const char kInputVBuffer[] = "vbuffer";
+
     const ChannelList kInputChannels =
     {
-        {"vbuffer",             "gVBuffer",                 "V Buffer to get the intersected triangle",         false},
+        {kInputVBuffer,         "gVBuffer",                 "V Buffer to get the intersected triangle",         false},
         {"viewW",               "gViewWorld",               "World View Direction",                             false},
         {"thp",                 "gThp",                     "Throughput",                                       false},
         {"emissive",            "gEmissive",                "Emissive",                                         false},
     };
 
+    //Final gather points of VBufferPM, one array slice per gather ray. If connected, the global photons are collected there and the caustic photons at the vbuffer hit
+    const ChannelList kGatherInputChannels =
+    {
+        {"gatherVBuffer",       "gGatherVBuffer",           "Final gather points",                              true /* optional */},
+        {"gatherViewW",         "gGatherViewW",             "World View Direction at the final gather points",  true /* optional */},
+        {"gatherThp",           "gGatherThp",               "Throughput from the vbuffer hit to the final gather points", true /* optional */},
+    };
+
     const ChannelList kOutputChannels =
     {
         { "PhotonImage",          "gPhotonImage",               "An image that shows the caustics and indirect light from global photons" , false , ResourceFormat::RGBA32Float }
@@ -89,6 +117,11 @@ namespace
         {PhotonMapperStochasticHash::LightTexMode::area , "Area"}
     };
 
+    const Gui::DropdownList kCollectModeList{
+        {PhotonMapperStochasticHash::CollectMode::cube , "Cube"},
+        {PhotonMapperStochasticHash::CollectMode::tight , "Tight"}
+    };
+
     const Gui::DropdownList kCausticMapModes{
         {0, "LS+D"},
         {1, "L(S|D)*SD"}
@@ -97,20 +130,46 @@ namespace
 
 PhotonMapperStochasticHash::SharedPtr PhotonMapperStochasticHash::create(RenderContext* pRenderContext, const Dictionary& dict)
 {
-    SharedPtr pPass = SharedPtr(new PhotonMapperStochasticHash);
+    SharedPtr pPass = SharedPtr(new PhotonMapperStochasticHash(dict));
     return pPass;
 }
 
-PhotonMapperStochasticHash::PhotonMapperStochasticHash():
+PhotonMapperStochasticHash::PhotonMapperStochasticHash(const Dictionary& dict):
     RenderPass(kInfo)
 {
+    mpStats = PhotonMapperStats::create();
+
+    for (const auto& [key, value] : dict)
+    {
+        if (key == kAccumulateImage) mAccumulateImage = value;
+        else if (key == kMinPhotonsPerLight) mMinPhotonsPerLight = value;
+        else if (key == kMaxPhotonsPerLight) mMaxPhotonsPerLight = value;
+        else if (key == kCollectStats) mpStats->setEnabled(value);
+        else if (key == kAutoRadius) mAutoRadius = value;
+        else if (key == kFluxRoulette) mFluxRoulette = value;
+        else if (key == kIncrementalUpdates) mIncrementalUpdates = value;
+        else if (key == kRestartThreshold) mInvalidation.setRestartThreshold(value);
+        else if (key == kResetMargin) mInvalidation.setResetMargin(value);
+        else logWarning("Unknown field '{}' in {} dictionary.", key, kInfo.type);
+    }
+
     mpSampleGenerator = SampleGenerator::create(SAMPLE_GENERATOR_UNIFORM);
     FALCOR_ASSERT(mpSampleGenerator);
 }
 
 Dictionary PhotonMapperStochasticHash::getScriptingDictionary()
 {
-    return Dictionary();
+    Dictionary dict;
+    dict[kAccumulateImage] = mAccumulateImage;
+    dict[kMinPhotonsPerLight] = mMinPhotonsPerLight;
+    dict[kMaxPhotonsPerLight] = mMaxPhotonsPerLight;
+    dict[kCollectStats] = mpStats->isEnabled();
+    dict[kAutoRadius] = mAutoRadius;
+    dict[kFluxRoulette] = mFluxRoulette;
+    dict[kIncrementalUpdates] = mIncrementalUpdates;
+    dict[kRestartThreshold] = mInvalidation.getRestartThreshold();
+    dict[kResetMargin] = mInvalidation.getResetMargin();
+    return dict;
 }
 
 RenderPassReflection PhotonMapperStochasticHash::reflect(const CompileData& compileData)
@@ -122,6 +181,15 @@ RenderPassReflection PhotonMapperStochasticHash::reflect(const CompileData& comp
     addRenderPassInputs(reflector, kInputChannels);
     addRenderPassOutputs(reflector, kOutputChannels);
 
+    //The accumulated image is not written while the timer stops the iterations, so its memory must not be shared with other resources of the graph
+    if (mAccumulateImage) reflector.getField(kOutputChannels[0].name)->flags(RenderPassReflection::Field::Flags::Persistent);
+
+    //The array size of the gather points is set by the VBufferPM pass
+    for (const auto& channel : kGatherInputChannels)
+    {
+        reflector.addInput(channel.name, channel.desc).texture2D(0, 0, 1, 1, 0).bindFlags(ResourceBindFlags::ShaderResource).flags(RenderPassReflection::Field::Flags::Optional);
+    }
+
 
     return reflector;
 }
@@ -151,6 +219,27 @@ void PhotonMapperStochasticHash::execute(RenderContext* pRenderContext, const Re
         return;
     }
 
+    //Emit photons from the environment map if it lights the scene. A changed environment map restarts the iterations
+    if (is_set(mpScene->getUpdates(), Scene::UpdateFlags::EnvMapChanged))
+        mpEnvMapSampler = nullptr;
+    if (mpScene->useEnvLight() != (mpEnvMapSampler != nullptr)) {
+        mpEnvMapSampler = mpScene->useEnvLight() ? EnvMapSampler::create(pRenderContext, mpScene->getEnvMap()) : nullptr;
+        mRebuildLightTex = true;
+        mResetIterations = true;
+    }
+
+    //Light and object animations restart the light groups and screen regions they change. A following accumulator cannot restart parts of the image and restarts completely
+    if (mIncrementalUpdates && mLightSampleTex) {
+        PhotonMapInvalidation::Decision decision = mInvalidation.update(PhotonMapInvalidation::getSceneUpdate(*mpScene));
+        mRebuildLightTex |= decision.rebuildLightSampling;
+        if (decision.action == PhotonMapInvalidation::Action::Restart || (decision.action == PhotonMapInvalidation::Action::Invalidate && !mAccumulateImage))
+            mResetIterations = true;
+        else if (decision.action == PhotonMapInvalidation::Action::Invalidate) {
+            mResetLightGroups |= decision.resetGroups;
+            mResetBounds.insert(mResetBounds.end(), decision.resetBounds.begin(), decision.resetBounds.end());
+        }
+    }
+
     //Reset Frame Count if conditions are met
     if (mResetIterations || mAlwaysResetIterations || is_set(mpScene->getUpdates(), Scene::UpdateFlags::CameraMoved)) {
         mFrameCount = 0;
@@ -165,6 +254,7 @@ void PhotonMapperStochasticHash::execute(RenderContext* pRenderContext, const Re
     if (mNumPhotonsChanged) {
         changeNumPhotons();
         mNumPhotonsChanged = false;
+        mRadiusPilotPending = true;
     }
 
     //reset radius
@@ -212,10 +302,33 @@ void PhotonMapperStochasticHash::execute(RenderContext* pRenderContext, const Re
     // Generate Ray Pass
     //
 
+    //With automatic radii the first iteration is a pilot that counts the stored photons
+    const bool radiusPilot = mAutoRadius && mRadiusPilotPending;
+    const bool statsEnabled = mpStats->isEnabled();
+    if (radiusPilot) mpStats->setEnabled(true);
+
+    mpStats->beginFrame(pRenderContext);
+    mpStats->beginStage(PhotonMapperStats::Stage::Generate);
     generatePhotons(pRenderContext, renderData);
+    mpStats->endStage(PhotonMapperStats::Stage::Generate);
     
+    //A following accumulator has to restart together with the photon mapper
+    if (!mAccumulateImage && mFrameCount == 0) {
+        auto flags = dict.getValue(kRenderPassRefreshFlags, RenderPassRefreshFlags::None);
+        dict[Falcor::kRenderPassRefreshFlags] = flags | Falcor::RenderPassRefreshFlags::RenderOptionsChanged;
+    }
+
     //Gather the photons with short rays
+    mpStats->beginStage(PhotonMapperStats::Stage::Collect);
     collectPhotons(pRenderContext, renderData);
+    mpStats->endStage(PhotonMapperStats::Stage::Collect);
+    mpStats->endFrame(pRenderContext, mCausticRadius, mGlobalRadius);
+    if (radiusPilot) {
+        applyRadiusEstimate(pRenderContext, renderData);
+        mpStats->setEnabled(statsEnabled);
+    }
+    mResetLightGroups = 0;
+    mResetBounds.clear();
     mFrameCount++;
 
     if (mUseStatisticProgressivePM) {
@@ -255,10 +368,11 @@ void PhotonMapperStochasticHash::generatePhotons(RenderContext* pRenderContext,
     mTracerGenerate.pProgram->addDefine("USE_EMISSIVE_LIGHTS", mpScene->useEmissiveLights() ? "1" : "0");
     mTracerGenerate.pProgram->addDefine("USE_ENV_LIGHT", mpScene->useEnvLight() ? "1" : "0");
     mTracerGenerate.pProgram->addDefine("USE_ENV_BACKGROUND", mpScene->useEnvBackground() ? "1" : "0");
-    mTracerGenerate.pProgram->addDefine("ANALYTIC_INV_PDF", std::to_string(mAnalyticInvPdf));
     mTracerGenerate.pProgram->addDefine("INFO_TEXTURE_HEIGHT", std::to_string(kInfoTexHeight));
     mTracerGenerate.pProgram->addDefine("NUM_BUCKETS", std::to_string(mNumBuckets));
     mTracerGenerate.pProgram->addDefine("PHOTON_FACE_NORMAL", mEnableFaceNormalRejection ? "1" : "0");
+    mTracerGenerate.pProgram->addDefine("LIGHT_GROUP_COUNT", std::to_string(getLightGroupCount()));
+    mTracerGenerate.pProgram->addDefine("HASH_BLOCKED_BUCKETS", mBlockedBuckets ? "1" : "0");
     mTracerGenerate.pProgram->addDefine("MULTI_DIFFHIT_CAUSTIC_MAP", mCausticMapMultipleDiffuseHits == 0 ? "0" : "1");
     
     // Prepare program vars. This may trigger shader compilation.
@@ -274,20 +388,26 @@ void PhotonMapperStochasticHash::generatePhotons(RenderContext* pRenderContext,
 
     // Set buffers
     auto var = mTracerGenerate.pVars->getRootVar();
+    mpStats->prepareProgram(mTracerGenerate.pProgram, var);
 
     //PerFrame Constant Buffer
     std::string nameBuf = "PerFrame";
     var[nameBuf]["gFrameCount"] = mFrameCount;
+    var[nameBuf]["gSceneCenter"] = mpScene->getSceneBounds().center();
+    var[nameBuf]["gSceneRadius"] = mpScene->getSceneBounds().radius();
+    var[nameBuf]["gNumEnvPhotons"] = mNumEnvPhotons;
+    var[nameBuf]["gPhotonFluxReference"] = mPhotonFluxReference;
     var[nameBuf]["gCausticRadius"] = mCausticRadius;
     var[nameBuf]["gGlobalRadius"] = mGlobalRadius;
-    var[nameBuf]["gCausticHashScaleFactor"] = 1.f / mCausticRadius;
-    var[nameBuf]["gGlobalHashScaleFactor"] = 1.f / mGlobalRadius;
+    var[nameBuf]["gCausticHashScaleFactor"] = 1.f / (mCellSizeFactor * mCausticRadius);
+    var[nameBuf]["gGlobalHashScaleFactor"] = 1.f / (mCellSizeFactor * mGlobalRadius);
 
     //Constant Buffer is only set when options changed
     if (mSetConstantBuffers) {
         nameBuf = "CB";
         var[nameBuf]["gPRNGDimension"] = dict.keyExists(kRenderPassPRNGDimension) ? dict[kRenderPassPRNGDimension] : 0u;
         var[nameBuf]["gGlobalRejection"] = mRussianRoulette;
+        var[nameBuf]["gFluxRoulette"] = mFluxRoulette;
         var[nameBuf]["gEmissiveScale"] = mIntensityScalar;
         var[nameBuf]["gSpecRoughCutoff"] = mSpecRoughCutoff;
 
@@ -311,6 +431,8 @@ void PhotonMapperStochasticHash::generatePhotons(RenderContext* pRenderContext,
     //Bind light sample tex
     var["gLightSample"] = mLightSampleTex;
     var["gNumPhotonsPerEmissive"] = mPhotonsPerTriangle;
+    var["gNumPhotonsPerAnalytic"] = mPhotonsPerAnalytic;
+    if (mpEnvMapSampler) mpEnvMapSampler->setShaderData(var["gEnvMapSampler"]);
 
     // Get dimensions of ray dispatch.
     const uint2 targetDim = uint2(mPGDispatchX, mMaxDispatchY);
@@ -330,6 +452,7 @@ void PhotonMapperStochasticHash::collectPhotons(RenderContext* pRenderContext, c
         Program::Desc desc;
         desc.addShaderLibrary(kShaderCollectPhoton).csEntry("main").setShaderModel("6_5");
         desc.addTypeConformances(mpScene->getTypeConformances());
+        desc.setCompilerFlags(Shader::CompilerFlags::FloatingPointModePrecise);   //The compensated sums need precise floating-point math
 
         Program::DefineList defines;
         defines.add(mpScene->getSceneDefines());
@@ -338,9 +461,15 @@ void PhotonMapperStochasticHash::collectPhotons(RenderContext* pRenderContext, c
         defines.add("INFO_TEXTURE_HEIGHT", std::to_string(kInfoTexHeight));
         defines.add("NUM_BUCKETS", std::to_string(mNumBuckets));
         defines.add("PHOTON_FACE_NORMAL", mEnableFaceNormalRejection ? "1" : "0");
+        defines.add("HASH_COLLECT_TIGHT", mCollectMode == CollectMode::tight ? "1" : "0");
+        defines.add("HASH_BLOCKED_BUCKETS", mBlockedBuckets ? "1" : "0");
 
         mpCSCollect = ComputePass::create(desc, defines, true);
     }
+
+    // For optional I/O resources, set 'is_valid_<name>' defines to inform the program of which ones it can access.
+    mpCSCollect->getProgram()->addDefines(getValidResourceDefines(kGatherInputChannels, renderData));
+    mpCSCollect->getProgram()->addDefine("LIGHT_GROUP_COUNT", std::to_string(getLightGroupCount()));
     
     // Prepare program vars. This may trigger shader compilation.
 
@@ -352,10 +481,11 @@ void PhotonMapperStochasticHash::collectPhotons(RenderContext* pRenderContext, c
 
     std::string nameBuf = "PerFrame";
     var[nameBuf]["gFrameCount"] = mFrameCount;
+    var[nameBuf]["gAccumulateImage"] = mAccumulateImage;
     var[nameBuf]["gCausticRadius"] = mCausticRadius;
     var[nameBuf]["gGlobalRadius"] = mGlobalRadius;
-    var[nameBuf]["gCausticHashScaleFactor"] = 1.f / mCausticRadius;
-    var[nameBuf]["gGlobalHashScaleFactor"] = 1.f / mGlobalRadius;
+    var[nameBuf]["gCausticHashScaleFactor"] = 1.f / (mCellSizeFactor * mCausticRadius);
+    var[nameBuf]["gGlobalHashScaleFactor"] = 1.f / (mCellSizeFactor * mGlobalRadius);
 
     //Set constant buffer only if changes where made
     if (mSetConstantBuffers) {
@@ -384,8 +514,17 @@ void PhotonMapperStochasticHash::collectPhotons(RenderContext* pRenderContext, c
     };
     //Bind input and output textures
     for (auto& channel : kInputChannels) bindAsTex(channel);
+    for (auto& channel : kGatherInputChannels) var[channel.texname] = renderData.getTexture(channel.name);
     bindAsTex(kOutputChannels[0]);
 
+    prepareAccumulation(renderData.getDefaultTextureDims());
+    const std::vector<uint4> resetRegions = PhotonMapInvalidation::getResetRegions(mResetBounds, mpScene->getCamera()->getViewProjMatrix(), renderData.getDefaultTextureDims());
+    var["PerFrame"]["gResetGroups"] = mFrameCount == 0 ? ~0u : mResetLightGroups;
+    var["PerFrame"]["gResetRegionCount"] = (uint32_t)resetRegions.size();
+    for (size_t i = 0; i < resetRegions.size(); i++) var["PerFrame"]["gResetRegions"][i] = resetRegions[i];
+    var["gAccumulationSum"] = mpAccumulationSum;
+    var["gAccumulationCorr"] = mpAccumulationCorr;
+
     // Get dimensions of ray dispatch.
     const uint2 targetDim = renderData.getDefaultTextureDims();
     FALCOR_ASSERT(targetDim.x > 0 && targetDim.y > 0);
@@ -398,6 +537,51 @@ void PhotonMapperStochasticHash::collectPhotons(RenderContext* pRenderContext, c
     mpCSCollect->execute(pRenderContext, uint3(targetDim, 1));
 }
 
+void PhotonMapperStochasticHash::prepareAccumulation(const uint2 dim)
+{
+    if (!mAccumulateImage) {
+        mpAccumulationSum = nullptr;
+        mpAccumulationCorr = nullptr;
+        return;
+    }
+    //The light groups are stacked vertically
+    const uint32_t height = dim.y * getLightGroupCount();
+    if (mpAccumulationSum && mpAccumulationSum->getWidth() == dim.x && mpAccumulationSum->getHeight() == height) return;
+
+    mpAccumulationSum = Texture::create2D(dim.x, height, ResourceFormat::RGBA32Float, 1, 1, nullptr, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+    mpAccumulationSum->setName("StochHashPPM::AccumulationSum");
+    mpAccumulationCorr = Texture::create2D(dim.x, height, ResourceFormat::RGBA32Float, 1, 1, nullptr, ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess);
+    mpAccumulationCorr->setName("StochHashPPM::AccumulationCorr");
+
+    //New sums hold no iterations
+    mResetLightGroups = ~0u;
+}
+
+uint PhotonMapperStochasticHash::getLightGroupCount() const
+{
+    return mIncrementalUpdates && mAccumulateImage ? (uint)PhotonLightGroup::Count : 1u;
+}
+
+void PhotonMapperStochasticHash::applyRadiusEstimate(RenderContext* pRenderContext, const RenderData& renderData)
+{
+    mRadiusPilotPending = false;
+
+    PhotonMapperStats::Stats stats;
+    if (!mpStats->getStats(stats)) return;
+
+    if (!mpPixelFootprint) mpPixelFootprint = PhotonPixelFootprint::create(mpScene);
+    const float pixelFootprint = mpPixelFootprint->execute(pRenderContext, renderData.getTexture(kInputVBuffer));
+
+    //Scene bounds surface area as an estimate of the lit surface area
+    const AABB& bounds = mpScene->getSceneBounds();
+    PhotonRadiusEstimate radii = estimatePhotonRadii(bounds.area(), bounds.radius(), pixelFootprint, stats.causticPhotons, stats.globalPhotons, mPhotonsPerQuery);
+    mCausticRadiusStart = std::max(radii.causticRadius, kMinPhotonRadius);
+    mGlobalRadiusStart = std::max(radii.globalRadius, kMinPhotonRadius);
+
+    //Restart the iterations with the new radii
+    mOptionsChanged = true;
+}
+
 void PhotonMapperStochasticHash::renderUI(Gui::Widgets& widget)
 {
     float2 dummySpacing = float2(0, 10);
@@ -479,8 +663,19 @@ void PhotonMapperStochasticHash::renderUI(Gui::Widgets& widget)
         widget.tooltip("The start value for the radius of caustic Photons");
         dirty |= widget.var("Global Radius Start", mGlobalRadiusStart, kMinPhotonRadius, FLT_MAX, 0.001f);
         widget.tooltip("The start value for the radius of global Photons");
+        bool estimateRadius = widget.checkbox("Auto Radius", mAutoRadius);
+        widget.tooltip("Estimates the start radii from the scene size, the pixel footprint at the camera hits and the photons stored in a pilot iteration. The estimation runs again when the scene or the number of photons changes");
+        if (mAutoRadius) {
+            estimateRadius |= widget.var("Photons per Query", mPhotonsPerQuery, 1.f, 1024.f, 1.f);
+            widget.tooltip("Targeted number of photons in a query for the radius estimation");
+            estimateRadius |= widget.button("Estimate Radius");
+        }
+        mRadiusPilotPending |= estimateRadius;
+        dirty |= estimateRadius;
         dirty |= widget.var("Russian Roulette", mRussianRoulette, 0.001f, 1.f, 0.001f);
         widget.tooltip("Probabilty that a Global Photon is saved");
+        dirty |= widget.checkbox("Flux Roulette", mFluxRoulette);
+        widget.tooltip("Terminates photon paths and stores global photons with probabilities proportional to their flux relative to the average photon flux. The photons then carry about the same flux, which lowers the noise for the same number of photons. Without it the paths are terminated by their throughput and the global photons are stored with the fixed probability above");
     }
     //Material Settings
     if (auto group = widget.group("Material Options")) {
@@ -497,6 +692,12 @@ void PhotonMapperStochasticHash::renderUI(Gui::Widgets& widget)
     if (auto group = widget.group("Hash Options")) {
         mResetCS |= widget.slider("Bucket size (bits)", mNumBucketBits, 2u, 32u);
         widget.tooltip("Bucket size in 2^x. One bucket takes 48Byte. Total Size = 2^x * 48B. There are two buckets total");
+        mResetCS |= widget.dropdown("Collect Mode", kCollectModeList, (uint32_t&)mCollectMode);
+        widget.tooltip("Cube visits every cell around the query point. Tight only visits the cells the query sphere overlaps");
+        dirty |= widget.var("Cell Size Factor", mCellSizeFactor, 0.25f, 4.f, 0.05f);
+        widget.tooltip("Size of a hash cell relative to the current radius. Larger cells need fewer lookups but share a bucket between more photons");
+        mResetCS |= widget.checkbox("Blocked Buckets", mBlockedBuckets);
+        widget.tooltip("Stores each 2x2x2 block of cells in consecutive buckets, so neighbouring cells of a query share cache lines");
 
         dirty |= mResetCS;
     }
@@ -504,6 +705,10 @@ void PhotonMapperStochasticHash::renderUI(Gui::Widgets& widget)
     if (auto group = widget.group("Light Sample Tex")) {
         mRebuildLightTex |= widget.dropdown("Sample mode", kLightTexModeList, (uint32_t&)mLightTexMode);
         widget.tooltip("Changes photon distribution for the light sampling texture. Also rebuilds the texture.");
+        mRebuildLightTex |= widget.var("Min Photons per Light", mMinPhotonsPerLight, 0u, 1u << 20);
+        widget.tooltip("Minimum number of photons of every analytic light with power, even if its share of the power is smaller");
+        mRebuildLightTex |= widget.var("Max Photons per Light", mMaxPhotonsPerLight, 0u, 1u << 24);
+        widget.tooltip("Maximum number of photons of an analytic light. The rest of its share goes to the other analytic lights. Zero for no cap");
         mRebuildLightTex |= widget.button("Rebuild Light Tex");
         dirty |= mRebuildLightTex;
     }
@@ -515,10 +720,31 @@ void PhotonMapperStochasticHash::renderUI(Gui::Widgets& widget)
         dirty |= widget.checkbox("Disable Caustic Photons", mDisableCausticCollection);
         widget.tooltip("Disables the collection of Caustic Photons. However they will still be generated");
     }
+    if (auto group = widget.group("Statistics")) {
+        mpStats->renderUI(group);
+    }
+
     widget.dummy("", dummySpacing);
     //Reset Iterations
     widget.checkbox("Always Reset Iterations", mAlwaysResetIterations);
     widget.tooltip("Always Resets the Iterations, currently good for moving the camera");
+    dirty |= widget.checkbox("Incremental Updates", mIncrementalUpdates);
+    widget.tooltip("Light and object animations restart only what they change. Analytic, mesh and environment map photons and the direct light are accumulated in separate sums (128 B per pixel), and a changed light restarts its group and the direct light. "
+        "Moved objects restart all groups in the screen region of their old and new bounds, grown by the reset margin. Shadows and reflections cast further than the margin keep the old lighting. "
+        "Without it scene changes other than camera and environment map changes are ignored");
+    if (mIncrementalUpdates) {
+        float restartThreshold = mInvalidation.getRestartThreshold();
+        if (widget.var("Restart Threshold", restartThreshold, 0.f, 1.f, 0.01f)) mInvalidation.setRestartThreshold(restartThreshold);
+        widget.tooltip("Fraction of the scene surface swept by moved objects from which on all iterations are restarted instead of their screen regions");
+        float resetMargin = mInvalidation.getResetMargin();
+        if (widget.var("Reset Margin", resetMargin, 0.f, 10.f, 0.05f)) mInvalidation.setResetMargin(resetMargin);
+        widget.tooltip("Growth of the bounds of moved objects relative to their extent. Larger margins also restart nearby shadows and reflections");
+    }
+    if (widget.checkbox("Accumulate Image", mAccumulateImage)) {
+        dirty = true;
+        requestRecompile();
+    }
+    widget.tooltip("Averages the iterations in the photon image, with compensated sums that do not drift over many iterations. Disable to output the radiance of each iteration, e.g. for an AccumulatePass with a precision mode. The timer does not stop a following accumulator");
     mResetIterations |= widget.button("Reset Iterations");
     widget.tooltip("Resets the iterations");
     dirty |= mResetIterations;
@@ -532,6 +758,9 @@ void PhotonMapperStochasticHash::setScene(RenderContext* pRenderContext, const S
 {
     // Clear data for previous scene.
     resetPhotonMapper();
+    mpEnvMapSampler = nullptr;
+    mpPixelFootprint = nullptr;
+    mRadiusPilotPending = true;
 
     // After changing scene, the raytracing program should to be recreated.
     mTracerGenerate = RayTraceProgramHelper::create();
@@ -594,30 +823,51 @@ void PhotonMapperStochasticHash::getActiveEmissiveTriangles(RenderContext* pRend
 void PhotonMapperStochasticHash::createLightSampleTexture(RenderContext* pRenderContext)
 {
     if (mPhotonsPerTriangle) mPhotonsPerTriangle.reset();
+    if (mPhotonsPerAnalytic) mPhotonsPerAnalytic.reset();
     if (mLightSampleTex) mLightSampleTex.reset();
 
     FALCOR_ASSERT(mpScene);    //Scene has to be set
 
-    auto analyticLights = mpScene->getActiveLights();
     auto lightCollection = mpScene->getLightCollection(pRenderContext);
 
+    //Split the photons between the analytic lights, the emissive triangles and the environment map by their power
+    //Analytic lights are indexed like in the scene. Inactive lights have no power and get no photons
+    const float sceneRadius = mpScene->getSceneBounds().radius();
+    PhotonEmissionPower power;
+    PhotonSourcePower sourcePower;     //Per light power for the scene change tracking
+    std::vector<float> analyticLightPower(mpScene->getLightCount());
+    for (uint i = 0; i < mpScene->getLightCount(); i++) {
+        analyticLightPower[i] = getAnalyticLightPhotonPower(*mpScene->getLight(i), sceneRadius);
+        power.analytic += analyticLightPower[i];
+    }
+    if (lightCollection->getActiveLightCount() > 0) {
+        getActiveEmissiveTriangles(pRenderContext);
+        const auto& meshLightTriangles = lightCollection->getMeshLightTriangles();
+        sourcePower.meshLights.resize(lightCollection->getMeshLights().size());
+        for (uint triIdx : mActiveEmissiveTriangles) {
+            power.emissive += meshLightTriangles[triIdx].flux;
+            sourcePower.meshLights[meshLightTriangles[triIdx].lightIdx] += meshLightTriangles[triIdx].flux * mIntensityScalar;
+        }
+        power.emissive *= mIntensityScalar;
+    }
+    if (mpEnvMapSampler) power.env = getEnvMapPhotonPower(pRenderContext, *mpEnvMapSampler, sceneRadius);
+
+    sourcePower.analytic = analyticLightPower;
+    sourcePower.env = power.env;
+    mInvalidation.reset(sourcePower, PhotonMapInvalidation::getInstanceBounds(*mpScene), mpScene->getSceneBounds());
+
+    PhotonEmissionCounts emissionCounts = splitPhotonsByPower(power, mNumPhotons);
+    uint numEmissivePhotons = emissionCounts.emissive;
+    mNumEnvPhotons = emissionCounts.env;
+
+    //Split the analytic photons between the analytic lights by their power
+    std::vector<uint> numPhotonsPerLight = splitPhotonsByLightPower(analyticLightPower, emissionCounts.analytic, mMinPhotonsPerLight, mMaxPhotonsPerLight);
     uint analyticPhotons = 0;
-    uint numEmissivePhotons = 0;
-    //If there are analytic Lights split number of Photons even between the analytic light and the number of emissive models (approximation of the number of emissive lights)
-    if (analyticLights.size() != 0){
-        uint lightsTotal = static_cast<uint>(analyticLights.size() + lightCollection->getMeshLights().size());
-        float percentAnalytic = static_cast<float>(analyticLights.size()) / static_cast<float>(lightsTotal);
-        analyticPhotons = static_cast<uint>(mNumPhotons * percentAnalytic);
-        analyticPhotons += (uint)analyticLights.size() - (analyticPhotons % (uint) analyticLights.size());  //add it up so every light gets the same number of photons
-        numEmissivePhotons = mNumPhotons - analyticPhotons;
-    }
-    else
-        numEmissivePhotons = mNumPhotons;
+    for (uint photons : numPhotonsPerLight) analyticPhotons += photons;
 
     std::vector<uint> numPhotonsPerTriangle;    //only filled when there are emissive
 
     if (numEmissivePhotons > 0) {
-        getActiveEmissiveTriangles(pRenderContext);
         auto meshLightTriangles = lightCollection->getMeshLightTriangles();
         //Get total area to distribute to get the number of photons per area.
         float totalMode = 0;
@@ -664,20 +914,23 @@ void PhotonMapperStochasticHash::createLightSampleTexture(RenderContext* pRender
         numEmissivePhotons = tmpNumEmissivePhotons;     //get real photon count
     }
 
-    uint totalNumPhotons = numEmissivePhotons + analyticPhotons;
+    uint totalNumPhotons = numEmissivePhotons + analyticPhotons + mNumEnvPhotons;
 
-    //calculate the pdf for analytic and emissive light
-    if (analyticPhotons > 0 && analyticLights.size() > 0) {
-        mAnalyticInvPdf = (static_cast<float>(totalNumPhotons) * static_cast<float>(analyticLights.size())) / static_cast<float>(analyticPhotons);
-    }   
+    //Flux roulette keeps the photons near the average flux of the emitted photons
+    mPhotonFluxReference = totalNumPhotons > 0 ? power.total() / totalNumPhotons : 0.f;
 
     const uint blockSize = 16;
     const uint blockSizeSq = blockSize * blockSize;
 
     //Create texture. The texture fills 16x16 fields with information
     
-    uint xPhotons = (totalNumPhotons / mMaxDispatchY) + 1;
-    xPhotons += (xPhotons % blockSize == 0 && analyticPhotons > 0) ? blockSize : blockSize - (xPhotons % blockSize);  //Fill up so x to 16x16 block with at least 1 block extra when mixed
+    //Every light group starts on a new block. Fill up x so that all blocks fit
+    auto getNumBlocks = [&](uint photons) {
+        return photons > 0 ? (photons / blockSizeSq) + 1 : 0;
+    };
+    uint numBlocks = getNumBlocks(analyticPhotons) + getNumBlocks(numEmissivePhotons) + getNumBlocks(mNumEnvPhotons);
+    uint blocksPerColumn = mMaxDispatchY / blockSize;
+    uint xPhotons = std::max((numBlocks + blocksPerColumn - 1) / blocksPerColumn, 1u) * blockSize;
 
     //Init the texture with the invalid index (zero)
     //Negative indices are analytic and postivie indices are emissive
@@ -695,28 +948,13 @@ void PhotonMapperStochasticHash::createLightSampleTexture(RenderContext* pRender
         return uint2(x, y);
     };
 
-    //Fill analytic lights
-    if (analyticLights.size() > 0) {
-        uint numCurrentLight = 0;
-        uint step = analyticPhotons / static_cast<uint>(analyticLights.size());
-        bool stop = false;
-        for (uint i = 0; i <= analyticPhotons / blockSizeSq; i++) {
-            if (stop) break;
-            for (uint y = 0; y < blockSize; y++) {
-                if (stop) break;
-                for (uint x = 0; x < blockSize; x++) {
-                    if (numCurrentLight >= analyticPhotons) {
-                        stop = true;
-                        break;
-                    }
-                    uint2 idx = getBlockStartingIndex(i);
-                    idx += uint2(x, y);
-                    int32_t lightIdx = static_cast<int32_t>((numCurrentLight / step) + 1);  //current light index + 1
-                    lightIdx *= -1;                                                         //turn it negative as it is a analytic light
-                    lightIdxTex[getIndex(idx)] = lightIdx;
-                    numCurrentLight++;
-                }
-            }
+    //Fill analytic lights. Every light gets a consecutive range of photons
+    uint analyticIdx = 0;
+    for (uint lightIdx = 0; lightIdx < static_cast<uint>(numPhotonsPerLight.size()); lightIdx++) {
+        for (uint i = 0; i < numPhotonsPerLight[lightIdx]; i++, analyticIdx++) {
+            uint2 idx = getBlockStartingIndex(analyticIdx / blockSizeSq);
+            idx += uint2(analyticIdx % blockSize, (analyticIdx % blockSizeSq) / blockSize);
+            lightIdxTex[getIndex(idx)] = -static_cast<int32_t>(lightIdx + 1);      //light index + 1, negative as it is a analytic light
         }
     }
     
@@ -751,8 +989,16 @@ void PhotonMapperStochasticHash::createLightSampleTexture(RenderContext* pRender
             }
         }
     }
-    
 
+    //Fill environment map photons
+    if (mNumEnvPhotons > 0) {
+        uint envStartBlock = getNumBlocks(analyticPhotons) + getNumBlocks(numEmissivePhotons);
+        for (uint i = 0; i < mNumEnvPhotons; i++) {
+            uint2 idx = getBlockStartingIndex(envStartBlock + i / blockSizeSq);
+            idx += uint2(i % blockSize, (i % blockSizeSq) / blockSize);
+            lightIdxTex[getIndex(idx)] = kPhotonEnvLightIndex;
+        }
+    }
 
     //Create texture and Pdf buffer
     mLightSampleTex = Texture::create2D(xPhotons, mMaxDispatchY, ResourceFormat::R32Int, 1, 1, lightIdxTex.data());
@@ -765,6 +1011,12 @@ void PhotonMapperStochasticHash::createLightSampleTexture(RenderContext* pRender
     mPhotonsPerTriangle = Buffer::createStructured(sizeof(uint), static_cast<uint32_t>(numPhotonsPerTriangle.size()), ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, numPhotonsPerTriangle.data());
     mPhotonsPerTriangle->setName("PhotonMapperStochasticHash::mPhotonsPerTriangleEmissive");
 
+    if (numPhotonsPerLight.size() == 0) {
+        numPhotonsPerLight.push_back(0);
+    }
+    mPhotonsPerAnalytic = Buffer::createStructured(sizeof(uint), static_cast<uint32_t>(numPhotonsPerLight.size()), ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, numPhotonsPerLight.data());
+    mPhotonsPerAnalytic->setName("PhotonMapperStochasticHash::mPhotonsPerAnalytic");
+
 
     //Set numPhoton variable
     mPGDispatchX = xPhotons;
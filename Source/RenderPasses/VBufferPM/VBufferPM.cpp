@@ -53,7 +53,7 @@ namespace
     const char kShader[] = "RenderPasses/VBufferPM/VBufferPM.rt.slang";
 
     //Ray Tracing Program data
-    const uint32_t kMaxPayloadSizeBytes = 64u;
+    const uint32_t kMaxPayloadSizeBytes = 96u;
     const uint32_t kMaxRecursionDepth = 2u;
 
 
@@ -75,6 +75,14 @@ namespace
         { "mvec",                 "gMVec",    "Motion vector",                    true /* optional */, ResourceFormat::RG32Float   },
     };
 
+    //Final gather points, one array slice per gather ray. Needed for final gather
+    const ChannelList kGatherOutputChannels =
+    {
+        { "gatherVBuffer",        "gGatherVBuffer",      "Final gather points in packed format",                      true /* optional */, ResourceFormat::Unknown     },
+        { "gatherViewW",          "gGatherViewW",        "World View Direction at the final gather points",           true /* optional */, ResourceFormat::RGBA32Float },
+        { "gatherThp",            "gGatherThp",          "Throughput from the vbuffer hit to the final gather points", true /* optional */, ResourceFormat::RGBA32Float },
+    };
+
     // UI variables.
     const Gui::DropdownList kSamplePatternList =
     {
@@ -93,6 +101,11 @@ namespace
     const char kUseAlphaTest[] = "useAlphaTest";
     const char kAdjustShadingNormals[] = "adjustShadingNormals";
     const char kSpecRoughCutoff[] = "specRoughCutoff";
+    const char kFinalGather[] = "finalGather";
+    const char kAdaptiveFinalGather[] = "adaptiveFinalGather";
+    const char kFinalGatherSamples[] = "finalGatherSamples";
+    const char kFinalGatherMinSamples[] = "finalGatherMinSamples";
+    const char kFinalGatherMaxSamples[] = "finalGatherMaxSamples";
 }
 
 VBufferPM::SharedPtr VBufferPM::create(RenderContext* pRenderContext, const Dictionary& dict)
@@ -111,6 +124,7 @@ VBufferPM::VBufferPM(const Dictionary& dict)
 
 void VBufferPM::parseDictionary(const Dictionary& dict)
 {
+    auto budgetOptions = mFinalGatherBudget.getOptions();
     for (const auto& [key, value] : dict)
     {
         if (key == kOutputSize) mOutputSizeSelection = value;
@@ -120,8 +134,14 @@ void VBufferPM::parseDictionary(const Dictionary& dict)
         else if (key == kUseAlphaTest) mUseAlphaTest = value;
         else if (key == kAdjustShadingNormals) mAdjustShadingNormals = value;
         else if (key == kSpecRoughCutoff) mSpecRoughCutoff = value;
+        else if (key == kFinalGather) mFinalGather = value;
+        else if (key == kAdaptiveFinalGather) mAdaptiveFinalGather = value;
+        else if (key == kFinalGatherSamples) budgetOptions.samplesPerPixel = value;
+        else if (key == kFinalGatherMinSamples) budgetOptions.minSamples = value;
+        else if (key == kFinalGatherMaxSamples) budgetOptions.maxSamples = value;
         // TODO: Check for unparsed fields
     }
+    mFinalGatherBudget.setOptions(budgetOptions);
 }
 
 Dictionary VBufferPM::getScriptingDictionary()
@@ -134,6 +154,12 @@ Dictionary VBufferPM::getScriptingDictionary()
     dict[kSampleCount] = mSampleCount;
     dict[kUseAlphaTest] = mUseAlphaTest;
     dict[kAdjustShadingNormals] = mAdjustShadingNormals;
+    dict[kFinalGather] = mFinalGather;
+    dict[kAdaptiveFinalGather] = mAdaptiveFinalGather;
+    const auto& budgetOptions = mFinalGatherBudget.getOptions();
+    dict[kFinalGatherSamples] = budgetOptions.samplesPerPixel;
+    dict[kFinalGatherMinSamples] = budgetOptions.minSamples;
+    dict[kFinalGatherMaxSamples] = budgetOptions.maxSamples;
 
     return dict;
 }
@@ -150,6 +176,14 @@ RenderPassReflection VBufferPM::reflect(const CompileData& compileData)
     addRenderPassOutputs(reflector, kOutputChannels);
     //add the extra outputs
     addRenderPassOutputs(reflector, kExtraOutputChannels);
+    //add the gather points. With final gather there is one slice per gather ray, otherwise the first hit is the only gather point
+    const uint32_t gatherSlices = mFinalGather ? mFinalGatherBudget.getOptions().maxSamples : 1;
+    for (const auto& channel : kGatherOutputChannels)
+    {
+        auto& tex = reflector.addOutput(channel.name, channel.desc).bindFlags(Resource::BindFlags::UnorderedAccess).texture2D(sz.x, sz.y, 1, 1, gatherSlices);
+        tex.format(channel.format == ResourceFormat::Unknown ? mVBufferFormat : channel.format);
+        tex.flags(RenderPassReflection::Field::Flags::Optional);
+    }
 
     return reflector;
 }
@@ -177,6 +211,7 @@ void VBufferPM::execute(RenderContext* pRenderContext, const RenderData& renderD
     pRenderContext->clearUAV(pVBuff->getUAV().get(), float4(0.f));
     for (const auto& channel : kOutputChannels) clear(channel);
     for (const auto& channel : kExtraOutputChannels) clear(channel);
+    for (const auto& channel : kGatherOutputChannels) clear(channel);
 
 
     //If we have no scene just return
@@ -189,6 +224,14 @@ void VBufferPM::execute(RenderContext* pRenderContext, const RenderData& renderD
     if (is_set(mpScene->getUpdates(), Scene::UpdateFlags::GeometryChanged))
         throw std::runtime_error("This render pass does not support scene geometry changes. Aborting.");
 
+    //Final gather writes its gather points to the gather outputs. Without them the collect passes would count the gathered light twice
+    bool gatherOutputsBound = true;
+    for (const auto& channel : kGatherOutputChannels) gatherOutputsBound &= renderData.getTexture(channel.name) != nullptr;
+    const bool finalGather = mFinalGather && gatherOutputsBound;
+    if (mFinalGather && !gatherOutputsBound && !mGatherOutputsWarned)
+        logWarning("VBufferPM: Final gather needs the 'gatherVBuffer', 'gatherViewW' and 'gatherThp' outputs to be connected to the photon mapper. Final gather is disabled.");
+    mGatherOutputsWarned = mFinalGather && !gatherOutputsBound;
+
     //On start set the jitters sample generator
     if (mFrameCount == 0)
         updateSamplePattern();
@@ -202,7 +245,11 @@ void VBufferPM::execute(RenderContext* pRenderContext, const RenderData& renderD
     // Specialize the program
     // These defines should not modify the program vars. Do not trigger program vars re-creation.
     mTracer.pProgram->addDefines(getValidResourceDefines(kExtraOutputChannels, renderData));    //Valid defines for extra channels
+    mTracer.pProgram->addDefines(getValidResourceDefines(kGatherOutputChannels, renderData));
     mTracer.pProgram->addDefine("COMPUTE_DEPTH_OF_FIELD", mComputeDOF ? "1" : "0");
+    mTracer.pProgram->addDefine("FINAL_GATHER", finalGather ? "1" : "0");
+    mTracer.pProgram->addDefine("USE_ENV_LIGHT", mpScene->useEnvLight() ? "1" : "0");
+    mTracer.pProgram->addDefine("USE_ENV_BACKGROUND", mpScene->useEnvBackground() ? "1" : "0");
     // Prepare program vars. This may trigger shader compilation.
     // The program should have all necessary defines set at this point.
 
@@ -215,6 +262,14 @@ void VBufferPM::execute(RenderContext* pRenderContext, const RenderData& renderD
     std::string bufName = "PerFrame";
     var[bufName]["gFrameCount"] = mFrameCount;
 
+    if (finalGather)
+    {
+        prepareFinalGather(pRenderContext);
+        var[bufName]["gFinalGatherFrameCount"] = mFinalGatherFrameCount;
+        var[bufName]["gFinalGatherScale"] = mAdaptiveFinalGather ? mFinalGatherBudget.getScale() : mFinalGatherBudget.getTargetSamplesPerPixel();
+        var["gGatherStats"] = mpGatherStats;
+    }
+
     if (mResetConstantBuffers) {
         bufName = "CB";
         var[bufName]["gMaxRecursion"] = mRecursionDepth;
@@ -222,6 +277,11 @@ void VBufferPM::execute(RenderContext* pRenderContext, const RenderData& renderD
         var[bufName]["gAdjustShadingNormals"] = mAdjustShadingNormals;
         var[bufName]["gUseAlphaTest"] = mUseAlphaTest;
         var[bufName]["gUseRandomPixelPosCamera"] = mCameraUseRandomSample;
+        const auto& budgetOptions = mFinalGatherBudget.getOptions();
+        var[bufName]["gAdaptiveFinalGather"] = mAdaptiveFinalGather;
+        var[bufName]["gFinalGatherMinSamples"] = budgetOptions.minSamples;
+        var[bufName]["gFinalGatherMaxSamples"] = budgetOptions.maxSamples;
+        var[bufName]["gFinalGatherImportanceFloor"] = budgetOptions.importanceFloor;
     }
 
     // Bind Output Textures. These needs to be done per-frame as the buffers may change anytime.
@@ -236,6 +296,7 @@ void VBufferPM::execute(RenderContext* pRenderContext, const RenderData& renderD
     var[kVBufferShaderName] = renderData[kVBufferName]->asTexture();
     for (auto& output : kOutputChannels) bindAsTex(output);
     for (auto& output : kExtraOutputChannels) bindAsTex(output);
+    for (auto& output : kGatherOutputChannels) bindAsTex(output);
 
     // Get dimensions of ray dispatch.
     FALCOR_ASSERT(mFrameDim.x > 0 && mFrameDim.y > 0);
@@ -243,6 +304,12 @@ void VBufferPM::execute(RenderContext* pRenderContext, const RenderData& renderD
     // Trace the Scene
     mpScene->raytrace(pRenderContext, mTracer.pProgram.get(), mTracer.pVars, uint3(mFrameDim, 1));
 
+    if (finalGather)
+    {
+        if (mAdaptiveFinalGather) reduceFinalGatherStats(pRenderContext);
+        mFinalGatherFrameCount++;
+    }
+
     mFrameCount++;
     if (mResetConstantBuffers) mResetConstantBuffers = false;
 }
@@ -255,6 +322,7 @@ void VBufferPM::setScene(RenderContext* pRenderContext, const Scene::SharedPtr&
     mResetConstantBuffers = true;
     mpScene = pScene;
     mFrameCount = 0;
+    mpGatherStats = nullptr;
 
     if (mpScene) {
         if (mpScene->hasGeometryType(Scene::GeometryType::Custom))
@@ -271,16 +339,21 @@ void VBufferPM::setScene(RenderContext* pRenderContext, const Scene::SharedPtr&
         desc.setMaxAttributeSize(pScene->getRaytracingMaxAttributeSize());
         desc.setMaxTraceRecursionDepth(kMaxRecursionDepth);
 
-        mTracer.pBindingTable = RtBindingTable::create(1, 1, mpScene->getGeometryCount());
+        //Ray types: camera path, final gather path, shadow
+        mTracer.pBindingTable = RtBindingTable::create(3, 3, mpScene->getGeometryCount());
         auto& sbt = mTracer.pBindingTable;
         //sbt->setRayGen(desc.addRayGen("rayGen", mpScene->getMaterialSystem()->getTypeConformances()));
         sbt->setRayGen(desc.addRayGen("rayGen"));
         sbt->setMiss(0, desc.addMiss("miss"));
+        sbt->setMiss(1, desc.addMiss("gatherMiss"));
+        sbt->setMiss(2, desc.addMiss("shadowMiss"));
 
         //TODO: Support more of Falcors geometry types
 
         if (mpScene->hasGeometryType(Scene::GeometryType::TriangleMesh)) {
             sbt->setHitGroup(0, mpScene->getGeometryIDs(Scene::GeometryType::TriangleMesh), desc.addHitGroup("closestHit", "anyHit"));
+            sbt->setHitGroup(1, mpScene->getGeometryIDs(Scene::GeometryType::TriangleMesh), desc.addHitGroup("gatherClosestHit", "gatherAnyHit"));
+            sbt->setHitGroup(2, mpScene->getGeometryIDs(Scene::GeometryType::TriangleMesh), desc.addHitGroup("", "shadowAnyHit"));
         }
 
 
@@ -327,6 +400,36 @@ void VBufferPM::renderUI(Gui::Widgets& widget)
 
     mOptionsChanged |= widget.checkbox("Adjust Shading Normals", mAdjustShadingNormals);
     widget.tooltip("Adjusts the shading normals to prevent invalid pixels at the edge of specular/transparent materials");
+
+    if (widget.checkbox("Final Gather", mFinalGather))
+    {
+        mOptionsChanged = true;
+        requestRecompile();     //Size of the gather outputs
+    }
+    widget.tooltip("Traces BSDF sampled rays from the first diffuse hit and gathers the global photons at all of their hits. The caustic photons are still gathered at the first hit.\n"
+                   "Direct light from analytic lights is evaluated at the first hit with a shadow ray.\n"
+                   "Needs the gather outputs to be connected to the photon mapper.");
+    if (mFinalGather)
+    {
+        auto budgetOptions = mFinalGatherBudget.getOptions();
+        bool budgetChanged = widget.var("Gather Samples", budgetOptions.samplesPerPixel, 1.f, 64.f, 0.5f);
+        widget.tooltip("Average number of final gather rays per pixel. Every hit is used as gather point.");
+        budgetChanged |= widget.checkbox("Adaptive Gather Samples", mAdaptiveFinalGather);
+        widget.tooltip("Distributes the gather rays by the relative variance of their throughput, e.g. more rays where many rays leave the scene.");
+        if (mAdaptiveFinalGather)
+        {
+            budgetChanged |= widget.var("Min Gather Samples", budgetOptions.minSamples, 1u, 64u);
+            budgetChanged |= widget.var("Max Gather Samples", budgetOptions.maxSamples, 1u, 64u);
+            widget.text("Average gather samples: " + std::to_string(mFinalGatherBudget.getRealizedSamplesPerPixel()));
+        }
+        if (budgetChanged)
+        {
+            const uint32_t maxSamples = mFinalGatherBudget.getOptions().maxSamples;
+            mFinalGatherBudget.setOptions(budgetOptions);
+            if (mFinalGatherBudget.getOptions().maxSamples != maxSamples) requestRecompile();     //Size of the gather outputs
+            mOptionsChanged = true;
+        }
+    }
 }
 
 void VBufferPM::prepareVars()
@@ -346,6 +449,44 @@ void VBufferPM::prepareVars()
     mpSampleGenerator->setShaderData(var);
 }
 
+void VBufferPM::prepareFinalGather(RenderContext* pRenderContext)
+{
+    //(Re)create the statistics if the frame size changed
+    if (!mpGatherStats || mpGatherStats->getWidth() != mFrameDim.x || mpGatherStats->getHeight() != mFrameDim.y)
+    {
+        mpGatherStats = Texture::create2D(mFrameDim.x, mFrameDim.y, ResourceFormat::RGBA32Float, 1, 1, nullptr, Resource::BindFlags::ShaderResource | Resource::BindFlags::UnorderedAccess);
+        mpGatherStats->setName("VBufferPM::GatherStats");
+        pRenderContext->clearUAV(mpGatherStats->getUAV().get(), float4(0.f));
+        mFinalGatherBudget.reset();
+        mFinalGatherFrameCount = 0;
+        mGatherStatsAvailable = false;
+    }
+
+    if (!mAdaptiveFinalGather || !mGatherStatsAvailable) return;
+
+    //Statistics of the last frame. Sums of the importance (z) and of the sample counts (w)
+    mpGatherStatsFence->syncCpu();
+    const float4 sums = *reinterpret_cast<const float4*>(mpGatherStatsResult->map(Buffer::MapType::Read));
+    mpGatherStatsResult->unmap();
+    mGatherStatsAvailable = false;
+
+    mFinalGatherBudget.update(sums.z, sums.w, uint64_t(mFrameDim.x) * mFrameDim.y);
+}
+
+void VBufferPM::reduceFinalGatherStats(RenderContext* pRenderContext)
+{
+    if (!mpGatherStatsReduction)
+    {
+        mpGatherStatsReduction = ComputeParallelReduction::create();
+        mpGatherStatsResult = Buffer::create(sizeof(float4), ResourceBindFlags::None, Buffer::CpuAccess::Read);
+        mpGatherStatsFence = GpuFence::create();
+    }
+
+    mpGatherStatsReduction->execute<float4>(pRenderContext, mpGatherStats, ComputeParallelReduction::Type::Sum, nullptr, mpGatherStatsResult);
+    mpGatherStatsFence->gpuSignal(pRenderContext->getLowLevelData()->getCommandQueue());
+    mGatherStatsAvailable = true;
+}
+
 static CPUSampleGenerator::SharedPtr createSamplePattern(uint32_t type, uint32_t sampleCount)
 {
     switch (type)
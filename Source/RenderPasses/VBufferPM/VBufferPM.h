@@ -28,6 +28,8 @@
 #pragma once
 #include "Falcor.h"
 #include "Utils/Sampling/SampleGenerator.h"
+#include "Utils/Algorithm/ComputeParallelReduction.h"
+#include "Rendering/Utils/GatherSampleBudget.h"
 #include "RenderGraph/RenderPassLibrary.h"
 #include "RenderGraph/RenderPassHelpers.h"
 
@@ -86,6 +88,14 @@ private:
     */
     void updateSamplePattern();
 
+    /** Creates the final gather statistics and updates the sample budget from the statistics of the last frame
+    */
+    void prepareFinalGather(RenderContext* pRenderContext);
+
+    /** Starts the readback of the final gather statistics of the current frame
+    */
+    void reduceFinalGatherStats(RenderContext* pRenderContext);
+
 
 
     // Internal state
@@ -104,6 +114,9 @@ private:
     bool                        mUseAlphaTest = true;                                           ///< Enable alpha test.
     bool                        mAdjustShadingNormals = true;                                   ///< Adjust shading normals.
     bool                        mComputeDOF = false;                                            ///< Adjust shading normals.
+    bool                        mFinalGather = false;                                           ///< Gather photons one BSDF sampled bounce after the first diffuse hit.
+    bool                        mAdaptiveFinalGather = true;                                    ///< Distribute the final gather rays by the variance of their weights.
+    GatherSampleBudget          mFinalGatherBudget;                                             ///< Controls the number of final gather rays per pixel.
 
      // Runtime data
     uint                        mFrameCount = 0;            ///< Frame count since last Reset
@@ -113,6 +126,15 @@ private:
     uint2                       mFrameDim = { 0,0 };
     bool                        mCameraUseRandomSample = false;
 
+    //Final gather
+    Texture::SharedPtr                  mpGatherStats;                  ///< Per pixel gather weight moments, importance and sample count.
+    ComputeParallelReduction::SharedPtr mpGatherStatsReduction;
+    Buffer::SharedPtr                   mpGatherStatsResult;            ///< Image-wide sums of mpGatherStats. Read back one frame later.
+    GpuFence::SharedPtr                 mpGatherStatsFence;
+    bool                                mGatherStatsAvailable = false;
+    uint                                mFinalGatherFrameCount = 0;     ///< Frame count since the gather statistics were reset.
+    bool                                mGatherOutputsWarned = false;   ///< Final gather is enabled but the gather outputs are not connected. Logged once.
+
     //Ray Tracing Program
     struct RayTraceProgramHelper
     {
@@ -0,0 +1,226 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderGraph/RenderGraphCompilePlan.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        using Desc = ResourceMemoryPlanner::ResourceDesc;
+
+        const uint2 kDims = { 1920, 1080 };
+        const ResourceFormat kFormat = ResourceFormat::RGBA32Float;
+
+        Desc texture2D(uint2 dims, ResourceFormat format)
+        {
+            Desc desc;
+            desc.width = dims.x;
+            desc.height = dims.y;
+            desc.format = format;
+            desc.bindFlags = ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess;
+            return desc;
+        }
+
+        struct ChainSettings
+        {
+            uint2 dims = kDims;
+            ResourceFormat format = kFormat;
+            ResourceFormat bFormat = ResourceFormat::RGBA16Float;
+            bool withD = false;
+        };
+
+        // Record the compilation of the chain A -> B -> C (-> D), where A has a fixed size internal lookup table.
+        RenderGraphCompilePlan compileChain(const ChainSettings& settings)
+        {
+            RenderGraphCompilePlan plan(settings.dims, settings.format);
+
+            RenderPassReflection a;
+            a.addOutput("color", "");
+            a.addInternal("lut", "").format(ResourceFormat::R32Float).texture2D(64, 64);
+            RenderPassReflection b;
+            b.addInput("src", "");
+            b.addOutput("dst", "").format(settings.bFormat);
+            RenderPassReflection c;
+            c.addInput("src", "");
+            c.addOutput("dst", "");
+
+            plan.setPassReflection("A", a);
+            plan.setPassReflection("B", b);
+            plan.setPassReflection("C", c);
+
+            // Connected resources as seen by RenderPass::compile().
+            RenderPassReflection aConnected;
+            aConnected.addOutput("color", "");
+            RenderPassReflection bConnected;
+            bConnected.addInput("src", "");
+            bConnected.addOutput("dst", "").format(settings.bFormat);
+            RenderPassReflection cConnected;
+            cConnected.addInput("src", "").format(settings.bFormat);
+
+            plan.setPassCompileData("A", aConnected);
+            plan.setPassCompileData("B", bConnected);
+            plan.setPassCompileData("C", cConnected);
+
+            plan.addResource("A.color", texture2D(settings.dims, settings.format));
+            plan.addResource("A.lut", texture2D({ 64, 64 }, ResourceFormat::R32Float));
+            plan.addResource("B.dst", texture2D(settings.dims, settings.bFormat));
+            plan.addResource("C.dst", texture2D(settings.dims, settings.format));
+
+            if (settings.withD)
+            {
+                RenderPassReflection d;
+                d.addOutput("dst", "");
+                plan.setPassReflection("D", d);
+                plan.setPassCompileData("D", d);
+                plan.addResource("D.dst", texture2D(settings.dims, settings.format));
+            }
+
+            return plan;
+        }
+
+        using Names = std::vector<std::string>;
+    }
+
+    CPU_TEST(RenderGraphCompilePlanInitial)
+    {
+        auto plan = compileChain({});
+        auto diff = plan.diff(nullptr);
+
+        EXPECT(diff.reflectedPasses == Names({ "A", "B", "C" }));
+        EXPECT(diff.compiledPasses == Names({ "A", "B", "C" }));
+        EXPECT(diff.unchangedPasses.empty());
+        EXPECT(diff.removedPasses.empty());
+        EXPECT(diff.reusedResources.empty());
+        EXPECT(diff.createdResources == Names({ "A.color", "A.lut", "B.dst", "C.dst" }));
+        EXPECT(diff.releasedResources.empty());
+    }
+
+    CPU_TEST(RenderGraphCompilePlanUnchanged)
+    {
+        auto previous = compileChain({});
+        auto plan = compileChain({});
+        auto diff = plan.diff(&previous);
+
+        EXPECT(diff.reflectedPasses.empty());
+        EXPECT(diff.compiledPasses.empty());
+        EXPECT(diff.unchangedPasses == Names({ "A", "B", "C" }));
+        EXPECT(diff.reusedResources == Names({ "A.color", "A.lut", "B.dst", "C.dst" }));
+        EXPECT(diff.createdResources.empty());
+        EXPECT(diff.releasedResources.empty());
+    }
+
+    CPU_TEST(RenderGraphCompilePlanChangedPass)
+    {
+        auto previous = compileChain({});
+
+        // Marking a pass changed without affecting its outputs only compiles that pass.
+        {
+            auto plan = compileChain({});
+            plan.markPassChanged("B");
+            auto diff = plan.diff(&previous);
+            EXPECT(diff.reflectedPasses == Names({ "B" }));
+            EXPECT(diff.compiledPasses == Names({ "B" }));
+            EXPECT(diff.unchangedPasses == Names({ "A", "C" }));
+            EXPECT_EQ(diff.reusedResources.size(), 4u);
+        }
+
+        // Changing the output format of B also compiles the connected pass C, without reflecting it.
+        {
+            ChainSettings settings;
+            settings.bFormat = ResourceFormat::RGBA32Float;
+            auto plan = compileChain(settings);
+            plan.markPassChanged("B");
+            EXPECT(plan.needsReflect(&previous, "B"));
+            EXPECT(!plan.needsReflect(&previous, "C"));
+            EXPECT(plan.needsCompile(&previous, "C"));
+
+            auto diff = plan.diff(&previous);
+            EXPECT(diff.reflectedPasses == Names({ "B" }));
+            EXPECT(diff.compiledPasses == Names({ "B", "C" }));
+            EXPECT(diff.unchangedPasses == Names({ "A" }));
+            EXPECT(diff.reusedResources == Names({ "A.color", "A.lut", "C.dst" }));
+            EXPECT(diff.createdResources == Names({ "B.dst" }));
+        }
+    }
+
+    CPU_TEST(RenderGraphCompilePlanResize)
+    {
+        auto previous = compileChain({});
+
+        ChainSettings settings;
+        settings.dims = { 1280, 720 };
+        auto plan = compileChain(settings);
+        auto diff = plan.diff(&previous);
+
+        // All passes depend on the default properties, but the fixed size table is kept.
+        EXPECT(diff.reflectedPasses == Names({ "A", "B", "C" }));
+        EXPECT(diff.compiledPasses == Names({ "A", "B", "C" }));
+        EXPECT(diff.reusedResources == Names({ "A.lut" }));
+        EXPECT(diff.createdResources == Names({ "A.color", "B.dst", "C.dst" }));
+    }
+
+    CPU_TEST(RenderGraphCompilePlanTopology)
+    {
+        ChainSettings settings;
+        settings.withD = true;
+        auto previous = compileChain(settings);
+
+        // Removing a pass releases its resources and leaves the others untouched.
+        {
+            auto plan = compileChain({});
+            auto diff = plan.diff(&previous);
+            EXPECT(diff.unchangedPasses == Names({ "A", "B", "C" }));
+            EXPECT(diff.removedPasses == Names({ "D" }));
+            EXPECT(diff.releasedResources == Names({ "D.dst" }));
+        }
+
+        // Adding a pass only reflects and compiles the new pass.
+        {
+            auto chain = compileChain({});
+            auto plan = compileChain(settings);
+            auto diff = plan.diff(&chain);
+            EXPECT(diff.reflectedPasses == Names({ "D" }));
+            EXPECT(diff.compiledPasses == Names({ "D" }));
+            EXPECT(diff.createdResources == Names({ "D.dst" }));
+        }
+
+        // Passes without compile data, such as generated passes, are reflected but not compiled.
+        {
+            auto plan = compileChain({});
+            RenderPassReflection resolve;
+            resolve.addInput("src", "");
+            resolve.addOutput("dst", "");
+            plan.setPassReflection("A.color-ResolvePass", resolve);
+            plan.markPassChanged("A.color-ResolvePass");
+            auto diff = plan.diff(&previous);
+            EXPECT(diff.reflectedPasses == Names({ "A.color-ResolvePass" }));
+            EXPECT(diff.compiledPasses.empty());
+        }
+    }
+}
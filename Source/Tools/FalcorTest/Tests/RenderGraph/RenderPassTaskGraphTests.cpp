@@ -0,0 +1,232 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderGraph/RenderPassTaskGraph.h"
+#include "Core/Errors.h"
+#include "Utils/Logger.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <atomic>
+#include <random>
+#include <stdexcept>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Stand-in for a render pass: a name, the passes it depends on and the CPU time its preparation takes.
+        struct MockPass
+        {
+            std::string name;
+            std::vector<uint32_t> dependencies;
+            double workTime = 0.0; ///< Preparation time in milliseconds.
+        };
+
+        RenderPassTaskGraph createTaskGraph(const std::vector<MockPass>& passes)
+        {
+            RenderPassTaskGraph graph;
+            for (uint32_t i = 0; i < passes.size(); i++)
+            {
+                graph.addPass(passes[i].name);
+                for (uint32_t d : passes[i].dependencies) graph.addDependency(i, d);
+            }
+            return graph;
+        }
+
+        void busyWait(double ms)
+        {
+            auto start = CpuTimer::getCurrentTimePoint();
+            while (CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) < ms) {}
+        }
+
+        // Run the task graph and record when each task started and finished, on a global sequence.
+        // Returns false if any pass started before all its dependencies finished or didn't run exactly once.
+        bool runAndCheckOrder(const RenderPassTaskGraph& graph, const std::vector<MockPass>& passes, bool parallel)
+        {
+            std::atomic<uint32_t> sequence = 0;
+            std::vector<std::atomic<uint32_t>> runCount(passes.size());
+            std::vector<uint32_t> started(passes.size()), finished(passes.size());
+
+            graph.run([&](uint32_t i)
+            {
+                started[i] = sequence++;
+                busyWait(passes[i].workTime);
+                runCount[i]++;
+                finished[i] = sequence++;
+            }, parallel);
+
+            for (uint32_t i = 0; i < passes.size(); i++)
+            {
+                if (runCount[i] != 1) return false;
+                for (uint32_t d : passes[i].dependencies)
+                {
+                    if (finished[d] > started[i]) return false;
+                }
+            }
+            return true;
+        }
+
+        // A frame similar to a path tracer graph with denoising and post-processing.
+        // Passes 1 to 6 only depend on the G-buffer and can be prepared concurrently.
+        std::vector<MockPass> createFrameGraph(double workTime)
+        {
+            return
+            {
+                { "GBuffer", {}, workTime },
+                { "ShadowMap", { 0 }, workTime },
+                { "AmbientOcclusion", { 0 }, workTime },
+                { "PathTracer", { 0 }, workTime },
+                { "Reflections", { 0 }, workTime },
+                { "MotionVectors", { 0 }, workTime },
+                { "Sky", { 0 }, workTime },
+                { "Composite", { 1, 2, 3, 4, 6 }, workTime },
+                { "Denoiser", { 5, 7 }, workTime },
+                { "ToneMapper", { 8 }, workTime },
+            };
+        }
+    }
+
+    CPU_TEST(RenderPassTaskGraphLevels)
+    {
+        // Diamond A -> (B, C) -> D, with an independent pass E.
+        std::vector<MockPass> passes = { { "A", {} }, { "B", { 0 } }, { "C", { 0 } }, { "E", {} }, { "D", { 1, 2 } } };
+        auto graph = createTaskGraph(passes);
+
+        auto levels = graph.getLevels();
+        EXPECT_EQ(levels.size(), 3u);
+        if (levels.size() != 3) return;
+        EXPECT(levels[0] == std::vector<uint32_t>({ 0, 3 }));
+        EXPECT(levels[1] == std::vector<uint32_t>({ 1, 2 }));
+        EXPECT(levels[2] == std::vector<uint32_t>({ 4 }));
+
+        // Duplicate dependencies are ignored.
+        graph.addDependency(4, 1);
+        EXPECT_EQ(graph.getDependencies(4).size(), 2u);
+
+        // Passes can only depend on passes executed before them.
+        bool threw = false;
+        try
+        {
+            graph.addDependency(1, 4);
+        }
+        catch (const ArgumentError&)
+        {
+            threw = true;
+        }
+        EXPECT(threw);
+    }
+
+    CPU_TEST(RenderPassTaskGraphOrdering)
+    {
+        std::mt19937 rng(7);
+
+        for (uint32_t iteration = 0; iteration < 20; iteration++)
+        {
+            // Random DAG where every pass depends on up to three earlier passes.
+            std::vector<MockPass> passes(64);
+            for (uint32_t i = 0; i < passes.size(); i++)
+            {
+                passes[i].name = "Pass" + std::to_string(i);
+                uint32_t dependencyCount = i > 0 ? rng() % 4 : 0;
+                for (uint32_t d = 0; d < dependencyCount; d++) passes[i].dependencies.push_back(uint32_t(rng() % i));
+                passes[i].workTime = (rng() % 100) * 1e-3;
+            }
+            auto graph = createTaskGraph(passes);
+
+            EXPECT(runAndCheckOrder(graph, passes, true)) << "iteration " << iteration;
+            EXPECT(runAndCheckOrder(graph, passes, false)) << "iteration " << iteration;
+        }
+    }
+
+    CPU_TEST(RenderPassTaskGraphChangeAfterRun)
+    {
+        // The levels of the first run are reused until the graph changes.
+        std::vector<MockPass> passes = { { "A", {} }, { "B", {} }, { "C", {} } };
+        auto graph = createTaskGraph(passes);
+        EXPECT(runAndCheckOrder(graph, passes, true));
+
+        passes[2].dependencies = { 1 };
+        graph.addDependency(2, 1);
+        passes.push_back({ "D", { 2 } });
+        graph.addPass("D");
+        graph.addDependency(3, 2);
+        EXPECT(runAndCheckOrder(graph, passes, true));
+        EXPECT_EQ(graph.getLevels().size(), 3u);
+    }
+
+    CPU_TEST(RenderPassTaskGraphException)
+    {
+        std::vector<MockPass> passes = { { "A", {} }, { "B", { 0 } }, { "C", { 0 } }, { "D", { 1, 2 } } };
+        auto graph = createTaskGraph(passes);
+
+        std::vector<std::atomic<uint32_t>> runCount(passes.size());
+        bool threw = false;
+        try
+        {
+            graph.run([&](uint32_t i)
+            {
+                runCount[i]++;
+                if (i == 1) throw std::runtime_error("Failed to prepare pass");
+            });
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+
+        // Passes depending on the failed level never run.
+        EXPECT(threw);
+        EXPECT_EQ(runCount[0].load(), 1u);
+        EXPECT_EQ(runCount[1].load(), 1u);
+        EXPECT_EQ(runCount[3].load(), 0u);
+    }
+
+    CPU_TEST(RenderPassTaskGraphSpeedup)
+    {
+        const double kWorkTime = 2.0;
+        auto passes = createFrameGraph(kWorkTime);
+        auto graph = createTaskGraph(passes);
+
+        const uint32_t kFrameCount = 10;
+        auto runFrames = [&](bool parallel)
+        {
+            bool ordered = true;
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            for (uint32_t frame = 0; frame < kFrameCount; frame++) ordered = runAndCheckOrder(graph, passes, parallel) && ordered;
+            return std::make_pair(CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint()) / kFrameCount, ordered);
+        };
+
+        auto [serialTime, serialOrdered] = runFrames(false);
+        auto [parallelTime, parallelOrdered] = runFrames(true);
+        EXPECT(serialOrdered);
+        EXPECT(parallelOrdered);
+
+        // The critical path is 5 passes long, which bounds the achievable speedup to 2x for this graph.
+        logInfo("RenderPassTaskGraphSpeedup: {} passes in {} levels, serial {:.2f} ms, parallel {:.2f} ms per frame ({:.2f}x)",
+            passes.size(), graph.getLevels().size(), serialTime, parallelTime, serialTime / parallelTime);
+    }
+}
@@ -0,0 +1,202 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "RenderGraph/ResourceMemoryPlanner.h"
+#include "Utils/Logger.h"
+#include "Utils/StringUtils.h"
+#include <algorithm>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        using Desc = ResourceMemoryPlanner::ResourceDesc;
+
+        Desc texture2D(uint32_t width, uint32_t height, ResourceFormat format, ResourceBindFlags bindFlags = ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess)
+        {
+            Desc desc;
+            desc.width = width;
+            desc.height = height;
+            desc.format = format;
+            desc.bindFlags = bindFlags;
+            return desc;
+        }
+
+        struct Lifetime
+        {
+            uint32_t firstUse;
+            uint32_t lastUse;
+        };
+
+        // Check that resources sharing an allocation have identical properties and disjoint lifetimes.
+        bool isValidPlan(const ResourceMemoryPlanner::Plan& plan, const std::vector<Desc>& descs, const std::vector<Lifetime>& lifetimes)
+        {
+            for (size_t i = 0; i < descs.size(); i++)
+            {
+                if (plan.allocations[plan.allocationIndices[i]] != descs[i]) return false;
+                for (size_t j = i + 1; j < descs.size(); j++)
+                {
+                    if (plan.allocationIndices[i] != plan.allocationIndices[j]) continue;
+                    if (lifetimes[i].firstUse <= lifetimes[j].lastUse && lifetimes[j].firstUse <= lifetimes[i].lastUse) return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    CPU_TEST(ResourceMemoryPlannerSize)
+    {
+        EXPECT_EQ(texture2D(4, 4, ResourceFormat::RGBA32Float).getSizeInBytes(), 256ull);
+        EXPECT_EQ(texture2D(4, 4, ResourceFormat::BC1Unorm).getSizeInBytes(), 8ull);
+
+        Desc mips = texture2D(4, 4, ResourceFormat::R32Float);
+        mips.mipLevels = Resource::kMaxPossible;
+        EXPECT_EQ(mips.getSizeInBytes(), 4ull * (16 + 4 + 1));
+
+        Desc cube = texture2D(2, 2, ResourceFormat::R32Float);
+        cube.type = RenderPassReflection::Field::Type::TextureCube;
+        EXPECT_EQ(cube.getSizeInBytes(), 6ull * 16);
+
+        Desc buffer;
+        buffer.type = RenderPassReflection::Field::Type::RawBuffer;
+        buffer.width = 1000;
+        EXPECT_EQ(buffer.getSizeInBytes(), 1000ull);
+    }
+
+    CPU_TEST(ResourceMemoryPlannerChain)
+    {
+        // Linear chain of passes where each pass reads the output of the previous one.
+        ResourceMemoryPlanner planner;
+        Desc desc = texture2D(16, 16, ResourceFormat::RGBA16Float);
+        for (uint32_t i = 0; i < 6; i++) planner.addResource(desc, i, i + 1, true);
+
+        auto plan = planner.plan();
+        EXPECT_EQ(plan.stats.resourceCount, 6u);
+        EXPECT_EQ(plan.stats.allocationCount, 2u);
+        EXPECT_EQ(plan.allocationIndices[0], plan.allocationIndices[2]);
+        EXPECT_EQ(plan.allocationIndices[1], plan.allocationIndices[3]);
+        EXPECT_NE(plan.allocationIndices[0], plan.allocationIndices[1]);
+        EXPECT_EQ(plan.stats.dedicatedBytes, 6 * desc.getSizeInBytes());
+        EXPECT_EQ(plan.stats.plannedBytes, 2 * desc.getSizeInBytes());
+        EXPECT_EQ(plan.stats.peakLiveBytes, 2 * desc.getSizeInBytes());
+    }
+
+    CPU_TEST(ResourceMemoryPlannerCompatibility)
+    {
+        ResourceMemoryPlanner planner;
+        Desc a = texture2D(16, 16, ResourceFormat::RGBA32Float);
+        Desc b = texture2D(16, 16, ResourceFormat::RGBA16Float);
+        Desc c = texture2D(16, 16, ResourceFormat::RGBA32Float, ResourceBindFlags::ShaderResource | ResourceBindFlags::RenderTarget);
+
+        planner.addResource(a, 0, 0, true);
+        planner.addResource(b, 1, 1, true);     // Different format.
+        planner.addResource(c, 2, 2, true);     // Different bind flags.
+        planner.addResource(a, 3, 3, false);    // Not transient.
+        planner.addResource(a, 4, uint32_t(-1), false);
+        planner.addResource(a, 5, 5, true);
+
+        auto plan = planner.plan();
+        EXPECT_EQ(plan.stats.allocationCount, 5u);
+        EXPECT_EQ(plan.allocationIndices[0], plan.allocationIndices[5]);
+        EXPECT_EQ(plan.stats.peakLiveBytes, 3 * a.getSizeInBytes());
+    }
+
+    CPU_TEST(ResourceMemoryPlannerRandom)
+    {
+        std::mt19937 rng(7);
+        std::vector<Desc> kinds = { texture2D(8, 8, ResourceFormat::RGBA32Float), texture2D(8, 8, ResourceFormat::R32Float), texture2D(4, 4, ResourceFormat::RGBA32Float) };
+
+        for (uint32_t iteration = 0; iteration < 20; iteration++)
+        {
+            ResourceMemoryPlanner planner;
+            std::vector<Desc> descs;
+            std::vector<Lifetime> lifetimes;
+            for (uint32_t i = 0; i < 200; i++)
+            {
+                uint32_t firstUse = uint32_t(rng() % 100);
+                Lifetime lifetime = { firstUse, firstUse + uint32_t(rng() % 10) };
+                descs.push_back(kinds[rng() % kinds.size()]);
+                lifetimes.push_back(lifetime);
+                planner.addResource(descs.back(), lifetime.firstUse, lifetime.lastUse, true);
+            }
+
+            auto plan = planner.plan();
+            EXPECT(isValidPlan(plan, descs, lifetimes)) << "iteration " << iteration;
+
+            // Per kind of resource, the allocation count must equal the largest number of overlapping lifetimes.
+            for (const auto& kind : kinds)
+            {
+                uint32_t maxOverlap = 0;
+                for (uint32_t t = 0; t < 110; t++)
+                {
+                    uint32_t overlap = 0;
+                    for (size_t i = 0; i < descs.size(); i++) overlap += descs[i] == kind && lifetimes[i].firstUse <= t && t <= lifetimes[i].lastUse;
+                    maxOverlap = std::max(maxOverlap, overlap);
+                }
+                uint32_t allocationCount = (uint32_t)std::count(plan.allocations.begin(), plan.allocations.end(), kind);
+                EXPECT_EQ(allocationCount, maxOverlap) << "iteration " << iteration;
+            }
+            EXPECT(plan.stats.peakLiveBytes <= plan.stats.plannedBytes);
+            EXPECT(plan.stats.plannedBytes <= plan.stats.dedicatedBytes);
+        }
+    }
+
+    CPU_TEST(ResourceMemoryPlannerPhotonMapperGraph)
+    {
+        // Synthetic version of a photon mapping graph at 4k: VBufferPM -> RTPhotonMapper -> AccumulatePass -> ToneMapper -> ErrorMeasurePass.
+        const uint32_t w = 3840, h = 2160;
+        const auto uav = ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess;
+        struct Field { const char* name; Desc desc; uint32_t firstUse; uint32_t lastUse; bool transient; };
+        std::vector<Field> fields =
+        {
+            { "VBufferPM.vbuffer", texture2D(w, h, ResourceFormat::RGBA32Uint, uav), 0, 1, true },
+            { "VBufferPM.viewW", texture2D(w, h, ResourceFormat::RGBA32Float, uav), 0, 1, true },
+            { "VBufferPM.throughput", texture2D(w, h, ResourceFormat::RGBA32Float, uav), 0, 1, true },
+            { "VBufferPM.emissive", texture2D(w, h, ResourceFormat::RGBA32Float, uav), 0, 1, true },
+            { "VBufferPM.thp", texture2D(w, h, ResourceFormat::RGBA16Float, uav), 0, 1, true },
+            { "RTPhotonMapper.PhotonImage", texture2D(w, h, ResourceFormat::RGBA32Float, uav), 1, 2, true },
+            { "AccumulatePass.output", texture2D(w, h, ResourceFormat::RGBA32Float, uav), 2, 4, true },
+            { "ToneMapper.dst", texture2D(w, h, ResourceFormat::RGBA32Float, uav), 3, uint32_t(-1), false },
+            { "ErrorMeasurePass.Output", texture2D(w, h, ResourceFormat::RGBA32Float, uav), 4, 4, true },
+        };
+
+        ResourceMemoryPlanner planner;
+        for (const auto& f : fields) planner.addResource(f.desc, f.firstUse, f.lastUse, f.transient);
+        auto plan = planner.plan();
+
+        // The accumulation and error outputs reuse allocations of the vertex buffer outputs.
+        EXPECT_EQ(plan.stats.allocationCount, 7u);
+        EXPECT(plan.stats.plannedBytes < plan.stats.dedicatedBytes);
+        EXPECT(plan.stats.peakLiveBytes <= plan.stats.plannedBytes);
+
+        logInfo("ResourceMemoryPlannerPhotonMapperGraph: {} resources, {} allocations, peak memory {} before, {} after, {} in use at most.",
+            plan.stats.resourceCount, plan.stats.allocationCount, formatByteSize(plan.stats.dedicatedBytes),
+            formatByteSize(plan.stats.plannedBytes), formatByteSize(plan.stats.peakLiveBytes));
+    }
+}
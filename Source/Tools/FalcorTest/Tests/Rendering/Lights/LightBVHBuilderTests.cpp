@@ -0,0 +1,163 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Lights/LightBVHBuilder.h"
+#include "Utils/Logger.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <cstring>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Create a synthetic set of emissive triangles.
+            The triangles are small and clustered to resemble emissive geometry in a scene.
+            About one in eight triangles is non-emissive to exercise the pre-integration culling.
+        */
+        std::vector<LightCollection::MeshLightTriangle> createTriangles(uint32_t count, uint32_t seed)
+        {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> u(0.f, 1.f);
+            auto randomDir = [&]()
+            {
+                float z = 1.f - 2.f * u(rng);
+                float r = std::sqrt(std::max(0.f, 1.f - z * z));
+                float phi = glm::two_pi<float>() * u(rng);
+                return float3(r * std::cos(phi), r * std::sin(phi), z);
+            };
+
+            std::vector<float3> clusters(64);
+            for (auto& c : clusters) c = float3(u(rng), u(rng), u(rng)) * 100.f;
+
+            std::vector<LightCollection::MeshLightTriangle> triangles(count);
+            for (auto& tri : triangles)
+            {
+                float3 center = clusters[rng() % clusters.size()] + randomDir() * (10.f * u(rng));
+                for (uint32_t j = 0; j < 3; j++) tri.vtx[j].pos = center + randomDir() * (0.1f * u(rng));
+                tri.normal = randomDir();
+                tri.flux = (rng() % 8 == 0) ? 0.f : u(rng) * 10.f;
+            }
+            return triangles;
+        }
+
+        struct BuildOutput
+        {
+            std::vector<PackedNode> nodes;
+            std::vector<uint32_t> triangleIndices;
+            std::vector<uint64_t> triangleBitmasks;
+        };
+
+        BuildOutput build(LightBVHBuilder::Options options, bool parallel, const std::vector<LightCollection::MeshLightTriangle>& triangles)
+        {
+            options.useParallelBuild = parallel;
+            BuildOutput output;
+            LightBVHBuilder::create(options)->buildNodes(triangles, output.nodes, output.triangleIndices, output.triangleBitmasks);
+            return output;
+        }
+
+        void testParallelBuild(CPUUnitTestContext& ctx, const LightBVHBuilder::Options& options, const std::vector<LightCollection::MeshLightTriangle>& triangles)
+        {
+            BuildOutput ref = build(options, false, triangles);
+            BuildOutput result = build(options, true, triangles);
+
+            EXPECT(!ref.nodes.empty());
+            EXPECT_EQ(ref.nodes.size(), result.nodes.size());
+            EXPECT_EQ(ref.triangleIndices.size(), result.triangleIndices.size());
+            EXPECT_EQ(ref.triangleBitmasks.size(), result.triangleBitmasks.size());
+            if (ctx.mNumFailures > 0) return;
+
+            // The nodes are compared bitwise as the parallel build is required to be bit-identical.
+            for (size_t i = 0; i < ref.nodes.size(); i++)
+            {
+                EXPECT(std::memcmp(&ref.nodes[i], &result.nodes[i], sizeof(PackedNode)) == 0) << "node = " << i;
+                if (ctx.mNumFailures > 0) return;
+            }
+            for (size_t i = 0; i < ref.triangleIndices.size(); i++)
+            {
+                EXPECT_EQ(ref.triangleIndices[i], result.triangleIndices[i]) << "i = " << i;
+            }
+            for (size_t i = 0; i < ref.triangleBitmasks.size(); i++)
+            {
+                EXPECT_EQ(ref.triangleBitmasks[i], result.triangleBitmasks[i]) << "i = " << i;
+            }
+        }
+    }
+
+    CPU_TEST(LightBVHBuilderParallel)
+    {
+        // Test sizes below and well above the thresholds of the parallel build.
+        for (uint32_t count : { 1u, 100u, 20000u, 250000u })
+        {
+            auto triangles = createTriangles(count, count);
+
+            for (auto heuristic : { LightBVHBuilder::SplitHeuristic::Equal, LightBVHBuilder::SplitHeuristic::BinnedSAH, LightBVHBuilder::SplitHeuristic::BinnedSAOH })
+            {
+                LightBVHBuilder::Options options;
+                options.splitHeuristicSelection = heuristic;
+                testParallelBuild(ctx, options, triangles);
+
+                options.splitAlongLargest = true;
+                options.createLeavesASAP = false;
+                options.useVolumeOverSA = true;
+                options.binCount = 7;
+                testParallelBuild(ctx, options, triangles);
+
+                // SAOH can exceed the maximum tree depth with small leaves or without pre-integration, so these are only varied for the other heuristics.
+                if (heuristic != LightBVHBuilder::SplitHeuristic::BinnedSAOH)
+                {
+                    options = {};
+                    options.splitHeuristicSelection = heuristic;
+                    options.usePreintegration = false;
+                    options.maxTriangleCountPerLeaf = 4;
+                    testParallelBuild(ctx, options, triangles);
+                }
+            }
+        }
+    }
+
+    CPU_TEST(LightBVHBuilderBenchmark, "Benchmark; run manually")
+    {
+        // Reports serial and parallel build times of the default configuration.
+        const uint32_t count = 1000000;
+        auto triangles = createTriangles(count, 1);
+
+        LightBVHBuilder::Options options;
+        auto timeBuild = [&](bool parallel)
+        {
+            auto start = CpuTimer::getCurrentTimePoint();
+            BuildOutput output = build(options, parallel, triangles);
+            EXPECT(!output.nodes.empty());
+            return CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+        };
+
+        double serialTime = timeBuild(false);
+        double parallelTime = timeBuild(true);
+        logInfo("LightBVHBuilder: {} triangles, serial build {:.1f} ms, parallel build {:.1f} ms ({:.2f}x)", count, serialTime, parallelTime, serialTime / parallelTime);
+    }
+}
@@ -0,0 +1,174 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Utils/GatherSampleBudget.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Returns the expected image-wide sample count for the given pixel importances.
+        */
+        double expectedSampleSum(const std::vector<float>& importance, const GatherSampleBudget& budget)
+        {
+            const auto& options = budget.getOptions();
+            double sum = 0.0;
+            for (float i : importance) sum += gatherSampleCountExpected(i, budget.getScale(), options.minSamples, options.maxSamples);
+            return sum;
+        }
+
+        double importanceSum(const std::vector<float>& importance)
+        {
+            double sum = 0.0;
+            for (float i : importance) sum += i;
+            return sum;
+        }
+    }
+
+    CPU_TEST(GatherSampleImportance)
+    {
+        const float floor = 0.1f;
+
+        // Constant weights have no variance.
+        EXPECT_EQ(gatherSampleImportance(0.5f, 0.25f, floor), floor);
+        // All samples rejected.
+        EXPECT_EQ(gatherSampleImportance(0.f, 0.f, floor), floor);
+        // Half of the samples with weight 1, half with weight 0: relative standard deviation 1.
+        EXPECT_LE(std::abs(gatherSampleImportance(0.5f, 0.5f, floor) - (floor + 1.f)), 1e-6f);
+        // Rare bright samples are more important than frequent ones.
+        EXPECT_GT(gatherSampleImportance(0.1f, 0.1f, floor), gatherSampleImportance(0.9f, 0.9f, floor));
+    }
+
+    CPU_TEST(GatherSampleCountRounding)
+    {
+        const uint minSamples = 1;
+        const uint maxSamples = 8;
+
+        EXPECT_EQ(gatherSampleCount(0.f, 4.f, minSamples, maxSamples, 0.5f), minSamples);
+        EXPECT_EQ(gatherSampleCount(100.f, 4.f, minSamples, maxSamples, 0.f), maxSamples);
+
+        // Stochastic rounding matches the expected count on average.
+        const uint n = 10000;
+        for (float importance : { 0.3f, 0.55f, 1.2f, 1.75f })
+        {
+            double sum = 0.0;
+            for (uint i = 0; i < n; i++)
+            {
+                uint count = gatherSampleCount(importance, 2.f, minSamples, maxSamples, (i + 0.5f) / n);
+                EXPECT_GE(count, minSamples);
+                EXPECT_LE(count, maxSamples);
+                sum += count;
+            }
+            float expected = gatherSampleCountExpected(importance, 2.f, minSamples, maxSamples);
+            EXPECT_LE(std::abs(sum / n - expected), 1e-3) << "importance = " << importance;
+        }
+    }
+
+    CPU_TEST(GatherSampleBudgetUniform)
+    {
+        GatherSampleBudget::Options options;
+        options.samplesPerPixel = 6.f;
+        GatherSampleBudget budget(options);
+
+        // Before any statistics pixels at the floor importance take the budget.
+        EXPECT_EQ(gatherSampleCountExpected(options.importanceFloor, budget.getScale(), options.minSamples, options.maxSamples), 6.f);
+
+        std::vector<float> importance(1000, 0.7f);
+        budget.update(importanceSum(importance), 0.0, importance.size());
+        EXPECT_LE(std::abs(expectedSampleSum(importance, budget) / importance.size() - 6.0), 1e-4);
+
+        // The budget is clamped to the sample count range.
+        options.samplesPerPixel = 100.f;
+        budget.setOptions(options);
+        EXPECT_EQ(budget.getTargetSamplesPerPixel(), float(options.maxSamples));
+    }
+
+    CPU_TEST(GatherSampleBudgetConverges)
+    {
+        GatherSampleBudget::Options options;
+        options.samplesPerPixel = 4.f;
+        options.minSamples = 1;
+        options.maxSamples = 16;
+        GatherSampleBudget budget(options);
+
+        // Most pixels see converged gather samples, a few (e.g. next to windows) have a high variance.
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> u;
+        std::vector<float> importance(4096);
+        for (auto& i : importance) i = u(rng) < 0.1f ? 2.f + 8.f * u(rng) : options.importanceFloor + 0.2f * u(rng);
+
+        const double pixelCount = double(importance.size());
+        const double impSum = importanceSum(importance);
+        double sampleSum = 0.0;
+        for (uint frame = 0; frame < 30; frame++)
+        {
+            budget.update(impSum, sampleSum, importance.size());
+            sampleSum = expectedSampleSum(importance, budget);
+        }
+
+        // Clamping makes the unclamped estimate miss the budget, the feedback corrects it.
+        EXPECT_LE(std::abs(sampleSum / pixelCount - options.samplesPerPixel), 0.01) << "average = " << sampleSum / pixelCount;
+        EXPECT_LE(std::abs(budget.getRealizedSamplesPerPixel() - options.samplesPerPixel), 0.01f);
+
+        // Samples follow importance.
+        const float scale = budget.getScale();
+        EXPECT_GE(gatherSampleCountExpected(5.f, scale, options.minSamples, options.maxSamples),
+                  gatherSampleCountExpected(0.2f, scale, options.minSamples, options.maxSamples));
+        EXPECT_EQ(gatherSampleCountExpected(10.f, scale, options.minSamples, options.maxSamples), float(options.maxSamples));
+    }
+
+    CPU_TEST(GatherSampleBudgetSaturated)
+    {
+        GatherSampleBudget::Options options;
+        options.samplesPerPixel = 8.f;
+        options.minSamples = 1;
+        options.maxSamples = 8;
+        GatherSampleBudget budget(options);
+
+        // Budget equals the max count: every pixel, including those at the floor importance, has to
+        // saturate. The scale stops growing once they do.
+        std::vector<float> importance(256);
+        for (size_t i = 0; i < importance.size(); i++) importance[i] = i % 2 ? options.importanceFloor : 0.5f;
+        double sampleSum = 0.0;
+        for (uint frame = 0; frame < 100; frame++)
+        {
+            budget.update(importanceSum(importance), sampleSum, importance.size());
+            sampleSum = expectedSampleSum(importance, budget);
+        }
+        EXPECT_LE(budget.getScale(), float(options.maxSamples) / options.importanceFloor);
+        EXPECT_LE(std::abs(sampleSum / importance.size() - 8.0), 1e-3);
+
+        // Statistics without any pixels are ignored.
+        float scale = budget.getScale();
+        budget.update(0.0, 0.0, 0);
+        EXPECT_EQ(budget.getScale(), scale);
+    }
+}
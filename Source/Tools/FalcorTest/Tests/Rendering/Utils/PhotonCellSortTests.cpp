@@ -0,0 +1,121 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Utils/PhotonCellSort.h"
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kBucketHeaderSize = 4; ///< size, cell and pad, in uints.
+
+        /** CPU reference of the photon cell sort.
+            \param[in] buckets Bucket data, (kBucketHeaderSize + photonsPerBucket) uints per bucket.
+            \param[out] cellStart bucketCount + 1 start indices.
+            \param[out] sortedIndices Photon indices in bucket order.
+        */
+        void photonCellSort(const std::vector<uint32_t>& buckets, uint32_t photonsPerBucket, std::vector<uint32_t>& cellStart, std::vector<uint32_t>& sortedIndices)
+        {
+            const uint32_t stride = kBucketHeaderSize + photonsPerBucket;
+            const uint32_t bucketCount = (uint32_t)(buckets.size() / stride);
+            cellStart.assign(bucketCount + 1, 0);
+            sortedIndices.clear();
+            for (uint32_t b = 0; b < bucketCount; b++)
+            {
+                cellStart[b] = (uint32_t)sortedIndices.size();
+                const uint32_t* pBucket = buckets.data() + b * stride;
+                const uint32_t count = std::min(pBucket[0], photonsPerBucket);
+                sortedIndices.insert(sortedIndices.end(), pBucket + kBucketHeaderSize, pBucket + kBucketHeaderSize + count);
+            }
+            cellStart[bucketCount] = (uint32_t)sortedIndices.size();
+        }
+
+        void testPhotonCellSort(GPUUnitTestContext& ctx, const PhotonCellSort::SharedPtr& pSort, uint32_t bucketCount, uint32_t photonsPerBucket)
+        {
+            // Create random buckets. Most are empty and some received more photons than they can hold.
+            const uint32_t stride = kBucketHeaderSize + photonsPerBucket;
+            std::vector<uint32_t> buckets(bucketCount * stride, 0);
+            std::mt19937 r;
+            for (uint32_t b = 0; b < bucketCount; b++)
+            {
+                uint32_t* pBucket = buckets.data() + b * stride;
+                if (r() % 4 != 0) continue;
+                pBucket[0] = 1 + r() % (2 * photonsPerBucket);
+                pBucket[1] = r();
+                for (uint32_t i = 0; i < photonsPerBucket; i++) pBucket[kBucketHeaderSize + i] = r();
+            }
+
+            std::vector<uint32_t> refCellStart;
+            std::vector<uint32_t> refSortedIndices;
+            photonCellSort(buckets, photonsPerBucket, refCellStart, refSortedIndices);
+
+            // Execute the sort on the GPU.
+            Buffer::SharedPtr pBuckets = Buffer::createStructured(stride * sizeof(uint32_t), bucketCount, ResourceBindFlags::ShaderResource, Buffer::CpuAccess::None, buckets.data(), false);
+            Buffer::SharedPtr pCellStart = Buffer::create((bucketCount + 1) * sizeof(uint32_t));
+            Buffer::SharedPtr pSortedIndices = Buffer::createStructured(sizeof(uint32_t), std::max((uint32_t)refSortedIndices.size(), 1u), ResourceBindFlags::ShaderResource | ResourceBindFlags::UnorderedAccess, Buffer::CpuAccess::None, nullptr, false);
+            pSort->execute(ctx.getRenderContext(), pBuckets, bucketCount, photonsPerBucket, pCellStart, pSortedIndices);
+
+            // Compare results.
+            const uint32_t* cellStart = (const uint32_t*)pCellStart->map(Buffer::MapType::Read);
+            FALCOR_ASSERT(cellStart);
+            for (uint32_t b = 0; b <= bucketCount; b++)
+            {
+                EXPECT_EQ(cellStart[b], refCellStart[b]) << "bucket = " << b;
+            }
+            pCellStart->unmap();
+
+            const uint32_t* sortedIndices = (const uint32_t*)pSortedIndices->map(Buffer::MapType::Read);
+            FALCOR_ASSERT(sortedIndices);
+            for (uint32_t i = 0; i < refSortedIndices.size(); i++)
+            {
+                EXPECT_EQ(sortedIndices[i], refSortedIndices[i]) << "i = " << i;
+            }
+            pSortedIndices->unmap();
+        }
+    }
+
+    GPU_TEST(PhotonCellSort)
+    {
+        // Quick test of our reference function.
+        std::vector<uint32_t> buckets = { 3, 0, 0, 0, 7, 8, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 5, 0 };
+        std::vector<uint32_t> cellStart, sortedIndices;
+        photonCellSort(buckets, 2, cellStart, sortedIndices);
+        FALCOR_ASSERT(cellStart.size() == 4 && cellStart[0] == 0 && cellStart[1] == 2 && cellStart[2] == 2 && cellStart[3] == 3);
+        FALCOR_ASSERT(sortedIndices.size() == 3 && sortedIndices[0] == 7 && sortedIndices[1] == 8 && sortedIndices[2] == 5);
+
+        // Create helper class.
+        PhotonCellSort::SharedPtr pSort = PhotonCellSort::create();
+
+        // Test varying grid sizes and bucket capacities.
+        testPhotonCellSort(ctx, pSort, 1, 1);
+        testPhotonCellSort(ctx, pSort, 1000, 4);
+        testPhotonCellSort(ctx, pSort, 1 << 16, 12);
+        testPhotonCellSort(ctx, pSort, 1 << 20, 12);
+    }
+}
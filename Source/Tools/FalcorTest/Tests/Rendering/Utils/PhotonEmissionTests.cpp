@@ -0,0 +1,254 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Utils/PhotonEmission.h"
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+    namespace
+    {
+        const float kSceneRadius = 2.f;
+        const float3 kSceneCenter = float3(1.f, -3.f, 0.5f);
+
+        /** Uniform sample in [0,1) from the raw generator output so the stream is the same on all standard libraries.
+        */
+        float sampleUniform(std::mt19937& rng)
+        {
+            return float(rng() / 4294967296.0);
+        }
+
+        /** Uniformly distributed direction on the sphere (pdf 1 / 4pi) or on the upper hemisphere (pdf 1 / 2pi).
+        */
+        float3 sampleDirection(std::mt19937& rng, bool upperHemisphere)
+        {
+            float y = upperHemisphere ? 1.f - sampleUniform(rng) : 1.f - 2.f * sampleUniform(rng);
+            float r = std::sqrt(std::fmax(0.f, 1.f - y * y));
+            float phi = float(2.0 * M_PI) * sampleUniform(rng);
+            return float3(r * std::cos(phi), y, r * std::sin(phi));
+        }
+
+        /** Estimates the irradiance at the scene center on an upward facing disk from a constant environment map
+            with radiance L = 1 by tracing the photons to the plane of the disk.
+        */
+        double estimateIrradiance(bool upperHemisphere)
+        {
+            const uint32_t photonCount = 1000000;
+            const float patchRadius = 0.25f * kSceneRadius;
+            const float dirPdf = float(upperHemisphere ? 1.0 / (2.0 * M_PI) : 1.0 / (4.0 * M_PI));
+            const float flux = photonEnvFluxScale(dirPdf, kSceneRadius, photonCount);
+
+            std::mt19937 rng(42);
+            double fluxSum = 0.0;
+            for (uint32_t i = 0; i < photonCount; i++)
+            {
+                float3 dir = sampleDirection(rng, upperHemisphere);
+                float2 u = float2(sampleUniform(rng), sampleUniform(rng));
+                float3 origin = photonEnvOrigin(dir, kSceneCenter, kSceneRadius, u);
+                if (dir.y <= 0.f) continue;     // Photon arrives from below
+
+                // Intersect the photon path origin - t * dir with the plane y = center.y.
+                float t = (origin.y - kSceneCenter.y) / dir.y;
+                float3 hit = origin - t * dir - kSceneCenter;
+                if (hit.x * hit.x + hit.z * hit.z < patchRadius * patchRadius) fluxSum += flux;
+            }
+            return fluxSum / (M_PI * patchRadius * patchRadius);
+        }
+    }
+
+    CPU_TEST(PhotonEmissionSplitProportional)
+    {
+        PhotonEmissionPower power;
+        power.analytic = 1.f;
+        power.emissive = 2.f;
+        power.env = 1.f;
+        PhotonEmissionCounts counts = splitPhotonsByPower(power, 1000);
+        EXPECT_EQ(counts.analytic, 250u);
+        EXPECT_EQ(counts.emissive, 500u);
+        EXPECT_EQ(counts.env, 250u);
+
+        // The remainder goes to the most powerful group.
+        power.env = 0.f;
+        counts = splitPhotonsByPower(power, 1001);
+        EXPECT_EQ(counts.analytic, 333u);
+        EXPECT_EQ(counts.emissive, 668u);
+        EXPECT_EQ(counts.env, 0u);
+        EXPECT_EQ(counts.total(), 1001u);
+    }
+
+    CPU_TEST(PhotonEmissionSplitMinimum)
+    {
+        PhotonEmissionPower power;
+        power.emissive = 1.f;
+        power.env = 1e-6f;
+        PhotonEmissionCounts counts = splitPhotonsByPower(power, 100);
+        EXPECT_EQ(counts.analytic, 0u);
+        EXPECT_EQ(counts.emissive, 100u);
+        EXPECT_EQ(counts.env, 1u);
+
+        counts = splitPhotonsByPower(PhotonEmissionPower(), 100);
+        EXPECT_EQ(counts.total(), 0u);
+    }
+
+    CPU_TEST(PhotonEmissionLightSplitProportional)
+    {
+        std::vector<uint32_t> counts = splitPhotonsByLightPower({ 1.f, 0.f, 3.f }, 1000, 0, 0);
+        EXPECT_EQ(counts.size(), 3u);
+        EXPECT_EQ(counts[0], 250u);
+        EXPECT_EQ(counts[1], 0u);
+        EXPECT_EQ(counts[2], 750u);
+
+        // Rounding keeps the total and every count within one photon of its share.
+        std::mt19937 rng(3);
+        std::vector<float> power(37);
+        double totalPower = 0.0;
+        for (float& p : power)
+        {
+            p = sampleUniform(rng) < 0.2f ? 0.f : sampleUniform(rng);
+            totalPower += p;
+        }
+        counts = splitPhotonsByLightPower(power, 100003, 0, 0);
+        uint32_t total = 0;
+        for (size_t i = 0; i < power.size(); i++)
+        {
+            total += counts[i];
+            EXPECT_LE(std::abs(counts[i] - 100003 * power[i] / totalPower), 1.0) << "light = " << i;
+        }
+        EXPECT_EQ(total, 100003u);
+    }
+
+    CPU_TEST(PhotonEmissionLightSplitLimits)
+    {
+        // The minimum is taken from the other lights.
+        std::vector<uint32_t> counts = splitPhotonsByLightPower({ 1000.f, 1.f }, 1000, 100, 0);
+        EXPECT_EQ(counts[0], 900u);
+        EXPECT_EQ(counts[1], 100u);
+
+        // The share above the cap goes to the other lights, proportional to their power.
+        counts = splitPhotonsByLightPower({ 1.f, 3.f, 16.f }, 1000, 0, 500);
+        EXPECT_EQ(counts[0], 125u);
+        EXPECT_EQ(counts[1], 375u);
+        EXPECT_EQ(counts[2], 500u);
+
+        // Lights without power get no photons, even with a minimum.
+        counts = splitPhotonsByLightPower({ 0.f, 1.f }, 1000, 100, 0);
+        EXPECT_EQ(counts[0], 0u);
+        EXPECT_EQ(counts[1], 1000u);
+
+        // Limits that can not be met with the budget.
+        counts = splitPhotonsByLightPower({ 1.f, 2.f }, 100, 256, 0);
+        EXPECT_EQ(counts[0], 256u);
+        EXPECT_EQ(counts[1], 256u);
+        counts = splitPhotonsByLightPower({ 1.f, 2.f }, 1000, 0, 100);
+        EXPECT_EQ(counts[0], 100u);
+        EXPECT_EQ(counts[1], 100u);
+
+        // The cap takes precedence over the minimum.
+        counts = splitPhotonsByLightPower({ 1.f, 1.f }, 1000, 600, 300);
+        EXPECT_EQ(counts[0], 300u);
+        EXPECT_EQ(counts[1], 300u);
+
+        EXPECT_EQ(splitPhotonsByLightPower({}, 1000, 100, 0).size(), 0u);
+        counts = splitPhotonsByLightPower({ 0.f, 0.f }, 1000, 100, 0);
+        EXPECT_EQ(counts[0] + counts[1], 0u);
+    }
+
+    CPU_TEST(PhotonEmissionLightPower)
+    {
+        const float kPi = float(M_PI);
+        EXPECT_LE(std::abs(photonPointLightPower(2.f, kPi) - 8.f * kPi), 1e-5f);
+        EXPECT_LE(std::abs(photonPointLightPower(2.f, 0.5f * kPi) - 4.f * kPi), 1e-5f);
+        EXPECT_EQ(photonPointLightPower(2.f, 0.f), 0.f);
+        EXPECT_LE(std::abs(photonAreaLightPower(2.f, 3.f) - 6.f * kPi), 1e-5f);
+        EXPECT_LE(std::abs(photonDirectionalLightPower(2.f, kSceneRadius) - 2.f * kPi * kSceneRadius * kSceneRadius), 1e-4f);
+
+        // A distant light of small angle has the irradiance radiance * solid angle, like a directional light.
+        float cosTheta = 0.999f;
+        float solidAngle = 2.f * kPi * (1.f - cosTheta);
+        EXPECT_LE(std::abs(photonDistantLightPower(2.f, cosTheta, kSceneRadius) / photonDirectionalLightPower(2.f * solidAngle, kSceneRadius) - 1.f), 1e-5f);
+    }
+
+    CPU_TEST(PhotonEmissionDiskSample)
+    {
+        // Uniform density on the unit disk: E[r^2] = 1/2 and the same number of samples per quadrant.
+        std::mt19937 rng(7);
+        const uint32_t n = 100000;
+        double r2Sum = 0.0;
+        uint32_t quadrant[4] = {};
+        for (uint32_t i = 0; i < n; i++)
+        {
+            float2 p = photonEnvDiskSample(float2(sampleUniform(rng), sampleUniform(rng)));
+            float r2 = p.x * p.x + p.y * p.y;
+            EXPECT_LE(r2, 1.f + 1e-6f);
+            r2Sum += r2;
+            quadrant[(p.x < 0.f ? 1 : 0) + (p.y < 0.f ? 2 : 0)]++;
+        }
+        EXPECT_LE(std::abs(r2Sum / n - 0.5), 0.005);
+        for (uint32_t q = 0; q < 4; q++) EXPECT_LE(std::abs(quadrant[q] / double(n) - 0.25), 0.005) << "quadrant = " << q;
+    }
+
+    CPU_TEST(PhotonEmissionOrigin)
+    {
+        // The start points lie on the disk perpendicular to dir that touches the scene-bounding sphere.
+        std::mt19937 rng(11);
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            float3 dir = sampleDirection(rng, false);
+            float3 origin = photonEnvOrigin(dir, kSceneCenter, kSceneRadius, float2(sampleUniform(rng), sampleUniform(rng)));
+            float3 offset = origin - kSceneCenter;
+            float along = dot(offset, dir);
+            float3 inPlane = offset - along * dir;
+            EXPECT_LE(std::abs(along - kSceneRadius), 1e-4f);
+            EXPECT_LE(dot(inPlane, inPlane), kSceneRadius * kSceneRadius * (1.f + 1e-4f));
+        }
+    }
+
+    CPU_TEST(PhotonEmissionIrradiance)
+    {
+        // A constant environment map with L = 1 gives the irradiance pi on an upward facing surface,
+        // independent of the direction density.
+        double sphere = estimateIrradiance(false);
+        double hemisphere = estimateIrradiance(true);
+        EXPECT_LE(std::abs(sphere / M_PI - 1.0), 0.03) << "irradiance = " << sphere;
+        EXPECT_LE(std::abs(hemisphere / M_PI - 1.0), 0.03) << "irradiance = " << hemisphere;
+    }
+
+    CPU_TEST(PhotonEmissionEnvPower)
+    {
+        // The photon fluxes of a constant environment map add up to its power.
+        const uint32_t photonCount = 1000;
+        float flux = photonEnvFluxScale(float(1.0 / (4.0 * M_PI)), kSceneRadius, photonCount);
+        float power = photonEnvPower(1.f, kSceneRadius);
+        EXPECT_LE(std::abs(flux * photonCount / power - 1.f), 1e-5f);
+        EXPECT_EQ(photonEnvFluxScale(0.f, kSceneRadius, photonCount), 0.f);
+        EXPECT_EQ(photonEnvFluxScale(1.f, kSceneRadius, 0), 0.f);
+    }
+}
@@ -0,0 +1,198 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Utils/PhotonHashGrid.slang"
+#include "Utils/Logger.h"
+#include <random>
+#include <set>
+#include <tuple>
+
+namespace Falcor
+{
+    namespace
+    {
+        using Cell = std::tuple<int, int, int>;
+
+        const uint kNumBuckets = 1u << 18;
+        const uint kBytesPerBucket = 16;    ///< One float4 texel per bucket, as in the stochastic hash photon mapper.
+        const uint kCacheLineSize = 64;
+
+        /** CPU port of the tight cell enumeration in the hash photon collect passes.
+            Position and radius are in cell units.
+        */
+        template<typename F>
+        void forEachTightCell(float3 p, float radius, F func)
+        {
+            float r2 = radius * radius;
+            int2 zSpan = photonHashGridCellSpan(p.z, r2);
+            for (int z = zSpan.x; z <= zSpan.y; z++)
+            {
+                float rz2 = photonHashGridSliceRadiusSqr(p.z, r2, z);
+                int2 ySpan = photonHashGridCellSpan(p.y, rz2);
+                for (int y = ySpan.x; y <= ySpan.y; y++)
+                {
+                    float ry2 = photonHashGridSliceRadiusSqr(p.y, rz2, y);
+                    int2 xSpan = photonHashGridCellSpan(p.x, ry2);
+                    for (int x = xSpan.x; x <= xSpan.y; x++) func(int3(x, y, z));
+                }
+            }
+        }
+
+        /** CPU port of the legacy cube enumeration.
+        */
+        template<typename F>
+        void forEachCubeCell(float3 p, float radius, F func)
+        {
+            int3 center = int3(int(std::floor(p.x)), int(std::floor(p.y)), int(std::floor(p.z)));
+            int r = int(std::ceil(radius));
+            for (int z = center.z - r; z <= center.z + r; z++)
+                for (int y = center.y - r; y <= center.y + r; y++)
+                    for (int x = center.x - r; x <= center.x + r; x++) func(int3(x, y, z));
+        }
+
+        double cellDistanceSqr(float3 p, int3 cell)
+        {
+            double dx = photonHashGridAxisDistance(p.x, cell.x);
+            double dy = photonHashGridAxisDistance(p.y, cell.y);
+            double dz = photonHashGridAxisDistance(p.z, cell.z);
+            return dx * dx + dy * dy + dz * dz;
+        }
+
+        struct LookupStats
+        {
+            double cells = 0.0;         ///< Average number of cells visited per query.
+            double cacheLines = 0.0;    ///< Average number of distinct cache lines touched per query.
+        };
+
+        LookupStats modelLookups(const std::vector<float3>& queries, float radius, bool tight, bool blocked)
+        {
+            LookupStats stats;
+            std::set<uint> lines;
+            for (const auto& p : queries)
+            {
+                lines.clear();
+                auto visit = [&](int3 cell)
+                {
+                    uint bucket = photonHashGridBucket(cell, kNumBuckets, blocked);
+                    lines.insert(bucket * kBytesPerBucket / kCacheLineSize);
+                    stats.cells += 1.0;
+                };
+                if (tight) forEachTightCell(p, radius, visit);
+                else forEachCubeCell(p, radius, visit);
+                stats.cacheLines += (double)lines.size();
+            }
+            stats.cells /= queries.size();
+            stats.cacheLines /= queries.size();
+            return stats;
+        }
+    }
+
+    CPU_TEST(PhotonHashGridTightEnumeration)
+    {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> posDist(-100.f, 100.f);
+        std::uniform_real_distribution<float> radiusDist(0.01f, 3.f);
+
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            float3 p(posDist(rng), posDist(rng), posDist(rng));
+            float radius = radiusDist(rng);
+            double r2 = (double)radius * radius;
+
+            std::set<Cell> tight;
+            bool duplicates = false;
+            forEachTightCell(p, radius, [&](int3 c) { duplicates |= !tight.insert({ c.x, c.y, c.z }).second; });
+            EXPECT(!duplicates) << "query " << i;
+
+            // Every cell of the brute-force cube that clearly overlaps the sphere must be visited,
+            // and every visited cell must lie in the cube and overlap the sphere.
+            std::set<Cell> cube;
+            forEachCubeCell(p, radius, [&](int3 c)
+            {
+                cube.insert({ c.x, c.y, c.z });
+                if (cellDistanceSqr(p, c) < r2 * (1.0 - 1e-5)) EXPECT(tight.count({ c.x, c.y, c.z }) == 1) << "query " << i;
+            });
+            for (const auto& c : tight)
+            {
+                int3 cell(std::get<0>(c), std::get<1>(c), std::get<2>(c));
+                EXPECT(cube.count(c) == 1) << "query " << i;
+                EXPECT_LE(cellDistanceSqr(p, cell), r2 * (1.0 + 1e-5) + 1e-9) << "query " << i;
+            }
+        }
+    }
+
+    CPU_TEST(PhotonHashGridBlockedBuckets)
+    {
+        std::mt19937 rng(1234);
+        std::uniform_int_distribution<int> cellDist(-100000, 100000);
+
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            int3 base(cellDist(rng) & ~1, cellDist(rng) & ~1, cellDist(rng) & ~1);
+            std::set<uint> buckets;
+            uint firstBucket = photonHashGridBucket(base, kNumBuckets, true);
+            EXPECT_EQ(firstBucket % 8, 0u);
+            for (int j = 0; j < 8; j++)
+            {
+                int3 cell = base + int3(j & 1, (j >> 1) & 1, (j >> 2) & 1);
+                uint bucket = photonHashGridBucket(cell, kNumBuckets, true);
+                EXPECT_LT(bucket, kNumBuckets);
+                EXPECT_EQ(bucket, firstBucket + j);
+                EXPECT_LT(photonHashGridBucket(cell, kNumBuckets, false), kNumBuckets);
+            }
+        }
+    }
+
+    CPU_TEST(PhotonHashGridLookupModel)
+    {
+        // Queries with a unit radius and cells sized relative to it, as in the collect pass.
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> posDist(-1000.f, 1000.f);
+        std::vector<float3> queries(10000);
+        for (auto& p : queries) p = float3(posDist(rng), posDist(rng), posDist(rng));
+
+        for (float cellSizeFactor : { 0.5f, 1.f, 2.f })
+        {
+            std::vector<float3> cellQueries(queries.size());
+            for (size_t i = 0; i < queries.size(); i++) cellQueries[i] = queries[i] / cellSizeFactor;
+            float radius = 1.f / cellSizeFactor;
+
+            LookupStats cube = modelLookups(cellQueries, radius, false, false);
+            LookupStats tight = modelLookups(cellQueries, radius, true, false);
+            LookupStats blocked = modelLookups(cellQueries, radius, true, true);
+
+            logInfo("Cell size {}x radius: cube {:.1f} cells / {:.1f} lines, tight {:.1f} cells / {:.1f} lines, tight blocked {:.1f} cells / {:.1f} lines",
+                cellSizeFactor, cube.cells, cube.cacheLines, tight.cells, tight.cacheLines, blocked.cells, blocked.cacheLines);
+
+            EXPECT_LT(tight.cells, cube.cells);
+            EXPECT_LE(tight.cacheLines, cube.cacheLines);
+            EXPECT_EQ(blocked.cells, tight.cells);
+            EXPECT_LT(blocked.cacheLines, tight.cacheLines);
+        }
+    }
+}
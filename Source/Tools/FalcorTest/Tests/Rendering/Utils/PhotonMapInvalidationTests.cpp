@@ -0,0 +1,281 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Utils/PhotonMapInvalidation.h"
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+
+namespace Falcor
+{
+    namespace
+    {
+        using Action = PhotonMapInvalidation::Action;
+
+        // Box with 10 m edges and three unit cubes in it.
+        const AABB kSceneBounds(float3(0.f), float3(10.f));
+
+        AABB unitCube(float3 p) { return AABB(p, p + float3(1.f)); }
+
+        uint32_t groupBits(std::initializer_list<PhotonLightGroup> groups)
+        {
+            uint32_t bits = 0;
+            for (PhotonLightGroup group : groups) bits |= 1u << (uint32_t)group;
+            return bits;
+        }
+
+        const uint32_t kAllGroups = groupBits({ PhotonLightGroup::Direct, PhotonLightGroup::Analytic, PhotonLightGroup::Emissive, PhotonLightGroup::EnvMap });
+
+        // Four analytic lights, two mesh lights and the environment map.
+        PhotonSourcePower testPower()
+        {
+            PhotonSourcePower power;
+            power.analytic = { 1.f, 1.f, 1.f, 0.f };
+            power.meshLights = { 2.f, 0.f };
+            power.env = 2.f;
+            return power;
+        }
+
+        PhotonMapInvalidation createTracker()
+        {
+            PhotonMapInvalidation tracker;
+            tracker.reset(testPower(), { unitCube(float3(1.f)), unitCube(float3(5.f)), unitCube(float3(8.f)) }, kSceneBounds);
+            return tracker;
+        }
+
+        bool contains(const AABB& outer, const AABB& inner)
+        {
+            AABB merged = outer;
+            merged |= inner;
+            return merged == outer;
+        }
+    }
+
+    CPU_TEST(PhotonMapInvalidationLights)
+    {
+        PhotonMapInvalidation tracker = createTracker();
+
+        // No change keeps the accumulated image.
+        PhotonMapInvalidation::Decision d = tracker.update(PhotonSceneUpdate());
+        EXPECT(d.action == Action::None);
+        EXPECT_EQ(d.resetGroups, 0u);
+        EXPECT(!d.rebuildLightSampling);
+
+        // An intensity tweak restarts the analytic group and the direct light of the vbuffer.
+        PhotonSceneUpdate update;
+        update.flags = Scene::UpdateFlags::LightIntensityChanged;
+        update.analyticPower = { 1.5f, 1.f, 1.f, 0.f };
+        d = tracker.update(update);
+        EXPECT(d.action == Action::Invalidate);
+        EXPECT_EQ(d.resetGroups, groupBits({ PhotonLightGroup::Direct, PhotonLightGroup::Analytic }));
+        EXPECT(d.resetBounds.empty());
+        EXPECT(d.rebuildLightSampling);
+
+        // The tracker keeps the new power, so the same state again is no change.
+        d = tracker.update(update);
+        EXPECT(d.action == Action::None);
+
+        // A moved light restarts its group, a moved light without power does not.
+        update.flags = Scene::UpdateFlags::LightsMoved;
+        update.movedAnalyticLights = { 1 };
+        d = tracker.update(update);
+        EXPECT_EQ(d.resetGroups, groupBits({ PhotonLightGroup::Direct, PhotonLightGroup::Analytic }));
+
+        update.movedAnalyticLights = { 3 };
+        EXPECT(tracker.update(update).action == Action::None);
+
+        // Mesh lights come from the light collection update list.
+        update = PhotonSceneUpdate();
+        update.flags = Scene::UpdateFlags::LightCollectionChanged;
+        update.movedMeshLights = { 0 };
+        d = tracker.update(update);
+        EXPECT(d.action == Action::Invalidate);
+        EXPECT_EQ(d.resetGroups, groupBits({ PhotonLightGroup::Direct, PhotonLightGroup::Emissive }));
+
+        update.movedMeshLights = { 1 };
+        EXPECT(tracker.update(update).action == Action::None);
+
+        // The environment map restarts its own group.
+        update = PhotonSceneUpdate();
+        update.flags = Scene::UpdateFlags::EnvMapPropertiesChanged;
+        d = tracker.update(update);
+        EXPECT(d.action == Action::Invalidate);
+        EXPECT_EQ(d.resetGroups, groupBits({ PhotonLightGroup::Direct, PhotonLightGroup::EnvMap }));
+        EXPECT(d.rebuildLightSampling);
+
+        // All light groups changing at once restarts.
+        update = PhotonSceneUpdate();
+        update.flags = Scene::UpdateFlags::LightsMoved | Scene::UpdateFlags::LightCollectionChanged | Scene::UpdateFlags::EnvMapPropertiesChanged;
+        update.analyticPower = { 1.5f, 1.f, 1.f, 0.f };
+        update.movedAnalyticLights = { 0 };
+        update.movedMeshLights = { 0 };
+        d = tracker.update(update);
+        EXPECT(d.action == Action::Restart);
+        EXPECT_EQ(d.resetGroups, kAllGroups);
+    }
+
+    CPU_TEST(PhotonMapInvalidationTurntable)
+    {
+        // A unit cube circles the scene center for one turn, one degree per frame. Every frame only the region
+        // the cube swept over restarts, grown by the margin, and the other cubes keep their iterations.
+        const float3 center(4.5f, 1.f, 4.5f);
+        auto cubeAt = [&](float degrees)
+        {
+            const float phi = degrees * float(M_PI) / 180.f;
+            return unitCube(center + 3.f * float3(std::cos(phi), 0.f, std::sin(phi)));
+        };
+
+        PhotonMapInvalidation tracker;
+        tracker.reset(testPower(), { cubeAt(0.f), unitCube(float3(5.f, 8.f, 5.f)), unitCube(float3(8.f)) }, kSceneBounds);
+
+        for (uint32_t frame = 1; frame <= 360; frame++)
+        {
+            PhotonSceneUpdate update;
+            update.flags = Scene::UpdateFlags::GeometryMoved | Scene::UpdateFlags::SceneGraphChanged;
+            update.movedInstances.emplace_back(0, cubeAt(float(frame)));
+
+            PhotonMapInvalidation::Decision d = tracker.update(update);
+            EXPECT(d.action == Action::Invalidate) << "frame " << frame;
+            EXPECT_EQ(d.resetGroups, 0u);
+            EXPECT(!d.rebuildLightSampling);
+            EXPECT_EQ(d.resetBounds.size(), 1u);
+            if (d.resetBounds.size() != 1) continue;
+
+            // The old and the new cube, grown by half the largest swept extent on every side.
+            const AABB& bounds = d.resetBounds[0];
+            EXPECT(contains(bounds, cubeAt(float(frame - 1))) && contains(bounds, cubeAt(float(frame)))) << "frame " << frame;
+            const float3 extent = bounds.extent();
+            EXPECT(extent.y > 2.f && extent.y < 2.06f) << "frame " << frame << ", extent.y = " << extent.y;
+            EXPECT(extent.x < 2.2f && extent.z < 2.2f) << "frame " << frame;
+            EXPECT(!contains(bounds, unitCube(float3(5.f, 8.f, 5.f))) && !contains(bounds, unitCube(float3(8.f)))) << "frame " << frame;
+        }
+
+        // The margin is configurable.
+        tracker.setResetMargin(0.f);
+        PhotonSceneUpdate update;
+        update.flags = Scene::UpdateFlags::GeometryMoved;
+        update.movedInstances.emplace_back(0, cubeAt(360.f));
+        PhotonMapInvalidation::Decision d = tracker.update(update);
+        EXPECT(d.resetBounds.size() == 1 && d.resetBounds[0] == cubeAt(360.f));
+
+        // A jump across the scene sweeps a large box and restarts.
+        update.movedInstances[0].second = unitCube(float3(0.f, 8.f, 0.f));
+        d = tracker.update(update);
+        EXPECT(d.action == Action::Restart);
+        EXPECT(d.resetBounds.empty());
+    }
+
+    CPU_TEST(PhotonMapInvalidationRestart)
+    {
+        // Changes that cannot be localized restart.
+        const Scene::UpdateFlags restartFlags[] = { Scene::UpdateFlags::MaterialsChanged, Scene::UpdateFlags::GeometryChanged, Scene::UpdateFlags::MeshesChanged, Scene::UpdateFlags::RenderSettingsChanged };
+        for (Scene::UpdateFlags flags : restartFlags)
+        {
+            PhotonMapInvalidation tracker = createTracker();
+            PhotonSceneUpdate update;
+            update.flags = flags;
+            PhotonMapInvalidation::Decision d = tracker.update(update);
+            EXPECT(d.action == Action::Restart) << "flags = " << (uint32_t)flags;
+            EXPECT_EQ(d.resetGroups, kAllGroups);
+        }
+
+        // Added lights and unknown instances restart.
+        PhotonMapInvalidation tracker = createTracker();
+        PhotonSceneUpdate update;
+        update.flags = Scene::UpdateFlags::LightCountChanged;
+        update.analyticPower = { 1.f, 1.f, 1.f, 0.f, 1.f };
+        PhotonMapInvalidation::Decision d = tracker.update(update);
+        EXPECT(d.action == Action::Restart);
+        EXPECT(d.rebuildLightSampling);
+
+        tracker = createTracker();
+        update = PhotonSceneUpdate();
+        update.flags = Scene::UpdateFlags::GeometryMoved;
+        update.movedInstances.emplace_back(3, unitCube(float3(2.f)));
+        EXPECT(tracker.update(update).action == Action::Restart);
+
+        tracker = createTracker();
+        update = PhotonSceneUpdate();
+        update.flags = Scene::UpdateFlags::LightCollectionChanged;
+        update.movedMeshLights = { 2 };
+        EXPECT(tracker.update(update).action == Action::Restart);
+
+        // Camera changes are handled by the photon mappers themselves.
+        tracker = createTracker();
+        update = PhotonSceneUpdate();
+        update.flags = Scene::UpdateFlags::CameraMoved;
+        EXPECT(tracker.update(update).action == Action::None);
+    }
+
+    CPU_TEST(PhotonMapInvalidationResetRegions)
+    {
+        // With the identity matrix the device coordinates are the world x and y.
+        const uint2 frameDim(100, 50);
+        rmcv::mat4 viewProj = rmcv::identity<rmcv::mat4>();
+
+        std::vector<uint4> regions = PhotonMapInvalidation::getResetRegions({ AABB(float3(-0.5f, 0.f, 0.f), float3(0.5f, 0.5f, 0.5f)) }, viewProj, frameDim);
+        EXPECT(regions.size() == 1 && regions[0] == uint4(25, 12, 75, 25));
+
+        // Regions are clipped to the frame, regions outside of it are dropped.
+        regions = PhotonMapInvalidation::getResetRegions({ AABB(float3(0.5f, -2.f, 0.f), float3(2.f, 2.f, 0.f)), AABB(float3(1.5f, 0.f, 0.f), float3(2.f, 1.f, 0.f)) }, viewProj, frameDim);
+        EXPECT(regions.size() == 1 && regions[0] == uint4(75, 0, 100, 50));
+
+        // Beyond the limit the regions are merged into the last one.
+        std::vector<AABB> bounds;
+        for (uint32_t i = 0; i <= kMaxPhotonResetRegions; i++)
+        {
+            const float x = -1.f + 0.2f * i;
+            bounds.emplace_back(float3(x, 0.f, 0.f), float3(x + 0.1f, 0.1f, 0.f));
+        }
+        regions = PhotonMapInvalidation::getResetRegions(bounds, viewProj, frameDim);
+        EXPECT_EQ(regions.size(), (size_t)kMaxPhotonResetRegions);
+        if (regions.size() == kMaxPhotonResetRegions) EXPECT(regions.back() == uint4(70, 22, 85, 25));
+
+        // A region that reaches behind the camera covers the whole frame.
+        viewProj[3] = float4(0.f, 0.f, 1.f, 0.f);
+        regions = PhotonMapInvalidation::getResetRegions({ AABB(float3(0.f, 0.f, -1.f), float3(1.f, 1.f, 1.f)) }, viewProj, frameDim);
+        EXPECT(regions.size() == 1 && regions[0] == uint4(0, 0, 100, 50));
+    }
+
+    CPU_TEST(PhotonLightGroupEncoding)
+    {
+        // The light group survives the rounding of a 16-bit photon texture, the face normal angle is unchanged.
+        for (uint32_t group = 0; group < (uint32_t)PhotonLightGroup::Count; group++)
+        {
+            for (float theta : { 0.f, 0.5f, 1.f, 2.f, float(M_PI) })
+            {
+                const float encoded = encodePhotonLightGroup(theta, group);
+                EXPECT_EQ(decodePhotonLightGroup(encoded), group) << "theta = " << theta;
+                EXPECT_EQ(decodePhotonLightGroup(encoded + 0.02f), group) << "theta = " << theta;
+                EXPECT_EQ(decodePhotonLightGroup(encoded - 0.02f), group) << "theta = " << theta;
+                EXPECT(std::abs(std::cos(encoded) - std::cos(theta)) < 1e-5f) << "theta = " << theta << ", group = " << group;
+                EXPECT(std::abs(std::sin(encoded) - std::sin(theta)) < 1e-5f) << "theta = " << theta << ", group = " << group;
+            }
+        }
+    }
+}
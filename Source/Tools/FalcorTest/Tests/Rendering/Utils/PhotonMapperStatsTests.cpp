@@ -0,0 +1,64 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Utils/PhotonMapperStats.h"
+
+namespace Falcor
+{
+    CPU_TEST(PhotonMapperStatsCounters)
+    {
+        uint32_t counters[(uint32_t)PhotonStatsCounter::Count] = {};
+        counters[(uint32_t)PhotonStatsCounter::Emitted] = 1000;
+        counters[(uint32_t)PhotonStatsCounter::StoredCaustic] = 120;
+        counters[(uint32_t)PhotonStatsCounter::StoredGlobal] = 640;
+        counters[(uint32_t)PhotonStatsCounter::Culled] = 900;
+        counters[(uint32_t)PhotonStatsCounter::Dropped] = 15;
+        counters[(uint32_t)PhotonStatsCounter::PathVertices] = 2500;
+
+        PhotonMapperStats::Stats stats;
+        stats.setCounters(counters);
+        EXPECT_EQ(stats.photonsEmitted, 1000u);
+        EXPECT_EQ(stats.causticPhotons, 120u);
+        EXPECT_EQ(stats.globalPhotons, 640u);
+        EXPECT_EQ(stats.culledPhotons, 900u);
+        EXPECT_EQ(stats.droppedPhotons, 15u);
+        EXPECT_EQ(stats.pathVertices, 2500u);
+        EXPECT_EQ(stats.avgPathDepth, 2.5f);
+    }
+
+    CPU_TEST(PhotonMapperStatsNoPhotons)
+    {
+        // Nothing emitted, e.g. a scene without lights. The average must not divide by zero.
+        uint32_t counters[(uint32_t)PhotonStatsCounter::Count] = {};
+
+        PhotonMapperStats::Stats stats;
+        stats.setCounters(counters);
+        EXPECT_EQ(stats.photonsEmitted, 0u);
+        EXPECT_EQ(stats.avgPathDepth, 0.f);
+    }
+}
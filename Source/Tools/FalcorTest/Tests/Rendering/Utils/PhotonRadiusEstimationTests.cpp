@@ -0,0 +1,106 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Utils/PhotonRadiusEstimation.h"
+#include <cmath>
+#include <random>
+
+namespace Falcor
+{
+    CPU_TEST(PhotonRadiusPixelFootprint)
+    {
+        // 24 mm film with a 12 mm lens: the image plane at distance d is d high.
+        EXPECT_EQ(photonPixelFootprint(10.f, 12.f, 24.f, 1000), 0.02f);
+        EXPECT_EQ(photonPixelFootprint(5.f, 12.f, 24.f, 1000), 0.01f);
+        EXPECT_EQ(photonPixelFootprint(10.f, 12.f, 24.f, 500), 0.04f);
+
+        EXPECT_EQ(photonPixelFootprint(10.f, 0.f, 24.f, 1000), 0.f);
+        EXPECT_EQ(photonPixelFootprint(10.f, 12.f, 24.f, 0), 0.f);
+    }
+
+    CPU_TEST(PhotonRadiusDensity)
+    {
+        // Photons spread uniformly over a unit square. The fraction of them in a disk of the
+        // density radius around the center has to match photonsPerQuery / photonCount.
+        const uint32_t photonCount = 200000;
+        const float photonsPerQuery = 50.f;
+        const float r = photonDensityRadius(float(photonCount), 1.f, photonsPerQuery);
+        EXPECT_LT(std::abs(float(M_PI) * r * r * photonCount - photonsPerQuery), 1e-3f);
+
+        std::mt19937 rng(7);
+        uint32_t inside = 0;
+        for (uint32_t i = 0; i < photonCount; i++)
+        {
+            float x = float(rng() / 4294967296.0) - 0.5f;
+            float y = float(rng() / 4294967296.0) - 0.5f;
+            if (x * x + y * y <= r * r) inside++;
+        }
+        // Poisson distributed with mean 50, so within 4 standard deviations.
+        EXPECT_LT(std::abs(float(inside) - photonsPerQuery), 4.f * std::sqrt(photonsPerQuery)) << "inside = " << inside;
+
+        EXPECT_EQ(photonDensityRadius(0.f, 1.f, photonsPerQuery), 0.f);
+    }
+
+    CPU_TEST(PhotonRadiusEstimateBounds)
+    {
+        const float area = 600.f;       // Box with 10 m edges.
+        const float sceneRadius = 8.66f;
+        const float maxRadius = 0.05f * sceneRadius;
+
+        // Unclamped: the radii follow the photon density.
+        PhotonRadiusEstimate e = estimatePhotonRadii(area, sceneRadius, 0.001f, 4000000, 1000000, 32.f);
+        EXPECT_LT(std::abs(e.globalRadius - photonDensityRadius(1000000.f, area, 32.f)), 1e-6f);
+        EXPECT_LT(std::abs(e.causticRadius - photonDensityRadius(4000000.f, area, 32.f)), 1e-6f);
+
+        // Four times the photons halve the radius.
+        PhotonRadiusEstimate e4 = estimatePhotonRadii(area, sceneRadius, 0.001f, 16000000, 4000000, 32.f);
+        EXPECT_LT(std::abs(e4.globalRadius - 0.5f * e.globalRadius), 1e-6f);
+        EXPECT_LT(std::abs(e4.causticRadius - 0.5f * e.causticRadius), 1e-6f);
+
+        // The pixel footprint is the lower bound.
+        e = estimatePhotonRadii(area, sceneRadius, 0.2f, 1000000, 4000000, 32.f);
+        EXPECT_EQ(e.globalRadius, 0.2f);
+        EXPECT_EQ(e.causticRadius, 0.2f);
+
+        // The scene size is the upper bound, the caustic radius is not larger than the global radius.
+        e = estimatePhotonRadii(area, sceneRadius, 0.001f, 100, 1000, 32.f);
+        EXPECT_EQ(e.globalRadius, maxRadius);
+        EXPECT_EQ(e.causticRadius, maxRadius);
+        e = estimatePhotonRadii(area, sceneRadius, 0.001f, 1000, 4000000, 32.f);
+        EXPECT_EQ(e.causticRadius, e.globalRadius);
+
+        // A footprint larger than the upper bound does not exceed it.
+        e = estimatePhotonRadii(area, sceneRadius, 10.f, 1000000, 4000000, 32.f);
+        EXPECT_EQ(e.globalRadius, maxRadius);
+
+        // Without photons the radii fall back to the upper bound.
+        e = estimatePhotonRadii(area, sceneRadius, 0.001f, 0, 0, 32.f);
+        EXPECT_EQ(e.globalRadius, maxRadius);
+        EXPECT_EQ(e.causticRadius, maxRadius);
+    }
+}
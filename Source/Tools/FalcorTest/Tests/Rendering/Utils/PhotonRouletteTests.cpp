@@ -0,0 +1,175 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Utils/PhotonRoulette.slang"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Uniform sample in [0,1) from the raw generator output so the stream is the same on all standard libraries.
+        */
+        float sampleUniform(std::mt19937& rng)
+        {
+            return float(rng() / 4294967296.0);
+        }
+
+        /** Toy scene for the photon roulette. Half of the photons start with flux 1, the other half with flux 0.1,
+            like photons of a bright and a dim light. Every bounce hits a diffuse surface with albedo 0.8 where the
+            photon may be stored as a global photon. The estimate is the sum of the stored flux, whose expected value
+            is the sum of the incident flux over all bounces.
+        */
+        const uint32_t kPhotonCount = 2000;
+        const uint32_t kMaxBounces = 10;
+        const float kAlbedo = 0.8f;
+        const float kRejectionProbability = 0.3f;
+        const float kBrightFlux = 1.f;
+        const float kDimFlux = 0.1f;
+        const float kReferenceFlux = 0.5f * (kBrightFlux + kDimFlux);
+
+        struct ToyResult
+        {
+            double estimate = 0.0;          ///< Sum of the stored flux.
+            uint32_t pathVertices = 0;      ///< Number of bounces of all photons, i.e. the generate cost.
+            std::vector<float> storedFlux;
+        };
+
+        double expectedToyEstimate()
+        {
+            double bounces = 0.0;
+            for (uint32_t i = 0; i < kMaxBounces; i++) bounces += std::pow(double(kAlbedo), double(i));
+            return 0.5 * kPhotonCount * (kBrightFlux + kDimFlux) * bounces;
+        }
+
+        /** Traces the photons of the toy scene like the photon generation shaders.
+            \param[in] fluxRoulette Use the flux-aware probabilities, else terminate by throughput and store with the fixed probability.
+        */
+        ToyResult traceToyScene(std::mt19937& rng, bool fluxRoulette)
+        {
+            ToyResult result;
+            for (uint32_t i = 0; i < kPhotonCount; i++)
+            {
+                const float lightFlux = (i % 2 == 0) ? kBrightFlux : kDimFlux;
+                float thp = 1.f;
+                for (uint32_t bounce = 0; bounce < kMaxBounces; bounce++)
+                {
+                    result.pathVertices++;
+
+                    const float flux = lightFlux * thp;
+                    const float storeProbability = fluxRoulette ? photonStoreProbability(flux, kReferenceFlux, kRejectionProbability) : kRejectionProbability;
+                    if (sampleUniform(rng) < storeProbability)
+                    {
+                        result.estimate += flux / storeProbability;
+                        result.storedFlux.push_back(flux / storeProbability);
+                    }
+
+                    thp *= kAlbedo;
+                    const float survival = fluxRoulette ? photonSurvivalProbability(lightFlux * thp, kReferenceFlux) : saturate(thp);
+                    if (sampleUniform(rng) >= survival) break;
+                    thp /= survival;
+                }
+            }
+            return result;
+        }
+
+        struct ToyStats
+        {
+            double mean = 0.0;
+            double variance = 0.0;
+            double pathVertices = 0.0;      ///< Average per run.
+            float minStoredFlux = 0.f;
+            float maxStoredFlux = 0.f;
+        };
+
+        ToyStats runToyScene(bool fluxRoulette, uint32_t runs)
+        {
+            std::mt19937 rng(11);
+            std::vector<double> estimates;
+            ToyStats stats;
+            stats.minStoredFlux = 1e30f;
+            for (uint32_t run = 0; run < runs; run++)
+            {
+                ToyResult result = traceToyScene(rng, fluxRoulette);
+                estimates.push_back(result.estimate);
+                stats.pathVertices += result.pathVertices;
+                for (float f : result.storedFlux)
+                {
+                    stats.minStoredFlux = std::min(stats.minStoredFlux, f);
+                    stats.maxStoredFlux = std::max(stats.maxStoredFlux, f);
+                }
+            }
+            for (double e : estimates) stats.mean += e;
+            stats.mean /= runs;
+            for (double e : estimates) stats.variance += (e - stats.mean) * (e - stats.mean);
+            stats.variance /= runs - 1;
+            stats.pathVertices /= runs;
+            return stats;
+        }
+    }
+
+    CPU_TEST(PhotonRouletteProbabilities)
+    {
+        EXPECT_EQ(photonSurvivalProbability(0.25f, 0.5f), 0.5f);
+        EXPECT_EQ(photonSurvivalProbability(2.f, 0.5f), 1.f);
+        EXPECT_EQ(photonSurvivalProbability(0.f, 0.5f), 0.f);
+        EXPECT_EQ(photonSurvivalProbability(0.25f, 0.f), 1.f);
+
+        EXPECT_EQ(photonStoreProbability(0.5f, 0.5f, 0.3f), 0.3f);
+        EXPECT_EQ(photonStoreProbability(0.25f, 0.5f, 0.5f), 0.25f);
+        EXPECT_EQ(photonStoreProbability(10.f, 0.5f, 0.3f), 1.f);
+        EXPECT_EQ(photonStoreProbability(0.25f, 0.f, 0.3f), 0.3f);
+    }
+
+    CPU_TEST(PhotonRouletteToyScene)
+    {
+        const uint32_t runs = 200;
+        const double expected = expectedToyEstimate();
+        ToyStats throughput = runToyScene(false, runs);
+        ToyStats flux = runToyScene(true, runs);
+
+        // Both policies are unbiased.
+        EXPECT_LT(std::abs(throughput.mean - expected), 4.0 * std::sqrt(throughput.variance / runs)) << "mean = " << throughput.mean << ", expected = " << expected;
+        EXPECT_LT(std::abs(flux.mean - expected), 4.0 * std::sqrt(flux.variance / runs)) << "mean = " << flux.mean << ", expected = " << expected;
+
+        // All photons are dimmer than referenceFlux / rejectionProbability, so the flux roulette stores them with exactly that flux.
+        const float uniformFlux = kReferenceFlux / kRejectionProbability;
+        EXPECT_LT(std::abs(flux.minStoredFlux - uniformFlux), 1e-5f * uniformFlux);
+        EXPECT_LT(std::abs(flux.maxStoredFlux - uniformFlux), 1e-5f * uniformFlux);
+        EXPECT_GT(throughput.maxStoredFlux, 5.f * throughput.minStoredFlux);
+
+        // The flux roulette spends fewer bounces and has a lower variance, so it reaches the same error for less work.
+        EXPECT_LT(flux.pathVertices, throughput.pathVertices);
+        EXPECT_LT(flux.variance, throughput.variance);
+        EXPECT_LT(flux.variance * flux.pathVertices, 0.75 * throughput.variance * throughput.pathVertices)
+            << "flux = " << flux.variance * flux.pathVertices << ", throughput = " << throughput.variance * throughput.pathVertices;
+    }
+}
@@ -0,0 +1,152 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Rendering/Utils/ProgressiveAccumulation.slang"
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kIterations = 100000;
+
+        /** Exponentially distributed sample with mean 1, from the raw generator output
+            so the stream is the same on all standard libraries.
+        */
+        float sampleExponential(std::mt19937& rng)
+        {
+            double u = (rng() + 0.5) / 4294967296.0;
+            return float(-std::log(u));
+        }
+
+        double relativeError(float value, double reference)
+        {
+            return std::abs(value - reference) / std::abs(reference);
+        }
+
+        /** Accumulates a stream with a compensated sum and returns the relative error
+            of its mean against a double precision reference.
+        */
+        template<typename Generator>
+        double accumulateCompensated(Generator next)
+        {
+            CompensatedSum sum = { float4(0.f), float4(0.f) };
+            double reference = 0.0;
+
+            for (uint32_t i = 0; i < kIterations; i++)
+            {
+                float value = next();
+                sum = compensatedSumAdd(sum, float4(value));
+                reference += value;
+            }
+            reference /= kIterations;
+
+            float compensatedMean = sum.sum.x / float(kIterations);
+            return relativeError(compensatedMean, reference);
+        }
+
+        /** Same update as runningMeanUpdate(), rounded to float after every operation like on the GPU.
+            The volatile temporaries keep the compiler from contracting the multiply-add, which would
+            change how much the mean drifts.
+        */
+        float runningMeanStep(float mean, float value, uint32_t count)
+        {
+            volatile float n = float(count);
+            volatile float product = mean * n;
+            volatile float sum = product + value;
+            volatile float nextCount = n + 1.f;
+            return sum / nextCount;
+        }
+    }
+
+    CPU_TEST(ProgressiveAccumulationRunningMean)
+    {
+        // Values that are exact in float.
+        float4 mean = runningMeanUpdate(float4(0.f), float4(1.f), 0);
+        EXPECT_EQ(mean.x, 1.f);
+        mean = runningMeanUpdate(mean, float4(2.f), 1);
+        EXPECT_EQ(mean.x, 1.5f);
+        mean = runningMeanUpdate(mean, float4(3.f), 2);
+        EXPECT_EQ(mean.x, 2.f);
+    }
+
+    CPU_TEST(ProgressiveAccumulationDrift)
+    {
+        // The running mean of a constant image drifts away from the constant, the compensated sum keeps it.
+        const uint32_t iterations = 1000000;
+        const float value = 0.7f;
+        float mean = 0.f;
+        CompensatedSum sum = { float4(0.f), float4(0.f) };
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            mean = runningMeanStep(mean, value, i);
+            sum = compensatedSumAdd(sum, float4(value));
+        }
+
+        double drift = relativeError(mean, value);
+        double compensatedError = relativeError(sum.sum.x / float(iterations), value);
+        EXPECT_GT(drift, 1e-3) << "running mean error = " << drift;
+        EXPECT_LT(compensatedError * 1000, drift) << "compensated error = " << compensatedError << ", running mean error = " << drift;
+    }
+
+    CPU_TEST(ProgressiveAccumulationConstant)
+    {
+        // A constant image has to stay constant.
+        EXPECT_LE(accumulateCompensated([]() { return 0.7f; }), 1e-6);
+    }
+
+    CPU_TEST(ProgressiveAccumulationExponential)
+    {
+        // Heavy-tailed stream, similar to the radiance estimates of a photon mapper.
+        std::mt19937 rng(1234);
+        EXPECT_LE(accumulateCompensated([&rng]() { return sampleExponential(rng); }), 1e-6);
+    }
+
+    CPU_TEST(ProgressiveAccumulationVariance)
+    {
+        EXPECT_EQ(varianceOfMean(float4(1.f), float4(1.f), 1).x, 0.f);
+        // Constant samples have no variance.
+        EXPECT_LE(varianceOfMean(float4(0.3f * 1000), float4(0.09f * 1000), 1000).x, 1e-9f);
+
+        // Uniform samples in [0,1) have variance 1/12.
+        std::mt19937 rng(5678);
+        const uint32_t n = 10000;
+        float4 sum(0.f);
+        float4 sumSq(0.f);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            float value = float(rng() / 4294967296.0);
+            sum = sum + float4(value);
+            sumSq = sumSq + float4(value * value);
+        }
+        float varianceOfMeanX = varianceOfMean(sum, sumSq, n).x;
+        EXPECT_LE(std::abs(varianceOfMeanX * n - 1.f / 12.f), 0.005f) << "variance = " << varianceOfMeanX * n;
+    }
+}
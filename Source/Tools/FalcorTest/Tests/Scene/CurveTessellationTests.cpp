@@ -0,0 +1,172 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Curves/CurveTessellation.h"
+#include "Utils/Logger.h"
+#include "Utils/Timing/CpuTimer.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        struct Groom
+        {
+            std::vector<uint32_t> vertexCounts;
+            std::vector<float3> points;
+            std::vector<float> widths;
+            std::vector<float2> UVs;
+
+            uint32_t getStrandCount() const { return (uint32_t)vertexCounts.size(); }
+        };
+
+        /** Create a synthetic groom of wavy strands on a square patch.
+            Some strands contain repeated control points, which are removed during tessellation.
+        */
+        Groom createGroom(uint32_t strandCount, uint32_t maxVertexCount)
+        {
+            Groom groom;
+            uint32_t seed = 1;
+            auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (float)(seed >> 8) / 16777216.f; };
+            uint32_t side = (uint32_t)std::ceil(std::sqrt((float)strandCount));
+            for (uint32_t i = 0; i < strandCount; ++i)
+            {
+                uint32_t vertexCount = 2 + (uint32_t)(random() * (maxVertexCount - 1));
+                float3 root = float3((float)(i % side), 0.f, (float)(i / side)) * 0.01f;
+                float phase = random() * 6.f;
+                groom.vertexCounts.push_back(vertexCount);
+                for (uint32_t j = 0; j < vertexCount; ++j)
+                {
+                    float3 p = root + float3(0.002f * std::sin(phase + j), 0.01f * j, 0.002f * std::cos(phase + 0.5f * j));
+                    if (j > 0 && random() < 0.05f) p = groom.points.back();
+                    groom.points.push_back(p);
+                    groom.widths.push_back(0.001f * (1.f - 0.5f * j / vertexCount));
+                    groom.UVs.push_back(float2(root.x, root.z));
+                }
+            }
+            return groom;
+        }
+
+        /** Create a straight strand along the y-axis with a degenerate strand (a single repeated point) before it.
+        */
+        Groom createStraightStrand()
+        {
+            Groom groom;
+            groom.vertexCounts = { 3, 4 };
+            groom.points = { float3(1.f), float3(1.f), float3(1.f), float3(0.f, 0.f, 0.f), float3(0.f, 1.f, 0.f), float3(0.f, 2.f, 0.f), float3(0.f, 3.f, 0.f) };
+            groom.widths = std::vector<float>(groom.points.size(), 0.5f);
+            groom.UVs = { float2(0.f), float2(0.f), float2(0.f), float2(0.f, 0.f), float2(0.f, 1.f), float2(0.f, 2.f), float2(0.f, 3.f) };
+            return groom;
+        }
+    }
+
+    CPU_TEST(CurveTessellationSweptSphere)
+    {
+        Groom groom = createStraightStrand();
+        auto result = CurveTessellation::convertToLinearSweptSphere(groom.getStrandCount(), groom.vertexCounts.data(), groom.points.data(), groom.widths.data(), groom.UVs.data(), 1, 4, 1, 1, 1.f, rmcv::identity<rmcv::mat4>());
+
+        // The degenerate strand is skipped, the straight strand has 3 segments with 4 sub-segments each.
+        EXPECT_EQ(result.points.size(), 13);
+        EXPECT_EQ(result.radius.size(), 13);
+        EXPECT_EQ(result.texCrds.size(), 13);
+        EXPECT_EQ(result.indices.size(), 12);
+        for (uint32_t i = 0; i < result.points.size(); ++i)
+        {
+            EXPECT_EQ(result.points[i].x, 0.f);
+            EXPECT_EQ(result.points[i].z, 0.f);
+            EXPECT_EQ(result.radius[i], 0.25f);
+            if (i > 0) EXPECT_GT(result.points[i].y, result.points[i - 1].y);
+            if (i < result.indices.size()) EXPECT_EQ(result.indices[i], i);
+        }
+        EXPECT(std::abs(result.points.back().y - 3.f) < 1e-5f);
+        EXPECT(std::abs(result.texCrds.back().y - 3.f) < 1e-5f);
+
+        // Keep every other strand and every third sample.
+        Groom groom2 = createGroom(100, 10);
+        auto result2 = CurveTessellation::convertToLinearSweptSphere(groom2.getStrandCount(), groom2.vertexCounts.data(), groom2.points.data(), groom2.widths.data(), nullptr, 1, 4, 2, 3, 1.f, rmcv::identity<rmcv::mat4>());
+        EXPECT(result2.texCrds.empty());
+        EXPECT_EQ(result2.radius.size(), result2.points.size());
+
+        // Segment indices refer to all but the last point of each strand.
+        size_t strandCount = result2.points.size() - result2.indices.size();
+        EXPECT(strandCount > 0 && strandCount <= 50);
+        for (uint32_t index : result2.indices) EXPECT(index + 1 < result2.points.size());
+    }
+
+    CPU_TEST(CurveTessellationPolytube)
+    {
+        const uint32_t kPointCountPerCrossSection = 4;
+        Groom groom = createStraightStrand();
+        auto result = CurveTessellation::convertToPolytube(groom.getStrandCount(), groom.vertexCounts.data(), groom.points.data(), groom.widths.data(), groom.UVs.data(), 4, 1, 1, 1.f, kPointCountPerCrossSection);
+
+        // 13 cross-sections connected by 12 rings of quads.
+        EXPECT_EQ(result.vertices.size(), 13 * kPointCountPerCrossSection);
+        EXPECT_EQ(result.normals.size(), result.vertices.size());
+        EXPECT_EQ(result.tangents.size(), result.vertices.size());
+        EXPECT_EQ(result.radii.size(), result.vertices.size());
+        EXPECT_EQ(result.texCrds.size(), result.vertices.size());
+        EXPECT_EQ(result.faceVertexCounts.size(), 12 * 2 * kPointCountPerCrossSection);
+        EXPECT_EQ(result.faceVertexIndices.size(), 3 * result.faceVertexCounts.size());
+        for (uint32_t count : result.faceVertexCounts) EXPECT_EQ(count, 3);
+        for (uint32_t index : result.faceVertexIndices) EXPECT(index < result.vertices.size());
+
+        // The vertices of each cross-section are on a circle around the straight strand.
+        for (size_t i = 0; i < result.vertices.size(); ++i)
+        {
+            const float3& v = result.vertices[i];
+            EXPECT(std::abs(std::sqrt(v.x * v.x + v.z * v.z) - result.radii[i]) < 1e-5f);
+            EXPECT(std::abs(result.tangents[i].y - 1.f) < 1e-5f);
+        }
+
+        // The output does not depend on how strands are scheduled.
+        Groom groom2 = createGroom(1000, 10);
+        auto a = CurveTessellation::convertToPolytube(groom2.getStrandCount(), groom2.vertexCounts.data(), groom2.points.data(), groom2.widths.data(), groom2.UVs.data(), 2, 1, 1, 1.f, kPointCountPerCrossSection);
+        auto b = CurveTessellation::convertToPolytube(groom2.getStrandCount(), groom2.vertexCounts.data(), groom2.points.data(), groom2.widths.data(), groom2.UVs.data(), 2, 1, 1, 1.f, kPointCountPerCrossSection);
+        EXPECT(a.vertices == b.vertices);
+        EXPECT(a.faceVertexIndices == b.faceVertexIndices);
+    }
+
+    CPU_TEST(CurveTessellationBenchmark, "Benchmark; run manually")
+    {
+        Groom groom = createGroom(500000, 16);
+        logInfo("CurveTessellationBenchmark: {} strands, {} control points", groom.getStrandCount(), groom.points.size());
+
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        auto spheres = CurveTessellation::convertToLinearSweptSphere(groom.getStrandCount(), groom.vertexCounts.data(), groom.points.data(), groom.widths.data(), groom.UVs.data(), 1, 2, 1, 1, 1.f, rmcv::identity<rmcv::mat4>());
+        double time = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        logInfo("CurveTessellationBenchmark: swept spheres {:10} points {:10.2f} ms", spheres.points.size(), time);
+
+        // Keep every fourth strand for the mesh to bound the memory footprint.
+        startTime = CpuTimer::getCurrentTimePoint();
+        auto mesh = CurveTessellation::convertToPolytube(groom.getStrandCount(), groom.vertexCounts.data(), groom.points.data(), groom.widths.data(), groom.UVs.data(), 2, 4, 1, 1.f, 4);
+        time = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        logInfo("CurveTessellationBenchmark: polytube {:10} vertices {:10.2f} ms", mesh.vertices.size(), time);
+
+        EXPECT_EQ(spheres.radius.size(), spheres.points.size());
+        EXPECT_EQ(mesh.faceVertexIndices.size(), 3 * mesh.faceVertexCounts.size());
+    }
+}
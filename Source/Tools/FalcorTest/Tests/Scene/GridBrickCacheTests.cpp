@@ -0,0 +1,142 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Volume/Grid.h"
+#include "Scene/Volume/GridBrickCache.h"
+#include "Utils/Timing/CpuTimer.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4146 4244 4267 4275 4996)
+#endif
+#include <nanovdb/util/IO.h>
+// See Grid.cpp for this workaround.
+#define result_of invoke_result
+#include <nanovdb/util/GridBuilder.h>
+#undef result_of
+#include <nanovdb/util/Primitives.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <cstring>
+
+namespace Falcor
+{
+    namespace
+    {
+        const std::string kGridName = "density";
+
+        std::vector<std::vector<uint8_t>> readBricks(GPUUnitTestContext& ctx, const Grid::SharedPtr& pGrid)
+        {
+            RenderContext* pRenderContext = ctx.getRenderContext();
+            const BrickedGrid& bricks = pGrid->getBrickedGrid();
+            return {
+                pRenderContext->readTextureSubresource(bricks.range.get(), 0),
+                pRenderContext->readTextureSubresource(bricks.indirection.get(), 0),
+                pRenderContext->readTextureSubresource(bricks.atlas.get(), 0),
+            };
+        }
+
+        std::filesystem::path writeSphereGrid(float radius)
+        {
+            auto path = std::filesystem::temp_directory_path() / fmt::format("GridBrickCacheTests_{}.nvdb", radius);
+            auto handle = nanovdb::createFogVolumeSphere<float>(radius, nanovdb::Vec3f(0.f), 1.f, 3.f, nanovdb::Vec3d(0.0), kGridName);
+            nanovdb::io::writeGrid(path.string(), handle);
+            return path;
+        }
+    }
+
+    GPU_TEST(GridBrickCache)
+    {
+        auto path = writeSphereGrid(60.f);
+        auto key = GridBrickCache::computeKey(path, kGridName);
+        auto cachePath = GridBrickCache::getCachePath(key);
+        std::filesystem::remove(cachePath);
+
+        // The key depends on the file content and grid name.
+        EXPECT(key != GridBrickCache::computeKey(path, "other"));
+
+        // Loading without the cache must not create a cache file.
+        auto pReference = Grid::createFromFile(path, kGridName, false);
+        EXPECT(pReference != nullptr);
+        EXPECT(!std::filesystem::exists(cachePath));
+        auto reference = readBricks(ctx, pReference);
+
+        // Loading with the cache converts the grid and writes the cache file, which can then be read back.
+        auto pConverted = Grid::createFromFile(path, kGridName);
+        EXPECT(std::filesystem::exists(cachePath));
+        auto pCached = GridBrickCache::readGrid(key);
+        EXPECT(pCached != nullptr);
+        if (!pConverted || !pCached) return;
+
+        EXPECT(readBricks(ctx, pConverted) == reference);
+        EXPECT(readBricks(ctx, pCached) == reference);
+        EXPECT_EQ(pCached->getVoxelCount(), pReference->getVoxelCount());
+        EXPECT_EQ(pCached->getMinValue(), pReference->getMinValue());
+        EXPECT_EQ(pCached->getMaxValue(), pReference->getMaxValue());
+        EXPECT(pCached->getGridHandle().size() == pReference->getGridHandle().size());
+        EXPECT(std::memcmp(pCached->getGridHandle().data(), pReference->getGridHandle().data(), pReference->getGridHandle().size()) == 0);
+
+        // A truncated cache file is ignored and replaced.
+        std::filesystem::resize_file(cachePath, std::filesystem::file_size(cachePath) / 2);
+        EXPECT(GridBrickCache::readGrid(key) == nullptr);
+        auto pReconverted = Grid::createFromFile(path, kGridName);
+        EXPECT(pReconverted != nullptr);
+        EXPECT(GridBrickCache::readGrid(key) != nullptr);
+
+        std::filesystem::remove(cachePath);
+        std::filesystem::remove(path);
+    }
+
+    GPU_TEST(GridBrickCacheBenchmark, "Benchmark; run manually")
+    {
+        auto path = writeSphereGrid(400.f);
+        auto cachePath = GridBrickCache::getCachePath(GridBrickCache::computeKey(path, kGridName));
+        std::filesystem::remove(cachePath);
+
+        auto load = [&](const char* name, bool useCache)
+        {
+            auto t0 = CpuTimer::getCurrentTimePoint();
+            auto pGrid = Grid::createFromFile(path, kGridName, useCache);
+            ctx.getRenderContext()->flush(true);
+            double ms = CpuTimer::calcDuration(t0, CpuTimer::getCurrentTimePoint());
+            EXPECT(pGrid != nullptr);
+            logInfo("GridBrickCache {}: {:.1f} ms", name, ms);
+            return ms;
+        };
+
+        load("no cache", false);
+        load("cold cache", true);
+        double cached = load("warm cache", true);
+        logInfo("GridBrickCache file size: {:.1f} MB, warm load {:.1f} ms", std::filesystem::file_size(cachePath) / (1024.0 * 1024.0), cached);
+
+        std::filesystem::remove(cachePath);
+        std::filesystem::remove(path);
+    }
+}
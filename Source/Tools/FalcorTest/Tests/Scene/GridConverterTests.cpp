@@ -0,0 +1,152 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Volume/GridConverter.h"
+#include "Utils/Timing/CpuTimer.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4146 4244 4267 4275 4996)
+#endif
+// See Grid.cpp for this workaround.
+#define result_of invoke_result
+#include <nanovdb/util/GridBuilder.h>
+#undef result_of
+#include <nanovdb/util/Primitives.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+namespace Falcor
+{
+    namespace
+    {
+        struct BrickData
+        {
+            std::vector<uint8_t> range;
+            std::vector<uint8_t> indirection;
+            std::vector<uint8_t> atlas;
+            uint3 atlasSize;
+            uint3 leafDim;
+        };
+
+        template<typename Converter>
+        BrickData convertGrid(GPUUnitTestContext& ctx, const nanovdb::FloatGrid* pGrid)
+        {
+            BrickedGrid bricks = Converter(pGrid).convert();
+            RenderContext* pRenderContext = ctx.getRenderContext();
+            BrickData data;
+            data.range = pRenderContext->readTextureSubresource(bricks.range.get(), 0);
+            data.indirection = pRenderContext->readTextureSubresource(bricks.indirection.get(), 0);
+            data.atlas = pRenderContext->readTextureSubresource(bricks.atlas.get(), 0);
+            data.atlasSize = uint3(bricks.atlas->getWidth(), bricks.atlas->getHeight(), bricks.atlas->getDepth());
+            data.leafDim = uint3(bricks.range->getWidth(), bricks.range->getHeight(), bricks.range->getDepth());
+            return data;
+        }
+    }
+
+    GPU_TEST(GridConverterBricks)
+    {
+        auto handle = nanovdb::createFogVolumeSphere<float>(60.f, nanovdb::Vec3f(0.f), 1.f, 3.f);
+        const nanovdb::FloatGrid* pGrid = handle.grid<float>();
+
+        // The conversion is parallel, but the result must not depend on scheduling.
+        BrickData data = convertGrid<NanoVDBConverterUNORM8>(ctx, pGrid);
+        BrickData data2 = convertGrid<NanoVDBConverterUNORM8>(ctx, pGrid);
+        EXPECT(data.range == data2.range);
+        EXPECT(data.indirection == data2.indirection);
+        EXPECT(data.atlas == data2.atlas);
+        EXPECT(convertGrid<NanoVDBConverterBC4>(ctx, pGrid).atlas == convertGrid<NanoVDBConverterBC4>(ctx, pGrid).atlas);
+
+        // Non-empty bricks are stored in scan order and hold the quantized voxels of their leaf.
+        auto bboxMin = pGrid->indexBBox().min();
+        int3 origin = int3(bboxMin.x(), bboxMin.y(), bboxMin.z()) & (~7);
+        auto a = pGrid->getAccessor();
+        const uint32_t* pRange = reinterpret_cast<const uint32_t*>(data.range.data());
+        const uint32_t* pIndirection = reinterpret_cast<const uint32_t*>(data.indirection.data());
+        uint3 atlasBricks = data.atlasSize / 8u;
+        uint32_t nextSlot = 0;
+        bool inOrder = true;
+        bool voxelsMatch = true;
+        for (uint32_t z = 0; z < data.leafDim.z; ++z)
+        {
+            for (uint32_t y = 0; y < data.leafDim.y; ++y)
+            {
+                for (uint32_t x = 0; x < data.leafDim.x; ++x)
+                {
+                    uint32_t leafIndex = (z * data.leafDim.y + y) * data.leafDim.x + x;
+                    float majorant = f16tof32(pRange[leafIndex] & 0xffff);
+                    float minorant = f16tof32(pRange[leafIndex] >> 16);
+                    if (majorant == minorant) continue;
+
+                    uint32_t ptr = pIndirection[leafIndex];
+                    uint3 brick = uint3(ptr & 0xff, (ptr >> 8) & 0xff, ptr >> 16);
+                    inOrder &= brick.x + (brick.y + brick.z * atlasBricks.y) * atlasBricks.x == nextSlot++;
+
+                    float invRange = 255.f / (majorant - minorant);
+                    for (uint32_t k = 0; k < 8; ++k)
+                    {
+                        for (uint32_t j = 0; j < 8; ++j)
+                        {
+                            for (uint32_t i = 0; i < 8; ++i)
+                            {
+                                float f = a.getValue(nanovdb::Coord(origin.x + x * 8 + i, origin.y + y * 8 + j, origin.z + z * 8 + k));
+                                uint3 texel = brick * 8u + uint3(i, j, k);
+                                voxelsMatch &= data.atlas[(texel.z * data.atlasSize.y + texel.y) * data.atlasSize.x + texel.x] == uint8_t((f - minorant) * invRange);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        EXPECT_GT(nextSlot, 0u);
+        EXPECT(inOrder);
+        EXPECT(voxelsMatch);
+    }
+
+    GPU_TEST(GridConverterBenchmark, "Benchmark; run manually")
+    {
+        auto handle = nanovdb::createFogVolumeSphere<float>(400.f, nanovdb::Vec3f(0.f), 1.f, 3.f);
+        const nanovdb::FloatGrid* pGrid = handle.grid<float>();
+        uint64_t leafCount = pGrid->tree().nodeCount(0);
+
+        auto measure = [&](const char* name, auto convert)
+        {
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            BrickedGrid bricks = convert();
+            ctx.getRenderContext()->flush(true);
+            double time = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+            logInfo("GridConverterBenchmark: {:<6} {} leaves in {:.1f} ms ({:.0f} leaves/s)", name, leafCount, time, leafCount / (time * 1e-3));
+            EXPECT(bricks.atlas != nullptr);
+        };
+
+        measure("BC4", [&]() { return NanoVDBConverterBC4(pGrid).convert(); });
+        measure("UNORM8", [&]() { return NanoVDBConverterUNORM8(pGrid).convert(); });
+        measure("UNORM16", [&]() { return NanoVDBConverterUNORM16(pGrid).convert(); });
+    }
+}
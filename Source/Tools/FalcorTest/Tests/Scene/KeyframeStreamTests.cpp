@@ -0,0 +1,250 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Animation/KeyframeStream.h"
+#include "Utils/Logger.h"
+#include "Utils/StringUtils.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <cmath>
+#include <cstring>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Vertex layout matching PackedStaticVertexData.
+        struct Vertex
+        {
+            float3 position;
+            float3 packed;
+            float2 texCrd;
+        };
+
+        // Generate a waving grid where every vertex moves a little between keyframes.
+        std::vector<std::vector<Vertex>> createAnimation(uint32_t vertexCount, uint32_t keyframeCount)
+        {
+            std::vector<std::vector<Vertex>> keyframes(keyframeCount, std::vector<Vertex>(vertexCount));
+            for (uint32_t k = 0; k < keyframeCount; k++)
+            {
+                for (uint32_t i = 0; i < vertexCount; i++)
+                {
+                    float x = float(i % 256) / 256.f;
+                    float z = float(i / 256) / 256.f;
+                    float y = 0.1f * std::sin(6.f * x + 0.05f * k) * std::cos(4.f * z + 0.03f * k);
+                    keyframes[k][i] = { float3(x, y, z), float3(0.25f, float(i & 7), 1.f), float2(x, z) };
+                }
+            }
+            return keyframes;
+        }
+
+        AABB computeBounds(const std::vector<std::vector<Vertex>>& keyframes)
+        {
+            AABB bounds;
+            for (const auto& vertices : keyframes)
+            {
+                for (const auto& v : vertices) bounds.include(v.position);
+            }
+            return bounds;
+        }
+
+        KeyframeStream createStream(const std::vector<std::vector<Vertex>>& keyframes, uint32_t positionBits, uint32_t intraInterval = 16)
+        {
+            KeyframeStream stream((uint32_t)keyframes[0].size(), (uint32_t)sizeof(Vertex), computeBounds(keyframes), positionBits, intraInterval);
+            for (const auto& vertices : keyframes) stream.append(vertices.data());
+            return stream;
+        }
+
+        float maxPositionError(const std::vector<Vertex>& a, const std::vector<Vertex>& b)
+        {
+            float maxError = 0.f;
+            for (size_t i = 0; i < a.size(); i++)
+            {
+                for (uint32_t j = 0; j < 3; j++) maxError = std::max(maxError, std::abs(a[i].position[j] - b[i].position[j]));
+            }
+            return maxError;
+        }
+
+        bool equalAttributes(const std::vector<Vertex>& a, const std::vector<Vertex>& b)
+        {
+            for (size_t i = 0; i < a.size(); i++)
+            {
+                if (std::memcmp(&a[i].packed, &b[i].packed, sizeof(Vertex) - sizeof(float3)) != 0) return false;
+            }
+            return true;
+        }
+    }
+
+    CPU_TEST(KeyframeStreamLossless)
+    {
+        auto keyframes = createAnimation(1000, 40);
+        KeyframeStream stream = createStream(keyframes, 0, 8);
+        EXPECT_EQ(stream.getKeyframeCount(), 40u);
+        EXPECT_EQ(stream.getMaxPositionError(), 0.f);
+
+        // Decode sequentially, backwards and with jumps across intra keyframes.
+        KeyframeStream::Decoder decoder(stream);
+        std::vector<Vertex> decoded(1000);
+        for (uint32_t k : { 0u, 1u, 2u, 3u, 39u, 17u, 16u, 15u, 0u, 38u, 39u })
+        {
+            decoder.decode(k, decoded.data());
+            EXPECT(std::memcmp(decoded.data(), keyframes[k].data(), stream.getKeyframeSize()) == 0) << "keyframe " << k;
+        }
+    }
+
+    CPU_TEST(KeyframeStreamQuantized)
+    {
+        auto keyframes = createAnimation(1000, 40);
+        for (uint32_t bits : { 8u, 12u, 16u, 24u })
+        {
+            KeyframeStream stream = createStream(keyframes, bits);
+            float bound = stream.getMaxPositionError() * 1.001f + 1e-7f;
+
+            KeyframeStream::Decoder decoder(stream);
+            std::vector<Vertex> decoded(1000);
+            for (uint32_t k = 0; k < 40; k++)
+            {
+                decoder.decode(k, decoded.data());
+                EXPECT(maxPositionError(decoded, keyframes[k]) <= bound) << "bits " << bits << " keyframe " << k;
+                EXPECT(equalAttributes(decoded, keyframes[k])) << "bits " << bits << " keyframe " << k;
+            }
+        }
+    }
+
+    CPU_TEST(KeyframeStreamCompression)
+    {
+        auto keyframes = createAnimation(65536, 32);
+        KeyframeStream lossless = createStream(keyframes, 0);
+        KeyframeStream quantized = createStream(keyframes, 16);
+
+        EXPECT_EQ(lossless.getDecodedSize(), (size_t)65536 * 32 * sizeof(Vertex));
+        EXPECT(lossless.getEncodedSize() < lossless.getDecodedSize());
+        EXPECT(quantized.getEncodedSize() < lossless.getEncodedSize());
+        EXPECT(quantized.getEncodedSize() * 4 < quantized.getDecodedSize());
+
+        logInfo("KeyframeStreamCompression: {} keyframes of {} vertices: {} uncompressed, {} lossless, {} quantized (max error {})",
+            quantized.getKeyframeCount(), quantized.getVertexCount(), formatByteSize(quantized.getDecodedSize()),
+            formatByteSize(lossless.getEncodedSize()), formatByteSize(quantized.getEncodedSize()), quantized.getMaxPositionError());
+
+        // Report the memory footprint of streaming through an 8 slot window against keeping all keyframes resident.
+        size_t windowSize = 8 * quantized.getKeyframeSize();
+        logInfo("KeyframeStreamCompression: resident {} vs. streamed {} ({} host + {} window)",
+            formatByteSize(quantized.getDecodedSize()), formatByteSize(quantized.getEncodedSize() + windowSize),
+            formatByteSize(quantized.getEncodedSize()), formatByteSize(windowSize));
+
+        KeyframeStream::Decoder decoder(quantized);
+        std::vector<Vertex> decoded(65536);
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        for (uint32_t k = 0; k < quantized.getKeyframeCount(); k++) decoder.decode(k, decoded.data());
+        double time = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        logInfo("KeyframeStreamCompression: sequential decode {:.3f} ms per keyframe", time / quantized.getKeyframeCount());
+    }
+
+    CPU_TEST(KeyframeStreamWindow)
+    {
+        KeyframeWindow window(10, 4);
+        EXPECT_EQ(window.getSlotCount(), 4u);
+
+        // The first update loads the whole window, nearest first.
+        auto loads = window.update(0);
+        EXPECT_EQ(loads.size(), 4u);
+        for (uint32_t i = 0; i < loads.size(); i++) EXPECT_EQ(loads[i].keyframe, i);
+
+        // Advancing by one loads the single new keyframe into the slot that was released.
+        uint32_t slot0 = window.getSlot(0);
+        loads = window.update(1);
+        EXPECT_EQ(loads.size(), 1u);
+        EXPECT_EQ(loads[0].keyframe, 4u);
+        EXPECT_EQ(loads[0].slot, slot0);
+        EXPECT_EQ(window.getSlot(0), KeyframeWindow::kInvalidSlot);
+
+        // Staying on a keyframe loads nothing.
+        EXPECT(window.update(1).empty());
+
+        // The window wraps around at the end, so the interpolation from the last to the first keyframe is resident.
+        // Keyframe 1 is still resident from the previous window.
+        loads = window.update(8);
+        EXPECT_EQ(loads.size(), 3u);
+        EXPECT_EQ(loads[0].keyframe, 8u);
+        EXPECT_EQ(loads[1].keyframe, 9u);
+        EXPECT_EQ(loads[2].keyframe, 0u);
+        loads = window.update(9);
+        EXPECT_EQ(loads.size(), 1u);
+        EXPECT_EQ(loads[0].keyframe, 2u);
+
+        // Every resident keyframe owns a distinct slot.
+        std::vector<bool> used(window.getSlotCount(), false);
+        for (uint32_t k : { 9u, 0u, 1u, 2u })
+        {
+            uint32_t slot = window.getSlot(k);
+            EXPECT(slot < window.getSlotCount());
+            if (slot < window.getSlotCount())
+            {
+                EXPECT(!used[slot]);
+                used[slot] = true;
+            }
+        }
+
+        // Short animations keep all keyframes resident.
+        KeyframeWindow shortWindow(3, 8);
+        EXPECT_EQ(shortWindow.getSlotCount(), 3u);
+        EXPECT_EQ(shortWindow.update(2).size(), 3u);
+        EXPECT(shortWindow.update(0).empty());
+    }
+
+    CPU_TEST(KeyframeStreamPrefetcher)
+    {
+        auto keyframesA = createAnimation(2000, 20);
+        auto keyframesB = createAnimation(500, 30);
+        KeyframeStream streamA = createStream(keyframesA, 16, 4);
+        KeyframeStream streamB = createStream(keyframesB, 0, 4);
+
+        KeyframeStream::Decoder decoderA(streamA);
+        std::vector<uint8_t> expected(streamA.getKeyframeSize());
+        std::vector<uint8_t> data;
+
+        KeyframePrefetcher prefetcher({ &streamA, &streamB });
+        for (uint32_t k = 0; k < 20; k++) prefetcher.request(0, k);
+        prefetcher.request(1, 29);
+        prefetcher.cancel(0, 5);
+
+        // Blocking takes return the keyframe whether it was decoded ahead, cancelled or never requested.
+        for (uint32_t k = 0; k < 20; k++)
+        {
+            prefetcher.take(0, k, data);
+            decoderA.decode(k, expected.data());
+            EXPECT(data == expected) << "keyframe " << k;
+        }
+        prefetcher.take(1, 29, data);
+        EXPECT(std::memcmp(data.data(), keyframesB[29].data(), streamB.getKeyframeSize()) == 0);
+        prefetcher.take(1, 3, data);
+        EXPECT(std::memcmp(data.data(), keyframesB[3].data(), streamB.getKeyframeSize()) == 0);
+
+        // Taken keyframes are no longer held by the prefetcher.
+        EXPECT(!prefetcher.tryTake(0, 0, data));
+    }
+}
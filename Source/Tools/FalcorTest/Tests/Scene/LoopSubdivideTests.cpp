@@ -0,0 +1,203 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/Importers/PBRTImporter/LoopSubdivide.h"
+#include "Utils/Logger.h"
+#include "Utils/Timing/CpuTimer.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        struct TestMesh
+        {
+            std::vector<float3> positions;
+            std::vector<uint32_t> indices;
+        };
+
+        TestMesh createOctahedron()
+        {
+            return
+            {
+                { { 1.f, 0.f, 0.f }, { -1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, -1.f, 0.f }, { 0.f, 0.f, 1.f }, { 0.f, 0.f, -1.f } },
+                { 0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4, 2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5 },
+            };
+        }
+
+        /** Open grid with boundary and corner vertices. Coordinates are exactly representable.
+        */
+        TestMesh createGrid(uint32_t n)
+        {
+            TestMesh mesh;
+            for (uint32_t y = 0; y <= n; ++y)
+            {
+                for (uint32_t x = 0; x <= n; ++x) mesh.positions.push_back({ 0.25f * x, 0.5f * y, 0.125f * ((x + 2 * y) % 3) });
+            }
+            for (uint32_t y = 0; y < n; ++y)
+            {
+                for (uint32_t x = 0; x < n; ++x)
+                {
+                    uint32_t a = y * (n + 1) + x, b = a + 1, c = a + n + 1, d = c + 1;
+                    mesh.indices.insert(mesh.indices.end(), { a, b, d, a, d, c });
+                }
+            }
+            return mesh;
+        }
+
+        /** Open fan around an irregular interior vertex of valence 7.
+        */
+        TestMesh createFan()
+        {
+            TestMesh mesh;
+            mesh.positions = { { 0.f, 0.f, 0.5f }, { 1.f, 0.f, 0.f }, { 0.5f, 0.75f, 0.f }, { -0.25f, 1.f, 0.f }, { -1.f, 0.5f, 0.f }, { -0.75f, -0.5f, 0.f }, { 0.f, -1.f, 0.f }, { 0.75f, -0.75f, 0.f } };
+            for (uint32_t i = 0; i < 7; ++i) mesh.indices.insert(mesh.indices.end(), { 0, 1 + i, 1 + (i + 1) % 7 });
+            return mesh;
+        }
+
+        /** Closed torus made of regular vertices.
+        */
+        TestMesh createTorus(uint32_t majorSegments, uint32_t minorSegments)
+        {
+            TestMesh mesh;
+            for (uint32_t i = 0; i < majorSegments; ++i)
+            {
+                for (uint32_t j = 0; j < minorSegments; ++j)
+                {
+                    float u = 2.f * float(M_PI) * i / majorSegments;
+                    float v = 2.f * float(M_PI) * j / minorSegments;
+                    float r = 1.f + 0.3f * std::cos(v);
+                    mesh.positions.push_back({ r * std::cos(u), r * std::sin(u), 0.3f * std::sin(v) });
+                }
+            }
+            for (uint32_t i = 0; i < majorSegments; ++i)
+            {
+                for (uint32_t j = 0; j < minorSegments; ++j)
+                {
+                    uint32_t i1 = (i + 1) % majorSegments, j1 = (j + 1) % minorSegments;
+                    uint32_t a = i * minorSegments + j, b = i1 * minorSegments + j, c = i1 * minorSegments + j1, d = i * minorSegments + j1;
+                    mesh.indices.insert(mesh.indices.end(), { a, b, c, a, c, d });
+                }
+            }
+            return mesh;
+        }
+
+        uint64_t hashBytes(const void* pData, size_t size, uint64_t hash)
+        {
+            // FNV-1a.
+            const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash ^= pBytes[i];
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        uint64_t hashResult(const pbrt::LoopSubdivideResult& result)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            hash = hashBytes(result.positions.data(), result.positions.size() * sizeof(float3), hash);
+            hash = hashBytes(result.indices.data(), result.indices.size() * sizeof(uint32_t), hash);
+            return hash;
+        }
+    }
+
+    CPU_TEST(LoopSubdivideReference)
+    {
+        // Vertex counts, triangle counts and hashes of the limit positions and indices produced by the original pbrt implementation.
+        struct Reference
+        {
+            uint32_t levels;
+            size_t vertexCount;
+            size_t triangleCount;
+            uint64_t hash;
+        };
+
+        auto check = [&](const TestMesh& mesh, const std::vector<Reference>& references)
+        {
+            for (const auto& ref : references)
+            {
+                auto result = pbrt::loopSubdivide(ref.levels, mesh.positions, mesh.indices);
+                EXPECT_EQ(result.positions.size(), ref.vertexCount);
+                EXPECT_EQ(result.normals.size(), ref.vertexCount);
+                EXPECT_EQ(result.indices.size() / 3, ref.triangleCount);
+                EXPECT_EQ(hashResult(result), ref.hash);
+            }
+        };
+
+        check(createOctahedron(),
+        {
+            { 0, 6, 8, 0x943fbb6b17765bf5ull },
+            { 1, 18, 32, 0x94c7d721443a97c5ull },
+            { 2, 66, 128, 0x49f604458106d91dull },
+            { 3, 258, 512, 0x293bee91fe76230dull },
+        });
+        check(createGrid(4),
+        {
+            { 0, 25, 32, 0x5bc720ba7f632aadull },
+            { 1, 81, 128, 0xf96a2629ce058584ull },
+            { 2, 289, 512, 0xdbacfe3df584c3a0ull },
+            { 3, 1089, 2048, 0xf92e58c34fac28c3ull },
+        });
+        check(createFan(),
+        {
+            { 0, 8, 7, 0xedd26453eae9dee7ull },
+            { 1, 22, 28, 0x61be901c62683816ull },
+            { 2, 71, 112, 0x0c3335f7c8c2bd38ull },
+            { 3, 253, 448, 0x55c0d1bf04d39c49ull },
+        });
+
+        // Limit normals of the convex octahedron are consistently oriented.
+        TestMesh octahedron = createOctahedron();
+        auto result = pbrt::loopSubdivide(3, octahedron.positions, octahedron.indices);
+        size_t outwardCount = 0;
+        for (size_t i = 0; i < result.positions.size(); ++i)
+        {
+            float d = dot(result.normals[i], result.positions[i]);
+            EXPECT_NE(d, 0.f);
+            if (d > 0.f) ++outwardCount;
+        }
+        EXPECT(outwardCount == 0 || outwardCount == result.positions.size());
+    }
+
+    CPU_TEST(LoopSubdivideBenchmark, "Benchmark; run manually")
+    {
+        TestMesh mesh = createTorus(32, 16);
+
+        for (uint32_t levels = 1; levels <= 6; ++levels)
+        {
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            auto result = pbrt::loopSubdivide(levels, mesh.positions, mesh.indices);
+            double time = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+            logInfo("LoopSubdivideBenchmark: level {} {:8} triangles {:8} vertices {:10.2f} ms", levels, result.indices.size() / 3, result.positions.size(), time);
+
+            // A closed torus satisfies V - E + F = 0 with E = 3F / 2.
+            EXPECT_EQ(2 * result.positions.size(), result.indices.size() / 3);
+        }
+    }
+}
@@ -0,0 +1,173 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Scene/SceneBuilder.h"
+#include "Utils/Logger.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <filesystem>
+#include <fstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        std::filesystem::path getTempDir(const std::string& name)
+        {
+            auto dir = std::filesystem::temp_directory_path() / ("FalcorTest" + name);
+            std::filesystem::create_directories(dir);
+            return dir;
+        }
+
+        /** Write an ASCII PLY file containing a tessellated grid.
+        */
+        void writeGridPly(const std::filesystem::path& path, uint32_t resolution)
+        {
+            std::ofstream file(path);
+            const uint32_t vertexCount = (resolution + 1) * (resolution + 1);
+            const uint32_t faceCount = resolution * resolution * 2;
+            file << "ply\nformat ascii 1.0\n";
+            file << "element vertex " << vertexCount << "\nproperty float x\nproperty float y\nproperty float z\n";
+            file << "element face " << faceCount << "\nproperty list uchar int vertex_indices\nend_header\n";
+            for (uint32_t y = 0; y <= resolution; ++y)
+            {
+                for (uint32_t x = 0; x <= resolution; ++x)
+                {
+                    float u = float(x) / resolution;
+                    float v = float(y) / resolution;
+                    file << u << " " << 0.1f * std::sin(20.f * u) * std::cos(20.f * v) << " " << v << "\n";
+                }
+            }
+            for (uint32_t y = 0; y < resolution; ++y)
+            {
+                for (uint32_t x = 0; x < resolution; ++x)
+                {
+                    uint32_t i = y * (resolution + 1) + x;
+                    file << "3 " << i << " " << i + 1 << " " << i + resolution + 2 << "\n";
+                    file << "3 " << i << " " << i + resolution + 2 << " " << i + resolution + 1 << "\n";
+                }
+            }
+        }
+
+        /** Write a synthetic pbrt scene split into multiple files.
+            Each part contains a PLY mesh, a subdivision surface, curves and a triangle mesh using the material of the main file.
+            \param[in] directive Directive used to reference the parts, either "Import" or "Include".
+            \return Path of the main scene file.
+        */
+        std::filesystem::path writeScene(const std::filesystem::path& dir, const std::string& directive, uint32_t partCount, uint32_t plyResolution)
+        {
+            for (uint32_t i = 0; i < partCount; ++i)
+            {
+                auto plyPath = dir / fmt::format("mesh{}.ply", i);
+                if (!std::filesystem::exists(plyPath)) writeGridPly(plyPath, plyResolution);
+
+                std::ofstream file(dir / fmt::format("part{}.pbrt", i));
+                file << "AttributeBegin\n";
+                file << fmt::format("Material \"diffuse\" \"rgb reflectance\" [ {} 0.5 0.5 ]\n", float(i) / partCount);
+                file << fmt::format("Translate {} 0 0\n", 2 * i);
+                file << fmt::format("Shape \"plymesh\" \"string filename\" \"mesh{}.ply\"\n", i);
+                file << "Shape \"loopsubdiv\" \"integer levels\" 5 \"integer indices\" [ 0 1 2 0 2 3 0 3 1 1 3 2 ]\n";
+                file << "    \"point3 P\" [ 0 0 0  1 0 0  0 1 0  0 0 1 ]\n";
+                for (uint32_t j = 0; j < 16; ++j)
+                {
+                    file << "Shape \"curve\" \"string basis\" \"bspline\" \"string type\" \"cylinder\" \"float width\" 0.02\n";
+                    file << fmt::format("    \"point3 P\" [ {0} 0 0  {0} 0.3 0.1  {0} 0.6 -0.1  {0} 1 0 ]\n", 0.05f * j);
+                }
+                file << "AttributeEnd\n";
+                file << fmt::format("Translate 0 0 {}\n", 2 * i);
+                file << "Shape \"trianglemesh\" \"integer indices\" [ 0 1 2 ] \"point3 P\" [ 0 0 0  1 0 0  0 1 0 ]\n";
+            }
+
+            auto path = dir / fmt::format("scene{}.pbrt", directive);
+            std::ofstream file(path);
+            file << "LookAt 0 5 -10  0 0 0  0 1 0\n";
+            file << "Camera \"perspective\" \"float fov\" [ 45 ]\n";
+            file << "WorldBegin\n";
+            file << "Material \"diffuse\" \"rgb reflectance\" [ 0.8 0.8 0.8 ]\n";
+            for (uint32_t i = 0; i < partCount; ++i)
+            {
+                file << fmt::format("{} \"part{}.pbrt\"\n", directive, i);
+            }
+            return path;
+        }
+
+        std::vector<std::string> getMaterialNames(const SceneBuilder& builder)
+        {
+            std::vector<std::string> names;
+            for (const auto& pMaterial : builder.getMaterials()) names.push_back(pMaterial->getName());
+            return names;
+        }
+    }
+
+    GPU_TEST(PBRTImportDeterministic)
+    {
+        auto dir = getTempDir("PBRTImportDeterministic");
+        auto importPath = writeScene(dir, "Import", 8, 16);
+        auto includePath = writeScene(dir, "Include", 8, 16);
+
+        // Imported files are parsed concurrently but must be merged in the order of the directives.
+        auto pBuilderA = SceneBuilder::create(importPath);
+        auto pBuilderB = SceneBuilder::create(importPath);
+        EXPECT_EQ(pBuilderA->getNodeCount(), pBuilderB->getNodeCount());
+        EXPECT(getMaterialNames(*pBuilderA) == getMaterialNames(*pBuilderB));
+
+        // Importing must produce the same scene content as including the files inline.
+        auto pBuilderC = SceneBuilder::create(includePath);
+        EXPECT_EQ(pBuilderA->getNodeCount(), pBuilderC->getNodeCount());
+        EXPECT_EQ(pBuilderA->getMaterials().size(), pBuilderC->getMaterials().size());
+
+        std::filesystem::remove_all(dir);
+    }
+
+    GPU_TEST(PBRTImportBenchmark, "Benchmark; run manually")
+    {
+        const uint32_t partCount = 32;
+        const uint32_t plyResolution = 256;
+
+        auto dir = getTempDir("PBRTImportBenchmark");
+        auto importPath = writeScene(dir, "Import", partCount, plyResolution);
+        auto includePath = writeScene(dir, "Include", partCount, plyResolution);
+
+        auto measure = [](const std::filesystem::path& path)
+        {
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            auto pBuilder = SceneBuilder::create(path);
+            return CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        };
+
+        // Warm up the file system cache.
+        measure(includePath);
+
+        double includeTime = measure(includePath);
+        double importTime = measure(importPath);
+
+        logInfo("PBRTImportBenchmark: {} parts with {}x{} PLY grids, 'Include' {:.1f} ms, 'Import' {:.1f} ms ({:.2f}x).",
+            partCount, plyResolution, plyResolution, includeTime, importTime, includeTime / importTime);
+
+        std::filesystem::remove_all(dir);
+    }
+}
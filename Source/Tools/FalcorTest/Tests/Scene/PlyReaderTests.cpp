@@ -0,0 +1,268 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Core/Errors.h"
+#include "Core/Platform/OS.h"
+#include "Scene/PlyReader.h"
+#include "Scene/TriangleMesh.h"
+#include "Utils/Logger.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <zlib.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        std::filesystem::path getTempDir(const std::string& name)
+        {
+            auto dir = std::filesystem::temp_directory_path() / ("FalcorTest" + name);
+            std::filesystem::create_directories(dir);
+            return dir;
+        }
+
+        /** Grid mesh with quad faces. All values are exactly representable in ASCII.
+        */
+        struct Grid
+        {
+            uint32_t resolution;
+            std::vector<float> vertexData;                  ///< x, y, z, nx, ny, nz, u, v per vertex.
+            std::vector<std::array<uint32_t, 4>> quads;
+
+            explicit Grid(uint32_t resolution) : resolution(resolution)
+            {
+                for (uint32_t y = 0; y <= resolution; ++y)
+                {
+                    for (uint32_t x = 0; x <= resolution; ++x)
+                    {
+                        float u = float(x) / resolution;
+                        float v = float(y) / resolution;
+                        vertexData.insert(vertexData.end(), { u, 0.25f * float((x + y) % 4), v, 0.f, 1.f, 0.f, u, v });
+                    }
+                }
+                for (uint32_t y = 0; y < resolution; ++y)
+                {
+                    for (uint32_t x = 0; x < resolution; ++x)
+                    {
+                        uint32_t i = y * (resolution + 1) + x;
+                        quads.push_back({ i, i + 1, i + resolution + 2, i + resolution + 1 });
+                    }
+                }
+            }
+
+            uint32_t getVertexCount() const { return (uint32_t)(vertexData.size() / 8); }
+        };
+
+        template<typename T>
+        void appendValue(std::string& data, T value, bool bigEndian)
+        {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            if (bigEndian) std::reverse(bytes, bytes + sizeof(T));
+            data.append(bytes, sizeof(T));
+        }
+
+        std::string createPly(const Grid& grid, const std::string& format)
+        {
+            std::string data = fmt::format(
+                "ply\nformat {} 1.0\ncomment FalcorTest\nelement vertex {}\n"
+                "property float x\nproperty float y\nproperty float z\nproperty float nx\nproperty float ny\nproperty float nz\nproperty float u\nproperty float v\n"
+                "element face {}\nproperty list uchar int vertex_indices\nend_header\n",
+                format, grid.getVertexCount(), grid.quads.size());
+
+            if (format == "ascii")
+            {
+                for (size_t i = 0; i < grid.vertexData.size(); i += 8)
+                {
+                    data += fmt::format("{} {} {} {} {} {} {} {}\n", grid.vertexData[i], grid.vertexData[i + 1], grid.vertexData[i + 2], grid.vertexData[i + 3],
+                        grid.vertexData[i + 4], grid.vertexData[i + 5], grid.vertexData[i + 6], grid.vertexData[i + 7]);
+                }
+                for (const auto& q : grid.quads) data += fmt::format("4 {} {} {} {}\n", q[0], q[1], q[2], q[3]);
+            }
+            else
+            {
+                bool bigEndian = format == "binary_big_endian";
+                for (float value : grid.vertexData) appendValue(data, value, bigEndian);
+                for (const auto& q : grid.quads)
+                {
+                    appendValue(data, uint8_t(4), bigEndian);
+                    for (uint32_t index : q) appendValue(data, (int32_t)index, bigEndian);
+                }
+            }
+            return data;
+        }
+
+        void writeFile(const std::filesystem::path& path, const std::string& data)
+        {
+            std::ofstream(path, std::ios::binary).write(data.data(), data.size());
+        }
+
+        void writeCompressedFile(const std::filesystem::path& path, const std::string& data)
+        {
+            gzFile file = gzopen(path.string().c_str(), "wb");
+            gzwrite(file, data.data(), (unsigned)data.size());
+            gzclose(file);
+        }
+
+        void checkMesh(CPUUnitTestContext& ctx, const Grid& grid, const PlyMesh& mesh)
+        {
+            EXPECT_EQ(mesh.getVertexCount(), grid.getVertexCount());
+            EXPECT_EQ((size_t)mesh.getTriangleCount(), grid.quads.size() * 2);
+            EXPECT_EQ(mesh.normals.size(), mesh.positions.size());
+            EXPECT_EQ(mesh.texCrds.size(), mesh.positions.size());
+            if (mesh.getVertexCount() != grid.getVertexCount() || mesh.getTriangleCount() != grid.quads.size() * 2) return;
+
+            bool attributesMatch = true;
+            for (uint32_t i = 0; i < mesh.getVertexCount(); ++i)
+            {
+                const float* v = &grid.vertexData[i * 8];
+                attributesMatch &= mesh.positions[i] == float3(v[0], v[1], v[2]);
+                attributesMatch &= mesh.normals[i] == float3(v[3], v[4], v[5]);
+                attributesMatch &= mesh.texCrds[i] == float2(v[6], v[7]);
+            }
+            EXPECT(attributesMatch);
+
+            bool indicesMatch = true;
+            for (size_t i = 0; i < grid.quads.size(); ++i)
+            {
+                const auto& q = grid.quads[i];
+                const uint32_t* t = &mesh.indices[i * 6];
+                indicesMatch &= t[0] == q[0] && t[1] == q[1] && t[2] == q[2];
+                indicesMatch &= t[3] == q[0] && t[4] == q[2] && t[5] == q[3];
+            }
+            EXPECT(indicesMatch);
+        }
+    }
+
+    CPU_TEST(PlyReaderFormats)
+    {
+        auto dir = getTempDir("PlyReaderFormats");
+        Grid grid(37);
+
+        for (std::string format : { "ascii", "binary_little_endian", "binary_big_endian" })
+        {
+            std::string data = createPly(grid, format);
+            checkMesh(ctx, grid, PlyReader::read(data.data(), data.size()));
+
+            auto path = dir / (format + ".ply");
+            writeFile(path, data);
+            checkMesh(ctx, grid, PlyReader::read(path));
+
+            auto compressedPath = dir / (format + ".ply.gz");
+            writeCompressedFile(compressedPath, data);
+            checkMesh(ctx, grid, PlyReader::read(compressedPath));
+        }
+
+        // Truncated files must be reported as errors.
+        std::string data = createPly(grid, "binary_little_endian");
+        data.resize(data.size() / 2);
+        bool threw = false;
+        try
+        {
+            PlyReader::read(data.data(), data.size());
+        }
+        catch (const RuntimeError&)
+        {
+            threw = true;
+        }
+        EXPECT(threw);
+
+        std::filesystem::remove_all(dir);
+    }
+
+    CPU_TEST(PlyReaderBenchmark, "Benchmark; run manually")
+    {
+        auto dir = getTempDir("PlyReaderBenchmark");
+        Grid grid(1024);
+        std::string data = createPly(grid, "binary_little_endian");
+        auto path = dir / "grid.ply";
+        auto compressedPath = dir / "grid.ply.gz";
+        writeFile(path, data);
+        writeCompressedFile(compressedPath, data);
+        data = {};
+        grid = Grid(1);
+
+        const double fileSizeMB = std::filesystem::file_size(path) / (1024.0 * 1024.0);
+
+        // Peak RSS only grows, so the native reader runs first and each measurement reports the increase over the
+        // RSS at its start.
+        auto measure = [&](const char* name, auto func)
+        {
+            uint64_t startRSS = getCurrentRSS();
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            size_t triangleCount = func();
+            double time = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+            uint64_t peakRSS = getPeakRSS();
+            double peakMB = peakRSS > startRSS ? (peakRSS - startRSS) / (1024.0 * 1024.0) : 0.0;
+            logInfo("PlyReaderBenchmark: {:<24} {:8.1f} ms, {:8.1f} MB/s, peak RSS +{:.1f} MB, {} triangles",
+                name, time, fileSizeMB / (time * 1e-3), peakMB, triangleCount);
+            return triangleCount;
+        };
+
+        size_t nativeCount = measure("PlyReader", [&]() { return (size_t)PlyReader::read(path).getTriangleCount(); });
+        size_t compressedCount = measure("PlyReader (gzip)", [&]() { return (size_t)PlyReader::read(compressedPath).getTriangleCount(); });
+        size_t assimpCount = measure("ASSIMP", [&]()
+        {
+            // Same import as TriangleMesh::createFromFile() used for PLY files, including the copy into a vertex list.
+            Assimp::Importer importer;
+            const aiScene* pScene = importer.ReadFile(path.string().c_str(), aiProcess_FlipUVs | aiProcess_Triangulate | aiProcess_GenNormals | aiProcess_PreTransformVertices);
+            if (!pScene) return size_t(0);
+            TriangleMesh::VertexList vertices;
+            TriangleMesh::IndexList indices;
+            for (uint32_t m = 0; m < pScene->mNumMeshes; ++m)
+            {
+                const aiMesh* pMesh = pScene->mMeshes[m];
+                uint32_t base = (uint32_t)vertices.size();
+                for (uint32_t i = 0; i < pMesh->mNumVertices; ++i)
+                {
+                    const auto& p = pMesh->mVertices[i];
+                    const auto& n = pMesh->mNormals[i];
+                    const auto t = pMesh->mTextureCoords[0] ? pMesh->mTextureCoords[0][i] : aiVector3D(0.f);
+                    vertices.push_back({ float3(p.x, p.y, p.z), float3(n.x, n.y, n.z), float2(t.x, t.y) });
+                }
+                for (uint32_t f = 0; f < pMesh->mNumFaces; ++f)
+                {
+                    for (uint32_t i = 0; i < 3; ++i) indices.push_back(base + pMesh->mFaces[f].mIndices[i]);
+                }
+            }
+            return indices.size() / 3;
+        });
+
+        EXPECT_EQ(nativeCount, compressedCount);
+        EXPECT_EQ(nativeCount, assimpCount);
+
+        std::filesystem::remove_all(dir);
+    }
+}
@@ -0,0 +1,204 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Core/API/Device.h"
+#include "Utils/Logger.h"
+#include "Utils/Image/AsyncTextureLoader.h"
+#include "Utils/Image/Bitmap.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <random>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Write a set of synthetic RGBA8 textures to a temporary directory.
+        */
+        std::vector<std::filesystem::path> createTextureSet(const std::string& name, size_t count, uint32_t size)
+        {
+            auto dir = std::filesystem::temp_directory_path() / ("FalcorTest" + name);
+            std::filesystem::create_directories(dir);
+
+            std::mt19937 rng(1234);
+            std::vector<uint8_t> pixels(size_t(size) * size * 4);
+            std::vector<std::filesystem::path> paths;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                // Smooth gradient with a little noise so files are neither trivial nor incompressible.
+                for (uint32_t y = 0; y < size; ++y)
+                {
+                    for (uint32_t x = 0; x < size; ++x)
+                    {
+                        uint8_t* p = &pixels[(size_t(y) * size + x) * 4];
+                        p[0] = uint8_t((x * 255) / size);
+                        p[1] = uint8_t((y * 255) / size);
+                        p[2] = uint8_t((i * 37 + (rng() & 15)) & 255);
+                        p[3] = 255;
+                    }
+                }
+
+                auto path = dir / fmt::format("texture{}.png", i);
+                Bitmap::saveImage(path, size, size, Bitmap::FileFormat::PngFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA8Unorm, true, pixels.data());
+                paths.push_back(path);
+            }
+
+            return paths;
+        }
+
+        void removeTextureSet(const std::vector<std::filesystem::path>& paths)
+        {
+            if (!paths.empty()) std::filesystem::remove_all(paths[0].parent_path());
+        }
+    }
+
+    GPU_TEST(AsyncTextureLoader)
+    {
+        const uint32_t kSize = 64;
+        auto paths = createTextureSet("AsyncTextureLoader", 8, kSize);
+
+        {
+            AsyncTextureLoader loader(4);
+
+            std::vector<std::future<Texture::SharedPtr>> futures;
+            size_t callbackCount = 0;
+            std::mutex callbackMutex;
+            auto callback = [&](Texture::SharedPtr) { std::lock_guard<std::mutex> lock(callbackMutex); callbackCount++; };
+
+            for (size_t i = 0; i < paths.size(); ++i)
+            {
+                futures.push_back(loader.loadFromFile(paths[i], false, false, Resource::BindFlags::ShaderResource, callback, uint32_t(i)));
+            }
+
+            // Identical requests are merged and return the same texture.
+            auto futureA = loader.loadFromFile(paths[0], true, false);
+            auto futureB = loader.loadFromFile(paths[0], true, false);
+
+            // Missing files complete with nullptr.
+            auto futureMissing = loader.loadFromFile(paths[0].parent_path() / "missing.png", false, false);
+
+            for (size_t i = 0; i < futures.size(); ++i)
+            {
+                auto pTexture = futures[i].get();
+                EXPECT(pTexture != nullptr);
+                if (pTexture)
+                {
+                    EXPECT_EQ(pTexture->getWidth(), kSize);
+                    EXPECT_EQ(pTexture->getHeight(), kSize);
+                    EXPECT_EQ(pTexture->getMipCount(), 1u);
+                    EXPECT(pTexture->getSourcePath() == paths[i]);
+                }
+            }
+
+            auto pTextureA = futureA.get();
+            auto pTextureB = futureB.get();
+            EXPECT(pTextureA != nullptr);
+            EXPECT(pTextureA == pTextureB);
+            if (pTextureA) EXPECT_GT(pTextureA->getMipCount(), 1u);
+
+            EXPECT(futureMissing.get() == nullptr);
+
+            loader.waitForAll();
+            EXPECT_EQ(callbackCount, paths.size());
+
+            auto stats = loader.getStats();
+            EXPECT_EQ(stats.requestCount, paths.size() + 3);
+            EXPECT_GE(stats.mergedCount, 1u);
+            EXPECT_EQ(stats.cancelledCount, 0u);
+        }
+
+        {
+            // Cancellation. Every request completes, either with a texture or with nullptr if it was cancelled.
+            AsyncTextureLoader loader(1);
+
+            std::vector<std::future<Texture::SharedPtr>> futures;
+            for (const auto& path : paths) futures.push_back(loader.loadFromFile(path, false, false));
+
+            size_t cancelledCount = loader.cancelAll();
+
+            size_t nullCount = 0;
+            for (auto& future : futures)
+            {
+                if (future.get() == nullptr) nullCount++;
+            }
+            EXPECT_EQ(nullCount, cancelledCount);
+
+            loader.waitForAll();
+            auto stats = loader.getStats();
+            EXPECT_EQ(stats.cancelledCount, cancelledCount);
+            EXPECT_EQ(stats.uploadedCount + stats.cancelledCount, paths.size());
+        }
+
+        removeTextureSet(paths);
+    }
+
+    GPU_TEST(AsyncTextureLoaderBenchmark, "Benchmark; run manually")
+    {
+        const size_t kCount = 64;
+        const uint32_t kSize = 1024;
+        const size_t kTextureBytes = size_t(kSize) * kSize * 4;
+        auto paths = createTextureSet("AsyncTextureLoaderBenchmark", kCount, kSize);
+
+        // Baseline: load all textures serially on the calling thread.
+        auto startTime = CpuTimer::getCurrentTimePoint();
+        for (const auto& path : paths)
+        {
+            EXPECT(Texture::createFromFile(path, true, true) != nullptr);
+        }
+        gpDevice->flushAndSync();
+        double serialTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+        // Pipelined loader with an in-flight budget of a quarter of the texture set.
+        const size_t threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        const size_t budget = kCount * kTextureBytes / 4;
+
+        startTime = CpuTimer::getCurrentTimePoint();
+        AsyncTextureLoader::Stats stats;
+        {
+            AsyncTextureLoader loader(threadCount, budget);
+            std::vector<std::future<Texture::SharedPtr>> futures;
+            for (const auto& path : paths) futures.push_back(loader.loadFromFile(path, true, true));
+            for (auto& future : futures) EXPECT(future.get() != nullptr);
+            loader.waitForAll();
+            stats = loader.getStats();
+        }
+        double asyncTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+        EXPECT_EQ(stats.uploadedCount, kCount);
+        EXPECT_LE(stats.peakInFlightBytes, budget + threadCount * kTextureBytes);
+
+        double totalMB = double(kCount * kTextureBytes) / (1 << 20);
+        logInfo("AsyncTextureLoader: {} textures ({:.1f} MB decoded): serial {:.1f} ms ({:.1f} MB/s), async {:.1f} ms ({:.1f} MB/s) with {} threads, peak in-flight {:.1f} MB, {} flushes",
+            kCount, totalMB, serialTime, totalMB / serialTime * 1000.0, asyncTime, totalMB / asyncTime * 1000.0, threadCount, double(stats.peakInFlightBytes) / (1 << 20), stats.flushCount);
+
+        removeTextureSet(paths);
+    }
+}
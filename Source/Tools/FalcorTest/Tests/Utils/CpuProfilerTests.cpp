@@ -0,0 +1,168 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Logger.h"
+#include "Utils/Timing/CpuProfiler.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <json/json.hpp>
+#include <map>
+#include <thread>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kThreadCount = 4;
+        const uint32_t kIterationCount = 1000;
+
+        void recordNestedScopes(uint32_t threadIndex)
+        {
+            CpuProfiler::instance().setThreadName(fmt::format("Worker {}", threadIndex));
+            for (uint32_t i = 0; i < kIterationCount; ++i)
+            {
+                FALCOR_PROFILE_CPU("outer");
+                {
+                    FALCOR_PROFILE_CPU("inner");
+                    CpuProfilerScope scope(std::string_view("dynamic \"name\""));
+                }
+            }
+        }
+    }
+
+    CPU_TEST(CpuProfilerNestedScopes)
+    {
+        auto& profiler = CpuProfiler::instance();
+        if (profiler.isCapturing()) profiler.endCapture();
+
+        // Scopes are not recorded without an active capture.
+        recordNestedScopes(0);
+
+        profiler.startCapture();
+        EXPECT(profiler.isEnabled());
+
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < kThreadCount; ++i) threads.emplace_back(recordNestedScopes, i);
+        for (auto& thread : threads) thread.join();
+
+        auto pCapture = profiler.endCapture();
+        EXPECT(!profiler.isEnabled());
+        EXPECT(pCapture != nullptr);
+        if (!pCapture) return;
+
+        EXPECT_EQ(pCapture->getDroppedEventCount(), 0);
+        EXPECT_EQ(pCapture->getEvents().size(), size_t(kThreadCount) * kIterationCount * 3);
+
+        // Check per-thread counts and that every nested scope lies within its parent.
+        std::map<uint32_t, std::map<std::string, uint32_t>> counts;
+        std::vector<const CpuProfiler::Event*> stack;
+        uint32_t currentThread = uint32_t(-1);
+        size_t nestingErrors = 0;
+        for (const auto& event : pCapture->getEvents())
+        {
+            counts[event.threadID][pCapture->getName(event.name)]++;
+            if (event.threadID != currentThread) stack.clear();
+            currentThread = event.threadID;
+
+            stack.resize(std::min<size_t>(stack.size(), event.depth));
+            if (stack.size() != event.depth) nestingErrors++;
+            else if (!stack.empty())
+            {
+                const auto* pParent = stack.back();
+                if (event.startTime < pParent->startTime || event.startTime + event.duration > pParent->startTime + pParent->duration) nestingErrors++;
+            }
+            stack.push_back(&event);
+        }
+        EXPECT_EQ(nestingErrors, 0);
+        EXPECT_EQ(counts.size(), kThreadCount);
+        for (const auto& [threadID, names] : counts)
+        {
+            EXPECT_EQ(names.at("outer"), kIterationCount);
+            EXPECT_EQ(names.at("inner"), kIterationCount);
+            EXPECT_EQ(names.at("dynamic \"name\""), kIterationCount);
+            EXPECT(pCapture->getThreadName(threadID).rfind("Worker ", 0) == 0);
+        }
+
+        // The Chrome trace must be valid JSON with one complete event per scope.
+        auto trace = nlohmann::json::parse(pCapture->toChromeTrace());
+        size_t completeCount = 0;
+        size_t metadataCount = 0;
+        for (const auto& event : trace["traceEvents"])
+        {
+            if (event["ph"] == "X") completeCount++;
+            if (event["ph"] == "M") metadataCount++;
+        }
+        EXPECT_EQ(completeCount, pCapture->getEvents().size());
+        EXPECT_GE(metadataCount, kThreadCount);
+    }
+
+    CPU_TEST(CpuProfilerOverflow)
+    {
+        auto& profiler = CpuProfiler::instance();
+        if (profiler.isCapturing()) profiler.endCapture();
+
+        // A fresh thread gets a small buffer. Without the collector keeping up, events beyond the capacity are dropped, never overwritten.
+        profiler.startCapture(16);
+        std::thread thread([]()
+        {
+            for (uint32_t i = 0; i < 100000; ++i)
+            {
+                FALCOR_PROFILE_CPU("overflow");
+            }
+        });
+        thread.join();
+        auto pCapture = profiler.endCapture();
+
+        EXPECT_EQ(pCapture->getEvents().size() + pCapture->getDroppedEventCount(), 100000);
+    }
+
+    CPU_TEST(CpuProfilerOverhead)
+    {
+        auto& profiler = CpuProfiler::instance();
+        if (profiler.isCapturing()) profiler.endCapture();
+
+        const uint32_t scopeCount = 1000000;
+        auto measure = [&]()
+        {
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            for (uint32_t i = 0; i < scopeCount; ++i)
+            {
+                FALCOR_PROFILE_CPU("overhead");
+            }
+            return CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+        };
+
+        double disabledTime = measure();
+        profiler.startCapture(1 << 21);
+        double enabledTime = measure();
+        auto pCapture = profiler.endCapture();
+
+        logInfo("CpuProfilerOverhead: {} scopes, disabled {:.2f} ns/scope, enabled {:.2f} ns/scope, {} recorded, {} dropped",
+            scopeCount, disabledTime * 1e6 / scopeCount, enabledTime * 1e6 / scopeCount, pCapture->getEvents().size(), pCapture->getDroppedEventCount());
+        EXPECT_EQ(pCapture->getEvents().size() + pCapture->getDroppedEventCount(), scopeCount);
+    }
+}
@@ -0,0 +1,232 @@
+/***************************************************************************
+ # Copyright (c) 2015-21, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Testing/UnitTest.h"
+#include "Utils/Logger.h"
+#include "Utils/Image/AsyncImageWriter.h"
+#include "Utils/Image/Bitmap.h"
+#include "Utils/Image/ScanlineWriter.h"
+#include "Utils/Timing/CpuTimer.h"
+#include <glm/detail/type_half.hpp>
+#include <filesystem>
+
+namespace Falcor
+{
+    namespace
+    {
+        /** Create a synthetic RGBA32F framebuffer with a smooth HDR gradient and some high-frequency detail.
+        */
+        std::vector<float> createFrame(uint32_t width, uint32_t height, uint32_t seed)
+        {
+            std::vector<float> pixels(size_t(width) * height * 4);
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    float* p = &pixels[(size_t(y) * width + x) * 4];
+                    uint32_t h = (x * 73856093u) ^ (y * 19349663u) ^ (seed * 83492791u);
+                    p[0] = 8.f * x / width;
+                    p[1] = 0.25f + float(y) / height;
+                    p[2] = float(h & 1023) / 1024.f;
+                    p[3] = float((x + y) & 1);
+                }
+            }
+            return pixels;
+        }
+
+        float roundToHalf(float v)
+        {
+            return glm::detail::toFloat32(glm::detail::toFloat16(v));
+        }
+
+        std::filesystem::path getTempDir(const std::string& name)
+        {
+            auto dir = std::filesystem::temp_directory_path() / ("FalcorTest" + name);
+            std::filesystem::create_directories(dir);
+            return dir;
+        }
+
+        /** Load an image and compare it against the source pixels.
+        */
+        void testRoundTrip(CPUUnitTestContext& ctx, const std::filesystem::path& path, uint32_t width, uint32_t height, const std::vector<float>& pixels, bool hasAlpha, bool isHalf)
+        {
+            auto pBitmap = Bitmap::createFromFile(path, true);
+            EXPECT(pBitmap != nullptr);
+            if (!pBitmap) return;
+
+            EXPECT_EQ(pBitmap->getWidth(), width);
+            EXPECT_EQ(pBitmap->getHeight(), height);
+            EXPECT(pBitmap->getFormat() == ResourceFormat::RGBA32Float);
+            if (pBitmap->getFormat() != ResourceFormat::RGBA32Float || pBitmap->getWidth() != width || pBitmap->getHeight() != height) return;
+
+            const float* pData = reinterpret_cast<const float*>(pBitmap->getData());
+            size_t mismatchCount = 0;
+            for (size_t i = 0; i < pixels.size(); ++i)
+            {
+                bool isAlpha = (i & 3) == 3;
+                float expected = isAlpha && !hasAlpha ? 1.f : pixels[i];
+                if (isHalf) expected = roundToHalf(expected);
+                if (pData[i] != expected) mismatchCount++;
+            }
+            EXPECT_EQ(mismatchCount, 0);
+        }
+    }
+
+    CPU_TEST(ScanlineWriterRoundTrip)
+    {
+        const uint32_t width = 317;
+        const uint32_t height = 123;
+        auto pixels = createFrame(width, height, 1);
+        auto reader = [&](uint32_t y, uint32_t rowCount, float* pDst)
+        {
+            std::memcpy(pDst, pixels.data() + size_t(y) * width * 4, size_t(rowCount) * width * 4 * sizeof(float));
+        };
+
+        auto dir = getTempDir("ScanlineWriter");
+
+        ScanlineWriter::ExrOptions options;
+        options.exportAlpha = true;
+        options.halfFloat = false;
+        options.compression = ScanlineWriter::ExrCompression::None;
+        ScanlineWriter::writeEXR(dir / "float.exr", width, height, reader, options);
+        testRoundTrip(ctx, dir / "float.exr", width, height, pixels, true, false);
+
+        options.halfFloat = true;
+        options.compression = ScanlineWriter::ExrCompression::Zip;
+        ScanlineWriter::writeEXR(dir / "half.exr", width, height, reader, options);
+        testRoundTrip(ctx, dir / "half.exr", width, height, pixels, true, true);
+
+        options.exportAlpha = false;
+        options.halfFloat = false;
+        ScanlineWriter::writeEXR(dir / "float_rgb.exr", width, height, reader, options);
+        testRoundTrip(ctx, dir / "float_rgb.exr", width, height, pixels, false, false);
+
+        ScanlineWriter::writePFM(dir / "image.pfm", width, height, reader);
+        testRoundTrip(ctx, dir / "image.pfm", width, height, pixels, false, false);
+
+        // Bitmap::saveImage routes floating-point formats through the streaming writer.
+        Bitmap::saveImage(dir / "bitmap.exr", width, height, Bitmap::FileFormat::ExrFile, Bitmap::ExportFlags::ExportAlpha | Bitmap::ExportFlags::Uncompressed, ResourceFormat::RGBA32Float, true, pixels.data());
+        testRoundTrip(ctx, dir / "bitmap.exr", width, height, pixels, true, false);
+
+        std::filesystem::remove_all(dir);
+    }
+
+    CPU_TEST(AsyncImageWriter)
+    {
+        const uint32_t width = 64;
+        const uint32_t height = 48;
+        const size_t frameBytes = size_t(width) * height * 4 * sizeof(float);
+        auto dir = getTempDir("AsyncImageWriter");
+
+        // Budget for two frames to exercise backpressure.
+        AsyncImageWriter writer(2 * frameBytes);
+        std::vector<std::vector<float>> frames;
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            frames.push_back(createFrame(width, height, i));
+            std::vector<uint8_t> data(frameBytes);
+            std::memcpy(data.data(), frames.back().data(), frameBytes);
+            writer.write(dir / fmt::format("frame{}.exr", i), width, height, Bitmap::FileFormat::ExrFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA32Float, std::move(data));
+        }
+        writer.flush();
+
+        auto stats = writer.getStats();
+        EXPECT_EQ(stats.imageCount, 8);
+        EXPECT_EQ(stats.bytesWritten, 8 * frameBytes);
+        EXPECT_LE(stats.peakQueuedBytes, 2 * frameBytes);
+
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            testRoundTrip(ctx, dir / fmt::format("frame{}.exr", i), width, height, frames[i], true, true);
+        }
+
+        std::filesystem::remove_all(dir);
+    }
+
+    CPU_TEST(ImageWriterBenchmark, "Benchmark; run manually")
+    {
+        struct Resolution { uint32_t width; uint32_t height; const char* name; };
+        const Resolution resolutions[] = { { 3840, 2160, "4K" }, { 7680, 4320, "8K" } };
+        const uint32_t frameCount = 4;
+
+        auto dir = getTempDir("ImageWriterBenchmark");
+
+        for (const auto& res : resolutions)
+        {
+            const size_t frameBytes = size_t(res.width) * res.height * 4 * sizeof(float);
+            auto pixels = createFrame(res.width, res.height, 0);
+            auto reader = [&](uint32_t y, uint32_t rowCount, float* pDst)
+            {
+                std::memcpy(pDst, pixels.data() + size_t(y) * res.width * 4, size_t(rowCount) * res.width * 4 * sizeof(float));
+            };
+
+            auto runSync = [&](const std::string& name, auto&& func)
+            {
+                auto path = dir / name;
+                auto startTime = CpuTimer::getCurrentTimePoint();
+                size_t fileSize = func(path);
+                double ms = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+                logInfo("ImageWriterBenchmark: {} {}: {:.1f} ms, {:.1f} MB, {:.0f} MB/s of pixel data", res.name, name, ms, fileSize / 1e6, frameBytes / 1e3 / ms);
+                std::filesystem::remove(path);
+            };
+
+            ScanlineWriter::ExrOptions options;
+            options.exportAlpha = true;
+            runSync("half_zip.exr", [&](const std::filesystem::path& path) { return ScanlineWriter::writeEXR(path, res.width, res.height, reader, options); });
+            options.halfFloat = false;
+            options.compression = ScanlineWriter::ExrCompression::None;
+            runSync("float_none.exr", [&](const std::filesystem::path& path) { return ScanlineWriter::writeEXR(path, res.width, res.height, reader, options); });
+            runSync("image.pfm", [&](const std::filesystem::path& path) { return ScanlineWriter::writePFM(path, res.width, res.height, reader); });
+
+            // Queue a sequence of frames as a capture loop would. The time spent in write() is what the render loop sees.
+            double submitTime = 0.0;
+            auto startTime = CpuTimer::getCurrentTimePoint();
+            AsyncImageWriter::Stats stats;
+            {
+                AsyncImageWriter writer(2 * frameBytes);
+                for (uint32_t i = 0; i < frameCount; ++i)
+                {
+                    std::vector<uint8_t> data(frameBytes);
+                    std::memcpy(data.data(), pixels.data(), frameBytes);
+                    auto submitStart = CpuTimer::getCurrentTimePoint();
+                    writer.write(dir / fmt::format("frame{}.exr", i), res.width, res.height, Bitmap::FileFormat::ExrFile, Bitmap::ExportFlags::ExportAlpha, ResourceFormat::RGBA32Float, std::move(data));
+                    submitTime += CpuTimer::calcDuration(submitStart, CpuTimer::getCurrentTimePoint());
+                }
+                writer.flush();
+                stats = writer.getStats();
+            }
+            double totalTime = CpuTimer::calcDuration(startTime, CpuTimer::getCurrentTimePoint());
+
+            logInfo("ImageWriterBenchmark: {} async: {} frames, total {:.1f} ms, submit {:.1f} ms (blocked {:.1f} ms), peak queue {:.1f} MB",
+                res.name, frameCount, totalTime, submitTime, stats.blockedTime, stats.peakQueuedBytes / 1e6);
+            EXPECT_EQ(stats.imageCount, frameCount);
+            EXPECT_LE(stats.peakQueuedBytes, 2 * frameBytes);
+        }
+
+        std::filesystem::remove_all(dir);
+    }
+}
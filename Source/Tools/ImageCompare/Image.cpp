@@ -0,0 +1,263 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "Image.h"
+
+#include <FreeImage.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    template<typename T>
+    T clamp(T x, T lo, T hi) { return std::max(lo, std::min(hi, x)); }
+}
+
+void Image::readTile(uint32_t x, uint32_t y, uint32_t width, uint32_t height, float* const planes[4], size_t pitch) const
+{
+    for (uint32_t row = 0; row < height; ++row)
+    {
+        const float* src = getData() + (size_t(y + row) * mWidth + x) * 4;
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            float* dst = planes[c] + row * pitch;
+            for (uint32_t i = 0; i < width; ++i) dst[i] = src[i * 4 + c];
+        }
+    }
+}
+
+void Image::saveToFile(const std::filesystem::path& path, bool writeAlpha) const
+{
+    FREE_IMAGE_FORMAT fifFormat = FIF_UNKNOWN;
+
+    auto pathStr = path.string();
+
+    // Determine file format.
+    fifFormat = FreeImage_GetFIFFromFilename(pathStr.c_str());
+    if (fifFormat == FIF_UNKNOWN) throw std::runtime_error("Unknown image format");
+    if (!FreeImage_FIFSupportsWriting(fifFormat)) throw std::runtime_error("Unsupported image format");
+
+    bool writeFloat = fifFormat == FIF_EXR || fifFormat == FIF_PFM || fifFormat == FIF_HDR;
+    if (fifFormat != FIF_EXR && fifFormat != FIF_PNG) writeAlpha = false;
+
+    // Create bitmap.
+    FIBITMAP* bitmap;
+    const float* src = getData();
+    if (writeFloat)
+    {
+        bitmap = FreeImage_AllocateT(writeAlpha ? FIT_RGBAF : FIT_RGBF, mWidth, mHeight);
+        for (uint32_t y = 0; y < mHeight; y++)
+        {
+            float* dst = reinterpret_cast<float*>(FreeImage_GetScanLine(bitmap, mHeight - y - 1));
+            if (writeAlpha)
+            {
+                std::memcpy(dst, src, mWidth * 4 * sizeof(float));
+                src += mWidth * 4;
+            }
+            else
+            {
+                for (uint32_t x = 0; x < mWidth; ++x)
+                {
+                    dst[0] = src[0];
+                    dst[1] = src[1];
+                    dst[2] = src[2];
+                    dst += 3;
+                    src += 4;
+                }
+            }
+        }
+    }
+    else
+    {
+        bitmap = FreeImage_Allocate(mWidth, mHeight, writeAlpha ? 32 : 24);
+        for (uint32_t y = 0; y < mHeight; y++)
+        {
+            uint8_t* dst = reinterpret_cast<uint8_t*>(FreeImage_GetScanLine(bitmap, mHeight - y - 1));
+            for (uint32_t x = 0; x < mWidth; ++x)
+            {
+                dst[2] = clamp(int(src[0] * 255.f), 0, 255);
+                dst[1] = clamp(int(src[1] * 255.f), 0, 255);
+                dst[0] = clamp(int(src[2] * 255.f), 0, 255);
+                if (writeAlpha) dst[3] = clamp(int(src[3] * 255.f), 0, 255);
+                dst += writeAlpha ? 4 : 3;
+                src += 4;
+            }
+        }
+    }
+
+    // Write image.
+    FreeImage_Save(fifFormat, bitmap, pathStr.c_str());
+    FreeImage_Unload(bitmap);
+}
+
+ImageFile::~ImageFile()
+{
+    if (mpBitmap) FreeImage_Unload(mpBitmap);
+}
+
+ImageFile::SharedPtr ImageFile::loadFromFile(const std::filesystem::path& path)
+{
+    FREE_IMAGE_FORMAT fifFormat = FIF_UNKNOWN;
+
+    auto pathStr = path.string();
+
+    // Determine file format.
+    fifFormat = FreeImage_GetFileType(pathStr.c_str(), 0);
+    if (fifFormat == FIF_UNKNOWN) fifFormat = FreeImage_GetFIFFromFilename(pathStr.c_str());
+    if (fifFormat == FIF_UNKNOWN) throw std::runtime_error("Unknown image format");
+    if (!FreeImage_FIFSupportsReading(fifFormat)) throw std::runtime_error("Unsupported image format");
+
+    // Read image.
+    FIBITMAP* bitmap = FreeImage_Load(fifFormat, pathStr.c_str());
+    if (!bitmap) throw std::runtime_error("Cannot read image");
+
+    // Keep the formats readTile() can convert directly. Convert everything else once.
+    FREE_IMAGE_TYPE type = FreeImage_GetImageType(bitmap);
+    bool isDirect = type == FIT_UINT16 || type == FIT_RGB16 || type == FIT_RGBA16 || type == FIT_FLOAT || type == FIT_RGBF || type == FIT_RGBAF;
+    if (type == FIT_BITMAP) isDirect = FreeImage_GetBPP(bitmap) == 24 || FreeImage_GetBPP(bitmap) == 32;
+    if (!isDirect)
+    {
+        FIBITMAP* convertedBitmap = type == FIT_BITMAP ? FreeImage_ConvertTo32Bits(bitmap) : FreeImage_ConvertToRGBAF(bitmap);
+        FreeImage_Unload(bitmap);
+        if (!convertedBitmap) throw std::runtime_error("Cannot convert to RGBA float format");
+        bitmap = convertedBitmap;
+        type = FreeImage_GetImageType(bitmap);
+    }
+
+    auto image = SharedPtr(new ImageFile());
+    image->mpBitmap = bitmap;
+    image->mWidth = FreeImage_GetWidth(bitmap);
+    image->mHeight = FreeImage_GetHeight(bitmap);
+    image->mIsLinear = type == FIT_FLOAT || type == FIT_RGBF || type == FIT_RGBAF;
+
+    return image;
+}
+
+void ImageFile::readTile(uint32_t x, uint32_t y, uint32_t width, uint32_t height, float* const planes[4], size_t pitch) const
+{
+    const FREE_IMAGE_TYPE type = FreeImage_GetImageType(mpBitmap);
+    const uint32_t bytesPerPixel = FreeImage_GetBPP(mpBitmap) / 8;
+
+    for (uint32_t row = 0; row < height; ++row)
+    {
+        // FreeImage stores images bottom-up.
+        const uint8_t* scanLine = FreeImage_GetScanLine(mpBitmap, mHeight - (y + row) - 1);
+        float* r = planes[0] + row * pitch;
+        float* g = planes[1] + row * pitch;
+        float* b = planes[2] + row * pitch;
+        float* a = planes[3] + row * pitch;
+
+        switch (type)
+        {
+        case FIT_BITMAP:
+        {
+            const uint8_t* src = scanLine + size_t(x) * bytesPerPixel;
+            const bool hasAlpha = bytesPerPixel == 4;
+            for (uint32_t i = 0; i < width; ++i, src += bytesPerPixel)
+            {
+                r[i] = src[FI_RGBA_RED] / 255.f;
+                g[i] = src[FI_RGBA_GREEN] / 255.f;
+                b[i] = src[FI_RGBA_BLUE] / 255.f;
+                a[i] = hasAlpha ? src[FI_RGBA_ALPHA] / 255.f : 1.f;
+            }
+            break;
+        }
+        case FIT_UINT16:
+        {
+            const uint16_t* src = reinterpret_cast<const uint16_t*>(scanLine) + x;
+            for (uint32_t i = 0; i < width; ++i)
+            {
+                r[i] = g[i] = b[i] = src[i] / 65535.f;
+                a[i] = 1.f;
+            }
+            break;
+        }
+        case FIT_RGB16:
+        {
+            const FIRGB16* src = reinterpret_cast<const FIRGB16*>(scanLine) + x;
+            for (uint32_t i = 0; i < width; ++i)
+            {
+                r[i] = src[i].red / 65535.f;
+                g[i] = src[i].green / 65535.f;
+                b[i] = src[i].blue / 65535.f;
+                a[i] = 1.f;
+            }
+            break;
+        }
+        case FIT_RGBA16:
+        {
+            const FIRGBA16* src = reinterpret_cast<const FIRGBA16*>(scanLine) + x;
+            for (uint32_t i = 0; i < width; ++i)
+            {
+                r[i] = src[i].red / 65535.f;
+                g[i] = src[i].green / 65535.f;
+                b[i] = src[i].blue / 65535.f;
+                a[i] = src[i].alpha / 65535.f;
+            }
+            break;
+        }
+        case FIT_FLOAT:
+        {
+            const float* src = reinterpret_cast<const float*>(scanLine) + x;
+            for (uint32_t i = 0; i < width; ++i)
+            {
+                r[i] = g[i] = b[i] = src[i];
+                a[i] = 1.f;
+            }
+            break;
+        }
+        case FIT_RGBF:
+        {
+            const FIRGBF* src = reinterpret_cast<const FIRGBF*>(scanLine) + x;
+            for (uint32_t i = 0; i < width; ++i)
+            {
+                r[i] = src[i].red;
+                g[i] = src[i].green;
+                b[i] = src[i].blue;
+                a[i] = 1.f;
+            }
+            break;
+        }
+        case FIT_RGBAF:
+        {
+            const FIRGBAF* src = reinterpret_cast<const FIRGBAF*>(scanLine) + x;
+            for (uint32_t i = 0; i < width; ++i)
+            {
+                r[i] = src[i].red;
+                g[i] = src[i].green;
+                b[i] = src[i].blue;
+                a[i] = src[i].alpha;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
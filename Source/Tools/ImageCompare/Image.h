@@ -0,0 +1,96 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+
+#include "ImageComparison.h"
+
+#include <filesystem>
+#include <memory>
+
+struct FIBITMAP;
+
+/** Image with RGBA float pixel data in memory. Row 0 is the top row.
+*/
+class Image : public ImageSource
+{
+public:
+    using SharedPtr = std::shared_ptr<Image>;
+
+    uint32_t getWidth() const override { return mWidth; }
+    uint32_t getHeight() const override { return mHeight; }
+    bool isLinear() const override { return true; }
+    void readTile(uint32_t x, uint32_t y, uint32_t width, uint32_t height, float* const planes[4], size_t pitch) const override;
+
+    const float* getData() const { return mData.get(); }
+    float* getData() { return mData.get(); }
+
+    static SharedPtr create(uint32_t width, uint32_t height) { return SharedPtr(new Image(width, height)); }
+
+    void saveToFile(const std::filesystem::path& path, bool writeAlpha = true) const;
+
+private:
+    uint32_t mWidth;
+    uint32_t mHeight;
+    std::unique_ptr<float[]> mData;
+
+    Image(uint32_t width, uint32_t height)
+        : mWidth(width)
+        , mHeight(height)
+        , mData(std::make_unique<float[]>(size_t(width) * height * 4))
+    {}
+};
+
+/** Image loaded from file and kept in its native pixel format.
+    Pixels are converted to float on the fly when tiles are read, which avoids holding a full RGBA float copy of the image.
+*/
+class ImageFile : public ImageSource
+{
+public:
+    using SharedPtr = std::shared_ptr<ImageFile>;
+
+    ImageFile(const ImageFile&) = delete;
+    ImageFile& operator=(const ImageFile&) = delete;
+    ~ImageFile();
+
+    /** Load an image. Throws std::runtime_error on failure.
+    */
+    static SharedPtr loadFromFile(const std::filesystem::path& path);
+
+    uint32_t getWidth() const override { return mWidth; }
+    uint32_t getHeight() const override { return mHeight; }
+    bool isLinear() const override { return mIsLinear; }
+    void readTile(uint32_t x, uint32_t y, uint32_t width, uint32_t height, float* const planes[4], size_t pitch) const override;
+
+private:
+    ImageFile() = default;
+
+    FIBITMAP* mpBitmap = nullptr;
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    bool mIsLinear = false;
+};
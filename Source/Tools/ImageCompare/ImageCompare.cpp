@@ -25,221 +25,34 @@
  # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  **************************************************************************/
-#include <FreeImage.h>
+#include "Image.h"
+#include "ImageComparison.h"
+
 #include <args.hxx>
+#include <json/json.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
 #include <stdexcept>
-#include <map>
-#include <functional>
 #include <filesystem>
 
-#include <cmath>
-#include <cstring>
-
-template<typename T>
-T sqr(T x) { return x * x; }
-
 template<typename T>
 T lerp(T a, T b, T t) { return a + t * (b - a); }
 
 template<typename T>
 T clamp(T x, T lo, T hi) { return std::max(lo, std::min(hi, x)); }
 
-class Image
-{
-public:
-    using SharedPtr = std::shared_ptr<Image>;
-
-    uint32_t getWidth() const { return mWidth; }
-    uint32_t getHeight() const { return mHeight; }
-    const float* getData() const { return mData.get(); }
-    float* getData() { return mData.get(); }
-
-    static SharedPtr create(uint32_t width, uint32_t height) { return SharedPtr(new Image(width, height)); }
-
-    static SharedPtr loadFromFile(const std::filesystem::path& path)
-    {
-        FREE_IMAGE_FORMAT fifFormat = FIF_UNKNOWN;
-
-        auto pathStr = path.string();
-
-        // Determine file format.
-        fifFormat = FreeImage_GetFileType(pathStr.c_str(), 0);
-        if (fifFormat == FIF_UNKNOWN) fifFormat = FreeImage_GetFIFFromFilename(pathStr.c_str());
-        if (fifFormat == FIF_UNKNOWN) throw std::runtime_error("Unknown image format");
-        if (!FreeImage_FIFSupportsReading(fifFormat)) throw std::runtime_error("Unsupported image format");
-
-        // Read image.
-        FIBITMAP* srcBitmap = FreeImage_Load(fifFormat, pathStr.c_str());
-        if (!srcBitmap) throw std::runtime_error("Cannot read image");
-
-        // Convert to RGBA32F.
-        FIBITMAP* floatBitmap = FreeImage_ConvertToRGBAF(srcBitmap);
-        FreeImage_Unload(srcBitmap);
-        if (!floatBitmap) throw std::runtime_error("Cannot convert to RGBA float format");
-
-        // Create image.
-        auto image = create(FreeImage_GetWidth(floatBitmap), FreeImage_GetHeight(floatBitmap));
-        int bytesPerPixel = 4 * sizeof(float);
-        FreeImage_ConvertToRawBits(reinterpret_cast<BYTE*>(image->getData()), floatBitmap, bytesPerPixel * image->getWidth(), bytesPerPixel * 8, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, true);
-        FreeImage_Unload(floatBitmap);
-
-        return image;
-    }
-
-    void saveToFile(const std::filesystem::path& path, bool writeAlpha = true) const
-    {
-        FREE_IMAGE_FORMAT fifFormat = FIF_UNKNOWN;
-
-        auto pathStr = path.string();
-
-        // Determine file format.
-        fifFormat = FreeImage_GetFIFFromFilename(pathStr.c_str());
-        if (fifFormat == FIF_UNKNOWN) throw std::runtime_error("Unknown image format");
-        if (!FreeImage_FIFSupportsWriting(fifFormat)) throw std::runtime_error("Unsupported image format");
-
-        bool writeFloat = fifFormat == FIF_EXR || fifFormat == FIF_PFM || fifFormat == FIF_HDR;
-        if (fifFormat != FIF_EXR && fifFormat != FIF_PNG) writeAlpha = false;
-
-        // Create bitmap.
-        FIBITMAP* bitmap;
-        const float* src = getData();
-        if (writeFloat)
-        {
-            bitmap = FreeImage_AllocateT(writeAlpha ? FIT_RGBAF : FIT_RGBF, mWidth, mHeight);
-            for (uint32_t y = 0; y < mHeight; y++)
-            {
-                float* dst = reinterpret_cast<float*>(FreeImage_GetScanLine(bitmap, mHeight - y - 1));
-                if (writeAlpha)
-                {
-                    std::memcpy(dst, src, mWidth * 4 * sizeof(float));
-                    src += mWidth * 4;
-                }
-                else
-                {
-                    for (uint32_t x = 0; x < mWidth; ++x)
-                    {
-                        dst[0] = src[0];
-                        dst[1] = src[1];
-                        dst[2] = src[2];
-                        dst += 3;
-                        src += 4;
-                    }
-                }
-            }
-        }
-        else
-        {
-            bitmap = FreeImage_Allocate(mWidth, mHeight, writeAlpha ? 32 : 24);
-            for (uint32_t y = 0; y < mHeight; y++)
-            {
-                uint8_t* dst = reinterpret_cast<uint8_t*>(FreeImage_GetScanLine(bitmap, mHeight - y - 1));
-                for (uint32_t x = 0; x < mWidth; ++x)
-                {
-                    dst[2] = clamp(int(src[0] * 255.f), 0, 255);
-                    dst[1] = clamp(int(src[1] * 255.f), 0, 255);
-                    dst[0] = clamp(int(src[2] * 255.f), 0, 255);
-                    if (writeAlpha) dst[3] = clamp(int(src[3] * 255.f), 0, 255);
-                    dst += writeAlpha ? 4 : 3;
-                    src += 4;
-                }
-            }
-        }
-
-        // Write image.
-        FreeImage_Save(fifFormat, bitmap, pathStr.c_str());
-        FreeImage_Unload(bitmap);
-    }
-
-private:
-    uint32_t mWidth;
-    uint32_t mHeight;
-    std::unique_ptr<float[]> mData;
-
-    Image(uint32_t width, uint32_t height)
-        : mWidth(width)
-        , mHeight(height)
-        , mData(std::make_unique<float[]>(width * height * 4))
-    {}
-};
-
-struct MSE
-{
-    double operator()(const float* a, const float* b, size_t count) const
-    {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += sqr(a[i] - b[i]); }
-        return error / count;
-    }
-};
-
-struct RMSE
-{
-    double operator()(const float* a, const float* b, size_t count) const
-    {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += sqr(a[i] - b[i]) / (sqr(a[i]) + 1e-3); }
-        return error / count;
-    }
-};
-
-struct MAE
-{
-    double operator()(const float* a, const float* b, size_t count) const
-    {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += std::fabs(sqr(a[i] - b[i])); }
-        return error / count;
-    }
-};
-
-struct MAPE
-{
-    double operator()(const float* a, const float* b, size_t count) const
-    {
-        double error = 0.0;
-        for (size_t i = 0; i < count; ++i) { error += std::fabs((a[i] - b[i]) / (a[i] + 1e-3)); }
-        return 100.0 * error / count;
-    }
-};
-
-template<typename Metric>
-double compare(const Image& imageA, const Image& imageB, bool alpha, float* errorMap)
-{
-    Metric metric;
-    double sum = 0.0;
-    const float* a = imageA.getData();
-    const float* b = imageB.getData();
-    size_t count = imageA.getWidth() * imageA.getHeight();
-    for (size_t i = 0; i < count; ++i)
-    {
-        double error = metric(a, b, alpha ? 4 : 3);
-        if (errorMap) *errorMap++ = float(error);
-        sum += error;
-        a += 4;
-        b += 4;
-    }
-    return sum / count;
-}
-
-struct ErrorMetric
-{
-    std::string name;
-    std::string desc;
-    std::function<double(const Image& imageA, const Image& imageB, bool alpha, float* errorMap)> compare;
-};
-
-static const std::vector<ErrorMetric> errorMetrics =
-{
-    { "mse", "Mean Squared Error", compare<MSE> },
-    { "rmse", "Relative Mean Squared Error", compare<RMSE> },
-    { "mae", "Mean Absolute Error", compare<MAE> },
-    { "mape", "Mean Absolute Percentage Error", compare<MAPE> },
-};
+static const std::vector<std::string> kImageExtensions = { ".png", ".jpg", ".tga", ".bmp", ".pfm", ".exr" };
+static const std::string kErrorImageSuffix = ".error.png";
 
 static Image::SharedPtr generateHeatMap(uint32_t width, uint32_t height, const float* errorMap)
 {
@@ -258,11 +71,11 @@ static Image::SharedPtr generateHeatMap(uint32_t width, uint32_t height, const f
         *dst++ = 1.f;
     };
 
-    const auto [minValue, maxValue] = std::minmax_element(errorMap, errorMap + width * height);
+    const auto [minValue, maxValue] = std::minmax_element(errorMap, errorMap + size_t(width) * height);
     const float range = std::max(1e-5f, *maxValue - *minValue);
     auto image = Image::create(width, height);
     float* dst = image->getData();
-    for (size_t i = 0; i < width * height; ++i)
+    for (size_t i = 0; i < size_t(width) * height; ++i)
     {
         float t = clamp((errorMap[i] - *minValue) / range, 0.f, 1.f);
         writeColor(t, dst);
@@ -272,72 +85,202 @@ static Image::SharedPtr generateHeatMap(uint32_t width, uint32_t height, const f
     return image;
 }
 
-static bool compareImages(const std::filesystem::path& pathA, const std::filesystem::path& pathB, ErrorMetric metric, float threshold, bool alpha, const std::filesystem::path& heatMapPath)
+struct CompareJob
+{
+    std::string name;
+    std::filesystem::path pathA;
+    std::filesystem::path pathB;
+    std::filesystem::path heatMapPath;
+};
+
+struct CompareReport
+{
+    std::string name;
+    double error = 0.0;
+    bool success = false;
+    std::string message;
+};
+
+struct LoadedImages
 {
-    auto loadImage = [] (const std::filesystem::path& path)
+    ImageFile::SharedPtr imageA;
+    ImageFile::SharedPtr imageB;
+    std::string message;
+};
+
+static LoadedImages loadImages(const CompareJob& job)
+{
+    LoadedImages images;
+    auto loadImage = [&images] (const std::filesystem::path& path)
     {
         try
         {
-            return Image::loadFromFile(path);
+            return ImageFile::loadFromFile(path);
         }
         catch (const std::runtime_error& e)
         {
-            std::cerr << "Cannot load image from '" << path.string() << "' (Error: " << e.what() << ")." << std::endl;
-            return Image::SharedPtr();
+            images.message = "Cannot load image from '" + path.string() + "' (Error: " + e.what() + ").";
+            return ImageFile::SharedPtr();
         }
     };
 
-    auto saveImage = [] (const Image& image, const std::filesystem::path& path)
+    images.imageA = loadImage(job.pathA);
+    if (images.imageA) images.imageB = loadImage(job.pathB);
+    return images;
+}
+
+static CompareReport compareImages(const CompareJob& job, const LoadedImages& images, ErrorMetric metric, float threshold, const CompareOptions& options)
+{
+    CompareReport report;
+    report.name = job.name;
+
+    if (!images.imageA || !images.imageB)
+    {
+        report.error = std::numeric_limits<double>::quiet_NaN();
+        report.message = images.message;
+        return report;
+    }
+
+    const auto& imageA = *images.imageA;
+    const auto& imageB = *images.imageB;
+
+    // Check resolution.
+    if (imageA.getWidth() != imageB.getWidth() || imageA.getHeight() != imageB.getHeight())
+    {
+        report.error = std::numeric_limits<double>::quiet_NaN();
+        report.message = "Cannot compare images with different resolutions.";
+        return report;
+    }
+
+    uint32_t width = imageA.getWidth();
+    uint32_t height = imageA.getHeight();
+
+    // Compare images.
+    std::unique_ptr<float[]> errorMap = job.heatMapPath.empty() ? nullptr : std::make_unique<float[]>(size_t(width) * height);
+    report.error = compareImages(imageA, imageB, metric, options, errorMap.get());
+
+    // Generate heat map.
+    if (errorMap)
     {
         try
         {
-            image.saveToFile(path);
+            generateHeatMap(width, height, errorMap.get())->saveToFile(job.heatMapPath);
         }
         catch (const std::runtime_error& e)
         {
-            std::cerr << "Cannot save image to '" << path.string() << "' (Error: " << e.what() << ")." << std::endl;
+            std::cerr << "Cannot save image to '" << job.heatMapPath.string() << "' (Error: " << e.what() << ")." << std::endl;
         }
-    };
+    }
+
+    // Treat nans and infs as errors.
+    report.success = !std::isnan(report.error) && !std::isinf(report.error) && report.error <= threshold;
+    return report;
+}
 
-    // Load images.
-    auto imageA = loadImage(pathA);
-    if (!imageA) return false;
-    auto imageB = loadImage(pathB);
-    if (!imageB) return false;
+/** Compare a list of image pairs. Loading of the next pair overlaps with comparing the current pair.
+*/
+static std::vector<CompareReport> runJobs(const std::vector<CompareJob>& jobs, ErrorMetric metric, float threshold, const CompareOptions& options)
+{
+    std::vector<CompareReport> reports;
+    if (jobs.empty()) return reports;
 
-    // Check resolution.
-    if (imageA->getWidth() != imageB->getWidth() || imageA->getHeight() != imageB->getHeight())
+    std::future<LoadedImages> next = std::async(std::launch::async, loadImages, std::cref(jobs[0]));
+    for (size_t i = 0; i < jobs.size(); ++i)
     {
-        std::cerr << "Cannot compare images with different resolutions." << std::endl;
-        return false;
+        LoadedImages images = next.get();
+        if (i + 1 < jobs.size()) next = std::async(std::launch::async, loadImages, std::cref(jobs[i + 1]));
+        reports.push_back(compareImages(jobs[i], images, metric, threshold, options));
     }
+    return reports;
+}
 
-    uint32_t width = imageA->getWidth();
-    uint32_t height = imageB->getHeight();
+static bool isImageFile(const std::filesystem::path& path)
+{
+    auto name = path.filename().string();
+    if (name.size() >= kErrorImageSuffix.size() && name.compare(name.size() - kErrorImageSuffix.size(), kErrorImageSuffix.size(), kErrorImageSuffix) == 0) return false;
+    auto ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [] (char c) { return (char)std::tolower(c); });
+    return std::find(kImageExtensions.begin(), kImageExtensions.end(), ext) != kImageExtensions.end();
+}
 
-    // Compare images.
-    std::unique_ptr<float[]> errorMap = heatMapPath.empty() ? nullptr : std::make_unique<float[]>(width * height);
-    double error = metric.compare(*imageA, *imageB, alpha, errorMap.get());
+/** Collect image pairs with the same relative path in two directories.
+    Images that only exist in one of the directories are reported as failures.
+*/
+static std::vector<CompareJob> collectJobs(const std::filesystem::path& dirA, const std::filesystem::path& dirB, const std::filesystem::path& heatMapDir, std::vector<CompareReport>& missing)
+{
+    auto collect = [] (const std::filesystem::path& dir)
+    {
+        std::vector<std::filesystem::path> files;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(dir))
+        {
+            if (entry.is_regular_file() && isImageFile(entry.path())) files.push_back(entry.path().lexically_relative(dir));
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    };
 
-    // Generate heat map.
-    if (errorMap)
+    auto filesA = collect(dirA);
+    auto filesB = collect(dirB);
+
+    std::vector<CompareJob> jobs;
+    for (const auto& file : filesA)
+    {
+        if (!std::binary_search(filesB.begin(), filesB.end(), file))
+        {
+            missing.push_back({ file.generic_string(), std::numeric_limits<double>::quiet_NaN(), false, "Image is missing in '" + dirB.string() + "'." });
+            continue;
+        }
+
+        CompareJob job{ file.generic_string(), dirA / file, dirB / file };
+        if (!heatMapDir.empty())
+        {
+            job.heatMapPath = heatMapDir / (file.string() + kErrorImageSuffix);
+            std::filesystem::create_directories(job.heatMapPath.parent_path());
+        }
+        jobs.push_back(job);
+    }
+    for (const auto& file : filesB)
     {
-        auto heatMap = generateHeatMap(width, height, errorMap.get());
-        saveImage(*heatMap, heatMapPath);
+        if (!std::binary_search(filesA.begin(), filesA.end(), file))
+        {
+            missing.push_back({ file.generic_string(), std::numeric_limits<double>::quiet_NaN(), false, "Image is missing in '" + dirA.string() + "'." });
+        }
     }
 
-    std::cout << error << std::endl;
+    return jobs;
+}
 
-    // Treat nans and infs as errors.
-    if (std::isnan(error) || std::isinf(error)) return false;
+static void writeJsonReport(const std::filesystem::path& path, const std::string& metric, float threshold, const std::vector<CompareReport>& reports)
+{
+    nlohmann::json images = nlohmann::json::array();
+    bool success = true;
+    for (const auto& report : reports)
+    {
+        nlohmann::json image = {
+            { "name", report.name },
+            { "success", report.success },
+            { "error", report.error }, // NaN is written as null.
+            { "tolerance", threshold },
+        };
+        if (!report.message.empty()) image["message"] = report.message;
+        images.push_back(image);
+        success = success && report.success;
+    }
+
+    nlohmann::json json = {
+        { "metric", metric },
+        { "tolerance", threshold },
+        { "success", success },
+        { "images", images },
+    };
 
-    return error <= threshold;
+    std::ofstream(path) << json.dump(4) << std::endl;
 }
 
 static void printMetrics(std::ostream &stream = std::cout)
 {
     stream << "Available error metrics:" << std::endl;
-    for (const auto& metric : errorMetrics)
+    for (const auto& metric : getErrorMetrics())
     {
         stream << "  " << metric.name << " - " << metric.desc << std::endl;
     }
@@ -345,16 +288,18 @@ static void printMetrics(std::ostream &stream = std::cout)
 
 int main(int argc, char** argv)
 {
-    args::ArgumentParser parser("Utility to compare images.");
+    args::ArgumentParser parser("Utility to compare images.", "If both arguments are directories, all images with the same relative path are compared (batch mode).");
     parser.helpParams.programName = "ImageCompare";
     args::HelpFlag helpFlag(parser, "help", "Display this help menu.", {'h', "help"});
     args::Flag listMetricsFlag(parser, "", "List available error metrics.", {'l'});
     args::ValueFlag<std::string> metricFlag(parser, "metric", "The error metric.", {'m'});
     args::ValueFlag<float> thresholdFlag(parser, "threshold", "The error threshold.", {'t'});
     args::Flag alphaFlag(parser, "", "Include alpha channel.", {'a'});
-    args::ValueFlag<std::string> heatMapFlag(parser, "filename", "Generate error heat map.", {'e'});
-    args::Positional<std::string> image1(parser, "image1", "The first image.", args::Options::Required);
-    args::Positional<std::string> image2(parser, "image2", "The second image.", args::Options::Required);
+    args::ValueFlag<std::string> heatMapFlag(parser, "filename", "Generate error heat map (output directory in batch mode).", {'e'});
+    args::ValueFlag<std::string> jsonFlag(parser, "filename", "Write a JSON report.", {'j', "json"});
+    args::ValueFlag<float> ppdFlag(parser, "ppd", "Pixels per degree for the FLIP metric (default 67).", {"ppd"});
+    args::Positional<std::string> image1(parser, "image1", "The first (reference) image or directory.", args::Options::Required);
+    args::Positional<std::string> image2(parser, "image2", "The second image or directory.", args::Options::Required);
     args::CompletionFlag completionFlag(parser, {"complete"});
 
     try
@@ -390,26 +335,68 @@ int main(int argc, char** argv)
         return 0;
     }
 
-    ErrorMetric metric = errorMetrics.front();
+    ErrorMetricInfo metric = getErrorMetrics().front();
     if (metricFlag)
     {
         auto name = args::get(metricFlag);
-        auto it = std::find_if(errorMetrics.begin(), errorMetrics.end(), [&name] (const ErrorMetric& metric) { return metric.name == name; });
-        if (it == errorMetrics.end())
+        const auto& metrics = getErrorMetrics();
+        auto it = std::find_if(metrics.begin(), metrics.end(), [&name] (const ErrorMetricInfo& metric) { return metric.name == name; });
+        if (it == metrics.end())
         {
             std::cerr << "Unknown error metric '" << args::get(metricFlag) << "'." << std::endl;
             printMetrics(std::cerr);
             return 1;
         }
         metric = *it;
+        if (!metric.replacement.empty())
+        {
+            std::cerr << "Warning: Error metric '" << metric.name << "' is deprecated, use '" << metric.replacement << "' instead." << std::endl;
+        }
+    }
+
+    CompareOptions options;
+    options.alpha = alphaFlag ? args::get(alphaFlag) : false;
+    if (ppdFlag) options.pixelsPerDegree = args::get(ppdFlag);
+
+    const float threshold = thresholdFlag ? args::get(thresholdFlag) : 0.f;
+    const std::filesystem::path pathA = args::get(image1);
+    const std::filesystem::path pathB = args::get(image2);
+    const std::filesystem::path heatMapPath = heatMapFlag ? args::get(heatMapFlag) : "";
+    const bool batch = std::filesystem::is_directory(pathA) && std::filesystem::is_directory(pathB);
+
+    std::vector<CompareReport> reports;
+    if (batch)
+    {
+        std::vector<CompareReport> missing;
+        auto jobs = collectJobs(pathA, pathB, heatMapPath, missing);
+        reports = runJobs(jobs, metric.metric, threshold, options);
+        reports.insert(reports.end(), missing.begin(), missing.end());
+
+        for (const auto& report : reports)
+        {
+            std::cout << report.name << ": " << report.error << (report.success ? "" : " FAILED");
+            if (!report.message.empty()) std::cout << " (" << report.message << ")";
+            std::cout << std::endl;
+        }
     }
+    else
+    {
+        CompareJob job{ pathA.filename().string(), pathA, pathB, heatMapPath };
+        reports = runJobs({ job }, metric.metric, threshold, options);
+
+        const auto& report = reports.front();
+        if (!report.message.empty())
+        {
+            std::cerr << report.message << std::endl;
+        }
+        else
+        {
+            std::cout << report.error << std::endl;
+        }
+    }
+
+    if (jsonFlag) writeJsonReport(args::get(jsonFlag), metric.name, threshold, reports);
 
-    return compareImages(
-        args::get(image1),
-        args::get(image2),
-        metric,
-        thresholdFlag ? args::get(thresholdFlag) : 0.f,
-        alphaFlag ? args::get(alphaFlag) : false,
-        heatMapFlag ? args::get(heatMapFlag) : ""
-    ) ? 0 : 1;
+    bool success = std::all_of(reports.begin(), reports.end(), [] (const CompareReport& report) { return report.success; });
+    return success ? 0 : 1;
 }
@@ -0,0 +1,563 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#include "ImageComparison.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <execution>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+    const float kEpsilon = 1e-3f;
+
+    const std::vector<ErrorMetricInfo> kErrorMetrics =
+    {
+        { ErrorMetric::MSE, "mse", "Mean Squared Error" },
+        { ErrorMetric::RelMSE, "rmse", "Relative Mean Squared Error (deprecated, use relmse, or rootmse for the root mean squared error)", "relmse" },
+        { ErrorMetric::RelMSE, "relmse", "Relative Mean Squared Error" },
+        { ErrorMetric::RootMSE, "rootmse", "Root Mean Squared Error" },
+        { ErrorMetric::MAE, "mae", "Mean Absolute Error" },
+        { ErrorMetric::MAPE, "mape", "Mean Absolute Percentage Error" },
+        { ErrorMetric::SMAPE, "smape", "Symmetric Mean Absolute Percentage Error" },
+        { ErrorMetric::MaxError, "max", "Maximum Absolute Error" },
+        { ErrorMetric::FLIP, "flip", "Mean FLIP Error (LDR-FLIP, float images are clamped to [0,1])" },
+    };
+
+    /** Rectangle in image coordinates.
+    */
+    struct Rect
+    {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        size_t getArea() const { return size_t(width) * height; }
+    };
+
+    /** Per-tile partial result. Partial results are reduced in tile order.
+    */
+    struct TileResult
+    {
+        double sum = 0.0;
+        float max = 0.f;
+    };
+
+    /** Per-thread scratch memory, reused across tiles.
+    */
+    class TileScratch
+    {
+    public:
+        float* get(size_t index, size_t size)
+        {
+            if (index >= mBuffers.size()) mBuffers.resize(index + 1);
+            if (mBuffers[index].size() < size) mBuffers[index].resize(size);
+            return mBuffers[index].data();
+        }
+
+        int32_t* getIndices(size_t size)
+        {
+            if (mIndices.size() < size) mIndices.resize(size);
+            return mIndices.data();
+        }
+
+    private:
+        std::vector<std::vector<float>> mBuffers;
+        std::vector<int32_t> mIndices;
+    };
+
+    /** Mirror an index at the borders of [0, n) (symmetric boundary condition, edge pixel repeated).
+    */
+    int32_t reflect(int32_t i, int32_t n)
+    {
+        if (i < 0) i = -i - 1;
+        if (i >= n) i = 2 * n - i - 1;
+        return std::clamp(i, 0, n - 1);
+    }
+
+    // Simple metrics.
+
+    void computePixelErrors(ErrorMetric metric, const float* const a[4], const float* const b[4], uint32_t channelCount, size_t count, float* dst)
+    {
+        // All loops run over contiguous planes so the compiler can vectorize them.
+        std::fill(dst, dst + count, 0.f);
+
+        for (uint32_t c = 0; c < channelCount; ++c)
+        {
+            const float* pa = a[c];
+            const float* pb = b[c];
+
+            switch (metric)
+            {
+            case ErrorMetric::MSE:
+            case ErrorMetric::RootMSE:
+                for (size_t i = 0; i < count; ++i) { float d = pa[i] - pb[i]; dst[i] += d * d; }
+                break;
+            case ErrorMetric::RelMSE:
+                for (size_t i = 0; i < count; ++i) { float d = pa[i] - pb[i]; dst[i] += d * d / (pa[i] * pa[i] + kEpsilon); }
+                break;
+            case ErrorMetric::MAE:
+                for (size_t i = 0; i < count; ++i) { dst[i] += std::fabs(pa[i] - pb[i]); }
+                break;
+            case ErrorMetric::MAPE:
+                for (size_t i = 0; i < count; ++i) { dst[i] += std::fabs((pa[i] - pb[i]) / (pa[i] + kEpsilon)); }
+                break;
+            case ErrorMetric::SMAPE:
+                for (size_t i = 0; i < count; ++i) { dst[i] += 2.f * std::fabs(pa[i] - pb[i]) / (std::fabs(pa[i]) + std::fabs(pb[i]) + kEpsilon); }
+                break;
+            case ErrorMetric::MaxError:
+                // Written to propagate NaNs.
+                for (size_t i = 0; i < count; ++i) { float e = std::fabs(pa[i] - pb[i]); dst[i] = std::isnan(e) ? e : std::max(dst[i], e); }
+                break;
+            default:
+                throw std::runtime_error("Unsupported error metric");
+            }
+        }
+
+        float scale = 1.f;
+        switch (metric)
+        {
+        case ErrorMetric::MAPE:
+        case ErrorMetric::SMAPE:
+            scale = 100.f / channelCount;
+            break;
+        case ErrorMetric::MaxError:
+            break;
+        default:
+            scale = 1.f / channelCount;
+            break;
+        }
+        if (scale != 1.f)
+        {
+            for (size_t i = 0; i < count; ++i) dst[i] *= scale;
+        }
+    }
+
+    // FLIP (LDR-FLIP, Andersson et al. 2020, "FLIP: A Difference Evaluator for Alternating Images").
+
+    const float kFlipGqc = 0.7f;    ///< Color error exponent.
+    const float kFlipGpc = 0.4f;    ///< Color error redistribution cutoff.
+    const float kFlipGpt = 0.95f;   ///< Color error redistribution point.
+    const float kFlipGw = 0.082f;   ///< Feature detector width in degrees.
+    const float kFlipGqf = 0.5f;    ///< Feature error exponent.
+    const float kPi = 3.14159265358979323846f;
+
+    using float3 = std::array<float, 3>;
+
+    float3 linearRGBToXYZ(const float3& c)
+    {
+        return {
+            0.4124564f * c[0] + 0.3575761f * c[1] + 0.1804375f * c[2],
+            0.2126729f * c[0] + 0.7151522f * c[1] + 0.0721750f * c[2],
+            0.0193339f * c[0] + 0.1191920f * c[1] + 0.9503041f * c[2],
+        };
+    }
+
+    float3 XYZToLinearRGB(const float3& c)
+    {
+        return {
+             3.2404542f * c[0] - 1.5371385f * c[1] - 0.4985314f * c[2],
+            -0.9692660f * c[0] + 1.8760108f * c[1] + 0.0415560f * c[2],
+             0.0556434f * c[0] - 0.2040259f * c[1] + 1.0572252f * c[2],
+        };
+    }
+
+    const float3 kReferenceWhite = linearRGBToXYZ({ 1.f, 1.f, 1.f });
+
+    float sRGBToLinear(float c)
+    {
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float3 huntLab(const float3& linearRGB)
+    {
+        auto f = [](float t)
+        {
+            const float delta = 6.f / 29.f;
+            return t > delta * delta * delta ? std::cbrt(t) : t / (3.f * delta * delta) + 4.f / 29.f;
+        };
+
+        float3 xyz = linearRGBToXYZ(linearRGB);
+        float fx = f(xyz[0] / kReferenceWhite[0]);
+        float fy = f(xyz[1] / kReferenceWhite[1]);
+        float fz = f(xyz[2] / kReferenceWhite[2]);
+        float L = 116.f * fy - 16.f;
+        float a = 500.f * (fx - fy);
+        float b = 200.f * (fy - fz);
+        return { L, 0.01f * L * a, 0.01f * L * b };
+    }
+
+    float hyAB(const float3& a, const float3& b)
+    {
+        float dL = a[0] - b[0];
+        float da = a[1] - b[1];
+        float db = a[2] - b[2];
+        return std::fabs(dL) + std::sqrt(da * da + db * db);
+    }
+
+    /** Filter kernels and constants for FLIP at a given number of pixels per degree.
+        All 2D kernels used by FLIP are (sums of) separable kernels and are stored as 1D kernels.
+    */
+    struct FlipKernels
+    {
+        static const uint32_t kCsfCount = 4;
+
+        std::vector<float> csf[kCsfCount];  ///< Gaussian components of the contrast sensitivity functions (Y, Cx, Cz, Cz).
+        float csfWeight[kCsfCount];         ///< Weights of the components (2D kernels normalized per channel).
+        std::vector<float> gauss;           ///< Normalized Gaussian for feature detection.
+        std::vector<float> edge;            ///< Normalized first derivative of Gaussian.
+        std::vector<float> point;           ///< Normalized second derivative of Gaussian.
+        uint32_t radius = 0;                ///< Largest kernel radius.
+        float cmax = 0.f;                   ///< Maximum color difference (after exponent).
+        float pccmax = 0.f;                 ///< Redistribution cutoff.
+
+        FlipKernels(float ppd)
+        {
+            // Contrast sensitivity functions: a1 * sqrt(pi / b1) * exp(-pi^2 * x^2 / b1) (+ second term for Cz), x in degrees.
+            const double a[kCsfCount] = { 1.0, 1.0, 34.1, 13.5 };
+            const double b[kCsfCount] = { 0.0047, 0.0053, 0.04, 0.025 };
+            const double maxB = 0.04;
+            const double pi = kPi;
+            const int32_t csfRadius = (int32_t)std::ceil(3.0 * std::sqrt(maxB / (2.0 * pi * pi)) * ppd);
+
+            double sum[kCsfCount];
+            double weight[kCsfCount];
+            for (uint32_t i = 0; i < kCsfCount; ++i)
+            {
+                sum[i] = 0.0;
+                for (int32_t k = -csfRadius; k <= csfRadius; ++k)
+                {
+                    double x = k / double(ppd);
+                    double value = std::exp(-pi * pi * x * x / b[i]);
+                    csf[i].push_back(float(value));
+                    sum[i] += value;
+                }
+                weight[i] = a[i] * std::sqrt(pi / b[i]);
+            }
+
+            // Normalize the 2D kernels of each channel to unit sum.
+            csfWeight[0] = float(1.0 / (sum[0] * sum[0]));
+            csfWeight[1] = float(1.0 / (sum[1] * sum[1]));
+            double normCz = weight[2] * sum[2] * sum[2] + weight[3] * sum[3] * sum[3];
+            csfWeight[2] = float(weight[2] / normCz);
+            csfWeight[3] = float(weight[3] / normCz);
+
+            // Feature detection kernels. Positive and negative weights are normalized separately.
+            const double sd = 0.5 * kFlipGw * ppd;
+            const int32_t featureRadius = (int32_t)std::ceil(3.0 * sd);
+            double gaussSum = 0.0, edgePos = 0.0, edgeNeg = 0.0, pointPos = 0.0, pointNeg = 0.0;
+            std::vector<double> g, e, p;
+            for (int32_t k = -featureRadius; k <= featureRadius; ++k)
+            {
+                double x = k;
+                double gv = std::exp(-(x * x) / (2.0 * sd * sd));
+                double ev = -x * gv;
+                double pv = (x * x / (sd * sd) - 1.0) * gv;
+                g.push_back(gv);
+                e.push_back(ev);
+                p.push_back(pv);
+                gaussSum += gv;
+                (ev > 0.0 ? edgePos : edgeNeg) += std::fabs(ev);
+                (pv > 0.0 ? pointPos : pointNeg) += std::fabs(pv);
+            }
+            for (size_t i = 0; i < g.size(); ++i)
+            {
+                gauss.push_back(float(g[i] / gaussSum));
+                edge.push_back(float(e[i] / (e[i] > 0.0 ? edgePos : edgeNeg)));
+                point.push_back(float(p[i] / (p[i] > 0.0 ? pointPos : pointNeg)));
+            }
+
+            radius = (uint32_t)std::max(csfRadius, featureRadius);
+
+            cmax = std::pow(hyAB(huntLab({ 0.f, 1.f, 0.f }), huntLab({ 0.f, 0.f, 1.f })), kFlipGqc);
+            pccmax = kFlipGpc * cmax;
+        }
+    };
+
+    /** Correlate a region plane with the separable kernel kx(x) * ky(y) and write the result for the tile.
+        Samples outside the image are mirrored at the image borders. The region must contain all image pixels within the kernel radius of the tile.
+    */
+    void convolve(const float* src, const Rect& region, const Rect& tile, uint32_t imageWidth, uint32_t imageHeight,
+        const std::vector<float>& kx, const std::vector<float>& ky, float weight, bool accumulate, TileScratch& scratch, float* dst)
+    {
+        const int32_t rx = int32_t(kx.size() / 2);
+        const int32_t ry = int32_t(ky.size() / 2);
+        const uint32_t lineWidth = tile.width + 2 * rx;
+
+        float* line = scratch.get(0, lineWidth);
+        float* tmp = scratch.get(1, size_t(region.height) * tile.width);
+        int32_t* columns = scratch.getIndices(lineWidth);
+
+        for (uint32_t i = 0; i < lineWidth; ++i)
+        {
+            columns[i] = reflect(int32_t(tile.x + i) - rx, int32_t(imageWidth)) - int32_t(region.x);
+        }
+
+        // Horizontal pass over all region rows.
+        for (uint32_t y = 0; y < region.height; ++y)
+        {
+            const float* srcRow = src + size_t(y) * region.width;
+            for (uint32_t i = 0; i < lineWidth; ++i) line[i] = srcRow[columns[i]];
+
+            float* out = tmp + size_t(y) * tile.width;
+            std::fill(out, out + tile.width, 0.f);
+            for (size_t k = 0; k < kx.size(); ++k)
+            {
+                const float w = kx[k];
+                const float* in = line + k;
+                for (uint32_t x = 0; x < tile.width; ++x) out[x] += w * in[x];
+            }
+        }
+
+        // Vertical pass for the tile rows.
+        for (uint32_t y = 0; y < tile.height; ++y)
+        {
+            float* out = dst + size_t(y) * tile.width;
+            if (!accumulate) std::fill(out, out + tile.width, 0.f);
+            for (size_t k = 0; k < ky.size(); ++k)
+            {
+                const int32_t row = reflect(int32_t(tile.y + y + k) - ry, int32_t(imageHeight)) - int32_t(region.y);
+                const float w = weight * ky[k];
+                const float* in = tmp + size_t(row) * tile.width;
+                for (uint32_t x = 0; x < tile.width; ++x) out[x] += w * in[x];
+            }
+        }
+    }
+
+    /** Outputs of the per-image part of FLIP for a tile.
+    */
+    struct FlipTileData
+    {
+        float* L;
+        float* a;
+        float* b;
+        float* edge;
+        float* point;
+    };
+
+    /** Run the per-image part of FLIP on a tile.
+        \param[in,out] planes Region RGBA planes. Overwritten with intermediate data.
+    */
+    void computeFlipTileData(const FlipKernels& kernels, float* const planes[4], bool isLinear, const Rect& region, const Rect& tile,
+        uint32_t imageWidth, uint32_t imageHeight, TileScratch& scratch, size_t scratchBase, FlipTileData& out)
+    {
+        const size_t regionSize = region.getArea();
+        const size_t tileSize = tile.getArea();
+
+        // Convert to YCxCz in place. The alpha plane receives normalized luminance for feature detection.
+        float* Y = planes[0];
+        float* Cx = planes[1];
+        float* Cz = planes[2];
+        float* luminance = planes[3];
+        for (size_t i = 0; i < regionSize; ++i)
+        {
+            float3 rgb = { std::clamp(Y[i], 0.f, 1.f), std::clamp(Cx[i], 0.f, 1.f), std::clamp(Cz[i], 0.f, 1.f) };
+            if (!isLinear) rgb = { sRGBToLinear(rgb[0]), sRGBToLinear(rgb[1]), sRGBToLinear(rgb[2]) };
+            float3 xyz = linearRGBToXYZ(rgb);
+            float x = xyz[0] / kReferenceWhite[0];
+            float y = xyz[1] / kReferenceWhite[1];
+            float z = xyz[2] / kReferenceWhite[2];
+            Y[i] = 116.f * y - 16.f;
+            Cx[i] = 500.f * (x - y);
+            Cz[i] = 200.f * (y - z);
+            luminance[i] = y;
+        }
+
+        // Feature detection on normalized luminance.
+        float* fx = scratch.get(scratchBase + 0, tileSize);
+        float* fy = scratch.get(scratchBase + 1, tileSize);
+        convolve(luminance, region, tile, imageWidth, imageHeight, kernels.edge, kernels.gauss, 1.f, false, scratch, fx);
+        convolve(luminance, region, tile, imageWidth, imageHeight, kernels.gauss, kernels.edge, 1.f, false, scratch, fy);
+        for (size_t i = 0; i < tileSize; ++i) out.edge[i] = std::sqrt(fx[i] * fx[i] + fy[i] * fy[i]);
+        convolve(luminance, region, tile, imageWidth, imageHeight, kernels.point, kernels.gauss, 1.f, false, scratch, fx);
+        convolve(luminance, region, tile, imageWidth, imageHeight, kernels.gauss, kernels.point, 1.f, false, scratch, fy);
+        for (size_t i = 0; i < tileSize; ++i) out.point[i] = std::sqrt(fx[i] * fx[i] + fy[i] * fy[i]);
+
+        // Spatial filtering with the contrast sensitivity functions.
+        float* filteredY = out.L;
+        float* filteredCx = out.a;
+        float* filteredCz = out.b;
+        convolve(Y, region, tile, imageWidth, imageHeight, kernels.csf[0], kernels.csf[0], kernels.csfWeight[0], false, scratch, filteredY);
+        convolve(Cx, region, tile, imageWidth, imageHeight, kernels.csf[1], kernels.csf[1], kernels.csfWeight[1], false, scratch, filteredCx);
+        convolve(Cz, region, tile, imageWidth, imageHeight, kernels.csf[2], kernels.csf[2], kernels.csfWeight[2], false, scratch, filteredCz);
+        convolve(Cz, region, tile, imageWidth, imageHeight, kernels.csf[3], kernels.csf[3], kernels.csfWeight[3], true, scratch, filteredCz);
+
+        // Convert back to linear RGB, clamp and convert to Hunt-adjusted L*a*b*.
+        for (size_t i = 0; i < tileSize; ++i)
+        {
+            float y = (filteredY[i] + 16.f) / 116.f;
+            float x = y + filteredCx[i] / 500.f;
+            float z = y - filteredCz[i] / 200.f;
+            float3 rgb = XYZToLinearRGB({ x * kReferenceWhite[0], y * kReferenceWhite[1], z * kReferenceWhite[2] });
+            float3 lab = huntLab({ std::clamp(rgb[0], 0.f, 1.f), std::clamp(rgb[1], 0.f, 1.f), std::clamp(rgb[2], 0.f, 1.f) });
+            out.L[i] = lab[0];
+            out.a[i] = lab[1];
+            out.b[i] = lab[2];
+        }
+    }
+
+    void computeFlipErrors(const FlipKernels& kernels, const FlipTileData& a, const FlipTileData& b, size_t count, float* dst)
+    {
+        const float invSqrt2 = 1.f / std::sqrt(2.f);
+        for (size_t i = 0; i < count; ++i)
+        {
+            // Color difference, redistributed to [0,1].
+            float hyab = std::pow(hyAB({ a.L[i], a.a[i], a.b[i] }, { b.L[i], b.a[i], b.b[i] }), kFlipGqc);
+            float colorError = hyab < kernels.pccmax
+                ? (kFlipGpt / kernels.pccmax) * hyab
+                : kFlipGpt + ((hyab - kernels.pccmax) / (kernels.cmax - kernels.pccmax)) * (1.f - kFlipGpt);
+
+            // Feature difference.
+            float featureDiff = std::max(std::fabs(a.edge[i] - b.edge[i]), std::fabs(a.point[i] - b.point[i]));
+            float featureError = std::pow(invSqrt2 * featureDiff, kFlipGqf);
+
+            dst[i] = std::pow(colorError, 1.f - featureError);
+        }
+    }
+}
+
+const std::vector<ErrorMetricInfo>& getErrorMetrics()
+{
+    return kErrorMetrics;
+}
+
+double compareImages(const ImageSource& imageA, const ImageSource& imageB, ErrorMetric metric, const CompareOptions& options, float* errorMap)
+{
+    if (imageA.getWidth() != imageB.getWidth() || imageA.getHeight() != imageB.getHeight())
+    {
+        throw std::runtime_error("Cannot compare images with different resolutions.");
+    }
+
+    const uint32_t width = imageA.getWidth();
+    const uint32_t height = imageA.getHeight();
+    const size_t pixelCount = size_t(width) * height;
+    if (pixelCount == 0) return 0.0;
+
+    const uint32_t tileSize = std::max(options.tileSize, 8u);
+    const uint32_t tilesX = (width + tileSize - 1) / tileSize;
+    const uint32_t tilesY = (height + tileSize - 1) / tileSize;
+    const bool isFlip = metric == ErrorMetric::FLIP;
+    const uint32_t channelCount = options.alpha ? 4 : 3;
+
+    std::unique_ptr<FlipKernels> pFlipKernels = isFlip ? std::make_unique<FlipKernels>(options.pixelsPerDegree) : nullptr;
+    const uint32_t apron = isFlip ? pFlipKernels->radius : 0;
+
+    std::vector<uint32_t> tileIndices(size_t(tilesX) * tilesY);
+    std::iota(tileIndices.begin(), tileIndices.end(), 0);
+    std::vector<TileResult> tileResults(tileIndices.size());
+
+    std::for_each(std::execution::par, tileIndices.begin(), tileIndices.end(), [&](uint32_t tileIndex)
+    {
+        thread_local TileScratch scratch;
+
+        Rect tile;
+        tile.x = (tileIndex % tilesX) * tileSize;
+        tile.y = (tileIndex / tilesX) * tileSize;
+        tile.width = std::min(tileSize, width - tile.x);
+        tile.height = std::min(tileSize, height - tile.y);
+
+        // The region read from the images includes an apron for the filter kernels.
+        Rect region;
+        region.x = tile.x - std::min(tile.x, apron);
+        region.y = tile.y - std::min(tile.y, apron);
+        region.width = std::min(tile.x + tile.width + apron, width) - region.x;
+        region.height = std::min(tile.y + tile.height + apron, height) - region.y;
+
+        // Scratch buffers: 0-1 are used by convolve(), 3-10 hold region planes, 11 holds the errors, 12+ are used by FLIP.
+        const size_t regionSize = region.getArea();
+        float* planesA[4];
+        float* planesB[4];
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            planesA[c] = scratch.get(3 + c, regionSize);
+            planesB[c] = scratch.get(7 + c, regionSize);
+        }
+        imageA.readTile(region.x, region.y, region.width, region.height, planesA, region.width);
+        imageB.readTile(region.x, region.y, region.width, region.height, planesB, region.width);
+
+        const size_t count = tile.getArea();
+        float* errors = scratch.get(11, count);
+
+        if (isFlip)
+        {
+            auto allocTileData = [&](size_t base)
+            {
+                return FlipTileData{ scratch.get(base, count), scratch.get(base + 1, count), scratch.get(base + 2, count), scratch.get(base + 3, count), scratch.get(base + 4, count) };
+            };
+            FlipTileData dataA = allocTileData(12);
+            FlipTileData dataB = allocTileData(17);
+            computeFlipTileData(*pFlipKernels, planesA, imageA.isLinear(), region, tile, width, height, scratch, 22, dataA);
+            computeFlipTileData(*pFlipKernels, planesB, imageB.isLinear(), region, tile, width, height, scratch, 22, dataB);
+            computeFlipErrors(*pFlipKernels, dataA, dataB, count, errors);
+        }
+        else
+        {
+            // No apron, so region and tile coincide.
+            computePixelErrors(metric, planesA, planesB, channelCount, count, errors);
+        }
+
+        TileResult result;
+        for (uint32_t y = 0; y < tile.height; ++y)
+        {
+            const float* row = errors + size_t(y) * tile.width;
+            double rowSum = 0.0;
+            for (uint32_t x = 0; x < tile.width; ++x)
+            {
+                rowSum += row[x];
+                result.max = std::isnan(row[x]) ? row[x] : std::max(result.max, row[x]);
+            }
+            result.sum += rowSum;
+
+            if (errorMap) std::copy(row, row + tile.width, errorMap + size_t(tile.y + y) * width + tile.x);
+        }
+        tileResults[tileIndex] = result;
+    });
+
+    // Reduce in tile order to get deterministic results.
+    double sum = 0.0;
+    float max = 0.f;
+    for (const auto& result : tileResults)
+    {
+        sum += result.sum;
+        max = std::isnan(result.max) ? result.max : std::max(max, result.max);
+    }
+
+    switch (metric)
+    {
+    case ErrorMetric::RootMSE:
+        return std::sqrt(sum / pixelCount);
+    case ErrorMetric::MaxError:
+        return max;
+    default:
+        return sum / pixelCount;
+    }
+}
@@ -0,0 +1,102 @@
+/***************************************************************************
+ # Copyright (c) 2015-22, NVIDIA CORPORATION. All rights reserved.
+ #
+ # Redistribution and use in source and binary forms, with or without
+ # modification, are permitted provided that the following conditions
+ # are met:
+ #  * Redistributions of source code must retain the above copyright
+ #    notice, this list of conditions and the following disclaimer.
+ #  * Redistributions in binary form must reproduce the above copyright
+ #    notice, this list of conditions and the following disclaimer in the
+ #    documentation and/or other materials provided with the distribution.
+ #  * Neither the name of NVIDIA CORPORATION nor the names of its
+ #    contributors may be used to endorse or promote products derived
+ #    from this software without specific prior written permission.
+ #
+ # THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS "AS IS" AND ANY
+ # EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ # IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ # PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ # CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ # EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ # PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ # PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ # OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/** Interface for images that can be read tile by tile.
+    Implementations must allow concurrent calls to readTile().
+*/
+class ImageSource
+{
+public:
+    virtual ~ImageSource() = default;
+
+    virtual uint32_t getWidth() const = 0;
+    virtual uint32_t getHeight() const = 0;
+
+    /** Returns true if pixel values are linear (float formats), false if they are sRGB encoded (integer formats).
+    */
+    virtual bool isLinear() const = 0;
+
+    /** Read a rectangle of pixels into planar float RGBA buffers. Row 0 is the top row of the image.
+        \param[in] x Left column of the rectangle.
+        \param[in] y Top row of the rectangle.
+        \param[in] width Width of the rectangle.
+        \param[in] height Height of the rectangle.
+        \param[out] planes Destination planes for the R, G, B and A channels.
+        \param[in] pitch Number of floats between rows in the destination planes.
+    */
+    virtual void readTile(uint32_t x, uint32_t y, uint32_t width, uint32_t height, float* const planes[4], size_t pitch) const = 0;
+};
+
+enum class ErrorMetric
+{
+    MSE,        ///< Mean squared error.
+    RootMSE,    ///< Root mean squared error.
+    RelMSE,     ///< Relative mean squared error.
+    MAE,        ///< Mean absolute error.
+    MAPE,       ///< Mean absolute percentage error.
+    SMAPE,      ///< Symmetric mean absolute percentage error.
+    MaxError,   ///< Maximum absolute error.
+    FLIP,       ///< Mean FLIP error (LDR-FLIP).
+};
+
+struct ErrorMetricInfo
+{
+    ErrorMetric metric;
+    std::string name;
+    std::string desc;
+    std::string replacement;    ///< Name of the metric to use instead if this name is deprecated, empty otherwise.
+};
+
+/** Returns the list of available error metrics.
+*/
+const std::vector<ErrorMetricInfo>& getErrorMetrics();
+
+struct CompareOptions
+{
+    bool alpha = false;             ///< Include the alpha channel (ignored by FLIP).
+    float pixelsPerDegree = 67.f;   ///< Observer pixels per degree of visual angle for FLIP (default corresponds to a 0.7m distance from a 0.7m wide 4K monitor).
+    uint32_t tileSize = 128;        ///< Size of the square tiles images are processed in.
+};
+
+/** Compare two images.
+    Images are processed in tiles in parallel, so only a few tiles of float data per thread are held in memory
+    in addition to the sources. The per-tile results are reduced in a fixed order, so the result is deterministic.
+    \param[in] imageA First (reference) image.
+    \param[in] imageB Second image. Must have the same resolution as the first.
+    \param[in] metric Error metric.
+    \param[in] options Comparison options.
+    \param[out] errorMap Optional per-pixel error map (width * height floats, row 0 is the top row).
+    \return Error of the given metric.
+*/
+double compareImages(const ImageSource& imageA, const ImageSource& imageB, ErrorMetric metric, const CompareOptions& options, float* errorMap = nullptr);